@@ -180,6 +180,15 @@ which also convenient when commenting out the last element.
 The serializer indents four spaces for each level of nesting. 
 Tables are written with the keys in alphabetic order.
 
+\section Performance
+
+load() and parse() scan the text directly from memory and only fall back to the
+general G3D::TextInput tokenizer for unusual syntax and for reporting errors, so
+they produce identical results in about half of the time of deserialize(TextInput&).
+Most of the remaining time is spent allocating the Any nodes themselves. For very large
+files, setDiskCacheDirectory() additionally keeps the compact binary form written by
+serializeCompact(), so that later loads of an unchanged file skip parsing entirely.
+
 \sa G3D::AnyTableReader
 */
 class Any {
@@ -334,6 +343,23 @@ private:
         simultaneously.*/    
     void ensureMutable();
 
+    /** Parser for the common subset of the syntax that works directly on the file
+        buffer.  Defined in Any_scanner.cpp. */
+    class Scanner;
+
+    /** Fast path for load(). Returns false if the file must instead be read by
+        deserialize(TextInput&), which also reports all errors. */
+    bool loadFast(const String& resolvedFilename);
+
+    /** Fast path for _parse(). \sa loadFast */
+    bool parseFast(const String& src);
+
+    /** Body of serializeCompact(). Strings are written once and then
+        referenced by their index in \a stringIndex. */
+    void serializeCompactValue(class BinaryOutput& b, Table<String, int>& stringIndex) const;
+
+    void deserializeCompactValue(class BinaryInput& b, Array<String>& stringTable);
+
     /** Read an unnamed a TABLE or ARRAY.  Token should be the open
         paren token; it is the next token after the close on
         return. Called from deserialize().*/
@@ -736,10 +762,23 @@ public:
     void clear();
 
     /** Parse from a file.
-     \sa deserialize, parse, fromFile, loadIfExists
+
+     If a disk cache directory has been set, an unchanged file is read
+     from its binary form in the cache instead of being parsed.
+
+     \sa deserialize, parse, fromFile, loadIfExists, setDiskCacheDirectory
      */
     void load(const String& filename);
 
+    /** Directory in which load() stores the binary form of each file that it parses.
+        Entries are keyed by an MD5 hash of the file's name and contents and are
+        ignored if any file that it #includes has since changed.  The directory
+        is created if it does not exist.  The default, the empty string,
+        disables the cache. */
+    static void setDiskCacheDirectory(const String& directory);
+
+    static const String& diskCacheDirectory();
+
     /** Load a new Any from \a filename. \sa load, save, loadIfExists */
     static Any fromFile(const String& filename);
 
@@ -753,6 +792,12 @@ public:
 
     void serialize(class BinaryOutput& b) const;
 
+    /** Compact binary encoding used by the load() disk cache. It preserves comments,
+        names, brackets, and source locations, so that the result is indistinguishable
+        from the parsed text, and is read by deserialize(BinaryInput&). Unlike
+        serialize(BinaryOutput&), G3D 10.00 and earlier cannot read it. */
+    void serializeCompact(class BinaryOutput& b) const;
+
     /** Parse from a stream.
      \sa load, parse */
     void deserialize(TextInput& ti);
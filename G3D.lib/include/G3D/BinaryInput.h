@@ -4,7 +4,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
  
  \created 2001-08-09
- \edited  2013-01-03
+ \edited  2026-10-18
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -50,7 +50,9 @@ namespace G3D {
  Sequential or random access byte-order independent binary file access.
  Files compressed with zlib and beginning with an unsigned 32-bit int
  size are transparently decompressed when the compressed = true flag is
- specified to the constructor.
+ specified to the constructor. Files written with BinaryOutput::setBlockCompression
+ are also detected in that case; their blocks are decompressed in parallel, a window of
+ DECOMPRESSION_WINDOW_BLOCKS blocks at a time, as the position moves through them.
 
  For every readX method there are also versions that operate on a whole
  Array, std::vector, or C-array.  e.g. readFloat32(Array<float32>& array, n)
@@ -80,6 +82,10 @@ private:
 #endif
     ;
 
+    /** Number of blocks of a file written with BinaryOutput::setBlockCompression that are
+        decompressed at a time. The window grows only for reads larger than it. */
+    static const int DECOMPRESSION_WINDOW_BLOCKS = 64;
+
     /**
      is the file big or little endian
      */
@@ -126,6 +132,29 @@ private:
      */
     bool            m_freeBuffer;
 
+    /** For files written with BinaryOutput::setBlockCompression, the offset of each
+        compressed block in the file. Empty for other files and for in-memory data, which is
+        decompressed in its entirety. */
+    Array<uint64>   m_blockOffset;
+
+    /** Offset of the block index, which is the end of the last compressed block */
+    int64           m_blockIndexOffset;
+
+    /** Uncompressed bytes per block */
+    int64           m_blockSize;
+
+    /** Sets m_length and the block index from the footer and index of a block-compressed file.
+        \a tail is the final \a tailLength bytes of the \a fileLength byte file. */
+    void readBlockIndex(const uint8* tail, int64 tailLength, int64 fileLength);
+
+    /** Decompresses blocks [first, first + count) from \a src, which contains the compressed data
+        beginning at m_blockOffset[first], into \a dst. Runs in parallel. */
+    void decompressBlocks(const uint8* src, int first, int count, uint8* dst);
+
+    /** Loads the blocks containing [startPosition, startPosition + minLength) of a
+        block-compressed file. Called by loadIntoMemory. */
+    void loadBlocksIntoMemory(int64 startPosition, int64 minLength);
+
     /** Ensures that we are able to read at least minLength from startPosition (relative
         to start of file). */
     void loadIntoMemory(int64 startPosition, int64 minLength = 0);
@@ -146,6 +175,9 @@ public:
     /** false, constant to use with the copyMemory option */
     static const bool       NO_COPY;
 
+    /** True if \a data begins with the header written by BinaryOutput::setBlockCompression */
+    static bool isBlockCompressed(const uint8* data, int64 dataLen);
+
     /**
        If the file cannot be opened, a zero length buffer is presented.
        Automatically opens files that are inside zipfiles.
@@ -266,6 +298,15 @@ public:
 
     void readBytes(void* bytes, int64 n);
 
+    /** Ensures that the next \a n bytes are in memory and returns a pointer to them
+        without advancing the position.  The pointer is invalidated by the next read,
+        seek, or skip.  Intended for bulk decoders that parse records directly out of
+        the buffer (e.g., ParsePLY).  Does not perform byte swapping. */
+    const uint8* peekBytes(int64 n) {
+        prepareToRead(n);
+        return m_buffer + m_pos;
+    }
+
     int8 readInt8() {
         prepareToRead(1);
         return m_buffer[m_pos++];
@@ -4,7 +4,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
  
  \created 2001-08-09
- \edited  2011-08-24
+ \edited  2026-10-18
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -40,7 +40,10 @@ namespace G3D {
 /**
  Sequential or random access byte-order independent binary file access.
 
- The compress() call can be used to compress with zlib.
+ The compress() call can be used to compress with zlib. setBlockCompression()
+ selects a framed format of independently compressed zlib blocks that is
+ compressed in parallel, streamed to disk, and supports payloads larger than 4 GB.
+ BinaryInput reads both formats when constructed with compressed = true.
 
  Any method call can trigger an out of memory error (thrown as char*) 
  when writing to "<memory>" instead of a file.
@@ -90,8 +93,34 @@ private:
 
     bool            m_ok;
 
+    /** zlib level for setBlockCompression(), or -1 when block compression is disabled */
+    int             m_blockCompressionLevel;
+
+    /** Uncompressed bytes per block */
+    size_t          m_compressionBlockSize;
+
+    /** Offset from the start of the output of each block that has been compressed so far */
+    Array<uint64>   m_blockOffset;
+
+    /** Bytes of compressed output already written to disk in block compression mode.
+        In that mode m_alreadyWritten counts uncompressed bytes. */
+    int64           m_compressedWritten;
+
     void reserveBytesWhenOutOfMemory(size_t bytes);
 
+    /** Compresses the first \a numBytes of m_buffer in parallel, appending the blocks to \a out.
+        \a numBytes must be a multiple of the block size unless \a final is true. */
+    void compressBlocks(size_t numBytes, bool final, Array<uint8>& out);
+
+    /** Streams as many whole blocks to disk as possible while keeping the last \a keepBytes of
+        the buffer and everything after the current position in memory.
+        Returns false if there was nothing to write. */
+    bool flushCompressedBlocks(size_t keepBytes);
+
+    /** Replaces the buffer with the remaining compressed blocks, the block index, and the footer.
+        Called by commit(). */
+    void finishBlockCompression();
+
     void reallocBuffer(size_t bytes, size_t oldBufferLen);
 
     /**
@@ -115,6 +144,9 @@ private:
 
 public:
 
+    /** Uncompressed size of each block for setBlockCompression() */
+    static const int DEFAULT_COMPRESSION_BLOCK_SIZE = 1024 * 1024;
+
     /**
      You must call setEndian() if you use this (memory) constructor.
      */
@@ -144,6 +176,32 @@ public:
      */
     void compress(int level = 9);
 
+    /** Compresses everything subsequently written as a sequence of independent zlib blocks
+        of \a blockSize uncompressed bytes each. Blocks are compressed in parallel. When writing
+        to a file, full blocks are streamed to disk once the buffer holds 64 blocks, so there is no
+        size limit; seeking backwards is only supported within the last 10 blocks. commit() compresses the
+        remainder and appends a block index that BinaryInput uses for random access.
+        For "<memory>" output, commit() replaces the buffer with the compressed data.
+
+        Must be called before anything is written. BinaryInput detects this format
+        automatically when constructed with compressed = true.
+
+        Format (all fields little-endian):
+        <pre>
+        "G3DZ" uint8 version=1 uint8[3] reserved
+        zlib block 0, block 1, ..., block n - 1
+        uint64 blockOffset[n]          (from the start of the file)
+        uint64 uncompressedSize
+        uint64 n
+        uint64 indexOffset
+        uint32 blockSize
+        "G3DZ"
+        </pre>
+
+        \param level Compression level.  0 = fast, low compression; 9 = slow, high compression
+     */
+    void setBlockCompression(int level = 6, int blockSize = DEFAULT_COMPRESSION_BLOCK_SIZE);
+
     /** True if no errors have been encountered.*/
     bool ok() const;
 
@@ -0,0 +1,196 @@
+/**
+  \file G3D/BlockCompressedImage.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#ifndef G3D_BlockCompressedImage_h
+#define G3D_BlockCompressedImage_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/Any.h"
+#include "G3D/enumclass.h"
+#include "G3D/ReferenceCount.h"
+#include "G3D/ImageFormat.h"
+
+namespace G3D {
+
+class PixelTransferBuffer;
+class CPUPixelTransferBuffer;
+class Image;
+
+/** Speed and quality tradeoff for BlockCompressedImage */
+G3D_DECLARE_ENUM_CLASS(CompressionQuality,
+        /** Bounding box endpoints. Fast enough to compress at load time. */
+        FAST,
+
+        /** Principal axis endpoints refined once by least squares */
+        NORMAL,
+
+        /** Repeated refinement followed by a local search over the quantized endpoints.
+            Several times slower than NORMAL. */
+        BEST);
+
+
+/**
+ \brief A mip chain of 4x4 block-compressed texels (BC1-BC5 and BC7, known to OpenGL as
+ DXT, RGTC, and BPTC), with a CPU encoder and DDS file input and output.
+
+ Block compressed textures occupy 4 or 8 bits per texel on the GPU instead of 24 or 32, and
+ are sampled without decompressing them first. Compressing offline (or once, with the result
+ cached on disk) therefore reduces both GPU memory and load time.
+
+ The encoder converts the source to RGBA8, box filters the mip chain (in linear space for sRGB
+ formats), and compresses each level in parallel across rows of blocks. Each block fits a line
+ through its texels in color space, quantizes the line's endpoints, and assigns every texel the
+ nearest of the interpolated colors with an SSE or AVX search. BC7 is always encoded in mode 6
+ (one subset, RGBA endpoints with 16 colors), which handles color and alpha well but is not as
+ precise as a full search over all eight modes.
+
+ psnr() reports the peak signal-to-noise ratio of the first mip level against the source over
+ the channels that the format stores, so that quality can be validated without a display.
+
+ <pre>
+   // Compresses brick.png once and reuses brick.RGBA_BC7.NORMAL.dds afterwards
+   const shared_ptr<BlockCompressedImage>& im =
+       BlockCompressedImage::fromFile("brick.png", BlockCompressedImage::Settings(ImageFormat::RGBA_BC7()));
+   debugPrintf("%5.2f dB\n", im->psnr());
+ </pre>
+
+ Texture::fromFile uses this class automatically when the requested encoding is one of the
+ supported formats.
+
+ \sa Texture::fromBlockCompressedImage, Image, ImageFormat
+*/
+class BlockCompressedImage : public ReferenceCountedObject {
+public:
+
+    class Settings {
+    public:
+        /** Must satisfy supportsFormat(). Default is RGBA_BC7. */
+        const ImageFormat*      format;
+
+        /** Default is NORMAL */
+        CompressionQuality      quality;
+
+        /** If true, compress a complete mip chain down to 1x1. Default is true. */
+        bool                    generateMipMaps;
+
+        Settings(const ImageFormat* format = ImageFormat::RGBA_BC7(), CompressionQuality quality = CompressionQuality::NORMAL) :
+            format(format), quality(quality), generateMipMaps(true) {}
+
+        /** A string is interpreted as the format.
+
+         <pre>
+           BlockCompressedImage::Settings {
+               format = "SRGBA_BC7";
+               quality = "BEST";
+               generateMipMaps = true;
+           }
+         </pre>
+        */
+        explicit Settings(const Any& any);
+
+        Any toAny() const;
+    };
+
+    class MipLevel {
+    public:
+        int                     width;
+        int                     height;
+
+        /** Blocks in row-major order, each ImageFormat::cpuBitsPerPixel bits long */
+        Array<uint8>            data;
+
+        MipLevel() : width(0), height(0) {}
+    };
+
+protected:
+
+    const ImageFormat*          m_format;
+    Array<MipLevel>             m_mipLevel;
+
+    /** In dB; nan() when unknown */
+    float                       m_psnr;
+
+    BlockCompressedImage() : m_format(NULL), m_psnr(nan()) {}
+
+    static shared_ptr<BlockCompressedImage> compress(int width, int height, Array<uint8>& rgba, const Settings& settings);
+
+public:
+
+    /** True for RGB_DXT1, RGBA_DXT1, RGBA_DXT3, RGBA_DXT5 (BC1-BC3) and their sRGB versions,
+        R_BC4, RG_BC5, RGBA_BC7, and SRGBA_BC7 */
+    static bool supportsFormat(const ImageFormat* format);
+
+    /** Compresses \a src, which may be in any format that ImageConvert can convert to RGBA8. */
+    static shared_ptr<BlockCompressedImage> fromPixelTransferBuffer(const shared_ptr<PixelTransferBuffer>& src, const Settings& settings = Settings());
+
+    static shared_ptr<BlockCompressedImage> fromImage(const shared_ptr<Image>& src, const Settings& settings = Settings());
+
+    /** Loads a DDS file directly, ignoring \a settings. Any other image is loaded from
+        cacheFilename() if that file is at least as new as the source, and is otherwise
+        compressed and written to cacheFilename() when \a useCache is true. A cache that
+        cannot be written, e.g., because the source is in a zipfile, is silently skipped. */
+    static shared_ptr<BlockCompressedImage> fromFile(const String& filename, const Settings& settings = Settings(), bool useCache = true);
+
+    /** The file next to \a filename in which fromFile() caches the compressed result, e.g.,
+        <code>brick.RGBA_BC7.NORMAL.dds</code> for <code>brick.png</code> */
+    static String cacheFilename(const String& filename, const Settings& settings);
+
+    /** Reads a DDS file in a supported format with a DX9 (FourCC) or DX10 header. Throws
+        ParseError for cube maps, arrays, and unsupported formats. */
+    static shared_ptr<BlockCompressedImage> fromDDSFile(const String& filename);
+
+    /** Writes a DDS file. BC1-BC3 without sRGB use the DX9 header that older tools expect,
+        and all other formats use the DX10 header. */
+    void save(const String& filename) const;
+
+    /** Decodes one mip level to RGBA8. Channels that the format does not store are 0, except
+        alpha, which is 1. BC7 blocks in modes other than 6 (which this encoder never writes)
+        decode as black. */
+    shared_ptr<CPUPixelTransferBuffer> decompress(int mipLevel = 0) const;
+
+    /** Peak signal-to-noise ratio of mip level 0 against the source image, in dB, over the
+        channels that the format stores. finf() for a lossless result and nan() if the source
+        is unknown. Stored in DDS files written by save(). */
+    float psnr() const {
+        return m_psnr;
+    }
+
+    const ImageFormat* format() const {
+        return m_format;
+    }
+
+    int width() const {
+        return m_mipLevel[0].width;
+    }
+
+    int height() const {
+        return m_mipLevel[0].height;
+    }
+
+    int numMipLevels() const {
+        return m_mipLevel.size();
+    }
+
+    const MipLevel& mipLevel(int m) const {
+        return m_mipLevel[m];
+    }
+
+    /** Total bytes of compressed data in all mip levels */
+    size_t sizeInMemory() const;
+};
+
+} // namespace G3D
+
+G3D_DECLARE_ENUM_CLASS_HASHCODE(G3D::CompressionQuality);
+
+#endif
@@ -0,0 +1,354 @@
+/**
+  \file G3D/BoundedThreadsafeQueue.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+ */
+
+#ifndef G3D_BoundedThreadsafeQueue_h
+#define G3D_BoundedThreadsafeQueue_h
+
+#include <atomic>
+#include <thread>
+#include "G3D/platform.h"
+#include "G3D/g3dmath.h"
+#include "G3D/System.h"
+
+namespace G3D {
+
+namespace _internal {
+
+/**
+  Lets threads sleep until a condition that is checked without a lock becomes true, while keeping
+  notification free when no thread is sleeping. Waiters call prepareWait(), re-check their
+  condition, and then either cancelWait() or commitWait() with the returned key. Notifiers change
+  the condition and then call notifyAll(). This is Vyukov's eventcount.
+
+  Uses a futex on Linux and a mutex with a condition variable elsewhere.
+*/
+class EventCount {
+private:
+    /** Epoch in the high 32 bits, number of waiters in the low 32 bits. notifyAll() advances the
+        epoch and zeroes the waiter count in one step, so a burst of notifications makes only one
+        system call even before the woken threads run. */
+    std::atomic<uint64>     m_state;
+
+    /** Opaque storage for the condition variable used on platforms without futexes */
+    void*                   m_platform;
+
+    static uint32 epoch(uint64 state) {
+        return uint32(state >> 32);
+    }
+
+    static uint32 waiters(uint64 state) {
+        return uint32(state);
+    }
+
+    void wakeAll();
+
+public:
+
+    EventCount();
+    ~EventCount();
+
+    uint32 prepareWait() {
+        return epoch(m_state.fetch_add(1, std::memory_order_seq_cst));
+    }
+
+    /** Withdraws the prepareWait() that returned \a key */
+    void cancelWait(uint32 key) {
+        uint64 s = m_state.load(std::memory_order_relaxed);
+        // If the epoch changed, notifyAll() already removed this waiter
+        while ((epoch(s) == key) && (waiters(s) > 0) &&
+               ! m_state.compare_exchange_weak(s, s - 1, std::memory_order_seq_cst)) {}
+    }
+
+    /** Sleeps until notifyAll() is invoked after the prepareWait() that returned \a key, or
+        until \a timeout seconds elapse. May wake spuriously. */
+    void commitWait(uint32 key, RealTime timeout);
+
+    void notifyAll() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters(m_state.load(std::memory_order_seq_cst)) > 0) {
+            wakeAll();
+        }
+    }
+};
+
+} // _internal
+
+
+/**
+  \brief A fixed-capacity first-in, first-out queue that any number of threads may push to and
+  pop from concurrently without locking.
+
+  ThreadsafeQueue serializes every operation with a Spinlock and cannot wait for data. This class
+  is a ring buffer of sequence-numbered cells in which producers and consumers each reserve slots
+  with a single atomic compare-and-swap, so threads only contend when they touch the same end of
+  the queue at the same instant. The batch methods reserve a run of slots with one
+  compare-and-swap.
+
+  The capacity bounds memory and provides backpressure: tryPushBack() fails when the queue is full
+  and pushBack() blocks until a consumer makes room. popFront() blocks until data arrives. Blocked
+  threads sleep in the kernel (on a futex on Linux) rather than spinning, and non-blocking
+  operations never make a system call when no thread is waiting.
+
+  T must be default constructible and assignable. Elements are copied in and out, so for large
+  objects store pointers.
+
+  \sa ThreadsafeQueue, Queue
+*/
+template<class T>
+class BoundedThreadsafeQueue {
+private:
+
+    class Cell {
+    public:
+        /** Equal to the position that may write this cell when it is empty, and to that
+            position plus one when it is full */
+        std::atomic<size_t>     sequence;
+        T                       value;
+    };
+
+    /** Keep the two ends of the queue on separate cache lines so that producers and consumers
+        do not invalidate each other's cache */
+    enum {CACHE_LINE_SIZE = 64};
+
+    /** Number of times that blocking methods retry before sleeping */
+    enum {SPINS_BEFORE_SLEEP = 16};
+
+    Cell*                   m_cell;
+    const size_t            m_mask;
+    uint8                   m_pad0[CACHE_LINE_SIZE];
+
+    /** Next position to write */
+    std::atomic<size_t>     m_enqueuePos;
+    uint8                   m_pad1[CACHE_LINE_SIZE];
+
+    /** Next position to read */
+    std::atomic<size_t>     m_dequeuePos;
+    uint8                   m_pad2[CACHE_LINE_SIZE];
+
+    _internal::EventCount   m_notEmpty;
+    _internal::EventCount   m_notFull;
+
+    // Not copyable
+    BoundedThreadsafeQueue(const BoundedThreadsafeQueue&);
+    BoundedThreadsafeQueue& operator=(const BoundedThreadsafeQueue&);
+
+    static size_t roundUpCapacity(int capacity) {
+        debugAssertM(capacity > 0, "Capacity must be positive");
+        size_t c = 2;
+        while (c < size_t(capacity)) {
+            c *= 2;
+        }
+        return c;
+    }
+
+    /** Waits for the producer or consumer that reserved \a cell to finish with it */
+    static void waitForSequence(const Cell& cell, size_t sequence) {
+        while (cell.sequence.load(std::memory_order_acquire) != sequence) {
+            std::this_thread::yield();
+        }
+    }
+
+    /** Waits on \a event until \a attempt succeeds or the deadline passes */
+    template<class Attempt>
+    static bool blockUntil(_internal::EventCount& event, RealTime timeout, const Attempt& attempt) {
+        const RealTime deadline = (timeout == finf()) ? finf() : System::time() + timeout;
+        while (true) {
+            // Briefly yield before sleeping, since the other end of the queue is usually about
+            // to make progress and a sleep costs two system calls
+            for (int i = 0; i < SPINS_BEFORE_SLEEP; ++i) {
+                if (attempt()) {
+                    return true;
+                }
+                std::this_thread::yield();
+            }
+
+            const uint32 key = event.prepareWait();
+            // Re-check after announcing the wait so that a notification sent before
+            // prepareWait() is not missed
+            if (attempt()) {
+                event.cancelWait(key);
+                return true;
+            }
+
+            const RealTime remaining = (deadline == finf()) ? finf() : deadline - System::time();
+            if (remaining <= 0) {
+                event.cancelWait(key);
+                return false;
+            }
+            event.commitWait(key, remaining);
+        }
+    }
+
+public:
+
+    /** \param capacity Rounded up to a power of two */
+    explicit BoundedThreadsafeQueue(int capacity) : m_mask(roundUpCapacity(capacity) - 1), m_enqueuePos(0), m_dequeuePos(0) {
+        m_cell = new Cell[m_mask + 1];
+        for (size_t i = 0; i <= m_mask; ++i) {
+            m_cell[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedThreadsafeQueue() {
+        delete[] m_cell;
+    }
+
+    int capacity() const {
+        return int(m_mask + 1);
+    }
+
+    /** Returns false without blocking if the queue is full */
+    bool tryPushBack(const T& v) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cell[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = v;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    m_notEmpty.notifyAll();
+                    return true;
+                }
+            } else if (diff < 0) {
+                // Full
+                return false;
+            } else {
+                // Another producer claimed this slot
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Returns false without blocking if the queue is empty */
+    bool tryPopFront(T& v) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cell[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    v = cell.value;
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    m_notFull.notifyAll();
+                    return true;
+                }
+            } else if (diff < 0) {
+                // Empty
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Pushes as many of \a v[0...count - 1] as fit, in order, and returns the number pushed.
+        Reserves all slots with one atomic operation. */
+    int tryPushBack(const T* v, int count) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t n = 0;
+        do {
+            const intptr_t used = intptr_t(pos - m_dequeuePos.load(std::memory_order_acquire));
+            if (used < 0) {
+                // pos is stale; consumers have already passed it
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            // A stale dequeue position underestimates the free space, which is safe
+            n = min(size_t(count), size_t(max(intptr_t(0), intptr_t(m_mask + 1) - used)));
+            if (n == 0) {
+                return 0;
+            }
+        } while (! m_enqueuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed));
+
+        for (size_t i = 0; i < n; ++i) {
+            Cell& cell = m_cell[(pos + i) & m_mask];
+            // A consumer may have reserved but not yet finished reading this slot
+            waitForSequence(cell, pos + i);
+            cell.value = v[i];
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        m_notEmpty.notifyAll();
+        return int(n);
+    }
+
+    /** Pops up to \a maxCount elements into \a v, in order, and returns the number popped.
+        Reserves all slots with one atomic operation. */
+    int tryPopFront(T* v, int maxCount) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        size_t n = 0;
+        do {
+            const size_t enqueued = m_enqueuePos.load(std::memory_order_acquire);
+            n = min(size_t(maxCount), (enqueued > pos) ? enqueued - pos : 0);
+            if (n == 0) {
+                return 0;
+            }
+        } while (! m_dequeuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed));
+
+        for (size_t i = 0; i < n; ++i) {
+            Cell& cell = m_cell[(pos + i) & m_mask];
+            // A producer may have reserved but not yet finished writing this slot
+            waitForSequence(cell, pos + i + 1);
+            v[i] = cell.value;
+            cell.sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+        }
+        m_notFull.notifyAll();
+        return int(n);
+    }
+
+    /** Blocks while the queue is full. Returns false if \a timeout seconds elapse first. */
+    bool pushBack(const T& v, RealTime timeout = finf()) {
+        return blockUntil(m_notFull, timeout, [&]() { return tryPushBack(v); });
+    }
+
+    /** Blocks while the queue is empty. Returns false if \a timeout seconds elapse first. */
+    bool popFront(T& v, RealTime timeout = finf()) {
+        return blockUntil(m_notEmpty, timeout, [&]() { return tryPopFront(v); });
+    }
+
+    /** Pushes all of \a v[0...count - 1], blocking while the queue is full. Returns the number
+        pushed, which is less than \a count only if \a timeout seconds elapse first. */
+    int pushBack(const T* v, int count, RealTime timeout = finf()) {
+        int pushed = 0;
+        blockUntil(m_notFull, timeout, [&]() {
+            pushed += tryPushBack(v + pushed, count - pushed);
+            return pushed == count;
+        });
+        return pushed;
+    }
+
+    /** Blocks until at least one element is available, then pops up to \a maxCount of them
+        into \a v. Returns 0 if \a timeout seconds elapse first. */
+    int popFront(T* v, int maxCount, RealTime timeout = finf()) {
+        int popped = 0;
+        blockUntil(m_notEmpty, timeout, [&]() {
+            popped = tryPopFront(v, maxCount);
+            return popped > 0;
+        });
+        return popped;
+    }
+
+    /** Number of elements reserved for reading but not yet popped. Note that by the time the
+        method has returned, the value may be incorrect. */
+    int size() const {
+        const size_t d = m_dequeuePos.load(std::memory_order_acquire);
+        const size_t e = m_enqueuePos.load(std::memory_order_acquire);
+        return (e > d) ? int(e - d) : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
+
+} // G3D
+
+#endif
@@ -11,6 +11,8 @@
 #include "G3D/ReferenceCount.h"
 #include "G3D/Array.h"
 #include "G3D/Image3.h"
+#include "G3D/AtomicInt32.h"
+#include "G3D/GMutex.h"
 
 namespace G3D {
 
@@ -32,11 +34,59 @@ protected:
     /** Size before padding */
     float       m_fSize;
 
+    /** Number of levels in the box-filtered mip chain, including level 0 (m_faceArray) */
+    int         m_numMipLevels;
+
+    /** Levels 1 and higher of the box-filtered mip chain used by trilinear(), padded like
+        m_faceArray. Each level is filtered from the unpadded faces of the level above and
+        then given new borders, so that level L has max(1, size() >> L) pixels on a side and
+        the borders never bleed into the interior. Face f of level L is m_mipFace[(L - 1) * 6 + f]. 
+        Built lazily. */
+    mutable Array<shared_ptr<Image3>> m_mipFace;
+
+    /** Nonzero once m_mipFace has been built */
+    mutable AtomicInt32 m_mipValid;
+
+    /** Serializes construction of m_mipFace */
+    mutable Spinlock    m_mipLock;
+
+    /** Number of levels in the GGX chain, including level 0 (m_faceArray) */
+    int         m_numGGXLevels;
+
+    /** Levels 1 and higher of the GGX-prefiltered chain, padded like m_faceArray.
+        Face f of level L is m_ggxFace[(L - 1) * 6 + f]. Built lazily. */
+    mutable Array<shared_ptr<Image3>> m_ggxFace;
+
+    /** Nonzero once m_ggxFace has been built */
+    mutable AtomicInt32 m_ggxValid;
+
+    /** Serializes construction of m_ggxFace */
+    mutable Spinlock    m_ggxLock;
+
     CubeMap(const Array<shared_ptr<Image3>>& face, const Color3& readMultiplyFirst, const Color3& readAddSecond);
 
+    /** Copies the six \a face images into \a dst with a one-pixel border on each side
+        taken from the adjacent faces, so that bilinear lookups are seamless. */
+    static void copyWithBorders(const Array<shared_ptr<Image3>>& face, const Color3& readMultiplyFirst, const Color3& readAddSecond, Image3* const* dst);
+
+    /** Returns a texture coordinate on [0, 1]^2 within \a face */
+    static Vector2 texCoord(const Vector3& vec, CubeFace& face);
+
+    /** Inverse of texCoord. The result is not unit length. */
+    static Vector3 direction(CubeFace face, const Vector2& texCoord);
+
     /** Returns a pixel coordinate in m_faceArray[face] */
     Vector2 pixelCoord(const Vector3& vec, CubeFace& face) const;
 
+    /** Bilinear lookup in \a image, which is a face padded like m_faceArray, at texture coordinate \a texCoord */
+    static Color3 paddedBilinear(const Image3& image, const Vector2& texCoord);
+
+    /** Bilinear lookup in level \a level of the box-filtered mip chain */
+    Color3 mipBilinear(int level, const Vector3& v) const;
+
+    /** Bilinear lookup in level \a level of the GGX chain */
+    Color3 ggxBilinear(int level, const Vector3& v) const;
+
 public:
     /** \param face All faces must have the same dimensions. 
         \param gamma Apply this gamma: L = p^gamma after reading back values (before bilinear interpolation, and before scale and bias)
@@ -45,6 +95,44 @@ public:
     Color3 nearest(const Vector3& v) const;
     Color3 bilinear(const Vector3& v) const;
 
+    /** Mip-mapped lookup. \a lod is log2 of the width of the filter footprint in texels of a face.
+        \sa Map2D::trilinear */
+    Color3 trilinear(const Vector3& v, float lod) const;
+
+    /** Mip-mapped lookup with the footprint chosen from the screen-space derivatives of 
+        the lookup direction \a v (e.g., from ray differentials). */
+    Color3 trilinear(const Vector3& v, const Vector3& dvdx, const Vector3& dvdy) const;
+
+    /** Radiance convolved with a GGX lobe of the given \a roughness on [0, 1]
+        (alpha = roughness^2) centered on \a v, under the common approximation that the 
+        normal, view, and reflection vectors are equal. Interpolates between levels of a chain 
+        of prefiltered, successively lower resolution cube maps that is built on first use.
+        roughness = 0 matches bilinear(). */
+    Color3 prefilteredGGX(const Vector3& v, float roughness) const;
+
+    /** Batched bilinear() over \a n directions. \sa Map2D::trilinear */
+    void bilinear(const Vector3* v, Color3* result, int n) const;
+
+    /** Batched trilinear() */
+    void trilinear(const Vector3* v, const float* lod, Color3* result, int n) const;
+
+    /** Batched prefilteredGGX() */
+    void prefilteredGGX(const Vector3* v, const float* roughness, Color3* result, int n) const;
+
+    /** Builds the mip chain used by trilinear() if it has not been built yet. Threadsafe. */
+    void generateMipMaps() const;
+
+    /** Builds the chain used by prefilteredGGX() if it has not been built yet. This takes 
+        time proportional to the number of texels, so call it during loading to avoid a
+        hitch at the first lookup. Threadsafe. */
+    void generateGGXMipMaps() const;
+
+    /** Number of roughness levels in the prefilteredGGX() chain. Level L has roughness
+        L / (numGGXLevels() - 1) and max(1, size() >> L) pixels on a side. */
+    int numGGXLevels() const {
+        return m_numGGXLevels;
+    }
+
     /** The size of one face, in pixels, based on the input (not counting padding used for seamless cube mapping */
     int size() const;
 
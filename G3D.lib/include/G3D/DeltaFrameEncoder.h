@@ -0,0 +1,211 @@
+/**
+  \file G3D/DeltaFrameEncoder.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#ifndef G3D_DeltaFrameEncoder_h
+#define G3D_DeltaFrameEncoder_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/Queue.h"
+#include "G3D/Image.h"
+
+namespace G3D {
+
+class BinaryOutput;
+class CPUPixelTransferBuffer;
+
+/**
+ \brief Encodes a stream of frames for transmission to a single remote viewer by sending only the
+ fixed-size tiles that changed since the previous frame.
+
+ Each frame is divided into Settings::tileSize square tiles. encode() hashes every tile and
+ compresses only those whose hash differs from the last frame that it encoded, in parallel, as
+ independent PNG or JPEG images. Every Settings::keyframeInterval frames, and after
+ forceKeyframe(), every tile is sent so that a viewer that joins late or lost state recovers.
+
+ The encoder also paces the stream. The application calls acknowledge() when the viewer reports
+ that it received a frame, and readyToSend() returns false while too many bytes or frames are
+ unacknowledged, so a slow connection receives fewer, fresher frames instead of an ever-growing
+ backlog. Skipped frames cost nothing: the next encode() sends everything that changed since the
+ last frame that was actually encoded.
+
+ Use one DeltaFrameEncoder per connection, since the tiles to send depend on what that viewer has
+ already received.
+
+ <pre>
+   if (encoder->readyToSend()) {
+       DeltaFrameEncoder::Frame frame;
+       if (encoder->encode(image->toPixelTransferBuffer(), frame)) {
+           BinaryOutput bo("<memory>", G3D_BIG_ENDIAN);
+           frame.serialize(bo);
+           send(bo);
+       }
+   }
+   ...
+   // when the viewer reports receiving a frame
+   encoder->acknowledge();
+ </pre>
+
+ \sa VideoOutput, Image::serialize
+*/
+class DeltaFrameEncoder {
+public:
+
+    class Settings {
+    public:
+        /** Width and height of a tile in pixels. Smaller tiles send less when little changes
+            but compress less well. Default is 64. */
+        int                     tileSize;
+
+        /** Send every tile every this many encoded frames. 0 sends only the first frame
+            (and those after forceKeyframe()) in full. Default is 300. */
+        int                     keyframeInterval;
+
+        /** Image::PNG or Image::JPEG. Default is JPEG. */
+        Image::ImageFileFormat  tileFormat;
+
+        /** readyToSend() returns false while more than this many encoded bytes are
+            unacknowledged. Default is 4 MB. */
+        size_t                  maxBytesInFlight;
+
+        /** readyToSend() returns false while this many frames are unacknowledged. Default is 2. */
+        int                     maxFramesInFlight;
+
+        Settings() :
+            tileSize(64),
+            keyframeInterval(300),
+            tileFormat(Image::JPEG),
+            maxBytesInFlight(4 * 1024 * 1024),
+            maxFramesInFlight(2) {}
+    };
+
+    /** A compressed rectangle of a frame */
+    class Tile {
+    public:
+        /** Pixel bounds of this tile within the frame. Tiles at the right and bottom edges
+            may be smaller than Settings::tileSize. */
+        int                     x;
+        int                     y;
+        int                     width;
+        int                     height;
+
+        /** PNG or JPEG file contents */
+        Array<uint8>            data;
+
+        Tile() : x(0), y(0), width(0), height(0) {}
+    };
+
+    class Frame {
+    public:
+        /** Number of frames encoded before this one */
+        int                     index;
+
+        /** True if tiles covers the entire frame */
+        bool                    keyframe;
+
+        int                     width;
+        int                     height;
+
+        Image::ImageFileFormat  tileFormat;
+
+        /** Only the tiles that changed */
+        Array<Tile>             tiles;
+
+        Frame() : index(0), keyframe(false), width(0), height(0), tileFormat(Image::JPEG) {}
+
+        /** Total size of the compressed tile data in bytes */
+        size_t dataSize() const;
+
+        /** Writes:
+            <pre>
+              int32 width, height, index
+              uint8 keyframe
+              int32 number of tiles
+              for each tile:
+                 int32 x, y, width, height, data size
+                 data
+            </pre>
+            in the byte order of \a bo. */
+        void serialize(BinaryOutput& bo) const;
+    };
+
+protected:
+
+    Settings                    m_settings;
+
+    int                         m_width;
+    int                         m_height;
+    const ImageFormat*          m_format;
+
+    /** Tiles per row and column */
+    int                         m_tilesX;
+    int                         m_tilesY;
+
+    /** Hash of each tile as last encoded, in row-major order */
+    Array<uint64>               m_tileHash;
+
+    int                         m_frameCount;
+    bool                        m_forceKeyframe;
+
+    /** dataSize() of each unacknowledged frame, oldest first */
+    Queue<size_t>               m_inFlight;
+    size_t                      m_bytesInFlight;
+
+    /** Resets the tile grid for a new frame size or format */
+    void resize(int width, int height, const ImageFormat* format);
+
+    uint64 hashTile(const CPUPixelTransferBuffer* src, int tx, int ty) const;
+
+    void encodeTile(const CPUPixelTransferBuffer* src, Tile& tile) const;
+
+public:
+
+    DeltaFrameEncoder(const Settings& settings = Settings());
+
+    const Settings& settings() const {
+        return m_settings;
+    }
+
+    /** Encodes the tiles of \a src that changed since the previous call into \a frame and
+        counts the frame as in flight. Returns false, and does not count the frame, if
+        nothing changed. \a src must be in an 8-bit per channel format such as RGB8 or RGBA8. */
+    bool encode(const shared_ptr<CPUPixelTransferBuffer>& src, Frame& frame);
+
+    bool encode(const shared_ptr<Image>& src, Frame& frame);
+
+    /** Sends every tile on the next encode() */
+    void forceKeyframe() {
+        m_forceKeyframe = true;
+    }
+
+    /** False while the viewer is too far behind to accept another frame */
+    bool readyToSend() const {
+        return (m_inFlight.size() < m_settings.maxFramesInFlight) &&
+            (m_bytesInFlight <= m_settings.maxBytesInFlight);
+    }
+
+    /** Marks the oldest in-flight frame as received by the viewer */
+    void acknowledge();
+
+    /** Number of frames encoded but not yet acknowledged */
+    int framesInFlight() const {
+        return m_inFlight.size();
+    }
+
+    size_t bytesInFlight() const {
+        return m_bytesInFlight;
+    }
+};
+
+} // namespace G3D
+
+#endif
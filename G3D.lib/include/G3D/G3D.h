@@ -64,6 +64,7 @@
 #include "G3D/Projection.h"
 #include "G3D/PhysicsFrame.h"
 #include "G3D/PhysicsFrameSpline.h"
+#include "G3D/PhysicsFrameSplineBatch.h"
 #include "G3D/Plane.h"
 #include "G3D/Line.h"
 #include "G3D/Ray.h"
@@ -79,6 +80,7 @@
 #include "G3D/prompt.h"
 #include "G3D/Table.h"
 #include "G3D/FileSystem.h"
+#include "G3D/ZipfileCache.h"
 #include "G3D/Set.h"
 #include "G3D/GUniqueID.h"
 #include "G3D/RayGridIterator.h"
@@ -106,6 +108,7 @@
 #include "G3D/CubeFace.h"
 #include "G3D/Line2D.h"
 #include "G3D/ThreadsafeQueue.h"
+#include "G3D/BoundedThreadsafeQueue.h"
 #include "G3D/network.h"
 #include "G3D/FrameName.h"
 #include "G3D/G3DAllocator.h"
@@ -119,6 +122,8 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 };
 
 #include "G3D/Image.h"
+#include "G3D/BlockCompressedImage.h"
+#include "G3D/ImageFilter.h"
 #include "G3D/CubeMap.h"
 #include "G3D/CollisionDetection.h"
 #include "G3D/Intersect.h"
@@ -150,6 +155,7 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 #include "G3D/Stopwatch.h"
 #include "G3D/AtomicInt32.h"
 #include "G3D/Thread.h"
+#include "G3D/radixSort.h"
 #include "G3D/ThreadSet.h"
 #include "G3D/RegistryUtil.h"
 #include "G3D/Any.h"
@@ -180,6 +186,7 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 #include "G3D/FastPointHashGrid.h"
 #include "G3D/PixelTransferBuffer.h"
 #include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/DeltaFrameEncoder.h"
 #include "G3D/CompassDirection.h"
 #include "G3D/Access.h"
 #include "G3D/DepthFirstTreeBuilder.h"
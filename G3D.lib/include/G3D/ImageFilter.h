@@ -0,0 +1,124 @@
+/**
+  \file G3D/ImageFilter.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#ifndef G3D_ImageFilter_h
+#define G3D_ImageFilter_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/enumclass.h"
+#include "G3D/WrapMode.h"
+
+namespace G3D {
+
+class Image3;
+class Image4;
+class PixelTransferBuffer;
+class CPUPixelTransferBuffer;
+
+/** Reconstruction filter for ImageFilter::resample and ImageFilter::generateMipMaps */
+G3D_DECLARE_ENUM_CLASS(ResampleFilter,
+        /** Nearest neighbor when magnifying and an area average when minifying. Support 0.5. */
+        BOX,
+
+        /** Bilinear interpolation. Support 1. */
+        TRIANGLE,
+
+        /** Mitchell-Netravali cubic with B = C = 1/3. Support 2. */
+        MITCHELL,
+
+        /** Lanczos-windowed sinc with three lobes. Sharpest, with some ringing. Support 3. */
+        LANCZOS3,
+
+        /** Kaiser-windowed sinc (alpha = 4). Less ringing than LANCZOS3, so it is a good
+            choice for mip chains of detailed textures. Support 3. */
+        KAISER);
+
+
+/**
+ \brief Separable convolution, resampling, and mip chain generation for images in CPU memory.
+
+ Every operation works directly on the contiguous storage of an Image3, Image4, or
+ CPUPixelTransferBuffer instead of calling Map2D::get and Map2D::set per pixel. Pixels are
+ filtered as four floats each, first horizontally into a scratch buffer and then vertically,
+ with SSE or (when System::hasAVX()) AVX inner loops. The destination is divided into
+ bands of rows that are processed in parallel.
+
+ PixelTransferBuffers in sRGB formats are converted to linear before filtering and back to sRGB
+ afterwards, so that, for example, the mip maps of a black and white checkerboard are the
+ same brightness as the original at a distance. R8, L8, RGB8, SRGB8, RGBA8, SRGBA8, R32F,
+ RGB32F, and RGBA32F buffers produce results in the same format. Buffers in other formats that
+ ImageConvert can convert to RGBA32F produce RGBA32F results. Unorm8 results are clamped to [0, 1].
+
+ <pre>
+   Array<shared_ptr<CPUPixelTransferBuffer>> mip;
+   ImageFilter::generateMipMaps(ImageFilter::resample(Image::fromFile("brick.png")->toPixelTransferBuffer(), 512, 512), mip, ResampleFilter::KAISER);
+ </pre>
+
+ \sa gaussian1D, Map2D::generateMipMaps, BlockCompressedImage
+*/
+class ImageFilter {
+private:
+
+    ImageFilter();
+
+public:
+
+    /** Half-width of \a filter's footprint in source pixels at unit scale */
+    static float support(ResampleFilter filter);
+
+    /** Value of \a filter at offset \a x pixels from its center (not normalized) */
+    static float evaluate(ResampleFilter filter, float x);
+
+    /** Convolves rows with \a kernelX and then columns with \a kernelY. Each kernel must have
+        an odd number of elements and is centered on its middle element. Kernels are not
+        normalized. Pixels outside of \a src are read according to its wrapMode(), except that
+        WrapMode::ERROR and WrapMode::IGNORE clamp. */
+    static shared_ptr<Image4> convolve(const shared_ptr<Image4>& src, const Array<float>& kernelX, const Array<float>& kernelY);
+
+    static shared_ptr<Image3> convolve(const shared_ptr<Image3>& src, const Array<float>& kernelX, const Array<float>& kernelY);
+
+    static shared_ptr<CPUPixelTransferBuffer> convolve(const shared_ptr<PixelTransferBuffer>& src, const Array<float>& kernelX, const Array<float>& kernelY, WrapMode wrap = WrapMode::CLAMP);
+
+    /** Gaussian blur with standard deviation \a std pixels, using a gaussian1D kernel that
+        extends 3 std to each side */
+    static shared_ptr<Image4> gaussianBlur(const shared_ptr<Image4>& src, float std);
+
+    static shared_ptr<Image3> gaussianBlur(const shared_ptr<Image3>& src, float std);
+
+    static shared_ptr<CPUPixelTransferBuffer> gaussianBlur(const shared_ptr<PixelTransferBuffer>& src, float std, WrapMode wrap = WrapMode::CLAMP);
+
+    /** Scales \a src to \a width x \a height. Pixel centers are aligned as they are for texture
+        sampling, and the filter is widened when minifying so that it also removes frequencies
+        that the result cannot represent. Weights are normalized, so a constant image remains
+        constant even at the edges. */
+    static shared_ptr<Image4> resample(const shared_ptr<Image4>& src, int width, int height, ResampleFilter filter = ResampleFilter::LANCZOS3);
+
+    static shared_ptr<Image3> resample(const shared_ptr<Image3>& src, int width, int height, ResampleFilter filter = ResampleFilter::LANCZOS3);
+
+    static shared_ptr<CPUPixelTransferBuffer> resample(const shared_ptr<PixelTransferBuffer>& src, int width, int height, ResampleFilter filter = ResampleFilter::LANCZOS3, WrapMode wrap = WrapMode::CLAMP);
+
+    /** Sets \a mip to the complete mip chain of \a src, down to 1x1. mip[0] is \a src and level
+        L is max(1, width >> L) x max(1, height >> L), resampled from level L - 1. */
+    static void generateMipMaps(const shared_ptr<Image4>& src, Array< shared_ptr<Image4> >& mip, ResampleFilter filter = ResampleFilter::BOX);
+
+    static void generateMipMaps(const shared_ptr<Image3>& src, Array< shared_ptr<Image3> >& mip, ResampleFilter filter = ResampleFilter::BOX);
+
+    /** mip[0] is a copy of \a src in the result format */
+    static void generateMipMaps(const shared_ptr<PixelTransferBuffer>& src, Array< shared_ptr<CPUPixelTransferBuffer> >& mip, ResampleFilter filter = ResampleFilter::BOX, WrapMode wrap = WrapMode::CLAMP);
+};
+
+} // namespace G3D
+
+G3D_DECLARE_ENUM_CLASS_HASHCODE(G3D::ResampleFilter);
+
+#endif
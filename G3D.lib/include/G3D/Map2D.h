@@ -5,7 +5,7 @@
 
  @maintainer Morgan McGuire, morgan@cs.brown.edu
  @created 2004-10-10
- @edited  2009-03-24
+ @edited  2026-10-18
  */
 #ifndef G3D_Map2D_h
 #define G3D_Map2D_h
@@ -18,10 +18,12 @@
 #include "G3D/ReferenceCount.h"
 #include "G3D/AtomicInt32.h"
 #include "G3D/Thread.h"
+#include "G3D/GMutex.h"
 #include "G3D/Rect2D.h"
 #include "G3D/WrapMode.h"
 
 #include "G3D/G3DString.h"
+#include <emmintrin.h>
 
 namespace G3D {
 namespace _internal {
@@ -208,6 +210,46 @@ protected:
 
     Array<Storage>      data;
 
+    /** A level of the mip pyramid below level 0, which is \a data */
+    class MipLevel {
+    public:
+        int             width;
+        int             height;
+        Array<Compute>  data;
+
+        MipLevel() : width(0), height(0) {}
+    };
+
+    /** Levels 1 and higher of the lazily built mip pyramid; m_mipLevel[i] is level i + 1. */
+    mutable Array<MipLevel> m_mipLevel;
+
+    /** Nonzero if m_mipLevel is up to date with data. Cleared by setChanged(true). */
+    mutable AtomicInt32     m_mipMapsValid;
+
+    /** Serializes construction of m_mipLevel by concurrent readers */
+    mutable Spinlock        m_mipLock;
+
+    /** Source texels and weights of the area (box) filter that reduces \a srcLength texels to 
+        \a dstLength = max(1, srcLength / 2) along one axis, for destination texel \a d.
+        Odd lengths take three texels, weighted by their overlap with the footprint of \a d,
+        so that the last texel of the row is not dropped and every level covers the same extent. */
+    static void mipFootprint(int srcLength, int dstLength, int d, int index[3], float weight[3]) {
+        index[0] = 2 * d;
+        index[1] = min(2 * d + 1, srcLength - 1);
+        index[2] = min(2 * d + 2, srcLength - 1);
+        if (srcLength == 1) {
+            weight[0] = 1.0f; weight[1] = 0.0f; weight[2] = 0.0f;
+        } else if ((srcLength & 1) == 0) {
+            weight[0] = 0.5f; weight[1] = 0.5f; weight[2] = 0.0f;
+        } else {
+            const float n = float(dstLength);
+            const float invSrcLength = 1.0f / float(srcLength);
+            weight[0] = (n - float(d)) * invSrcLength;
+            weight[1] = n * invSrcLength;
+            weight[2] = (float(d) + 1.0f) * invSrcLength;
+        }
+    }
+
     /** Handles the exceptional cases from get */
     const Storage& slowGet(int x, int y, WrapMode wrap) {
         switch (wrap) {
@@ -252,7 +294,7 @@ public:
 
 protected:
 
-    Map2D(int w, int h, WrapMode wrap, int d = 1) : w(0), h(0), d(1), m_wrapMode(wrap), m_changed(1) {
+    Map2D(int w, int h, WrapMode wrap, int d = 1) : w(0), h(0), d(1), m_wrapMode(wrap), m_changed(1), m_mipMapsValid(0) {
         ZERO = Storage(Compute(Storage()) * 0);
         resize(w, h, d);
     }
@@ -291,9 +333,12 @@ public:
         return m_changed.value() != 0;
     }
 
-    /** Set/unset the changed flag. */
+    /** Set/unset the changed flag. Setting it also invalidates the mip pyramid. */
     void setChanged(bool c) {
         m_changed = c ? 1 : 0;
+        if (c) {
+            m_mipMapsValid = 0;
+        }
     }
 
     /** Returns a pointer to the underlying row-major data. There is no padding at the end of the row.
@@ -613,6 +658,327 @@ public:
         return bicubic(p.x, p.y, m_wrapMode);
     }
 
+    /** Builds the box-filtered mip pyramid used by trilinear() and ewa() if it is out of date
+        (i.e., if setChanged(true) was invoked since it was last built). The filtered lookups call
+        this automatically; call it explicitly to move the cost out of the first lookup.
+
+        Mip levels are stored in the Compute type. Level L is max(1, width() >> L) x max(1, height() >> L).
+        Each texel is the average of the area of the level above that it covers, so odd sizes are
+        filtered with three taps per axis instead of two. Threadsafe with respect to other readers. */
+    void generateMipMaps() const {
+        if (m_mipMapsValid.value() != 0) {
+            return;
+        }
+
+        m_mipLock.lock();
+        if (m_mipMapsValid.value() == 0) {
+            int numLevels = 0;
+            for (uint32 lw = w, lh = h; (lw > 1) || (lh > 1); lw = max(1U, lw / 2), lh = max(1U, lh / 2)) {
+                ++numLevels;
+            }
+
+            m_mipLevel.resize(numLevels);
+            for (int L = 1; L <= numLevels; ++L) {
+                const int srcWidth  = mipWidth(L - 1);
+                const int srcHeight = mipHeight(L - 1);
+                MipLevel& dst = m_mipLevel[L - 1];
+                dst.width  = max(1, srcWidth / 2);
+                dst.height = max(1, srcHeight / 2);
+                dst.data.resize(dst.width * dst.height);
+
+                Thread::runConcurrently(0, dst.height, [&](int y) {
+                    int   iy[3], ix[3];
+                    float wy[3], wx[3];
+                    mipFootprint(srcHeight, dst.height, y, iy, wy);
+                    for (int x = 0; x < dst.width; ++x) {
+                        mipFootprint(srcWidth, dst.width, x, ix, wx);
+                        Compute sum = ZERO;
+                        for (int j = 0; j < 3; ++j) {
+                            for (int i = 0; i < 3; ++i) {
+                                const float weight = wx[i] * wy[j];
+                                if (weight > 0.0f) {
+                                    sum += mipTexel(L - 1, ix[i], iy[j], WrapMode::CLAMP) * weight;
+                                }
+                            }
+                        }
+                        dst.data[x + y * dst.width] = sum;
+                    }
+                });
+            }
+            m_mipMapsValid = 1;
+        }
+        m_mipLock.unlock();
+    }
+
+    /** Number of levels in the mip pyramid, including level 0 (this map itself). */
+    int numMipLevels() const {
+        generateMipMaps();
+        return m_mipLevel.size() + 1;
+    }
+
+    /** Width of mip \a level in pixels. Requires generateMipMaps() for level > 0. */
+    int mipWidth(int level) const {
+        return (level == 0) ? int(w) : m_mipLevel[level - 1].width;
+    }
+
+    /** Height of mip \a level in pixels. Requires generateMipMaps() for level > 0. */
+    int mipHeight(int level) const {
+        return (level == 0) ? int(h) : m_mipLevel[level - 1].height;
+    }
+
+    /** Value of pixel (x, y) of mip \a level. Requires generateMipMaps() for level > 0.
+
+        WrapMode::ERROR and WrapMode::IGNORE clamp here, because filter footprints
+        legitimately extend past the edges of the map. */
+    Compute mipTexel(int level, int x, int y, WrapMode wrap) const {
+        const int lw = mipWidth(level);
+        const int lh = mipHeight(level);
+        if (((uint32)x >= (uint32)lw) || ((uint32)y >= (uint32)lh)) {
+            switch (wrap) {
+            case WrapMode::TILE:
+                x = iWrap(x, lw);
+                y = iWrap(y, lh);
+                break;
+
+            case WrapMode::ZERO:
+                return Compute(ZERO);
+
+            default:
+                x = iClamp(x, 0, lw - 1);
+                y = iClamp(y, 0, lh - 1);
+            }
+        }
+
+        return (level == 0) ? Compute(data[x + y * w]) : m_mipLevel[level - 1].data[x + y * lw];
+    }
+
+    /** Bilinear interpolation within mip \a level. (x, y) is in level-0 pixel
+        coordinates, so the same point can be looked up at any level. 
+        Requires generateMipMaps() for level > 0. */
+    Compute mipBilinear(int level, float x, float y, WrapMode wrap) const {
+        if (level > 0) {
+            // Pixel centers are at integers at every level
+            x = (x + 0.5f) * (float(mipWidth(level)) / float(w)) - 0.5f;
+            y = (y + 0.5f) * (float(mipHeight(level)) / float(h)) - 0.5f;
+        }
+        const int i = iFloor(x);
+        const int j = iFloor(y);
+        const float fX = x - i;
+        const float fY = y - j;
+
+        return lerp(lerp(mipTexel(level, i, j, wrap),     mipTexel(level, i + 1, j, wrap),     fX),
+                    lerp(mipTexel(level, i, j + 1, wrap), mipTexel(level, i + 1, j + 1, wrap), fX), fY);
+    }
+
+    /** Mip-mapped lookup: bilinear interpolation within the two mip levels nearest to
+        \a lod, blended linearly. \a lod is log2 of the width of the filter footprint in
+        pixels; lod = 0 matches bilinear() except for the wrap behavior at the edges
+        (see mipTexel()). Builds the mip pyramid on first use. */
+    Compute trilinear(float x, float y, float lod, WrapMode wrap) const {
+        generateMipMaps();
+        const int maxLevel = m_mipLevel.size();
+        lod = clamp(lod, 0.0f, float(maxLevel));
+        const int L = min(iFloor(lod), maxLevel);
+        const float t = lod - float(L);
+
+        const Compute& a = mipBilinear(L, x, y, wrap);
+        if ((t <= 0.0f) || (L == maxLevel)) {
+            return a;
+        } else {
+            return lerp(a, mipBilinear(L + 1, x, y, wrap), t);
+        }
+    }
+
+    Compute trilinear(const Vector2& p, float lod) const {
+        return trilinear(p.x, p.y, lod, m_wrapMode);
+    }
+
+    /** Trilinear lookup with the level of detail chosen from the screen-space 
+        derivatives of the sample position (e.g., from ray differentials),
+        \a dpdx and \a dpdy, in pixels. The filter is isotropic, so it
+        blurs along the minor axis of anisotropic footprints. \sa ewa */
+    Compute trilinear(const Vector2& p, const Vector2& dpdx, const Vector2& dpdy, WrapMode wrap) const {
+        const float width = max(dpdx.length(), dpdy.length());
+        return trilinear(p.x, p.y, (width > 0.0f) ? log2(width) : 0.0f, wrap);
+    }
+
+    Compute trilinear(const Vector2& p, const Vector2& dpdx, const Vector2& dpdy) const {
+        return trilinear(p, dpdx, dpdy, m_wrapMode);
+    }
+
+    /** Batched trilinear(x, y, lod, wrap) for \a n samples, where the results are written 
+        to \a result. Lanes are processed in groups of four, with the level selection, 
+        per-level coordinate scaling, and filter weights computed in SSE registers. */
+    void trilinear(const Vector2* p, const float* lod, Compute* result, int n, WrapMode wrap) const {
+        generateMipMaps();
+        const int maxLevel = m_mipLevel.size();
+
+        // Per-level scale factors from level-0 to level-L pixel coordinates
+        float scaleX[32], scaleY[32];
+        for (int L = 0; L <= maxLevel; ++L) {
+            scaleX[L] = float(mipWidth(L)) / float(w);
+            scaleY[L] = float(mipHeight(L)) / float(h);
+        }
+
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 one  = _mm_set1_ps(1.0f);
+        for (int i = 0; i < n; i += 4) {
+            const int k = min(4, n - i);
+
+            // Pad short groups by repeating the last lane
+            float px[4], py[4], pl[4];
+            for (int j = 0; j < 4; ++j) {
+                const int s = i + min(j, k - 1);
+                px[j] = p[s].x;
+                py[j] = p[s].y;
+                pl[j] = lod[s];
+            }
+
+            const __m128 L = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pl), _mm_setzero_ps()), _mm_set1_ps(float(maxLevel)));
+            // L >= 0, so truncation is floor
+            const __m128i level = _mm_cvttps_epi32(L);
+            int   L0[4];
+            float t[4];
+            _mm_storeu_si128((__m128i*)L0, level);
+            _mm_storeu_ps(t, _mm_sub_ps(L, _mm_cvtepi32_ps(level)));
+
+            int   ix[2][4], iy[2][4];
+            float fx[2][4], fy[2][4];
+            for (int side = 0; side < 2; ++side) {
+                int Ls[4];
+                for (int j = 0; j < 4; ++j) {
+                    Ls[j] = min(L0[j] + side, maxLevel);
+                }
+                const __m128 x  = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(px), half), _mm_setr_ps(scaleX[Ls[0]], scaleX[Ls[1]], scaleX[Ls[2]], scaleX[Ls[3]])), half);
+                const __m128 y  = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(py), half), _mm_setr_ps(scaleY[Ls[0]], scaleY[Ls[1]], scaleY[Ls[2]], scaleY[Ls[3]])), half);
+
+                // floor() from truncation, correcting negative non-integers
+                __m128 xf = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+                __m128 yf = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+                xf = _mm_sub_ps(xf, _mm_and_ps(_mm_cmpgt_ps(xf, x), one));
+                yf = _mm_sub_ps(yf, _mm_and_ps(_mm_cmpgt_ps(yf, y), one));
+
+                _mm_storeu_si128((__m128i*)ix[side], _mm_cvttps_epi32(xf));
+                _mm_storeu_si128((__m128i*)iy[side], _mm_cvttps_epi32(yf));
+                _mm_storeu_ps(fx[side], _mm_sub_ps(x, xf));
+                _mm_storeu_ps(fy[side], _mm_sub_ps(y, yf));
+            }
+
+            for (int j = 0; j < k; ++j) {
+                Compute c[2];
+                for (int side = 0; side < ((t[j] > 0.0f) ? 2 : 1); ++side) {
+                    const int Ls = min(L0[j] + side, maxLevel);
+                    const int a = ix[side][j], b = iy[side][j];
+                    c[side] = lerp(lerp(mipTexel(Ls, a, b, wrap),     mipTexel(Ls, a + 1, b, wrap),     fx[side][j]),
+                                   lerp(mipTexel(Ls, a, b + 1, wrap), mipTexel(Ls, a + 1, b + 1, wrap), fx[side][j]), fy[side][j]);
+                }
+                result[i + j] = (t[j] > 0.0f) ? lerp(c[0], c[1], t[j]) : c[0];
+            }
+        }
+    }
+
+    /** Anisotropic lookup with an elliptical weighted average (EWA) filter over the 
+        footprint spanned by the screen-space derivatives \a dpdx and \a dpdy (in pixels), 
+        e.g., from ray differentials. The minor axis selects the mip level, and the
+        footprint is widened as needed so that its eccentricity is at most \a maxAnisotropy,
+        bounding the cost of a lookup.
+
+        \cite Heckbert, Fundamentals of Texture Mapping and Image Warping, 1989
+        \cite Pharr, Jakob, and Humphreys, Physically Based Rendering, 3rd edition, section 10.4.5 */
+    Compute ewa(const Vector2& p, Vector2 dpdx, Vector2 dpdy, WrapMode wrap, float maxAnisotropy = 16.0f) const {
+        generateMipMaps();
+
+        if (dpdx.squaredLength() < dpdy.squaredLength()) {
+            std::swap(dpdx, dpdy);
+        }
+        const float majorLength = dpdx.length();
+        float minorLength = dpdy.length();
+
+        // Clamp the eccentricity by widening the minor axis
+        if ((minorLength * maxAnisotropy < majorLength) && (minorLength > 0.0f)) {
+            const float scale = majorLength / (minorLength * maxAnisotropy);
+            dpdy *= scale;
+            minorLength *= scale;
+        }
+
+        if (minorLength == 0.0f) {
+            // Degenerate footprint
+            return trilinear(p, dpdx, dpdy, wrap);
+        }
+
+        const int maxLevel = m_mipLevel.size();
+        const float lod = clamp(log2(minorLength), 0.0f, float(maxLevel));
+        const int L = min(iFloor(lod), maxLevel);
+        const float t = lod - float(L);
+
+        const Compute& a = ewaLevel(L, p, dpdx, dpdy, wrap);
+        if ((t <= 0.0f) || (L == maxLevel)) {
+            return a;
+        } else {
+            return lerp(a, ewaLevel(L + 1, p, dpdx, dpdy, wrap), t);
+        }
+    }
+
+    Compute ewa(const Vector2& p, const Vector2& dpdx, const Vector2& dpdy) const {
+        return ewa(p, dpdx, dpdy, m_wrapMode);
+    }
+
+protected:
+
+    /** EWA filter within one mip level. All arguments are in level-0 pixels. 
+        Requires generateMipMaps(). */
+    Compute ewaLevel(int level, const Vector2& p, const Vector2& dpdx, const Vector2& dpdy, WrapMode wrap) const {
+        const float sx = float(mipWidth(level)) / float(w);
+        const float sy = float(mipHeight(level)) / float(h);
+        const float s  = (p.x + 0.5f) * sx - 0.5f;
+        const float t  = (p.y + 0.5f) * sy - 0.5f;
+        const Vector2 d0(dpdx.x * sx, dpdx.y * sy);
+        const Vector2 d1(dpdy.x * sx, dpdy.y * sy);
+
+        // Implicit ellipse A s^2 + B s t + C t^2 < 1, padded by one
+        // texel to avoid missing all texels for tiny footprints
+        float A = square(d0.y) + square(d1.y) + 1.0f;
+        float B = -2.0f * (d0.x * d0.y + d1.x * d1.y);
+        float C = square(d0.x) + square(d1.x) + 1.0f;
+        const float invF = 1.0f / (A * C - square(B) * 0.25f);
+        A *= invF;
+        B *= invF;
+        C *= invF;
+
+        // Bounding box of the ellipse
+        const float det    = -square(B) + 4.0f * A * C;
+        const float invDet = 1.0f / det;
+        const float uSqrt  = sqrt(det * C);
+        const float vSqrt  = sqrt(A * det);
+        const int s0 = iCeil(s - 2.0f * invDet * uSqrt);
+        const int s1 = iFloor(s + 2.0f * invDet * uSqrt);
+        const int t0 = iCeil(t - 2.0f * invDet * vSqrt);
+        const int t1 = iFloor(t + 2.0f * invDet * vSqrt);
+
+        // Truncated Gaussian weights
+        const float alpha = 2.0f;
+        const float expAlpha = std::exp(-alpha);
+
+        Compute sum = Compute(ZERO);
+        float sumWeight = 0.0f;
+        for (int it = t0; it <= t1; ++it) {
+            const float tt = float(it) - t;
+            for (int is = s0; is <= s1; ++is) {
+                const float ss = float(is) - s;
+                const float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+                if (r2 < 1.0f) {
+                    const float weight = std::exp(-alpha * r2) - expAlpha;
+                    sum += mipTexel(level, is, it, wrap) * weight;
+                    sumWeight += weight;
+                }
+            }
+        }
+
+        return (sumWeight > 0.0f) ? sum * (1.0f / sumWeight) : mipBilinear(level, p.x, p.y, wrap);
+    }
+
+public:
+
     /** Pixel width */
     inline int32 width() const {
         return (int32)w;
@@ -245,6 +245,9 @@ public:
      (i.e. if the edge has only one adjacent face) it will appear in the 
      array with one  face index set to MeshAlg::Face::NONE.
 
+     Runs in parallel. The half-edges are bucketed by their lower vertex with
+     computeVertexCorners, so the output does not depend on the number of threads.
+
      @param vertexGeometry  %Vertex positions to use when deciding colocation.
      @param indexArray      Order to traverse vertices to make triangles
      @param faceArray       <I>Output</I>
@@ -307,6 +310,26 @@ private:
 
 public:
 
+    /**
+     Builds the inverse of a triangle list index array: for every vertex, the triangle corners that
+     reference it, in compressed sparse row form. A corner is 3 * triangle + j for j in 0..2, so
+     corner c refers to vertex indexArray[c]. The corners of vertex v are
+     <code>corner[cornerOffset[v]]</code> through <code>corner[cornerOffset[v + 1] - 1]</code>,
+     in increasing order.
+
+     Runs in parallel by counting sort. Functions that accumulate a value per triangle into its
+     vertices use this to compute each vertex's sum independently, in the same order as a serial
+     loop over the triangles, so the results are identical to the serial computation.
+
+     \param cornerOffset Output. numVertices + 1 elements
+     \param corner Output. indexArray.size() elements
+     */
+    static void computeVertexCorners(
+        const Array<int>&           indexArray,
+        int                         numVertices,
+        Array<int>&                 cornerOffset,
+        Array<int>&                 corner);
+
     /**
      Computes tangent and binormal vectors,
      which provide a (mostly) consistent
@@ -490,6 +513,53 @@ public:
     static int countBoundaryEdges(const Array<Edge>& edgeArray);
 
 
+    /**
+     Reorders the triangles of a triangle list so that consecutive triangles reuse
+     vertices while they are still in the GPU's post-transform vertex cache. The
+     vertices of each triangle keep their winding. Runs in time linear in the number of
+     triangles.
+
+     @cite T. Forsyth, Linear-Speed Vertex Cache Optimisation, 2006.
+
+     @param numVertices One more than the largest index in \a indexArray
+     \sa simulateVertexCache, computeVertexFetchRemap
+     */
+    static void optimizeVertexCache(
+        Array<int>&         indexArray,
+        int                 numVertices);
+
+    /**
+     Computes a renumbering of the vertices in the order in which the triangles of
+     \a indexArray first use them, so that vertex fetches for a cache-optimized index
+     array walk memory nearly sequentially. Unused vertices follow in their original
+     order, so the result is always a permutation.
+
+     Call once with the concatenation of all index arrays that share the vertices, then
+     apply with <code>newIndex = remap[oldIndex]</code>.
+
+     @param remap <I>Output</I> remap[oldIndex] is the new index of each vertex
+     */
+    static void computeVertexFetchRemap(
+        const Array<int>&   indexArray,
+        int                 numVertices,
+        Array<int>&         remap);
+
+    /**
+     Simulates a FIFO post-transform vertex cache of \a cacheSize entries while drawing
+     the triangle list \a indexArray.
+
+     @param acmr <I>Output</I> Average cache miss ratio: vertex shader invocations per
+     triangle. 3 is the worst case, about 0.5 is ideal for large regular meshes.
+     @param atvr <I>Output</I> Average transform to vertex ratio: vertex shader
+     invocations per unique vertex. 1 is ideal.
+     */
+    static void simulateVertexCache(
+        const Array<int>&   indexArray,
+        float&              acmr,
+        float&              atvr,
+        int                 cacheSize = 16);
+
+
     /**
      Generates an array of integers from start to start + n - 1 that have run numbers
      in series then omit the next skip before the next run.  Useful for turning
@@ -4,7 +4,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
  \created 2011-07-23
- \edited  2011-07-23
+ \edited  2026-10-18
 
  Copyright 2002-2011, Morgan McGuire.
  All rights reserved.
@@ -109,13 +109,32 @@ public:
 
 private:
 
+    /** Bytes of input decoded per batch by the bulk decoders. Large enough to amortize
+        thread launch, small enough to stay resident for huge files. */
+    static const int64 BULK_CHUNK_BYTES = 64 * 1024 * 1024;
+
     static void parseProperty(const String& s, Property& prop);
     static float readAsFloat(const Property& prop, BinaryInput& bi);
 
+    /** If none of \a prop are lists, then every record has the same size. Computes the
+        byte offset of each property within a record and the record stride and returns true.
+        Otherwise returns false. */
+    static bool computeFixedLayout(const Array<Property>& prop, Array<int>& offset, int& stride);
+
     void readHeader(BinaryInput& bi);
     void readVertexList(BinaryInput& bi);
+
+    /** Decodes fixed-stride vertex records in parallel batches directly from the BinaryInput buffer */
+    void readVertexListFixed(BinaryInput& bi, const Array<int>& offset, int stride);
+
     void readFaceList(BinaryInput& bi);
 
+    /** Decodes face or tristrip records whose only variable-length property is the index list.
+        Each batch is scanned once to find record offsets and then decoded in parallel.
+        \param before Bytes of fixed-size properties preceding the index list
+        \param after Bytes of fixed-size properties following the index list */
+    void readFaceListFixed(BinaryInput& bi, const Property& indexProp, int before, int after);
+
 public:
     
     ParsePLY();
@@ -0,0 +1,139 @@
+/**
+  \file G3D/PhysicsFrameSplineBatch.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#ifndef G3D_PhysicsFrameSplineBatch_h
+#define G3D_PhysicsFrameSplineBatch_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/PhysicsFrameSpline.h"
+
+namespace G3D {
+
+/**
+ \brief Evaluates many PhysicsFrameSplines at once, for scenes with thousands of animated entities.
+
+ Each spline is compiled when it is added: the four control points around every interval are
+ combined with the Catmull-Rom basis into the coefficients of a cubic polynomial in the fraction
+ of the interval that has elapsed. Evaluation then only finds the interval and evaluates the
+ translation and rotation polynomials by Horner's rule in SSE lanes, instead of gathering control
+ points, computing tangents, and multiplying by the basis on every call as Spline::evaluate does.
+
+ Each spline remembers the interval that it last used, so finding the interval takes constant
+ time when time increases smoothly between calls. Large batches are evaluated in parallel.
+
+ The results match PhysicsFrameSpline::evaluate to within floating-point rounding. Non-cyclic
+ splines evaluated before their first or after their last control point are delegated to
+ PhysicsFrameSpline::evaluate.
+
+ The evaluate() methods are const but update the per-spline interval cache, so a single batch
+ must not be evaluated from multiple threads at once.
+
+ <pre>
+   PhysicsFrameSplineBatch batch;
+   for (...) { batch.append(spline); }
+   ...
+   Array<PhysicsFrame> frame;
+   batch.evaluate(float(time), frame);
+ </pre>
+
+ \sa Entity::SplineTrack, Scene::onSimulation
+*/
+class PhysicsFrameSplineBatch {
+protected:
+
+    /** Cubic polynomial for the interval between two control points */
+    class Segment {
+    public:
+        /** Time at which u = 0 */
+        float                   start;
+
+        /** 1 / duration of the segment, so that u = (time - start) * invLength */
+        float                   invLength;
+
+        /** coefficient[k] multiplies u^(3 - k). Elements 0-2 are the translation,
+            3 is unused, and 4-7 are the rotation in Quat x, y, z, w order. */
+        float                   coefficient[4][8];
+    };
+
+    class Track {
+    public:
+        /** Index of the first element in m_segment */
+        int                     firstSegment;
+
+        int                     numSegments;
+
+        /** Index of the first element in m_segmentTime, which has numSegments + 1 entries
+            for this track */
+        int                     firstTime;
+
+        /** Period of a cyclic spline. Zero for splines that do not wrap. */
+        float                   duration;
+
+        /** Used for non-cyclic splines evaluated outside of their control points */
+        PhysicsFrameSpline      spline;
+
+        /** Segment index relative to firstSegment that was used most recently */
+        mutable int             lastSegment;
+    };
+
+    Array<Track>                m_track;
+
+    Array<Segment>              m_segment;
+
+    /** Start time of each segment, followed by the end time of the last segment of each track */
+    Array<float>                m_segmentTime;
+
+    /** Number of segments in m_segment that belong to no track because set() replaced them */
+    int                         m_numUnusedSegments;
+
+    /** Appends the compiled form of \a spline to m_segment and m_segmentTime */
+    void compile(const PhysicsFrameSpline& spline, Track& track);
+
+    /** Rebuilds m_segment and m_segmentTime when set() has left too many unused segments */
+    void compact();
+
+    /** Returns the index relative to track.firstSegment of the segment containing \a s,
+        which must already be wrapped into the period of a cyclic spline */
+    int findSegment(const Track& track, float s) const;
+
+public:
+
+    PhysicsFrameSplineBatch() : m_numUnusedSegments(0) {}
+
+    /** Number of splines */
+    int size() const {
+        return m_track.size();
+    }
+
+    void clear();
+
+    /** Adds a spline and returns its index */
+    int append(const PhysicsFrameSpline& spline);
+
+    /** Replaces the spline at \a index */
+    void set(int index, const PhysicsFrameSpline& spline);
+
+    /** Evaluates spline \a index at time \a s */
+    PhysicsFrame evaluate(int index, float s) const;
+
+    /** Evaluates every spline at time \a s. \a result is resized to size(). */
+    void evaluate(float s, Array<PhysicsFrame>& result) const;
+
+    /** Evaluates spline \a i at time \a s[i]. \a s must have size() elements.
+        \a result is resized to size(). */
+    void evaluate(const Array<float>& s, Array<PhysicsFrame>& result) const;
+};
+
+} // namespace G3D
+
+#endif
@@ -215,7 +215,7 @@ public:
                 // Wrapped around bottom
 
                 // Number of times we wrapped around the cyclic array
-                int wraps = (N + 1 - i) / N;                    
+                int wraps = (N - 1 - i) / N;
                 int j = (i + wraps * N) % N;
                 t = time[j] - wraps * duration();
 
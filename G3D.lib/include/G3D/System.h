@@ -100,6 +100,7 @@ private:
     bool           m_hasSSE;
     bool           m_hasSSE2;
     bool           m_hasSSE3;
+    bool           m_hasAVX;
     bool           m_has3DNOW;
     bool           m_has3DNOW2;
     bool           m_hasAMDMMX;
@@ -212,6 +213,13 @@ public:
         return instance().m_hasSSE3;
     }
 
+    /** True if both the processor and the operating system support AVX instructions.
+        Functions that use AVX intrinsics must be declared with G3D_TARGET_AVX and
+        only called when this is true. */
+    inline static bool hasAVX() {
+        return instance().m_hasAVX;
+    }
+
     inline static bool hasMMX() {
         return instance().m_hasMMX;
     }
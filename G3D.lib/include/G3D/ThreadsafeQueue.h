@@ -17,7 +17,7 @@
 namespace G3D {
 
 /** A queue whose methods are synchronized with respect to each other.
-    \sa Queue, GMutex, Spinlock */
+    \sa Queue, GMutex, Spinlock, BoundedThreadsafeQueue */
 template<class T>
 class ThreadsafeQueue {
 private:
@@ -0,0 +1,162 @@
+/**
+  \file G3D/ZipfileCache.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+ */
+#ifndef G3D_ZipfileCache_h
+#define G3D_ZipfileCache_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/Table.h"
+#include "G3D/ReferenceCount.h"
+#include "G3D/GMutex.h"
+#include "G3D/G3DString.h"
+
+struct zip;
+
+namespace G3D {
+
+/**
+  \brief Process-wide cache of open zipfiles and their parsed central directories.
+
+  Opening a zipfile with libzip reads and validates the entire central directory,
+  which is expensive for archives (e.g., .pk3 files) containing thousands of entries.
+  FileSystem, BinaryInput, and readWholeFile share the Archive objects from this cache
+  instead of calling zip_open for every access.
+
+  Archives are keyed by their resolved path and revalidated against the file's
+  modification time and size on every lookup, so a zipfile that is rewritten on disk is
+  transparently reopened.  FileSystem::clearCache also flushes matching entries.
+
+  All methods are threadsafe. Multiple threads may read different (or the same) entries
+  of one Archive simultaneously; each concurrent reader is given its own libzip handle
+  from a small pool owned by the Archive.
+
+  \sa FileSystem, BinaryInput
+*/
+class ZipfileCache {
+public:
+
+    /** An entry in the central directory of a zipfile */
+    class Entry {
+    public:
+        /** Full name inside the zipfile, with Unix-style slashes */
+        String          name;
+
+        /** Uncompressed size in bytes */
+        int64           size;
+
+        Entry() : size(0) {}
+    };
+
+    /** An open zipfile.  Immutable except for its internal handle pool. */
+    class Archive : public ReferenceCountedObject {
+    private:
+        friend class ZipfileCache;
+
+        String                  m_filename;
+
+        /** Modification time of the file when it was opened */
+        int64                   m_modificationTime;
+
+        /** Size of the file on disk when it was opened */
+        int64                   m_fileSize;
+
+        /** In libzip index order */
+        Array<Entry>            m_entry;
+
+        /** Maps lower-case entry names to indices in m_entry, since
+            all G3D zipfile lookups are case insensitive. */
+        Table<String, int>      m_index;
+
+        /** Protects m_freeHandle */
+        mutable Spinlock        m_handleLock;
+
+        /** libzip handles that are not currently being read from */
+        mutable Array<struct zip*> m_freeHandle;
+
+        /** Returns a handle that is exclusively owned by the caller until releaseHandle().
+            Returns nullptr if the zipfile could not be reopened. */
+        struct zip* acquireHandle() const;
+
+        void releaseHandle(struct zip* z) const;
+
+    protected:
+
+        Archive(const String& filename, int64 modificationTime, int64 fileSize);
+
+    public:
+
+        ~Archive();
+
+        /** Returns nullptr if \a filename could not be opened as a zipfile */
+        static shared_ptr<Archive> create(const String& filename, int64 modificationTime, int64 fileSize);
+
+        const String& filename() const {
+            return m_filename;
+        }
+
+        int numEntries() const {
+            return m_entry.size();
+        }
+
+        const Entry& entry(int i) const {
+            return m_entry[i];
+        }
+
+        const Array<Entry>& entryArray() const {
+            return m_entry;
+        }
+
+        /** Returns the index of the entry named \a name (case insensitive, either slash direction),
+            or -1 if there is no such entry. */
+        int find(const String& name) const;
+
+        bool contains(const String& name) const {
+            return find(name) != -1;
+        }
+
+        /** Uncompressed size of \a name in bytes, or -1 if it does not exist */
+        int64 size(const String& name) const {
+            const int i = find(name);
+            return (i == -1) ? -1 : m_entry[i].size;
+        }
+
+        /** Decompresses entry \a i into \a buffer, which must be at least entry(i).size bytes.
+            Returns false if the entry could not be decompressed. Threadsafe. */
+        bool read(int i, void* buffer) const;
+    };
+
+private:
+
+    static GMutex                                   s_mutex;
+
+    /** Maps resolved zipfile paths (lower case on Windows) to archives */
+    static Table<String, shared_ptr<Archive>>&      table();
+
+    /** Resolved, canonical cache key for \a path */
+    static String key(const String& path);
+
+public:
+
+    /** Returns the cached archive for \a zipfile, opening it if it is not already open or has
+        changed on disk since it was opened.  Returns nullptr if \a zipfile does not exist or is
+        not a valid zipfile. */
+    static shared_ptr<Archive> archive(const String& zipfile);
+
+    /** Closes all cached archives at or below \a path ("" means all archives).
+        Archives currently being read remain valid until their last reference is dropped.
+        Called by FileSystem::clearCache. */
+    static void clear(const String& path = "");
+};
+
+} // namespace G3D
+
+#endif
@@ -182,6 +182,11 @@ These control the version of Winsock used by G3D.
     Enables printf parameter validation on gcc. */
 #   define G3D_CHECK_VPRINTF_METHOD_ARGS
 
+/** @def G3D_TARGET_AVX
+    Allows AVX intrinsics in the function that it prefixes. Only call such
+    functions when System::hasAVX() is true. MSVC always accepts AVX intrinsics. */
+#   define G3D_TARGET_AVX
+
     // On MSVC, we need to link against the multithreaded DLL version of
     // the C++ runtime because that is what SDL and ZLIB are compiled
     // against.  This is not the default for MSVC, so we set the following
@@ -301,6 +306,11 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrev, LPSTR szCmdLine, int sw) {\
 /** @def G3D_CHECK_PRINTF_METHOD_ARGS()
     Enables printf parameter validation on gcc. */
 #   define G3D_CHECK_VPRINTF_ARGS         __attribute__((__format__(__printf__, 1, 0)))
+
+/** @def G3D_TARGET_AVX
+    Allows AVX intrinsics in the function that it prefixes. Only call such
+    functions when System::hasAVX() is true. */
+#   define G3D_TARGET_AVX                 __attribute__((__target__("avx")))
 #endif
 
 
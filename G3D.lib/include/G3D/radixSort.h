@@ -0,0 +1,96 @@
+/**
+  \file G3D/radixSort.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+ */
+
+#ifndef G3D_radixSort_h
+#define G3D_radixSort_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/g3dmath.h"
+#include "G3D/System.h"
+#include "G3D/Thread.h"
+
+namespace G3D {
+
+/**
+ Stable, parallel least-significant-digit radix sort of the \a n elements of \a src
+ by their unsigned integer \a key members, which must be less than 2^numKeyBits.
+
+ Each pass sorts by the next eight bits of the key and scatters from one array to
+ the other, so the result is in either \a src or \a scratch, which must also hold
+ \a n elements; the returned pointer is the one that holds it. Passes in which every
+ key has the same digit are skipped. Blocks of \a elementsPerTask elements are counted
+ and scattered in parallel.
+
+ Reentrant: the digit histograms are local to each call.
+
+ \code
+ struct Proxy { uint32 key; int index; };
+ const Proxy* sorted = radixSortByKey(proxyArray.getCArray(), scratchArray.getCArray(), n, 24);
+ \endcode
+ */
+template<class T>
+T* radixSortByKey(T* src, T* scratch, int n, int numKeyBits, int elementsPerTask = 16 * 1024) {
+    static const int RADIX_BITS = 8;
+    static const int RADIX      = 1 << RADIX_BITS;
+
+    const int numTasks = max(1, (n + elementsPerTask - 1) / elementsPerTask);
+
+    // Digit counts per task, and then each task's first output position per digit
+    Array<int> histogram;
+    histogram.resize(numTasks * RADIX, false);
+
+    for (int shift = 0; shift < numKeyBits; shift += RADIX_BITS) {
+        Thread::runConcurrently(0, numTasks, [&](int t) {
+            int* h = histogram.getCArray() + t * RADIX;
+            System::memset(h, 0, sizeof(int) * RADIX);
+            const int end = min(n, (t + 1) * elementsPerTask);
+            for (int i = t * elementsPerTask; i < end; ++i) {
+                ++h[(src[i].key >> shift) & (RADIX - 1)];
+            }
+        });
+
+        // Exclusive prefix sum in digit-major order, so that each task writes its
+        // elements after those with smaller digits and after those of earlier tasks
+        int offset = 0;
+        bool allKeysShareDigit = false;
+        for (int d = 0; d < RADIX; ++d) {
+            const int digitStart = offset;
+            for (int t = 0; t < numTasks; ++t) {
+                int& h = histogram[t * RADIX + d];
+                const int count = h;
+                h = offset;
+                offset += count;
+            }
+            allKeysShareDigit = allKeysShareDigit || (offset - digitStart == n);
+        }
+
+        if (allKeysShareDigit) {
+            // This pass would not change the order
+            continue;
+        }
+
+        T* dst = scratch;
+        Thread::runConcurrently(0, numTasks, [&](int t) {
+            int* h = histogram.getCArray() + t * RADIX;
+            const int end = min(n, (t + 1) * elementsPerTask);
+            for (int i = t * elementsPerTask; i < end; ++i) {
+                dst[h[(src[i].key >> shift) & (RADIX - 1)]++] = src[i];
+            }
+        });
+
+        std::swap(src, scratch);
+    }
+
+    return src;
+}
+
+} // namespace G3D
+
+#endif
@@ -31,7 +31,7 @@ const char* Any::PAREN   = "()";
 const char* Any::BRACKET = "[]";
 const char* Any::BRACE   = "{}";
 
-static bool isContainerType(Any::Type& t) {
+static bool isContainerType(const Any::Type& t) {
     return (t == Any::ARRAY) || (t == Any::TABLE) || (t == Any::EMPTY_CONTAINER);
 }
 
@@ -43,10 +43,267 @@ void Any::serialize(BinaryOutput& b) const {
 }
 
 
+void Any::serializeCompact(BinaryOutput& b) const {
+    beforeRead();
+    b.writeInt32(2);
+    Table<String, int> stringIndex;
+    serializeCompactValue(b, stringIndex);
+}
+
+
 void Any::deserialize(BinaryInput& b) {
+    beforeRead();
     const int version = b.readInt32();
-    alwaysAssertM(version == 1, "Wrong Any serialization version");
-    _parse(b.readString32());
+    if (version == 1) {
+        _parse(b.readString32());
+    } else {
+        alwaysAssertM(version == 2, "Wrong Any serialization version");
+        Array<String> stringTable;
+        deserializeCompactValue(b, stringTable);
+    }
+}
+
+
+/** Flags in the first byte of each value written by serializeCompactValue. The low three bits are the Type. */
+enum {
+    COMPACT_TYPE_MASK    = 0x07,
+    COMPACT_HAS_DATA     = 0x08,
+    COMPACT_HAS_COMMENT  = 0x10,
+    COMPACT_HAS_NAME     = 0x20,
+    COMPACT_HAS_INCLUDE  = 0x40,
+    COMPACT_HEX_INTEGER  = 0x80
+};
+
+/** How serializeCompactValue stores a NUMBER */
+enum {COMPACT_INT, COMPACT_FLOAT32, COMPACT_FLOAT64};
+
+static void writeCount(BinaryOutput& b, uint64 n) {
+    while (n >= 0x80) {
+        b.writeUInt8(uint8(n | 0x80));
+        n >>= 7;
+    }
+    b.writeUInt8(uint8(n));
+}
+
+
+static uint64 readCount(BinaryInput& b) {
+    uint64 n = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const uint8 c = b.readUInt8();
+        n |= uint64(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return n;
+        }
+    }
+    throw "Corrupt binary Any";
+}
+
+
+static void writeSharedString(BinaryOutput& b, const String& s, Table<String, int>& stringIndex) {
+    const int* index = stringIndex.getPointer(s);
+    if (notNull(index)) {
+        writeCount(b, *index + 1);
+    } else {
+        // Zero introduces a new string
+        writeCount(b, 0);
+        writeCount(b, s.size());
+        b.writeBytes(s.c_str(), s.size());
+        stringIndex.set(s, stringIndex.size());
+    }
+}
+
+
+static String readSharedString(BinaryInput& b, Array<String>& stringTable) {
+    const uint64 index = readCount(b);
+    if (index == 0) {
+        const uint64 length = readCount(b);
+        if (length > uint64(b.getLength() - b.getPosition())) {
+            throw "Corrupt binary Any";
+        }
+        stringTable.append(String((const char*)b.peekBytes(length), size_t(length)));
+        b.skip(length);
+        return stringTable.last();
+    } else if (index <= uint64(stringTable.size())) {
+        return stringTable[int(index - 1)];
+    } else {
+        throw "Corrupt binary Any";
+    }
+}
+
+
+void Any::serializeCompactValue(BinaryOutput& b, Table<String, int>& stringIndex) const {
+    uint8 flags = uint8(m_type);
+    if (notNull(m_data)) {
+        flags |= COMPACT_HAS_DATA;
+        if (! m_data->comment.empty())     { flags |= COMPACT_HAS_COMMENT; }
+        if (! m_data->name.empty())        { flags |= COMPACT_HAS_NAME; }
+        if (! m_data->includeLine.empty()) { flags |= COMPACT_HAS_INCLUDE; }
+        if (m_data->hexInteger)            { flags |= COMPACT_HEX_INTEGER; }
+    }
+    b.writeUInt8(flags);
+
+    if (notNull(m_data)) {
+        writeSharedString(b, m_data->source.filename, stringIndex);
+        writeCount(b, uint32(m_data->source.line));
+        writeCount(b, uint32(m_data->source.character));
+
+        if (isContainerType(m_type)) {
+            const int bracket = (m_data->bracket == PAREN) ? 0 : (m_data->bracket == BRACKET) ? 1 : 2;
+            b.writeUInt8(uint8(bracket | ((m_data->separator == ';') ? 4 : 0)));
+        }
+
+        if (flags & COMPACT_HAS_COMMENT) { writeSharedString(b, m_data->comment, stringIndex); }
+        if (flags & COMPACT_HAS_NAME)    { writeSharedString(b, m_data->name, stringIndex); }
+        if (flags & COMPACT_HAS_INCLUDE) { writeSharedString(b, m_data->includeLine, stringIndex); }
+    }
+
+    switch (m_type) {
+    case NIL:
+    case EMPTY_CONTAINER:
+        break;
+
+    case BOOLEAN:
+        b.writeUInt8(m_simpleValue.b ? 1 : 0);
+        break;
+
+    case NUMBER:
+        {
+            const double n = m_simpleValue.n;
+            if ((n == floor(n)) && (abs(n) < 2147483648.0) && ! ((n == 0.0) && (1.0 / n < 0.0))) {
+                // Integers other than -0. Zig-zag encode so that small negative integers are also short
+                const int32 i = int32(n);
+                b.writeUInt8(COMPACT_INT);
+                writeCount(b, (uint32(i) << 1) ^ uint32(i >> 31));
+            } else if (double(float(n)) == n) {
+                b.writeUInt8(COMPACT_FLOAT32);
+                b.writeFloat32(float(n));
+            } else {
+                b.writeUInt8(COMPACT_FLOAT64);
+                b.writeFloat64(n);
+            }
+        }
+        break;
+
+    case STRING:
+        writeSharedString(b, *(m_data->value.s), stringIndex);
+        break;
+
+    case ARRAY:
+        {
+            const AnyArray& array = *(m_data->value.a);
+            writeCount(b, array.size());
+            for (int i = 0; i < array.size(); ++i) {
+                array[i].serializeCompactValue(b, stringIndex);
+            }
+        }
+        break;
+
+    case TABLE:
+        {
+            const AnyTable& table = *(m_data->value.t);
+            writeCount(b, table.size());
+            for (AnyTable::Iterator it = table.begin(); it.isValid(); ++it) {
+                writeSharedString(b, it->key, stringIndex);
+                it->value.serializeCompactValue(b, stringIndex);
+            }
+        }
+        break;
+    }
+}
+
+
+void Any::deserializeCompactValue(BinaryInput& b, Array<String>& stringTable) {
+    dropReference();
+    m_simpleValue.b = false;
+
+    const uint8 flags = b.readUInt8();
+    if ((flags & COMPACT_TYPE_MASK) > EMPTY_CONTAINER) {
+        throw "Corrupt binary Any";
+    }
+    m_type = Type(flags & COMPACT_TYPE_MASK);
+
+    if ((flags & COMPACT_HAS_DATA) || (m_type == STRING) || isContainerType(m_type)) {
+        ensureData();
+    }
+
+    if (flags & COMPACT_HAS_DATA) {
+        m_data->source.filename  = readSharedString(b, stringTable);
+        m_data->source.line      = int(readCount(b));
+        m_data->source.character = int(readCount(b));
+
+        if (isContainerType(m_type)) {
+            const uint8 c = b.readUInt8();
+            static const char* bracket[] = {PAREN, BRACKET, BRACE, BRACE};
+            m_data->bracket   = bracket[c & 3];
+            m_data->separator = (c & 4) ? ';' : ',';
+        }
+
+        if (flags & COMPACT_HAS_COMMENT) { m_data->comment     = readSharedString(b, stringTable); }
+        if (flags & COMPACT_HAS_NAME)    { m_data->name        = readSharedString(b, stringTable); }
+        if (flags & COMPACT_HAS_INCLUDE) { m_data->includeLine = readSharedString(b, stringTable); }
+        m_data->hexInteger = (flags & COMPACT_HEX_INTEGER) != 0;
+    }
+
+    switch (m_type) {
+    case NIL:
+    case EMPTY_CONTAINER:
+        break;
+
+    case BOOLEAN:
+        m_simpleValue.b = (b.readUInt8() != 0);
+        break;
+
+    case NUMBER:
+        switch (b.readUInt8()) {
+        case COMPACT_INT:
+            {
+                const uint32 z = uint32(readCount(b));
+                m_simpleValue.n = double(int32(z >> 1) ^ -int32(z & 1));
+            }
+            break;
+
+        case COMPACT_FLOAT32:
+            m_simpleValue.n = b.readFloat32();
+            break;
+
+        default:
+            m_simpleValue.n = b.readFloat64();
+        }
+        break;
+
+    case STRING:
+        *(m_data->value.s) = readSharedString(b, stringTable);
+        break;
+
+    case ARRAY:
+        {
+            const uint64 n = readCount(b);
+            // Every element occupies at least one byte
+            if (n > uint64(b.getLength() - b.getPosition())) {
+                throw "Corrupt binary Any";
+            }
+            AnyArray& array = *(m_data->value.a);
+            array.resize(int(n));
+            for (int i = 0; i < array.size(); ++i) {
+                array[i].deserializeCompactValue(b, stringTable);
+            }
+        }
+        break;
+
+    case TABLE:
+        {
+            const uint64 n = readCount(b);
+            if (n > uint64(b.getLength() - b.getPosition())) {
+                throw "Corrupt binary Any";
+            }
+            AnyTable& table = *(m_data->value.t);
+            for (uint64 i = 0; i < n; ++i) {
+                const String& key = readSharedString(b, stringTable);
+                table.getCreate(key).deserializeCompactValue(b, stringTable);
+            }
+        }
+        break;
+    }
 }
 
 
@@ -920,6 +1177,10 @@ Any Any::parse(const String& src) {
 
 void Any::_parse(const String& src) {
     beforeRead();
+    if (parseFast(src)) {
+        return;
+    }
+
     TextInput::Settings settings;
     getDeserializeSettings(settings);
 
@@ -930,10 +1191,15 @@ void Any::_parse(const String& src) {
 
 void Any::load(const String& filename) {
     beforeRead();
+    const String& resolvedFilename = FileSystem::resolve(filename);
+    if (loadFast(resolvedFilename)) {
+        return;
+    }
+
     TextInput::Settings settings;
     getDeserializeSettings(settings);
 
-    TextInput ti(FileSystem::resolve(filename), settings);
+    TextInput ti(resolvedFilename, settings);
     deserialize(ti);
 }
 
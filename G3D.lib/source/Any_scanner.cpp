@@ -0,0 +1,942 @@
+/**
+ \file G3D.lib/source/Any_scanner.cpp
+
+ Fast path for Any::load and Any::parse, and the binary disk cache used by Any::load.
+
+ \author Morgan McGuire, http://graphics.cs.williams.edu
+ \created 2026-10-18
+ \edited  2026-10-18
+
+ Copyright 2000-2026, Morgan McGuire.
+ All rights reserved.
+ */
+#include "G3D/Any.h"
+#include "G3D/BinaryInput.h"
+#include "G3D/BinaryOutput.h"
+#include "G3D/Crypto.h"
+#include "G3D/FileSystem.h"
+#include "G3D/HashTrait.h"
+#include "G3D/SpeedLoad.h"
+#include "G3D/fileutils.h"
+#include "G3D/stringutils.h"
+#include <stdlib.h>
+
+namespace G3D {
+
+/** Increment whenever the layout of disk cache files changes. Files written by other versions are
+    ignored and overwritten. */
+static const int DISK_CACHE_VERSION = 1;
+
+static String s_diskCacheDirectory;
+
+/** A file that was #included, for validating the disk cache */
+class DiskCacheDependency {
+public:
+    String      filename;
+    MD5Hash     hash;
+};
+
+
+/** Reads \a filename, which must already be resolved. Returns false if it does not exist. */
+static bool readSourceFile(const String& filename, Array<char>& buffer) {
+    if (! FileSystem::exists(filename)) {
+        return false;
+    }
+
+    String zipfile;
+    if (FileSystem::inZipfile(filename, zipfile)) {
+        const String& input = readWholeFile(filename);
+        buffer.resize(int(input.size()) + 1);
+        System::memcpy(buffer.getCArray(), input.c_str(), input.size());
+    } else {
+        const int64 n = FileSystem::size(filename);
+        FILE* f = FileSystem::fopen(filename.c_str(), "rb");
+        if ((n < 0) || isNull(f)) {
+            return false;
+        }
+        buffer.resize(int(n) + 1);
+        const size_t numRead = fread(buffer.getCArray(), 1, size_t(n), f);
+        FileSystem::fclose(f);
+        if (numRead != size_t(n)) {
+            return false;
+        }
+    }
+    buffer.last() = '\0';
+    return true;
+}
+
+
+static bool isOpen(int c) {
+    return (c == '(') || (c == '[') || (c == '{');
+}
+
+
+static bool isClose(int c) {
+    return (c == ')') || (c == ']') || (c == '}');
+}
+
+
+static bool isIdentifierStart(int c) {
+    return (c != EOF) && (isLetter((unsigned char)c) || (c == '_'));
+}
+
+
+static bool isIdentifierChar(int c) {
+    return (c != EOF) && (isLetter((unsigned char)c) || isDigit((unsigned char)c) || (c == '_'));
+}
+
+
+/**
+ Recursive-descent parser for Any that works directly on an in-memory, NUL-terminated
+ buffer and produces exactly the value that deserialize(TextInput&) would, including comments,
+ names, brackets, separators, and source locations.
+
+ No tokens are created: identifiers, numbers, and symbols are recognized in place and only the
+ Strings stored in the result are allocated. Table keys are interned, so each distinct key is
+ hashed from the buffer and constructed once per file.
+
+ The scanner accepts the syntax that appears in practice. On anything else--including all
+ malformed input--it throws Unsupported and the caller re-parses with TextInput, which either
+ accepts the input or reports the error exactly as before.
+*/
+class Any::Scanner {
+public:
+
+    class Unsupported {};
+
+private:
+
+    enum Classification {SYMBOL, BOOLEAN_TRUE, BOOLEAN_FALSE, NUMBER_NAN, NUMBER_INF};
+
+    /** Table keys seen so far. Open addressing over indices into m_keyArray. */
+    class KeyTable {
+    public:
+        Array<String>   m_keyArray;
+        Array<uint32>   m_hashArray;
+        Array<int>      m_slot;
+
+        KeyTable() {
+            m_slot.resize(256);
+            m_slot.setAll(-1);
+        }
+
+        int intern(const char* s, size_t n) {
+            const uint32 h = superFastHash(s, n);
+            const int mask = m_slot.size() - 1;
+            for (int i = int(h) & mask; true; i = (i + 1) & mask) {
+                const int k = m_slot[i];
+                if (k == -1) {
+                    m_slot[i] = m_keyArray.size();
+                    m_keyArray.append(String(s, n));
+                    m_hashArray.append(h);
+                    if (m_keyArray.size() * 2 > m_slot.size()) {
+                        rehash();
+                    }
+                    return m_keyArray.size() - 1;
+                } else if ((m_hashArray[k] == h) && (m_keyArray[k].size() == n) && (memcmp(m_keyArray[k].c_str(), s, n) == 0)) {
+                    return k;
+                }
+            }
+        }
+
+        void rehash() {
+            m_slot.resize(m_slot.size() * 2);
+            m_slot.setAll(-1);
+            const int mask = m_slot.size() - 1;
+            for (int k = 0; k < m_keyArray.size(); ++k) {
+                int i = int(m_hashArray[k]) & mask;
+                while (m_slot[i] != -1) {
+                    i = (i + 1) & mask;
+                }
+                m_slot[i] = k;
+            }
+        }
+    };
+
+    /** Reported in Any::Source */
+    const String&           m_filename;
+
+    /** Next character to consume. *m_end == '\0' */
+    const char*             m_cur;
+    const char*             m_end;
+
+    /** Line number of m_cur, starting at 1 */
+    int                     m_line;
+
+    /** The character after the most recent newline */
+    const char*             m_lineStart;
+
+    KeyTable                m_keys;
+
+    /** If not null, receives every file that is #included, recursively */
+    Array<DiskCacheDependency>*      m_dependencyArray;
+
+    int peek(int distance = 0) const {
+        return (m_cur + distance < m_end) ? (unsigned char)m_cur[distance] : EOF;
+    }
+
+    /** Consumes one character, treating "\r\n" as a single '\n' like TextInput::eatInputChar() */
+    int eat() {
+        if (m_cur >= m_end) {
+            return EOF;
+        }
+
+        int c = (unsigned char)*m_cur;
+        ++m_cur;
+        if (c == '\r') {
+            if ((m_cur < m_end) && (*m_cur == '\n')) {
+                c = '\n';
+                ++m_cur;
+            }
+            m_lineStart = m_cur;
+            ++m_line;
+        } else if (c == '\n') {
+            m_lineStart = m_cur;
+            ++m_line;
+        }
+        return c;
+    }
+
+    /** TextInput's column numbering for m_cur, starting at 1 */
+    int character() const {
+        return int(m_cur - m_lineStart) + 1;
+    }
+
+    void skipWhitespace() {
+        while ((m_cur < m_end) && isWhitespace((unsigned char)*m_cur)) {
+            eat();
+        }
+    }
+
+    bool atComment() const {
+        return (peek() == '/') && ((peek(1) == '/') || (peek(1) == '*'));
+    }
+
+    /** Consumes a comment, appending its text without the delimiters to \a s if it is not null */
+    void readComment(String* s) {
+        const bool lineComment = (peek(1) == '/');
+        m_cur += 2;
+        if (lineComment) {
+            const char* start = m_cur;
+            while ((m_cur < m_end) && ! isNewline((unsigned char)*m_cur)) {
+                ++m_cur;
+            }
+            if (notNull(s)) {
+                s->append(start, m_cur - start);
+            }
+        } else {
+            while ((m_cur < m_end) && ! ((peek() == '*') && (peek(1) == '/'))) {
+                if (notNull(s)) {
+                    // TextInput keeps only the '\r' of "\r\n" in comments
+                    *s += *m_cur;
+                }
+                eat();
+            }
+            // Closing delimiter, if not at the end of the file
+            m_cur = (m_cur + 2 <= m_end) ? m_cur + 2 : m_end;
+        }
+    }
+
+    /** Skips whitespace and comments, like TextInput::readSignificant() */
+    void skipSignificant() {
+        skipWhitespace();
+        while (atComment()) {
+            readComment(nullptr);
+            skipWhitespace();
+        }
+    }
+
+    /** Mirrors Any::deserializeComment() */
+    void readLeadingComments(String& comment) {
+        skipWhitespace();
+        if (! atComment()) {
+            return;
+        }
+        while (atComment()) {
+            String c;
+            readComment(&c);
+            comment += trimWhitespace(c);
+            comment += "\n";
+            skipWhitespace();
+        }
+        comment = trimWhitespace(comment);
+    }
+
+    /** True if the next token is "=" or ":", as opposed to "==" or "::" */
+    bool atAssignment() const {
+        const int c = peek();
+        return ((c == '=') || (c == ':')) && (peek(1) != c);
+    }
+
+    void skipIdentifier() {
+        do {
+            ++m_cur;
+        } while (isIdentifierChar(peek()));
+    }
+
+    /** TextInput turns some identifiers into BOOLEAN and NUMBER tokens */
+    static Classification classify(const char* s, size_t n) {
+        if ((n == 4) && (toupper(s[0]) == 'T') && (toupper(s[1]) == 'R') && (toupper(s[2]) == 'U') && (toupper(s[3]) == 'E')) {
+            return BOOLEAN_TRUE;
+        } else if ((n == 5) && (toupper(s[0]) == 'F') && (toupper(s[1]) == 'A') && (toupper(s[2]) == 'L') && (toupper(s[3]) == 'S') && (toupper(s[4]) == 'E')) {
+            return BOOLEAN_FALSE;
+        } else if ((n == 3) && (memcmp(s, "nan", 3) == 0)) {
+            return NUMBER_NAN;
+        } else if ((n == 3) && (memcmp(s, "inf", 3) == 0)) {
+            return NUMBER_INF;
+        } else {
+            return SYMBOL;
+        }
+    }
+
+    /** True if TextInput would read a NUMBER token here */
+    bool atNumber() const {
+        const int c = peek();
+        const int c1 = peek(1);
+        if ((c != EOF) && isDigit((unsigned char)c)) {
+            return true;
+        } else if (c == '.') {
+            return (c1 != EOF) && isDigit((unsigned char)c1);
+        } else if ((c == '-') || (c == '+')) {
+            if ((c1 != EOF) && isDigit((unsigned char)c1)) {
+                return true;
+            } else if (c1 == '.') {
+                return (peek(2) != EOF) && isDigit((unsigned char)peek(2));
+            } else {
+                // Signed infinity
+                return (c1 == 'i') && (peek(2) == 'n') && (peek(3) == 'f') && ! isIdentifierStart(peek(4));
+            }
+        } else {
+            return false;
+        }
+    }
+
+    /** Consumes a number. Requires atNumber(). Mirrors the lexing in TextInput::nextToken() and
+        the conversion in TextInput::parseNumber(). */
+    double readNumber(bool& hexInteger) {
+        hexInteger = false;
+        const char* start = m_cur;
+        bool negative = false;
+        if ((*m_cur == '-') || (*m_cur == '+')) {
+            negative = (*m_cur == '-');
+            ++m_cur;
+            if (*m_cur == 'i') {
+                m_cur += 3;
+                return negative ? -inf() : inf();
+            }
+            if (! negative) {
+                // TextInput drops the '+'
+                start = m_cur;
+            }
+        }
+
+        if ((m_cur[0] == '0') && (m_cur[1] == 'x')) {
+            if (negative) {
+                // Parsed as a hexadecimal float by sscanf
+                throw Unsupported();
+            }
+            m_cur += 2;
+            uint32 value = 0;
+            int numDigits = 0;
+            while (isxdigit((unsigned char)*m_cur)) {
+                const char c = *m_cur;
+                value = value * 16 + uint32(isDigit(c) ? (c - '0') : (toupper(c) - 'A' + 10));
+                ++numDigits;
+                ++m_cur;
+            }
+            if ((numDigits == 0) || (numDigits > 8)) {
+                throw Unsupported();
+            }
+            hexInteger = true;
+            return double(value);
+        }
+
+        bool isFloat = false;
+        while (isDigitFast(*m_cur)) {
+            ++m_cur;
+        }
+        if (*m_cur == '.') {
+            isFloat = true;
+            ++m_cur;
+            if (*m_cur == '#') {
+                // MSVC floating-point special, e.g., 1.#INF00
+                throw Unsupported();
+            }
+            while (isDigitFast(*m_cur)) {
+                ++m_cur;
+            }
+        }
+        if ((*m_cur == 'e') || (*m_cur == 'E')) {
+            isFloat = true;
+            ++m_cur;
+            if ((*m_cur == '-') || (*m_cur == '+')) {
+                ++m_cur;
+            }
+            if (! isDigitFast(*m_cur)) {
+                // sscanf's behavior differs from strtod's for a missing exponent
+                throw Unsupported();
+            }
+            while (isDigitFast(*m_cur)) {
+                ++m_cur;
+            }
+        }
+
+        const size_t length = m_cur - start;
+        if (isFloat && (*m_cur == 'f')) {
+            ++m_cur;
+        }
+
+        char buffer[64];
+        if (length >= sizeof(buffer)) {
+            throw Unsupported();
+        }
+        System::memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        return strtod(buffer, nullptr);
+    }
+
+    /** Consumes a double-quoted string, appending its value to \a s if it is not null. Mirrors
+        TextInput::parseQuotedString(). */
+    void readString(String* s) {
+        ++m_cur;
+        while (true) {
+            const char* start = m_cur;
+            while ((m_cur < m_end) && (*m_cur != '\"') && (*m_cur != '\\') && ! isNewline((unsigned char)*m_cur)) {
+                ++m_cur;
+            }
+            if (notNull(s)) {
+                s->append(start, m_cur - start);
+            }
+
+            if (m_cur >= m_end) {
+                // Unterminated
+                throw Unsupported();
+            }
+
+            const char c = *m_cur;
+            if (c == '\"') {
+                ++m_cur;
+                return;
+            } else if (c == '\\') {
+                ++m_cur;
+                const int e = eat();
+                char value = 0;
+                switch (e) {
+                case 'r':  value = '\r'; break;
+                case 'n':  value = '\n'; break;
+                case 't':  value = '\t'; break;
+                case '0':  value = '\0'; break;
+                case '\\':
+                case '\"':
+                case '\'':
+                    value = char(e);
+                    break;
+                default:
+                    // TextInput drops illegal escape sequences
+                    continue;
+                }
+                if (notNull(s)) {
+                    *s += value;
+                }
+            } else {
+                // Newline
+                const int n = eat();
+                if (notNull(s)) {
+                    *s += char(n);
+                }
+            }
+        }
+    }
+
+    /** Consumes one token of any kind that can begin an element, for the lookahead in containerType() */
+    void skipToken() {
+        const int c = peek();
+        if (c == '\"') {
+            readString(nullptr);
+        } else if (atNumber()) {
+            bool ignore;
+            readNumber(ignore);
+        } else if (isIdentifierStart(c)) {
+            skipIdentifier();
+        } else if (isOpen(c) || isClose(c) || (c == ',') || (c == ';') || (c == '#')) {
+            ++m_cur;
+        } else {
+            throw Unsupported();
+        }
+    }
+
+    /** Mirrors the lookahead in findType() in Any.cpp. m_cur is at the open bracket. */
+    Any::Type containerType(int close) {
+        const char* cur       = m_cur;
+        const char* lineStart = m_lineStart;
+        const int   line      = m_line;
+
+        ++m_cur;
+        skipSignificant();
+
+        Any::Type type;
+        if (peek() == close) {
+            type = EMPTY_CONTAINER;
+        } else if (atAssignment()) {
+            type = TABLE;
+        } else {
+            skipToken();
+            skipSignificant();
+            type = atAssignment() ? TABLE : ARRAY;
+        }
+
+        m_cur       = cur;
+        m_lineStart = lineStart;
+        m_line      = line;
+        return type;
+    }
+
+    void setSource(Any& a, int line, int character) const {
+        Any::Source& source = a.m_data->source;
+        source.filename  = m_filename;
+        source.line      = line;
+        source.character = character;
+    }
+
+    /** Appends the remainder of a qualified name such as Texture::Specification to \a name.
+        Mirrors Any::deserializeName(). */
+    void readName(String& name) {
+        while (true) {
+            skipSignificant();
+            const int c = peek();
+            if (isOpen(c)) {
+                return;
+            } else if (((c == ':') && (peek(1) == ':')) || ((c == '-') && (peek(1) == '>'))) {
+                name.append(m_cur, 2);
+                m_cur += 2;
+            } else if ((c == '.') && (peek(1) != '.') && ! atNumber()) {
+                name += '.';
+                ++m_cur;
+            } else if (isIdentifierStart(c)) {
+                const char* start = m_cur;
+                skipIdentifier();
+                if (classify(start, m_cur - start) != SYMBOL) {
+                    throw Unsupported();
+                }
+                name.append(start, m_cur - start);
+            } else {
+                throw Unsupported();
+            }
+        }
+    }
+
+    /** Reads a TABLE, ARRAY, or EMPTY_CONTAINER. m_cur is at the open bracket. Mirrors Any::deserializeBody(). */
+    void readContainer(Any& a) {
+        const int line = m_line;
+        const int character = this->character();
+
+        const char* bracket;
+        switch (*m_cur) {
+        case '(': bracket = PAREN;   break;
+        case '[': bracket = BRACKET; break;
+        default:  bracket = BRACE;   break;
+        }
+        const int close = bracket[1];
+
+        a.m_type = containerType(close);
+        a.ensureData();
+        setSource(a, line, character);
+        a.m_data->bracket = bracket;
+
+        ++m_cur;
+        while (true) {
+            String comment;
+            readLeadingComments(comment);
+
+            int c = peek();
+            if (c == close) {
+                break;
+            } else if ((c == EOF) || (c == '\0') || isClose(c)) {
+                throw Unsupported();
+            }
+
+            Any element;
+            int key = -1;
+            if (a.m_type == TABLE) {
+                if (c == '\"') {
+                    String s;
+                    readString(&s);
+                    key = m_keys.intern(s.c_str(), s.size());
+                } else if (isIdentifierStart(c)) {
+                    const char* start = m_cur;
+                    skipIdentifier();
+                    if (classify(start, m_cur - start) != SYMBOL) {
+                        throw Unsupported();
+                    }
+                    key = m_keys.intern(start, m_cur - start);
+                } else {
+                    throw Unsupported();
+                }
+
+                skipSignificant();
+                if (! atAssignment()) {
+                    throw Unsupported();
+                }
+                ++m_cur;
+            }
+
+            readValue(element);
+
+            if (! comment.empty()) {
+                element.ensureData();
+                element.m_data->comment = trimWhitespace(comment + "\n" + element.m_data->comment);
+            }
+
+            if (a.m_type == TABLE) {
+                a.set(m_keys.m_keyArray[key], element);
+            } else {
+                a.append(element);
+            }
+
+            // Mirrors Any::readUntilSeparatorOrClose()
+            skipSignificant();
+            c = peek();
+            if ((c == ',') || (c == ';')) {
+                ++m_cur;
+                a.m_data->separator = char(c);
+            } else if (c != close) {
+                throw Unsupported();
+            }
+        }
+
+        // Close bracket
+        ++m_cur;
+    }
+
+    /** Mirrors the #include case of Any::deserialize(TextInput&, Token&). m_cur is at the '#'. */
+    void readInclude(Any& a, const String& comment) {
+        ++m_cur;
+        skipWhitespace();
+        const int line = m_line;
+        const int character = this->character();
+        if (! isIdentifierStart(peek())) {
+            throw Unsupported();
+        }
+        const char* start = m_cur;
+        skipIdentifier();
+        if ((m_cur - start != 7) || (memcmp(start, "include", 7) != 0)) {
+            throw Unsupported();
+        }
+
+        skipWhitespace();
+        if (peek() != '(') {
+            throw Unsupported();
+        }
+        ++m_cur;
+
+        skipWhitespace();
+        if (peek() != '\"') {
+            throw Unsupported();
+        }
+        String includeName;
+        readString(&includeName);
+
+        skipWhitespace();
+        if (peek() != ')') {
+            throw Unsupported();
+        }
+        ++m_cur;
+
+        String t = FileSystem::resolve(includeName, FilePath::parent(m_filename));
+        if (! FileSystem::exists(t)) {
+            t = System::findDataFile(includeName);
+        }
+
+        if (! parseFile(FileSystem::resolve(t), a, m_dependencyArray)) {
+            throw Unsupported();
+        }
+
+        a.ensureData();
+        if (! comment.empty()) {
+            a.m_data->includeLine = format("\n/* %s */\n", comment.c_str());
+        }
+        a.m_data->includeLine += format("#include(\"%s\")", includeName.c_str());
+        a.m_data->source.filename += format(" [included from %s:%d(%d)]", m_filename.c_str(), line, character);
+    }
+
+    /** Mirrors Any::deserialize(TextInput&, Token&) */
+    void readValue(Any& a) {
+        String comment;
+        readLeadingComments(comment);
+
+        const int line = m_line;
+        const int character = this->character();
+        const int c = peek();
+
+        if (c == '\"') {
+            a.m_type = STRING;
+            a.ensureData();
+            readString(a.m_data->value.s);
+            setSource(a, line, character);
+
+        } else if (atNumber()) {
+            bool hexInteger;
+            a.m_type = NUMBER;
+            a.m_simpleValue.n = readNumber(hexInteger);
+            a.ensureData();
+            setSource(a, line, character);
+            a.m_data->hexInteger = hexInteger;
+
+        } else if (isIdentifierStart(c)) {
+            const char* start = m_cur;
+            skipIdentifier();
+            const size_t length = m_cur - start;
+
+            switch (classify(start, length)) {
+            case BOOLEAN_TRUE:
+            case BOOLEAN_FALSE:
+                a.m_type = BOOLEAN;
+                a.m_simpleValue.b = (classify(start, length) == BOOLEAN_TRUE);
+                a.ensureData();
+                setSource(a, line, character);
+                break;
+
+            case NUMBER_NAN:
+            case NUMBER_INF:
+                a.m_type = NUMBER;
+                a.m_simpleValue.n = (classify(start, length) == NUMBER_NAN) ? nan() : inf();
+                a.ensureData();
+                setSource(a, line, character);
+                break;
+
+            case SYMBOL:
+                if (((length == 3) && (toupper(start[0]) == 'N') && (toupper(start[1]) == 'I') && (toupper(start[2]) == 'L')) ||
+                    ((length == 4) && (memcmp(start, "None", 4) == 0))) {
+                    a.ensureData();
+                    setSource(a, line, character);
+                } else {
+                    // TextInput::peek() would return the contents of a comment or string, which
+                    // Any::deserialize then compares against brackets
+                    skipWhitespace();
+                    if (atComment() || (peek() == '\"')) {
+                        throw Unsupported();
+                    }
+
+                    if (isOpen(peek()) || ((peek() == ':') && (peek(1) == ':'))) {
+                        String name(start, length);
+                        readName(name);
+                        readContainer(a);
+                        a.m_data->name = name;
+                    } else {
+                        // Unquoted string
+                        a.m_type = STRING;
+                        a.ensureData();
+                        a.m_data->value.s->assign(start, length);
+                        setSource(a, line, character);
+                    }
+                }
+                break;
+            }
+
+        } else if (isOpen(c)) {
+            readContainer(a);
+
+        } else if (c == '#') {
+            readInclude(a, comment);
+
+        } else {
+            throw Unsupported();
+        }
+
+        if (! comment.empty()) {
+            a.ensureData();
+            a.m_data->comment = comment;
+        }
+    }
+
+public:
+
+    /** \param buffer Must be NUL-terminated at buffer[length] */
+    Scanner(const String& filename, const char* buffer, size_t length, Array<DiskCacheDependency>* dependencyArray) :
+        m_filename(filename),
+        m_cur(buffer),
+        m_end(buffer + length),
+        m_line(1),
+        m_lineStart(buffer),
+        m_dependencyArray(dependencyArray) {
+        debugAssert(*m_end == '\0');
+    }
+
+    /** Reads the first value. Like deserialize(TextInput&), ignores anything after it except
+        for failing if the next token is not even lexically valid. */
+    void read(Any& result) {
+        readValue(result);
+
+        skipWhitespace();
+        const int c = peek();
+        if ((c == '`') || (c == 0x7F) || (c == 0xFF) || ((c > 0) && (c < ' '))) {
+            throw Unsupported();
+        }
+    }
+
+    /** Parses \a filename, which must already be resolved, appending it and everything that it
+        includes to \a dependencyArray if that is not null. Returns false if the file does not
+        exist. */
+    static bool parseFile(const String& filename, Any& result, Array<DiskCacheDependency>* dependencyArray) {
+        Array<char> buffer;
+        if (! readSourceFile(filename, buffer)) {
+            return false;
+        }
+
+        if (notNull(dependencyArray)) {
+            DiskCacheDependency& d = dependencyArray->next();
+            d.filename = filename;
+            d.hash = Crypto::md5(buffer.getCArray(), buffer.size() - 1);
+        }
+
+        Scanner scanner(filename, buffer.getCArray(), buffer.size() - 1, dependencyArray);
+        scanner.read(result);
+        return true;
+    }
+};
+
+
+void Any::setDiskCacheDirectory(const String& directory) {
+    s_diskCacheDirectory = directory;
+    if (! directory.empty() && ! FileSystem::exists(directory)) {
+        FileSystem::createDirectory(directory);
+    }
+}
+
+
+const String& Any::diskCacheDirectory() {
+    return s_diskCacheDirectory;
+}
+
+
+static String toHex(const MD5Hash& h) {
+    String s;
+    for (int i = 0; i < 16; ++i) {
+        s += format("%02x", h[i]);
+    }
+    return s;
+}
+
+
+/** Content hash of a file, or the zero hash if it does not exist */
+static MD5Hash sourceHash(const String& filename) {
+    Array<char> buffer;
+    if (readSourceFile(filename, buffer)) {
+        return Crypto::md5(buffer.getCArray(), buffer.size() - 1);
+    } else {
+        return MD5Hash();
+    }
+}
+
+
+/** Returns false if \a cacheFilename does not exist, is out of date, or is corrupt */
+static bool loadFromDiskCache(const String& cacheFilename, Any& result) {
+    if (! FileSystem::exists(cacheFilename, false)) {
+        return false;
+    }
+
+    try {
+        BinaryInput b(cacheFilename, G3D_LITTLE_ENDIAN);
+        if ((b.readString(SpeedLoad::HEADER_LENGTH) != "Any") || (b.readInt32() != DISK_CACHE_VERSION)) {
+            return false;
+        }
+
+        // The hash of the file itself is part of the cache filename
+        const int numDependencies = b.readInt32();
+        for (int i = 0; i < numDependencies; ++i) {
+            const String& filename = b.readString32();
+            const MD5Hash hash(b);
+            if (sourceHash(filename) != hash) {
+                return false;
+            }
+        }
+
+        result.deserialize(b);
+        return true;
+    } catch (...) {
+        // Truncated or corrupt file; parse the source
+        return false;
+    }
+}
+
+
+static void saveToDiskCache(const String& cacheFilename, const Array<DiskCacheDependency>& dependencyArray, const Any& value) {
+    const String tempFilename = cacheFilename + ".tmp";
+    {
+        BinaryOutput b(tempFilename, G3D_LITTLE_ENDIAN);
+        SpeedLoad::writeHeader(b, "Any");
+        b.writeInt32(DISK_CACHE_VERSION);
+        b.writeInt32(dependencyArray.size());
+        for (int i = 0; i < dependencyArray.size(); ++i) {
+            b.writeString32(dependencyArray[i].filename);
+            dependencyArray[i].hash.serialize(b);
+        }
+        value.serializeCompact(b);
+        b.commit();
+    }
+
+    // Replace any stale file only after the new one is complete, so that a concurrent or
+    // interrupted process never sees a partial file
+    if (FileSystem::exists(cacheFilename, false)) {
+        FileSystem::removeFile(cacheFilename);
+    }
+    FileSystem::rename(tempFilename, cacheFilename);
+}
+
+
+bool Any::loadFast(const String& resolvedFilename) {
+    Array<char> buffer;
+    if (! readSourceFile(resolvedFilename, buffer)) {
+        // Let TextInput report the error
+        return false;
+    }
+    const size_t length = buffer.size() - 1;
+
+    String cacheFilename;
+    if (! s_diskCacheDirectory.empty()) {
+        const String& key = format("%d %s %s", DISK_CACHE_VERSION, resolvedFilename.c_str(),
+                                   toHex(Crypto::md5(buffer.getCArray(), length)).c_str());
+        cacheFilename = FilePath::concat(s_diskCacheDirectory, toHex(Crypto::md5(key.c_str(), key.size())) + ".AnyCache");
+
+        Any cached;
+        if (loadFromDiskCache(cacheFilename, cached)) {
+            *this = cached;
+            return true;
+        }
+    }
+
+    Any result;
+    Array<DiskCacheDependency> dependencyArray;
+    try {
+        Scanner scanner(resolvedFilename, buffer.getCArray(), length, cacheFilename.empty() ? nullptr : &dependencyArray);
+        scanner.read(result);
+    } catch (const Scanner::Unsupported&) {
+        return false;
+    }
+
+    *this = result;
+
+    if (! cacheFilename.empty()) {
+        saveToDiskCache(cacheFilename, dependencyArray, result);
+    }
+    return true;
+}
+
+
+bool Any::parseFast(const String& src) {
+    // The pseudo-filename that TextInput generates for strings
+    const String& filename = (src.size() < 14) ? format("\"%.*s\"", int(src.size()), src.c_str()) : format("\"%.*s...\"", 10, src.c_str());
+
+    Any result;
+    try {
+        Scanner scanner(filename, src.c_str(), src.size(), nullptr);
+        scanner.read(result);
+    } catch (const Scanner::Unsupported&) {
+        return false;
+    }
+
+    *this = result;
+    return true;
+}
+
+} // namespace G3D
@@ -5,7 +5,7 @@
  Copyright 2001-2013, Morgan McGuire.  All rights reserved.
  
  \created 2001-08-09
- \edited  2013-01-03
+ \edited  2026-10-18
 
 
   <PRE>
@@ -39,13 +39,93 @@
 #include "G3D/Log.h"
 #include "G3D/FileSystem.h"
 #include "../../zlib.lib/include/zlib.h"
-#include "../../zip.lib/include/zip.h"
+#include "G3D/ZipfileCache.h"
 #include <cstring>
+#include <atomic>
 
 namespace G3D {
 
 const bool BinaryInput::NO_COPY = false;
 
+/** Size of the header and footer of files written with BinaryOutput::setBlockCompression */
+static const int BLOCK_HEADER_SIZE = 8;
+static const int BLOCK_FOOTER_SIZE = 32;
+
+/** Seeks to a 64-bit offset */
+static void seekFile(FILE* file, int64 offset) {
+#   ifdef G3D_WINDOWS
+        _fseeki64(file, offset, SEEK_SET);
+#   else
+        fseeko(file, (off_t)offset, SEEK_SET);
+#   endif
+}
+
+
+static uint64 readLittleEndian(const uint8* data, int numBytes) {
+    uint64 x = 0;
+    for (int i = 0; i < numBytes; ++i) {
+        x |= uint64(data[i]) << (8 * i);
+    }
+    return x;
+}
+
+
+bool BinaryInput::isBlockCompressed(const uint8* data, int64 dataLen) {
+    // The zlib format written by BinaryOutput::compress begins with a 32-bit size and
+    // then a zlib header byte, which is never 1
+    return (dataLen >= BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE) &&
+        (data[0] == 'G') && (data[1] == '3') && (data[2] == 'D') && (data[3] == 'Z') && (data[4] == 1);
+}
+
+
+void BinaryInput::readBlockIndex(const uint8* tail, int64 tailLength, int64 fileLength) {
+    const uint8* footer = tail + tailLength - BLOCK_FOOTER_SIZE;
+    if ((tailLength < BLOCK_FOOTER_SIZE) || (footer[28] != 'G') || (footer[29] != '3') || (footer[30] != 'D') || (footer[31] != 'Z')) {
+        throw "Block-compressed file footer is corrupted";
+    }
+
+    m_length                 = (int64)readLittleEndian(footer, 8);
+    const int64 numBlocks    = (int64)readLittleEndian(footer + 8, 8);
+    m_blockIndexOffset       = (int64)readLittleEndian(footer + 16, 8);
+    m_blockSize              = (int64)readLittleEndian(footer + 24, 4);
+
+    if ((m_blockIndexOffset + numBlocks * 8 + BLOCK_FOOTER_SIZE != fileLength) ||
+        (numBlocks * 8 + BLOCK_FOOTER_SIZE > tailLength) ||
+        (m_blockSize <= 0) || (numBlocks != (m_length + m_blockSize - 1) / m_blockSize)) {
+        throw "Block-compressed file index is corrupted";
+    }
+
+    const uint8* index = footer - numBlocks * 8;
+    m_blockOffset.resize((int)numBlocks);
+    for (int b = 0; b < m_blockOffset.size(); ++b) {
+        m_blockOffset[b] = readLittleEndian(index + b * 8, 8);
+    }
+}
+
+
+void BinaryInput::decompressBlocks(const uint8* src, int first, int count, uint8* dst) {
+    if (count == 0) {
+        return;
+    }
+
+    const uint64 base = m_blockOffset[first];
+    std::atomic<bool> ok(true);
+    tbb::parallel_for(tbb::blocked_range<int>(first, first + count, 1), [&](const tbb::blocked_range<int>& r) {
+        for (int b = r.begin(); b < r.end(); ++b) {
+            const uint64 end = (b + 1 < m_blockOffset.size()) ? m_blockOffset[b + 1] : uint64(m_blockIndexOffset);
+            uLongf L = (uLongf)G3D::min(m_blockSize, m_length - b * m_blockSize);
+            const int result = uncompress(dst + (b - first) * m_blockSize, &L, src + (m_blockOffset[b] - base), (uLong)(end - m_blockOffset[b]));
+            if (result != Z_OK) {
+                ok = false;
+            }
+        }
+    });
+
+    if (! ok.load()) {
+        throw "BinaryInput/zlib detected corruption in " + m_filename;
+    }
+}
+
 
 /** Helper used by the constructors for decompression */
 static uint32 readUInt32FromBuffer(const uint8* data, bool swapBytes) {
@@ -74,13 +154,23 @@ BinaryInput::BinaryInput(
     m_beginEndBits(0),
     m_alreadyRead(0),
     m_bufferLength(0),
-    m_pos(0) {
+    m_pos(0),
+    m_blockIndexOffset(0),
+    m_blockSize(0) {
 
     m_freeBuffer = copyMemory || compressed;
 
     setEndian(dataEndian);
 
-    if (compressed) {
+    if (compressed && isBlockCompressed(data, dataLen)) {
+        readBlockIndex(data, dataLen, dataLen);
+        m_bufferLength = m_length;
+        m_buffer = (uint8*)System::alignedMalloc(m_length, 16);
+        decompressBlocks(data + BLOCK_HEADER_SIZE, 0, m_blockOffset.size(), m_buffer);
+
+        // In-memory data never needs to be reloaded
+        m_blockOffset.clear();
+    } else if (compressed) {
         // Read the decompressed size from the first 4 bytes
         m_length = readUInt32FromBuffer(data, m_swapBytes);
 
@@ -122,7 +212,9 @@ BinaryInput::BinaryInput
     m_bufferLength(0),
     m_buffer(NULL),
     m_pos(0),
-    m_freeBuffer(true) {
+    m_freeBuffer(true),
+    m_blockIndexOffset(0),
+    m_blockSize(0) {
 
     setEndian(fileEndian);
     
@@ -134,26 +226,18 @@ BinaryInput::BinaryInput
 
         // Zipfiles require Unix-style slashes
         String internalFile = FilePath::canonicalize(m_filename.substr(zipfile.length() + 1));
-        struct zip* z = zip_open(zipfile.c_str(), ZIP_CHECKCONS, NULL);
-        {
-            struct zip_stat info;
-            zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-            zip_stat(z, internalFile.c_str(), ZIP_FL_NOCASE, &info);
-            m_bufferLength = m_length = info.size;
-            // sets machines up to use MMX, if they want
-            m_buffer = reinterpret_cast<uint8*>(System::alignedMalloc(m_length, 16));
-            struct zip_file* zf = zip_fopen( z, internalFile.c_str(), ZIP_FL_NOCASE );
-            if (zf == NULL) {
-                throw String("\"") + internalFile + "\" inside \"" + zipfile + "\" could not be opened.";
-            } else {
-                const int64 bytesRead = zip_fread( zf, m_buffer, m_length );
-                debugAssertM(bytesRead == m_length,
-                             internalFile + " was corrupt because it unzipped to the wrong size.");
-                (void)bytesRead;
-                zip_fclose( zf );
-            }
+        const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(zipfile);
+        const int index = isNull(archive) ? -1 : archive->find(internalFile);
+        if (index == -1) {
+            throw String("\"") + internalFile + "\" inside \"" + zipfile + "\" could not be opened.";
         }
-        zip_close( z );
+
+        m_bufferLength = m_length = archive->entry(index).size;
+        // sets machines up to use MMX, if they want
+        m_buffer = reinterpret_cast<uint8*>(System::alignedMalloc(m_length, 16));
+        const bool success = archive->read(index, m_buffer);
+        debugAssertM(success, internalFile + " was corrupt because it unzipped to the wrong size.");
+        (void)success;
 
         if (compressed) {
             decompress();
@@ -174,6 +258,35 @@ BinaryInput::BinaryInput
         return;
     }
 
+    if (compressed) {
+        uint8 header[BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE];
+        if ((m_length >= (int64)sizeof(header)) && (fread(header, 1, BLOCK_HEADER_SIZE, file) == BLOCK_HEADER_SIZE) &&
+            isBlockCompressed(header, m_length)) {
+
+            // Read the footer to find the size of the index, and then the index
+            const int64 fileLength = m_length;
+            seekFile(file, fileLength - BLOCK_FOOTER_SIZE);
+            (void)fread(header, 1, BLOCK_FOOTER_SIZE, file);
+            const int64 tailLength = G3D::min(fileLength, (int64)readLittleEndian(header + 8, 8) * 8 + BLOCK_FOOTER_SIZE);
+            Array<uint8> tail;
+            tail.resize((int)tailLength);
+            seekFile(file, fileLength - tailLength);
+            (void)fread(tail.getCArray(), 1, tailLength, file);
+            FileSystem::fclose(file);
+            file = NULL;
+
+            readBlockIndex(tail.getCArray(), tailLength, fileLength);
+
+            // Decompress on demand, with the buffer holding a window of whole blocks
+            m_bufferLength = G3D::min(m_length, DECOMPRESSION_WINDOW_BLOCKS * m_blockSize);
+            if (m_blockOffset.size() > 0) {
+                loadBlocksIntoMemory(0, m_bufferLength);
+            }
+            return;
+        }
+        rewind(file);
+    }
+
     if (! compressed && (m_length > INITIAL_BUFFER_LENGTH)) {
         // Read only a subset of the file so we don't consume
         // all available memory.
@@ -240,6 +353,17 @@ void BinaryInput::decompress() {
     // Decompress
     // Use the existing buffer as the source, allocate
     // a new buffer to use as the destination.
+
+    if (isBlockCompressed(m_buffer, m_length)) {
+        uint8* tempBuffer = m_buffer;
+        readBlockIndex(tempBuffer, m_bufferLength, m_bufferLength);
+        m_bufferLength = m_length;
+        m_buffer = (uint8*)System::alignedMalloc(m_length, 16);
+        decompressBlocks(tempBuffer + BLOCK_HEADER_SIZE, 0, m_blockOffset.size(), m_buffer);
+        m_blockOffset.clear();
+        System::alignedFree(tempBuffer);
+        return;
+    }
     
     int64 tempLength = m_length;
     m_length = readUInt32FromBuffer(m_buffer, m_swapBytes);
@@ -272,7 +396,50 @@ void BinaryInput::setEndian(G3DEndian e) {
 }
 
 
+void BinaryInput::loadBlocksIntoMemory(int64 startPosition, int64 minLength) {
+    const int64 absPos = m_alreadyRead + m_pos;
+
+    // Start on a block boundary
+    const int first = (int)(startPosition / m_blockSize);
+    m_alreadyRead = first * m_blockSize;
+    const int64 needed = G3D::max(m_bufferLength, minLength + (startPosition - m_alreadyRead));
+    const int count = (int)G3D::min<int64>((needed + m_blockSize - 1) / m_blockSize, m_blockOffset.size() - first);
+
+    if (isNull(m_buffer) || (m_bufferLength < count * m_blockSize)) {
+        System::alignedFree(m_buffer);
+        m_bufferLength = count * m_blockSize;
+        m_buffer = (uint8*)System::alignedMalloc(m_bufferLength, 16);
+        if (isNull(m_buffer)) {
+            throw "Tried to read a larger memory chunk than could fit in memory. (3)";
+        }
+    }
+
+    const int64 compressedStart = (int64)m_blockOffset[first];
+    const int64 compressedEnd   = (first + count < m_blockOffset.size()) ? (int64)m_blockOffset[first + count] : m_blockIndexOffset;
+    uint8* src = (uint8*)System::malloc((size_t)(compressedEnd - compressedStart));
+
+    FILE* file = FileSystem::fopen(m_filename.c_str(), "rb");
+    if (isNull(file) || isNull(src)) {
+        throw "Could not load block-compressed data from " + m_filename;
+    }
+    seekFile(file, compressedStart);
+    const size_t ret = fread(src, 1, (size_t)(compressedEnd - compressedStart), file);
+    debugAssert(ret == (size_t)(compressedEnd - compressedStart)); (void)ret;
+    FileSystem::fclose(file);
+
+    decompressBlocks(src, first, count, m_buffer);
+    System::free(src);
+
+    m_pos = absPos - m_alreadyRead;
+}
+
+
 void BinaryInput::loadIntoMemory(int64 startPosition, int64 minLength) {
+    if (m_blockOffset.size() > 0) {
+        loadBlocksIntoMemory(startPosition, minLength);
+        return;
+    }
+
     // Load the next section of the file
     debugAssertM(m_filename != "<memory>", "Read past end of file.");
 
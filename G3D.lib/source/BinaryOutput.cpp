@@ -5,7 +5,7 @@
  Copyright 2002-2011, Morgan McGuire, All rights reserved.
  
  @created 2002-02-20
- @edited  2010-03-17
+ @edited  2026-10-18
  */
 
 #include "G3D/platform.h"
@@ -29,8 +29,24 @@
 // Currently 400 MB
 #define MAX_BINARYOUTPUT_BUFFER_SIZE 400000000
 
+// In block compression mode, whole blocks are compressed and streamed to
+// disk whenever the buffer grows past this many blocks, keeping the last
+// BLOCK_COMPRESSION_KEEP_BLOCKS in memory to allow seeking backwards.
+//
+// Currently 64 MB and 10 MB at the default block size
+#define BLOCK_COMPRESSION_FLUSH_BLOCKS 64
+#define BLOCK_COMPRESSION_KEEP_BLOCKS 10
+
 namespace G3D {
 
+/** Appends \a x to \a out in little-endian order */
+static void appendLittleEndian(Array<uint8>& out, uint64 x, int numBytes) {
+    for (int i = 0; i < numBytes; ++i) {
+        out.append(uint8(x >> (8 * i)));
+    }
+}
+
+
 void BinaryOutput::writeBool8(const std::vector<bool>& out, int n) {
     for (int i = 0; i < n; ++i) {
         writeBool8(out[i]);
@@ -113,6 +129,17 @@ IMPLEMENT_WRITER(Float64, float64)
 void BinaryOutput::reallocBuffer(size_t bytes, size_t oldBufferLen) {
     //debugPrintf("reallocBuffer(%d, %d)\n", bytes, oldBufferLen);
 
+    if ((m_blockCompressionLevel >= 0) && (m_filename != "<memory>") && (oldBufferLen >= BLOCK_COMPRESSION_FLUSH_BLOCKS * m_compressionBlockSize)) {
+        // Stream compressed blocks to disk instead of growing the buffer
+        const size_t requestedBufferLen = m_bufferLen;
+        m_bufferLen = oldBufferLen;
+        if (flushCompressedBlocks(BLOCK_COMPRESSION_KEEP_BLOCKS * m_compressionBlockSize)) {
+            reserveBytes(bytes);
+            return;
+        }
+        m_bufferLen = requestedBufferLen;
+    }
+
     size_t newBufferLen = (int)(m_bufferLen * 1.5) + 100;
     uint8* newBuffer = NULL;
 
@@ -145,6 +172,12 @@ void BinaryOutput::reallocBuffer(size_t bytes, size_t oldBufferLen) {
 void BinaryOutput::reserveBytesWhenOutOfMemory(size_t bytes) {
     if (m_filename == "<memory>") {
         throw "Out of memory while writing to memory in BinaryOutput (no RAM left).";
+    } else if (m_blockCompressionLevel >= 0) {
+        // Raw bytes cannot be dumped into a compressed file
+        if (! flushCompressedBlocks(0)) {
+            throw "Out of memory while writing to disk in BinaryOutput (could not create a large enough buffer).";
+        }
+        reserveBytes(bytes);
     } else if ((int)bytes > (int)m_maxBufferLen) {
         throw "Out of memory while writing to disk in BinaryOutput (could not create a large enough buffer).";
     } else {
@@ -211,6 +244,9 @@ BinaryOutput::BinaryOutput() {
     m_bitPos = 0;
     m_ok = true;
     m_committed = false;
+    m_blockCompressionLevel = -1;
+    m_compressionBlockSize = DEFAULT_COMPRESSION_BLOCK_SIZE;
+    m_compressedWritten = 0;
 }
 
 
@@ -229,6 +265,9 @@ BinaryOutput::BinaryOutput(
     m_bitString = 0;
     m_bitPos = 0;
     m_committed = false;
+    m_blockCompressionLevel = -1;
+    m_compressionBlockSize = DEFAULT_COMPRESSION_BLOCK_SIZE;
+    m_compressedWritten = 0;
 
     m_ok = true;    
     /** Verify ability to write to disk */
@@ -250,6 +289,9 @@ void BinaryOutput::reset() {
     m_bitString = 0;
     m_bitPos = 0;
     m_committed = false;
+    m_blockCompressionLevel = -1;
+    m_blockOffset.fastClear();
+    m_compressedWritten = 0;
 }
 
 
@@ -274,6 +316,7 @@ bool BinaryOutput::ok() const {
 
 
 void BinaryOutput::compress(int level) {
+    debugAssertM(m_blockCompressionLevel < 0, "Cannot compress() when block compression is enabled.");
     if (m_alreadyWritten > 0) {
         throw "Cannot compress huge files (part of this file has already been written to disk).";
     }
@@ -319,11 +362,134 @@ void BinaryOutput::compress(int level) {
 }
 
 
+void BinaryOutput::setBlockCompression(int level, int blockSize) {
+    debugAssertM(length() == 0, "setBlockCompression must be called before writing.");
+    debugAssertM(blockSize > 0, "Block size must be positive.");
+    m_blockCompressionLevel = iClamp(level, 0, 9);
+    m_compressionBlockSize  = (size_t)blockSize;
+}
+
+
+void BinaryOutput::compressBlocks(size_t numBytes, bool final, Array<uint8>& out) {
+    const size_t blockSize = m_compressionBlockSize;
+    debugAssert(final || (numBytes % blockSize == 0));
+    const int numBlocks = (int)((numBytes + blockSize - 1) / blockSize);
+    if (numBlocks == 0) {
+        return;
+    }
+
+    // Each block is compressed into its own worst-case-sized slot
+    const size_t bound = compressBound((uLong)blockSize);
+    uint8* scratch = (uint8*)System::malloc(bound * numBlocks);
+    if (isNull(scratch)) {
+        throw "Out of memory while compressing in BinaryOutput.";
+    }
+
+    Array<uLong> compressedSize;
+    compressedSize.resize(numBlocks);
+    tbb::parallel_for(tbb::blocked_range<int>(0, numBlocks, 1), [&](const tbb::blocked_range<int>& r) {
+        for (int b = r.begin(); b < r.end(); ++b) {
+            const size_t start = b * blockSize;
+            compressedSize[b] = (uLong)bound;
+            const int result = compress2(scratch + b * bound, &compressedSize[b], m_buffer + start,
+                                         (uLong)G3D::min(blockSize, numBytes - start), m_blockCompressionLevel);
+            debugAssert(result == Z_OK); (void)result;
+        }
+    });
+
+    for (int b = 0; b < numBlocks; ++b) {
+        m_blockOffset.append(uint64(m_compressedWritten + out.size()));
+        const int start = out.size();
+        out.resize(start + (int)compressedSize[b]);
+        System::memcpy(out.getCArray() + start, scratch + b * bound, compressedSize[b]);
+    }
+
+    System::free(scratch);
+}
+
+
+bool BinaryOutput::flushCompressedBlocks(size_t keepBytes) {
+    debugAssert(m_filename != "<memory>");
+
+    // Everything after the current position may still be overwritten by a seek
+    const size_t available = G3D::min((size_t)m_pos, m_bufferLen);
+    if (available <= keepBytes) {
+        return false;
+    }
+
+    const size_t numBytes = ((available - keepBytes) / m_compressionBlockSize) * m_compressionBlockSize;
+    if (numBytes == 0) {
+        return false;
+    }
+
+    Array<uint8> out;
+    if (m_compressedWritten == 0) {
+        out.append('G', '3', 'D', 'Z');
+        out.append(1, 0, 0, 0);
+    }
+    compressBlocks(numBytes, false, out);
+
+    const char* mode = (m_compressedWritten > 0) ? "ab" : "wb";
+    FILE* file = FileSystem::fopen(m_filename.c_str(), mode);
+    if (isNull(file)) {
+        throw String("BinaryOutput could not write to '") + m_filename + "'";
+    }
+    const size_t count = fwrite(out.getCArray(), 1, out.size(), file);
+    FileSystem::fclose(file);
+    if (count != (size_t)out.size()) {
+        throw String("BinaryOutput could not write to '") + m_filename + "'";
+    }
+
+    m_compressedWritten += out.size();
+    m_alreadyWritten    += numBytes;
+    m_bufferLen         -= numBytes;
+    m_pos               -= numBytes;
+
+    // The regions overlap
+    memmove(m_buffer, m_buffer + numBytes, m_bufferLen);
+    return true;
+}
+
+
+void BinaryOutput::finishBlockCompression() {
+    Array<uint8> out;
+    if (m_compressedWritten == 0) {
+        out.append('G', '3', 'D', 'Z');
+        out.append(1, 0, 0, 0);
+    }
+    compressBlocks(m_bufferLen, true, out);
+
+    const uint64 indexOffset = uint64(m_compressedWritten + out.size());
+    for (int b = 0; b < m_blockOffset.size(); ++b) {
+        appendLittleEndian(out, m_blockOffset[b], 8);
+    }
+    appendLittleEndian(out, uint64(m_alreadyWritten + m_bufferLen), 8);
+    appendLittleEndian(out, uint64(m_blockOffset.size()), 8);
+    appendLittleEndian(out, indexOffset, 8);
+    appendLittleEndian(out, uint64(m_compressionBlockSize), 4);
+    out.append('G', '3', 'D', 'Z');
+
+    // Replace the uncompressed data with the tail of the compressed file, which
+    // commit() then writes after the blocks that were already streamed to disk
+    System::free(m_buffer);
+    m_maxBufferLen = m_bufferLen = out.size();
+    m_buffer = (uint8*)System::malloc(m_maxBufferLen);
+    System::memcpy(m_buffer, out.getCArray(), out.size());
+    m_pos = m_bufferLen;
+    m_alreadyWritten = m_compressedWritten;
+    m_blockCompressionLevel = -1;
+}
+
+
 void BinaryOutput::commit(bool flush) {
     debugAssertM(! m_committed, "Cannot commit twice");
     m_committed = true;
     debugAssertM(m_beginEndBits == 0, "Missing endBits before commit");
 
+    if (m_blockCompressionLevel >= 0) {
+        finishBlockCompression();
+    }
+
     if (m_filename == "<memory>") {
         return;
     }
@@ -375,6 +541,10 @@ void BinaryOutput::commit(
     debugAssertM(! m_committed, "Cannot commit twice");
     m_committed = true;
 
+    if (m_blockCompressionLevel >= 0) {
+        finishBlockCompression();
+    }
+
     System::memcpy(out, m_buffer, m_bufferLen);
 }
 
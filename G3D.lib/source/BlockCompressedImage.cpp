@@ -0,0 +1,1492 @@
+/**
+  \file G3D.lib/source/BlockCompressedImage.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#include "G3D/BlockCompressedImage.h"
+#include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/ImageConvert.h"
+#include "G3D/Image.h"
+#include "G3D/BinaryInput.h"
+#include "G3D/BinaryOutput.h"
+#include "G3D/FileSystem.h"
+#include "G3D/ParseError.h"
+#include "G3D/System.h"
+#include "G3D/Log.h"
+#include "G3D/units.h"
+#include <immintrin.h>
+
+namespace G3D {
+
+BlockCompressedImage::Settings::Settings(const Any& any) {
+    *this = Settings();
+    if (any.type() == Any::STRING) {
+        format = ImageFormat::fromString(any.string());
+    } else {
+        any.verifyName("BlockCompressedImage::Settings");
+        AnyTableReader r(any);
+        String f;
+        if (r.getIfPresent("format", f)) {
+            format = ImageFormat::fromString(f);
+        }
+        r.getIfPresent("quality",         quality);
+        r.getIfPresent("generateMipMaps", generateMipMaps);
+        r.verifyDone();
+    }
+    any.verify(supportsFormat(format), "Unsupported block compression format");
+}
+
+
+Any BlockCompressedImage::Settings::toAny() const {
+    Any a(Any::TABLE, "BlockCompressedImage::Settings");
+    a["format"]          = format->name();
+    a["quality"]         = quality;
+    a["generateMipMaps"] = generateMipMaps;
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/** The texels of one 4x4 block on [0, 255], channel-major so that the SIMD search can
+    process four or eight texels at once */
+class BlockTexels {
+public:
+    /** Only the first numChannels are compared */
+    int                 numChannels;
+    float               value[4][16];
+
+    /** Texels with zero weight do not contribute to the error or the endpoint fit, e.g.,
+        transparent texels of a BC1 block */
+    float               weight[16];
+};
+
+
+/** Colors that the texels of a block may be assigned */
+class Palette {
+public:
+    int                 size;
+    float               color[16][4];
+};
+
+
+/** Stores the index of the nearest palette color to each texel and returns the total
+    weighted squared error */
+static float selectIndicesSSE(const BlockTexels& t, const Palette& p, uint8* index) {
+    __m128 total = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        __m128 best = _mm_set1_ps(finf());
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int k = 0; k < p.size; ++k) {
+            __m128 d = _mm_setzero_ps();
+            for (int c = 0; c < t.numChannels; ++c) {
+                const __m128 delta = _mm_sub_ps(_mm_loadu_ps(t.value[c] + i), _mm_set1_ps(p.color[k][c]));
+                d = _mm_add_ps(d, _mm_mul_ps(delta, delta));
+            }
+            const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(k)));
+        }
+        total = _mm_add_ps(total, _mm_mul_ps(best, _mm_loadu_ps(t.weight + i)));
+
+        int32 j[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(j), bestIndex);
+        for (int k = 0; k < 4; ++k) {
+            index[i + k] = uint8(j[k]);
+        }
+    }
+
+    float sum[4];
+    _mm_storeu_ps(sum, total);
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+
+/** AVX version of selectIndicesSSE, which searches eight texels at once */
+G3D_TARGET_AVX static float selectIndicesAVX(const BlockTexels& t, const Palette& p, uint8* index) {
+    __m256 total = _mm256_setzero_ps();
+    for (int i = 0; i < 16; i += 8) {
+        __m256 best = _mm256_set1_ps(finf());
+        __m256 bestIndex = _mm256_setzero_ps();
+        for (int k = 0; k < p.size; ++k) {
+            __m256 d = _mm256_setzero_ps();
+            for (int c = 0; c < t.numChannels; ++c) {
+                const __m256 delta = _mm256_sub_ps(_mm256_loadu_ps(t.value[c] + i), _mm256_set1_ps(p.color[k][c]));
+                d = _mm256_add_ps(d, _mm256_mul_ps(delta, delta));
+            }
+            const __m256 closer = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+            best = _mm256_min_ps(d, best);
+            bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(float(k)), closer);
+        }
+        total = _mm256_add_ps(total, _mm256_mul_ps(best, _mm256_loadu_ps(t.weight + i)));
+
+        int32 j[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(j), _mm256_cvttps_epi32(bestIndex));
+        for (int k = 0; k < 8; ++k) {
+            index[i + k] = uint8(j[k]);
+        }
+    }
+
+    float sum[8];
+    _mm256_storeu_ps(sum, total);
+    return ((sum[0] + sum[1]) + (sum[2] + sum[3])) + ((sum[4] + sum[5]) + (sum[6] + sum[7]));
+}
+
+
+/** Least-squares endpoints of the line through the texels for fixed indices, where palette
+    color k is (1 - alpha[k]) * e0 + alpha[k] * e1. Returns false if all texels use the same
+    interpolation weight. */
+static bool refineEndpoints(const BlockTexels& t, const uint8* index, const float* alpha, float* e0, float* e1) {
+    float A = 0, B = 0, C = 0;
+    float X[4] = {0, 0, 0, 0}, Y[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        const float w = t.weight[i];
+        const float b = alpha[index[i]];
+        const float a = 1.0f - b;
+        A += w * a * a;
+        B += w * a * b;
+        C += w * b * b;
+        for (int c = 0; c < t.numChannels; ++c) {
+            X[c] += w * a * t.value[c][i];
+            Y[c] += w * b * t.value[c][i];
+        }
+    }
+
+    const float det = A * C - B * B;
+    if (abs(det) < 1e-6f) {
+        return false;
+    }
+
+    for (int c = 0; c < t.numChannels; ++c) {
+        e0[c] = clamp((C * X[c] - B * Y[c]) / det, 0.0f, 255.0f);
+        e1[c] = clamp((A * Y[c] - B * X[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+
+class BlockEncoder {
+public:
+    CompressionQuality  quality;
+    bool                useAVX;
+
+    /** Number of least-squares refinement passes */
+    int                 refinements;
+
+    BlockEncoder(CompressionQuality quality) :
+        quality(quality),
+        useAVX(System::hasAVX()),
+        refinements((quality == CompressionQuality::FAST) ? 0 : (quality == CompressionQuality::NORMAL) ? 1 : 4) {}
+
+    float selectIndices(const BlockTexels& t, const Palette& p, uint8* index) const {
+        return useAVX ? selectIndicesAVX(t, p, index) : selectIndicesSSE(t, p, index);
+    }
+
+    /** Endpoints of a line through the weighted texels */
+    void fitLine(const BlockTexels& t, float* e0, float* e1) const;
+
+    float evaluateBC1(const BlockTexels& t, bool threeColor, uint16& c0, uint16& c1, uint8* index) const;
+    void encodeBC1(const BlockTexels& t, bool allowTransparent, uint8* out) const;
+
+    float evaluateBC4(const BlockTexels& t, int a0, int a1, uint8* index) const;
+    void encodeBC4(const BlockTexels& t, uint8* out) const;
+
+    float evaluateBC7(const BlockTexels& t, const int* q0, const int* q1, int p0, int p1, uint8* index) const;
+    void encodeBC7(const BlockTexels& t, uint8* out) const;
+};
+
+
+void BlockEncoder::fitLine(const BlockTexels& t, float* e0, float* e1) const {
+    const int n = t.numChannels;
+    float mean[4] = {0, 0, 0, 0}, lo[4], hi[4];
+    float totalWeight = 0.0f;
+    for (int c = 0; c < n; ++c) {
+        lo[c] = 255.0f;
+        hi[c] = 0.0f;
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (t.weight[i] > 0.0f) {
+            totalWeight += t.weight[i];
+            for (int c = 0; c < n; ++c) {
+                mean[c] += t.weight[i] * t.value[c][i];
+                lo[c] = min(lo[c], t.value[c][i]);
+                hi[c] = max(hi[c], t.value[c][i]);
+            }
+        }
+    }
+    if (totalWeight == 0.0f) {
+        for (int c = 0; c < n; ++c) {
+            e0[c] = e1[c] = 0.0f;
+        }
+        return;
+    }
+
+    float cov[4][4];
+    for (int c = 0; c < n; ++c) {
+        mean[c] /= totalWeight;
+        for (int d = 0; d < n; ++d) {
+            cov[c][d] = 0.0f;
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < n; ++c) {
+            const float u = t.value[c][i] - mean[c];
+            for (int d = c; d < n; ++d) {
+                cov[c][d] += t.weight[i] * u * (t.value[d][i] - mean[d]);
+            }
+        }
+    }
+    for (int c = 0; c < n; ++c) {
+        for (int d = 0; d < c; ++d) {
+            cov[c][d] = cov[d][c];
+        }
+    }
+
+    if (quality == CompressionQuality::FAST) {
+        // Bounding box diagonal, flipping each channel that decreases along the channel with
+        // the largest range, inset so that the extreme texels round to the endpoints
+        int major = 0;
+        for (int c = 1; c < n; ++c) {
+            if (hi[c] - lo[c] > hi[major] - lo[major]) {
+                major = c;
+            }
+        }
+        for (int c = 0; c < n; ++c) {
+            const float inset = (hi[c] - lo[c]) / 16.0f;
+            e0[c] = lo[c] + inset;
+            e1[c] = hi[c] - inset;
+            if (cov[major][c] < 0.0f) {
+                std::swap(e0[c], e1[c]);
+            }
+        }
+        return;
+    }
+
+    // Principal axis by power iteration, starting from the bounding box diagonal
+    float axis[4];
+    for (int c = 0; c < n; ++c) {
+        axis[c] = hi[c] - lo[c];
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[4];
+        float length2 = 0.0f;
+        for (int c = 0; c < n; ++c) {
+            next[c] = 0.0f;
+            for (int d = 0; d < n; ++d) {
+                next[c] += cov[c][d] * axis[d];
+            }
+            length2 += square(next[c]);
+        }
+        if (length2 < 1e-12f) {
+            break;
+        }
+        const float s = 1.0f / sqrt(length2);
+        for (int c = 0; c < n; ++c) {
+            axis[c] = next[c] * s;
+        }
+    }
+
+    float length2 = 0.0f;
+    for (int c = 0; c < n; ++c) {
+        length2 += square(axis[c]);
+    }
+    if (length2 < 1e-12f) {
+        // All texels are the same color
+        for (int c = 0; c < n; ++c) {
+            e0[c] = e1[c] = mean[c];
+        }
+        return;
+    }
+    for (int c = 0; c < n; ++c) {
+        axis[c] /= sqrt(length2);
+    }
+
+    float tMin = finf(), tMax = -finf();
+    for (int i = 0; i < 16; ++i) {
+        if (t.weight[i] > 0.0f) {
+            float s = 0.0f;
+            for (int c = 0; c < n; ++c) {
+                s += (t.value[c][i] - mean[c]) * axis[c];
+            }
+            tMin = min(tMin, s);
+            tMax = max(tMax, s);
+        }
+    }
+    for (int c = 0; c < n; ++c) {
+        e0[c] = clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+        e1[c] = clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BC1
+
+static uint16 toRGB565(const float* c) {
+    const int r = iClamp(iRound(c[0] * (31.0f / 255.0f)), 0, 31);
+    const int g = iClamp(iRound(c[1] * (63.0f / 255.0f)), 0, 63);
+    const int b = iClamp(iRound(c[2] * (31.0f / 255.0f)), 0, 31);
+    return uint16((r << 11) | (g << 5) | b);
+}
+
+
+static void fromRGB565(uint16 c, int* rgb) {
+    const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+
+/** The colors of a BC1 block. Four-color blocks have c0 > c1 and three-color blocks, whose
+    fourth index is transparent black, have c0 <= c1. */
+static int bc1Palette(uint16 c0, uint16 c1, bool alwaysFourColor, int palette[4][4]) {
+    int a[3], b[3];
+    fromRGB565(c0, a);
+    fromRGB565(c1, b);
+    for (int c = 0; c < 3; ++c) {
+        palette[0][c] = a[c];
+        palette[1][c] = b[c];
+        if ((c0 > c1) || alwaysFourColor) {
+            palette[2][c] = (2 * a[c] + b[c]) / 3;
+            palette[3][c] = (a[c] + 2 * b[c]) / 3;
+        } else {
+            palette[2][c] = (a[c] + b[c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (int k = 0; k < 4; ++k) {
+        palette[k][3] = 255;
+    }
+    if ((c0 <= c1) && ! alwaysFourColor) {
+        palette[3][3] = 0;
+        return 3;
+    }
+    return 4;
+}
+
+
+/** Orders the endpoints for the mode and returns the error of the best indices */
+float BlockEncoder::evaluateBC1(const BlockTexels& t, bool threeColor, uint16& c0, uint16& c1, uint8* index) const {
+    if (threeColor ? (c0 > c1) : (c0 < c1)) {
+        std::swap(c0, c1);
+    }
+
+    int color[4][4];
+    Palette p;
+    p.size = bc1Palette(c0, c1, ! threeColor, color);
+    if (! threeColor && (c0 == c1)) {
+        // Degenerate line; only index 0 is needed
+        p.size = 1;
+    }
+    for (int k = 0; k < p.size; ++k) {
+        for (int c = 0; c < 3; ++c) {
+            p.color[k][c] = float(color[k][c]);
+        }
+    }
+
+    const float error = selectIndices(t, p, index);
+    if (threeColor) {
+        for (int i = 0; i < 16; ++i) {
+            if (t.weight[i] == 0.0f) {
+                index[i] = 3;
+            }
+        }
+    }
+    return error;
+}
+
+
+static void writeBC1(uint16 c0, uint16 c1, const uint8* index, uint8* out) {
+    out[0] = uint8(c0 & 0xFF);
+    out[1] = uint8(c0 >> 8);
+    out[2] = uint8(c1 & 0xFF);
+    out[3] = uint8(c1 >> 8);
+    uint32 bits = 0;
+    for (int i = 0; i < 16; ++i) {
+        bits |= uint32(index[i]) << (2 * i);
+    }
+    for (int j = 0; j < 4; ++j) {
+        out[4 + j] = uint8(bits >> (8 * j));
+    }
+}
+
+
+void BlockEncoder::encodeBC1(const BlockTexels& source, bool allowTransparent, uint8* out) const {
+    BlockTexels t = source;
+    t.numChannels = 3;
+
+    bool threeColor = false;
+    if (allowTransparent) {
+        for (int i = 0; i < 16; ++i) {
+            if (t.value[3][i] < 128.0f) {
+                t.weight[i] = 0.0f;
+                threeColor = true;
+            }
+        }
+    }
+
+    float e0[4], e1[4];
+    fitLine(t, e0, e1);
+
+    uint16 c0 = toRGB565(e0), c1 = toRGB565(e1);
+    uint8 index[16];
+    float error = evaluateBC1(t, threeColor, c0, c1, index);
+
+    static const float alpha4[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    static const float alpha3[4] = {0.0f, 1.0f, 0.5f, 0.0f};
+    for (int r = 0; (r < refinements) && (error > 0.0f); ++r) {
+        if (! refineEndpoints(t, index, threeColor ? alpha3 : alpha4, e0, e1)) {
+            break;
+        }
+        uint16 d0 = toRGB565(e0), d1 = toRGB565(e1);
+        uint8 candidate[16];
+        const float e = evaluateBC1(t, threeColor, d0, d1, candidate);
+        if (e >= error) {
+            break;
+        }
+        error = e;
+        c0 = d0;
+        c1 = d1;
+        System::memcpy(index, candidate, sizeof(index));
+    }
+
+    if (quality == CompressionQuality::BEST) {
+        // Move each 565 component of each endpoint by one step while that reduces the error
+        static const int shift[3] = {11, 5, 0};
+        static const int maxValue[3] = {31, 63, 31};
+        bool improved = true;
+        for (int pass = 0; improved && (pass < 4) && (error > 0.0f); ++pass) {
+            improved = false;
+            for (int e = 0; e < 2; ++e) {
+                for (int c = 0; c < 3; ++c) {
+                    for (int step = -1; step <= 1; step += 2) {
+                        uint16 d[2] = {c0, c1};
+                        const int v = ((d[e] >> shift[c]) & maxValue[c]) + step;
+                        if ((v < 0) || (v > maxValue[c])) {
+                            continue;
+                        }
+                        d[e] = uint16((d[e] & ~(maxValue[c] << shift[c])) | (v << shift[c]));
+                        uint8 candidate[16];
+                        const float err = evaluateBC1(t, threeColor, d[0], d[1], candidate);
+                        if (err < error) {
+                            error = err;
+                            c0 = d[0];
+                            c1 = d[1];
+                            System::memcpy(index, candidate, sizeof(index));
+                            improved = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    writeBC1(c0, c1, index, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BC4 (also the alpha block of BC3)
+
+/** Eight values when a0 > a1; otherwise six and the constants 0 and 255 */
+static void bc4Palette(int a0, int a1, int* palette) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int k = 2; k < 8; ++k) {
+            palette[k] = ((8 - k) * a0 + (k - 1) * a1 + 3) / 7;
+        }
+    } else {
+        for (int k = 2; k < 6; ++k) {
+            palette[k] = ((6 - k) * a0 + (k - 1) * a1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+
+float BlockEncoder::evaluateBC4(const BlockTexels& t, int a0, int a1, uint8* index) const {
+    int value[8];
+    bc4Palette(a0, a1, value);
+    Palette p;
+    p.size = 8;
+    for (int k = 0; k < 8; ++k) {
+        p.color[k][0] = float(value[k]);
+    }
+    return selectIndices(t, p, index);
+}
+
+
+void BlockEncoder::encodeBC4(const BlockTexels& t, uint8* out) const {
+    debugAssert(t.numChannels == 1);
+
+    float lo = 255.0f, hi = 0.0f, innerLo = 255.0f, innerHi = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        const float v = t.value[0][i];
+        lo = min(lo, v);
+        hi = max(hi, v);
+        if ((v > 0.0f) && (v < 255.0f)) {
+            innerLo = min(innerLo, v);
+            innerHi = max(innerHi, v);
+        }
+    }
+
+    // Eight-value mode spanning the range
+    int a0 = iRound(hi), a1 = iRound(lo);
+    uint8 index[16];
+    float error = evaluateBC4(t, a0, a1, index);
+
+    if (quality != CompressionQuality::FAST) {
+        static const float alpha8[8] = {0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f};
+        for (int r = 0; (r < refinements) && (error > 0.0f) && (a0 > a1); ++r) {
+            float e0, e1;
+            if (! refineEndpoints(t, index, alpha8, &e0, &e1)) {
+                break;
+            }
+            int b0 = iRound(e0), b1 = iRound(e1);
+            if (b0 < b1) {
+                std::swap(b0, b1);
+            }
+            if (b0 == b1) {
+                break;
+            }
+            uint8 candidate[16];
+            const float e = evaluateBC4(t, b0, b1, candidate);
+            if (e >= error) {
+                break;
+            }
+            error = e;
+            a0 = b0;
+            a1 = b1;
+            System::memcpy(index, candidate, sizeof(index));
+        }
+
+        // Six-value mode over the texels that are not exactly 0 or 255
+        if ((error > 0.0f) && (innerLo <= innerHi)) {
+            const int b0 = iRound(innerLo), b1 = iRound(innerHi);
+            uint8 candidate[16];
+            const float e = evaluateBC4(t, b0, b1, candidate);
+            if (e < error) {
+                error = e;
+                a0 = b0;
+                a1 = b1;
+                System::memcpy(index, candidate, sizeof(index));
+            }
+        }
+    }
+
+    if (quality == CompressionQuality::BEST) {
+        // Move each endpoint by one step while that reduces the error and keeps the mode
+        const bool eightValues = (a0 > a1);
+        bool improved = true;
+        for (int pass = 0; improved && (pass < 8) && (error > 0.0f); ++pass) {
+            improved = false;
+            for (int e = 0; e < 2; ++e) {
+                for (int step = -1; step <= 1; step += 2) {
+                    int b[2] = {a0, a1};
+                    b[e] += step;
+                    if ((b[e] < 0) || (b[e] > 255) || ((b[0] > b[1]) != eightValues)) {
+                        continue;
+                    }
+                    uint8 candidate[16];
+                    const float err = evaluateBC4(t, b[0], b[1], candidate);
+                    if (err < error) {
+                        error = err;
+                        a0 = b[0];
+                        a1 = b[1];
+                        System::memcpy(index, candidate, sizeof(index));
+                        improved = true;
+                    }
+                }
+            }
+        }
+    }
+
+    out[0] = uint8(a0);
+    out[1] = uint8(a1);
+    uint64 bits = 0;
+    for (int i = 0; i < 16; ++i) {
+        bits |= uint64(index[i]) << (3 * i);
+    }
+    for (int j = 0; j < 6; ++j) {
+        out[2 + j] = uint8(bits >> (8 * j));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BC7 mode 6
+
+static const int bc7Weight4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/** Little-endian bit stream within one 128-bit block */
+class BitWriter {
+public:
+    uint8*  out;
+    int     position;
+
+    BitWriter(uint8* out) : out(out), position(0) {
+        System::memset(out, 0, 16);
+    }
+
+    void write(uint32 value, int numBits) {
+        for (int b = 0; b < numBits; ++b, ++position) {
+            out[position >> 3] |= uint8(((value >> b) & 1) << (position & 7));
+        }
+    }
+};
+
+
+class BitReader {
+public:
+    const uint8*    in;
+    int             position;
+
+    BitReader(const uint8* in) : in(in), position(0) {}
+
+    uint32 read(int numBits) {
+        uint32 value = 0;
+        for (int b = 0; b < numBits; ++b, ++position) {
+            value |= uint32((in[position >> 3] >> (position & 7)) & 1) << b;
+        }
+        return value;
+    }
+};
+
+
+static void bc7Palette(const int* e0, const int* e1, Palette& p) {
+    p.size = 16;
+    for (int k = 0; k < 16; ++k) {
+        const int w = bc7Weight4[k];
+        for (int c = 0; c < 4; ++c) {
+            p.color[k][c] = float(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+        }
+    }
+}
+
+
+float BlockEncoder::evaluateBC7(const BlockTexels& t, const int* q0, const int* q1, int p0, int p1, uint8* index) const {
+    int e0[4], e1[4];
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = (q0[c] << 1) | p0;
+        e1[c] = (q1[c] << 1) | p1;
+    }
+    Palette p;
+    bc7Palette(e0, e1, p);
+    return selectIndices(t, p, index);
+}
+
+
+/** Seven-bit endpoint for parity bit \a p */
+static void quantizeBC7(const float* e, int p, int* q) {
+    for (int c = 0; c < 4; ++c) {
+        q[c] = iClamp(iRound((e[c] - float(p)) * 0.5f), 0, 127);
+    }
+}
+
+
+void BlockEncoder::encodeBC7(const BlockTexels& t, uint8* out) const {
+    debugAssert(t.numChannels == 4);
+
+    float e0[4], e1[4];
+    fitLine(t, e0, e1);
+
+    int q0[4], q1[4], p0 = 0, p1 = 0;
+    uint8 index[16];
+    float error = finf();
+
+    // Chooses the parity bits and quantized endpoints for the line (e0, e1)
+    const auto quantize = [&](const float* e0, const float* e1) {
+        for (int pair = 0; pair < 4; ++pair) {
+            const int a = pair & 1, b = pair >> 1;
+            if (quality == CompressionQuality::FAST) {
+                // Only the parity that best represents the unquantized endpoints
+                float errorA[2] = {0, 0}, errorB[2] = {0, 0};
+                for (int p = 0; p < 2; ++p) {
+                    int qa[4], qb[4];
+                    quantizeBC7(e0, p, qa);
+                    quantizeBC7(e1, p, qb);
+                    for (int c = 0; c < 4; ++c) {
+                        errorA[p] += square(e0[c] - float((qa[c] << 1) | p));
+                        errorB[p] += square(e1[c] - float((qb[c] << 1) | p));
+                    }
+                }
+                if ((a != int(errorA[1] < errorA[0])) || (b != int(errorB[1] < errorB[0]))) {
+                    continue;
+                }
+            }
+            int r0[4], r1[4];
+            quantizeBC7(e0, a, r0);
+            quantizeBC7(e1, b, r1);
+            uint8 candidate[16];
+            const float err = evaluateBC7(t, r0, r1, a, b, candidate);
+            if (err < error) {
+                error = err;
+                System::memcpy(q0, r0, sizeof(q0));
+                System::memcpy(q1, r1, sizeof(q1));
+                p0 = a;
+                p1 = b;
+                System::memcpy(index, candidate, sizeof(index));
+            }
+        }
+    };
+
+    quantize(e0, e1);
+
+    float alpha16[16];
+    for (int k = 0; k < 16; ++k) {
+        alpha16[k] = float(bc7Weight4[k]) / 64.0f;
+    }
+    for (int r = 0; (r < refinements) && (error > 0.0f); ++r) {
+        const float previous = error;
+        if (! refineEndpoints(t, index, alpha16, e0, e1)) {
+            break;
+        }
+        quantize(e0, e1);
+        if (error >= previous) {
+            break;
+        }
+    }
+
+    if (quality == CompressionQuality::BEST) {
+        bool improved = true;
+        for (int pass = 0; improved && (pass < 4) && (error > 0.0f); ++pass) {
+            improved = false;
+            for (int e = 0; e < 2; ++e) {
+                for (int c = 0; c < 4; ++c) {
+                    for (int step = -1; step <= 1; step += 2) {
+                        int r0[4], r1[4];
+                        System::memcpy(r0, q0, sizeof(r0));
+                        System::memcpy(r1, q1, sizeof(r1));
+                        int& v = (e == 0) ? r0[c] : r1[c];
+                        v += step;
+                        if ((v < 0) || (v > 127)) {
+                            continue;
+                        }
+                        uint8 candidate[16];
+                        const float err = evaluateBC7(t, r0, r1, p0, p1, candidate);
+                        if (err < error) {
+                            error = err;
+                            System::memcpy(q0, r0, sizeof(q0));
+                            System::memcpy(q1, r1, sizeof(q1));
+                            System::memcpy(index, candidate, sizeof(index));
+                            improved = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // The first texel's index has an implicit zero high bit
+    if (index[0] >= 8) {
+        for (int c = 0; c < 4; ++c) {
+            std::swap(q0[c], q1[c]);
+        }
+        std::swap(p0, p1);
+        for (int i = 0; i < 16; ++i) {
+            index[i] = uint8(15 - index[i]);
+        }
+    }
+
+    BitWriter w(out);
+    w.write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        w.write(q0[c], 7);
+        w.write(q1[c], 7);
+    }
+    w.write(p0, 1);
+    w.write(p1, 1);
+    w.write(index[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        w.write(index[i], 4);
+    }
+    debugAssert(w.position == 128);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Decoders
+
+/** Writes the texels of one 4x4 block at (x, y), clipped to the image */
+static void storeBlock(const uint8 texel[16][4], int x, int y, int width, int height, uint8* rgba) {
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            if ((x + i < width) && (y + j < height)) {
+                System::memcpy(rgba + 4 * ((x + i) + (y + j) * width), texel[i + 4 * j], 4);
+            }
+        }
+    }
+}
+
+
+static void decodeBC1(const uint8* in, bool alwaysFourColor, uint8 texel[16][4]) {
+    const uint16 c0 = uint16(in[0] | (in[1] << 8));
+    const uint16 c1 = uint16(in[2] | (in[3] << 8));
+    int palette[4][4];
+    bc1Palette(c0, c1, alwaysFourColor, palette);
+    const uint32 bits = uint32(in[4]) | (uint32(in[5]) << 8) | (uint32(in[6]) << 16) | (uint32(in[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        const int k = (bits >> (2 * i)) & 3;
+        for (int c = 0; c < 4; ++c) {
+            texel[i][c] = uint8(palette[k][c]);
+        }
+    }
+}
+
+
+static void decodeBC4(const uint8* in, int channel, uint8 texel[16][4]) {
+    int palette[8];
+    bc4Palette(in[0], in[1], palette);
+    uint64 bits = 0;
+    for (int j = 0; j < 6; ++j) {
+        bits |= uint64(in[2 + j]) << (8 * j);
+    }
+    for (int i = 0; i < 16; ++i) {
+        texel[i][channel] = uint8(palette[(bits >> (3 * i)) & 7]);
+    }
+}
+
+
+static void decodeBC7(const uint8* in, uint8 texel[16][4]) {
+    BitReader r(in);
+    if (r.read(7) != (1 << 6)) {
+        System::memset(texel, 0, 16 * 4);
+        for (int i = 0; i < 16; ++i) {
+            texel[i][3] = 255;
+        }
+        return;
+    }
+
+    int e0[4], e1[4];
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = r.read(7) << 1;
+        e1[c] = r.read(7) << 1;
+    }
+    const int p0 = r.read(1), p1 = r.read(1);
+    for (int c = 0; c < 4; ++c) {
+        e0[c] |= p0;
+        e1[c] |= p1;
+    }
+
+    Palette p;
+    bc7Palette(e0, e1, p);
+    for (int i = 0; i < 16; ++i) {
+        const int k = r.read((i == 0) ? 3 : 4);
+        for (int c = 0; c < 4; ++c) {
+            texel[i][c] = uint8(p.color[k][c]);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool isBC1(const ImageFormat* f) {
+    return (f == ImageFormat::RGB_DXT1()) || (f == ImageFormat::RGBA_DXT1()) ||
+        (f == ImageFormat::SRGB_DXT1()) || (f == ImageFormat::SRGBA_DXT1());
+}
+
+static bool isBC2(const ImageFormat* f) {
+    return (f == ImageFormat::RGBA_DXT3()) || (f == ImageFormat::SRGBA_DXT3());
+}
+
+static bool isBC3(const ImageFormat* f) {
+    return (f == ImageFormat::RGBA_DXT5()) || (f == ImageFormat::SRGBA_DXT5());
+}
+
+static bool isBC7(const ImageFormat* f) {
+    return (f == ImageFormat::RGBA_BC7()) || (f == ImageFormat::SRGBA_BC7());
+}
+
+
+/** Channels that the format stores, for PSNR */
+static int numStoredChannels(const ImageFormat* f) {
+    if (f == ImageFormat::R_BC4()) {
+        return 1;
+    } else if (f == ImageFormat::RG_BC5()) {
+        return 2;
+    } else if ((f == ImageFormat::RGB_DXT1()) || (f == ImageFormat::SRGB_DXT1())) {
+        return 3;
+    } else {
+        return 4;
+    }
+}
+
+
+/** Gathers the 4x4 block at (x, y) into \a t, replicating the last row and column of the image
+    into blocks that extend past it */
+static void loadBlock(const uint8* rgba, int width, int height, int x, int y, BlockTexels& t) {
+    for (int j = 0; j < 4; ++j) {
+        const int yy = min(y + j, height - 1);
+        for (int i = 0; i < 4; ++i) {
+            const uint8* src = rgba + 4 * (min(x + i, width - 1) + yy * width);
+            for (int c = 0; c < 4; ++c) {
+                t.value[c][i + 4 * j] = float(src[c]);
+            }
+            t.weight[i + 4 * j] = 1.0f;
+        }
+    }
+    t.numChannels = 4;
+}
+
+
+static void encodeBlock(const BlockEncoder& encoder, const ImageFormat* format, const BlockTexels& t, uint8* out) {
+    if (isBC1(format)) {
+        encoder.encodeBC1(t, ! format->opaque, out);
+    } else if (isBC2(format)) {
+        // Explicit four-bit alpha
+        uint64 bits = 0;
+        for (int i = 0; i < 16; ++i) {
+            bits |= uint64(iRound(t.value[3][i] * (15.0f / 255.0f))) << (4 * i);
+        }
+        for (int j = 0; j < 8; ++j) {
+            out[j] = uint8(bits >> (8 * j));
+        }
+        encoder.encodeBC1(t, false, out + 8);
+    } else if (isBC7(format)) {
+        encoder.encodeBC7(t, out);
+    } else {
+        // One BC4 block per channel: alpha for BC3, red and green for BC5
+        const bool bc3 = isBC3(format);
+        const int numBlocks = (format == ImageFormat::RG_BC5()) ? 2 : 1;
+        for (int b = 0; b < numBlocks; ++b) {
+            BlockTexels channel;
+            channel.numChannels = 1;
+            System::memcpy(channel.value[0], t.value[bc3 ? 3 : b], sizeof(channel.value[0]));
+            System::memcpy(channel.weight, t.weight, sizeof(channel.weight));
+            encoder.encodeBC4(channel, out + 8 * b);
+        }
+        if (bc3) {
+            encoder.encodeBC1(t, false, out + 8);
+        }
+    }
+}
+
+
+static void decodeBlock(const ImageFormat* format, const uint8* in, uint8 texel[16][4]) {
+    if (isBC1(format)) {
+        decodeBC1(in, false, texel);
+    } else if (isBC2(format)) {
+        decodeBC1(in + 8, true, texel);
+        for (int i = 0; i < 16; ++i) {
+            texel[i][3] = uint8(((in[i / 2] >> (4 * (i & 1))) & 15) * 17);
+        }
+    } else if (isBC3(format)) {
+        decodeBC1(in + 8, true, texel);
+        decodeBC4(in, 3, texel);
+    } else if (isBC7(format)) {
+        decodeBC7(in, texel);
+    } else {
+        System::memset(texel, 0, 16 * 4);
+        for (int i = 0; i < 16; ++i) {
+            texel[i][3] = 255;
+        }
+        decodeBC4(in, 0, texel);
+        if (format == ImageFormat::RG_BC5()) {
+            decodeBC4(in + 8, 1, texel);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class SRGBTable {
+public:
+    float       toLinear[256];
+
+    /** Indexed by linear value * (SIZE - 1) */
+    enum {SIZE = 4096};
+    uint8       fromLinear[SIZE];
+
+    SRGBTable() {
+        for (int i = 0; i < 256; ++i) {
+            const float s = float(i) / 255.0f;
+            toLinear[i] = (s <= 0.04045f) ? (s / 12.92f) : ::powf((s + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < SIZE; ++i) {
+            const float v = float(i) / float(SIZE - 1);
+            const float s = (v <= 0.0031308f) ? (v * 12.92f) : (1.055f * ::powf(v, 1.0f / 2.4f) - 0.055f);
+            fromLinear[i] = uint8(iClamp(iRound(s * 255.0f), 0, 255));
+        }
+    }
+};
+
+
+/** Halves an RGBA8 image with a 2x2 box filter, averaging color in linear space if \a srgb */
+static void downsample(const Array<uint8>& src, int width, int height, bool srgb, Array<uint8>& dst) {
+    static const SRGBTable table;
+    const int w = max(1, width / 2), h = max(1, height / 2);
+    dst.resize(w * h * 4);
+    tbb::parallel_for(tbb::blocked_range<int>(0, h, 16), [&](const tbb::blocked_range<int>& r) {
+        for (int y = r.begin(); y < r.end(); ++y) {
+            const int y0 = min(2 * y, height - 1), y1 = min(2 * y + 1, height - 1);
+            for (int x = 0; x < w; ++x) {
+                const int x0 = min(2 * x, width - 1), x1 = min(2 * x + 1, width - 1);
+                const uint8* s[4] = {&src[4 * (x0 + y0 * width)], &src[4 * (x1 + y0 * width)], &src[4 * (x0 + y1 * width)], &src[4 * (x1 + y1 * width)]};
+                uint8* d = &dst[4 * (x + y * w)];
+                for (int c = 0; c < 4; ++c) {
+                    if (srgb && (c < 3)) {
+                        const float v = 0.25f * (table.toLinear[s[0][c]] + table.toLinear[s[1][c]] + table.toLinear[s[2][c]] + table.toLinear[s[3][c]]);
+                        d[c] = table.fromLinear[iRound(v * float(SRGBTable::SIZE - 1))];
+                    } else {
+                        d[c] = uint8((s[0][c] + s[1][c] + s[2][c] + s[3][c] + 2) / 4);
+                    }
+                }
+            }
+        }
+    });
+}
+
+
+/** Copies \a src into a tightly packed RGBA8 array */
+static void toRGBA8(const shared_ptr<PixelTransferBuffer>& src, Array<uint8>& rgba) {
+    const ImageFormat* f = src->format();
+    const bool srgb = (f->colorSpace == ImageFormat::COLOR_SPACE_SRGB);
+    int numChannels = 0;
+    bool bgr = false, luminance = false;
+    if ((f == ImageFormat::RGBA8()) || (f == ImageFormat::SRGBA8())) {
+        numChannels = 4;
+    } else if ((f == ImageFormat::RGB8()) || (f == ImageFormat::SRGB8())) {
+        numChannels = 3;
+    } else if (f == ImageFormat::BGRA8()) {
+        numChannels = 4;
+        bgr = true;
+    } else if (f == ImageFormat::BGR8()) {
+        numChannels = 3;
+        bgr = true;
+    } else if (f == ImageFormat::RG8()) {
+        numChannels = 2;
+    } else if (f == ImageFormat::R8()) {
+        numChannels = 1;
+    } else if ((f == ImageFormat::L8()) || (f == ImageFormat::SL8())) {
+        numChannels = 1;
+        luminance = true;
+    } else if ((f == ImageFormat::LA8()) || (f == ImageFormat::SLA8())) {
+        numChannels = 2;
+        luminance = true;
+    }
+
+    if (numChannels == 0) {
+        const shared_ptr<PixelTransferBuffer>& converted = ImageConvert::convertBuffer(src, srgb ? ImageFormat::SRGBA8() : ImageFormat::RGBA8());
+        if (isNull(converted)) {
+            throw String("BlockCompressedImage cannot convert from ImageFormat ") + f->name();
+        }
+        toRGBA8(converted, rgba);
+        return;
+    }
+
+    const int width = src->width(), height = src->height();
+    rgba.resize(width * height * 4);
+    const uint8* data = static_cast<const uint8*>(src->mapRead());
+    for (int y = 0; y < height; ++y) {
+        const uint8* s = data + y * src->stride();
+        uint8* d = rgba.getCArray() + 4 * width * y;
+        for (int x = 0; x < width; ++x, s += numChannels, d += 4) {
+            if (luminance) {
+                d[0] = d[1] = d[2] = s[0];
+                d[3] = (numChannels == 2) ? s[1] : 255;
+            } else {
+                d[0] = s[bgr ? 2 : 0];
+                d[1] = (numChannels > 1) ? s[1] : 0;
+                d[2] = (numChannels > 2) ? s[bgr ? 0 : 2] : 0;
+                d[3] = (numChannels > 3) ? s[3] : 255;
+            }
+        }
+    }
+    src->unmap();
+}
+
+
+static float computePSNR(const uint8* a, const uint8* b, int numTexels, int numChannels) {
+    double sum = 0.0;
+    for (int i = 0; i < numTexels; ++i) {
+        for (int c = 0; c < numChannels; ++c) {
+            sum += square(double(a[4 * i + c]) - double(b[4 * i + c]));
+        }
+    }
+    if (sum == 0.0) {
+        return finf();
+    }
+    const double mse = sum / (double(numTexels) * numChannels);
+    return float(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////////
+
+bool BlockCompressedImage::supportsFormat(const ImageFormat* format) {
+    return notNull(format) && (isBC1(format) || isBC2(format) || isBC3(format) || isBC7(format) ||
+        (format == ImageFormat::R_BC4()) || (format == ImageFormat::RG_BC5()));
+}
+
+
+size_t BlockCompressedImage::sizeInMemory() const {
+    size_t s = 0;
+    for (int m = 0; m < m_mipLevel.size(); ++m) {
+        s += m_mipLevel[m].data.size();
+    }
+    return s;
+}
+
+
+shared_ptr<BlockCompressedImage> BlockCompressedImage::compress(int width, int height, Array<uint8>& rgba, const Settings& settings) {
+    alwaysAssertM(supportsFormat(settings.format), "Unsupported block compression format");
+    alwaysAssertM((width > 0) && (height > 0), "Cannot compress an empty image");
+
+    const shared_ptr<BlockCompressedImage> result(new BlockCompressedImage());
+    result->m_format = settings.format;
+
+    const BlockEncoder encoder(settings.quality);
+    const int bytesPerBlock = settings.format->cpuBitsPerPixel / 8;
+    const bool srgb = (settings.format->colorSpace == ImageFormat::COLOR_SPACE_SRGB);
+
+    // Level 0 is kept for the PSNR; later levels replace one another
+    Array<uint8> level;
+    const Array<uint8>* src = &rgba;
+    int w = width, h = height;
+    while (true) {
+        MipLevel& mip = result->m_mipLevel.next();
+        mip.width  = w;
+        mip.height = h;
+        const int blocksWide = (w + 3) / 4, blocksHigh = (h + 3) / 4;
+        mip.data.resize(blocksWide * blocksHigh * bytesPerBlock);
+
+        // Each task compresses whole rows of blocks
+        const uint8* pixels = src->getCArray();
+        uint8* out = mip.data.getCArray();
+        tbb::parallel_for(tbb::blocked_range<int>(0, blocksHigh, 1), [&](const tbb::blocked_range<int>& r) {
+            BlockTexels t;
+            for (int by = r.begin(); by < r.end(); ++by) {
+                for (int bx = 0; bx < blocksWide; ++bx) {
+                    loadBlock(pixels, w, h, 4 * bx, 4 * by, t);
+                    encodeBlock(encoder, settings.format, t, out + (bx + by * blocksWide) * bytesPerBlock);
+                }
+            }
+        });
+
+        if (! settings.generateMipMaps || ((w == 1) && (h == 1))) {
+            break;
+        }
+        Array<uint8> next;
+        downsample(*src, w, h, srgb, next);
+        level.swap(next);
+        src = &level;
+        w = max(1, w / 2);
+        h = max(1, h / 2);
+    }
+
+    const shared_ptr<CPUPixelTransferBuffer>& decoded = result->decompress(0);
+    result->m_psnr = computePSNR(rgba.getCArray(), static_cast<const uint8*>(decoded->buffer()), width * height, numStoredChannels(settings.format));
+
+    return result;
+}
+
+
+shared_ptr<BlockCompressedImage> BlockCompressedImage::fromPixelTransferBuffer(const shared_ptr<PixelTransferBuffer>& src, const Settings& settings) {
+    Array<uint8> rgba;
+    toRGBA8(src, rgba);
+    return compress(src->width(), src->height(), rgba, settings);
+}
+
+
+shared_ptr<BlockCompressedImage> BlockCompressedImage::fromImage(const shared_ptr<Image>& src, const Settings& settings) {
+    return fromPixelTransferBuffer(src->toPixelTransferBuffer(), settings);
+}
+
+
+shared_ptr<CPUPixelTransferBuffer> BlockCompressedImage::decompress(int m) const {
+    const MipLevel& mip = m_mipLevel[m];
+    const shared_ptr<CPUPixelTransferBuffer>& result = CPUPixelTransferBuffer::create(mip.width, mip.height, ImageFormat::RGBA8());
+    uint8* rgba = static_cast<uint8*>(result->buffer());
+
+    const int bytesPerBlock = m_format->cpuBitsPerPixel / 8;
+    const int blocksWide = (mip.width + 3) / 4, blocksHigh = (mip.height + 3) / 4;
+    tbb::parallel_for(tbb::blocked_range<int>(0, blocksHigh, 4), [&](const tbb::blocked_range<int>& r) {
+        uint8 texel[16][4];
+        for (int by = r.begin(); by < r.end(); ++by) {
+            for (int bx = 0; bx < blocksWide; ++bx) {
+                decodeBlock(m_format, mip.data.getCArray() + (bx + by * blocksWide) * bytesPerBlock, texel);
+                storeBlock(texel, 4 * bx, 4 * by, mip.width, mip.height, rgba);
+            }
+        }
+    });
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// DDS files. See https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+
+#define G3D_MAKEFOURCC(a, b, c, d) (uint32(uint8(a)) | (uint32(uint8(b)) << 8) | (uint32(uint8(c)) << 16) | (uint32(uint8(d)) << 24))
+
+static const uint32 DDS_MAGIC           = G3D_MAKEFOURCC('D', 'D', 'S', ' ');
+static const uint32 DDS_HEADER_SIZE     = 124;
+static const uint32 DDS_PIXELFORMAT_SIZE = 32;
+
+static const uint32 DDSD_CAPS           = 0x00000001;
+static const uint32 DDSD_HEIGHT         = 0x00000002;
+static const uint32 DDSD_WIDTH          = 0x00000004;
+static const uint32 DDSD_PIXELFORMAT    = 0x00001000;
+static const uint32 DDSD_MIPMAPCOUNT    = 0x00020000;
+static const uint32 DDSD_LINEARSIZE     = 0x00080000;
+
+static const uint32 DDPF_ALPHAPIXELS    = 0x00000001;
+static const uint32 DDPF_FOURCC         = 0x00000004;
+
+static const uint32 DDSCAPS_COMPLEX     = 0x00000008;
+static const uint32 DDSCAPS_TEXTURE     = 0x00001000;
+static const uint32 DDSCAPS_MIPMAP      = 0x00400000;
+static const uint32 DDSCAPS2_CUBEMAP    = 0x00000200;
+static const uint32 DDSCAPS2_VOLUME     = 0x00200000;
+
+static const uint32 DDS_DIMENSION_TEXTURE2D = 3;
+
+/** Marks the PSNR that save() stores in the reserved words of the header */
+static const uint32 PSNR_TAG            = G3D_MAKEFOURCC('G', '3', 'D', 'P');
+static const int    PSNR_TAG_WORD       = 7;
+
+static const struct {
+    const char*     format;
+    uint32          dxgiFormat;
+} dxgiFormatTable[] = {
+    {"RGB_DXT1",   71}, {"RGBA_DXT1",   71}, {"SRGB_DXT1",   72}, {"SRGBA_DXT1", 72},
+    {"RGBA_DXT3",  74}, {"SRGBA_DXT3",  75},
+    {"RGBA_DXT5",  77}, {"SRGBA_DXT5",  78},
+    {"R_BC4",      80}, {"RG_BC5",      83},
+    {"RGBA_BC7",   98}, {"SRGBA_BC7",   99}};
+
+
+static uint32 toDXGIFormat(const ImageFormat* format) {
+    for (int i = 0; i < int(sizeof(dxgiFormatTable) / sizeof(dxgiFormatTable[0])); ++i) {
+        if (format->name() == dxgiFormatTable[i].format) {
+            return dxgiFormatTable[i].dxgiFormat;
+        }
+    }
+    return 0;
+}
+
+
+static const ImageFormat* fromDXGIFormat(uint32 dxgiFormat) {
+    for (int i = 0; i < int(sizeof(dxgiFormatTable) / sizeof(dxgiFormatTable[0])); ++i) {
+        if (dxgiFormatTable[i].dxgiFormat == dxgiFormat) {
+            // BC1 has no alpha flag in the DX10 header, so assume that it may use alpha. The
+            // alpha variant follows the opaque one in the table.
+            return ImageFormat::fromString(dxgiFormatTable[i + (((dxgiFormat == 71) || (dxgiFormat == 72)) ? 1 : 0)].format);
+        }
+    }
+    return NULL;
+}
+
+
+void BlockCompressedImage::save(const String& filename) const {
+    // The DX9 header cannot express sRGB, BC4, BC5, or BC7
+    uint32 fourCC = 0;
+    if ((m_format == ImageFormat::RGB_DXT1()) || (m_format == ImageFormat::RGBA_DXT1())) {
+        fourCC = G3D_MAKEFOURCC('D', 'X', 'T', '1');
+    } else if (m_format == ImageFormat::RGBA_DXT3()) {
+        fourCC = G3D_MAKEFOURCC('D', 'X', 'T', '3');
+    } else if (m_format == ImageFormat::RGBA_DXT5()) {
+        fourCC = G3D_MAKEFOURCC('D', 'X', 'T', '5');
+    }
+    const bool dx10 = (fourCC == 0);
+
+    const String& tempFilename = filename + ".tmp";
+    BinaryOutput b(tempFilename, G3D_LITTLE_ENDIAN);
+    b.writeUInt32(DDS_MAGIC);
+    b.writeUInt32(DDS_HEADER_SIZE);
+    b.writeUInt32(DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | ((numMipLevels() > 1) ? DDSD_MIPMAPCOUNT : 0));
+    b.writeUInt32(height());
+    b.writeUInt32(width());
+    b.writeUInt32(m_mipLevel[0].data.size());
+    b.writeUInt32(0);
+    b.writeUInt32(numMipLevels());
+
+    for (int i = 0; i < 11; ++i) {
+        if ((i == PSNR_TAG_WORD) && ! isNaN(m_psnr)) {
+            b.writeUInt32(PSNR_TAG);
+            b.writeFloat32(m_psnr);
+            ++i;
+        } else {
+            b.writeUInt32(0);
+        }
+    }
+
+    b.writeUInt32(DDS_PIXELFORMAT_SIZE);
+    b.writeUInt32(DDPF_FOURCC | ((m_format == ImageFormat::RGBA_DXT1()) ? DDPF_ALPHAPIXELS : 0));
+    b.writeUInt32(dx10 ? G3D_MAKEFOURCC('D', 'X', '1', '0') : fourCC);
+    for (int i = 0; i < 5; ++i) {
+        // Bit count and masks
+        b.writeUInt32(0);
+    }
+
+    b.writeUInt32(DDSCAPS_TEXTURE | ((numMipLevels() > 1) ? (DDSCAPS_COMPLEX | DDSCAPS_MIPMAP) : 0));
+    for (int i = 0; i < 4; ++i) {
+        // caps2, caps3, caps4, reserved2
+        b.writeUInt32(0);
+    }
+
+    if (dx10) {
+        b.writeUInt32(toDXGIFormat(m_format));
+        b.writeUInt32(DDS_DIMENSION_TEXTURE2D);
+        b.writeUInt32(0);
+        // Array size
+        b.writeUInt32(1);
+        b.writeUInt32(0);
+    }
+
+    for (int m = 0; m < m_mipLevel.size(); ++m) {
+        b.writeBytes(m_mipLevel[m].data.getCArray(), m_mipLevel[m].data.size());
+    }
+    b.commit();
+
+    // Replace any stale file only after the new one is complete, so that a concurrent or
+    // interrupted process never sees a partial file
+    if (FileSystem::exists(filename, false)) {
+        FileSystem::removeFile(filename);
+    }
+    FileSystem::rename(tempFilename, filename);
+}
+
+
+shared_ptr<BlockCompressedImage> BlockCompressedImage::fromDDSFile(const String& filename) {
+    BinaryInput b(filename, G3D_LITTLE_ENDIAN);
+
+    if ((b.size() < 128) || (b.readUInt32() != DDS_MAGIC) || (b.readUInt32() != DDS_HEADER_SIZE)) {
+        throw ParseError(filename, 0, "Not a DDS file");
+    }
+
+    const uint32 flags       = b.readUInt32();
+    const int    height      = int(b.readUInt32());
+    const int    width       = int(b.readUInt32());
+    b.readUInt32();
+    b.readUInt32();
+    const uint32 mipMapCount = b.readUInt32();
+
+    uint32 reserved[11];
+    for (int i = 0; i < 11; ++i) {
+        reserved[i] = b.readUInt32();
+    }
+
+    b.readUInt32();
+    const uint32 pixelFlags = b.readUInt32();
+    const uint32 fourCC     = b.readUInt32();
+    b.skip(5 * 4);
+    b.readUInt32();
+    const uint32 caps2      = b.readUInt32();
+    b.skip(3 * 4);
+
+    if ((caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) != 0) {
+        throw ParseError(filename, b.getPosition(), "DDS cube maps and volumes are not supported");
+    }
+    if ((pixelFlags & DDPF_FOURCC) == 0) {
+        throw ParseError(filename, b.getPosition(), "Uncompressed DDS files are not supported");
+    }
+
+    const ImageFormat* format = NULL;
+    if (fourCC == G3D_MAKEFOURCC('D', 'X', '1', '0')) {
+        const uint32 dxgiFormat = b.readUInt32();
+        const uint32 dimension  = b.readUInt32();
+        b.readUInt32();
+        const uint32 arraySize  = b.readUInt32();
+        b.readUInt32();
+        if ((dimension != DDS_DIMENSION_TEXTURE2D) || (arraySize > 1)) {
+            throw ParseError(filename, b.getPosition(), "Only single 2D DDS textures are supported");
+        }
+        format = fromDXGIFormat(dxgiFormat);
+    } else if (fourCC == G3D_MAKEFOURCC('D', 'X', 'T', '1')) {
+        format = (pixelFlags & DDPF_ALPHAPIXELS) ? ImageFormat::RGBA_DXT1() : ImageFormat::RGB_DXT1();
+    } else if ((fourCC == G3D_MAKEFOURCC('D', 'X', 'T', '3')) || (fourCC == G3D_MAKEFOURCC('D', 'X', 'T', '2'))) {
+        format = ImageFormat::RGBA_DXT3();
+    } else if ((fourCC == G3D_MAKEFOURCC('D', 'X', 'T', '5')) || (fourCC == G3D_MAKEFOURCC('D', 'X', 'T', '4'))) {
+        format = ImageFormat::RGBA_DXT5();
+    } else if ((fourCC == G3D_MAKEFOURCC('A', 'T', 'I', '1')) || (fourCC == G3D_MAKEFOURCC('B', 'C', '4', 'U'))) {
+        format = ImageFormat::R_BC4();
+    } else if ((fourCC == G3D_MAKEFOURCC('A', 'T', 'I', '2')) || (fourCC == G3D_MAKEFOURCC('B', 'C', '5', 'U'))) {
+        format = ImageFormat::RG_BC5();
+    }
+
+    if (isNull(format)) {
+        throw ParseError(filename, b.getPosition(), "Unsupported DDS pixel format");
+    }
+    if ((width <= 0) || (height <= 0)) {
+        throw ParseError(filename, b.getPosition(), "Empty DDS image");
+    }
+
+    const shared_ptr<BlockCompressedImage> result(new BlockCompressedImage());
+    result->m_format = format;
+    if (reserved[PSNR_TAG_WORD] == PSNR_TAG) {
+        System::memcpy(&result->m_psnr, &reserved[PSNR_TAG_WORD + 1], sizeof(float));
+    }
+
+    const int bytesPerBlock = format->cpuBitsPerPixel / 8;
+    const int numLevels = ((flags & DDSD_MIPMAPCOUNT) && (mipMapCount > 0)) ? int(mipMapCount) : 1;
+    int w = width, h = height;
+    for (int m = 0; m < numLevels; ++m) {
+        MipLevel& mip = result->m_mipLevel.next();
+        mip.width  = w;
+        mip.height = h;
+        mip.data.resize(((w + 3) / 4) * ((h + 3) / 4) * bytesPerBlock);
+        if (b.getPosition() + mip.data.size() > b.size()) {
+            throw ParseError(filename, b.getPosition(), "Truncated DDS file");
+        }
+        b.readBytes(mip.data.getCArray(), mip.data.size());
+        w = max(1, w / 2);
+        h = max(1, h / 2);
+    }
+
+    return result;
+}
+
+#undef G3D_MAKEFOURCC
+
+///////////////////////////////////////////////////////////////////////////////////
+
+String BlockCompressedImage::cacheFilename(const String& filename, const Settings& settings) {
+    return FilePath::concat(FilePath::parent(filename),
+        FilePath::base(filename) + "." + settings.format->name() + "." + settings.quality.toString() +
+        (settings.generateMipMaps ? "" : ".nomip") + ".dds");
+}
+
+
+shared_ptr<BlockCompressedImage> BlockCompressedImage::fromFile(const String& filename, const Settings& settings, bool useCache) {
+    if (toLower(FilePath::ext(filename)) == "dds") {
+        return fromDDSFile(filename);
+    }
+
+    const String& cache = cacheFilename(filename, settings);
+    useCache = useCache && ! FileSystem::inZipfile(filename) && (System::machineEndian() == G3D_LITTLE_ENDIAN);
+
+    if (useCache && FileSystem::exists(cache, false) && ! FileSystem::isNewer(filename, cache)) {
+        try {
+            const shared_ptr<BlockCompressedImage>& cached = fromDDSFile(cache);
+            if (cached->format() == settings.format) {
+                return cached;
+            }
+        } catch (...) {
+            // Truncated or corrupt file; compress the source again
+        }
+    }
+
+    const RealTime start = System::time();
+    const shared_ptr<BlockCompressedImage>& result = fromImage(Image::fromFile(filename), settings);
+    logPrintf("BlockCompressedImage: compressed %s to %s in %.0f ms, PSNR %.2f dB\n",
+              filename.c_str(), settings.format->name().c_str(), (System::time() - start) / units::milliseconds(), result->psnr());
+
+    if (useCache) {
+        try {
+            result->save(cache);
+        } catch (...) {
+            // Read-only directory; compress again next time
+            logPrintf("BlockCompressedImage: could not write %s\n", cache.c_str());
+        }
+    }
+
+    return result;
+}
+
+} // namespace G3D
@@ -0,0 +1,127 @@
+/**
+  \file G3D.lib/source/BoundedThreadsafeQueue.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+*/
+#include "G3D/BoundedThreadsafeQueue.h"
+
+#ifdef G3D_LINUX
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   include <climits>
+#   include <ctime>
+#else
+#   include <mutex>
+#   include <condition_variable>
+#   include <chrono>
+#endif
+
+namespace G3D {
+namespace _internal {
+
+#ifdef G3D_LINUX
+
+/** The 32-bit epoch half of m_state, on which threads wait */
+static int* epochWord(std::atomic<uint64>& state) {
+#   if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return reinterpret_cast<int*>(&state) + 1;
+#   else
+        return reinterpret_cast<int*>(&state);
+#   endif
+}
+
+
+EventCount::EventCount() : m_state(0), m_platform(NULL) {}
+
+
+EventCount::~EventCount() {}
+
+
+void EventCount::commitWait(uint32 key, RealTime timeout) {
+    struct timespec t;
+    struct timespec* tp = NULL;
+    if (timeout < finf()) {
+        t.tv_sec  = time_t(timeout);
+        t.tv_nsec = long((timeout - double(t.tv_sec)) * 1e9);
+        tp = &t;
+    }
+
+    // Returns immediately if the epoch has already changed from key
+    syscall(SYS_futex, epochWord(m_state), FUTEX_WAIT_PRIVATE, int(key), tp, NULL, 0);
+
+    // Timed out or woke spuriously
+    cancelWait(key);
+}
+
+
+void EventCount::wakeAll() {
+    uint64 s = m_state.load(std::memory_order_relaxed);
+    do {
+        if (waiters(s) == 0) {
+            // Another notifier got here first
+            return;
+        }
+    } while (! m_state.compare_exchange_weak(s, uint64(epoch(s) + 1) << 32, std::memory_order_seq_cst));
+
+    syscall(SYS_futex, epochWord(m_state), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+#else
+
+namespace {
+class ConditionVariable {
+public:
+    std::mutex                  mutex;
+    std::condition_variable     condition;
+};
+}
+
+
+EventCount::EventCount() : m_state(0), m_platform(new ConditionVariable()) {}
+
+
+EventCount::~EventCount() {
+    delete static_cast<ConditionVariable*>(m_platform);
+}
+
+
+void EventCount::commitWait(uint32 key, RealTime timeout) {
+    ConditionVariable* cv = static_cast<ConditionVariable*>(m_platform);
+    {
+        std::unique_lock<std::mutex> lock(cv->mutex);
+        if (epoch(m_state.load(std::memory_order_seq_cst)) == key) {
+            if (timeout < finf()) {
+                cv->condition.wait_for(lock, std::chrono::duration<double>(timeout));
+            } else {
+                cv->condition.wait(lock);
+            }
+        }
+    }
+    cancelWait(key);
+}
+
+
+void EventCount::wakeAll() {
+    ConditionVariable* cv = static_cast<ConditionVariable*>(m_platform);
+    {
+        // Advancing the epoch under the lock prevents a waiter from checking it and then
+        // missing the notification before it begins waiting
+        std::lock_guard<std::mutex> lock(cv->mutex);
+        uint64 s = m_state.load(std::memory_order_relaxed);
+        do {
+            if (waiters(s) == 0) {
+                return;
+            }
+        } while (! m_state.compare_exchange_weak(s, uint64(epoch(s) + 1) << 32, std::memory_order_seq_cst));
+    }
+    cv->condition.notify_all();
+}
+
+#endif
+
+} // _internal
+} // G3D
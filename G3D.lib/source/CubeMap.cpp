@@ -3,7 +3,7 @@
   Copyright 2002-2016, Morgan McGuire
 
   \created 2002-05-27
-  \edited  2016-10-07
+  \edited  2026-10-18
  */
 
 #include "G3D/CubeMap.h"
@@ -28,7 +28,7 @@ shared_ptr<CubeMap> CubeMap::create
 CubeMap::CubeMap
    (const Array<shared_ptr<Image3>>&    face,
     const Color3&                       readMultiplyFirst,
-    const Color3&                       readAddSecond) {
+    const Color3&                       readAddSecond) : m_mipValid(0), m_ggxValid(0) {
 
     debugAssert(face.size() == 6);
     m_iSize = face[0]->width();
@@ -38,6 +38,35 @@ CubeMap::CubeMap
             "Cube maps must use square faces with the same format");
     }
 
+    Image3* target[6];
+    for (int f = 0; f < 6; ++f) {
+        target[f] = &m_faceArray[f];
+    }
+    copyWithBorders(face, readMultiplyFirst, readAddSecond, target);
+
+    m_fSize = float(m_iSize);
+
+    m_numMipLevels = 1;
+    while ((m_iSize >> m_numMipLevels) > 0) {
+        ++m_numMipLevels;
+    }
+
+    // Stop the GGX chain at 4x4 faces and eight roughness levels
+    m_numGGXLevels = max(1, min(8, int(log2(m_iSize)) - 1));
+
+    // For debugging wrapping
+    //for (int i = 0; i < 6; ++i) { m_faceArray[i].save(G3D::format("%d.png", i)); }
+}
+
+
+void CubeMap::copyWithBorders
+   (const Array<shared_ptr<Image3>>&    face,
+    const Color3&                       readMultiplyFirst,
+    const Color3&                       readAddSecond,
+    Image3* const*                      target) {
+
+    const int size = face[0]->width();
+
     // Constants for specifying adjacency
     const int U = 0, V = 1;
     const int HI = 1, LO = -1;
@@ -67,12 +96,12 @@ CubeMap::CubeMap
     // Construct the source images
     for (int f = 0; f < 6; ++f) {
 
-        Image3& dst = m_faceArray[f];
-        dst.resize(m_iSize + 2, m_iSize + 2);
+        Image3& dst = *target[f];
+        dst.resize(size + 2, size + 2);
         // Copy the interior
         {
             const Image3& src = *face[f].get();
-            Thread::runConcurrently(Point2int32(0, 0), Point2int32(m_iSize, m_iSize), [&](Point2int32 P) {
+            Thread::runConcurrently(Point2int32(0, 0), Point2int32(size, size), [&](Point2int32 P) {
                 dst.set(P.x + 1, P.y + 1, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
             });
         }
@@ -84,10 +113,10 @@ CubeMap::CubeMap
             const int iterationAxis = (leftAxis[f] + 1) % 2;
             const int sign          = leftSign[f];
             Point2int32 P;
-            P[fixedAxis] = (sign == HI) ? m_iSize - 1 : 0;
-            for (int i = 0; i < m_iSize; ++i) {
+            P[fixedAxis] = (sign == HI) ? size - 1 : 0;
+            for (int i = 0; i < size; ++i) {
                 P[iterationAxis] = i;
-                dst.set(m_iSize + 1, i + 1, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
+                dst.set(size + 1, i + 1, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
             }
         }
 
@@ -98,8 +127,8 @@ CubeMap::CubeMap
             const int iterationAxis = (rightAxis[f] + 1) % 2;
             const int sign          = rightSign[f];
             Point2int32 P;
-            P[fixedAxis] = (sign == HI) ? m_iSize - 1 : 0;
-            for (int i = 0; i < m_iSize; ++i) {
+            P[fixedAxis] = (sign == HI) ? size - 1 : 0;
+            for (int i = 0; i < size; ++i) {
                 P[iterationAxis] = i;
                 dst.set(0, i + 1, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
             }
@@ -112,8 +141,8 @@ CubeMap::CubeMap
             const int iterationAxis = (topAxis[f] + 1) % 2;
             const int sign          = topSign[f];
             Point2int32 P;
-            P[fixedAxis] = (sign == HI) ? m_iSize - 1 : 0;
-            for (int i = 0; i < m_iSize; ++i) {
+            P[fixedAxis] = (sign == HI) ? size - 1 : 0;
+            for (int i = 0; i < size; ++i) {
                 P[iterationAxis] = i;
                 dst.set(i + 1, 0, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
             }
@@ -126,10 +155,10 @@ CubeMap::CubeMap
             const int iterationAxis = (bottomAxis[f] + 1) % 2;
             const int sign          = bottomSign[f];
             Point2int32 P;
-            P[fixedAxis] = (sign == HI) ? m_iSize - 1 : 0;
-            for (int i = 0; i < m_iSize; ++i) {
+            P[fixedAxis] = (sign == HI) ? size - 1 : 0;
+            for (int i = 0; i < size; ++i) {
                 P[iterationAxis] =  i;
-                dst.set(i + 1, m_iSize + 1, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
+                dst.set(i + 1, size + 1, src.get(P.x, P.y) * readMultiplyFirst + readAddSecond);
             }
         }
     }
@@ -137,32 +166,27 @@ CubeMap::CubeMap
     // Implement corners by averaging adjacent row and column in linear space and re-gamma encoding.
     // This must run after the loop that sets border rows and columns.
     for (int f = 0; f < 6; ++f) {
-        Image3& img = m_faceArray[f];
+        Image3& img = *target[f];
         Color3 a = img.get(0, 1);
         Color3 b = img.get(1, 0);
         img.set(0, 0, (a + b) * 0.5f);
 
-        a = img.get(0, m_iSize);
-        b = img.get(1, m_iSize + 1);
-        img.set(0, m_iSize + 1, (a + b) * 0.5f);
+        a = img.get(0, size);
+        b = img.get(1, size + 1);
+        img.set(0, size + 1, (a + b) * 0.5f);
 
-        a = img.get(m_iSize + 1, m_iSize);
-        b = img.get(m_iSize, m_iSize + 1);
-        img.set(m_iSize + 1, m_iSize + 1, (a + b) * 0.5f);
+        a = img.get(size + 1, size);
+        b = img.get(size, size + 1);
+        img.set(size + 1, size + 1, (a + b) * 0.5f);
 
-        a = img.get(m_iSize + 1, 1);
-        b = img.get(m_iSize, 0);
-        img.set(m_iSize + 1, 0, (a + b) * 0.5f);
+        a = img.get(size + 1, 1);
+        b = img.get(size, 0);
+        img.set(size + 1, 0, (a + b) * 0.5f);
     }
-
-    m_fSize = float(m_iSize);
-
-    // For debugging wrapping
-    //for (int i = 0; i < 6; ++i) { m_faceArray[i].save(G3D::format("%d.png", i)); }
 }
 
 
-Vector2 CubeMap::pixelCoord(const Vector3& vec, CubeFace& face) const {
+Vector2 CubeMap::texCoord(const Vector3& vec, CubeFace& face) {
     const Vector3::Axis faceAxis = vec.primaryAxis();
     face = (CubeFace)(int(faceAxis) * 2 + ((vec[faceAxis] < 0.0f) ? 1 : 0));
 
@@ -171,36 +195,72 @@ Vector2 CubeMap::pixelCoord(const Vector3& vec, CubeFace& face) const {
     const Vector3::Axis vAxis = Vector3::Axis((faceAxis + 2) % 3);
 
     // Texture coordinate, where (0, 0) is the upper left of the image
-    Vector2 texCoord = 0.5f * Vector2(vec[uAxis], vec[vAxis]) / fabsf(vec[faceAxis]) + Vector2(0.5f, 0.5f);
+    const Vector2& tc = 0.5f * Vector2(vec[uAxis], vec[vAxis]) / fabsf(vec[faceAxis]) + Vector2(0.5f, 0.5f);
 
     // Correct for OpenGL cube map rules
     switch (face) {
     case CubeFace::POS_X:
-        texCoord = Vector2(1.0f - texCoord.y, 1.0f - texCoord.x);
-        break;
+        return Vector2(1.0f - tc.y, 1.0f - tc.x);
 
     case CubeFace::NEG_X:
-        texCoord = Vector2(texCoord.y, 1.0f - texCoord.x);
-        break;
+        return Vector2(tc.y, 1.0f - tc.x);
 
     case CubeFace::POS_Y:
-        texCoord = Vector2(texCoord.y, texCoord.x);
+        return Vector2(tc.y, tc.x);
+
+    case CubeFace::NEG_Y:
+        return Vector2(tc.y, 1.0f - tc.x);
+
+    case CubeFace::POS_Z:
+        return Vector2(tc.x, 1.0f - tc.y);
+
+    case CubeFace::NEG_Z:
+    default:
+        return Vector2(1.0f - tc.x, 1.0f - tc.y);
+    }
+}
+
+
+Vector3 CubeMap::direction(CubeFace face, const Vector2& texCoord) {
+    // Undo the OpenGL cube map rules from texCoord()
+    Vector2 tc;
+    switch (face) {
+    case CubeFace::POS_X:
+        tc = Vector2(1.0f - texCoord.y, 1.0f - texCoord.x);
         break;
 
+    case CubeFace::NEG_X:
     case CubeFace::NEG_Y:
-        texCoord = Vector2(texCoord.y, 1.0f - texCoord.x);
+        tc = Vector2(1.0f - texCoord.y, texCoord.x);
+        break;
+
+    case CubeFace::POS_Y:
+        tc = Vector2(texCoord.y, texCoord.x);
         break;
 
     case CubeFace::POS_Z:
-        texCoord = Vector2(texCoord.x, 1.0f - texCoord.y);
+        tc = Vector2(texCoord.x, 1.0f - texCoord.y);
         break;
 
     case CubeFace::NEG_Z:
-        texCoord = Vector2(1.0f - texCoord.x, 1.0f - texCoord.y);
+    default:
+        tc = Vector2(1.0f - texCoord.x, 1.0f - texCoord.y);
         break;
     }
 
-    return m_fSize * texCoord + Vector2::one();
+    const int faceAxis = int(face) / 2;
+    Vector3 vec;
+    vec[faceAxis]           = ((int(face) & 1) == 0) ? 1.0f : -1.0f;
+    vec[(faceAxis + 1) % 3] = tc.x * 2.0f - 1.0f;
+    vec[(faceAxis + 2) % 3] = tc.y * 2.0f - 1.0f;
+    return vec;
+}
+
+
+Vector2 CubeMap::pixelCoord(const Vector3& vec, CubeFace& face) const {
+    // Pixel centers are at integers and the interior starts at 1, so texel i spans 
+    // [i / size, (i + 1) / size) of the face
+    return m_fSize * texCoord(vec, face) + Vector2(0.5f, 0.5f);
 }
 
 
@@ -218,6 +278,228 @@ Color3 CubeMap::bilinear(const Vector3& vec) const {
 }
 
 
+Color3 CubeMap::paddedBilinear(const Image3& image, const Vector2& texCoord) {
+    const Vector2& P = float(image.width() - 2) * texCoord + Vector2(0.5f, 0.5f);
+    return image.bilinear(P, WrapMode::CLAMP);
+}
+
+
+Color3 CubeMap::mipBilinear(int level, const Vector3& vec) const {
+    CubeFace face;
+    const Vector2& tc = texCoord(vec, face);
+    return paddedBilinear((level == 0) ? m_faceArray[face] : *m_mipFace[(level - 1) * 6 + face], tc);
+}
+
+
+Color3 CubeMap::trilinear(const Vector3& vec, float lod) const {
+    if (lod <= 0.0f) {
+        return bilinear(vec);
+    }
+
+    generateMipMaps();
+    const int maxLevel = m_numMipLevels - 1;
+    lod = min(lod, float(maxLevel));
+    const int   L = min(iFloor(lod), maxLevel);
+    const float t = lod - float(L);
+
+    const Color3& a = mipBilinear(L, vec);
+    if ((t <= 0.0f) || (L == maxLevel)) {
+        return a;
+    } else {
+        return a.lerp(mipBilinear(L + 1, vec), t);
+    }
+}
+
+
+Color3 CubeMap::trilinear(const Vector3& vec, const Vector3& dvdx, const Vector3& dvdy) const {
+    // Texture coordinates change at 0.5 / |v[faceAxis]| per unit change of the other components
+    const float scale = 0.5f * m_fSize / max(fabsf(vec.x), fabsf(vec.y), fabsf(vec.z));
+    const float width = max(dvdx.length(), dvdy.length()) * scale;
+    return trilinear(vec, (width > 0.0f) ? log2(width) : 0.0f);
+}
+
+
+void CubeMap::bilinear(const Vector3* vec, Color3* result, int n) const {
+    for (int i = 0; i < n; ++i) {
+        result[i] = bilinear(vec[i]);
+    }
+}
+
+
+void CubeMap::trilinear(const Vector3* vec, const float* lod, Color3* result, int n) const {
+    generateMipMaps();
+    for (int i = 0; i < n; ++i) {
+        result[i] = trilinear(vec[i], lod[i]);
+    }
+}
+
+
+void CubeMap::generateMipMaps() const {
+    if (m_mipValid.value() != 0) {
+        return;
+    }
+
+    m_mipLock.lock();
+    if (m_mipValid.value() == 0) {
+        // Filter the unpadded faces, which already have the read scale and bias applied.
+        // Filtering the padded faces would average the borders into the interior and 
+        // produce levels whose sizes do not halve the face size.
+        Array<shared_ptr<Image3>> face;
+        for (int f = 0; f < 6; ++f) {
+            face.append(Image3::createEmpty(m_iSize, m_iSize, WrapMode::CLAMP));
+            for (int y = 0; y < m_iSize; ++y) {
+                for (int x = 0; x < m_iSize; ++x) {
+                    face[f]->set(x, y, m_faceArray[f].get(x + 1, y + 1));
+                }
+            }
+            face[f]->generateMipMaps();
+        }
+
+        // Pad each level with the edges of the adjacent faces at the same level
+        m_mipFace.resize((m_numMipLevels - 1) * 6);
+        for (int level = 1; level < m_numMipLevels; ++level) {
+            const int size = face[0]->mipWidth(level);
+            Array<shared_ptr<Image3>> faceLevel;
+            Image3* target[6];
+            for (int f = 0; f < 6; ++f) {
+                faceLevel.append(Image3::createEmpty(size, size, WrapMode::CLAMP));
+                for (int y = 0; y < size; ++y) {
+                    for (int x = 0; x < size; ++x) {
+                        faceLevel[f]->set(x, y, face[f]->mipTexel(level, x, y, WrapMode::CLAMP));
+                    }
+                }
+                m_mipFace[(level - 1) * 6 + f] = Image3::createEmpty(size + 2, size + 2, WrapMode::CLAMP);
+                target[f] = m_mipFace[(level - 1) * 6 + f].get();
+            }
+            copyWithBorders(faceLevel, Color3::one(), Color3::zero(), target);
+        }
+
+        m_mipValid = 1;
+    }
+    m_mipLock.unlock();
+}
+
+
+void CubeMap::generateGGXMipMaps() const {
+    if (m_ggxValid.value() != 0) {
+        return;
+    }
+
+    m_ggxLock.lock();
+    if (m_ggxValid.value() == 0) {
+        // The prefilter samples the box-filtered pyramid of the faces
+        generateMipMaps();
+
+        // Solid angle of a level 0 texel, ignoring the distortion away from the face center
+        const float texelSolidAngle = 4.0f * pif() / (6.0f * square(m_fSize));
+
+        // Hammersley points for importance sampling the GGX distribution
+        static const int NUM_SAMPLES = 64;
+        Vector2 sample[NUM_SAMPLES];
+        for (int i = 0; i < NUM_SAMPLES; ++i) {
+            uint32 bits = uint32(i);
+            bits = (bits << 16) | (bits >> 16);
+            bits = ((bits & 0x55555555) << 1) | ((bits & 0xAAAAAAAA) >> 1);
+            bits = ((bits & 0x33333333) << 2) | ((bits & 0xCCCCCCCC) >> 2);
+            bits = ((bits & 0x0F0F0F0F) << 4) | ((bits & 0xF0F0F0F0) >> 4);
+            bits = ((bits & 0x00FF00FF) << 8) | ((bits & 0xFF00FF00) >> 8);
+            sample[i] = Vector2((float(i) + 0.5f) / float(NUM_SAMPLES), float(bits) * 2.3283064365386963e-10f);
+        }
+
+        m_ggxFace.resize((m_numGGXLevels - 1) * 6);
+        for (int level = 1; level < m_numGGXLevels; ++level) {
+            const int   size      = max(1, m_iSize >> level);
+            const float roughness = float(level) / float(m_numGGXLevels - 1);
+            const float alpha2    = square(square(roughness));
+
+            // Reflected directions in the tangent space of n = v = r, their cosine 
+            // weights, and the mip level matching each sample's solid angle
+            // (filtered importance sampling)
+            Vector3 L[NUM_SAMPLES];
+            float   weight[NUM_SAMPLES];
+            float   lod[NUM_SAMPLES];
+            for (int i = 0; i < NUM_SAMPLES; ++i) {
+                const float phi      = 2.0f * pif() * sample[i].x;
+                const float cosTheta = sqrt((1.0f - sample[i].y) / (1.0f + (alpha2 - 1.0f) * sample[i].y));
+                const float sinTheta = sqrt(max(0.0f, 1.0f - square(cosTheta)));
+                const Vector3 H(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+                L[i]      = 2.0f * cosTheta * H - Vector3::unitZ();
+                weight[i] = max(0.0f, L[i].z);
+
+                const float D = alpha2 / (pif() * square(square(cosTheta) * (alpha2 - 1.0f) + 1.0f));
+                const float pdf = D * 0.25f;
+                const float sampleSolidAngle = 1.0f / (float(NUM_SAMPLES) * pdf + 1e-6f);
+                lod[i] = max(0.0f, 0.5f * log2(sampleSolidAngle / texelSolidAngle) + 1.0f);
+            }
+
+            Array<shared_ptr<Image3>> face;
+            for (int f = 0; f < 6; ++f) {
+                face.append(Image3::createEmpty(size, size, WrapMode::CLAMP));
+            }
+
+            Thread::runConcurrently(Point3int32(0, 0, 0), Point3int32(size, size, 6), [&](Point3int32 P) {
+                const Vector3& n = direction(CubeFace(P.z), Vector2((float(P.x) + 0.5f) / float(size), (float(P.y) + 0.5f) / float(size))).direction();
+                Vector3 X, Y;
+                n.getTangents(X, Y);
+
+                Color3 sum;
+                float sumWeight = 0.0f;
+                for (int i = 0; i < NUM_SAMPLES; ++i) {
+                    if (weight[i] > 0.0f) {
+                        sum += trilinear(X * L[i].x + Y * L[i].y + n * L[i].z, lod[i]) * weight[i];
+                        sumWeight += weight[i];
+                    }
+                }
+                face[P.z]->set(P.x, P.y, sum / max(sumWeight, 1e-6f));
+            });
+
+            Image3* target[6];
+            for (int f = 0; f < 6; ++f) {
+                m_ggxFace[(level - 1) * 6 + f] = Image3::createEmpty(size + 2, size + 2, WrapMode::CLAMP);
+                target[f] = m_ggxFace[(level - 1) * 6 + f].get();
+            }
+            copyWithBorders(face, Color3::one(), Color3::zero(), target);
+        }
+
+        m_ggxValid = 1;
+    }
+    m_ggxLock.unlock();
+}
+
+
+Color3 CubeMap::ggxBilinear(int level, const Vector3& vec) const {
+    if (level == 0) {
+        return bilinear(vec);
+    }
+    CubeFace face;
+    const Vector2& tc = texCoord(vec, face);
+    return paddedBilinear(*m_ggxFace[(level - 1) * 6 + face], tc);
+}
+
+
+Color3 CubeMap::prefilteredGGX(const Vector3& vec, float roughness) const {
+    generateGGXMipMaps();
+    const float level = clamp(roughness, 0.0f, 1.0f) * float(m_numGGXLevels - 1);
+    const int   L     = min(iFloor(level), m_numGGXLevels - 1);
+    const float t     = level - float(L);
+
+    const Color3& a = ggxBilinear(L, vec);
+    if ((t <= 0.0f) || (L == m_numGGXLevels - 1)) {
+        return a;
+    } else {
+        return a.lerp(ggxBilinear(L + 1, vec), t);
+    }
+}
+
+
+void CubeMap::prefilteredGGX(const Vector3* vec, const float* roughness, Color3* result, int n) const {
+    generateGGXMipMaps();
+    for (int i = 0; i < n; ++i) {
+        result[i] = prefilteredGGX(vec[i], roughness[i]);
+    }
+}
+
+
 int CubeMap::size() const {
     return m_iSize;
 }
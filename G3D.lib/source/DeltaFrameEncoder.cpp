@@ -0,0 +1,187 @@
+/**
+  \file G3D.lib/source/DeltaFrameEncoder.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+*/
+#include "G3D/DeltaFrameEncoder.h"
+#include "G3D/BinaryOutput.h"
+#include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/ImageFormat.h"
+
+namespace G3D {
+
+size_t DeltaFrameEncoder::Frame::dataSize() const {
+    size_t s = 0;
+    for (int t = 0; t < tiles.size(); ++t) {
+        s += tiles[t].data.size();
+    }
+    return s;
+}
+
+
+void DeltaFrameEncoder::Frame::serialize(BinaryOutput& bo) const {
+    bo.writeInt32(width);
+    bo.writeInt32(height);
+    bo.writeInt32(index);
+    bo.writeUInt8(keyframe ? 1 : 0);
+    bo.writeInt32(tiles.size());
+    for (int t = 0; t < tiles.size(); ++t) {
+        const Tile& tile = tiles[t];
+        bo.writeInt32(tile.x);
+        bo.writeInt32(tile.y);
+        bo.writeInt32(tile.width);
+        bo.writeInt32(tile.height);
+        bo.writeInt32(tile.data.size());
+        bo.writeBytes(tile.data.getCArray(), tile.data.size());
+    }
+}
+
+
+DeltaFrameEncoder::DeltaFrameEncoder(const Settings& settings) :
+    m_settings(settings),
+    m_width(0),
+    m_height(0),
+    m_format(NULL),
+    m_tilesX(0),
+    m_tilesY(0),
+    m_frameCount(0),
+    m_forceKeyframe(true),
+    m_bytesInFlight(0) {
+
+    debugAssertM(m_settings.tileSize > 0, "tileSize must be positive");
+    debugAssertM((m_settings.tileFormat == Image::PNG) || (m_settings.tileFormat == Image::JPEG), "Only PNG and JPEG tiles are supported");
+}
+
+
+void DeltaFrameEncoder::resize(int width, int height, const ImageFormat* format) {
+    m_width  = width;
+    m_height = height;
+    m_format = format;
+    m_tilesX = iCeil(float(width)  / float(m_settings.tileSize));
+    m_tilesY = iCeil(float(height) / float(m_settings.tileSize));
+    m_tileHash.resize(m_tilesX * m_tilesY);
+    m_forceKeyframe = true;
+}
+
+
+uint64 DeltaFrameEncoder::hashTile(const CPUPixelTransferBuffer* src, int tx, int ty) const {
+    const int bytesPerPixel = m_format->cpuBitsPerPixel / 8;
+    const int x0 = tx * m_settings.tileSize;
+    const int y0 = ty * m_settings.tileSize;
+    const int rowBytes = (min(x0 + m_settings.tileSize, m_width) - x0) * bytesPerPixel;
+    const int y1 = min(y0 + m_settings.tileSize, m_height);
+
+    // 64-bit multiply-xorshift over 8-byte words. Collisions only cause a stale tile until
+    // the next keyframe.
+    const uint64 K = 0x9E3779B97F4A7C15ULL;
+    uint64 h = 0xCBF29CE484222325ULL;
+    for (int y = y0; y < y1; ++y) {
+        const uint8* row = static_cast<const uint8*>(src->row(y)) + x0 * bytesPerPixel;
+        int i = 0;
+        for (; i + 8 <= rowBytes; i += 8) {
+            uint64 w;
+            System::memcpy(&w, row + i, 8);
+            h = (h ^ w) * K;
+            h ^= h >> 29;
+        }
+        for (; i < rowBytes; ++i) {
+            h = (h ^ row[i]) * K;
+        }
+    }
+    return h;
+}
+
+
+void DeltaFrameEncoder::encodeTile(const CPUPixelTransferBuffer* src, Tile& tile) const {
+    const int bytesPerPixel = m_format->cpuBitsPerPixel / 8;
+    const shared_ptr<CPUPixelTransferBuffer> tileBuffer = CPUPixelTransferBuffer::create(tile.width, tile.height, m_format);
+    for (int y = 0; y < tile.height; ++y) {
+        System::memcpy(tileBuffer->row(y), static_cast<const uint8*>(src->row(tile.y + y)) + tile.x * bytesPerPixel, tile.width * bytesPerPixel);
+    }
+
+    BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+    Image::fromPixelTransferBuffer(tileBuffer)->serialize(bo, m_settings.tileFormat);
+
+    tile.data.resize(int(bo.size()));
+    System::memcpy(tile.data.getCArray(), bo.getCArray(), bo.size());
+}
+
+
+bool DeltaFrameEncoder::encode(const shared_ptr<Image>& src, Frame& frame) {
+    return encode(src->toPixelTransferBuffer(), frame);
+}
+
+
+bool DeltaFrameEncoder::encode(const shared_ptr<CPUPixelTransferBuffer>& src, Frame& frame) {
+    debugAssertM((src->format()->cpuBitsPerPixel % 8) == 0, "Unsupported pixel format");
+
+    if ((src->width() != m_width) || (src->height() != m_height) || (src->format() != m_format)) {
+        resize(src->width(), src->height(), src->format());
+    }
+
+    const bool keyframe = m_forceKeyframe ||
+        ((m_settings.keyframeInterval > 0) && (m_frameCount % m_settings.keyframeInterval == 0));
+
+    // Hash all tiles in parallel and mark the changed ones
+    const int numTiles = m_tilesX * m_tilesY;
+    Array<uint64> hash;
+    hash.resize(numTiles);
+    tbb::parallel_for(tbb::blocked_range<int>(0, numTiles, 16), [&](const tbb::blocked_range<int>& r) {
+        for (int t = r.begin(); t < r.end(); ++t) {
+            hash[t] = hashTile(src.get(), t % m_tilesX, t / m_tilesX);
+        }
+    });
+
+    Array<int> changed;
+    for (int t = 0; t < numTiles; ++t) {
+        if (keyframe || (hash[t] != m_tileHash[t])) {
+            changed.append(t);
+        }
+    }
+
+    if (changed.size() == 0) {
+        return false;
+    }
+
+    frame.index      = m_frameCount;
+    frame.keyframe   = keyframe;
+    frame.width      = m_width;
+    frame.height     = m_height;
+    frame.tileFormat = m_settings.tileFormat;
+    frame.tiles.resize(changed.size());
+
+    // Compress the changed tiles in parallel. Each one is an independent image.
+    tbb::parallel_for(tbb::blocked_range<int>(0, changed.size(), 1), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            const int t = changed[i];
+            Tile& tile  = frame.tiles[i];
+            tile.x      = (t % m_tilesX) * m_settings.tileSize;
+            tile.y      = (t / m_tilesX) * m_settings.tileSize;
+            tile.width  = min(m_settings.tileSize, m_width - tile.x);
+            tile.height = min(m_settings.tileSize, m_height - tile.y);
+            encodeTile(src.get(), tile);
+        }
+    });
+
+    m_tileHash = hash;
+    m_forceKeyframe = false;
+    ++m_frameCount;
+
+    const size_t bytes = frame.dataSize();
+    m_inFlight.pushBack(bytes);
+    m_bytesInFlight += bytes;
+
+    return true;
+}
+
+
+void DeltaFrameEncoder::acknowledge() {
+    if (m_inFlight.size() > 0) {
+        m_bytesInFlight -= m_inFlight.popFront();
+    }
+}
+
+} // namespace G3D
@@ -4,7 +4,7 @@
  \author Morgan McGuire, http://graphics.cs.williams.edu
  
  \author  2002-06-06
- \edited  2016-02-16
+ \edited  2026-10-18
  */
 #include "G3D/FileSystem.h"
 #include "G3D/System.h"
@@ -12,11 +12,11 @@
 #include "G3D/fileutils.h"
 #include <sys/stat.h>
 #include <sys/types.h>
-#include "zip.h"
 #include <regex>
 #include "G3D/g3dfnmatch.h"
 #include "G3D/BinaryInput.h"
 #include "G3D/BinaryOutput.h"
+#include "G3D/ZipfileCache.h"
 
 #ifdef G3D_WINDOWS
     // Needed for _getcwd
@@ -83,18 +83,16 @@ bool FileSystem::Dir::contains(const String& f, bool caseSensitive) const {
     
 void FileSystem::Dir::computeZipListing(const String& zipfile, const String& _pathInsideZipfile) {
     const String& pathInsideZipfile = FilePath::canonicalize(_pathInsideZipfile);
-    struct zip* z = zip_open( FilePath::removeTrailingSlash(zipfile).c_str(), ZIP_CHECKCONS, NULL );
-    debugAssert(z);
+    const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(zipfile);
+    debugAssert(notNull(archive));
+    if (isNull(archive)) {
+        return;
+    }
 
-    int count = zip_get_num_files( z );
     Set<String> alreadyAdded;
-    for (int i = 0; i < count; ++i) {
-        struct zip_stat info;
-        zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-        zip_stat_index( z, i, ZIP_FL_NOCASE, &info );
-        
+    for (int i = 0; i < archive->numEntries(); ++i) {
         // Fully-qualified name of a file inside zipfile
-        String name = FilePath::canonicalize(info.name);
+        String name = archive->entry(i).name;
 
         if (beginsWith(name, pathInsideZipfile)) {
             // We found something inside the directory we were looking for,
@@ -129,9 +127,6 @@ void FileSystem::Dir::computeZipListing(const String& zipfile, const String& _pa
             }
         }
     }
-    
-    zip_close(z);
-    z = NULL;
 }
 
 
@@ -331,6 +326,9 @@ FILE* FileSystem::_fopen(const char* _filename, const char* mode) {
 void FileSystem::_clearCache(const String& _path) {
     const String& path = FilePath::expandEnvironmentVariables(_path);
 
+    // Also close the open zipfiles under path, so that they are reparsed on next access
+    ZipfileCache::clear(path);
+
     if ((path == "") || FilePath::isRoot(path)) {
         m_cache.clear();
     } else {
@@ -662,20 +660,9 @@ int64 FileSystem::_size(const String& _filename) {
     if (result == -1) {
         String zip, contents;
         if (zipfileExists(filename, zip, contents)) {
-            int64 requiredMem;
-            
-            struct zip *z = zip_open( zip.c_str(), ZIP_CHECKCONS, NULL );
-            debugAssertM(z != NULL, zip + ": zip open failed.");
-            {
-                struct zip_stat info;
-                zip_stat_init( &info );    // Docs unclear if zip_stat_init is required.
-                int success = zip_stat( z, contents.c_str(), ZIP_FL_NOCASE, &info );
-                (void) success;
-                debugAssertM(success == 0, zip + ": " + contents + ": zip stat failed.");
-                requiredMem = info.size;
-            }
-            zip_close(z);
-            return requiredMem;
+            const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(zip);
+            debugAssertM(notNull(archive), zip + ": zip open failed.");
+            return isNull(archive) ? -1 : archive->size(contents);
         } else {
             return -1;
         }
@@ -19,6 +19,7 @@
 #include "G3D/ImageConvert.h"
 #include "G3D/PixelTransferBuffer.h"
 #include "G3D/CPUPixelTransferBuffer.h"
+#include <atomic>
 
 // Forward declaration for OpenEXR to avoid bringing in the entire header
 namespace Imf {
@@ -62,16 +63,21 @@ shared_ptr<Image> Image::create(int width, int height, const ImageFormat* imageF
 GMutex Image::s_freeImageMutex;
 
 void Image::initFreeImage() {
-    GMutexLock lock(&s_freeImageMutex);
-    static bool hasInitialized = false;
+    // Every Image constructor calls this, so avoid the lock after initialization to keep parallel
+    // decodes from serializing here
+    static std::atomic<bool> hasInitialized(false);
+    if (hasInitialized.load(std::memory_order_acquire)) {
+        return;
+    }
 
-    if (! hasInitialized) {
+    GMutexLock lock(&s_freeImageMutex);
+    if (! hasInitialized.load(std::memory_order_relaxed)) {
         FreeImage_Initialise();
         // FreeImage's ILM-based mutexes are broken, making actual lazy initialization of the OpenEXR library
         // not threadsafe. So, we explicitly call that protected by our own 
         // mutex.
         Imf::staticInitialize();
-        hasInitialized = true;
+        hasInitialized.store(true, std::memory_order_release);
     }
 }
 
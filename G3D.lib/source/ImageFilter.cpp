@@ -0,0 +1,751 @@
+/**
+  \file G3D/source/ImageFilter.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#include "G3D/ImageFilter.h"
+#include "G3D/Image3.h"
+#include "G3D/Image4.h"
+#include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/ImageConvert.h"
+#include "G3D/filter.h"
+#include "G3D/System.h"
+#include <algorithm>
+#include <vector>
+#include <immintrin.h>
+
+namespace G3D {
+
+/** Which source pixels, with what weights, contribute to each destination pixel along one axis.
+    Every destination pixel has the same number of taps so that the inner loops do not branch. */
+class Contributions {
+public:
+    int             numTaps;
+
+    /** Source pixel of tap t for destination pixel i is index[i * numTaps + t]. Always in bounds. */
+    Array<int>      index;
+    Array<float>    weight;
+
+    /** Destination pixels [interiorBegin, interiorEnd) all read taps i - (numTaps - 1) / 2 through
+        i + (numTaps - 1) / 2 with the same weights, so they can be filtered without the index table */
+    int             interiorBegin;
+    int             interiorEnd;
+
+    Contributions() : numTaps(0), interiorBegin(0), interiorEnd(0) {}
+
+    void resize(int dstLength, int n) {
+        numTaps = n;
+        index.resize(dstLength * n);
+        weight.resize(dstLength * n);
+    }
+
+    /** Maps the source coordinate of every tap into bounds */
+    void wrap(int srcLength, WrapMode wrapMode) {
+        for (int i = 0; i < index.size(); ++i) {
+            int& x = index[i];
+            if ((x < 0) || (x >= srcLength)) {
+                if (wrapMode == WrapMode::TILE) {
+                    x = iWrap(x, srcLength);
+                } else {
+                    if (wrapMode == WrapMode::ZERO) {
+                        weight[i] = 0.0f;
+                    }
+                    x = iClamp(x, 0, srcLength - 1);
+                }
+            }
+        }
+    }
+
+    void fromKernel(int length, const Array<float>& kernel, WrapMode wrapMode) {
+        debugAssertM(isOdd(kernel.size()), "Convolution kernels must have odd length");
+        const int n = kernel.size();
+        const int radius = (n - 1) / 2;
+        resize(length, n);
+        for (int i = 0; i < length; ++i) {
+            for (int t = 0; t < n; ++t) {
+                index[i * n + t]  = i + t - radius;
+                weight[i * n + t] = kernel[t];
+            }
+        }
+        wrap(length, wrapMode);
+
+        interiorBegin = min(radius, length);
+        interiorEnd   = max(interiorBegin, length - radius);
+    }
+
+    void fromFilter(int srcLength, int dstLength, ResampleFilter filter, WrapMode wrapMode) {
+        const float scale       = float(dstLength) / float(srcLength);
+
+        // Widen the filter when minifying
+        const float filterScale = min(scale, 1.0f);
+        const float support     = ImageFilter::support(filter) / filterScale;
+        const int n             = iCeil(2.0f * support) + 1;
+
+        // Weights of all n taps of every pixel, and the first nonzero tap
+        Array<float> w;
+        w.resize(dstLength * n);
+        Array<int> first, lo;
+        first.resize(dstLength);
+        lo.resize(dstLength);
+        int span = 1;
+
+        for (int i = 0; i < dstLength; ++i) {
+            const float center = (float(i) + 0.5f) / scale - 0.5f;
+            first[i] = iFloor(center - support);
+            float sum = 0.0f;
+            for (int t = 0; t < n; ++t) {
+                w[i * n + t] = ImageFilter::evaluate(filter, (float(first[i] + t) - center) * filterScale);
+                sum += w[i * n + t];
+            }
+
+            if (sum != 0.0f) {
+                for (int t = 0; t < n; ++t) {
+                    w[i * n + t] /= sum;
+                }
+            }
+
+            int a = 0, b = n - 1;
+            while ((a < b) && (w[i * n + a] == 0.0f)) { ++a; }
+            while ((b > a) && (w[i * n + b] == 0.0f)) { --b; }
+            lo[i] = a;
+            span = max(span, b - a + 1);
+        }
+
+        // Drop the zero-weight taps, e.g., the third tap of a box filter when halving
+        resize(dstLength, span);
+        for (int i = 0; i < dstLength; ++i) {
+            for (int t = 0; t < span; ++t) {
+                const int s = lo[i] + t;
+                index[i * span + t]  = first[i] + s;
+                weight[i * span + t] = (s < n) ? w[i * n + s] : 0.0f;
+            }
+        }
+        wrap(srcLength, wrapMode);
+    }
+};
+
+
+/** A width x height image of RGBA floats, which either owns its pixels or refers to an Image4's */
+class FloatImage {
+public:
+    int             width;
+    int             height;
+    float*          data;
+
+    /** Empty when data is not owned */
+    Array<float>    storage;
+
+    FloatImage() : width(0), height(0), data(NULL) {}
+
+    void resize(int w, int h) {
+        width  = w;
+        height = h;
+        storage.resize(w * h * 4, false);
+        data   = storage.getCArray();
+    }
+
+    void reference(float* d, int w, int h) {
+        width  = w;
+        height = h;
+        storage.clear();
+        data   = d;
+    }
+
+    void swap(FloatImage& other) {
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+        std::swap(data, other.data);
+        Array<float>::swap(storage, other.storage);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernels
+
+/** dst[x] = sum over t of weight[t] * src[index[t]] for RGBA pixels x0 <= x < x1 */
+static void gatherSSE(const float* src, float* dst, int x0, int x1, const Contributions& c) {
+    const int n = c.numTaps;
+    const int* index = c.index.getCArray() + x0 * n;
+    const float* weight = c.weight.getCArray() + x0 * n;
+    dst += 4 * x0;
+    for (int x = x0; x < x1; ++x, index += n, weight += n, dst += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int t = 0; t < n; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + 4 * index[t]), _mm_set1_ps(weight[t])));
+        }
+        _mm_storeu_ps(dst, acc);
+    }
+}
+
+
+/** Two pixels per iteration, one in each 128-bit lane */
+G3D_TARGET_AVX static void gatherAVX(const float* src, float* dst, int x0, int x1, const Contributions& c) {
+    const int n = c.numTaps;
+    const int* index = c.index.getCArray() + x0 * n;
+    const float* weight = c.weight.getCArray() + x0 * n;
+    dst += 4 * x0;
+    int x = x0;
+    for (; x + 1 < x1; x += 2, index += 2 * n, weight += 2 * n, dst += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int t = 0; t < n; ++t) {
+            const __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4 * index[t])), _mm_loadu_ps(src + 4 * index[n + t]), 1);
+            const __m256 w = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weight[t])), _mm_set1_ps(weight[n + t]), 1);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(v, w));
+        }
+        _mm256_storeu_ps(dst, acc);
+    }
+
+    if (x < x1) {
+        __m128 acc = _mm_setzero_ps();
+        for (int t = 0; t < n; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + 4 * index[t]), _mm_set1_ps(weight[t])));
+        }
+        _mm_storeu_ps(dst, acc);
+    }
+}
+
+
+/** dst[i] = sum over t of weight[t] * row[t][i], for \a count floats (a multiple of 4) */
+static void weightedSumSSE(const float* const* row, const float* weight, int n, float* dst, int count) {
+    for (int i = 0; i < count; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int t = 0; t < n; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(row[t] + i), _mm_set1_ps(weight[t])));
+        }
+        _mm_storeu_ps(dst + i, acc);
+    }
+}
+
+
+G3D_TARGET_AVX static void weightedSumAVX(const float* const* row, const float* weight, int n, float* dst, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int t = 0; t < n; ++t) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(row[t] + i), _mm256_set1_ps(weight[t])));
+        }
+        _mm256_storeu_ps(dst + i, acc);
+    }
+
+    if (i < count) {
+        __m128 acc = _mm_setzero_ps();
+        for (int t = 0; t < n; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(row[t] + i), _mm_set1_ps(weight[t])));
+        }
+        _mm_storeu_ps(dst + i, acc);
+    }
+}
+
+
+/** The SSE or AVX kernels, chosen once for this CPU */
+class Kernels {
+public:
+    void (*gather)(const float* src, float* dst, int x0, int x1, const Contributions& c);
+    void (*weightedSum)(const float* const* row, const float* weight, int n, float* dst, int count);
+
+    Kernels() {
+        if (System::hasAVX()) {
+            gather      = gatherAVX;
+            weightedSum = weightedSumAVX;
+        } else {
+            gather      = gatherSSE;
+            weightedSum = weightedSumSSE;
+        }
+    }
+
+    /** Filters one row of \a width RGBA pixels. \a tap has room for c.numTaps pointers. */
+    void horizontal(const float* src, float* dst, int width, const Contributions& c, const float** tap) const {
+        if (c.interiorBegin < c.interiorEnd) {
+            // Shifted copies of the row are the "rows" of a weighted sum
+            const int radius = (c.numTaps - 1) / 2;
+            for (int t = 0; t < c.numTaps; ++t) {
+                tap[t] = src + 4 * (c.interiorBegin + t - radius);
+            }
+            gather(src, dst, 0, c.interiorBegin, c);
+            weightedSum(tap, &c.weight[c.interiorBegin * c.numTaps], c.numTaps, dst + 4 * c.interiorBegin, 4 * (c.interiorEnd - c.interiorBegin));
+            gather(src, dst, c.interiorEnd, width, c);
+        } else {
+            gather(src, dst, 0, width, c);
+        }
+    }
+};
+
+
+/** Applies \a cx horizontally and then \a cy vertically. Each band of destination rows
+    filters only the source rows that it reads, so no full-size intermediate is needed. */
+static void separableFilter(const FloatImage& src, const Contributions& cx, const Contributions& cy, FloatImage& dst) {
+    static const int BAND_ROWS = 32;
+    static const Kernels kernels;
+
+    const int numBands = (dst.height + BAND_ROWS - 1) / BAND_ROWS;
+    const int rowFloats = dst.width * 4;
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, numBands, 1), [&](const tbb::blocked_range<int>& r) {
+        // slot[y] is the row of scratch holding horizontally filtered source row y, or -1
+        std::vector<int> slot(src.height, -1);
+        std::vector<int> used;
+        std::vector<float> scratch;
+        std::vector<const float*> row(max(cx.numTaps, cy.numTaps));
+
+        for (int band = r.begin(); band < r.end(); ++band) {
+            const int y0 = band * BAND_ROWS;
+            const int y1 = min(dst.height, y0 + BAND_ROWS);
+
+            used.clear();
+            for (int i = y0 * cy.numTaps; i < y1 * cy.numTaps; ++i) {
+                const int y = cy.index[i];
+                if (slot[y] == -1) {
+                    slot[y] = int(used.size());
+                    used.push_back(y);
+                }
+            }
+
+            scratch.resize(used.size() * rowFloats);
+            for (size_t s = 0; s < used.size(); ++s) {
+                kernels.horizontal(src.data + used[s] * src.width * 4, &scratch[s * rowFloats], dst.width, cx, row.data());
+            }
+
+            for (int y = y0; y < y1; ++y) {
+                for (int t = 0; t < cy.numTaps; ++t) {
+                    row[t] = &scratch[slot[cy.index[y * cy.numTaps + t]] * rowFloats];
+                }
+                kernels.weightedSum(row.data(), &cy.weight[y * cy.numTaps], cy.numTaps, dst.data + y * rowFloats, rowFloats);
+            }
+
+            for (size_t s = 0; s < used.size(); ++s) {
+                slot[used[s]] = -1;
+            }
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Conversion to and from FloatImage
+
+/** Nearest-in-linear-space sRGB encoding and exact decoding of unorm8 values */
+class SRGB8 {
+public:
+    float       toLinear[256];
+
+    /** threshold[i] is the linear value halfway between sRGB values i and i + 1 */
+    float       threshold[255];
+
+    SRGB8() {
+        for (int i = 0; i < 256; ++i) {
+            const float s = float(i) / 255.0f;
+            toLinear[i] = (s <= 0.04045f) ? (s / 12.92f) : ::powf((s + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 255; ++i) {
+            threshold[i] = 0.5f * (toLinear[i] + toLinear[i + 1]);
+        }
+    }
+
+    uint8 fromLinear(float v) const {
+        return uint8(std::upper_bound(threshold, threshold + 255, v) - threshold);
+    }
+
+    static const SRGB8& table() {
+        static const SRGB8 t;
+        return t;
+    }
+};
+
+
+/** Describes how the formats that ImageFilter reads and writes directly are laid out */
+class Layout {
+public:
+    int         numChannels;
+    bool        isFloat;
+    bool        isSRGB;
+
+    /** False for formats that must be converted to RGBA32F */
+    static bool get(const ImageFormat* f, Layout& layout) {
+        layout.isFloat = false;
+        layout.isSRGB  = (f->colorSpace == ImageFormat::COLOR_SPACE_SRGB);
+        if ((f == ImageFormat::R8()) || (f == ImageFormat::L8())) {
+            layout.numChannels = 1;
+        } else if ((f == ImageFormat::RGB8()) || (f == ImageFormat::SRGB8())) {
+            layout.numChannels = 3;
+        } else if ((f == ImageFormat::RGBA8()) || (f == ImageFormat::SRGBA8())) {
+            layout.numChannels = 4;
+        } else if (f == ImageFormat::R32F()) {
+            layout.numChannels = 1;
+            layout.isFloat = true;
+        } else if (f == ImageFormat::RGB32F()) {
+            layout.numChannels = 3;
+            layout.isFloat = true;
+        } else if (f == ImageFormat::RGBA32F()) {
+            layout.numChannels = 4;
+            layout.isFloat = true;
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+
+/** Decodes \a src to \a dst and returns the format of results */
+static const ImageFormat* toFloat(const shared_ptr<PixelTransferBuffer>& src, FloatImage& dst) {
+    Layout layout;
+    if (! Layout::get(src->format(), layout)) {
+        const shared_ptr<PixelTransferBuffer>& converted = ImageConvert::convertBuffer(src, ImageFormat::RGBA32F());
+        if (isNull(converted)) {
+            throw String("ImageFilter cannot convert from ImageFormat ") + src->format()->name();
+        }
+        return toFloat(converted, dst);
+    }
+
+    dst.resize(src->width(), src->height());
+    const SRGB8& srgb = SRGB8::table();
+    const uint8* in = static_cast<const uint8*>(src->mapRead());
+    const int nc = layout.numChannels;
+    const size_t stride = src->stride();
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, dst.height, 16), [&](const tbb::blocked_range<int>& r) {
+        for (int y = r.begin(); y < r.end(); ++y) {
+            float* out = dst.data + y * dst.width * 4;
+            for (int x = 0; x < dst.width; ++x, out += 4) {
+                out[1] = out[2] = 0.0f;
+                out[3] = 1.0f;
+                if (layout.isFloat) {
+                    const float* p = reinterpret_cast<const float*>(in + y * stride) + x * nc;
+                    for (int c = 0; c < nc; ++c) {
+                        out[c] = p[c];
+                    }
+                } else {
+                    const uint8* p = in + y * stride + x * nc;
+                    for (int c = 0; c < nc; ++c) {
+                        out[c] = (layout.isSRGB && (c < 3)) ? srgb.toLinear[p[c]] : (float(p[c]) / 255.0f);
+                    }
+                }
+            }
+        }
+    });
+
+    src->unmap();
+    return src->format();
+}
+
+
+static shared_ptr<CPUPixelTransferBuffer> fromFloat(const FloatImage& src, const ImageFormat* format) {
+    Layout layout;
+    Layout::get(format, layout);
+    const shared_ptr<CPUPixelTransferBuffer>& dst = CPUPixelTransferBuffer::create(src.width, src.height, format);
+    const SRGB8& srgb = SRGB8::table();
+    uint8* out = static_cast<uint8*>(dst->buffer());
+    const int nc = layout.numChannels;
+    const size_t stride = dst->stride();
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, src.height, 16), [&](const tbb::blocked_range<int>& r) {
+        for (int y = r.begin(); y < r.end(); ++y) {
+            const float* in = src.data + y * src.width * 4;
+            for (int x = 0; x < src.width; ++x, in += 4) {
+                if (layout.isFloat) {
+                    float* p = reinterpret_cast<float*>(out + y * stride) + x * nc;
+                    for (int c = 0; c < nc; ++c) {
+                        p[c] = in[c];
+                    }
+                } else {
+                    uint8* p = out + y * stride + x * nc;
+                    for (int c = 0; c < nc; ++c) {
+                        p[c] = (layout.isSRGB && (c < 3)) ? srgb.fromLinear(in[c]) : uint8(iClamp(iRound(in[c] * 255.0f), 0, 255));
+                    }
+                }
+            }
+        }
+    });
+
+    return dst;
+}
+
+
+static void toFloat(const shared_ptr<Image3>& src, FloatImage& dst) {
+    dst.resize(src->width(), src->height());
+    const Color3* in = src->getCArray();
+    float* out = dst.data;
+    for (int i = 0; i < dst.width * dst.height; ++i, out += 4) {
+        out[0] = in[i].r;
+        out[1] = in[i].g;
+        out[2] = in[i].b;
+        out[3] = 1.0f;
+    }
+}
+
+
+/** Creates the result image and the FloatImage that the filter writes into */
+static void allocate(int width, int height, WrapMode wrap, shared_ptr<Image3>& im, FloatImage& dst) {
+    im = Image3::createEmpty(width, height, wrap);
+    dst.resize(width, height);
+}
+
+
+/** Copies the filtered pixels into the result image if they are not already there */
+static void finish(const FloatImage& src, shared_ptr<Image3>& im) {
+    const float* in = src.data;
+    Color3* out = im->getCArray();
+    for (int i = 0; i < src.width * src.height; ++i, in += 4) {
+        out[i] = Color3(in[0], in[1], in[2]);
+    }
+}
+
+
+/** Image4 is already RGBA float, so it is filtered without copying. Sources are never written. */
+static void toFloat(const shared_ptr<Image4>& src, FloatImage& dst) {
+    dst.reference(reinterpret_cast<float*>(const_cast<Color4*>(src->getCArray())), src->width(), src->height());
+}
+
+
+static void allocate(int width, int height, WrapMode wrap, shared_ptr<Image4>& im, FloatImage& dst) {
+    im = Image4::createEmpty(width, height, wrap);
+    dst.reference(reinterpret_cast<float*>(im->getCArray()), width, height);
+}
+
+
+static void finish(const FloatImage& src, shared_ptr<Image4>& im) {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** \a dst must be the same size as \a src */
+static void convolve(const FloatImage& src, const Array<float>& kernelX, const Array<float>& kernelY, WrapMode wrap, FloatImage& dst) {
+    Contributions cx, cy;
+    cx.fromKernel(src.width, kernelX, wrap);
+    cy.fromKernel(src.height, kernelY, wrap);
+    separableFilter(src, cx, cy, dst);
+}
+
+
+/** Resamples \a src to the size of \a dst */
+static void resample(const FloatImage& src, ResampleFilter filter, WrapMode wrap, FloatImage& dst) {
+    debugAssert((dst.width > 0) && (dst.height > 0));
+    Contributions cx, cy;
+    cx.fromFilter(src.width, dst.width, filter, wrap);
+    cy.fromFilter(src.height, dst.height, filter, wrap);
+    separableFilter(src, cx, cy, dst);
+}
+
+
+static void gaussianKernel(float std, Array<float>& kernel) {
+    gaussian1D(kernel, 2 * iCeil(3.0f * std) + 1, std);
+}
+
+
+/** ERROR and IGNORE would otherwise reject the filter footprint at the edges */
+static WrapMode filterWrap(WrapMode wrap) {
+    return ((wrap == WrapMode::TILE) || (wrap == WrapMode::ZERO)) ? wrap : WrapMode::CLAMP;
+}
+
+
+template<class ImageType>
+static shared_ptr<ImageType> convolveImage(const shared_ptr<ImageType>& src, const Array<float>& kernelX, const Array<float>& kernelY) {
+    FloatImage in, out;
+    shared_ptr<ImageType> im;
+    toFloat(src, in);
+    allocate(src->width(), src->height(), src->wrapMode(), im, out);
+    convolve(in, kernelX, kernelY, filterWrap(src->wrapMode()), out);
+    finish(out, im);
+    return im;
+}
+
+
+template<class ImageType>
+static shared_ptr<ImageType> resampleImage(const shared_ptr<ImageType>& src, int width, int height, ResampleFilter filter) {
+    FloatImage in, out;
+    shared_ptr<ImageType> im;
+    toFloat(src, in);
+    allocate(width, height, src->wrapMode(), im, out);
+    resample(in, filter, filterWrap(src->wrapMode()), out);
+    finish(out, im);
+    return im;
+}
+
+
+template<class ImageType>
+static void generateImageMipMaps(const shared_ptr<ImageType>& src, Array< shared_ptr<ImageType> >& mip, ResampleFilter filter) {
+    const WrapMode wrap = filterWrap(src->wrapMode());
+    mip.fastClear();
+    mip.append(src);
+
+    FloatImage level;
+    toFloat(src, level);
+    while ((level.width > 1) || (level.height > 1)) {
+        FloatImage next;
+        shared_ptr<ImageType> im;
+        allocate(max(1, level.width / 2), max(1, level.height / 2), src->wrapMode(), im, next);
+        resample(level, filter, wrap, next);
+        finish(next, im);
+        mip.append(im);
+        level.swap(next);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float ImageFilter::support(ResampleFilter filter) {
+    switch (filter.value) {
+    case ResampleFilter::BOX:
+        return 0.5f;
+
+    case ResampleFilter::TRIANGLE:
+        return 1.0f;
+
+    case ResampleFilter::MITCHELL:
+        return 2.0f;
+
+    default:
+        return 3.0f;
+    }
+}
+
+
+static float sinc(float x) {
+    if (abs(x) < 1e-6f) {
+        return 1.0f;
+    }
+    x *= pif();
+    return ::sinf(x) / x;
+}
+
+
+/** Zeroth-order modified Bessel function of the first kind */
+static float besselI0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    const float q = 0.25f * x * x;
+    for (int k = 1; k < 20; ++k) {
+        term *= q / float(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+
+float ImageFilter::evaluate(ResampleFilter filter, float x) {
+    x = abs(x);
+    switch (filter.value) {
+    case ResampleFilter::BOX:
+        // Half-open, so that a sample exactly between two pixels belongs to only one of them
+        return (x < 0.5f) ? 1.0f : 0.0f;
+
+    case ResampleFilter::TRIANGLE:
+        return max(0.0f, 1.0f - x);
+
+    case ResampleFilter::MITCHELL:
+        {
+            static const float B = 1.0f / 3.0f, C = 1.0f / 3.0f;
+            if (x < 1.0f) {
+                return ((12.0f - 9.0f * B - 6.0f * C) * x * x * x + (-18.0f + 12.0f * B + 6.0f * C) * x * x + (6.0f - 2.0f * B)) / 6.0f;
+            } else if (x < 2.0f) {
+                return ((-B - 6.0f * C) * x * x * x + (6.0f * B + 30.0f * C) * x * x + (-12.0f * B - 48.0f * C) * x + (8.0f * B + 24.0f * C)) / 6.0f;
+            } else {
+                return 0.0f;
+            }
+        }
+
+    case ResampleFilter::LANCZOS3:
+        return (x < 3.0f) ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+
+    case ResampleFilter::KAISER:
+        {
+            static const float alpha = 4.0f;
+            static const float I0alpha = besselI0(alpha);
+            return (x < 3.0f) ? sinc(x) * besselI0(alpha * sqrt(1.0f - square(x / 3.0f))) / I0alpha : 0.0f;
+        }
+
+    default:
+        return 0.0f;
+    }
+}
+
+
+shared_ptr<Image4> ImageFilter::convolve(const shared_ptr<Image4>& src, const Array<float>& kernelX, const Array<float>& kernelY) {
+    return convolveImage(src, kernelX, kernelY);
+}
+
+
+shared_ptr<Image3> ImageFilter::convolve(const shared_ptr<Image3>& src, const Array<float>& kernelX, const Array<float>& kernelY) {
+    return convolveImage(src, kernelX, kernelY);
+}
+
+
+shared_ptr<CPUPixelTransferBuffer> ImageFilter::convolve(const shared_ptr<PixelTransferBuffer>& src, const Array<float>& kernelX, const Array<float>& kernelY, WrapMode wrap) {
+    FloatImage in, out;
+    const ImageFormat* format = toFloat(src, in);
+    out.resize(in.width, in.height);
+    G3D::convolve(in, kernelX, kernelY, filterWrap(wrap), out);
+    return fromFloat(out, format);
+}
+
+
+shared_ptr<Image4> ImageFilter::gaussianBlur(const shared_ptr<Image4>& src, float std) {
+    Array<float> kernel;
+    gaussianKernel(std, kernel);
+    return convolve(src, kernel, kernel);
+}
+
+
+shared_ptr<Image3> ImageFilter::gaussianBlur(const shared_ptr<Image3>& src, float std) {
+    Array<float> kernel;
+    gaussianKernel(std, kernel);
+    return convolve(src, kernel, kernel);
+}
+
+
+shared_ptr<CPUPixelTransferBuffer> ImageFilter::gaussianBlur(const shared_ptr<PixelTransferBuffer>& src, float std, WrapMode wrap) {
+    Array<float> kernel;
+    gaussianKernel(std, kernel);
+    return convolve(src, kernel, kernel, wrap);
+}
+
+
+shared_ptr<Image4> ImageFilter::resample(const shared_ptr<Image4>& src, int width, int height, ResampleFilter filter) {
+    return resampleImage(src, width, height, filter);
+}
+
+
+shared_ptr<Image3> ImageFilter::resample(const shared_ptr<Image3>& src, int width, int height, ResampleFilter filter) {
+    return resampleImage(src, width, height, filter);
+}
+
+
+shared_ptr<CPUPixelTransferBuffer> ImageFilter::resample(const shared_ptr<PixelTransferBuffer>& src, int width, int height, ResampleFilter filter, WrapMode wrap) {
+    FloatImage in, out;
+    const ImageFormat* format = toFloat(src, in);
+    out.resize(width, height);
+    G3D::resample(in, filter, filterWrap(wrap), out);
+    return fromFloat(out, format);
+}
+
+
+void ImageFilter::generateMipMaps(const shared_ptr<Image4>& src, Array< shared_ptr<Image4> >& mip, ResampleFilter filter) {
+    generateImageMipMaps(src, mip, filter);
+}
+
+
+void ImageFilter::generateMipMaps(const shared_ptr<Image3>& src, Array< shared_ptr<Image3> >& mip, ResampleFilter filter) {
+    generateImageMipMaps(src, mip, filter);
+}
+
+
+void ImageFilter::generateMipMaps(const shared_ptr<PixelTransferBuffer>& src, Array< shared_ptr<CPUPixelTransferBuffer> >& mip, ResampleFilter filter, WrapMode wrap) {
+    wrap = filterWrap(wrap);
+    FloatImage level;
+    const ImageFormat* format = toFloat(src, level);
+    mip.fastClear();
+    mip.append(fromFloat(level, format));
+    while ((level.width > 1) || (level.height > 1)) {
+        FloatImage next;
+        next.resize(max(1, level.width / 2), max(1, level.height / 2));
+        G3D::resample(level, filter, wrap, next);
+        mip.append(fromFloat(next, format));
+        level.swap(next);
+    }
+}
+
+} // namespace G3D
@@ -18,8 +18,12 @@
 #include "G3D/vectorMath.h"
 #include "G3D/AABox.h"
 #include "G3D/Image1.h"
+#include "G3D/System.h"
 
 #include <climits>
+#include <atomic>
+#include <vector>
+#include <algorithm>
 
 namespace G3D {
 
@@ -174,45 +178,51 @@ void MeshAlg::computeNormals(
 
     // Face normals (not unit length)
     faceNormalArray.resize(faceArray.size());
-    for (int f = 0; f < faceArray.size(); ++f) {
-        const Face& face = faceArray[f];
+    tbb::parallel_for(tbb::blocked_range<int>(0, faceArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
+            const Face& face = faceArray[f];
+
+            Vector3 vertex[3];
+            for (int j = 0; j < 3; ++j) {
+                vertex[j] = vertexGeometry[face.vertexIndex[j]];
+                debugAssert(vertex[j].isFinite());
+            }
 
-        Vector3 vertex[3];
-        for (int j = 0; j < 3; ++j) {
-            vertex[j] = vertexGeometry[face.vertexIndex[j]];
-            debugAssert(vertex[j].isFinite());
+            faceNormalArray[f] = (vertex[1] - vertex[0]).cross(vertex[2] - vertex[0]);
+#           ifdef G3D_DEBUG
+                const Vector3& N = faceNormalArray[f];
+                debugAssert(N.isFinite());
+#           endif
         }
+    });
 
-        faceNormalArray[f] = (vertex[1] - vertex[0]).cross(vertex[2] - vertex[0]);
-#       ifdef G3D_DEBUG
-            const Vector3& N = faceNormalArray[f];
-            debugAssert(N.isFinite());
-#       endif
-    }
-
-    // Per-vertex normals, computed by averaging
+    // Per-vertex normals, computed by averaging. Each vertex only reads the face normals,
+    // so the vertices are independent.
     vertexNormalArray.resize(vertexGeometry.size());
-    for (int v = 0; v < vertexNormalArray.size(); ++v) {
-        Vector3 sum = Vector3::zero();
-        for (int k = 0; k < vertexArray[v].faceIndex.size(); ++k) {
-            const int f = vertexArray[v].faceIndex[k];
-            sum += faceNormalArray[f];
-        }
-        vertexNormalArray[v] = sum.directionOrZero();
-#       ifdef G3D_DEBUG
-            const Vector3& N = vertexNormalArray[v];
-            debugAssert(N.isUnit() || N.isZero());
-#       endif
-    }
-
-
-    for (int f = 0; f < faceArray.size(); ++f) {
-        faceNormalArray[f] = faceNormalArray[f].directionOrZero();
-#       ifdef G3D_DEBUG
-            const Vector3& N = faceNormalArray[f];
-            debugAssert(N.isUnit() || N.isZero());
-#       endif
-    }
+    tbb::parallel_for(tbb::blocked_range<int>(0, vertexNormalArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int v = r.begin(); v < r.end(); ++v) {
+            Vector3 sum = Vector3::zero();
+            for (int k = 0; k < vertexArray[v].faceIndex.size(); ++k) {
+                const int f = vertexArray[v].faceIndex[k];
+                sum += faceNormalArray[f];
+            }
+            vertexNormalArray[v] = sum.directionOrZero();
+#           ifdef G3D_DEBUG
+                const Vector3& N = vertexNormalArray[v];
+                debugAssert(N.isUnit() || N.isZero());
+#           endif
+        }
+    });
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, faceArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
+            faceNormalArray[f] = faceNormalArray[f].directionOrZero();
+#           ifdef G3D_DEBUG
+                const Vector3& N = faceNormalArray[f];
+                debugAssert(N.isUnit() || N.isZero());
+#           endif
+        }
+    });
 
 }
 
@@ -225,21 +235,20 @@ void MeshAlg::computeFaceNormals(
 
     faceNormals.resize(faceArray.size());
 
-    for (int f = 0; f < faceArray.size(); ++f) {
-        const MeshAlg::Face& face = faceArray[f];
+    tbb::parallel_for(tbb::blocked_range<int>(0, faceArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
+            const MeshAlg::Face& face = faceArray[f];
 
-        const Vector3& v0 = vertexArray[face.vertexIndex[0]];
-        const Vector3& v1 = vertexArray[face.vertexIndex[1]];
-        const Vector3& v2 = vertexArray[face.vertexIndex[2]];
+            const Vector3& v0 = vertexArray[face.vertexIndex[0]];
+            const Vector3& v1 = vertexArray[face.vertexIndex[1]];
+            const Vector3& v2 = vertexArray[face.vertexIndex[2]];
         
-        faceNormals[f] = (v1 - v0).cross(v2 - v0);
-    }
-
-    if (normalize) {
-        for (int f = 0; f < faceArray.size(); ++f) {
-            faceNormals[f] = faceNormals[f].direction();
+            faceNormals[f] = (v1 - v0).cross(v2 - v0);
+            if (normalize) {
+                faceNormals[f] = faceNormals[f].direction();
+            }
         }
-    }
+    });
 }
 
 
@@ -549,6 +558,99 @@ void MeshAlg::computeBounds(
     }
 }
 
+/** Shared by both versions of computeVertexCorners. \a vertexOfCorner(c) returns the vertex
+    index at triangle corner c. */
+template<class VertexOfCorner>
+static void computeVertexCornersImpl(
+    int                         numCorners,
+    int                         numVertices,
+    const VertexOfCorner&       vertexOfCorner,
+    Array<int>&                 cornerOffset,
+    Array<int>&                 corner) {
+
+    cornerOffset.resize(numVertices + 1);
+    corner.resize(numCorners);
+
+    if (System::numCores() == 1) {
+        // The atomics below cost more than the sort saves on a single core. A serial
+        // counting sort emits each vertex's corners in order.
+        System::memset(cornerOffset.getCArray(), 0, sizeof(int) * cornerOffset.size());
+        for (int c = 0; c < numCorners; ++c) {
+            ++cornerOffset[vertexOfCorner(c) + 1];
+        }
+        for (int v = 0; v < numVertices; ++v) {
+            cornerOffset[v + 1] += cornerOffset[v];
+        }
+        Array<int> cursor(cornerOffset);
+        for (int c = 0; c < numCorners; ++c) {
+            corner[cursor[vertexOfCorner(c)]++] = c;
+        }
+        return;
+    }
+
+    // Count the corners of each vertex
+    std::vector< std::atomic<int> > count(numVertices);
+    tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 16384), [&](const tbb::blocked_range<int>& r) {
+        for (int v = r.begin(); v < r.end(); ++v) {
+            count[v].store(0, std::memory_order_relaxed);
+        }
+    });
+    tbb::parallel_for(tbb::blocked_range<int>(0, numCorners, 16384), [&](const tbb::blocked_range<int>& r) {
+        for (int c = r.begin(); c < r.end(); ++c) {
+            count[vertexOfCorner(c)].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // Exclusive prefix sum, leaving each counter at the start of its vertex's range
+    int total = 0;
+    for (int v = 0; v < numVertices; ++v) {
+        cornerOffset[v] = total;
+        total += count[v].load(std::memory_order_relaxed);
+        count[v].store(cornerOffset[v], std::memory_order_relaxed);
+    }
+    cornerOffset[numVertices] = total;
+
+    // Scatter. Threads claim slots within a vertex's range in arbitrary order...
+    tbb::parallel_for(tbb::blocked_range<int>(0, numCorners, 16384), [&](const tbb::blocked_range<int>& r) {
+        for (int c = r.begin(); c < r.end(); ++c) {
+            corner[count[vertexOfCorner(c)].fetch_add(1, std::memory_order_relaxed)] = c;
+        }
+    });
+
+    // ...so restore the serial order. Most ranges are short.
+    tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int v = r.begin(); v < r.end(); ++v) {
+            int* first = corner.getCArray() + cornerOffset[v];
+            int* last  = corner.getCArray() + cornerOffset[v + 1];
+            if (last - first > 16) {
+                std::sort(first, last);
+            } else {
+                // Insertion sort
+                for (int* i = first + 1; i < last; ++i) {
+                    const int x = *i;
+                    int* j = i;
+                    for (; (j > first) && (*(j - 1) > x); --j) {
+                        *j = *(j - 1);
+                    }
+                    *j = x;
+                }
+            }
+        }
+    });
+}
+
+
+void MeshAlg::computeVertexCorners(
+    const Array<int>&           indexArray,
+    int                         numVertices,
+    Array<int>&                 cornerOffset,
+    Array<int>&                 corner) {
+
+    const int* index = indexArray.getCArray();
+    computeVertexCornersImpl(indexArray.size(), numVertices, [index](int c) { return index[c]; }, cornerOffset, corner);
+}
+
+
 void MeshAlg::computeTangentSpaceBasis(
     const Array<Vector3>&       vertexArray,
     const Array<Vector2>&       texCoordArray,
@@ -562,78 +664,112 @@ void MeshAlg::computeTangentSpaceBasis(
     tangent.resize(vertexArray.size());
     binormal.resize(vertexArray.size());
 
-    // Zero the output arrays.
-    System::memset(tangent.getCArray(), 0, sizeof(Vector3) * tangent.size());
-    System::memset(binormal.getCArray(), 0, sizeof(Vector3) * binormal.size());
+    // Compute the tangent vectors for each face in parallel. Then, for each vertex in
+    // parallel, accumulate those of its faces in face order and orthonormalize. This
+    // produces exactly the same sums as scattering each face's vectors to its vertices.
 
-    // Iterate over faces, computing the tangent vectors for each 
-    // vertex.  Accumulate those into the tangent and binormal arrays
-    // and then orthonormalize at the end.
+    Array<Vector3> faceTangent;
+    Array<Vector3> faceBinormal;
+    faceTangent.resize(faceArray.size());
+    faceBinormal.resize(faceArray.size());
 
-    for (int f = 0; f < faceArray.size(); ++f) {
-        const Face& face = faceArray[f];
+    tbb::parallel_for(tbb::blocked_range<int>(0, faceArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
+            const Face& face = faceArray[f];
 
-        const int i0 = face.vertexIndex[0];
-        const int i1 = face.vertexIndex[1];
-        const int i2 = face.vertexIndex[2];
+            const int i0 = face.vertexIndex[0];
+            const int i1 = face.vertexIndex[1];
+            const int i2 = face.vertexIndex[2];
         
-        const Vector3& v0 = vertexArray[i0];
-        const Vector3& v1 = vertexArray[i1];
-        const Vector3& v2 = vertexArray[i2];
+            const Vector3& v0 = vertexArray[i0];
+            const Vector3& v1 = vertexArray[i1];
+            const Vector3& v2 = vertexArray[i2];
 
-        const Vector2& t0 = texCoordArray[i0];
-        const Vector2& t1 = texCoordArray[i1];
-        const Vector2& t2 = texCoordArray[i2];
+            const Vector2& t0 = texCoordArray[i0];
+            const Vector2& t1 = texCoordArray[i1];
+            const Vector2& t2 = texCoordArray[i2];
 
-        // See http://www.terathon.com/code/tangent.html for a derivation of the following code
+            // See http://www.terathon.com/code/tangent.html for a derivation of the following code
 
-        // vertex edges
-        Vector3 ve1 = v1 - v0;
-        Vector3 ve2 = v2 - v0;
+            // vertex edges
+            Vector3 ve1 = v1 - v0;
+            Vector3 ve2 = v2 - v0;
 
-        // texture edges
-        Vector2 te1 = t1 - t0;
-        Vector2 te2 = t2 - t0;
+            // texture edges
+            Vector2 te1 = t1 - t0;
+            Vector2 te2 = t2 - t0;
 
-        Vector3 n(ve1.cross(ve2).direction());
-        Vector3 t, b;
+            Vector3 n(ve1.cross(ve2).direction());
+            Vector3 t, b;
     
-        float r = te1.x * te2.y - te1.y * te2.x;
-        if (r == 0.0) {
-            // degenerate case
-            if (! n.isFinite() || n.isZero()) {
-                n = Vector3::unitY();
+            float r = te1.x * te2.y - te1.y * te2.x;
+            if (r == 0.0) {
+                // degenerate case
+                if (! n.isFinite() || n.isZero()) {
+                    n = Vector3::unitY();
+                }
+                n.getTangents(t, b);
+            } else {
+                r = 1.0f / r;        
+                t = (te2.y * ve1 - te1.y * ve2) * r;
+                b = (te2.x * ve1 - te1.x * ve2) * r;   
             }
-            n.getTangents(t, b);
-        } else {
-            r = 1.0f / r;        
-            t = (te2.y * ve1 - te1.y * ve2) * r;
-            b = (te2.x * ve1 - te1.x * ve2) * r;   
+
+            faceTangent[f]  = t;
+            faceBinormal[f] = b;
         }
+    });
 
-        for (int v = 0; v < 3; ++v) {
-            int i = face.vertexIndex[v];
-            tangent[i]  += t;
-            binormal[i] += b;
+    if (System::numCores() == 1) {
+        // Scattering in face order is the serial order, and cheaper than building the index
+        System::memset(tangent.getCArray(), 0, sizeof(Vector3) * tangent.size());
+        System::memset(binormal.getCArray(), 0, sizeof(Vector3) * binormal.size());
+        for (int f = 0; f < faceArray.size(); ++f) {
+            for (int j = 0; j < 3; ++j) {
+                const int v = faceArray[f].vertexIndex[j];
+                tangent[v]  += faceTangent[f];
+                binormal[v] += faceBinormal[f];
+            }
         }
+    } else {
+        Array<int> cornerOffset;
+        Array<int> corner;
+        computeVertexCornersImpl(faceArray.size() * 3, vertexArray.size(), 
+            [&faceArray](int c) { return faceArray[c / 3].vertexIndex[c % 3]; }, cornerOffset, corner);
+
+        tbb::parallel_for(tbb::blocked_range<int>(0, vertexArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+            for (int v = r.begin(); v < r.end(); ++v) {
+                Vector3 T = Vector3::zero();
+                Vector3 B = Vector3::zero();
+                for (int k = cornerOffset[v]; k < cornerOffset[v + 1]; ++k) {
+                    const int f = corner[k] / 3;
+                    T += faceTangent[f];
+                    B += faceBinormal[f];
+                }
+                tangent[v]  = T;
+                binormal[v] = B;
+            }
+        });
     }
 
-    // Normalize the basis vectors
-    for (int v = 0; v < vertexArray.size(); ++v) {
-        // Remove the component parallel to the normal
-        const Vector3& N = vertexNormalArray[v];
-        Vector3& T = tangent[v];
-        Vector3& B = binormal[v];
+    tbb::parallel_for(tbb::blocked_range<int>(0, vertexArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int v = r.begin(); v < r.end(); ++v) {
+            Vector3& T = tangent[v];
+            Vector3& B = binormal[v];
+
+            // Remove the component parallel to the normal
+            const Vector3& N = vertexNormalArray[v];
 
-        debugAssertM(N.isUnit() || N.isZero(), "Input normals must have unit length");
+            debugAssertM(N.isUnit() || N.isZero(), "Input normals must have unit length");
 
-        T -= T.dot(N) * N;
-        B -= B.dot(N) * N;
+            T -= T.dot(N) * N;
+            B -= B.dot(N) * N;
 
-        // Normalize
-        T = T.directionOrZero();
-        B = B.directionOrZero();
-    }
+            // Normalize
+            T = T.directionOrZero();
+            B = B.directionOrZero();
+        }
+    });
 }
 
 
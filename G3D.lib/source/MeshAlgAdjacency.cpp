@@ -15,156 +15,10 @@
 #include "G3D/Set.h"
 #include "G3D/Stopwatch.h"
 #include "G3D/SmallArray.h"
-#include "G3D/AreaMemoryManager.h"
+#include <algorithm>
 
 namespace G3D {
 
-/** Two-level table mapping index 0 -> index 1 -> list of face indices */
-class MeshEdgeTable {
-public:
-
-    /** We  expect 2 faces per edge. */
-    typedef SmallArray<int, 2> FaceIndexArray;
-
-    class Edge {
-    public:
-        int i1;
-
-        FaceIndexArray faceIndexArray;
-    };
-
-    /** We expect at most 6 edges per vertex; that matches a typical regular grid mesh */
-    typedef SmallArray<Edge, 6> EdgeArray;
-
-    typedef Array< EdgeArray > ET;
-
-private:
-    
-    ET                   table;
-
-public:
-
-    MeshEdgeTable() {
-        shared_ptr<AreaMemoryManager> mm = AreaMemoryManager::create();
-        table.clearAndSetMemoryManager(mm);
-    }
-
-    void clear() {
-        table.clear();
-    }
-    
-    void resize(int maxV) {
-        table.resize(maxV);
-    }
-
-    /**
-     Inserts the faceIndex into the edge's face list.
-     The index may be a negative number indicating a backface.
-
-     \param v0 Vertex index 0
-     \param v1 Vertex index 1
-     */
-    void insert(int v0, int v1, int faceIndex) {
-        
-        debugAssert(v0 <= v1);
-        EdgeArray& edgeArray = table[v0];
-        for (int i = 0; i < edgeArray.size(); ++i) {
-            if (edgeArray[i].i1 == v1) {
-                edgeArray[i].faceIndexArray.push(faceIndex);
-                return;
-            }
-        }
-
-        Edge& p = edgeArray.next();
-        p.i1 = v1;
-        p.faceIndexArray.push(faceIndex);
-    }
-
-    class Iterator {
-        friend class MeshEdgeTable;
-    private:
-
-        int                                   m_i0;
-        /** Pair index */
-        int                                   m_p;
-        ET&                                   m_array;
-        EdgeArray*                            m_edgeArray;
-        bool                                  m_end;
-
-    public:
-
-        int i0() const {
-            return m_i0;
-        }
-
-        int i1() const {
-            return (*m_edgeArray)[m_p].i1;
-        }
-
-        FaceIndexArray& faceIndex() {
-            return (*m_edgeArray)[m_p].faceIndexArray;
-        }
-
-        Iterator& operator++() {
-            if ((m_i0 >= 0) && (m_p < m_edgeArray->size() - 1)) {
-                ++m_p;
-            } else {
-                // Skip over elements with no face array
-                do {
-                    ++m_i0;
-                    if (m_i0 == m_array.size()) {
-                        m_end = true;
-                        return *this;
-                    } else {
-                        m_edgeArray = &m_array[m_i0];
-                        m_p = 0;
-                    }
-                } while (m_edgeArray->size() == 0);
-            }
-
-            return *this;
-        }
-
-        bool isValid() const {
-            return ! m_end;
-        }
-
-        /** @deprecated  Use isValid */
-        bool hasMore() const {
-            return ! m_end;
-        }
-
-    private:
-
-        Iterator(ET& a) : m_i0(-1), m_p(-1),  m_array(a), m_edgeArray(NULL), m_end(false) {
-            ++(*this);
-        }
-
-    };
-
-    Iterator begin() {
-        return Iterator(table);
-    }
-};
-
-
-/**
- Assigns the edge index into the next unassigned edge
- index.  The edge index may be negative, indicating
- a reverse edge.
- */
-static void assignEdgeIndex(MeshAlg::Face& face, int e) {
-    for (int i = 0; i < 3; ++i) {
-        if (face.edgeIndex[i] == MeshAlg::Face::NONE) {
-            face.edgeIndex[i] = e;
-            return;
-        }
-    }
-
-    debugAssertM(false, "Face has already been assigned 3 edges");
-}
-
-
 void MeshAlg::computeAdjacency(
     const Array<Vector3>&   vertexGeometry,
     const Array<int>&       indexArray,
@@ -197,172 +51,235 @@ void MeshAlg::computeAdjacency(
     Array<Edge>&            edgeArray,
     Array<Vertex>&          vertexArray) {
 
-    MeshEdgeTable           edgeTable;
+    // Half-edge h = 3 * f + j runs from corner j to corner j + 1 of face f. The half-edges
+    // are sorted by their lower vertex, and then each vertex pairs the half-edges that
+    // it is the lower vertex of independently of the others. Edges, and their
+    // assignment to faces, are numbered in the order of a serial walk over the sorted
+    // vertices, so that the result is the same as inserting the triangles one at a
+    // time into a per-vertex edge table.
+
+    static const int nextIndex[] = {1, 2, 0};
 
     edgeArray.clear();
     vertexArray.clear();
     faceArray.clear();
-    
-    // Face normals
-    Array<Vector3> faceNormal;
-    faceNormal.resize(indexArray.size() / 3);
-    faceArray.resize(faceNormal.size());
-
-    // This array has the same size as the vertex array
-    vertexArray.resize(vertexGeometry.size());
 
-    edgeTable.resize(vertexArray.size());
+    const int numFaces    = indexArray.size() / 3;
+    const int numVertices = vertexGeometry.size();
 
-    // Iterate through the triangle list
-    for (int q = 0, f = 0; q < indexArray.size(); ++f, q += 3) {
-
-        Vector3 vertex[3];
-        MeshAlg::Face& face = faceArray[f];
+    Array<Vector3> faceNormal;
+    faceNormal.resize(numFaces);
+    faceArray.resize(numFaces);
+    vertexArray.resize(numVertices);
+
+    Array<int> lowVertex;
+    Array<int> highVertex;
+    lowVertex.resize(3 * numFaces);
+    highVertex.resize(3 * numFaces);
+
+    // Construct the faces
+    tbb::parallel_for(tbb::blocked_range<int>(0, numFaces, 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
+            Face& face = faceArray[f];
+            Vector3 vertex[3];
 
-        // Construct the face
-        for (int j = 0; j < 3; ++j) {
-            int v = indexArray[q + j];
-            face.vertexIndex[j] = v;
-            face.edgeIndex[j]   = Face::NONE;
+            for (int j = 0; j < 3; ++j) {
+                const int v = indexArray[3 * f + j];
+                face.vertexIndex[j] = v;
+                vertex[j]           = vertexGeometry[v];
 
-            // Store back pointers in the vertices
-            vertexArray[v].faceIndex.append(f);
+                const int i1 = indexArray[3 * f + nextIndex[j]];
+                lowVertex[3 * f + j]  = iMin(v, i1);
+                highVertex[3 * f + j] = iMax(v, i1);
+            }
 
-            // We'll need these vertices to find the face normal
-            vertex[j]           = vertexGeometry[v];
+            const Vector3& N = (vertex[1] - vertex[0]).cross(vertex[2] - vertex[0]);
+            faceNormal[f] = N.directionOrZero();
         }
-
-        // Compute the face normal
-        const Vector3& N = (vertex[1] - vertex[0]).cross(vertex[2] - vertex[0]);
-        faceNormal[f] = N.directionOrZero();
-
-        static const int nextIndex[] = {1, 2, 0};
-
-        // Add each edge to the edge table.
-        for (int j = 0; j < 3; ++j) {
-            const int      i0 = indexArray[q + j];
-            const int      i1 = indexArray[q + nextIndex[j]];
-
-            if (i0 < i1) {
-                // The edge was directed in the same manner as in the face
-                edgeTable.insert(i0, i1, f);
-            } else {
-                // The edge was directed in the opposite manner as in the face
-                edgeTable.insert(i1, i0, ~f);
+    });
+
+    Array<int> halfEdgeOffset;
+    Array<int> halfEdge;
+    computeVertexCorners(lowVertex, numVertices, halfEdgeOffset, halfEdge);
+
+    // Index of the edge of each half-edge relative to the first edge of its lower vertex,
+    // complemented if the half-edge runs backwards along it
+    Array<int> localEdge;
+    localEdge.resize(3 * numFaces);
+
+    // Order in which the half-edges were assigned to their faces
+    Array<int> assignment;
+    assignment.resize(3 * numFaces);
+
+    // Number of edges for each vertex, and then the index of each vertex's first edge
+    Array<int> edgeOffset;
+    edgeOffset.resize(numVertices + 1);
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 1024), [&](const tbb::blocked_range<int>& r) {
+        // The upper vertex and face index (complemented for backfaces) of each of v0's
+        // half-edges, gathered once so that grouping them does not revisit the mesh
+        Array<int> localUpperVertex;
+        Array<int> localFaceIndex;
+
+        // The upper vertices of v0's edges, in the order that the edges first appear
+        Array<int> upperVertex;
+
+        // Face indices and half-edges of one edge, in face order
+        Array<int> faceIndexArray;
+        Array<int> halfEdgeArray;
+
+        for (int v0 = r.begin(); v0 < r.end(); ++v0) {
+            const int begin = halfEdgeOffset[v0];
+            const int n     = halfEdgeOffset[v0 + 1] - begin;
+
+            localUpperVertex.fastClear();
+            localFaceIndex.fastClear();
+            upperVertex.fastClear();
+            for (int k = 0; k < n; ++k) {
+                const int h  = halfEdge[begin + k];
+                const int v1 = highVertex[h];
+                const int f  = h / 3;
+
+                // The edge is forward in the face only if it runs from v0 to a higher index
+                localUpperVertex.append(v1);
+                localFaceIndex.append((indexArray[h] < v1) ? f : ~f);
+
+                if (! upperVertex.contains(v1)) {
+                    upperVertex.append(v1);
+                }
             }
-        }
-    }
-
-    // For each edge in the edge table, create an edge in the edge array.
-    // Collapse every 2 edges from adjacent faces.
-
-    MeshEdgeTable::Iterator cur = edgeTable.begin();
-
-    Array<Edge> tempEdgeArray;
-    while (cur.isValid()) {
-        MeshEdgeTable::FaceIndexArray& faceIndexArray = cur.faceIndex();
-
-        // Process this edge
-        while (faceIndexArray.size() > 0) {
-
-            // Remove the last index
-            int f0 = faceIndexArray.pop();
 
-            // Find the normal to that face
-            const Vector3& n0 = faceNormal[(f0 >= 0) ? f0 : ~f0];
+            int numEdges    = 0;
+            int numAssigned = 0;
+            for (int u = 0; u < upperVertex.size(); ++u) {
+                const int v1 = upperVertex[u];
+
+                faceIndexArray.fastClear();
+                halfEdgeArray.fastClear();
+                for (int k = 0; k < n; ++k) {
+                    if (localUpperVertex[k] == v1) {
+                        faceIndexArray.append(localFaceIndex[k]);
+                        halfEdgeArray.append(halfEdge[begin + k]);
+                    }
+                }
 
-            bool found = false;
+                // Process this edge
+                while (faceIndexArray.size() > 0) {
+
+                    // Remove the last index
+                    const int f0 = faceIndexArray.pop();
+                    const int h0 = halfEdgeArray.pop();
+
+                    bool found = false;
+                    int f1 = -1, i1 = -1;
+
+                    // Try to find the face with the matching edge
+                    int numCandidates = 0;
+                    for (int i = faceIndexArray.size() - 1; i >= 0; --i) {
+                        const int f = faceIndexArray[i];
+                        if ((f >= 0) != (f0 >= 0)) {
+                            // This face contains the oppositely oriented edge
+                            ++numCandidates;
+                            if (! found) {
+                                found = true;
+                                f1    = f;
+                                i1    = i;
+                            }
+                        }
+                    }
 
-            // We try to find the matching face with the closest
-            // normal.  This ensures that we don't introduce a lot
-            // of artificial ridges into flat parts of a mesh.
-            float ndotn = -2;
-            int f1 = -1, i1 = -1;
-            
-            // Try to find the face with the matching edge
-            for (int i = faceIndexArray.size() - 1; i >= 0; --i) {
-                int f = faceIndexArray[i];
+                    if (numCandidates > 1) {
+                        // We try to find the matching face with the closest
+                        // normal.  This ensures that we don't introduce a lot
+                        // of artificial ridges into flat parts of a mesh.
+                        // On a manifold there is only one candidate, so
+                        // the normals are only needed here.
+                        const Vector3& n0 = faceNormal[(f0 >= 0) ? f0 : ~f0];
+                        float ndotn = faceNormal[(f1 >= 0) ? f1 : ~f1].dot(n0);
+                        for (int i = i1 - 1; i >= 0; --i) {
+                            const int f = faceIndexArray[i];
+                            if ((f >= 0) != (f0 >= 0)) {
+                                const float d = faceNormal[(f >= 0) ? f : ~f].dot(n0);
+                                if (d > ndotn) {
+                                    ndotn = d;
+                                    f1    = f;
+                                    i1    = i;
+                                }
+                            }
+                        }
+                    }
 
-                if ((f >= 0) != (f0 >= 0)) {
-                    // This face contains the oppositely oriented edge
-                    // and has not been assigned too many edges
+                    // Create the new edge
+                    const int e = numEdges;
+                    ++numEdges;
 
-                    const Vector3& n1 = faceNormal[(f >= 0) ? f : ~f];
-                    float d = n1.dot(n0);
+                    localEdge[h0]  = (f0 >= 0) ? e : ~e;
+                    assignment[h0] = begin + numAssigned;
+                    ++numAssigned;
 
                     if (found) {
-                        // We previously found a good face; see if this
-                        // one is better.
-                        if (d > ndotn) {
-                            // This face is better.
-                            ndotn = d;
-                            f1    = f;
-                            i1    = i;
-                        }
-                    } else {
-                        // This is the first face we've found
-                        found = true;
-                        ndotn = d;
-                        f1    = f;
-                        i1    = i;
+                        // We found a matching face; remove both
+                        // faces from the active list.
+                        const int h1 = halfEdgeArray[i1];
+                        faceIndexArray.fastRemove(i1);
+                        halfEdgeArray.fastRemove(i1);
+
+                        localEdge[h1]  = (f1 >= 0) ? e : ~e;
+                        assignment[h1] = begin + numAssigned;
+                        ++numAssigned;
                     }
                 }
             }
 
-            // Create the new edge
-            int e = tempEdgeArray.size();
-            Edge& edge = tempEdgeArray.next();
-            
-            edge.vertexIndex[0] = cur.i0();
-            edge.vertexIndex[1] = cur.i1();
-
-            if (f0 >= 0) {
-                edge.faceIndex[0] = f0;
-                edge.faceIndex[1] = Face::NONE;
-                assignEdgeIndex(faceArray[f0], e); 
-            } else {
-                // The face indices above are two's complemented.
-                // this code restores them to regular indices.
-                debugAssert((~f0) >= 0);
-                edge.faceIndex[1] = ~f0;
-                edge.faceIndex[0] = Face::NONE;
-
-                // The edge index *does* need to be inverted, however.
-                assignEdgeIndex(faceArray[~f0], ~e); 
-            }
+            edgeOffset[v0] = numEdges;
+        }
+    });
+
+    {
+        int numEdges = 0;
+        for (int v = 0; v < numVertices; ++v) {
+            const int n = edgeOffset[v];
+            edgeOffset[v] = numEdges;
+            numEdges += n;
+        }
+        edgeOffset[numVertices] = numEdges;
+    }
 
-            if (found) {
-                // We found a matching face; remove both
-                // faces from the active list.
-                faceIndexArray.fastRemove(i1);
+    // Create the edges
+    Array<Edge> tempEdgeArray;
+    tempEdgeArray.resize(edgeOffset[numVertices]);
+    tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 1024), [&](const tbb::blocked_range<int>& r) {
+        for (int v0 = r.begin(); v0 < r.end(); ++v0) {
+            for (int k = halfEdgeOffset[v0]; k < halfEdgeOffset[v0 + 1]; ++k) {
+                const int h = halfEdge[k];
+                const int e = localEdge[h];
+                Edge& edge = tempEdgeArray[edgeOffset[v0] + ((e >= 0) ? e : ~e)];
+                edge.vertexIndex[0] = v0;
+                edge.vertexIndex[1] = highVertex[h];
+                edge.faceIndex[0]   = Face::NONE;
+                edge.faceIndex[1]   = Face::NONE;
+            }
 
-                if (f1 >= 0) {
-                    edge.faceIndex[0] = f1;
-                    assignEdgeIndex(faceArray[f1], e); 
+            for (int k = halfEdgeOffset[v0]; k < halfEdgeOffset[v0 + 1]; ++k) {
+                const int h = halfEdge[k];
+                const int e = localEdge[h];
+                if (e >= 0) {
+                    tempEdgeArray[edgeOffset[v0] + e].faceIndex[0] = h / 3;
                 } else {
-                    edge.faceIndex[1] = ~f1;
-                    assignEdgeIndex(faceArray[~f1], ~e); 
+                    tempEdgeArray[edgeOffset[v0] + ~e].faceIndex[1] = h / 3;
                 }
             }
         }
+    });
 
-        ++cur;
-    }
-
-    edgeTable.clear();
-
-    // Move boundary edges to the end of the list and then
-    // clean up the face references into them
+    // Move boundary edges to the end of the list
+    Array<int> newIndex;
+    newIndex.resize(tempEdgeArray.size());
     {
-        // Map old edge indices to new edge indices
-        Array<int> newIndex;
-        newIndex.resize(tempEdgeArray.size());
-
         // Index of the start and end of the edge array
         int i = 0;
         int j = tempEdgeArray.size() - 1;
 
-        edgeArray.resize(tempEdgeArray.size());
         for (int e = 0; e < tempEdgeArray.size(); ++e) {
             if (tempEdgeArray[e].boundary()) {
                 newIndex[e] = j;
@@ -371,58 +288,101 @@ void MeshAlg::computeAdjacency(
                 newIndex[e] = i;
                 ++i;
             }
-            edgeArray[newIndex[e]] = tempEdgeArray[e];
         }
 
         debugAssertM(i == j + 1, "Counting from front and back of array did not match");
+    }
+
+    edgeArray.resize(tempEdgeArray.size());
+    tbb::parallel_for(tbb::blocked_range<int>(0, tempEdgeArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int e = r.begin(); e < r.end(); ++e) {
+            edgeArray[newIndex[e]] = tempEdgeArray[e];
+        }
+    });
 
-        // Fix the faces
-        for (int f = 0; f < faceArray.size(); ++f) {
+    tbb::parallel_for(tbb::blocked_range<int>(0, numFaces, 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
             Face& face = faceArray[f];
+
+            // The face's edges, in the order that they were assigned to it
+            int order[3] = {3 * f, 3 * f + 1, 3 * f + 2};
+            for (int a = 1; a < 3; ++a) {
+                for (int b = a; (b > 0) && (assignment[order[b - 1]] > assignment[order[b]]); --b) {
+                    std::swap(order[b - 1], order[b]);
+                }
+            }
+
             for (int q = 0; q < 3; ++q) {
-                int e = face.edgeIndex[q];
+                const int h = order[q];
+                const int e = localEdge[h];
                 if (e < 0) {
                     // Backwards edge; twiddle before and after conversion
-                    face.edgeIndex[q] = ~newIndex[~e];
+                    face.edgeIndex[q] = ~newIndex[edgeOffset[lowVertex[h]] + ~e];
                 } else {
-                    // Regular edge; remap the index
-                    face.edgeIndex[q] = newIndex[e];
+                    face.edgeIndex[q] = newIndex[edgeOffset[lowVertex[h]] + e];
                 }
             }
-        }
-    }
 
-    // Now order the edge indices inside the faces correctly.
-    for (int f = 0; f < faceArray.size(); ++f) {
-        Face& face = faceArray[f];
-        int e0 = face.edgeIndex[0];
-        int e1 = face.edgeIndex[1];
-        int e2 = face.edgeIndex[2];
+            // Now order the edge indices inside the face correctly.
+            const int e0 = face.edgeIndex[0];
+            const int e1 = face.edgeIndex[1];
+            const int e2 = face.edgeIndex[2];
 
-        // e0 will always remain first.  The only 
-        // question is whether e1 and e2 should be swapped.
+            // e0 will always remain first.  The only 
+            // question is whether e1 and e2 should be swapped.
     
-        // See if e1 begins at the vertex where e1 ends.
-        const int e0End = (e0 < 0) ? 
-            edgeArray[~e0].vertexIndex[0] :
-            edgeArray[e0].vertexIndex[1];
-
-        const int e1Begin = (e1 < 0) ? 
-            edgeArray[~e1].vertexIndex[1] :
-            edgeArray[e1].vertexIndex[0];
-
-        if (e0End != e1Begin) {
-            // We must swap e1 and e2
-            face.edgeIndex[1] = e2;
-            face.edgeIndex[2] = e1;
+            // See if e1 begins at the vertex where e1 ends.
+            const int e0End = (e0 < 0) ? 
+                edgeArray[~e0].vertexIndex[0] :
+                edgeArray[e0].vertexIndex[1];
+
+            const int e1Begin = (e1 < 0) ? 
+                edgeArray[~e1].vertexIndex[1] :
+                edgeArray[e1].vertexIndex[0];
+
+            if (e0End != e1Begin) {
+                // We must swap e1 and e2
+                face.edgeIndex[1] = e2;
+                face.edgeIndex[2] = e1;
+            }
         }
+    });
+
+    // Fill out the face adjacency information in the vertex array, in face order
+    {
+        Array<int> cornerOffset;
+        Array<int> corner;
+        computeVertexCorners(indexArray, numVertices, cornerOffset, corner);
+        tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 4096), [&](const tbb::blocked_range<int>& r) {
+            for (int v = r.begin(); v < r.end(); ++v) {
+                for (int k = cornerOffset[v]; k < cornerOffset[v + 1]; ++k) {
+                    vertexArray[v].faceIndex.append(corner[k] / 3);
+                }
+            }
+        });
     }
 
-    // Fill out the edge adjacency information in the vertex array
-    for (int e = 0; e < edgeArray.size(); ++e) {
-        const Edge& edge = edgeArray[e];
-        vertexArray[edge.vertexIndex[0]].edgeIndex.append(e);
-        vertexArray[edge.vertexIndex[1]].edgeIndex.append(~e);
+    // Fill out the edge adjacency information in the vertex array, in edge order. 
+    // Endpoint 2 * e + i is vertex i of edge e.
+    {
+        Array<int> endpoint;
+        endpoint.resize(2 * edgeArray.size());
+        for (int e = 0; e < edgeArray.size(); ++e) {
+            endpoint[2 * e]     = edgeArray[e].vertexIndex[0];
+            endpoint[2 * e + 1] = edgeArray[e].vertexIndex[1];
+        }
+
+        Array<int> endpointOffset;
+        Array<int> sortedEndpoint;
+        computeVertexCorners(endpoint, numVertices, endpointOffset, sortedEndpoint);
+        tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 4096), [&](const tbb::blocked_range<int>& r) {
+            for (int v = r.begin(); v < r.end(); ++v) {
+                for (int k = endpointOffset[v]; k < endpointOffset[v + 1]; ++k) {
+                    const int c = sortedEndpoint[k];
+                    vertexArray[v].edgeIndex.append(((c & 1) == 0) ? (c >> 1) : ~(c >> 1));
+                }
+            }
+        });
     }
 }
 
@@ -0,0 +1,267 @@
+/**
+  @file MeshAlgVertexCache.cpp
+
+  The MeshAlg::optimizeVertexCache, computeVertexFetchRemap, and simulateVertexCache methods.
+
+  @maintainer Morgan McGuire, http://graphics.cs.williams.edu
+  @created 2026-10-18
+  @edited  2026-10-18
+
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+
+ */
+
+#include "G3D/MeshAlg.h"
+#include <cmath>
+
+namespace G3D {
+
+namespace _internal {
+
+/** Scoring function from Forsyth's linear-speed vertex cache optimization. Vertices that
+    are already in the modeled cache, and vertices with few remaining triangles, score highest. */
+class VertexCacheScore {
+public:
+    /** Size of the LRU cache that the score models */
+    enum {CACHE_SIZE = 32, MAX_VALENCE = 32};
+
+    float               cacheScore[CACHE_SIZE];
+    float               valenceScore[MAX_VALENCE + 1];
+
+    VertexCacheScore() {
+        static const float lastTriangleScore  = 0.75f;
+        static const float cacheDecayPower    = 1.5f;
+        static const float valenceBoostScale  = 2.0f;
+        static const float valenceBoostPower  = 0.5f;
+
+        for (int i = 0; i < CACHE_SIZE; ++i) {
+            if (i < 3) {
+                // The vertices of the triangle just drawn have a fixed score, so that
+                // the next triangle does not prefer to reuse exactly the same edge
+                cacheScore[i] = lastTriangleScore;
+            } else {
+                cacheScore[i] = ::powf(1.0f - float(i - 3) / float(CACHE_SIZE - 3), cacheDecayPower);
+            }
+        }
+
+        valenceScore[0] = 0.0f;
+        for (int i = 1; i <= MAX_VALENCE; ++i) {
+            valenceScore[i] = valenceBoostScale * ::powf(float(i), -valenceBoostPower);
+        }
+    }
+
+    float operator()(int cachePosition, int remainingValence) const {
+        if (remainingValence == 0) {
+            // No triangle will use this vertex again
+            return -1.0f;
+        }
+        const float score = (cachePosition >= 0) ? cacheScore[cachePosition] : 0.0f;
+        return score + valenceScore[min(remainingValence, (int)MAX_VALENCE)];
+    }
+};
+
+} // namespace _internal
+
+
+void MeshAlg::optimizeVertexCache(
+    Array<int>&         indexArray,
+    int                 numVertices) {
+
+    typedef _internal::VertexCacheScore Score;
+    static const Score score;
+    static const int CACHE_SIZE = Score::CACHE_SIZE;
+
+    const int numTriangles = indexArray.size() / 3;
+    if (numTriangles < 2) {
+        return;
+    }
+
+    // The triangles that use each vertex, in compressed rows. The first remaining[v]
+    // entries of each row are the triangles that have not yet been emitted.
+    Array<int> offset;
+    Array<int> remaining;
+    offset.resize(numVertices + 1);
+    remaining.resize(numVertices);
+    remaining.setAll(0);
+    for (int i = 0; i < numTriangles * 3; ++i) {
+        debugAssert((indexArray[i] >= 0) && (indexArray[i] < numVertices));
+        ++remaining[indexArray[i]];
+    }
+    offset[0] = 0;
+    for (int v = 0; v < numVertices; ++v) {
+        offset[v + 1] = offset[v] + remaining[v];
+        remaining[v] = 0;
+    }
+    Array<int> triangleOfVertex;
+    triangleOfVertex.resize(numTriangles * 3);
+    for (int i = 0; i < numTriangles * 3; ++i) {
+        const int v = indexArray[i];
+        triangleOfVertex[offset[v] + remaining[v]] = i / 3;
+        ++remaining[v];
+    }
+
+    Array<int> cachePosition;
+    Array<float> vertexScore;
+    cachePosition.resize(numVertices);
+    vertexScore.resize(numVertices);
+    for (int v = 0; v < numVertices; ++v) {
+        cachePosition[v] = -1;
+        vertexScore[v] = score(-1, remaining[v]);
+    }
+
+    Array<float> triangleScore;
+    Array<bool> emitted;
+    triangleScore.resize(numTriangles);
+    emitted.resize(numTriangles);
+    int best = 0;
+    for (int t = 0; t < numTriangles; ++t) {
+        triangleScore[t] = vertexScore[indexArray[3 * t]] + vertexScore[indexArray[3 * t + 1]] + vertexScore[indexArray[3 * t + 2]];
+        emitted[t] = false;
+        if (triangleScore[t] > triangleScore[best]) {
+            best = t;
+        }
+    }
+
+    // The modeled LRU cache, with room for the three vertices that are pushed past its end
+    int cache[CACHE_SIZE + 3];
+    int newCache[CACHE_SIZE + 3];
+    int cacheSize = 0;
+
+    Array<int> result;
+    result.resize(numTriangles * 3);
+
+    // Next triangle to consider when the cache holds no vertex with a remaining triangle
+    int cursor = 0;
+
+    for (int n = 0; n < numTriangles; ++n) {
+        if (best < 0) {
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = cursor;
+        }
+
+        const int* tri = indexArray.getCArray() + 3 * best;
+        result[3 * n] = tri[0];
+        result[3 * n + 1] = tri[1];
+        result[3 * n + 2] = tri[2];
+        emitted[best] = true;
+
+        // Put this triangle's vertices at the front of the cache and remove it from their rows
+        int newCacheSize = 0;
+        for (int j = 0; j < 3; ++j) {
+            const int v = tri[j];
+            int* row = triangleOfVertex.getCArray() + offset[v];
+            for (int k = 0; k < remaining[v]; ++k) {
+                if (row[k] == best) {
+                    row[k] = row[remaining[v] - 1];
+                    --remaining[v];
+                    break;
+                }
+            }
+
+            if ((newCacheSize == 0) || ((newCache[0] != v) && (newCache[newCacheSize - 1] != v))) {
+                newCache[newCacheSize] = v;
+                ++newCacheSize;
+            }
+        }
+        for (int i = 0; i < cacheSize; ++i) {
+            const int v = cache[i];
+            if ((v != tri[0]) && (v != tri[1]) && (v != tri[2])) {
+                newCache[newCacheSize] = v;
+                ++newCacheSize;
+            }
+        }
+
+        // Rescore the cached vertices and the triangles that use them, and choose the best
+        cacheSize = min(newCacheSize, CACHE_SIZE);
+        float bestScore = -finf();
+        best = -1;
+        for (int i = 0; i < newCacheSize; ++i) {
+            const int v = newCache[i];
+            cache[i] = v;
+            cachePosition[v] = (i < CACHE_SIZE) ? i : -1;
+            vertexScore[v] = score(cachePosition[v], remaining[v]);
+
+            const int* row = triangleOfVertex.getCArray() + offset[v];
+            for (int k = 0; k < remaining[v]; ++k) {
+                const int t = row[k];
+                const int* u = indexArray.getCArray() + 3 * t;
+                const float s = vertexScore[u[0]] + vertexScore[u[1]] + vertexScore[u[2]];
+                triangleScore[t] = s;
+                if (s > bestScore) {
+                    bestScore = s;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indexArray.swap(result);
+}
+
+
+void MeshAlg::computeVertexFetchRemap(
+    const Array<int>&   indexArray,
+    int                 numVertices,
+    Array<int>&         remap) {
+
+    remap.resize(numVertices);
+    remap.setAll(-1);
+
+    int next = 0;
+    for (int i = 0; i < indexArray.size(); ++i) {
+        int& r = remap[indexArray[i]];
+        if (r == -1) {
+            r = next;
+            ++next;
+        }
+    }
+
+    for (int v = 0; v < numVertices; ++v) {
+        if (remap[v] == -1) {
+            remap[v] = next;
+            ++next;
+        }
+    }
+}
+
+
+void MeshAlg::simulateVertexCache(
+    const Array<int>&   indexArray,
+    float&              acmr,
+    float&              atvr,
+    int                 cacheSize) {
+
+    int numVertices = 0;
+    for (int i = 0; i < indexArray.size(); ++i) {
+        numVertices = max(numVertices, indexArray[i] + 1);
+    }
+
+    // A vertex is in the FIFO while fewer than cacheSize vertices have been
+    // transformed since it was
+    static const int NEVER = -1;
+    Array<int> transformTime;
+    transformTime.resize(numVertices);
+    transformTime.setAll(NEVER);
+
+    int numTransforms = 0;
+    int numUnique = 0;
+    for (int i = 0; i < indexArray.size(); ++i) {
+        int& time = transformTime[indexArray[i]];
+        if (time == NEVER) {
+            ++numUnique;
+        }
+        if ((time == NEVER) || (numTransforms - time >= cacheSize)) {
+            time = numTransforms;
+            ++numTransforms;
+        }
+    }
+
+    const int numTriangles = indexArray.size() / 3;
+    acmr = (numTriangles > 0) ? float(numTransforms) / float(numTriangles) : 0.0f;
+    atvr = (numUnique > 0) ? float(numTransforms) / float(numUnique) : 0.0f;
+}
+
+} // namespace G3D
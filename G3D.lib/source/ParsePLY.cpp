@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2011-07-23
- \edited  2011-07-23
+ \edited  2026-10-18
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -13,6 +13,7 @@
 #include "G3D/FileSystem.h"
 #include "G3D/stringutils.h"
 #include "G3D/ParseError.h"
+#include "G3D/System.h"
 
 namespace G3D {
     
@@ -246,7 +247,117 @@ float ParsePLY::readAsFloat(const Property& prop, BinaryInput& bi) {
 }
 
 
+/** Unsigned integer type with the same size as the PLY data type being decoded */
+template<int bytes> struct UIntOfSize {};
+template<> struct UIntOfSize<1> { typedef uint8  type; };
+template<> struct UIntOfSize<2> { typedef uint16 type; };
+template<> struct UIntOfSize<4> { typedef uint32 type; };
+template<> struct UIntOfSize<8> { typedef uint64 type; };
+
+static inline uint8  flipBytes(uint8 x)  { return x; }
+static inline uint16 flipBytes(uint16 x) { return flipEndian16(x); }
+static inline uint32 flipBytes(uint32 x) { return flipEndian32(x); }
+static inline uint64 flipBytes(uint64 x) { return (uint64(flipEndian32(uint32(x))) << 32) | flipEndian32(uint32(x >> 32)); }
+
+
+/** Loads a possibly unaligned value of type T, swapping bytes if \a swap is true */
+template<class T, bool swap>
+static inline T loadValue(const uint8* src) {
+    typename UIntOfSize<sizeof(T)>::type bits;
+    memcpy(&bits, src, sizeof(T));
+    if (swap) {
+        bits = flipBytes(bits);
+    }
+    T value;
+    memcpy(&value, &bits, sizeof(T));
+    return value;
+}
+
+
+template<bool swap>
+static inline int loadAsInt(ParsePLY::DataType type, const uint8* src) {
+    switch (type) {
+    case ParsePLY::char_type:   return (int)*(const int8*)src;
+    case ParsePLY::uchar_type:  return (int)*src;
+    case ParsePLY::short_type:  return (int)loadValue<int16, swap>(src);
+    case ParsePLY::ushort_type: return (int)loadValue<uint16, swap>(src);
+    case ParsePLY::int_type:    return (int)loadValue<int32, swap>(src);
+    case ParsePLY::uint_type:   return (int)loadValue<uint32, swap>(src);
+    case ParsePLY::float_type:  return (int)loadValue<float32, swap>(src);
+    case ParsePLY::double_type: return (int)loadValue<float64, swap>(src);
+    default:                    return 0;
+    }
+}
+
+
+/** dst[v * dstStride] = src[v * srcStride] for \a count records */
+template<class T, bool swap>
+static void decodeColumn(const uint8* src, int srcStride, float* dst, int dstStride, int count) {
+    for (int v = 0; v < count; ++v) {
+        dst[v * dstStride] = (float)loadValue<T, swap>(src + v * srcStride);
+    }
+}
+
+
+template<bool swap>
+static void decodeColumn(ParsePLY::DataType type, const uint8* src, int srcStride, float* dst, int dstStride, int count) {
+    switch (type) {
+    case ParsePLY::char_type:   decodeColumn<int8, false>(src, srcStride, dst, dstStride, count);    break;
+    case ParsePLY::uchar_type:  decodeColumn<uint8, false>(src, srcStride, dst, dstStride, count);   break;
+    case ParsePLY::short_type:  decodeColumn<int16, swap>(src, srcStride, dst, dstStride, count);    break;
+    case ParsePLY::ushort_type: decodeColumn<uint16, swap>(src, srcStride, dst, dstStride, count);   break;
+    case ParsePLY::int_type:    decodeColumn<int32, swap>(src, srcStride, dst, dstStride, count);    break;
+    case ParsePLY::uint_type:   decodeColumn<uint32, swap>(src, srcStride, dst, dstStride, count);   break;
+    case ParsePLY::float_type:  decodeColumn<float32, swap>(src, srcStride, dst, dstStride, count);  break;
+    case ParsePLY::double_type: decodeColumn<float64, swap>(src, srcStride, dst, dstStride, count);  break;
+    default:
+        debugAssertM(false, "List properties do not have a fixed layout");
+    }
+}
+
+
+/** Copies \a count 32-bit words from \a src to \a dst, reversing the bytes of each. */
+static void byteSwap32(const uint8* src, float* dst, size_t count) {
+    size_t i = 0;
+
+    // SSE2 only: swap the bytes within each 16-bit half, then swap the halves
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), x);
+    }
+
+    for (; i < count; ++i) {
+        dst[i] = loadValue<float32, true>(src + i * 4);
+    }
+}
+
+
+bool ParsePLY::computeFixedLayout(const Array<Property>& prop, Array<int>& offset, int& stride) {
+    offset.resize(prop.size());
+    stride = 0;
+    for (int p = 0; p < prop.size(); ++p) {
+        if ((prop[p].type == list_type) || (prop[p].type == none_type)) {
+            return false;
+        }
+        offset[p] = stride;
+        stride += (int)byteSize(prop[p].type);
+    }
+    return true;
+}
+
+
 void ParsePLY::readVertexList(BinaryInput& bi) {
+    Array<int> offset;
+    int stride = 0;
+    if ((vertexProperty.size() > 0) && computeFixedLayout(vertexProperty, offset, stride)) {
+        readVertexListFixed(bi, offset, stride);
+        return;
+    }
+
+    // Some property is a list, so every vertex must be parsed serially
     const int N = vertexProperty.size();
     int i = 0;
     for (int v = 0; v < numVertices; ++v) {
@@ -258,24 +369,92 @@ void ParsePLY::readVertexList(BinaryInput& bi) {
 }
 
 
+void ParsePLY::readVertexListFixed(BinaryInput& bi, const Array<int>& offset, int stride) {
+    const int  N    = vertexProperty.size();
+    const bool swap = (bi.endian() != System::machineEndian());
+
+    // When every property is a float, the record layout is identical to vertexData
+    bool allFloat = true;
+    for (int p = 0; p < N; ++p) {
+        allFloat = allFloat && (vertexProperty[p].type == float_type);
+    }
+
+    const int verticesPerChunk = max(1, int(BULK_CHUNK_BYTES / stride));
+    static const int VERTICES_PER_TASK = 4096;
+
+    for (int first = 0; first < numVertices; first += verticesPerChunk) {
+        const int     count = min(verticesPerChunk, numVertices - first);
+        const uint8*  src   = bi.peekBytes(int64(count) * stride);
+        float*        dst   = vertexData + size_t(first) * N;
+
+        tbb::parallel_for(tbb::blocked_range<int>(0, count, VERTICES_PER_TASK), [&](const tbb::blocked_range<int>& r) {
+            const int     n        = r.end() - r.begin();
+            const uint8*  blockSrc = src + size_t(r.begin()) * stride;
+            float*        blockDst = dst + size_t(r.begin()) * N;
+
+            if (allFloat) {
+                if (swap) {
+                    byteSwap32(blockSrc, blockDst, size_t(n) * N);
+                } else {
+                    System::memcpy(blockDst, blockSrc, size_t(n) * N * sizeof(float));
+                }
+            } else {
+                // Decode one property at a time so that the type dispatch is out of the inner loop
+                for (int p = 0; p < N; ++p) {
+                    if (swap) {
+                        decodeColumn<true>(vertexProperty[p].type, blockSrc + offset[p], stride, blockDst + p, N, n);
+                    } else {
+                        decodeColumn<false>(vertexProperty[p].type, blockSrc + offset[p], stride, blockDst + p, N, n);
+                    }
+                }
+            }
+        });
+
+        bi.skip(int64(count) * stride);
+    }
+}
+
+
 void ParsePLY::readFaceList(BinaryInput& bi) {
     // How many properties are there before and after
     // the vertex_index list?
-    int numBefore = 0, numAfter = faceOrTriStripProperty.size() - 2;
+    int numBefore = 0;
+    while ((numBefore < faceOrTriStripProperty.size()) &&
+           (faceOrTriStripProperty[numBefore].name != "vertex_index") && 
+           (faceOrTriStripProperty[numBefore].name != "vertex_indices")) {
+        ++numBefore;
+    }
+
+    if (numBefore == faceOrTriStripProperty.size()) {
+        throw ParseError(bi.getFilename(), bi.getPosition(), "No vertex_index or vertex_indices property on faces in this PLY file");
+    }
+
+    const int numAfter = faceOrTriStripProperty.size() - numBefore - 1;
 
-    bool found = false;
+    const Property& indexProp = faceOrTriStripProperty[numBefore];
+
+    // If the index list is the only variable-length property, record boundaries can be
+    // found by a quick scan and the indices decoded in parallel
+    bool fixedOtherwise = (indexProp.type == list_type) && 
+        (indexProp.listLengthType != list_type) && (indexProp.listLengthType != none_type) &&
+        (indexProp.listElementType != list_type) && (indexProp.listElementType != none_type);
+    int before = 0, after = 0;
     for (int p = 0; p < faceOrTriStripProperty.size(); ++p) {
-        if ((faceOrTriStripProperty[p].name == "vertex_index") || 
-            (faceOrTriStripProperty[p].name == "vertex_indices")) {
-            found = true;
+        const DataType t = faceOrTriStripProperty[p].type;
+        if (p == numBefore) {
+            continue;
+        } else if ((t == list_type) || (t == none_type)) {
+            fixedOtherwise = false;
+        } else if (p < numBefore) {
+            before += (int)byteSize(t);
         } else {
-            ++numBefore;
-            --numAfter;
+            after += (int)byteSize(t);
         }
     }
 
-    if (! found) {
-        throw ParseError(bi.getFilename(), bi.getPosition(), "No vertex_index or vertex_indices property on faces in this PLY file");
+    if (fixedOtherwise) {
+        readFaceListFixed(bi, indexProp, before, after);
+        return;
     }
 
     // Only one of these is nonzero
@@ -294,6 +473,7 @@ void ParsePLY::readFaceList(BinaryInput& bi) {
         // Now read the index list
         const Property& prop = faceOrTriStripProperty[p];
         const int len = readAs<int>(prop.listLengthType, bi);
+        ++p;
 
         if (numFaces > 0) {
             // Read one face
@@ -321,5 +501,116 @@ void ParsePLY::readFaceList(BinaryInput& bi) {
     }
 }
 
+
+/** \param dst Face or TriStrip that has already been resized to \a len */
+template<bool swap, class IndexList>
+static void decodeIndexList(ParsePLY::DataType type, int elementSize, const uint8* src, int len, IndexList& dst) {
+    switch (type) {
+    case ParsePLY::int_type:
+    case ParsePLY::uint_type:
+        // By far the most common case
+        for (int i = 0; i < len; ++i) {
+            dst[i] = loadValue<int32, swap>(src + i * 4);
+        }
+        break;
+
+    default:
+        for (int i = 0; i < len; ++i) {
+            dst[i] = loadAsInt<swap>(type, src + i * elementSize);
+        }
+    }
+}
+
+
+void ParsePLY::readFaceListFixed(BinaryInput& bi, const Property& indexProp, int before, int after) {
+    const bool swap        = (bi.endian() != System::machineEndian());
+    const int  lengthSize  = (int)byteSize(indexProp.listLengthType);
+    const int  elementSize = (int)byteSize(indexProp.listElementType);
+
+    // Only one of these is nonzero
+    const int num = max(numFaces, numTriStrips);
+
+    static const int FACES_PER_TASK = 8192;
+
+    // Byte offset of each record in the current chunk
+    Array<int64> start;
+    int64 chunkBytes = BULK_CHUNK_BYTES;
+
+    int f = 0;
+    while (f < num) {
+        const int64   available = min(chunkBytes, bi.size() - bi.getPosition());
+        const uint8*  src       = bi.peekBytes(available);
+
+        // Serial pass: find the record boundaries by reading only the list lengths
+        start.fastClear();
+        int64 pos = 0;
+        while ((f + start.size() < num) && (pos + before + lengthSize <= available)) {
+            const int len = swap ? loadAsInt<true>(indexProp.listLengthType, src + pos + before) : 
+                                   loadAsInt<false>(indexProp.listLengthType, src + pos + before);
+            if (len < 0) {
+                throw ParseError(bi.getFilename(), bi.getPosition() + pos, "Negative index list length in PLY file");
+            }
+
+            const int64 recordBytes = before + lengthSize + int64(len) * elementSize + after;
+            if (pos + recordBytes > available) {
+                break;
+            }
+            start.append(pos);
+            pos += recordBytes;
+        }
+
+        if (start.size() == 0) {
+            if (available < chunkBytes) {
+                throw ParseError(bi.getFilename(), bi.getPosition(), "PLY file ended in the middle of a face");
+            }
+            // A single record was larger than the chunk
+            chunkBytes *= 2;
+            continue;
+        }
+
+        // Parallel pass: decode the indices
+        const int first = f;
+        tbb::parallel_for(tbb::blocked_range<int>(0, start.size(), FACES_PER_TASK), [&](const tbb::blocked_range<int>& r) {
+            for (int i = r.begin(); i < r.end(); ++i) {
+                const uint8* record = src + start[i] + before;
+                const int    len    = swap ? loadAsInt<true>(indexProp.listLengthType, record) : loadAsInt<false>(indexProp.listLengthType, record);
+                const uint8* list   = record + lengthSize;
+
+                if (numFaces > 0) {
+                    Face& face = faceArray[first + i];
+                    face.resize(len);
+                    if (swap) {
+                        decodeIndexList<true>(indexProp.listElementType, elementSize, list, len, face);
+                    } else {
+                        decodeIndexList<false>(indexProp.listElementType, elementSize, list, len, face);
+                    }
+#                   ifdef G3D_DEBUG
+                        for (int j = 0; j < len; ++j) {
+                            debugAssert(face[j] >= 0 && face[j] < numVertices);
+                        }
+#                   endif
+                } else {
+                    TriStrip& triStrip = triStripArray[first + i];
+                    triStrip.resize(len);
+                    if (swap) {
+                        decodeIndexList<true>(indexProp.listElementType, elementSize, list, len, triStrip);
+                    } else {
+                        decodeIndexList<false>(indexProp.listElementType, elementSize, list, len, triStrip);
+                    }
+#                   ifdef G3D_DEBUG
+                        for (int j = 0; j < len; ++j) {
+                            // -1 = "restart tristrip"
+                            debugAssert(triStrip[j] >= -1 && triStrip[j] < numVertices);
+                        }
+#                   endif
+                }
+            }
+        });
+
+        f += start.size();
+        bi.skip(pos);
+    }
+}
+
 } // G3D
 
@@ -0,0 +1,254 @@
+/**
+  \file G3D.lib/source/PhysicsFrameSplineBatch.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#include "G3D/PhysicsFrameSplineBatch.h"
+#include "G3D/Matrix4.h"
+#include <xmmintrin.h>
+
+namespace G3D {
+
+static void setCoefficient(float* c, const PhysicsFrame& f) {
+    c[0] = f.translation.x;
+    c[1] = f.translation.y;
+    c[2] = f.translation.z;
+    c[3] = 0.0f;
+    c[4] = f.rotation.x;
+    c[5] = f.rotation.y;
+    c[6] = f.rotation.z;
+    c[7] = f.rotation.w;
+}
+
+
+void PhysicsFrameSplineBatch::compile(const PhysicsFrameSpline& spline, Track& track) {
+    const int N = spline.control.size();
+    const bool cyclic = (spline.extrapolationMode == SplineExtrapolationMode::CYCLIC);
+
+    track.firstSegment = m_segment.size();
+    track.firstTime    = m_segmentTime.size();
+    track.duration     = cyclic ? spline.duration() : 0.0f;
+    track.spline       = spline;
+    track.lastSegment  = 0;
+
+    if (N < 2) {
+        // Constant over all time. The times are infinite so that the segment is always found,
+        // and Segment::start is zero so that u is finite.
+        track.numSegments = 1;
+        track.duration = 0.0f;
+        Segment& segment = m_segment.next();
+        System::memset(&segment, 0, sizeof(Segment));
+        segment.start = 0.0f;
+        segment.invLength = 0.0f;
+        setCoefficient(segment.coefficient[3], (N == 0) ? PhysicsFrame() : spline.control[0]);
+        m_segmentTime.append(-finf(), finf());
+        return;
+    }
+
+    if (cyclic && ! (track.duration > 0.0f)) {
+        // Degenerate period; always delegate to the spline
+        track.numSegments = 0;
+        track.duration = 0.0f;
+        m_segmentTime.append(finf());
+        return;
+    }
+
+    static const Matrix4 basis = SplineBase::computeBasis();
+
+    // A cyclic spline has an extra segment from the last control point back to the first
+    track.numSegments = cyclic ? N : N - 1;
+    for (int i = 0; i < track.numSegments; ++i) {
+        // Mirrors Spline::evaluate
+        PhysicsFrame p[4];
+        float        t[4];
+        for (int j = 0; j < 4; ++j) {
+            spline.getControl(i - 1 + j, t[j], p[j]);
+        }
+        spline.ensureShortestPath(p, 4);
+
+        PhysicsFrame C[4];
+        if (spline.interpolationMode == SplineInterpolationMode::LINEAR) {
+            C[0] = p[0] * 0.0f;
+            C[1] = C[0];
+            C[2] = p[2] + p[1] * -1.0f;
+            C[3] = p[1];
+        } else {
+            const float dt0 = t[1] - t[0];
+            const float dt1 = t[2] - t[1];
+            const float dt2 = t[3] - t[2];
+
+            const float x  = (dt0 + dt1) * 0.5f;
+            const float n0 = x / dt0;
+            const float n1 = x / dt1;
+            const float n2 = x / dt2;
+
+            const PhysicsFrame& dp0 = p[1] + (p[0] * -1.0f);
+            const PhysicsFrame& dp1 = p[2] + (p[1] * -1.0f);
+            const PhysicsFrame& dp2 = p[3] + (p[2] * -1.0f);
+
+            const PhysicsFrame& dp1n1 = dp1 * n1;
+            const PhysicsFrame  point[4] = {dp0 * n0 + dp1n1, p[1], p[2], dp1n1 + dp2 * n2};
+
+            // Spline::evaluate weights the points by (u^3, u^2, u, 1) * basis, so the
+            // coefficient of u^(3 - k) is row k of the basis applied to the points
+            for (int k = 0; k < 4; ++k) {
+                C[k] = point[0] * basis[k][0] + point[1] * basis[k][1] + point[2] * basis[k][2] + point[3] * basis[k][3];
+            }
+        }
+
+        Segment& segment = m_segment.next();
+        segment.start = t[1];
+        segment.invLength = 1.0f / (t[2] - t[1]);
+        for (int k = 0; k < 4; ++k) {
+            setCoefficient(segment.coefficient[k], C[k]);
+        }
+        m_segmentTime.append(t[1]);
+
+        if (i == track.numSegments - 1) {
+            m_segmentTime.append(t[2]);
+        }
+    }
+}
+
+
+void PhysicsFrameSplineBatch::compact() {
+    Array<Track> old;
+    Array<Track>::swap(old, m_track);
+    clear();
+    for (int i = 0; i < old.size(); ++i) {
+        append(old[i].spline);
+    }
+}
+
+
+void PhysicsFrameSplineBatch::clear() {
+    m_track.fastClear();
+    m_segment.fastClear();
+    m_segmentTime.fastClear();
+    m_numUnusedSegments = 0;
+}
+
+
+int PhysicsFrameSplineBatch::append(const PhysicsFrameSpline& spline) {
+    compile(spline, m_track.next());
+    return m_track.size() - 1;
+}
+
+
+void PhysicsFrameSplineBatch::set(int index, const PhysicsFrameSpline& spline) {
+    // The old segments are abandoned in place so that other tracks do not move
+    m_numUnusedSegments += m_track[index].numSegments;
+    compile(spline, m_track[index]);
+
+    if (m_numUnusedSegments > m_segment.size() / 2) {
+        compact();
+    }
+}
+
+
+int PhysicsFrameSplineBatch::findSegment(const Track& track, float s) const {
+    const float* T = m_segmentTime.getCArray() + track.firstTime;
+    const int    n = track.numSegments;
+
+    // Time usually advances by less than a segment between calls
+    int i = track.lastSegment;
+    if (T[i] <= s) {
+        if (s < T[i + 1]) {
+            return i;
+        } else if ((i + 1 < n) && (s < T[i + 2])) {
+            track.lastSegment = i + 1;
+            return i + 1;
+        }
+    }
+
+    // Binary search for the last segment that starts at or before s
+    int lo = 0;
+    int hi = n - 1;
+    while (lo < hi) {
+        const int mid = (lo + hi + 1) / 2;
+        if (T[mid] <= s) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    track.lastSegment = lo;
+    return lo;
+}
+
+
+/** Evaluates the translation and rotation polynomials by Horner's rule and unitizes the rotation */
+static void evaluateSegment(const float coefficient[4][8], float u, PhysicsFrame& result) {
+    const __m128 U = _mm_set1_ps(u);
+    __m128 t = _mm_loadu_ps(coefficient[0]);
+    __m128 q = _mm_loadu_ps(coefficient[0] + 4);
+    for (int k = 1; k < 4; ++k) {
+        t = _mm_add_ps(_mm_mul_ps(t, U), _mm_loadu_ps(coefficient[k]));
+        q = _mm_add_ps(_mm_mul_ps(q, U), _mm_loadu_ps(coefficient[k] + 4));
+    }
+
+    // Horizontal sum of q * q in every lane
+    __m128 d = _mm_mul_ps(q, q);
+    d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+    d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+    q = _mm_div_ps(q, _mm_sqrt_ps(d));
+
+    float out[8];
+    _mm_storeu_ps(out, t);
+    _mm_storeu_ps(out + 4, q);
+    result.translation = Vector3(out[0], out[1], out[2]);
+    result.rotation    = Quat(out[4], out[5], out[6], out[7]);
+}
+
+
+PhysicsFrame PhysicsFrameSplineBatch::evaluate(int index, float s) const {
+    const Track& track = m_track[index];
+    const float* T = m_segmentTime.getCArray() + track.firstTime;
+
+    if (track.duration > 0.0f) {
+        // Cyclic; reduce to the first period
+        if ((s < T[0]) || (s >= T[0] + track.duration)) {
+            const int wraps = iFloor((s - T[0]) / track.duration);
+            s -= track.duration * wraps;
+        }
+    } else if ((track.numSegments == 0) || ! ((s >= T[0]) && (s < T[track.numSegments]))) {
+        // Extrapolating (or NaN)
+        return track.spline.evaluate(s);
+    }
+
+    const Segment& segment = m_segment[track.firstSegment + findSegment(track, s)];
+    PhysicsFrame result;
+    evaluateSegment(segment.coefficient, (s - segment.start) * segment.invLength, result);
+    return result;
+}
+
+
+void PhysicsFrameSplineBatch::evaluate(float s, Array<PhysicsFrame>& result) const {
+    result.resize(m_track.size());
+    tbb::parallel_for(tbb::blocked_range<int>(0, m_track.size(), 512), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            result[i] = evaluate(i, s);
+        }
+    });
+}
+
+
+void PhysicsFrameSplineBatch::evaluate(const Array<float>& s, Array<PhysicsFrame>& result) const {
+    debugAssertM(s.size() == m_track.size(), "Wrong number of times");
+    result.resize(m_track.size());
+    tbb::parallel_for(tbb::blocked_range<int>(0, m_track.size(), 512), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            result[i] = evaluate(i, s[i]);
+        }
+    });
+}
+
+} // namespace G3D
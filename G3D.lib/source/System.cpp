@@ -79,6 +79,9 @@
 
 // SIMM include
 #include <xmmintrin.h>
+#ifdef _MSC_VER
+#   include <immintrin.h>
+#endif
 
 
 namespace G3D {
@@ -119,6 +122,7 @@ System::System() :
     m_hasSSE(false),
     m_hasSSE2(false),
     m_hasSSE3(false),
+    m_hasAVX(false),
     m_has3DNOW(false),
     m_has3DNOW2(false),
     m_hasAMDMMX(false),
@@ -579,6 +583,22 @@ static bool checkForCPUID() {
 }
 
 
+/** Reads the XCR0 extended control register, which reports the register
+    state that the OS saves. Only call when CPUID reports OSXSAVE. */
+static uint64 readXCR0() {
+#   if defined(_MSC_VER)
+        return (uint64)_xgetbv(0);
+#   elif ! defined(G3D_OSX) || defined(G3D_OSX_INTEL)
+        uint32 eax = 0, edx = 0;
+        // xgetbv, encoded directly for older assemblers
+        asm volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (uint64(edx) << 32) | eax;
+#   else
+        return 0;
+#   endif
+}
+
+
 void System::getStandardProcessorExtensions() {
 #if ! defined(G3D_OSX) || defined(G3D_OSX_INTEL)
     if (! m_hasCPUID) {
@@ -599,6 +619,13 @@ void System::getStandardProcessorExtensions() {
 
     m_hasSSE3     = checkBit(ecxreg, 0);
 
+    // AVX also requires that the OS saves the YMM registers on context switches
+    // (OSXSAVE, and XCR0 bits 1 and 2 set)
+    m_hasAVX      = false;
+    if (checkBit(ecxreg, 28) && checkBit(ecxreg, 27)) {
+        m_hasAVX  = ((readXCR0() & 0x6) == 0x6);
+    }
+
     if (m_highestCPUIDFunction >= CPUID_EXTENDED_FEATURES) {
         cpuid(CPUID_EXTENDED_FEATURES, eaxreg, ebxreg, ecxreg, features);
         m_hasAMDMMX = checkBit(features, 22);  // Only on AMD
@@ -1710,6 +1737,7 @@ void System::describeSystem(
         var(t, "hasSSE", System::hasSSE());
         var(t, "hasSSE2", System::hasSSE2());
         var(t, "hasSSE3", System::hasSSE3());
+        var(t, "hasAVX", System::hasAVX());
         var(t, "has3DNow", System::has3DNow());
         var(t, "hasRDTSC", System::hasRDTSC());
         var(t, "numCores", System::numCores());
@@ -0,0 +1,225 @@
+/**
+  \file ZipfileCache.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+ */
+#include "G3D/ZipfileCache.h"
+#include "G3D/FileSystem.h"
+#include "G3D/stringutils.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "zip.h"
+
+#ifdef G3D_WINDOWS
+#    define stat64 _stat64
+#endif
+
+namespace G3D {
+
+GMutex ZipfileCache::s_mutex;
+
+/** Returns false if \a filename does not exist */
+static bool statZipfile(const String& filename, int64& modificationTime, int64& fileSize) {
+    struct stat64 st;
+    if (stat64(filename.c_str(), &st) == -1) {
+        return false;
+    }
+    modificationTime = (int64)st.st_mtime;
+    fileSize         = (int64)st.st_size;
+    return true;
+}
+
+
+/** Case-insensitive lookup key for a name inside of a zipfile */
+static String entryKey(const String& name) {
+    return toLower(FilePath::canonicalize(name));
+}
+
+
+ZipfileCache::Archive::Archive(const String& filename, int64 modificationTime, int64 fileSize) :
+    m_filename(filename),
+    m_modificationTime(modificationTime),
+    m_fileSize(fileSize) {}
+
+
+ZipfileCache::Archive::~Archive() {
+    for (int i = 0; i < m_freeHandle.size(); ++i) {
+        zip_close(m_freeHandle[i]);
+    }
+    m_freeHandle.clear();
+}
+
+
+shared_ptr<ZipfileCache::Archive> ZipfileCache::Archive::create(const String& filename, int64 modificationTime, int64 fileSize) {
+    // Only the first open of an archive pays for the consistency check
+    struct zip* z = zip_open(filename.c_str(), ZIP_CHECKCONS, nullptr);
+    if (isNull(z)) {
+        return nullptr;
+    }
+
+    const shared_ptr<Archive>& archive = createShared<Archive>(filename, modificationTime, fileSize);
+
+    const int count = (int)zip_get_num_entries(z, 0);
+    archive->m_entry.resize(count);
+    for (int i = 0; i < count; ++i) {
+        struct zip_stat info;
+        zip_stat_init(&info);
+        zip_stat_index(z, i, 0, &info);
+
+        Entry& entry = archive->m_entry[i];
+        entry.name = FilePath::canonicalize(info.name);
+        entry.size = (int64)info.size;
+
+        // Keep the first of any duplicate names, matching zip_name_locate
+        bool created = false;
+        int& index = archive->m_index.getCreate(entryKey(entry.name), created);
+        if (created) {
+            index = i;
+        }
+    }
+
+    archive->m_freeHandle.append(z);
+    return archive;
+}
+
+
+int ZipfileCache::Archive::find(const String& name) const {
+    const int* i = m_index.getPointer(entryKey(name));
+    return isNull(i) ? -1 : *i;
+}
+
+
+struct zip* ZipfileCache::Archive::acquireHandle() const {
+    struct zip* z = nullptr;
+
+    m_handleLock.lock();
+    if (m_freeHandle.size() > 0) {
+        z = m_freeHandle.pop();
+    }
+    m_handleLock.unlock();
+
+    if (isNull(z)) {
+        // Every handle is in use by another thread, so open another one. The directory was
+        // already validated when the archive was created.
+        z = zip_open(m_filename.c_str(), 0, nullptr);
+    }
+
+    return z;
+}
+
+
+void ZipfileCache::Archive::releaseHandle(struct zip* z) const {
+    m_handleLock.lock();
+    m_freeHandle.append(z);
+    m_handleLock.unlock();
+}
+
+
+bool ZipfileCache::Archive::read(int i, void* buffer) const {
+    debugAssert(i >= 0 && i < m_entry.size());
+
+    struct zip* z = acquireHandle();
+    if (isNull(z)) {
+        return false;
+    }
+
+    bool success = false;
+    struct zip_file* zf = zip_fopen_index(z, i, 0);
+    if (notNull(zf)) {
+        const int64 bytesRead = zip_fread(zf, buffer, m_entry[i].size);
+        success = (bytesRead == m_entry[i].size);
+        zip_fclose(zf);
+    }
+
+    releaseHandle(z);
+    return success;
+}
+
+/////////////////////////////////////////////////////////////
+
+Table<String, shared_ptr<ZipfileCache::Archive>>& ZipfileCache::table() {
+    static Table<String, shared_ptr<Archive>> t;
+    return t;
+}
+
+
+String ZipfileCache::key(const String& path) {
+    const String& k = FilePath::canonicalize(FilePath::removeTrailingSlash(FileSystem::resolve(path)));
+#   ifdef G3D_WINDOWS
+        return toLower(k);
+#   else
+        return k;
+#   endif
+}
+
+
+shared_ptr<ZipfileCache::Archive> ZipfileCache::archive(const String& zipfile) {
+    // Resolve the path before taking the lock. FileSystem may call into this
+    // class while holding its own lock, so never call FileSystem while holding s_mutex.
+    const String& filename = FilePath::removeTrailingSlash(FilePath::expandEnvironmentVariables(zipfile));
+    const String& k = key(filename);
+
+    int64 modificationTime = 0, fileSize = 0;
+    if (! statZipfile(filename, modificationTime, fileSize)) {
+        return nullptr;
+    }
+
+    shared_ptr<Archive> a;
+    s_mutex.lock();
+    table().get(k, a);
+    s_mutex.unlock();
+
+    if (notNull(a) && (a->m_modificationTime == modificationTime) && (a->m_fileSize == fileSize)) {
+        return a;
+    }
+
+    // Open outside of the lock so that other archives remain accessible while the
+    // (potentially large) central directory is parsed
+    a = Archive::create(filename, modificationTime, fileSize);
+
+    s_mutex.lock();
+    if (isNull(a)) {
+        table().remove(k);
+    } else {
+        shared_ptr<Archive>& current = table().getCreate(k);
+        if (notNull(current) && (current->m_modificationTime == modificationTime) && (current->m_fileSize == fileSize)) {
+            // Another thread opened the same version first; share its handles
+            a = current;
+        } else {
+            current = a;
+        }
+    }
+    s_mutex.unlock();
+
+    return a;
+}
+
+
+void ZipfileCache::clear(const String& path) {
+    const String& expanded = FilePath::expandEnvironmentVariables(path);
+
+    if ((expanded == "") || FilePath::isRoot(expanded)) {
+        s_mutex.lock();
+        table().clear();
+        s_mutex.unlock();
+        return;
+    }
+
+    const String& prefix      = key(expanded);
+    const String& prefixSlash = prefix + "/";
+
+    s_mutex.lock();
+    Array<String> keys;
+    table().getKeys(keys);
+    for (int k = 0; k < keys.size(); ++k) {
+        if ((keys[k] == prefix) || beginsWith(keys[k], prefixSlash)) {
+            table().remove(keys[k]);
+        }
+    }
+    s_mutex.unlock();
+}
+
+} // namespace G3D
@@ -4,7 +4,7 @@
  @author Morgan McGuire, graphics3d.com
  
  @author  2002-06-06
- @edited  2010-02-05
+ @edited  2026-10-18
  */
 
 #include <cstring>
@@ -18,10 +18,10 @@
 #include "G3D/Set.h"
 #include "G3D/g3dfnmatch.h"
 #include "G3D/FileSystem.h"
+#include "G3D/ZipfileCache.h"
 
 #include <sys/stat.h>
 #include <sys/types.h>
-#include "zip.h"
 
 #ifdef G3D_WINDOWS
    // Needed for _getcwd
@@ -135,31 +135,25 @@ String readWholeFile(const String& filename) {
 
         // Zipfiles require Unix-style slashes
         String internalFile = FilePath::canonicalize(filename.substr(zipfile.length() + 1));
-        struct zip* z = zip_open(zipfile.c_str(), ZIP_CHECKCONS, NULL);
-        {
-            struct zip_stat info;
-            zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-            zip_stat(z, internalFile.c_str(), ZIP_FL_NOCASE, &info);
-
-            // Add NULL termination
-            char* buffer = reinterpret_cast<char*>(System::alignedMalloc(info.size + 1, 16));
-            buffer[info.size] = '\0';
-
-            struct zip_file* zf = zip_fopen( z, internalFile.c_str(), ZIP_FL_NOCASE );
-            if (zf == NULL) {
-                throw String("\"") + internalFile + "\" inside \"" + zipfile + "\" could not be opened.";
-            } else {
-                const int64 bytesRead = zip_fread( zf, buffer, (info.size));
-                debugAssertM((int64)bytesRead == (int64)info.size,
-                             internalFile + " was corrupt because it unzipped to the wrong size.");
-                (void)bytesRead;
-                zip_fclose( zf );
-            }
-            // Copy the string
-            s = buffer;
-            System::alignedFree(buffer);
+        const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(zipfile);
+        const int index = isNull(archive) ? -1 : archive->find(internalFile);
+        if (index == -1) {
+            throw String("\"") + internalFile + "\" inside \"" + zipfile + "\" could not be opened.";
         }
-        zip_close( z );
+
+        const int64 length = archive->entry(index).size;
+
+        // Add NULL termination
+        char* buffer = reinterpret_cast<char*>(System::alignedMalloc(length + 1, 16));
+        buffer[length] = '\0';
+
+        const bool success = archive->read(index, buffer);
+        debugAssertM(success, internalFile + " was corrupt because it unzipped to the wrong size.");
+        (void)success;
+
+        // Copy the string
+        s = buffer;
+        System::alignedFree(buffer);
     }
 
     return s;
@@ -173,20 +167,9 @@ int64 fileLength(const String& filename) {
     if (result == -1) {
         String zip, contents;
         if(zipfileExists(filename, zip, contents)){
-            int64 requiredMem;
-
-                        struct zip *z = zip_open( zip.c_str(), ZIP_CHECKCONS, NULL );
-                        debugAssertM(z != NULL, zip + ": zip open failed.");
-            {
-                                struct zip_stat info;
-                                zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-                                int success = zip_stat( z, contents.c_str(), ZIP_FL_NOCASE, &info );
-                (void)success;
-                                debugAssertM(success == 0, zip + ": " + contents + ": zip stat failed.");
-                                requiredMem = info.size;
-            }
-                        zip_close( z );
-            return requiredMem;
+            const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(zip);
+            debugAssertM(notNull(archive), zip + ": zip open failed.");
+            return isNull(archive) ? -1 : archive->size(contents);
         } else {
         return -1;
         }
@@ -309,15 +292,8 @@ static void _zip_resolveDirectory(String& completeDir, const String& drive, cons
 
 /** assumes that zipDir references a .zip file */
 static bool _zip_zipContains(const String& zipDir, const String& desiredFile){
-        struct zip *z = zip_open( zipDir.c_str(), ZIP_CHECKCONS, NULL );
-    //the last parameter, an int, determines case sensitivity:
-    //1 is sensitive, 2 is not, 0 is default
-        int test = zip_name_locate( z, desiredFile.c_str(), ZIP_FL_NOCASE );
-        zip_close( z );
-    if(test == -1){
-        return false;
-    }
-    return true;
+    const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(zipDir);
+    return notNull(archive) && archive->contains(desiredFile);
 }
 
 
@@ -752,20 +728,17 @@ static void getFileOrDirListZip(const String& path,
                                 Array<String>& files,
                                 bool wantFiles,
                                 bool includePath){
-    struct zip *z = zip_open( path.c_str(), ZIP_CHECKCONS, NULL );
+    const shared_ptr<ZipfileCache::Archive>& archive = ZipfileCache::archive(path);
+    if (isNull(archive)) {
+        return;
+    }
 
     Set<String> fileSet;
 
-    int count = zip_get_num_files( z );
-    for( int i = 0; i < count; ++i ) {
-        struct zip_stat info;
-        zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-        zip_stat_index( z, i, ZIP_FL_NOCASE, &info );
-        _zip_addEntry(path, prefix, info.name, fileSet, wantFiles, includePath);
+    for (int i = 0; i < archive->numEntries(); ++i) {
+        _zip_addEntry(path, prefix, archive->entry(i).name, fileSet, wantFiles, includePath);
     }
     
-    zip_close( z );
-    
     fileSet.getMembers(files);
 }
 
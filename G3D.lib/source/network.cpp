@@ -13,6 +13,12 @@
 #   include <netdb.h>
 
 
+#endif
+#ifdef G3D_WINDOWS
+    typedef int socklen_t;
+#else
+#   include <poll.h>
+#   include <sys/socket.h>
 #endif
 #include "enet/enet.h"
 
@@ -65,6 +71,118 @@ namespace _internal {
 }
 static Array< weak_ptr<_internal::NetClientSideConnection> > s_allClientConnections;
 
+/** Sockets of all client and server enet hosts, collected by serviceNetwork() for the network thread
+    to wait on. Protected by s_allServerAndClientConnectionMutex. */
+static Array<ENetSocket> s_hostSocket;
+
+/** Upper bound on the time that the network thread blocks without servicing enet, which must
+    periodically process its own timers for resending, pings, and timeouts. */
+static const int MAX_NETWORK_WAIT_MILLISECONDS = 10;
+
+/** Loopback datagram socket that becomes readable when the network thread has work to do.
+    Created by initializeNetwork(). enet's portable socket API is used so that the network thread
+    can wait on it together with the host sockets on every platform. */
+static ENetSocket       s_wakeupSocket = ENET_SOCKET_NULL;
+static ENetAddress      s_wakeupAddress;
+
+/** 1 while a wakeup datagram is pending, so that a burst of send() calls makes at most one system call */
+static AtomicInt32      s_wakeupPending;
+
+/** Makes the network thread service the network immediately instead of waiting for socket activity.
+    Safe to call from any thread. */
+static void wakeNetworkThread() {
+    if ((s_wakeupSocket != ENET_SOCKET_NULL) && (s_wakeupPending.compareAndSet(0, 1) == 0)) {
+        uint8 b = 0;
+        ENetBuffer buffer;
+        buffer.data = &b;
+        buffer.dataLength = 1;
+        enet_socket_send(s_wakeupSocket, &s_wakeupAddress, &buffer, 1);
+    }
+}
+
+
+static void createWakeupSocket() {
+    s_wakeupSocket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+    if (s_wakeupSocket == ENET_SOCKET_NULL) {
+        return;
+    }
+
+    enet_address_set_host(&s_wakeupAddress, "127.0.0.1");
+    s_wakeupAddress.port = 0;
+
+    struct sockaddr_in sin;
+    socklen_t sinLength = sizeof(sin);
+    if ((enet_socket_bind(s_wakeupSocket, &s_wakeupAddress) != 0) ||
+        (getsockname(s_wakeupSocket, (struct sockaddr*)&sin, &sinLength) != 0)) {
+        logPrintf("Warning: could not create the network thread wakeup socket; falling back to polling\n");
+        enet_socket_destroy(s_wakeupSocket);
+        s_wakeupSocket = ENET_SOCKET_NULL;
+        return;
+    }
+
+    // Bound to an ephemeral port
+    s_wakeupAddress.port = ENET_NET_TO_HOST_16(sin.sin_port);
+    enet_socket_set_option(s_wakeupSocket, ENET_SOCKOPT_NONBLOCK, 1);
+}
+
+
+static void destroyWakeupSocket() {
+    if (s_wakeupSocket != ENET_SOCKET_NULL) {
+        enet_socket_destroy(s_wakeupSocket);
+        s_wakeupSocket = ENET_SOCKET_NULL;
+    }
+}
+
+
+#ifdef G3D_WINDOWS
+    typedef WSAPOLLFD PollDescriptor;
+    static int pollSockets(PollDescriptor* descriptor, int count, int timeout) {
+        return WSAPoll(descriptor, (ULONG)count, timeout);
+    }
+#else
+    typedef struct pollfd PollDescriptor;
+    static int pollSockets(PollDescriptor* descriptor, int count, int timeout) {
+        return poll(descriptor, (nfds_t)count, timeout);
+    }
+#endif
+
+/** Blocks the network thread until any enet host socket is readable, wakeNetworkThread() is invoked,
+    or enet's timers need servicing. \a descriptor is scratch space reused between calls. */
+static void waitForNetworkEvents(Array<PollDescriptor>& descriptor) {
+    if (s_wakeupSocket == ENET_SOCKET_NULL) {
+        // Without a wakeup signal, new sends would wait for the timeout
+        System::sleep(0);
+        return;
+    }
+
+    descriptor.fastClear();
+    s_allServerAndClientConnectionMutex.lock();
+    for (int i = 0; i < s_hostSocket.size(); ++i) {
+        PollDescriptor& d = descriptor.next();
+        d.fd = s_hostSocket[i];
+        d.events = POLLIN;
+        d.revents = 0;
+    }
+    s_allServerAndClientConnectionMutex.unlock();
+
+    PollDescriptor& wakeup = descriptor.next();
+    wakeup.fd = s_wakeupSocket;
+    wakeup.events = POLLIN;
+    wakeup.revents = 0;
+
+    pollSockets(descriptor.getCArray(), descriptor.size(), MAX_NETWORK_WAIT_MILLISECONDS);
+
+    // Drain before clearing the pending flag. A send() that happens between the two finds the flag
+    // set and does not signal, but the serviceNetwork() that follows this call processes its message.
+    uint8 b[16];
+    ENetBuffer buffer;
+    buffer.data = b;
+    buffer.dataLength = sizeof(b);
+    while (enet_socket_receive(s_wakeupSocket, NULL, &buffer, 1) > 0) {}
+    s_wakeupPending = 0;
+}
+
+
 static unsigned int backlogForPeer(_ENetPeer* enetPeer) {
     const size_t outgoingReliableCommandCount     = enet_list_size(&(enetPeer->outgoingReliableCommands));      
     const size_t outgoingUnreliableCommandCount   = enet_list_size(&(enetPeer->outgoingUnreliableCommands));    
@@ -420,11 +538,13 @@ void serviceNetwork() {
 
     // Service all server enet hosts (and flush those that are gone)
     s_allServerAndClientConnectionMutex.lock();
+    s_hostSocket.fastClear();
     for (int i = 0; i < s_allServers.length(); ++i) {
         shared_ptr<NetServer> s = s_allServers[i].lock();
         if (notNull(s) && notNull(s->m_enetHost)) {
             b += backlogForHost(s->m_enetHost);
             s->serviceHost();
+            s_hostSocket.append(s->m_enetHost->socket);
         } else {
             s_allServers.fastRemove(i);
             --i;
@@ -437,6 +557,10 @@ void serviceNetwork() {
         if (notNull(c) && notNull(c->m_enetHost)) {
             b += backlogForHost(c->m_enetHost);
             c->serviceHost();
+            if (notNull(c->m_enetHost)) {
+                // Servicing may have disconnected and destroyed the host
+                s_hostSocket.append(c->m_enetHost->socket);
+            }
         } else {
             s_allClientConnections.fastRemove(i);
             --i;
@@ -459,13 +583,14 @@ public:
     NetworkThread() : Thread("G3D::NetworkThread"), keepGoing(1) {}
 
     virtual void threadMain() override {
+        Array<PollDescriptor> descriptor;
         while (keepGoing.value() != 0) {
 
             serviceNetwork();
 
-            // Yield, since we can't access enet's internal select() call to make it process
-            // multiple hosts at once and sleep until one is needed
-            System::sleep(0);
+            // Sleep until a host socket has data, a message is sent, or enet's timers need
+            // servicing, instead of spinning
+            waitForNetworkEvents(descriptor);
         }
     }
 };}
@@ -491,6 +616,8 @@ void initializeNetwork() {
     const int result = enet_initialize_with_callbacks(ENET_VERSION, &callbacks);
     alwaysAssertM(result == 0, format("enet initialization failed with code %d", result));
 
+    createWakeupSocket();
+
 #   ifdef G3D_DEBUG
     {
         // Verify that G3D and ENet are in sync.  There's no way to test this outside of
@@ -524,11 +651,14 @@ namespace _internal {
 void cleanupNetwork() {
     if (notNull(s_networkThread)) {
         s_networkThread->keepGoing = 0;
+        wakeNetworkThread();
         // Wait for the thread to shut down
-        System::sleep(5 * units::milliseconds());
+        s_networkThread->waitForCompletion();
         s_networkThread.reset();
     }
 
+    destroyWakeupSocket();
+
 #   ifdef G3D_WINDOWS
         // End request millisecond accuracy on timers for enet
         timeEndPeriod(1);
@@ -617,6 +747,9 @@ shared_ptr<NetServer> NetServer::create
     shared_ptr<NetServer> n(new NetServer(host));
 
     s_allServers.append(n);
+
+    // Start waiting on the new host's socket
+    wakeNetworkThread();
     return n;
 }
 
@@ -653,8 +786,8 @@ void NetServer::stop() {
 
     // Explicitly remove me from the list of servers accessed by serviceNetwork so 
     // that there is not a race between garbage collection and servicing the network
-    // after this is shut down.
-    shared_ptr<NetServer> me = dynamic_pointer_cast<NetServer>(shared_from_this());
+    // after this is shut down. This is also invoked from the destructor, so shared_from_this() is
+    // not available here.
     for (int i = 0; i < s_allServers.size(); ++i) {
         if (s_allServers[i].lock().get() == this) {
             s_allServers.fastRemove(i);
@@ -752,6 +885,7 @@ void NetSendConnection::send(NetMessageType type, const void* bytes, size_t size
     }
 
     sendQueue().pushBack(_internal::NetMessage(packet,  makeHeader(type, channel, header), m_enetPeer, m_enetHost));
+    wakeNetworkThread();
 }
 
 
@@ -773,6 +907,7 @@ void NetSendConnection::send(NetMessageType type, BinaryOutput& bo, BinaryOutput
     bo.commit(packet->data);
 
     sendQueue().pushBack(_internal::NetMessage(packet,  makeHeader(type, channel, header), m_enetPeer, m_enetHost));
+    wakeNetworkThread();
 }
 
 
@@ -926,6 +1061,9 @@ shared_ptr<NetConnection> NetConnection::connectToServer
     s_allClientConnections.append(connection);
     s_allServerAndClientConnectionMutex.unlock();
 
+    // Start waiting on the new host's socket
+    wakeNetworkThread();
+
     return connection;
 }
 
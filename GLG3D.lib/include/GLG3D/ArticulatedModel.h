@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu, Michael Mara, http://illuminationcodified.com
  \created 2011-07-19
- \edited  2016-10-12
+ \edited  2026-10-18
 
   G3D Library http://g3d.cs.williams.edu
   Copyright 2000-2016, Morgan McGuire morgan@cs.williams.edu
@@ -27,6 +27,7 @@
 #include "G3D/constants.h"
 #include "G3D/PhysicsFrameSpline.h"
 #include "GLG3D/CPUVertexArray.h"
+#include "GLG3D/MeshSimplifier.h"
 #include "GLG3D/UniversalMaterial.h"
 #include "GLG3D/AttributeArray.h"
 #include "GLG3D/UniversalSurface.h"
@@ -82,6 +83,22 @@ public:
 
     static void clearCache();
 
+    /** \brief Enables a persistent cache of loaded models on disk.
+
+        Parsing a large model and running preprocess and cleanGeometry on it (welding, normals,
+        tangents) can take minutes. When this is set, create() stores the resulting parts,
+        vertex and index arrays, and material specifications in \a directory, keyed by the
+        Specification and validated against a content hash of the source files, and later
+        processes load them directly. Textures are still loaded from their own files.
+
+        Models with Specification::cachable false, skeletons or animations, or materials that
+        were not created from a UniversalMaterial::Specification are not cached.
+
+        Default is the empty string, which disables the disk cache. */
+    static void setDiskCacheDirectory(const String& directory);
+
+    static const String& diskCacheDirectory();
+
     /** Parameters for cleanGeometry(). Note that HAIR format models are never cleaned on load, as an optimization, because 
         they are always generated cleanly. */
     class CleanGeometrySettings {
@@ -135,6 +152,17 @@ public:
         */
         float                       maxEdgeLength;
 
+        /**
+            Reorder the triangles of every mesh for the GPU's post-transform
+            vertex cache, then renumber the vertices in the order that the
+            triangles first use them so that vertex fetches are nearly
+            sequential. Increases rendering performance at a small cost in
+            loading time. Default: true.
+
+            \sa MeshAlg::optimizeVertexCache, MeshAlg::simulateVertexCache
+        */
+        bool                        optimizeVertexCache;
+
         CleanGeometrySettings() : 
             forceVertexMerging(true),
             allowVertexMerging(true),
@@ -142,7 +170,8 @@ public:
             forceComputeTangents(false),
             maxNormalWeldAngle(8 * units::degrees()),
             maxSmoothAngle(65 * units::degrees()),
-            maxEdgeLength(finf()) {
+            maxEdgeLength(finf()),
+            optimizeVertexCache(true) {
         }
 
         CleanGeometrySettings(const Any& a);
@@ -155,7 +184,8 @@ public:
                 (forceComputeTangents == other.forceComputeTangents) &&
                 (maxNormalWeldAngle == other.maxNormalWeldAngle) &&
                 (maxSmoothAngle == other.maxSmoothAngle) &&
-                (maxEdgeLength == other.maxEdgeLength);
+                (maxEdgeLength == other.maxEdgeLength) &&
+                (optimizeVertexCache == other.optimizeVertexCache);
         }
 
         Any toAny() const;
@@ -177,7 +207,8 @@ public:
         enum Type {SCALE, MOVE_CENTER_TO_ORIGIN, MOVE_BASE_TO_ORIGIN, SET_CFRAME, TRANSFORM_CFRAME, 
                    TRANSFORM_GEOMETRY, REMOVE_MESH, REMOVE_PART, SET_MATERIAL, SET_TWO_SIDED, 
                    MERGE_ALL, RENAME_PART, RENAME_MESH, ADD, REVERSE_WINDING, 
-                   COPY_TEXCOORD0_TO_TEXCOORD1, OFFSET_AND_SCALE_TEXCOORD1, INTERSECT_BOX};
+                   COPY_TEXCOORD0_TO_TEXCOORD1, OFFSET_AND_SCALE_TEXCOORD1, INTERSECT_BOX,
+                   SIMPLIFY, GENERATE_LODS, OPTIMIZE_VERTEX_CACHE};
 
         /**
           An identifier is one of:
@@ -339,6 +370,18 @@ Example:
 
                 reverseWinding("tree");
 
+                // Replace the triangles of a mesh with a simplified version that keeps
+                // the fraction of the triangles given by a number or MeshSimplifier::Settings.
+                simplify("rock", 0.25);
+
+                // Build up to 4 coarser levels of detail for each mesh, each one simplified
+                // from the previous by the given settings. See Mesh::lodArray and Pose::lodError.
+                generateLODs(all(), 4, MeshSimplifier::Settings { targetRatio = 0.5; });
+
+                // Reorder triangles and vertices for the GPU caches. cleanGeometry() does
+                // this for all meshes unless CleanGeometrySettings::optimizeVertexCache is false.
+                optimizeVertexCache("terrain");
+
                 // Apply a transformation to the vertices of a geometry, within its reference frame
                 transformGeometry("geom", Matrix4::scale(0, 1, 2));
 
@@ -618,6 +661,7 @@ Example:
         - If there are texture coordinates, computes a tangent for every element whose tangent.x is fnan() (or if the tangent array is empty).
         - Merges all vertices with identical indices.
         - Updates all Mesh indices accordingly.
+        - Reorders triangles and vertices for the GPU caches if CleanGeometrySettings::optimizeVertexCache.
         - Recomputes the bounding sphere and box.
         
         Does not upload to the GPU. 
@@ -640,6 +684,11 @@ Example:
 
         void mergeVertices(const Array<Face>& faceArray, float maxNormalWeldAngle, const Array<Mesh*> affectedMeshes);
 
+        /** Renumbers the vertices in the order that the index arrays of \a affectedMeshes, which must be
+            all of the meshes that use this geometry, first reference them. Updates the index arrays and
+            invokes clearAttributeArrays(). \sa Mesh::optimizeVertexCache */
+        void optimizeVertexOrder(const Array<Mesh*>& affectedMeshes);
+
         void getAffectedMeshes(const Array<Mesh*>& fullMeshArray, Array<Mesh*>& affectedMeshes);
 
         String                      name;
@@ -710,6 +759,28 @@ Example:
         /** \copydoc cpuIndexArray. Written by ArticulatedModel::Mesh::copyToGPU */
         IndexStream                             gpuIndexArray;
 
+        /** \brief A simplified index stream over the same vertices as the full mesh. */
+        class LevelOfDetail {
+        public:
+            Array<int>                              cpuIndexArray;
+
+            /** Written by ArticulatedModel::Mesh::copyToGPU */
+            IndexStream                             gpuIndexArray;
+
+            /** Written by ArticulatedModel::Mesh::copyToGPU */
+            shared_ptr<UniversalSurface::GPUGeom>   gpuGeom;
+
+            /** Object-space distance from the full mesh, as reported by MeshSimplifier */
+            float                                   error;
+
+            LevelOfDetail() : error(0.0f) {}
+        };
+
+        /** Coarser versions of this mesh in order of increasing error, created by the
+            generateLODs preprocess instruction. Empty for most meshes. Any operation that
+            rebuilds cpuIndexArray clears this. \sa Pose::lodError */
+        Array<LevelOfDetail>                    lodArray;
+
         bool                                    twoSided;
 
         /** Object Space */
@@ -733,6 +804,15 @@ Example:
         /** If you modify cpuIndexArray, invoke this method to force the GPU arrays to update on the next ArticulatedMode::pose() */
         void clearIndexStream();
 
+        /** The coarsest element of lodArray whose error is at most \a maxError, or NULL if
+            the full mesh should be used. */
+        const LevelOfDetail* levelOfDetail(float maxError) const;
+
+        /** Reorders the triangles of cpuIndexArray and of every level of detail for the GPU's
+            post-transform vertex cache, and invokes clearIndexStream().
+            \sa Geometry::optimizeVertexOrder, MeshAlg::optimizeVertexCache */
+        void optimizeVertexCache();
+
     private:
         
         Mesh(const String& n, Part* p, Geometry* geom, int ID) : name(n), logicalPart(p), geometry(geom), primitive(PrimitiveType::TRIANGLES), twoSided(false), uniqueID(ID) {
@@ -778,7 +858,19 @@ Example:
         /** For instanced rendering of a single model. Used as Args::numInstances */
         int                                            numInstances;
 
-        Pose() : numInstances(1) {}
+        /** If true, pose() also skins the meshes that have bones on the CPU, so that the
+            UniversalSurface::CPUGeom vertices seen by TriTree, collision detection, and other
+            CPU ray casting follow the skeletal animation. Costs CPU time on every pose.
+            Default is false. \sa CPUVertexArray::skin */
+        bool                                           cpuSkinning;
+
+        /** Object-space error that may be tolerated when choosing among the
+            Mesh::lodArray levels of detail. Zero, the default, always renders the full
+            meshes. Set this from the projected size of the model to reduce the cost of
+            distant instances. */
+        float                                          lodError;
+
+        Pose() : numInstances(1), cpuSkinning(false), lodError(0.0f) {}
 
         /**
          Example:
@@ -786,6 +878,7 @@ Example:
         \code
           ArticulatedModel::Pose {
               numInstances = 10;
+              lodError = 0.01;
               frameTable = {
                   "part" = Point3(0, 10, 0);
               };
@@ -1094,6 +1187,18 @@ protected:
     Table<Part*, CFrame>            m_partTransformTable;
     Table<Part*, CFrame>            m_prevPartTransformTable;
 
+    /** CPU-skinned vertices of one Geometry. Held as the source of the UniversalSurface%s
+        whose CPUGeom points into it. */
+    class SkinnedVertexArray : public ReferenceCountedObject {
+    public:
+        const Geometry*             geometry;
+        CPUVertexArray              vertexArray;
+    };
+
+    /** Skinned vertex arrays created by pose() when Pose::cpuSkinning is true. Entries that
+        are no longer referenced by any surface are reused without reallocation. */
+    Array<shared_ptr<SkinnedVertexArray>> m_skinnedVertexArrayPool;
+
     /**keeps track of the MTL files loaded from an OBJ
        only noneempty when loaded from an OBJ */
     Array<String>                   m_mtlArray;
@@ -1107,10 +1212,25 @@ protected:
 
     static shared_ptr<ArticulatedModel> loadArticulatedModel(const Specification& specification, const String& n);
 
+    /** The disk cache file for \a specification, or the empty string if the disk cache does not apply */
+    static String diskCacheFilename(const Specification& specification);
+
+    /** Returns NULL if \a filename is missing or from another version, or if the MD5 hash of any
+        source file differs from the one recorded when the cache file was written */
+    static shared_ptr<ArticulatedModel> loadFromDiskCache(const Specification& specification, const String& filename);
+
+    /** Called after load(). Does nothing if \a filename is empty or the model cannot be cached. */
+    void saveToDiskCache(const Specification& specification, const String& filename) const;
+
     
     /** \brief Execute the program.  Called from load() */
     void preprocess(const Array<Instruction>& program);
 
+    /** \brief Execute the instructions of the program that operate on final index arrays:
+        simplify, generateLODs, and optimizeVertexCache.
+        Called from load() after cleanGeometry(), which rebuilds the index arrays. */
+    void postprocess(const Array<Instruction>& program);
+
     /** \brief Executes \a c for each part in the hierarchy.
      */
     void forEachPart(PartCallback& c, Part* part, const CFrame& parentFrame, const Pose& pose, const int treeDepth);
@@ -1197,6 +1317,11 @@ public:
     /** Pairs of points representing each bone in this mode in the given pose are appended to skeleton */
     void getSkeletonLines(const Pose& pose, const CFrame& cframe, Array<Point3>& skeleton);
 
+    /** Computes the skinning transformation of each bone for the model at \a cframe in \a pose.
+        \a boneFrame is indexed by CPUVertexArray::boneIndices and maps bind-pose vertices to world space.
+        \sa CPUVertexArray::skin, Pose::cpuSkinning */
+    void getBoneFrames(const Pose& pose, const CFrame& cframe, Array<CFrame>& boneFrame);
+
     /** Uses last pose */
     void getSkeletonLines(const CFrame& cframe, Array<Point3>& skeleton) {
         if (notNull(m_lastPose)) {
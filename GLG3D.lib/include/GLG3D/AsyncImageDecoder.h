@@ -0,0 +1,85 @@
+/**
+  \file GLG3D/AsyncImageDecoder.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#pragma once
+
+#include <future>
+#include <functional>
+#include "G3D/platform.h"
+#include "G3D/G3DString.h"
+#include "GLG3D/Texture.h"
+
+namespace G3D {
+
+class CPUPixelTransferBuffer;
+
+/**
+ \brief Decodes image files on TBB worker threads, so that loading several textures (or the six
+ faces of a cube map) overlaps file I/O and decompression, and the thread that owns the OpenGL
+ context only uploads the results.
+
+ Each decode also applies the color adjustments of a Texture::Preprocess (modulate, gammaAdjust,
+ and convertToPremultipliedAlpha) on the worker. Pass remainingPreprocess() to Texture::fromMemory
+ afterwards so that they are not applied twice.
+
+ <pre>
+   AsyncImageDecoder::Future future[2];
+   future[0] = AsyncImageDecoder::decode("rock.png", preprocess);
+   future[1] = AsyncImageDecoder::decode("grass.png", preprocess);
+
+   for (int i = 0; i < 2; ++i) {
+       // Blocks until that file is decoded, rethrowing any Image::Error
+       const shared_ptr<CPUPixelTransferBuffer>& buffer = future[i].get();
+       texture[i] = Texture::fromMemory(..., AsyncImageDecoder::remainingPreprocess(preprocess));
+   }
+ </pre>
+
+ Texture::fromFile and Texture::fromTwoFiles load through this class.
+
+ Decodes run in a task arena whose tasks are guaranteed to make progress even on a single-core
+ machine, so it is safe to block on a Future from any thread that is not itself running a decode.
+*/
+class AsyncImageDecoder {
+public:
+
+    typedef std::shared_future< shared_ptr<CPUPixelTransferBuffer> > Future;
+
+    /** Work done on the worker thread after decoding and before preprocessing, e.g., rotating a
+        cube map face or converting the format. The Image may be modified in place. */
+    typedef std::function<void (const shared_ptr<Image>&)> Transform;
+
+private:
+
+    AsyncImageDecoder() {}
+
+public:
+
+    /** Begins decoding \a filename, which may be in a zipfile, and returns immediately.
+
+        \param imageFormat Passed to Image::fromFile
+        \param transform May be empty */
+    static Future decode
+       (const String&                   filename,
+        const Texture::Preprocess&      preprocess  = Texture::Preprocess::defaults(),
+        const Transform&                transform   = Transform(),
+        const ImageFormat*              imageFormat = ImageFormat::AUTO());
+
+    /** Applies the modulate, gammaAdjust, and convertToPremultipliedAlpha fields of \a preprocess
+        to \a buffer in place, as Texture::fromMemory would. Returns false without modifying
+        \a buffer if its format is not R8, L8, RGB8, or RGBA8 and \a preprocess would modify it. */
+    static bool applyPreprocess(const Texture::Preprocess& preprocess, const shared_ptr<CPUPixelTransferBuffer>& buffer);
+
+    /** \a preprocess without the adjustments that decode() has already applied */
+    static Texture::Preprocess remainingPreprocess(const Texture::Preprocess& preprocess);
+};
+
+} // namespace G3D
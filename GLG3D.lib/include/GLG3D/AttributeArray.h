@@ -280,6 +280,12 @@ public:
         */
     void* mapBuffer(GLenum permissions);
 
+    /** Like mapBuffer(GL_WRITE_ONLY), but also resizes this array to \a numElements,
+        which must fit within the space originally allocated. This allows filling the
+        array in place (e.g., from multiple threads) instead of building an Array on the
+        CPU and copying it with update(). Must be matched by unmapBuffer(). */
+    void* mapBufferForWrite(int numElements);
+
     /** Release CPU addressable memory previously returned by mapBuffer.
         This method of moving data is not typesafe and is not recommended. 
       */
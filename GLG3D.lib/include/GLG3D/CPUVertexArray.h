@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2011-07-22
- \edited  2012-10-03
+ \edited  2026-10-18
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -20,6 +20,7 @@
 #include "G3D/Vector2unorm16.h"
 #include "GLG3D/VertexBuffer.h"
 #include "G3D/Vector4int32.h"
+#include "G3D/Color4.h"
 
 namespace G3D {
 
@@ -119,6 +120,25 @@ public:
      does not contain a prevPosition array of its own. */
     void transformAndAppend(const CPUVertexArray& otherArray, const CoordinateFrame& cframe, const CoordinateFrame& prevCFrame);
 
+    /** \brief Linear blend skinning on the CPU, matching the GPU skinning of UniversalSurface.
+
+     Writes the vertices of this array, transformed by the sum over the four bones of
+     <code>boneFrame[boneIndices[i][b]] * boneWeights[i][b]</code>, to \a dst. Normals and
+     tangents are renormalized. Requires hasBones.
+
+     If <code>dst.size() != size()</code>, \a dst is first initialized as a copy of this array
+     without bones. Otherwise, only the positions, normals, and tangents of \a dst are written, so
+     a \a dst array can be reskinned every frame without reallocation.
+
+     Runs in parallel over vertices, using AVX when the processor supports it. \a dst may not
+     be this array.
+
+     \param allowAVX If false, use the SSE implementation even when the processor supports AVX.
+     For testing and benchmarking.
+
+     \sa ArticulatedModel::getBoneFrames */
+    void skin(const Array<CoordinateFrame>& boneFrame, CPUVertexArray& dst, bool allowAVX = true) const;
+
     int size() const {
         return vertex.size();
     }
@@ -125,12 +125,20 @@ public:
     protected:
         friend class Entity::Track;
         friend class Entity;
+        friend class Scene;
 
         PhysicsFrameSpline          m_spline;
         bool                        m_changed;
 
-        SplineTrack() : m_changed(false) {}
-        SplineTrack(const Any& a) : m_spline(a), m_changed(false) {}
+        /** Incremented by setSpline(), so that Scene can tell when to recompile its batch */
+        int                         m_version;
+
+        /** Frame at m_batchTime, computed by Scene::onSimulation for all SplineTracks at once */
+        SimTime                     m_batchTime;
+        CFrame                      m_batchFrame;
+
+        SplineTrack() : m_changed(false), m_version(0), m_batchTime(fnan()) {}
+        SplineTrack(const Any& a) : m_spline(a), m_changed(false), m_version(0), m_batchTime(fnan()) {}
 
     public:
 
@@ -142,7 +150,11 @@ public:
         }
 
         virtual CFrame computeFrame(SimTime time) const override {
-            return m_spline.evaluate(float(time));
+            if (time == m_batchTime) {
+                return m_batchFrame;
+            } else {
+                return m_spline.evaluate(float(time));
+            }
         }
 
         const PhysicsFrameSpline& spline() const {
@@ -152,6 +164,8 @@ public:
         void setSpline(const PhysicsFrameSpline& spline) {
             m_changed = true;
             m_spline = spline;
+            ++m_version;
+            m_batchTime = fnan();
         }
 
         /** True if setSpline was ever invoked */
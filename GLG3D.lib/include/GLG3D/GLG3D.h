@@ -22,6 +22,7 @@
 #include "GLG3D/glcalls.h"
 #include "GLG3D/getOpenGLState.h"
 #include "GLG3D/Texture.h"
+#include "GLG3D/AsyncImageDecoder.h"
 #include "GLG3D/glFormat.h"
 #include "GLG3D/Surfel.h"
 #include "GLG3D/Milestone.h"
@@ -61,6 +62,7 @@
 #include "GLG3D/Film.h"
 #include "GLG3D/Tri.h"
 #include "GLG3D/TriTree.h"
+#include "GLG3D/InstancedTriTree.h"
 #include "GLG3D/Profiler.h"
 #include "GLG3D/GuiTheme.h"
 #include "GLG3D/GuiButton.h"
@@ -100,10 +102,14 @@
 #include "GLG3D/Entity.h"
 #include "GLG3D/ArticulatedModel.h"
 #include "GLG3D/CPUVertexArray.h"
+#include "GLG3D/MeshSimplifier.h"
 #include "GLG3D/PhysicsFrameSplineEditor.h"
 #include "GLG3D/Scene.h"
 #include "GLG3D/SceneVisualizationSettings.h"
 #include "GLG3D/UniversalSurfel.h"
+#include "GLG3D/SurfelBuffer.h"
+#include "GLG3D/SurfaceBoundsCache.h"
+#include "GLG3D/OcclusionCuller.h"
 #include "GLG3D/MotionBlur.h"
 #include "GLG3D/HeightfieldModel.h"
 #include "GLG3D/Xbox360Controller.h"
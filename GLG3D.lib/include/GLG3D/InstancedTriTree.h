@@ -0,0 +1,213 @@
+/**
+  \file GLG3D/InstancedTriTree.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#pragma once
+
+#include <functional>
+#include "G3D/platform.h"
+#include "G3D/AABox.h"
+#include "G3D/CoordinateFrame.h"
+#include "GLG3D/TriTreeBase.h"
+
+namespace G3D {
+
+/**
+ \brief Two-level ray-casting structure for scenes that contain many copies of the same geometry.
+
+ TriTreeBase::setContents flattens every Surface into world space, so a forest of 10,000 copies
+ of one tree model costs 10,000 times the memory and build time of a single tree.
+ InstancedTriTree instead builds one bottom-level tree (a TriTree by default) per unique mesh, in
+ that mesh's object space, and a top-level bounding volume hierarchy over rigidly transformed
+ instances of those meshes. Rays are transformed into object space at the instance leaves of the
+ top-level hierarchy.
+
+ UniversalSurface%s that share a CPUVertexArray and CoordinateFrame form one instance. Instances
+ whose surfaces use the same vertex array, index arrays, and materials share a mesh. Other Surface
+ types are flattened into world space as a single identity-transformed mesh.
+
+ Hit::instanceID identifies the instance that was hit and Hit::triIndex indexes the triArray() of
+ that instance's meshTree(). sample() resolves such hits to world-space Surfel%s. The inherited
+ triArray() and vertexArray() are empty.
+
+ Instances may be moved by mutating instanceArray() and then calling rebuild(), which only
+ rebuilds the top-level hierarchy. Set Instance::prevFrame as well so that sampled Surfel%s
+ report the motion in Surfel::prevPosition.
+
+ \sa TriTree, NativeTriTree
+*/
+class InstancedTriTree : public TriTreeBase {
+public:
+    using TriTreeBase::intersectRay;
+    using TriTreeBase::intersectRays;
+
+    /** A rigid placement of a mesh */
+    class Instance {
+    public:
+        /** Object to world transformation. Must be a rigid (rotation and translation) transformation. */
+        CFrame          frame;
+
+        /** Object to world transformation at the previous frame of animation, used to compute
+            Surfel::prevPosition. Set this to the old \a frame when moving an instance. */
+        CFrame          prevFrame;
+
+        /** Index into meshTree() */
+        int             meshIndex;
+
+        /** World-space bounds. Computed by rebuild(). */
+        AABox           bounds;
+
+        Instance() : meshIndex(0) {}
+
+        Instance(int meshIndex, const CFrame& frame) : frame(frame), prevFrame(frame), meshIndex(meshIndex) {}
+
+        Instance(int meshIndex, const CFrame& frame, const CFrame& prevFrame) : frame(frame), prevFrame(prevFrame), meshIndex(meshIndex) {}
+    };
+
+    /** Creates an empty bottom-level tree */
+    typedef std::function<shared_ptr<TriTreeBase>()> MeshTreeFactory;
+
+protected:
+
+    /** Node of the top-level hierarchy over instances. Children of internal nodes are stored
+        adjacent to each other in m_node. */
+    class Node {
+    public:
+        AABox           bounds;
+
+        /** Index of the first child for internal nodes, or of the first entry in m_leafInstance for leaves */
+        int             first;
+
+        /** Number of instances for leaves, zero for internal nodes */
+        int             count;
+    };
+
+    /** Put at most this many instances in each leaf of the top-level hierarchy */
+    static const int    INSTANCES_PER_LEAF = 2;
+
+    MeshTreeFactory                 m_meshTreeFactory;
+
+    /** Bottom-level trees in object space */
+    Array<shared_ptr<TriTreeBase>>  m_meshTree;
+
+    /** Object-space bounds of each m_meshTree */
+    Array<AABox>                    m_meshBounds;
+
+    Array<Instance>                 m_instanceArray;
+
+    /** m_node[0] is the root. Empty if there are no instances. */
+    Array<Node>                     m_node;
+
+    /** Indices into m_instanceArray, in leaf order */
+    Array<int>                      m_leafInstance;
+
+    /** Recursively builds the subtree at m_node[nodeIndex] over m_leafInstance[first...first + count - 1] */
+    void buildNode(int nodeIndex, int first, int count, const Array<Point3>& center);
+
+    /** Called from intersectBox. Invokes \a callback with the object-space bounds of \a box for
+        every instance whose world-space bounds overlap it. */
+    void intersectBoxInstances(const AABox& box, const std::function<void (int instanceID, const AABox& objectBox)>& callback) const;
+
+public:
+
+    /** \param meshTreeFactory Creates the bottom-level trees. The default creates a TriTree. */
+    InstancedTriTree(const MeshTreeFactory& meshTreeFactory = nullptr);
+
+    virtual ~InstancedTriTree();
+
+    virtual void clear() override;
+
+    /** Groups the UniversalSurface%s into instances of shared meshes and builds the two-level structure. */
+    virtual void setContents
+        (const Array<shared_ptr<Surface>>&  surfaceArray,
+         ImageStorage                       newImageStorage = ImageStorage::COPY_TO_CPU) override;
+
+    /** Creates a single mesh with one identity instance */
+    virtual void setContents
+       (const Array<Tri>&                   triArray,
+        const CPUVertexArray&               vertexArray,
+        ImageStorage                        newStorage = ImageStorage::COPY_TO_CPU) override;
+
+    using TriTreeBase::setContents;
+
+    /** Builds a new bottom-level tree from object-space geometry and returns its index for use
+        with addInstance(). Call rebuild() after adding instances. */
+    int addMesh
+       (const Array<Tri>&                   triArray,
+        const CPUVertexArray&               vertexArray,
+        ImageStorage                        newStorage = ImageStorage::COPY_TO_CPU);
+
+    /** Returns the new instance's ID. Call rebuild() after adding instances. */
+    int addInstance(int meshIndex, const CFrame& frame, const CFrame& prevFrame);
+
+    /** Adds a stationary instance */
+    int addInstance(int meshIndex, const CFrame& frame) {
+        return addInstance(meshIndex, frame, frame);
+    }
+
+    int numMeshes() const {
+        return m_meshTree.size();
+    }
+
+    const shared_ptr<TriTreeBase>& meshTree(int meshIndex) const {
+        return m_meshTree[meshIndex];
+    }
+
+    const Array<Instance>& instanceArray() const {
+        return m_instanceArray;
+    }
+
+    /** If you mutate this, you must call rebuild() */
+    Array<Instance>& instanceArray() {
+        return m_instanceArray;
+    }
+
+    const Instance& instance(int instanceID) const {
+        return m_instanceArray[instanceID];
+    }
+
+    /** Rebuilds the top-level hierarchy from instanceArray(). The meshes are not rebuilt. */
+    virtual void rebuild() override;
+
+    virtual bool intersectRay
+        (const Ray&                         ray,
+         Hit&                               hit,
+         IntersectRayOptions                options         = IntersectRayOptions(0)) const override;
+
+    /** Returns Tris in the object space of their instance's mesh. Use the overload that also
+        returns instance IDs to transform them to world space. */
+    virtual void intersectBox
+        (const AABox&                       box,
+         Array<Tri>&                        results) const override;
+
+    /** \param instanceID Parallel to \a results. The vertices of results[i] are in
+        meshTree(instance(instanceID[i]).meshIndex)->vertexArray(). */
+    void intersectBox
+        (const AABox&                       box,
+         Array<Tri>&                        results,
+         Array<int>&                        instanceID) const;
+
+    /** \copydoc intersectBox(const AABox&, Array<Tri>&) const */
+    virtual void intersectSphere
+        (const Sphere&                      sphere,
+         Array<Tri>&                        results) const override;
+
+    void intersectSphere
+        (const Sphere&                      sphere,
+         Array<Tri>&                        results,
+         Array<int>&                        instanceID) const;
+
+    virtual void sample(const Hit& hit, shared_ptr<Surfel>& surfel) const override;
+
+    virtual void sample(const Hit& hit, SurfelBuffer& buffer, int index) const override;
+};
+
+} // G3D
@@ -522,6 +522,10 @@ public:
     
       \param cullFace If CullFace::CURRENT, the Light::shadowCullFace is used for each light.*/
     static void renderShadowMaps(RenderDevice* rd, const Array<shared_ptr<Light> >& lightArray, const Array<shared_ptr<Surface> >& allSurfaces, CullFace cullFace = CullFace::CURRENT);
+
+    /** As above, for surfaces whose bounds were already read into \a surfaceBounds. The views of
+        all of the lights are culled in a single pass. */
+    static void renderShadowMaps(RenderDevice* rd, const Array<shared_ptr<Light> >& lightArray, const class SurfaceBoundsCache& surfaceBounds, CullFace cullFace = CullFace::CURRENT);
 };
 
 } // namespace
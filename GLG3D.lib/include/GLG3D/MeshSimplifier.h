@@ -0,0 +1,107 @@
+/**
+  \file GLG3D/MeshSimplifier.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#pragma once
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/Any.h"
+
+namespace G3D {
+
+class CPUVertexArray;
+
+/**
+ \brief Reduces the triangle count of an indexed triangle list by quadric error metric
+ edge collapses (Garland and Heckbert, <i>Surface Simplification Using Quadric Error
+ Metrics</i>, SIGGRAPH 1997).
+
+ Every collapse moves one vertex onto a neighbour, so the result is a new index array over
+ the <i>same</i> CPUVertexArray. Several levels of detail can therefore share one set of
+ GPU vertex attributes and differ only in their index streams.
+
+ Vertices that have the same position are simplified together. A position where texture
+ coordinates, normals, or bone weights change discontinuously has several vertices
+ ("wedges"); it may only collapse along an edge where each of its wedges has exactly one
+ partner at the other end, so UV seams and hard edges stay closed and keep their shape.
+ Mesh boundaries and seams are additionally held in place by constraint planes, and the cost
+ of a collapse grows with the change in normal and bone weights that it causes.
+
+ Large meshes are sorted into spatially coherent clusters of triangles, which are simplified
+ in parallel with their shared border vertices locked. Later passes use offset and larger
+ clusters so that the borders are simplified as well.
+
+ \sa ArticulatedModel::Mesh::lodArray, MeshAlg
+*/
+class MeshSimplifier {
+public:
+
+    class Settings {
+    public:
+        /** Fraction of the triangles to keep, on [0, 1]. Default is 0.5. */
+        float           targetRatio;
+
+        /** Stop before any collapse whose error (an object-space distance) exceeds this,
+            even if targetRatio has not been reached. Default is finf(). */
+        float           maxError;
+
+        /** Cost of collapsing across a change in normal, relative to the geometric
+            error. Default is 1. */
+        float           normalWeight;
+
+        /** Cost of collapsing across a change in bone weights, relative to the geometric
+            error. Default is 1. */
+        float           boneWeight;
+
+        /** Weight of the planes that hold mesh boundaries and attribute seams in place.
+            Default is 10. */
+        float           boundaryWeight;
+
+        /** Approximate number of triangles per parallel work unit. Default is 16384. */
+        int             clusterSize;
+
+        Settings() : targetRatio(0.5f), maxError(finf()), normalWeight(1.0f), boneWeight(1.0f), boundaryWeight(10.0f), clusterSize(16384) {}
+
+        /** A number is interpreted as the targetRatio.
+
+         <pre>
+           MeshSimplifier::Settings {
+               targetRatio = 0.25;
+               maxError = 0.01;
+           }
+         </pre>
+        */
+        Settings(const Any& any);
+
+        Any toAny() const;
+    };
+
+    /**
+      Writes to \a result the triangles of \a indexArray that remain after simplification, in
+      their original order and with their vertices replaced by the vertices they collapsed onto.
+
+      \param lockedVertex If not empty, one flag per element of \a vertexArray. Vertices with
+      the same position as a locked vertex never move. Use this to keep the vertices that are
+      shared with other meshes in place so that no cracks open between them.
+
+      \return The largest error of any collapse performed, which is the object-space distance
+      of the result from the planes of the original triangles that it replaced.
+    */
+    static float simplify
+       (const CPUVertexArray&   vertexArray,
+        const Array<int>&       indexArray,
+        Array<int>&             result,
+        const Settings&         settings = Settings(),
+        const Array<bool>&      lockedVertex = Array<bool>());
+};
+
+} // namespace G3D
@@ -0,0 +1,215 @@
+/**
+  \file GLG3D/OcclusionCuller.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#pragma once
+
+#include "G3D/platform.h"
+#include "G3D/ReferenceCount.h"
+#include "G3D/Array.h"
+#include "G3D/AtomicInt32.h"
+#include "G3D/CoordinateFrame.h"
+#include "G3D/Projection.h"
+#include "G3D/Rect2D.h"
+#include "G3D/Matrix4.h"
+
+namespace G3D {
+
+class Box;
+class AABox;
+class CPUVertexArray;
+class Tri;
+class Surface;
+
+/**
+ \brief Culls surfaces that are hidden behind designated occluders, using a low-resolution depth
+ buffer that is rasterized on the CPU.
+
+ Frustum culling keeps everything in front of the camera, even in a dense city where most of it
+ is behind the nearest buildings. After setView(), rasterize() draws a few large, simple occluder
+ meshes (walls, terrain, building shells) into a small depth buffer. Triangles are binned into
+ screen tiles that are rasterized in parallel, four pixels at a time with SSE. A hierarchical
+ (max-depth) pyramid is then built so that occluded() tests a bounding box against a handful of
+ texels regardless of its size on screen.
+
+ The test is conservative up to the pixel-center sampling of the occluders: a box is reported as
+ occluded only if its nearest point is behind the farthest occluder depth everywhere its
+ projection covers. Boxes that cross the near plane or lie entirely off screen are never occluded.
+ A box that is partially off screen is clamped to the screen and only its on-screen part is
+ tested against the hierarchy.
+
+ Pass the culler to Surface::cull or SurfaceBoundsCache::View to remove occluded surfaces after
+ frustum culling:
+
+ <pre>
+   occlusionCuller->setView(camera->frame(), camera->projection(), viewport);
+   occlusionCuller->rasterize(occluderSurfaces);
+
+   Surface::cull(camera->frame(), camera->projection(), viewport, allSurfaces, visible, false, occlusionCuller);
+   debugPrintf("%d surfaces occluded\n", occlusionCuller->numOccluded());
+ </pre>
+
+ Everything runs on the CPU, so the depth buffer can be read back with depth() and compared
+ against reference images without a GPU.
+
+ \sa SurfaceBoundsCache, Surface::cull
+*/
+class OcclusionCuller : public ReferenceCountedObject {
+public:
+
+    class Settings {
+    public:
+        /** Depth buffer resolution. Rounded up to a multiple of the tile size. Does not need the
+            aspect ratio of the viewport. Default is 320 x 192. */
+        int         width;
+        int         height;
+
+        Settings() : width(320), height(192) {}
+    };
+
+    /** Pixels per side of the tiles that are rasterized in parallel */
+    enum {TILE_WIDTH = 64, TILE_HEIGHT = 32};
+
+protected:
+
+    /** A triangle after near-plane clipping and projection, ready to rasterize */
+    class ScreenTri {
+    public:
+        /** Edge functions: pixel (x, y) is inside when edge[i].x * x + edge[i].y * y + edge[i].z >= 0
+            for all three edges */
+        Vector3         edge[3];
+
+        /** 1 / w at pixel (x, y) is invW.x * x + invW.y * y + invW.z */
+        Vector3         invW;
+
+        /** Pixel bounds, inclusive, clamped to the depth buffer */
+        int             x0, y0, x1, y1;
+    };
+
+    Settings                    m_settings;
+
+    int                         m_width;
+    int                         m_height;
+
+    int                         m_tilesX;
+    int                         m_tilesY;
+
+    CFrame                      m_cameraFrame;
+    Projection                  m_projection;
+    Rect2D                      m_viewport;
+
+    /** World space to depth buffer pixels. w is the distance in front of the camera. */
+    Matrix4                     m_worldToPixel;
+
+    /** Distance to the near plane */
+    float                       m_nearW;
+
+    /** m_level[0] is the full-resolution buffer of 1 / w, which is 0 where nothing was drawn.
+        Each subsequent level is half the size and stores the minimum (farthest) of the
+        corresponding 2x2 block. */
+    Array< Array<float> >       m_level;
+    Array<int>                  m_levelWidth;
+    Array<int>                  m_levelHeight;
+
+    /** Scratch space reused across rasterize() calls */
+    Array<Vector4>              m_clipVertex;
+    Array<ScreenTri>            m_screenTri;
+    Array<bool>                 m_screenTriValid;
+    Array< Array<int> >         m_tileBin;
+
+    mutable AtomicInt32         m_numTested;
+    mutable AtomicInt32         m_numOccluded;
+
+    OcclusionCuller(const Settings& settings);
+
+    /** Near-clips and projects triangle (a, b, c), given in clip space, into up to two ScreenTris */
+    int setupTriangle(const Vector4& a, const Vector4& b, const Vector4& c, ScreenTri* out) const;
+
+    bool setupScreenTri(const Vector4& a, const Vector4& b, const Vector4& c, ScreenTri& tri) const;
+
+    void rasterizeTile(int tx, int ty);
+
+    void buildHierarchy();
+
+    /** Rasterizes triangles whose vertices have already been transformed into m_clipVertex */
+    void rasterizeClipSpace(const int* index, int numTriangles);
+
+public:
+
+    static shared_ptr<OcclusionCuller> create(const Settings& settings = Settings());
+
+    /** Clears the depth buffer and the occlusion statistics and sets the view used by all
+        subsequent calls */
+    void setView(const CFrame& cameraFrame, const Projection& projection, const Rect2D& viewport);
+
+    /** Clears the depth buffer, keeping the view */
+    void clear();
+
+    /** Draws world-space triangles: \a index holds three vertex indices per triangle. Both
+        windings are drawn. */
+    void rasterize(const Array<Point3>& vertex, const Array<int>& index);
+
+    /** Draws \a triArray, whose vertices are world-space positions in \a vertexArray, as
+        produced by Surface::getTris */
+    void rasterize(const CPUVertexArray& vertexArray, const Array<Tri>& triArray);
+
+    /** Draws the triangles of the surfaces, which should be a few large, opaque ones */
+    void rasterize(const Array<shared_ptr<Surface> >& occluderArray);
+
+    /** True if every point of the world-space box is hidden behind the occluders drawn so far */
+    bool occluded(const Box& box) const;
+
+    bool occluded(const AABox& box) const;
+
+    /** Box given by its center and the vectors from the center to the centers of three adjacent faces */
+    bool occluded(const Point3& center, const Vector3 halfAxis[3]) const;
+
+    const CFrame& cameraFrame() const {
+        return m_cameraFrame;
+    }
+
+    const Projection& projection() const {
+        return m_projection;
+    }
+
+    const Rect2D& viewport() const {
+        return m_viewport;
+    }
+
+    int width() const {
+        return m_width;
+    }
+
+    int height() const {
+        return m_height;
+    }
+
+    int numLevels() const {
+        return m_level.size();
+    }
+
+    /** Distance in front of the camera of the nearest occluder at the center of pixel (x, y),
+        or finf() if no occluder covers it. For \a level > 0, the farthest such distance over
+        the 2^level x 2^level block of pixels. Row 0 is the top of the viewport. */
+    float depth(int x, int y, int level = 0) const;
+
+    /** Number of occluded() calls since setView() */
+    int numTested() const {
+        return m_numTested.value();
+    }
+
+    /** Number of occluded() calls since setView() that returned true */
+    int numOccluded() const {
+        return m_numOccluded.value();
+    }
+};
+
+} // namespace G3D
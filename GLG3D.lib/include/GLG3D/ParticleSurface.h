@@ -50,6 +50,9 @@ protected:
         return shared_ptr<ParticleSurface>(new ParticleSurface(entity));
     }
 
+    /** Sorts the particles back to front along \a csz with a parallel radix sort
+        on quantized depth and writes the indices directly into the mapped
+        ParticleSystem::s_particleBuffer.indexStream. */
     static void sortAndUploadIndices(shared_ptr<ParticleSurface>surface, const Vector3& csz);
 
     /** If \param sort is true, construct an index array to render back-to-front (using \param csz), otherwise submit everything in a giant multi-draw call */
@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2015-08-30
-  \edited  2016-02-22
+  \edited  2026-10-18
  
  G3D Library http://g3d.cs.williams.edu
  Copyright 2000-2016, Morgan McGuire morgan@cs.williams.edu
@@ -348,21 +348,14 @@ protected:
     };
 
 
+    /** Element of the radix sort for sorted transparency */
     class SortProxy {
     public:
-        /** In camera space */
-        float           z;
+        /** Camera-space depth, quantized so that farther particles have smaller keys */
+        uint32          key;
 
         /** Of the particle in s_particleBuffer */
         int             index;
-
-        bool operator<(const SortProxy& other) const {
-            return z < other.z;
-        }
-
-        bool operator>(const SortProxy& other) const {
-            return z > other.z;
-        }
     };
 
     
@@ -375,6 +368,9 @@ protected:
     /** Used when sorting values to compute s_particleBuffer.indexStream for sorted transparency */
     static Array<SortProxy>             s_sortArray;
 
+    /** Destination of alternating radix sort passes over s_sortArray */
+    static Array<SortProxy>             s_sortScratchArray;
+
     /** Used to set the preferLowResolutionTransparency 
         hint on the surfaces created from every particle system. */
     static bool                         s_preferLowResolutionTransparency;
@@ -401,7 +397,7 @@ protected:
     ParticleSystem();
 
     /** Computes net forces from the brownian, wind, and gravity values and then 
-        applies euler integration to the particles. */
+        applies euler integration to the particles. \sa integratePhysics */
     virtual void applyPhysics(float t, float dt);
 
     /** Called by onPose */
@@ -446,6 +442,25 @@ public:
         return m_physicsEnvironment;
     }
 
+    /** Euler integration of drag, gravity, wind, and brownian motion for \a numParticles
+        particles, in the same reference frame as \a gravitationalAcceleration and \a windVelocity.
+        Called by applyPhysics.
+
+        Particles are processed in parallel chunks that are transposed into
+        structure-of-arrays form, integrated with SIMD, and then written back.
+
+        \param maxSIMDWidth Widest implementation to use: 8 for AVX (when System::hasAVX()),
+        4 for SSE, or 1 for scalar code. All agree to within floating-point rounding. */
+    static void integratePhysics
+       (Particle*       particle,
+        int             numParticles,
+        const Vector3&  gravitationalAcceleration,
+        const Vector3&  windVelocity,
+        float           maxBrownianVelocity,
+        float           t,
+        float           dt,
+        int             maxSIMDWidth = 8);
+
     virtual void onPose(Array<shared_ptr<Surface> >& surfaceArray) override;
 
     /** If canMove(), then computes forces from physicsEnvironment() and applies basic Euler integration of velocity. 
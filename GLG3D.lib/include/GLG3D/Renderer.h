@@ -15,6 +15,7 @@
 #include "G3D/platform.h"
 #include "G3D/ReferenceCount.h"
 #include "G3D/Array.h"
+#include "GLG3D/SurfaceBoundsCache.h"
 
 namespace G3D {
 
@@ -43,6 +44,20 @@ protected:
         ARBITRARY 
     };
 
+    /** Bounds of the surfaces passed to render(), shared by cullAndSort() and computeShadowing()
+        so that each surface's bounds are read once per frame. \sa surfaceBounds() */
+    SurfaceBoundsCache                  m_surfaceBounds;
+
+    /** True while m_surfaceBounds holds the surfaces of the frame being rendered. Subclasses
+        set this after updating m_surfaceBounds at the top of render() and clear it at the end. */
+    bool                                m_surfaceBoundsCurrent;
+
+    Renderer() : m_surfaceBoundsCurrent(false) {}
+
+    /** Returns m_surfaceBounds, first reading the bounds of \a allSurfaces into it unless
+        m_surfaceBoundsCurrent is set and m_surfaceBounds already holds exactly those surfaces. */
+    const SurfaceBoundsCache& surfaceBounds(const Array<shared_ptr<Surface>>& allSurfaces);
+
     /**
      \brief Appends to \a sortedVisibleSurfaces and \a forwardSurfaces.
 
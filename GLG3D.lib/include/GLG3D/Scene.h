@@ -14,8 +14,10 @@
 #include "G3D/Array.h"
 #include "G3D/SmallArray.h"
 #include "G3D/lazy_ptr.h"
+#include "G3D/PhysicsFrameSplineBatch.h"
 #include "GLG3D/LightingEnvironment.h"
 #include "GLG3D/ArticulatedModel.h"
+#include "GLG3D/Entity.h"
 
 namespace G3D {
 
@@ -122,6 +124,16 @@ protected:
 
     shared_ptr<GFont>                   m_font;
 
+    /** The Entity::SplineTracks of m_entityArray. Element i is compiled into m_splineBatch[i]. */
+    Array< shared_ptr<Entity::SplineTrack> > m_splineTrackArray;
+
+    /** Entity::SplineTrack::m_version of each element of m_splineTrackArray when it was compiled */
+    Array<int>                          m_splineTrackVersion;
+
+    PhysicsFrameSplineBatch             m_splineBatch;
+
+    Array<PhysicsFrame>                 m_splineFrame;
+
     Scene(const shared_ptr<AmbientOcclusion>& ambientOcclusion);
 
     const shared_ptr<Entity> _entity(const String& name) const;
@@ -129,6 +141,10 @@ protected:
     /** If m_needEntitySort, sort Entitys to resolve dependencies and set m_needEntitySort = false. Called fromOnSimulation */
     void sortEntitiesByDependency();
 
+    /** Evaluates the splines of all Entity::SplineTracks at m_time in one batch, so that
+        Entity::onSimulation finds their frames already computed. Called from onSimulation. */
+    void evaluateSplineTracks();
+
 public:
 
     /** \brief Register a new subclass of G3D::Entity so that it can be constructed from a .Scene.Any file.
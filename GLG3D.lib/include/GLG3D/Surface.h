@@ -241,7 +241,8 @@ protected:
      Array<shared_ptr<Surface> >&       allSurfaces, 
      Array<shared_ptr<Surface> >&       outSurfaces, 
      bool                               previous,
-     bool                               inPlace);
+     bool                               inPlace,
+     const shared_ptr<class OcclusionCuller>& occlusionCuller);
 
 public:
 
@@ -615,18 +616,25 @@ public:
      bool                               onlyShadowCasters = false);
 
 
-    /** Computes the array of surfaces that can be seen by \a camera.  Preserves order. */
+    /** Computes the array of surfaces that can be seen by \a camera.  Preserves order.
+
+        This reads the bounds of every surface. When culling the same surfaces for several
+        views, build one SurfaceBoundsCache and cull all of the views against it instead.
+
+        \param occlusionCuller If not NULL, also removes the surfaces that it reports as occluded.
+        Its OcclusionCuller::setView() must have been called with this camera and viewport. */
     static void cull
     (const CoordinateFrame&             cameraFrame,
      const class Projection&            cameraProjection,
      const class Rect2D&                viewport, 
      const Array<shared_ptr<Surface> >& allSurfaces, 
      Array<shared_ptr<Surface> >&       outSurfaces, 
-     bool                               previous = false) {
+     bool                               previous = false,
+     const shared_ptr<class OcclusionCuller>& occlusionCuller = nullptr) {
          // Const cast so that both this and the in-place version of cull can call the same method
          // However, as that one method needs to be able to modify allSurfaces in the in-place method
          // It must be sent as a non-const reference. The array is not modified, however.
-         cull(cameraFrame, cameraProjection, viewport, const_cast<Array<shared_ptr<Surface> >& >(allSurfaces), outSurfaces, previous, false);
+         cull(cameraFrame, cameraProjection, viewport, const_cast<Array<shared_ptr<Surface> >& >(allSurfaces), outSurfaces, previous, false, occlusionCuller);
     }
 
     /** Culls surfaces in place */
@@ -635,10 +643,11 @@ public:
      const class Projection&            cameraProjection, 
      const class Rect2D&                viewport, 
      Array<shared_ptr<Surface> >&       allSurfaces, 
-     bool                               previous = false) {
+     bool                               previous = false,
+     const shared_ptr<class OcclusionCuller>& occlusionCuller = nullptr) {
          // Initializing an array without a constructor allocates no memory, so this is safe
          Array<shared_ptr<Surface> > ignore;
-         cull(cameraFrame, cameraProjection, viewport, allSurfaces, ignore, previous, true);
+         cull(cameraFrame, cameraProjection, viewport, allSurfaces, ignore, previous, true, occlusionCuller);
     }
 
 
@@ -0,0 +1,166 @@
+/**
+  \file GLG3D/SurfaceBoundsCache.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#pragma once
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/CoordinateFrame.h"
+#include "G3D/Projection.h"
+#include "G3D/Rect2D.h"
+#include "G3D/AABox.h"
+
+namespace G3D {
+
+class Surface;
+class OcclusionCuller;
+extern bool ignoreBool;
+
+/**
+ \brief World-space bounds of an array of Surface%s in structure-of-arrays form, for culling
+ many surfaces against many views.
+
+ update() makes the Surface::getCoordinateFrame, Surface::getObjectSpaceBoundingSphere and
+ Surface::getObjectSpaceBoundingBox virtual calls once per surface, in parallel. cull() then tests
+ eight surfaces at a time against the view frustum planes (with AVX when System::hasAVX(), SSE
+ otherwise) without touching the Surface%s again. Build the cache once per frame after
+ GApp::onPose and cull the camera and every shadow map view against it.
+
+ A surface is culled if its bounding sphere or its bounding box is entirely outside one of the
+ frustum planes, or if the frustum is entirely outside one face of its bounding box, as
+ Surface::cull has always done. The face test runs only on the few surfaces that pass the plane
+ test. Surfaces with infinite bounds are never culled.
+
+ <pre>
+   SurfaceBoundsCache bounds;
+   bounds.update(allSurfaces);
+
+   Array<SurfaceBoundsCache::View> view;
+   view.append(SurfaceBoundsCache::View(camera->frame(), camera->projection(), viewport));
+   view.append(SurfaceBoundsCache::View(lightFrame, lightProjection, shadowViewport, true));
+
+   Array< Array<shared_ptr<Surface> > > visible;
+   bounds.cull(view, visible);
+ </pre>
+
+ \sa Surface::cull, Light::renderShadowMaps
+*/
+class SurfaceBoundsCache {
+public:
+
+    /** A camera or shadow map view to cull against */
+    class View {
+    public:
+        CFrame          frame;
+        Projection      projection;
+        Rect2D          viewport;
+
+        /** If true, also cull surfaces for which Surface::castsShadows() is false */
+        bool            onlyShadowCasters;
+
+        /** If not NULL, also cull surfaces that this reports as occluded. Its
+            OcclusionCuller::setView() must have been called with this view. */
+        shared_ptr<OcclusionCuller> occlusionCuller;
+
+        View() : onlyShadowCasters(false) {}
+
+        View(const CFrame& frame, const Projection& projection, const Rect2D& viewport, bool onlyShadowCasters = false,
+             const shared_ptr<OcclusionCuller>& occlusionCuller = nullptr) :
+            frame(frame), projection(projection), viewport(viewport), onlyShadowCasters(onlyShadowCasters), occlusionCuller(occlusionCuller) {}
+    };
+
+protected:
+
+    /** Indices of the arrays within m_field */
+    enum Field {
+        SPHERE_X, SPHERE_Y, SPHERE_Z, SPHERE_RADIUS,
+        BOX_X, BOX_Y, BOX_Z,
+
+        /** Half of Box::axis(i) * Box::extent(i) for each of the three box axes */
+        AXIS0_X, AXIS0_Y, AXIS0_Z,
+        AXIS1_X, AXIS1_Y, AXIS1_Z,
+        AXIS2_X, AXIS2_Y, AXIS2_Z,
+
+        NUM_FIELDS
+    };
+
+    Array<shared_ptr<Surface> > m_surfaceArray;
+
+    /** NUM_FIELDS arrays of m_paddedSize floats each. The padding entries are zero. */
+    Array<float>                m_field;
+
+    /** m_surfaceArray.size() rounded up to a multiple of 8 */
+    int                         m_paddedSize;
+
+    /** Surface::castsShadows() for each surface */
+    Array<bool>                 m_castsShadows;
+
+    /** False for surfaces whose box bounds are infinite */
+    Array<bool>                 m_finite;
+
+    bool                        m_previous;
+
+    const float* field(Field f) const {
+        return m_field.getCArray() + f * m_paddedSize;
+    }
+
+    float* field(Field f) {
+        return m_field.getCArray() + f * m_paddedSize;
+    }
+
+    /** Tests the box of surface \a i */
+    bool occluded(const OcclusionCuller* occlusionCuller, int i) const;
+
+public:
+
+    SurfaceBoundsCache() : m_paddedSize(0), m_previous(false) {}
+
+    /** Reads the bounds of every surface in \a surfaceArray. Does not shrink the underlying
+        arrays, so a cache that is updated every frame does not allocate once the scene stops
+        growing. */
+    void update(const Array<shared_ptr<Surface> >& surfaceArray, bool previous = false);
+
+    /** Releases the references to the surfaces */
+    void clear();
+
+    int size() const {
+        return m_surfaceArray.size();
+    }
+
+    /** The surfaces, in the order passed to update() */
+    const Array<shared_ptr<Surface> >& surfaceArray() const {
+        return m_surfaceArray;
+    }
+
+    /** True if the last update() read exactly the surfaces of \a surfaceArray, in the same order.
+        Compares pointers only, so this does not detect surfaces that have since changed. */
+    bool matches(const Array<shared_ptr<Surface> >& surfaceArray) const;
+
+    /** The \a previous argument to the last update() */
+    bool previous() const {
+        return m_previous;
+    }
+
+    /** Appends the surfaces visible in \a view to \a visible, in order. */
+    void cull(const View& view, Array<shared_ptr<Surface> >& visible) const;
+
+    /** Culls against every view in one parallel pass over the bounds. Resizes \a visible to
+        view.size() and appends the surfaces visible in view[v] to visible[v], in order. */
+    void cull(const Array<View>& view, Array< Array<shared_ptr<Surface> > >& visible) const;
+
+    /** World-space bounds of all surfaces with finite bounds, as Surface::getBoxBounds.
+
+        \param anyInfinite Set to true if any surface considered had infinite bounds. Not modified otherwise. */
+    void getBoxBounds(AABox& bounds, bool onlyShadowCasters = false, bool& anyInfinite = ignoreBool) const;
+};
+
+} // namespace G3D
@@ -0,0 +1,100 @@
+/**
+  \file GLG3D/SurfelBuffer.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#pragma once
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/Vector3.h"
+#include "G3D/Color3.h"
+#include "GLG3D/Surfel.h"
+
+namespace G3D {
+
+class UniversalSurfel;
+class UniversalMaterial;
+class Surface;
+
+/**
+ \brief Structure-of-arrays storage for many UniversalSurfel%s, for batch shading without
+ a heap allocation per ray hit.
+
+ TriTreeBase::sampleHits fills one element per Hit. Elements whose hit missed, or whose
+ Tri does not have a UniversalMaterial, have a null material; use TriTreeBase::sample
+ with a shared_ptr<Surfel> for those. Resizing never shrinks the arrays, so a buffer
+ that is reused across frames allocates only while the batch size grows.
+
+ Use get() to copy one element into a stack-allocated UniversalSurfel when the
+ Surfel scattering methods are needed.
+
+ \sa TriTreeBase::sampleHits, UniversalSurfel
+*/
+class SurfelBuffer {
+public:
+    Array<Point3>                   position;
+    Array<Point3>                   prevPosition;
+    Array<Vector3>                  geometricNormal;
+    Array<Vector3>                  shadingNormal;
+    Array<Vector3>                  shadingTangent1;
+    Array<Vector3>                  shadingTangent2;
+
+    /** \copydoc UniversalSurfel::tangentSpaceNormal */
+    Array<Vector3>                  tangentSpaceNormal;
+
+    Array<Color3>                   lambertianReflectivity;
+    Array<Color3>                   glossyReflectionCoefficient;
+    Array<Color3>                   transmissionCoefficient;
+    Array<Radiance3>                emission;
+    Array<float>                    coverage;
+    Array<float>                    smoothness;
+    Array<bool>                     isTransmissive;
+
+    Array<float>                    etaPos;
+    Array<Color3>                   kappaPos;
+    Array<float>                    etaNeg;
+    Array<Color3>                   kappaNeg;
+
+    /** nullptr for elements that have no surfel */
+    Array<const UniversalMaterial*> material;
+    Array<const Surface*>           surface;
+    Array<Surfel::Source>           source;
+
+    int size() const {
+        return material.size();
+    }
+
+    /** Resizes every array without releasing memory */
+    void resize(int n);
+
+    /** True if element \a i holds a surfel */
+    bool hasSurfel(int i) const {
+        return notNull(material[i]);
+    }
+
+    /** Marks element \a i as having no surfel */
+    void setNone(int i) {
+        material[i]     = nullptr;
+        surface[i]      = nullptr;
+        source[i].index = -1;
+    }
+
+    void set(int i, const UniversalSurfel& surfel);
+
+    /** Copies element \a i into \a surfel, which may be allocated on the stack */
+    void get(int i, UniversalSurfel& surfel) const;
+
+    /** Transforms the position, normals, and tangents of element \a i by the rigid transformation
+        \a xform, and its prevPosition by \a prevXform */
+    void transformToWorldSpace(int i, const CoordinateFrame& xform, const CoordinateFrame& prevXform);
+};
+
+} // G3D
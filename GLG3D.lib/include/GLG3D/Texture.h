@@ -47,6 +47,8 @@ class Matrix3;
 class Texture;
 class RenderDevice;
 class GLPixelTransferBuffer;
+class BlockCompressedImage;
+class AsyncImageDecoder;
 class Args;
 class UniformTable;
 
@@ -545,6 +547,7 @@ public:
 
     private:
         friend class Texture;
+        friend class AsyncImageDecoder;
 
         /**
          Scales the intensity up or down of an entire image and gamma corrects.
@@ -985,6 +988,17 @@ public:
         bool                            generateMipMaps = true,
         const Preprocess&               preprocess     = Preprocess::defaults());
 
+    /** Uploads all mip levels of \a image without decompressing them. The format of
+        \a encoding is ignored.
+
+        fromFile() compresses through BlockCompressedImage::fromFile, and so caches the
+        compressed result next to the source, when \a encoding requests a format for which
+        BlockCompressedImage::supportsFormat is true and \a preprocess does not modify texels. */
+    static shared_ptr<Texture> fromBlockCompressedImage(
+        const String&                   name,
+        const shared_ptr<BlockCompressedImage>& image,
+        const Encoding&                 encoding       = Encoding());
+
     /** Creates another texture that is the same as this one but contains only
         an alpha channel.  Alpha-only textures are useful as mattes.  
         
@@ -41,6 +41,7 @@ class Surface;
 class Tri {
 private:
     friend class NativeTriTree;
+    friend class TriTreeBase;
     friend class UniversalSurfel;
 
 	// Flags:
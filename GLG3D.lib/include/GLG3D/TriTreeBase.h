@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2009-06-10
-  \edited  2016-09-11
+  \edited  2026-10-18
 */
 #pragma once
 
@@ -23,7 +23,9 @@ namespace G3D {
 class Surface;
 class Surfel;
 class Material;
+class UniversalMaterial;
 class AABox;
+class SurfelBuffer;
 
 /** Base class for ray-casting data structures. */
 class TriTreeBase : public ReferenceCountedObject {
@@ -32,6 +34,26 @@ protected:
     Array<Tri>              m_triArray;
     CPUVertexArray          m_vertexArray;
 
+    /** The resolved source of a group of Tris that share Tri::data() */
+    class MaterialEntry {
+    public:
+        /** nullptr if the Tri's material is not a UniversalMaterial */
+        const UniversalMaterial*    material;
+
+        /** nullptr if Tri::data() is not a Surface */
+        const Surface*              surface;
+    };
+
+    /** Parallel to m_triArray. Index into m_materialTable, so that sampling does not
+        have to cast Tri::data() for every hit. */
+    Array<int>              m_triMaterialIndex;
+
+    /** Raw pointers are safe because the Tris in m_triArray hold references to the materials and surfaces */
+    Array<MaterialEntry>    m_materialTable;
+
+    /** Recomputes m_triMaterialIndex and m_materialTable from m_triArray. Subclasses must call this from rebuild(). */
+    void updateMaterialIndex();
+
 public:
 
     /** CPU timing of API conversion overhead for the most recent call to intersectRays */
@@ -60,8 +82,13 @@ public:
     class Hit {
     public:
         enum { NONE = -1 };
-        /** NONE if no hit. For occlusion ray casts, this will be an undefined value not equal to NONE. */
+        /** NONE if no hit. For occlusion ray casts, this will be an undefined value not equal to NONE. 
+            For hits on an instance of an InstancedTriTree, this indexes the triArray() of that
+            instance's mesh tree. */
         int         triIndex;
+
+        /** Instance that was hit in an InstancedTriTree, and NONE for trees that store world-space triangles directly. */
+        int         instanceID;
         float       u;
         float       v;
         float       distance;
@@ -69,7 +96,7 @@ public:
         /** For occlusion ray casts, this will always be false. */
         bool        backface;
 
-        Hit() : triIndex(NONE), u(0), v(0), distance(0), backface(false) {}
+        Hit() : triIndex(NONE), instanceID(NONE), u(0), v(0), distance(0), backface(false) {}
     };
 
     virtual ~TriTreeBase();
@@ -174,7 +201,20 @@ public:
         (const Sphere&                      sphere,
          Array<Tri>&                        triArray) const;
 
-    void sample(const Hit& hit, shared_ptr<Surfel>& surfel) const;
+    /** Creates the world-space Surfel for \a hit, or sets \a surfel to nullptr if the hit is Hit::NONE. 
+        All surfel-returning intersection methods resolve hits through this, so that trees with
+        instanced geometry can transform the result. */
+    virtual void sample(const Hit& hit, shared_ptr<Surfel>& surfel) const;
+
+    /** Writes the world-space surfel for \a hit into element \a index of \a buffer without
+        allocating memory. Sets the element to none for misses and for Tris that do not have
+        a UniversalMaterial. */
+    virtual void sample(const Hit& hit, SurfelBuffer& buffer, int index) const;
+
+    /** Batch version of sample() for shading the results of intersectRays. Resizes \a buffer to
+        hits.size() and samples in parallel. Reuse \a buffer across calls to avoid
+        allocation entirely. */
+    void sampleHits(const Array<Hit>& hits, SurfelBuffer& buffer) const;
 };
 
 } // G3D
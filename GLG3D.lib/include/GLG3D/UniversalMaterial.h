@@ -368,6 +368,16 @@ Any component can be a Texture::Specification, Color3/Color4, or table of <code>
         }
 
         size_t hashCode() const;
+
+        /** False if this specification refers to Texture%s that are already in memory,
+            rather than only to files and constants, and so cannot be serialized. */
+        bool serializable() const;
+
+        /** Binary form used by the ArticulatedModel disk cache. Requires serializable().
+            Texture files are referenced by name, not embedded. */
+        void serialize(BinaryOutput& b) const;
+
+        void deserialize(BinaryInput& b);
     };
 
 protected:
@@ -422,6 +432,10 @@ protected:
 
     Sampler                     m_sampler;
 
+    /** The specification from which create() built this material. NULL if it was
+        constructed from components. */
+    shared_ptr<Specification>   m_specification;
+
     UniversalMaterial();
 
 public:
@@ -440,6 +454,12 @@ public:
     const Sampler& sampler() const {
         return m_sampler;
     }
+
+    /** The specification that this material was created from, or NULL if it was
+        constructed from components rather than by create(const Specification&). */
+    const Specification* specification() const {
+        return m_specification.get();
+    }
     
     /** 
         Returns the dimension of the textures in the material
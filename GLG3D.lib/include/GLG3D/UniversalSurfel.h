@@ -2,7 +2,7 @@
     \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
     \created 2011-07-01
-    \edited  2016-09-01
+    \edited  2026-10-18
     
  G3D Innovation Engine
  Copyright 2000-2016, Morgan McGuire.
@@ -101,6 +101,10 @@ public:
         return std::make_shared<UniversalSurfel>();
     }
 
+    /** \param surface The Surface that \a tri came from, or nullptr. TriTreeBase passes a
+        precomputed value to avoid casting Tri::data() for every sample. */
+    void sample(const Tri& tri, float u, float v, int triIndex, const CPUVertexArray& vertexArray, bool backside, const class UniversalMaterial* universalMaterial, const Surface* surface);
+
     void sample(const Tri& tri, float u, float v, int triIndex, const CPUVertexArray& vertexArray, bool backside, const class UniversalMaterial* universalMaterial);
 
     UniversalSurfel(const Tri& tri, float u, float v, int triIndex, const CPUVertexArray& vertexArray, bool backside) {
@@ -1,7 +1,7 @@
 /** 
   \file GLG3D/VideoOutput.h
   \created 2010-01-01
-  \edited  2015-03-02
+  \edited  2026-10-18
 
  G3D Innovation Engine
  Copyright 2000-2015, Morgan McGuire.
@@ -15,6 +15,8 @@
 #include "G3D/g3dmath.h"
 #include "G3D/Image.h"
 #include "G3D/ReferenceCount.h"
+#include "G3D/BoundedThreadsafeQueue.h"
+#include "G3D/Thread.h"
 #include "GLG3D/Texture.h"
 
 // forward declarations for ffmpeg
@@ -22,12 +24,19 @@ struct AVOutputFormat;
 struct AVFormatContext;
 struct AVStream;
 struct AVFrame;
+struct SwsContext;
 
 namespace G3D {
 
 /** 
  \brief Saves video to disk in a variety of popular formats, including AVI and MPEG. 
 
+ By default, append() converts and encodes each frame before returning. Set
+ Settings::asynchronous.enabled to instead copy frames into a recycled pool of buffers and
+ return immediately, while a dedicated encoder thread converts the pixel format (in parallel)
+ and runs the codec. When the encoder falls behind, append() either waits for a free buffer
+ or drops the frame; stalledFrames() and droppedFrames() count these events.
+
  \beta
  */
 class VideoOutput : public ReferenceCountedObject {
@@ -248,6 +257,21 @@ public:
             int         gop;
         } mpeg;
 
+        struct
+        {
+            /** If true, append() queues a copy of the frame for a dedicated encoder thread
+                instead of encoding on the calling thread. Default is false. */
+            bool        enabled;
+
+            /** Number of frame buffers in the pool, which bounds the number of frames waiting
+                to be encoded and the memory used. Default is 8. */
+            int         queueLength;
+
+            /** If true, append() discards the frame when every buffer is waiting to be encoded.
+                If false, it blocks until the encoder frees a buffer. Default is false. */
+            bool        dropFramesWhenFull;
+        } asynchronous;
+
         /** For Settings created by the static factory methods, the
             file extension (without the period) recommended for this
             kind of file. */
@@ -302,15 +326,38 @@ public:
 
 protected:
 
+    /** A copy of an appended frame waiting for the encoder thread */
+    class PendingFrame {
+    public:
+        Array<uint8>        data;
+        const ImageFormat*  format;
+        bool                invertY;
+
+        PendingFrame() : format(NULL), invertY(false) {}
+    };
+
     VideoOutput();
 
     void initialize(const String& filename, const Settings& settings);
+
+    /** Encodes the frame immediately, or queues it for the encoder thread if Settings::asynchronous.enabled */
     void encodeFrame(const uint8* frame, const ImageFormat* format, bool invertY = false);
 
+    /** Converts and encodes on the current thread */
+    void encodeFrameNow(const uint8* frame, const ImageFormat* format, bool invertY);
+
     /** Flips the frame and adjusts format if needed.
         This routine does not support any planar input formats */
     const uint8* convertFrame(const uint8* frame, const ImageFormat* format, bool invertY);
 
+    /** Starts the encoder thread and allocates the frame pool */
+    void startEncoderThread();
+
+    /** Encodes all queued frames (or discards them, if \a discard is true) and then joins the encoder thread */
+    void stopEncoderThread(bool discard);
+
+    static void encoderThreadMain(void* videoOutput);
+
     Settings            m_settings;
     String              m_filename;
 
@@ -331,6 +378,26 @@ protected:
     /** Used by convertFrame to hold the temporary frame being prepared for output.*/
     Array<uint8>        m_temp;
 
+    /** Converts from RGB8 to the codec's pixel format. Created on the first frame that needs it. */
+    SwsContext*         m_swsContext;
+
+    /** Owns the buffers in m_freeFrames and m_queuedFrames */
+    Array<shared_ptr<PendingFrame>>                     m_framePool;
+
+    /** Buffers available for append() to fill */
+    shared_ptr<BoundedThreadsafeQueue<PendingFrame*>>   m_freeFrames;
+
+    /** Frames waiting for the encoder thread, in order. NULL tells the thread to exit. */
+    shared_ptr<BoundedThreadsafeQueue<PendingFrame*>>   m_queuedFrames;
+
+    shared_ptr<Thread>  m_encoderThread;
+
+    /** When true, the encoder thread discards frames instead of encoding them */
+    AtomicInt32         m_discardQueuedFrames;
+
+    int                 m_droppedFrames;
+    int                 m_stalledFrames;
+
 public:
 
 
@@ -373,12 +440,29 @@ public:
     void append(const shared_ptr<class VideoInput>& in);
 
 
-    /** Aborts writing video file and ends encoding */
+    /** Aborts writing video file and ends encoding. Frames still waiting for the encoder thread are discarded. */
     void abort();
 
-    /** Finishes writing video file and ends encoding */
+    /** Finishes writing video file and ends encoding. Blocks until the encoder thread has encoded every queued frame. */
     void commit();
 
+    /** Number of frames that append() discarded because the asynchronous queue was full and
+        Settings::asynchronous.dropFramesWhenFull was set */
+    int droppedFrames() const {
+        return m_droppedFrames;
+    }
+
+    /** Number of times that append() had to wait for the asynchronous encoder to free a buffer.
+        A nonzero value means that the encoder cannot keep up with the frame rate. */
+    int stalledFrames() const {
+        return m_stalledFrames;
+    }
+
+    /** Number of frames waiting for the asynchronous encoder thread */
+    int pendingFrames() const {
+        return notNull(m_queuedFrames) ? m_queuedFrames->size() : 0;
+    }
+
     bool finished()       { return m_isFinished; }
 
 };
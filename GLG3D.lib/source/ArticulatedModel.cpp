@@ -41,13 +41,18 @@ void ArticulatedModel::clearCache() {
 
 
 shared_ptr<ArticulatedModel> ArticulatedModel::loadArticulatedModel(const ArticulatedModel::Specification& specification, const String& n) {
-    shared_ptr<ArticulatedModel> a = createShared<ArticulatedModel>();
+    const String& cacheFilename = diskCacheFilename(specification);
+    shared_ptr<ArticulatedModel> a = loadFromDiskCache(specification, cacheFilename);
 
-    if (n.empty()) {
-        a->m_name = FilePath::base(specification.filename);
+    if (isNull(a)) {
+        a = createShared<ArticulatedModel>();
+        if (n.empty()) {
+            a->m_name = FilePath::base(specification.filename);
+        }
+
+        a->load(specification);
+        a->saveToDiskCache(specification, cacheFilename);
     }
-    
-    a->load(specification);
 
     if (! n.empty()) {
         a->m_name = n;
@@ -277,9 +282,12 @@ void ArticulatedModel::load(const Specification& specification) {
     } else {
         computeBounds();
     }
+    timer.after("cleanGeometry");
+
+    postprocess(specification.preprocess);
+    timer.after("postprocess");
 
     maybeCompactArrays();
-    timer.after("cleanGeometry");
 }
 
 
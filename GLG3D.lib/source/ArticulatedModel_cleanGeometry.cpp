@@ -12,6 +12,7 @@
 #include "G3D/AreaMemoryManager.h"
 #include "GLG3D/ArticulatedModel.h"
 #include "G3D/FastPointHashGrid.h"
+#include "G3D/MeshAlg.h"
 
 namespace G3D {
     
@@ -233,6 +234,7 @@ void ArticulatedModel::Geometry::subdivideUntilThresholdEdgeLength
         Mesh* mesh = affectedMeshes[m];
         mesh->cpuIndexArray.fastClear();
         mesh->gpuIndexArray = IndexStream();
+        mesh->lodArray.clear();
     }
 
     // Clear the CPU vertex array
@@ -374,10 +376,70 @@ void ArticulatedModel::Geometry::cleanGeometry(const CleanGeometrySettings& sett
         timer.after("  computeMissingTangents");
     }
 
+    if (settings.optimizeVertexCache) {
+        // Meshes are independent until their vertices are renumbered
+        tbb::parallel_for(tbb::blocked_range<int>(0, affectedMeshes.size(), 1), [&](const tbb::blocked_range<int>& r) {
+            for (int m = r.begin(); m < r.end(); ++m) {
+                affectedMeshes[m]->optimizeVertexCache();
+            }
+        });
+        optimizeVertexOrder(affectedMeshes);
+        timer.after("  optimizeVertexCache");
+    }
+
     computeBounds(affectedMeshes);
 }
 
 
+/** Moves element i of \a array to remap[i]. Optional per-vertex arrays that are not present are empty
+    and left unchanged. */
+template<class T>
+static void applyVertexRemap(Array<T>& array, const Array<int>& remap) {
+    if (array.size() != remap.size()) {
+        return;
+    }
+    Array<T> remapped;
+    remapped.resize(array.size());
+    for (int i = 0; i < array.size(); ++i) {
+        remapped[remap[i]] = array[i];
+    }
+    array.swap(remapped);
+}
+
+
+void ArticulatedModel::Geometry::optimizeVertexOrder(const Array<Mesh*>& affectedMeshes) {
+    Array<int> indexArray;
+    for (int m = 0; m < affectedMeshes.size(); ++m) {
+        indexArray.append(affectedMeshes[m]->cpuIndexArray);
+    }
+
+    Array<int> remap;
+    MeshAlg::computeVertexFetchRemap(indexArray, cpuVertexArray.size(), remap);
+
+    applyVertexRemap(cpuVertexArray.vertex, remap);
+    applyVertexRemap(cpuVertexArray.texCoord1, remap);
+    applyVertexRemap(cpuVertexArray.vertexColors, remap);
+    applyVertexRemap(cpuVertexArray.boneIndices, remap);
+    applyVertexRemap(cpuVertexArray.boneWeights, remap);
+    applyVertexRemap(cpuVertexArray.prevPosition, remap);
+    clearAttributeArrays();
+
+    for (int m = 0; m < affectedMeshes.size(); ++m) {
+        Mesh* mesh = affectedMeshes[m];
+        for (int i = 0; i < mesh->cpuIndexArray.size(); ++i) {
+            mesh->cpuIndexArray[i] = remap[mesh->cpuIndexArray[i]];
+        }
+        for (int d = 0; d < mesh->lodArray.size(); ++d) {
+            Array<int>& lodIndexArray = mesh->lodArray[d].cpuIndexArray;
+            for (int i = 0; i < lodIndexArray.size(); ++i) {
+                lodIndexArray[i] = remap[lodIndexArray[i]];
+            }
+        }
+        mesh->clearIndexStream();
+    }
+}
+
+
 void ArticulatedModel::Geometry::clearAttributeArrays() {
     gpuPositionArray    = AttributeArray();
     gpuNormalArray      = AttributeArray();
@@ -392,6 +454,30 @@ void ArticulatedModel::Geometry::clearAttributeArrays() {
 
 void ArticulatedModel::Mesh::clearIndexStream() {
     gpuIndexArray = IndexStream();
+    for (int i = 0; i < lodArray.size(); ++i) {
+        lodArray[i].gpuIndexArray = IndexStream();
+    }
+}
+
+
+void ArticulatedModel::Mesh::optimizeVertexCache() {
+    if ((primitive == PrimitiveType::TRIANGLES) && notNull(geometry)) {
+        const int numVertices = geometry->cpuVertexArray.size();
+        MeshAlg::optimizeVertexCache(cpuIndexArray, numVertices);
+        for (int i = 0; i < lodArray.size(); ++i) {
+            MeshAlg::optimizeVertexCache(lodArray[i].cpuIndexArray, numVertices);
+        }
+    }
+    clearIndexStream();
+}
+
+
+const ArticulatedModel::Mesh::LevelOfDetail* ArticulatedModel::Mesh::levelOfDetail(float maxError) const {
+    const LevelOfDetail* lod = NULL;
+    for (int i = 0; (i < lodArray.size()) && (lodArray[i].error <= maxError); ++i) {
+        lod = &lodArray[i];
+    }
+    return lod;
 }
 
 
@@ -490,28 +576,38 @@ void ArticulatedModel::Geometry::computeMissingTangents(const Array<Mesh*> affec
     cpuVertexArray.hasTangent = true;
     alwaysAssertM(cpuVertexArray.hasTexCoord0, "Cannot compute tangents without some texture coordinates.");
  
-    // Compute all tangents, but only extract those that we need at the bottom.
+    // Compute all face tangents, but only accumulate and extract those that we need at the bottom.
+
+    // Concatenate the triangles of all meshes, so that corner c is triangle c / 3 in mesh order
+    Array<int> index;
+    {
+        int numIndices = 0;
+        for (int m = 0; m < affectedMeshes.size(); ++m) {
+            numIndices += affectedMeshes[m]->cpuIndexArray.size();
+        }
+        index.resize(numIndices);
+        int* dst = index.getCArray();
+        for (int m = 0; m < affectedMeshes.size(); ++m) {
+            const Array<int>& cpuIndexArray = affectedMeshes[m]->cpuIndexArray;
+            System::memcpy(dst, cpuIndexArray.getCArray(), sizeof(int) * cpuIndexArray.size());
+            dst += cpuIndexArray.size();
+        }
+    }
 
     // See http://www.terathon.com/code/tangent.html for a derivation of the following code
-    Array<Vector3>  tangent1;
-    Array<Vector3>  tangent2;
-    tangent1.resize(cpuVertexArray.size());
-    tangent2.resize(cpuVertexArray.size());
-    Vector3* tan1 = tangent1.getCArray();
-    Vector3* tan2 = tangent2.getCArray();
+    Array<Vector3> faceTangent1;
+    Array<Vector3> faceTangent2;
+    faceTangent1.resize(index.size() / 3);
+    faceTangent2.resize(index.size() / 3);
     CPUVertexArray::Vertex* vertexArray = cpuVertexArray.vertex.getCArray();
-    debugAssertM(tan1[0].x == 0, "This implementation assumes that new Vector3 values are initialized to zero.");
+    const int* indexArray = index.getCArray();
 
     // For each face
-    for (int m = 0; m < affectedMeshes.size(); ++m) {
-        const Mesh* mesh = affectedMeshes[m];        
-        const Array<int>& cpuIndexArray = mesh->cpuIndexArray;
-        const int* indexArray = cpuIndexArray.getCArray();
-
-        for (int i = 0; i < cpuIndexArray.size(); i += 3) {
-            const int i0 = indexArray[i];
-            const int i1 = indexArray[i + 1];
-            const int i2 = indexArray[i + 2];
+    tbb::parallel_for(tbb::blocked_range<int>(0, faceTangent1.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int f = r.begin(); f < r.end(); ++f) {
+            const int i0 = indexArray[3 * f];
+            const int i1 = indexArray[3 * f + 1];
+            const int i2 = indexArray[3 * f + 2];
         
             const CPUVertexArray::Vertex& vertex0 = vertexArray[i0];
             const CPUVertexArray::Vertex& vertex1 = vertexArray[i1];
@@ -541,55 +637,60 @@ void ArticulatedModel::Geometry::computeMissingTangents(const Array<Mesh*> affec
         
             const float r = 1.0f / (s0 * t1 - s1 * t0);
             
-            const Vector3 sdir
+            faceTangent1[f] = Vector3
                 ((t1 * x0 - t0 * x1) * r, 
                  (t1 * y0 - t0 * y1) * r,
                  (t1 * z0 - t0 * z1) * r);
 
-            const Vector3 tdir
+            faceTangent2[f] = Vector3
                 ((s0 * x1 - s1 * x0) * r, 
                  (s0 * y1 - s1 * y0) * r,
                  (s0 * z1 - s1 * z0) * r);
-        
-            tan1[i0] += sdir;
-            tan1[i1] += sdir;
-            tan1[i2] += sdir;
-        
-            tan2[i0] += tdir;
-            tan2[i1] += tdir;
-            tan2[i2] += tdir;        
         } // For each triangle
-    } // For each mesh
-
-    for (int v = 0; v < cpuVertexArray.size(); ++v) {
-        CPUVertexArray::Vertex& vertex = vertexArray[v];
+    });
+
+    // Each vertex sums its faces' tangents in mesh and triangle order, which produces
+    // exactly the same values as accumulating them face by face
+    Array<int> cornerOffset;
+    Array<int> corner;
+    MeshAlg::computeVertexCorners(index, cpuVertexArray.size(), cornerOffset, corner);
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, cpuVertexArray.size(), 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int v = r.begin(); v < r.end(); ++v) {
+            CPUVertexArray::Vertex& vertex = vertexArray[v];
+
+            if (isNaN(vertex.tangent.x)) {
+                // This tangent needs to be overriden
+                Vector3 t1, t2;
+                for (int k = cornerOffset[v]; k < cornerOffset[v + 1]; ++k) {
+                    const int f = corner[k] / 3;
+                    t1 += faceTangent1[f];
+                    t2 += faceTangent2[f];
+                }
 
-        if (isNaN(vertex.tangent.x)) {
-            // This tangent needs to be overriden
-            const Vector3& n = vertex.normal;
-            const Vector3& t1 = tan1[v];
-            const Vector3& t2 = tan2[v];
+                const Vector3& n = vertex.normal;
         
-            // Gram-Schmidt orthogonalize
-            const Vector3& T = (t1 - n * n.dot(t1)).directionOrZero();
-
-            if ( T.isZero() ) {
-                Vector3 tan1, tan2;
-                n.direction().getTangents(tan1, tan2);
-                const Vector3& tan = tan1.direction();
-                vertex.tangent.x = tan.x;
-                vertex.tangent.y = tan.y;
-                vertex.tangent.z = tan.z;
-            } else {
-                vertex.tangent.x = T.x;
-                vertex.tangent.y = T.y;
-                vertex.tangent.z = T.z;
-            }
+                // Gram-Schmidt orthogonalize
+                const Vector3& T = (t1 - n * n.dot(t1)).directionOrZero();
+
+                if ( T.isZero() ) {
+                    Vector3 tan1, tan2;
+                    n.direction().getTangents(tan1, tan2);
+                    const Vector3& tan = tan1.direction();
+                    vertex.tangent.x = tan.x;
+                    vertex.tangent.y = tan.y;
+                    vertex.tangent.z = tan.z;
+                } else {
+                    vertex.tangent.x = T.x;
+                    vertex.tangent.y = T.y;
+                    vertex.tangent.z = T.z;
+                }
 
-            // Calculate handedness
-            vertex.tangent.w = (n.cross(t1).dot(t2) < 0.0f) ? 1.0f : -1.0f;
-        } // if this must be updated
-    } // for each vertex
+                // Calculate handedness
+                vertex.tangent.w = (n.cross(t1).dot(t2) < 0.0f) ? 1.0f : -1.0f;
+            } // if this must be updated
+        } // for each vertex
+    });
     
  }
 
@@ -600,6 +701,7 @@ void ArticulatedModel::Geometry::mergeVertices(const Array<Face>& faceArray, flo
         Mesh* mesh = affectedMeshes[m];
         mesh->cpuIndexArray.fastClear();
         mesh->gpuIndexArray = IndexStream();
+        mesh->lodArray.clear();
     }
 
     // Clear the CPU vertex array
@@ -0,0 +1,364 @@
+/**
+ \file GLG3D/source/ArticulatedModel_diskCache.cpp
+
+ \author Morgan McGuire, http://graphics.cs.williams.edu
+ \created 2026-10-18
+ \edited  2026-10-18
+
+ Copyright 2000-2026, Morgan McGuire.
+ All rights reserved.
+ */
+#include "GLG3D/ArticulatedModel.h"
+#include "G3D/SpeedLoad.h"
+#include "G3D/Crypto.h"
+#include "G3D/FileSystem.h"
+#include "G3D/BinaryInput.h"
+#include "G3D/BinaryOutput.h"
+
+namespace G3D {
+
+/** Increment whenever the layout written by saveToDiskCache() changes. Files written by other
+    versions are ignored and overwritten. */
+static const int DISK_CACHE_VERSION = 2;
+
+/** Vertex and index arrays begin at multiples of this many bytes from the start of the file */
+static const int DISK_CACHE_ALIGNMENT = 16;
+
+/** Source files are hashed in chunks of this many bytes so that huge files need not fit in memory */
+static const int64 SOURCE_HASH_CHUNK_SIZE = 64 * 1024 * 1024;
+
+static String s_diskCacheDirectory;
+
+
+void ArticulatedModel::setDiskCacheDirectory(const String& directory) {
+    s_diskCacheDirectory = directory;
+    if (! directory.empty() && ! FileSystem::exists(directory)) {
+        FileSystem::createDirectory(directory);
+    }
+}
+
+
+const String& ArticulatedModel::diskCacheDirectory() {
+    return s_diskCacheDirectory;
+}
+
+
+static String toHex(const MD5Hash& h) {
+    String s;
+    for (int i = 0; i < 16; ++i) {
+        s += format("%02x", h[i]);
+    }
+    return s;
+}
+
+
+/** Content hash of a source file, or the zero hash if it does not exist */
+static MD5Hash sourceHash(const String& filename) {
+    if (! FileSystem::exists(filename)) {
+        return MD5Hash();
+    }
+
+    BinaryInput b(filename, G3D_LITTLE_ENDIAN);
+    if (b.size() <= SOURCE_HASH_CHUNK_SIZE) {
+        return Crypto::md5(b.getCArray(), size_t(b.size()));
+    }
+
+    // Hash the hashes of the chunks
+    BinaryOutput chunkHashes("<memory>", G3D_LITTLE_ENDIAN);
+    Array<uint8> chunk;
+    for (int64 start = 0; start < b.size(); start += SOURCE_HASH_CHUNK_SIZE) {
+        chunk.resize(int(min(SOURCE_HASH_CHUNK_SIZE, b.size() - start)), DONT_SHRINK_UNDERLYING_ARRAY);
+        b.readBytes(chunk.getCArray(), chunk.size());
+        Crypto::md5(chunk.getCArray(), chunk.size()).serialize(chunkHashes);
+    }
+    return Crypto::md5(chunkHashes.getCArray(), size_t(chunkHashes.size()));
+}
+
+
+String ArticulatedModel::diskCacheFilename(const Specification& specification) {
+    if (s_diskCacheDirectory.empty() || ! specification.cachable || (System::machineEndian() != G3D_LITTLE_ENDIAN)) {
+        return "";
+    }
+
+    TextOutput::Settings settings;
+    settings.wordWrap = TextOutput::Settings::WRAP_NONE;
+    const String& key = format("%d ", DISK_CACHE_VERSION) + specification.toAny().unparse(settings);
+    return FilePath::concat(s_diskCacheDirectory, toHex(Crypto::md5(key.c_str(), key.size())) + ".ArticulatedModel");
+}
+
+
+static void writePadding(BinaryOutput& b) {
+    while (b.position() % DISK_CACHE_ALIGNMENT != 0) {
+        b.writeUInt8(0);
+    }
+}
+
+
+static void skipPadding(BinaryInput& b) {
+    const int64 remainder = b.getPosition() % DISK_CACHE_ALIGNMENT;
+    if (remainder != 0) {
+        b.skip(DISK_CACHE_ALIGNMENT - remainder);
+    }
+}
+
+
+/** Writes the raw bytes of a POD array, aligned so that a memory-mapped file could use it in place */
+template<class T>
+static void writeArray(BinaryOutput& b, const Array<T>& a) {
+    b.writeInt32(a.size());
+    writePadding(b);
+    b.writeBytes(a.getCArray(), int64(sizeof(T)) * a.size());
+}
+
+
+template<class T>
+static void readArray(BinaryInput& b, Array<T>& a) {
+    const int n = b.readInt32();
+    skipPadding(b);
+    a.resize(n);
+    b.readBytes(a.getCArray(), int64(sizeof(T)) * n);
+}
+
+
+void ArticulatedModel::saveToDiskCache(const Specification& specification, const String& filename) const {
+    if (filename.empty() || usesSkeletalAnimation() || usesAnimation()) {
+        // Animations and skeletons are not cached; they are cheap to load relative to the geometry
+        return;
+    }
+
+    // Materials are stored by specification and recreated on load
+    Array<shared_ptr<UniversalMaterial> > materialArray;
+    Table<shared_ptr<UniversalMaterial>, int> materialIndex;
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        const shared_ptr<UniversalMaterial>& material = m_meshArray[m]->material;
+        if (notNull(material) && ! materialIndex.containsKey(material)) {
+            if (isNull(material->specification()) || ! material->specification()->serializable()) {
+                // This material was built from Textures in memory
+                return;
+            }
+            materialIndex.set(material, materialArray.size());
+            materialArray.append(material);
+        }
+    }
+
+    Table<const Part*, int> partIndex;
+    for (int p = 0; p < m_partArray.size(); ++p) {
+        partIndex.set(m_partArray[p], p);
+    }
+    Table<const Geometry*, int> geometryIndex;
+    for (int g = 0; g < m_geometryArray.size(); ++g) {
+        geometryIndex.set(m_geometryArray[g], g);
+    }
+
+    const String tempFilename = filename + ".tmp";
+    BinaryOutput b(tempFilename, G3D_LITTLE_ENDIAN);
+
+    SpeedLoad::writeHeader(b, "ArticulatedModel");
+    b.writeInt32(DISK_CACHE_VERSION);
+
+    // Source files, which invalidate the cache when they change
+    Array<String> sourceArray;
+    sourceArray.append(specification.filename);
+    sourceArray.append(m_mtlArray);
+    b.writeInt32(sourceArray.size());
+    for (int i = 0; i < sourceArray.size(); ++i) {
+        b.writeString32(sourceArray[i]);
+        sourceHash(sourceArray[i]).serialize(b);
+    }
+
+    b.writeString32(m_name);
+    b.writeInt32(m_mtlArray.size());
+    for (int i = 0; i < m_mtlArray.size(); ++i) {
+        b.writeString32(m_mtlArray[i]);
+    }
+
+    b.writeInt32(materialArray.size());
+    for (int i = 0; i < materialArray.size(); ++i) {
+        b.writeString32(materialArray[i]->name());
+        materialArray[i]->specification()->serialize(b);
+    }
+
+    // Parents always precede their children in m_partArray
+    b.writeInt32(m_partArray.size());
+    for (int p = 0; p < m_partArray.size(); ++p) {
+        const Part* part = m_partArray[p];
+        b.writeString32(part->name);
+        b.writeInt32(isNull(part->parent()) ? -1 : partIndex[part->parent()]);
+        part->cframe.serialize(b);
+        part->inverseBindPoseTransform.serialize(b);
+    }
+
+    b.writeInt32(m_geometryArray.size());
+    for (int g = 0; g < m_geometryArray.size(); ++g) {
+        const Geometry* geometry = m_geometryArray[g];
+        const CPUVertexArray& vertexArray = geometry->cpuVertexArray;
+        b.writeString32(geometry->name);
+        b.writeBool8(vertexArray.hasTexCoord0);
+        b.writeBool8(vertexArray.hasTexCoord1);
+        b.writeBool8(vertexArray.hasTangent);
+        b.writeBool8(vertexArray.hasBones);
+        b.writeBool8(vertexArray.hasVertexColors);
+        geometry->sphereBounds.serialize(b);
+        geometry->boxBounds.serialize(b);
+
+        writeArray(b, vertexArray.vertex);
+        writeArray(b, vertexArray.texCoord1);
+        writeArray(b, vertexArray.vertexColors);
+        writeArray(b, vertexArray.boneIndices);
+        writeArray(b, vertexArray.boneWeights);
+        writeArray(b, vertexArray.prevPosition);
+    }
+
+    b.writeInt32(m_meshArray.size());
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        const Mesh* mesh = m_meshArray[m];
+        b.writeString32(mesh->name);
+        b.writeInt32(isNull(mesh->logicalPart) ? -1 : partIndex[mesh->logicalPart]);
+        b.writeInt32(geometryIndex[mesh->geometry]);
+        b.writeInt32(isNull(mesh->material) ? -1 : materialIndex[mesh->material]);
+        mesh->primitive.serialize(b);
+        b.writeBool8(mesh->twoSided);
+        mesh->sphereBounds.serialize(b);
+        mesh->boxBounds.serialize(b);
+
+        b.writeInt32(mesh->contributingJoints.size());
+        for (int j = 0; j < mesh->contributingJoints.size(); ++j) {
+            const Part* joint = mesh->contributingJoints[j];
+            b.writeInt32(isNull(joint) ? -1 : partIndex[joint]);
+        }
+
+        writeArray(b, mesh->cpuIndexArray);
+
+        b.writeInt32(mesh->lodArray.size());
+        for (int i = 0; i < mesh->lodArray.size(); ++i) {
+            b.writeFloat32(mesh->lodArray[i].error);
+            writeArray(b, mesh->lodArray[i].cpuIndexArray);
+        }
+    }
+
+    b.commit();
+
+    // Replace any stale file only after the new one is complete, so that a concurrent or
+    // interrupted process never sees a partial file
+    if (FileSystem::exists(filename, false)) {
+        FileSystem::removeFile(filename);
+    }
+    FileSystem::rename(tempFilename, filename);
+}
+
+
+shared_ptr<ArticulatedModel> ArticulatedModel::loadFromDiskCache(const Specification& specification, const String& filename) {
+    if (filename.empty() || ! FileSystem::exists(filename, false)) {
+        return nullptr;
+    }
+
+    try {
+        BinaryInput b(filename, G3D_LITTLE_ENDIAN);
+
+        if ((b.readString(SpeedLoad::HEADER_LENGTH) != "ArticulatedModel") || (b.readInt32() != DISK_CACHE_VERSION)) {
+            return nullptr;
+        }
+
+        const int numSources = b.readInt32();
+        for (int i = 0; i < numSources; ++i) {
+            const String& source = b.readString32();
+            const MD5Hash hash(b);
+            if (sourceHash(source) != hash) {
+                // Out of date
+                return nullptr;
+            }
+        }
+
+        const shared_ptr<ArticulatedModel> a = createShared<ArticulatedModel>();
+        a->m_name = b.readString32();
+        a->m_mtlArray.resize(b.readInt32());
+        for (int i = 0; i < a->m_mtlArray.size(); ++i) {
+            a->m_mtlArray[i] = b.readString32();
+        }
+
+        Array<shared_ptr<UniversalMaterial> > materialArray;
+        materialArray.resize(b.readInt32());
+        for (int i = 0; i < materialArray.size(); ++i) {
+            const String& name = b.readString32();
+            UniversalMaterial::Specification materialSpecification;
+            materialSpecification.deserialize(b);
+            materialArray[i] = UniversalMaterial::create(name, materialSpecification);
+        }
+
+        const int numParts = b.readInt32();
+        for (int p = 0; p < numParts; ++p) {
+            const String& name = b.readString32();
+            const int parentIndex = b.readInt32();
+            if (parentIndex >= p) {
+                return nullptr;
+            }
+            Part* part = a->addPart(name, (parentIndex == -1) ? nullptr : a->m_partArray[parentIndex]);
+            part->cframe.deserialize(b);
+            part->inverseBindPoseTransform.deserialize(b);
+        }
+
+        const int numGeometry = b.readInt32();
+        for (int g = 0; g < numGeometry; ++g) {
+            Geometry* geometry = a->addGeometry(b.readString32());
+            CPUVertexArray& vertexArray = geometry->cpuVertexArray;
+            vertexArray.hasTexCoord0    = b.readBool8();
+            vertexArray.hasTexCoord1    = b.readBool8();
+            vertexArray.hasTangent      = b.readBool8();
+            vertexArray.hasBones        = b.readBool8();
+            vertexArray.hasVertexColors = b.readBool8();
+            geometry->sphereBounds.deserialize(b);
+            geometry->boxBounds.deserialize(b);
+
+            readArray(b, vertexArray.vertex);
+            readArray(b, vertexArray.texCoord1);
+            readArray(b, vertexArray.vertexColors);
+            readArray(b, vertexArray.boneIndices);
+            readArray(b, vertexArray.boneWeights);
+            readArray(b, vertexArray.prevPosition);
+        }
+
+        const int numMeshes = b.readInt32();
+        for (int m = 0; m < numMeshes; ++m) {
+            const String& name = b.readString32();
+            const int partIndex     = b.readInt32();
+            const int geometryIndex = b.readInt32();
+            const int materialIndex = b.readInt32();
+            if ((partIndex >= numParts) || (geometryIndex < 0) || (geometryIndex >= numGeometry) || (materialIndex >= materialArray.size())) {
+                return nullptr;
+            }
+
+            Mesh* mesh = a->addMesh(name, (partIndex == -1) ? nullptr : a->m_partArray[partIndex], a->m_geometryArray[geometryIndex]);
+            if (materialIndex != -1) {
+                mesh->material = materialArray[materialIndex];
+            }
+            mesh->primitive.deserialize(b);
+            mesh->twoSided = b.readBool8();
+            mesh->sphereBounds.deserialize(b);
+            mesh->boxBounds.deserialize(b);
+
+            mesh->contributingJoints.resize(b.readInt32());
+            for (int j = 0; j < mesh->contributingJoints.size(); ++j) {
+                const int jointIndex = b.readInt32();
+                if (jointIndex >= numParts) {
+                    return nullptr;
+                }
+                mesh->contributingJoints[j] = (jointIndex == -1) ? nullptr : a->m_partArray[jointIndex];
+            }
+
+            readArray(b, mesh->cpuIndexArray);
+
+            mesh->lodArray.resize(b.readInt32());
+            for (int i = 0; i < mesh->lodArray.size(); ++i) {
+                mesh->lodArray[i].error = b.readFloat32();
+                readArray(b, mesh->lodArray[i].cpuIndexArray);
+            }
+        }
+
+        return a;
+    } catch (...) {
+        // Truncated or corrupt file; reload from the source
+        return nullptr;
+    }
+}
+
+} // namespace G3D
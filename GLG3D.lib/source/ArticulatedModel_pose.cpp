@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu, Michael Mara, http://www.illuminationcodified.com
  \created 2011-07-16
- \edited  2013-04-14
+ \edited  2026-10-18
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -116,6 +116,16 @@ static CFrame getFinalBoneTransform(ArticulatedModel::Part* part, const Table<Ar
 }
 
 
+void ArticulatedModel::getBoneFrames(const Pose& pose, const CFrame& cframe, Array<CFrame>& boneFrame) {
+    computePartTransforms(m_partTransformTable, m_prevPartTransformTable, cframe, pose, cframe, pose);
+
+    boneFrame.resize(m_boneArray.size());
+    for (int i = 0; i < m_boneArray.size(); ++i) {
+        boneFrame[i] = getFinalBoneTransform(m_boneArray[i], m_partTransformTable);
+    }
+}
+
+
 void ArticulatedModel::getSkeletonLines(const Pose& pose, const CFrame& cframe, Array<Point3>& skeleton) {
 
     computePartTransforms(m_partTransformTable, m_prevPartTransformTable, cframe, pose, cframe, pose);
@@ -215,6 +225,40 @@ void ArticulatedModel::pose
         }
     }
 
+    // Skin on the CPU once per Geometry, into arrays that the new surfaces will hold
+    Table<const Geometry*, shared_ptr<SkinnedVertexArray>> skinnedTable;
+    if (pose.cpuSkinning && usesSkeletalAnimation()) {
+        Array<CFrame> boneFrame;
+        boneFrame.resize(m_boneArray.size());
+        for (int i = 0; i < m_boneArray.size(); ++i) {
+            boneFrame[i] = getFinalBoneTransform(m_boneArray[i], m_partTransformTable);
+        }
+
+        for (int m = 0; m < m_meshArray.size(); ++m) {
+            const Geometry* geometry = m_meshArray[m]->geometry;
+            if (! geometry->cpuVertexArray.hasBones || skinnedTable.containsKey(geometry)) {
+                continue;
+            }
+
+            // Reuse an array that the surfaces from a previous pose have released
+            shared_ptr<SkinnedVertexArray> skinned;
+            for (int i = 0; (i < m_skinnedVertexArrayPool.size()) && isNull(skinned); ++i) {
+                if ((m_skinnedVertexArrayPool[i]->geometry == geometry) && m_skinnedVertexArrayPool[i].unique()) {
+                    skinned = m_skinnedVertexArrayPool[i];
+                }
+            }
+
+            if (isNull(skinned)) {
+                skinned.reset(new SkinnedVertexArray());
+                skinned->geometry = geometry;
+                m_skinnedVertexArrayPool.append(skinned);
+            }
+
+            geometry->cpuVertexArray.skin(boneFrame, skinned->vertexArray);
+            skinnedTable.set(geometry, skinned);
+        }
+    }
+
     bool anyMeshIndexArrayOutOfDate = false;
     for (int m = 0; (m < m_meshArray.size()) && ! anyMeshIndexArrayOutOfDate; ++m) {
         const Mesh* mesh = m_meshArray[m];
@@ -230,6 +274,9 @@ void ArticulatedModel::pose
             // We don't need padding on this because currently all indices are 32-bits, and must
             // be 4-byte aligned.
             totalIndexSize += mesh->cpuIndexArray.size();
+            for (int i = 0; i < mesh->lodArray.size(); ++i) {
+                totalIndexSize += mesh->lodArray[i].cpuIndexArray.size();
+            }
         }
 
         if (totalIndexSize > 0) {
@@ -270,6 +317,13 @@ void ArticulatedModel::pose
             }
         }
 
+        // Choose the coarsest level of detail within the error allowed by the pose
+        const Mesh::LevelOfDetail* lod = (pose.lodError > 0.0f) ? mesh->levelOfDetail(pose.lodError) : NULL;
+        if (notNull(lod) && isNull(lod->gpuGeom)) {
+            lod = NULL;
+        }
+        const shared_ptr<UniversalSurface::GPUGeom>& baseGeom = notNull(lod) ? lod->gpuGeom : mesh->gpuGeom;
+
         shared_ptr<UniversalSurface::GPUGeom> gpuGeom;
         if (mesh->gpuGeom->hasBones()) { 
             // Transform bounds
@@ -277,7 +331,7 @@ void ArticulatedModel::pose
             AABox aaBoneTransformedBounds;
             Box boneTransformedBounds;
 
-            gpuGeom = UniversalSurface::GPUGeom::create(mesh->gpuGeom);
+            gpuGeom = UniversalSurface::GPUGeom::create(baseGeom);
 
             for (int i = 0; i < mesh->contributingJoints.size(); ++i) {
                 const CFrame& frame = getFinalBoneTransform(mesh->contributingJoints[i], m_partTransformTable);
@@ -289,15 +343,23 @@ void ArticulatedModel::pose
             gpuGeom->boxBounds = fullBounds;
             gpuGeom->boxBounds.getBounds(gpuGeom->sphereBounds);
         } else {
-            gpuGeom = mesh->gpuGeom;
+            gpuGeom = baseGeom;
         }
 
-        const UniversalSurface::CPUGeom cpuGeom(&mesh->cpuIndexArray, &mesh->geometry->cpuVertexArray);
+        UniversalSurface::CPUGeom cpuGeom(notNull(lod) ? &lod->cpuIndexArray : &mesh->cpuIndexArray, &mesh->geometry->cpuVertexArray);
+
+        // The surface holds the skinned vertices, or else the model that owns the bind pose
+        shared_ptr<ReferenceCountedObject> source = dynamic_pointer_cast<ArticulatedModel>(shared_from_this());
+        const shared_ptr<SkinnedVertexArray>* skinned = skinnedTable.getPointer(geometry);
+        if (notNull(skinned) && mesh->gpuGeom->hasBones()) {
+            cpuGeom.vertexArray = &(*skinned)->vertexArray;
+            source = *skinned;
+        }
 
         const shared_ptr<UniversalSurface>& surface = 
             UniversalSurface::create
             (mesh->name, frame, 
-             prevFrame, material, gpuGeom, cpuGeom, dynamic_pointer_cast<ArticulatedModel>(shared_from_this()), 
+             prevFrame, material, gpuGeom, cpuGeom, source, 
              pose.expressiveLightScatteringProperties,
              dynamic_pointer_cast<Model>(shared_from_this()),
              entity, 
@@ -404,6 +466,13 @@ void ArticulatedModel::Mesh::updateGPUGeom() {
     // TODO: get directly from the model?
     gpuGeom->boneTexture        = boneTexture;    
     gpuGeom->prevBoneTexture    = prevBoneTexture; 
+
+    // Levels of detail share everything except the index stream
+    for (int i = 0; i < lodArray.size(); ++i) {
+        LevelOfDetail& lod = lodArray[i];
+        lod.gpuGeom = UniversalSurface::GPUGeom::create(gpuGeom);
+        lod.gpuGeom->index = lod.gpuIndexArray;
+    }
 }
 
 
@@ -418,7 +487,11 @@ void ArticulatedModel::Mesh::copyToGPU(const shared_ptr<VertexBuffer>& indexBuff
     
     if (isNull(all)) {
         const size_t indexBytes = 4;
-        all = VertexBuffer::create(triangleCount() * 3 * indexBytes, VertexBuffer::WRITE_ONCE);
+        size_t numIndices = cpuIndexArray.size();
+        for (int i = 0; i < lodArray.size(); ++i) {
+            numIndices += lodArray[i].cpuIndexArray.size();
+        }
+        all = VertexBuffer::create(numIndices * indexBytes, VertexBuffer::WRITE_ONCE);
     }
 
     if (false) { //indexBytes == 2) {
@@ -437,6 +510,10 @@ void ArticulatedModel::Mesh::copyToGPU(const shared_ptr<VertexBuffer>& indexBuff
         gpuIndexArray = IndexStream(cpuIndexArray, all);
     }
 
+    for (int i = 0; i < lodArray.size(); ++i) {
+        lodArray[i].gpuIndexArray = IndexStream(lodArray[i].cpuIndexArray, all);
+    }
+
     updateGPUGeom();
 }
 
@@ -265,6 +265,12 @@ void ArticulatedModel::preprocess(const Array<Instruction>& program) {
             }
             break;
 
+        case Instruction::SIMPLIFY:
+        case Instruction::GENERATE_LODS:
+        case Instruction::OPTIMIZE_VERTEX_CACHE:
+            // Deferred to postprocess(), after cleanGeometry() has merged vertices
+            break;
+
         default:
             alwaysAssertM(false, "Instruction not implemented");
         }
@@ -273,6 +279,96 @@ void ArticulatedModel::preprocess(const Array<Instruction>& program) {
 }
 
 
+void ArticulatedModel::postprocess(const Array<Instruction>& program) {
+    for (int i = 0; i < program.size(); ++i) {
+        const Instruction& instruction = program[i];
+        if (instruction.type == Instruction::OPTIMIZE_VERTEX_CACHE) {
+            Array<Mesh*> meshArray;
+            getIdentifiedMeshes(instruction.mesh, meshArray);
+
+            Array<Geometry*> geometryArray;
+            for (int m = 0; m < meshArray.size(); ++m) {
+                meshArray[m]->optimizeVertexCache();
+                if (notNull(meshArray[m]->geometry) && ! geometryArray.contains(meshArray[m]->geometry)) {
+                    geometryArray.append(meshArray[m]->geometry);
+                }
+            }
+
+            // Renumbering the vertices affects every mesh that shares them
+            Array<Mesh*> affectedMeshes;
+            for (int g = 0; g < geometryArray.size(); ++g) {
+                affectedMeshes.fastClear();
+                geometryArray[g]->getAffectedMeshes(m_meshArray, affectedMeshes);
+                geometryArray[g]->optimizeVertexOrder(affectedMeshes);
+            }
+            continue;
+        } else if ((instruction.type != Instruction::SIMPLIFY) && (instruction.type != Instruction::GENERATE_LODS)) {
+            continue;
+        }
+
+        Array<Mesh*> meshArray;
+        getIdentifiedMeshes(instruction.mesh, meshArray);
+
+        for (int m = 0; m < meshArray.size(); ++m) {
+            Mesh* mesh = meshArray[m];
+            if (isNull(mesh->geometry) || (mesh->primitive != PrimitiveType::TRIANGLES)) {
+                continue;
+            }
+            const CPUVertexArray& vertexArray = mesh->geometry->cpuVertexArray;
+
+            // Lock the vertices that other meshes of the same geometry use, so that
+            // no cracks open between the meshes
+            Array<bool> locked;
+            locked.resize(vertexArray.size());
+            for (int v = 0; v < locked.size(); ++v) {
+                locked[v] = false;
+            }
+            for (int n = 0; n < m_meshArray.size(); ++n) {
+                const Mesh* other = m_meshArray[n];
+                if ((other != mesh) && (other->geometry == mesh->geometry)) {
+                    for (int j = 0; j < other->cpuIndexArray.size(); ++j) {
+                        locked[other->cpuIndexArray[j]] = true;
+                    }
+                }
+            }
+
+            if (instruction.type == Instruction::SIMPLIFY) {
+                Array<int> result;
+                MeshSimplifier::simplify(vertexArray, mesh->cpuIndexArray, result, MeshSimplifier::Settings(instruction.arg), locked);
+                mesh->cpuIndexArray.swap(result);
+                mesh->lodArray.clear();
+
+                // Simplification keeps the original triangle order, which is no longer
+                // cache-friendly once most of the triangles are gone
+                mesh->optimizeVertexCache();
+            } else {
+                const int numLevels = int(instruction.arg.number());
+                const MeshSimplifier::Settings settings = (instruction.source.size() == 3) ? 
+                    MeshSimplifier::Settings(instruction.source[2]) : MeshSimplifier::Settings();
+
+                // Each level is simplified from the previous one, so the errors accumulate
+                mesh->lodArray.clear();
+                const Array<int>* previous = &mesh->cpuIndexArray;
+                float previousError = 0.0f;
+                for (int level = 0; level < numLevels; ++level) {
+                    Mesh::LevelOfDetail lod;
+                    lod.error = previousError + MeshSimplifier::simplify(vertexArray, *previous, lod.cpuIndexArray, settings, locked);
+                    if ((lod.cpuIndexArray.size() == previous->size()) || (lod.cpuIndexArray.size() == 0)) {
+                        // No further progress is possible
+                        break;
+                    }
+                    MeshAlg::optimizeVertexCache(lod.cpuIndexArray, vertexArray.size());
+                    mesh->lodArray.append(lod);
+                    previous = &mesh->lodArray.last().cpuIndexArray;
+                    previousError = lod.error;
+                }
+                mesh->clearIndexStream();
+            }
+        }
+    }
+}
+
+
 
 void ArticulatedModel::setMaterial
    (Instruction::Identifier                     meshId,
@@ -29,6 +29,7 @@ ArticulatedModel::CleanGeometrySettings::CleanGeometrySettings(const Any& a) {
         maxSmoothAngle = toRadians(f);
     }
     r.getIfPresent("maxEdgeLength", maxEdgeLength);
+    r.getIfPresent("optimizeVertexCache", optimizeVertexCache);
     r.verifyDone();
 }
 
@@ -42,6 +43,7 @@ Any ArticulatedModel::CleanGeometrySettings::toAny() const {
     a["maxNormalWeldAngleDegrees"]  = toDegrees(maxNormalWeldAngle);
     a["maxSmoothAngleDegrees"]      = toDegrees(maxSmoothAngle);
     a["maxEdgeLength"]              = maxEdgeLength;
+    a["optimizeVertexCache"]        = optimizeVertexCache;
     return a;
 }
 
@@ -423,6 +425,33 @@ ArticulatedModel::Instruction::Instruction(const Any& any) {
         part = any[0];
         arg = any[1];
 
+    } else if (instructionName == "simplify") {
+
+        type = SIMPLIFY;
+        any.verifySize(2);
+        mesh = any[0];
+        // Parse the settings now so that errors are reported at load time
+        (void)MeshSimplifier::Settings(any[1]);
+        arg = any[1];
+
+    } else if (instructionName == "generateLODs") {
+
+        type = GENERATE_LODS;
+        any.verifySize(2, 3);
+        mesh = any[0];
+        arg = any[1];
+        any.verify(int(arg.number()) >= 0, "The number of levels of detail must be nonnegative");
+        // The optional third (settings) argument is parsed during application
+        if (any.size() == 3) {
+            (void)MeshSimplifier::Settings(any[2]);
+        }
+
+    } else if (instructionName == "optimizeVertexCache") {
+
+        type = OPTIMIZE_VERTEX_CACHE;
+        any.verifySize(1);
+        mesh = any[0];
+
     } else {
 
         any.verify(false, String("Unknown instruction: \"") + instructionName + "\"");
@@ -433,7 +462,7 @@ ArticulatedModel::Instruction::Instruction(const Any& any) {
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-ArticulatedModel::Pose::Pose(const Any& any) : numInstances(1) {
+ArticulatedModel::Pose::Pose(const Any& any) : numInstances(1), cpuSkinning(false), lodError(0.0f) {
     if (any.nameBeginsWith("UniversalMaterial") || 
         any.nameBeginsWith("Texture") || 
         any.nameBeginsWith("Color")) {
@@ -460,6 +489,9 @@ ArticulatedModel::Pose::Pose(const Any& any) : numInstances(1) {
     }
 
     reader.getIfPresent("frameTable", frameTable);
+    reader.getIfPresent("cpuSkinning", cpuSkinning);
+    reader.getIfPresent("lodError", lodError);
+    any.verify(lodError >= 0.0f, "lodError must be nonnegative");
     reader.verifyDone();
 }
 
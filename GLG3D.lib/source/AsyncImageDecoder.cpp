@@ -0,0 +1,92 @@
+/**
+  \file GLG3D.lib/source/AsyncImageDecoder.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#include "GLG3D/AsyncImageDecoder.h"
+#include "G3D/Image.h"
+#include "G3D/CPUPixelTransferBuffer.h"
+
+namespace G3D {
+
+/** Decodes are enqueued rather than spawned because TBB guarantees enqueued tasks a worker thread
+    even on a single-core machine, where a thread blocked on a Future would otherwise wait forever */
+static tbb::task_arena& decodeArena() {
+    static tbb::task_arena arena;
+    return arena;
+}
+
+
+AsyncImageDecoder::Future AsyncImageDecoder::decode
+   (const String&                   filename,
+    const Texture::Preprocess&      preprocess,
+    const Transform&                transform,
+    const ImageFormat*              imageFormat) {
+
+    typedef std::promise< shared_ptr<CPUPixelTransferBuffer> > Promise;
+
+    // The task owns the promise, so the caller may discard the Future
+    const shared_ptr<Promise> promise(new Promise());
+    const Future future = promise->get_future().share();
+
+    decodeArena().enqueue([promise, filename, preprocess, transform, imageFormat]() {
+        try {
+            const shared_ptr<Image>& image = Image::fromFile(filename, imageFormat);
+            if (transform) {
+                transform(image);
+            }
+            const shared_ptr<CPUPixelTransferBuffer>& buffer = image->toPixelTransferBuffer();
+            const bool applied = applyPreprocess(preprocess, buffer);
+            (void)applied;
+            debugAssertM(applied, "Texture preprocessing only implemented for 1, 3, 4 8-bit channels.");
+            promise->set_value(buffer);
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+
+    return future;
+}
+
+
+bool AsyncImageDecoder::applyPreprocess(const Texture::Preprocess& preprocess, const shared_ptr<CPUPixelTransferBuffer>& buffer) {
+    if ((preprocess.modulate == Color4::one()) && (preprocess.gammaAdjust == 1.0f) && ! preprocess.convertToPremultipliedAlpha) {
+        return true;
+    }
+
+    const ImageFormat::Code code = buffer->format()->code;
+    if ((code != ImageFormat::CODE_R8) && (code != ImageFormat::CODE_L8) &&
+        (code != ImageFormat::CODE_RGB8) && (code != ImageFormat::CODE_RGBA8)) {
+        return false;
+    }
+
+    // Rows may be padded, so adjust one row at a time
+    const int rowBytes = buffer->width() * buffer->format()->cpuBitsPerPixel / 8;
+    uint8* row = static_cast<uint8*>(buffer->buffer());
+    if (int(buffer->stride()) == rowBytes) {
+        preprocess.modulateImage(code, row, rowBytes * buffer->height() * buffer->depth());
+    } else {
+        for (int y = 0; y < buffer->height() * buffer->depth(); ++y, row += buffer->stride()) {
+            preprocess.modulateImage(code, row, rowBytes);
+        }
+    }
+    return true;
+}
+
+
+Texture::Preprocess AsyncImageDecoder::remainingPreprocess(const Texture::Preprocess& preprocess) {
+    Texture::Preprocess p = preprocess;
+    p.modulate = Color4::one();
+    p.gammaAdjust = 1.0f;
+    p.convertToPremultipliedAlpha = false;
+    return p;
+}
+
+} // namespace G3D
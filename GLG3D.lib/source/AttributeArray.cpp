@@ -216,6 +216,14 @@ void* AttributeArray::mapBuffer(GLenum permissions) {
 }
 
 
+void* AttributeArray::mapBufferForWrite(int numElements) {
+    alwaysAssertM(m_elementSize * numElements <= m_maxSize,
+        "A AttributeArray can only be resized to fit within its original size.");
+    m_numElements = numElements;
+    return mapBuffer(GL_WRITE_ONLY);
+}
+
+
 void AttributeArray::unmapBuffer() {
     glUnmapBuffer(openGLTarget());
     glBindBuffer(openGLTarget(), GL_NONE);
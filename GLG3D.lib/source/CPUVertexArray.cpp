@@ -5,6 +5,8 @@
 #include "GLG3D/CPUVertexArray.h"
 #include "GLG3D/AttributeArray.h"
 #include "G3D/CoordinateFrame.h"
+#include "G3D/System.h"
+#include <immintrin.h>
 
 namespace G3D {
 
@@ -91,6 +93,156 @@ void CPUVertexArray::transformAndAppend(const CPUVertexArray& otherArray, const
     }
 }
 
+/** Number of vertices skinned by each task of CPUVertexArray::skin */
+static const int VERTICES_PER_SKIN_TASK = 2048;
+
+/** Writes a blended and transformed vertex. \a p, \a n, and \a t are the skinned position, 
+    normal, and tangent in the xyz components. */
+static inline void storeSkinnedVertex(__m128 p, __m128 n, __m128 t, const CPUVertexArray::Vertex& src, CPUVertexArray::Vertex& dst) {
+    float P[4], N[4], T[4];
+    _mm_storeu_ps(P, p);
+    _mm_storeu_ps(N, n);
+    _mm_storeu_ps(T, t);
+
+    dst.position = Point3(P[0], P[1], P[2]);
+    dst.normal   = Vector3(N[0], N[1], N[2]).directionOrZero();
+    dst.tangent  = Vector4(Vector3(T[0], T[1], T[2]).directionOrZero(), src.tangent.w);
+}
+
+
+/** \a bone holds three rows of [R | T] per bone. */
+static void skinSSE
+   (const float*                        bone,
+    const Vector4int32*                 boneIndex,
+    const Vector4*                      boneWeight,
+    const CPUVertexArray::Vertex*       src,
+    CPUVertexArray::Vertex*             dst,
+    int                                 start,
+    int                                 end) {
+
+    for (int i = start; i < end; ++i) {
+        // Blend the bone matrices
+        __m128 r0 = _mm_setzero_ps(), r1 = _mm_setzero_ps(), r2 = _mm_setzero_ps();
+        for (int b = 0; b < 4; ++b) {
+            const float* B = bone + 12 * boneIndex[i][b];
+            const __m128 w = _mm_set1_ps(boneWeight[i][b]);
+            r0 = _mm_add_ps(r0, _mm_mul_ps(w, _mm_loadu_ps(B)));
+            r1 = _mm_add_ps(r1, _mm_mul_ps(w, _mm_loadu_ps(B + 4)));
+            r2 = _mm_add_ps(r2, _mm_mul_ps(w, _mm_loadu_ps(B + 8)));
+        }
+
+        // Columns of the blended matrix
+        __m128 r3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        const CPUVertexArray::Vertex& v = src[i];
+        const __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.position.x), r0), _mm_mul_ps(_mm_set1_ps(v.position.y), r1)),
+                                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.position.z), r2), r3));
+        const __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.normal.x), r0), _mm_mul_ps(_mm_set1_ps(v.normal.y), r1)),
+                                    _mm_mul_ps(_mm_set1_ps(v.normal.z), r2));
+        const __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.tangent.x), r0), _mm_mul_ps(_mm_set1_ps(v.tangent.y), r1)),
+                                    _mm_mul_ps(_mm_set1_ps(v.tangent.z), r2));
+        storeSkinnedVertex(p, n, t, v, dst[i]);
+    }
+}
+
+
+/** AVX version of skinSSE. Blends the first two matrix rows in one register and
+    transforms the normal and tangent together. */
+G3D_TARGET_AVX static void skinAVX
+   (const float*                        bone,
+    const Vector4int32*                 boneIndex,
+    const Vector4*                      boneWeight,
+    const CPUVertexArray::Vertex*       src,
+    CPUVertexArray::Vertex*             dst,
+    int                                 start,
+    int                                 end) {
+
+    for (int i = start; i < end; ++i) {
+        __m256 r01 = _mm256_setzero_ps();
+        __m128 r2  = _mm_setzero_ps();
+        for (int b = 0; b < 4; ++b) {
+            const float* B = bone + 12 * boneIndex[i][b];
+            const __m256 w = _mm256_set1_ps(boneWeight[i][b]);
+            r01 = _mm256_add_ps(r01, _mm256_mul_ps(w, _mm256_loadu_ps(B)));
+            r2  = _mm_add_ps(r2, _mm_mul_ps(_mm256_castps256_ps128(w), _mm_loadu_ps(B + 8)));
+        }
+
+        __m128 r0 = _mm256_castps256_ps128(r01);
+        __m128 r1 = _mm256_extractf128_ps(r01, 1);
+        __m128 r3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        const CPUVertexArray::Vertex& v = src[i];
+        const __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.position.x), r0), _mm_mul_ps(_mm_set1_ps(v.position.y), r1)),
+                                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.position.z), r2), r3));
+
+        // Normal in the low half, tangent in the high half
+        const __m256 c0 = _mm256_insertf128_ps(_mm256_castps128_ps256(r0), r0, 1);
+        const __m256 c1 = _mm256_insertf128_ps(_mm256_castps128_ps256(r1), r1, 1);
+        const __m256 c2 = _mm256_insertf128_ps(_mm256_castps128_ps256(r2), r2, 1);
+        const __m256 x  = _mm256_setr_ps(v.normal.x, v.normal.x, v.normal.x, v.normal.x, v.tangent.x, v.tangent.x, v.tangent.x, v.tangent.x);
+        const __m256 y  = _mm256_setr_ps(v.normal.y, v.normal.y, v.normal.y, v.normal.y, v.tangent.y, v.tangent.y, v.tangent.y, v.tangent.y);
+        const __m256 z  = _mm256_setr_ps(v.normal.z, v.normal.z, v.normal.z, v.normal.z, v.tangent.z, v.tangent.z, v.tangent.z, v.tangent.z);
+        const __m256 nt = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, c0), _mm256_mul_ps(y, c1)), _mm256_mul_ps(z, c2));
+
+        storeSkinnedVertex(p, _mm256_castps256_ps128(nt), _mm256_extractf128_ps(nt, 1), v, dst[i]);
+    }
+}
+
+
+void CPUVertexArray::skin(const Array<CFrame>& boneFrame, CPUVertexArray& dst, bool allowAVX) const {
+    alwaysAssertM(hasBones && (boneIndices.size() == size()) && (boneWeights.size() == size()), 
+                  "CPUVertexArray::skin requires bone indices and weights");
+    alwaysAssertM(&dst != this, "CPUVertexArray::skin cannot skin in place");
+
+    if (dst.size() != size()) {
+        dst.clear();
+        dst.copyFrom(*this);
+        dst.vertexColors.copyPOD(vertexColors);
+        dst.hasVertexColors = hasVertexColors;
+    }
+
+    // Pack the bones as rows of [R | T] so that blending is a weighted sum of registers
+    Array<float> bone;
+    bone.resize(12 * boneFrame.size());
+    for (int b = 0; b < boneFrame.size(); ++b) {
+        const Matrix3& R = boneFrame[b].rotation;
+        const Vector3& T = boneFrame[b].translation;
+        float* row = bone.getCArray() + 12 * b;
+        for (int r = 0; r < 3; ++r) {
+            row[4 * r + 0] = R[r][0];
+            row[4 * r + 1] = R[r][1];
+            row[4 * r + 2] = R[r][2];
+            row[4 * r + 3] = T[r];
+        }
+    }
+
+#   ifdef G3D_DEBUG
+        for (int i = 0; i < boneIndices.size(); ++i) {
+            for (int b = 0; b < 4; ++b) {
+                debugAssertM((boneIndices[i][b] >= 0) && (boneIndices[i][b] < boneFrame.size()), "Bone index out of range");
+            }
+        }
+#   endif
+
+    const bool useAVX = allowAVX && System::hasAVX();
+    const float*         B   = bone.getCArray();
+    const Vector4int32*  I   = boneIndices.getCArray();
+    const Vector4*       W   = boneWeights.getCArray();
+    const Vertex*        src = vertex.getCArray();
+    Vertex*              out = dst.vertex.getCArray();
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, size(), VERTICES_PER_SKIN_TASK), [&](const tbb::blocked_range<int>& r) {
+        if (useAVX) {
+            skinAVX(B, I, W, src, out, r.begin(), r.end());
+        } else {
+            skinSSE(B, I, W, src, out, r.begin(), r.end());
+        }
+    });
+}
+
+
 void CPUVertexArray::copyToGPU
     (AttributeArray&               vertex, 
      AttributeArray&               normal, 
@@ -203,6 +203,10 @@ void DefaultRenderer::render
         depthPeelFramebuffer->resize(framebuffer->width(), framebuffer->height());
     }
 
+    // Read the bounds once for the camera and shadow map culling
+    m_surfaceBounds.update(allSurfaces);
+    m_surfaceBoundsCurrent = true;
+
     // Cull and sort
     Array<shared_ptr<Surface> > sortedVisibleSurfaces, forwardOpaqueSurfaces, forwardBlendedSurfaces;
     cullAndSort(gbuffer, allSurfaces, sortedVisibleSurfaces, forwardOpaqueSurfaces, forwardBlendedSurfaces);
@@ -240,6 +244,9 @@ void DefaultRenderer::render
         }
                 
     } rd->popState();
+
+    m_surfaceBoundsCurrent = false;
+    m_surfaceBounds.clear();
 }
 
 
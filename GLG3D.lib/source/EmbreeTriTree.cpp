@@ -82,6 +82,8 @@ void EmbreeTriTree::clear() {
 
 
 void EmbreeTriTree::rebuild() {
+    updateMaterialIndex();
+
     m_alphaTriangleArray.fastClear();
     m_opaqueTriangleArray.fastClear();
     if (m_scene) {
@@ -0,0 +1,493 @@
+/**
+  \file GLG3D/InstancedTriTree.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+*/
+#include "G3D/Box.h"
+#include "G3D/Sphere.h"
+#include "G3D/Table.h"
+#include "G3D/Intersect.h"
+#include "G3D/PrecomputedRay.h"
+#include "G3D/CollisionDetection.h"
+#include "GLG3D/InstancedTriTree.h"
+#include "GLG3D/TriTree.h"
+#include "GLG3D/Surface.h"
+#include "GLG3D/Surfel.h"
+#include "GLG3D/SurfelBuffer.h"
+#include "GLG3D/UniversalSurface.h"
+#include "GLG3D/Material.h"
+
+namespace G3D {
+
+namespace _internal {
+
+/** The surfaces of one entity part: a shared vertex array placed at one CoordinateFrame */
+class InstanceKey {
+public:
+    const CPUVertexArray*   vertexArray;
+    CFrame                  frame;
+
+    InstanceKey(const CPUVertexArray* vertexArray, const CFrame& frame) : vertexArray(vertexArray), frame(frame) {}
+
+    static size_t hashCode(const InstanceKey& key) {
+        const size_t cframeHash = key.frame.rotation.row(0).hashCode() + key.frame.rotation.row(1).hashCode() +
+                                  key.frame.rotation.row(2).hashCode() + key.frame.translation.hashCode();
+        return HashTrait<const void*>::hashCode(key.vertexArray) + cframeHash;
+    }
+
+    static bool equals(const InstanceKey& a, const InstanceKey& b) {
+        return (a.vertexArray == b.vertexArray) && (a.frame == b.frame);
+    }
+};
+
+
+/** One UniversalSurface's contribution to a mesh */
+class MeshPart {
+public:
+    const Array<int>*               index;
+    shared_ptr<UniversalSurface>    surface;
+
+    /** Surfaces with the same indices and material produce identical Tris */
+    bool operator==(const MeshPart& other) const {
+        return (index == other.index) &&
+            (surface->material() == other.surface->material()) &&
+            (surface->gpuGeom()->twoSided == other.surface->gpuGeom()->twoSided);
+    }
+};
+
+
+class PendingInstance {
+public:
+    const CPUVertexArray*   vertexArray;
+    CFrame                  frame;
+    CFrame                  prevFrame;
+    Array<MeshPart>         partArray;
+
+    bool hasSameParts(const PendingInstance& other) const {
+        if (partArray.size() != other.partArray.size()) {
+            return false;
+        }
+        for (int i = 0; i < partArray.size(); ++i) {
+            if (! (partArray[i] == other.partArray[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // _internal
+
+
+InstancedTriTree::InstancedTriTree(const MeshTreeFactory& meshTreeFactory) : m_meshTreeFactory(meshTreeFactory) {
+    if (! m_meshTreeFactory) {
+        m_meshTreeFactory = [] { return shared_ptr<TriTreeBase>(new TriTree()); };
+    }
+}
+
+
+InstancedTriTree::~InstancedTriTree() {
+    clear();
+}
+
+
+void InstancedTriTree::clear() {
+    TriTreeBase::clear();
+    m_meshTree.clear();
+    m_meshBounds.clear();
+    m_instanceArray.clear();
+    m_node.clear();
+    m_leafInstance.clear();
+}
+
+
+void InstancedTriTree::setContents
+   (const Array<shared_ptr<Surface>>&   surfaceArray,
+    ImageStorage                        newStorage) {
+
+    using namespace _internal;
+    clear();
+
+    // Group surfaces into instances
+    Table<InstanceKey, int, InstanceKey, InstanceKey> instanceTable;
+    Array<PendingInstance> pendingArray;
+    Array<shared_ptr<Surface>> flattenArray;
+
+    const bool CURRENT = false, PREVIOUS = true;
+    for (int s = 0; s < surfaceArray.size(); ++s) {
+        const shared_ptr<UniversalSurface>& surface = dynamic_pointer_cast<UniversalSurface>(surfaceArray[s]);
+        if (isNull(surface) || isNull(surface->cpuGeom().vertexArray)) {
+            flattenArray.append(surfaceArray[s]);
+            continue;
+        }
+
+        debugAssert(surface->gpuGeom()->primitive == PrimitiveType::TRIANGLES);
+
+        CFrame frame;
+        surface->getCoordinateFrame(frame, CURRENT);
+
+        bool created = false;
+        int& p = instanceTable.getCreate(InstanceKey(surface->cpuGeom().vertexArray, frame), created);
+        if (created) {
+            p = pendingArray.size();
+            PendingInstance& pending = pendingArray.next();
+            pending.vertexArray = surface->cpuGeom().vertexArray;
+            pending.frame = frame;
+            surface->getCoordinateFrame(pending.prevFrame, PREVIOUS);
+        }
+
+        MeshPart& part = pendingArray[p].partArray.next();
+        part.index = surface->cpuGeom().index;
+        part.surface = surface;
+    }
+
+    // Share meshes between instances with identical parts. Most vertex arrays
+    // have one mesh, so a linear search over the candidates is sufficient.
+    Table<const CPUVertexArray*, Array<int>> meshTable;
+    Array<int> meshPending;
+    for (int p = 0; p < pendingArray.size(); ++p) {
+        const PendingInstance& pending = pendingArray[p];
+        Array<int>& candidateArray = meshTable.getCreate(pending.vertexArray);
+
+        int meshIndex = -1;
+        for (int c = 0; (c < candidateArray.size()) && (meshIndex == -1); ++c) {
+            if (pendingArray[meshPending[candidateArray[c]]].hasSameParts(pending)) {
+                meshIndex = candidateArray[c];
+            }
+        }
+
+        if (meshIndex == -1) {
+            Array<Tri> triArray;
+            CPUVertexArray vertexArray;
+            vertexArray.copyFrom(*pending.vertexArray);
+            for (int i = 0; i < pending.partArray.size(); ++i) {
+                const MeshPart& part = pending.partArray[i];
+                const Array<int>& index = *part.index;
+                const bool twoSided = part.surface->gpuGeom()->twoSided;
+                const bool hasPartialCoverage = part.surface->material()->hasPartialCoverage();
+                for (int j = 0; j < index.size(); j += 3) {
+                    triArray.append(Tri(index[j], index[j + 1], index[j + 2], vertexArray, part.surface, twoSided, hasPartialCoverage));
+                }
+            }
+
+            meshIndex = addMesh(triArray, vertexArray, newStorage);
+            candidateArray.append(meshIndex);
+            meshPending.append(p);
+        }
+
+        addInstance(meshIndex, pending.frame, pending.prevFrame);
+    }
+
+    // Surfaces without shared CPU geometry are flattened into a single world-space mesh
+    if (flattenArray.size() > 0) {
+        Array<Tri> triArray;
+        CPUVertexArray vertexArray;
+        Surface::getTris(flattenArray, vertexArray, triArray, false);
+        if (triArray.size() > 0) {
+            addInstance(addMesh(triArray, vertexArray, newStorage), CFrame());
+        }
+    }
+
+    Surface::setStorage(surfaceArray, newStorage);
+    rebuild();
+}
+
+
+void InstancedTriTree::setContents
+   (const Array<Tri>&                   triArray,
+    const CPUVertexArray&               vertexArray,
+    ImageStorage                        newStorage) {
+
+    clear();
+    addInstance(addMesh(triArray, vertexArray, newStorage), CFrame());
+    rebuild();
+}
+
+
+int InstancedTriTree::addMesh
+   (const Array<Tri>&                   triArray,
+    const CPUVertexArray&               vertexArray,
+    ImageStorage                        newStorage) {
+
+    const shared_ptr<TriTreeBase>& tree = m_meshTreeFactory();
+    tree->setContents(triArray, vertexArray, newStorage);
+
+    AABox& bounds = m_meshBounds.next();
+    bounds = AABox::empty();
+    for (int t = 0; t < triArray.size(); ++t) {
+        for (int v = 0; v < 3; ++v) {
+            bounds.merge(triArray[t].position(vertexArray, v));
+        }
+    }
+
+    m_meshTree.append(tree);
+    return m_meshTree.size() - 1;
+}
+
+
+int InstancedTriTree::addInstance(int meshIndex, const CFrame& frame, const CFrame& prevFrame) {
+    debugAssert(meshIndex >= 0 && meshIndex < m_meshTree.size());
+    m_instanceArray.append(Instance(meshIndex, frame, prevFrame));
+    return m_instanceArray.size() - 1;
+}
+
+
+void InstancedTriTree::rebuild() {
+    m_node.fastClear();
+    m_leafInstance.fastClear();
+
+    Array<Point3> center;
+    center.resize(m_instanceArray.size());
+    for (int i = 0; i < m_instanceArray.size(); ++i) {
+        Instance& instance = m_instanceArray[i];
+        const AABox& meshBounds = m_meshBounds[instance.meshIndex];
+        if (meshBounds.isEmpty()) {
+            // Nothing to intersect
+            instance.bounds = AABox::empty();
+        } else {
+            instance.frame.toWorldSpace(meshBounds, instance.bounds);
+            center[i] = instance.bounds.center();
+            m_leafInstance.append(i);
+        }
+    }
+
+    if (m_leafInstance.size() > 0) {
+        m_node.next();
+        buildNode(0, 0, m_leafInstance.size(), center);
+    }
+}
+
+
+void InstancedTriTree::buildNode(int nodeIndex, int first, int count, const Array<Point3>& center) {
+    int* instance = m_leafInstance.getCArray() + first;
+
+    AABox bounds = m_instanceArray[instance[0]].bounds;
+    AABox centerBounds(center[instance[0]]);
+    for (int i = 1; i < count; ++i) {
+        bounds.merge(m_instanceArray[instance[i]].bounds);
+        centerBounds.merge(center[instance[i]]);
+    }
+
+    m_node[nodeIndex].bounds = bounds;
+
+    if ((count <= INSTANCES_PER_LEAF) || (centerBounds.extent().max() == 0.0f)) {
+        m_node[nodeIndex].first = first;
+        m_node[nodeIndex].count = count;
+        return;
+    }
+
+    // Median split along the longest axis of the instance centers
+    const Vector3::Axis axis = centerBounds.extent().primaryAxis();
+    const int half = count / 2;
+    std::nth_element(instance, instance + half, instance + count, [&](int a, int b) {
+        return center[a][axis] < center[b][axis];
+    });
+
+    // Children are adjacent. Do not hold a reference to m_node across the recursion,
+    // which may reallocate it.
+    const int child = m_node.size();
+    m_node.resize(child + 2);
+    m_node[nodeIndex].first = child;
+    m_node[nodeIndex].count = 0;
+
+    buildNode(child, first, half, center);
+    buildNode(child + 1, first + half, count - half, center);
+}
+
+
+bool InstancedTriTree::intersectRay
+   (const Ray&                          ray,
+    Hit&                                hit,
+    IntersectRayOptions                 options) const {
+
+    hit.triIndex = Hit::NONE;
+    hit.instanceID = Hit::NONE;
+    if (m_node.size() == 0) {
+        return false;
+    }
+
+    const PrecomputedRay worldRay(ray);
+    float maxDistance = ray.maxDistance();
+
+    // The top-level hierarchy is balanced, so this is deep enough for 2^64 instances
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_node[stack[--stackSize]];
+
+        float entry = 0.0f;
+        if (! Intersect::rayAABox(worldRay, node.bounds, entry) || (entry > maxDistance)) {
+            continue;
+        }
+
+        if (node.count == 0) {
+            stack[stackSize++] = node.first + 1;
+            stack[stackSize++] = node.first;
+            continue;
+        }
+
+        for (int i = 0; i < node.count; ++i) {
+            const int instanceID = m_leafInstance[node.first + i];
+            const Instance& instance = m_instanceArray[instanceID];
+
+            // Rigid transformations preserve distance along the ray
+            const Ray objectRay(instance.frame.pointToObjectSpace(ray.origin()),
+                                instance.frame.vectorToObjectSpace(ray.direction()),
+                                ray.minDistance(), maxDistance);
+
+            Hit objectHit;
+            if (m_meshTree[instance.meshIndex]->intersectRay(objectRay, objectHit, options) && (objectHit.distance <= maxDistance)) {
+                hit = objectHit;
+                hit.instanceID = instanceID;
+                maxDistance = objectHit.distance;
+
+                if ((options & OCCLUSION_TEST_ONLY) != 0) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return (hit.triIndex != Hit::NONE);
+}
+
+
+void InstancedTriTree::sample(const Hit& hit, shared_ptr<Surfel>& surfel) const {
+    if ((hit.triIndex == Hit::NONE) || (hit.instanceID == Hit::NONE)) {
+        surfel = nullptr;
+        return;
+    }
+
+    const Instance& instance = m_instanceArray[hit.instanceID];
+    const shared_ptr<TriTreeBase>& tree = m_meshTree[instance.meshIndex];
+    tree->triArray()[hit.triIndex].sample(hit.u, hit.v, hit.triIndex, tree->vertexArray(), hit.backface, surfel);
+
+    if (notNull(surfel)) {
+        surfel->transformToWorldSpace(instance.frame);
+        surfel->prevPosition = instance.prevFrame.pointToWorldSpace(surfel->prevPosition);
+    }
+}
+
+
+void InstancedTriTree::sample(const Hit& hit, SurfelBuffer& buffer, int index) const {
+    if ((hit.triIndex == Hit::NONE) || (hit.instanceID == Hit::NONE)) {
+        buffer.setNone(index);
+        return;
+    }
+
+    const Instance& instance = m_instanceArray[hit.instanceID];
+    Hit meshHit = hit;
+    meshHit.instanceID = Hit::NONE;
+    m_meshTree[instance.meshIndex]->sample(meshHit, buffer, index);
+
+    if (buffer.hasSurfel(index)) {
+        buffer.transformToWorldSpace(index, instance.frame, instance.prevFrame);
+    }
+}
+
+
+void InstancedTriTree::intersectBoxInstances(const AABox& box, const std::function<void (int, const AABox&)>& callback) const {
+    if (m_node.size() == 0) {
+        return;
+    }
+
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_node[stack[--stackSize]];
+        if (! node.bounds.intersects(box)) {
+            continue;
+        }
+
+        if (node.count == 0) {
+            stack[stackSize++] = node.first + 1;
+            stack[stackSize++] = node.first;
+            continue;
+        }
+
+        for (int i = 0; i < node.count; ++i) {
+            const int instanceID = m_leafInstance[node.first + i];
+            const Instance& instance = m_instanceArray[instanceID];
+            if (instance.bounds.intersects(box)) {
+                AABox objectBox;
+                instance.frame.toObjectSpace(box).getBounds(objectBox);
+                callback(instanceID, objectBox);
+            }
+        }
+    }
+}
+
+
+void InstancedTriTree::intersectBox
+   (const AABox&                        box,
+    Array<Tri>&                         results,
+    Array<int>&                         instanceID) const {
+
+    results.fastClear();
+    instanceID.fastClear();
+    Array<Tri> candidateArray;
+    intersectBoxInstances(box, [&](int id, const AABox& objectBox) {
+        const Instance& instance = m_instanceArray[id];
+        const CPUVertexArray& vertexArray = m_meshTree[instance.meshIndex]->vertexArray();
+
+        // The object-space box is conservative, so test the transformed triangles exactly
+        candidateArray.fastClear();
+        m_meshTree[instance.meshIndex]->intersectBox(objectBox, candidateArray);
+        for (int t = 0; t < candidateArray.size(); ++t) {
+            const Tri& tri = candidateArray[t];
+            if (CollisionDetection::fixedSolidBoxIntersectsFixedTriangle(box,
+                    instance.frame.toWorldSpace(Triangle(tri.position(vertexArray, 0), tri.position(vertexArray, 1), tri.position(vertexArray, 2))))) {
+                results.append(tri);
+                instanceID.append(id);
+            }
+        }
+    });
+}
+
+
+void InstancedTriTree::intersectBox
+   (const AABox&                        box,
+    Array<Tri>&                         results) const {
+    Array<int> ignore;
+    intersectBox(box, results, ignore);
+}
+
+
+void InstancedTriTree::intersectSphere
+   (const Sphere&                       sphere,
+    Array<Tri>&                         results,
+    Array<int>&                         instanceID) const {
+
+    AABox box;
+    sphere.getBounds(box);
+    intersectBox(box, results, instanceID);
+
+    // Iterate backwards because we're removing
+    for (int i = results.size() - 1; i >= 0; --i) {
+        const Tri& tri = results[i];
+        const Instance& instance = m_instanceArray[instanceID[i]];
+        const CPUVertexArray& vertexArray = m_meshTree[instance.meshIndex]->vertexArray();
+        if (! CollisionDetection::fixedSolidSphereIntersectsFixedTriangle(sphere,
+                instance.frame.toWorldSpace(Triangle(tri.position(vertexArray, 0), tri.position(vertexArray, 1), tri.position(vertexArray, 2))))) {
+            results.fastRemove(i);
+            instanceID.fastRemove(i);
+        }
+    }
+}
+
+
+void InstancedTriTree::intersectSphere
+   (const Sphere&                       sphere,
+    Array<Tri>&                         results) const {
+    Array<int> ignore;
+    intersectSphere(sphere, results, ignore);
+}
+
+} // G3D
@@ -15,6 +15,7 @@
 #include "GLG3D/Light.h"
 #include "GLG3D/RenderDevice.h"
 #include "GLG3D/ShadowMap.h"
+#include "GLG3D/SurfaceBoundsCache.h"
 #include "G3D/Cone.h"
 #include "GLG3D/GLCaps.h"
 #include "GLG3D/GApp.h"
@@ -652,55 +653,61 @@ void Light::makeGUI(class GuiPane* pane, class GApp* app) {
 
 
 void Light::renderShadowMaps(RenderDevice* rd, const Array<shared_ptr<Light> >& lightArray, const Array<shared_ptr<Surface> >& allSurfaces, CullFace cullFace) {
+    SurfaceBoundsCache bounds;
+    bounds.update(allSurfaces);
+    renderShadowMaps(rd, lightArray, bounds, cullFace);
+}
+
+
+void Light::renderShadowMaps(RenderDevice* rd, const Array<shared_ptr<Light> >& lightArray, const SurfaceBoundsCache& surfaceBounds, CullFace cullFace) {
     BEGIN_PROFILER_EVENT("Light::renderShadowMaps");
 
     // Find the scene bounds
     AABox shadowCasterBounds;
-    bool ignoreBool;
-    Surface::getBoxBounds(allSurfaces, shadowCasterBounds, false, ignoreBool, true);
+    surfaceBounds.getBoxBounds(shadowCasterBounds, true);
 
-    Array<shared_ptr<Surface> > lightVisible;
-
-    // Generate shadow maps
-    int s = 0;
+    // Compute the view of every shadow map first so that all of them can be culled in one pass
+    Array<shared_ptr<Light> > shadowLight;
+    Array<Matrix4> lightProjectionMatrix;
+    Array<SurfaceBoundsCache::View> lightView;
     for (int L = 0; L < lightArray.size(); ++L) {
         const shared_ptr<Light>& light = lightArray[L];
         if (light->castsShadows() && light->enabled()) {
-
             CFrame lightFrame;
-            Matrix4 lightProjectionMatrix;
+            Matrix4 projectionMatrix;
                 
             const float nearMin = -light->nearPlaneZLimit();
             const float farMax = -light->farPlaneZLimit();
-            ShadowMap::computeMatrices(light, shadowCasterBounds, lightFrame, light->shadowMap()->projection(), lightProjectionMatrix, 20, 20, nearMin, farMax);
-                
-            // Cull objects not visible to the light
+            ShadowMap::computeMatrices(light, shadowCasterBounds, lightFrame, light->shadowMap()->projection(), projectionMatrix, 20, 20, nearMin, farMax);
             debugAssert(notNull(light->shadowMap()->depthTexture()));
-            Surface::cull(lightFrame, light->shadowMap()->projection(), light->shadowMap()->rect2DBounds(), allSurfaces, lightVisible, false);
-
-            // Cull objects that don't cast shadows
-            for (int i = 0; i < lightVisible.size(); ++i) {
-                if (! lightVisible[i]->castsShadows()) {
-                    // Changing order is OK because we sort below
-                    lightVisible.fastRemove(i);
-                    --i;
-                }
-            }
 
-            Surface::sortFrontToBack(lightVisible, lightFrame.lookVector());
+            shadowLight.append(light);
+            lightProjectionMatrix.append(projectionMatrix);
 
-            CullFace renderCullFace = (cullFace == CullFace::CURRENT) ? light->shadowCullFace() : cullFace;
-            Color3 transmissionWeight = light->bulbPower() / max(light->bulbPower().sum(), 1e-6f);
+            // Cull objects not visible to the light and objects that don't cast shadows
+            lightView.append(SurfaceBoundsCache::View(lightFrame, light->shadowMap()->projection(), light->shadowMap()->rect2DBounds(), true));
+        }
+    }
 
-            if (light->shadowMap()->useVarianceShadowMap()) {
-                light->shadowMap()->updateDepth(rd, lightFrame, lightProjectionMatrix, lightVisible, renderCullFace, transmissionWeight, RenderPassType::OPAQUE_SHADOW_MAP);
-                light->shadowMap()->updateDepth(rd, lightFrame, lightProjectionMatrix, lightVisible, renderCullFace, transmissionWeight, RenderPassType::TRANSPARENT_SHADOW_MAP);
-            } else {
-                light->shadowMap()->updateDepth(rd, lightFrame, lightProjectionMatrix, lightVisible, renderCullFace, transmissionWeight, RenderPassType::SHADOW_MAP);
-            }
+    Array< Array<shared_ptr<Surface> > > lightVisibleArray;
+    surfaceBounds.cull(lightView, lightVisibleArray);
 
-            lightVisible.fastClear();
-            ++s;
+    // Generate shadow maps
+    for (int s = 0; s < shadowLight.size(); ++s) {
+        const shared_ptr<Light>& light = shadowLight[s];
+        const CFrame& lightFrame = lightView[s].frame;
+        Array<shared_ptr<Surface> >& lightVisible = lightVisibleArray[s];
+
+        Surface::sortFrontToBack(lightVisible, lightFrame.lookVector());
+
+        CullFace renderCullFace = (cullFace == CullFace::CURRENT) ? light->shadowCullFace() : cullFace;
+        Color3 transmissionWeight = light->bulbPower() / max(light->bulbPower().sum(), 1e-6f);
+
+        if (light->shadowMap()->useVarianceShadowMap()) {
+            light->shadowMap()->updateDepth(rd, lightFrame, lightProjectionMatrix[s], lightVisible, renderCullFace, transmissionWeight, RenderPassType::OPAQUE_SHADOW_MAP);
+            light->shadowMap()->updateDepth(rd, lightFrame, lightProjectionMatrix[s], lightVisible, renderCullFace, transmissionWeight, RenderPassType::TRANSPARENT_SHADOW_MAP);
+        } else {
+            light->shadowMap()->updateDepth(rd, lightFrame, lightProjectionMatrix[s], lightVisible, renderCullFace, transmissionWeight, RenderPassType::SHADOW_MAP);
         }
     }
 
@@ -0,0 +1,1033 @@
+/**
+  \file GLG3D.lib/source/MeshSimplifier.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+
+  G3D Innovation Engine
+  Copyright 2000-2026, Morgan McGuire.
+  All rights reserved.
+*/
+#include "GLG3D/MeshSimplifier.h"
+#include "GLG3D/CPUVertexArray.h"
+#include "G3D/AABox.h"
+#include "G3D/System.h"
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+namespace G3D {
+
+MeshSimplifier::Settings::Settings(const Any& any) {
+    *this = Settings();
+    if (any.type() == Any::NUMBER) {
+        targetRatio = any;
+    } else {
+        AnyTableReader r(any);
+        r.getIfPresent("targetRatio",    targetRatio);
+        r.getIfPresent("maxError",       maxError);
+        r.getIfPresent("normalWeight",   normalWeight);
+        r.getIfPresent("boneWeight",     boneWeight);
+        r.getIfPresent("boundaryWeight", boundaryWeight);
+        r.getIfPresent("clusterSize",    clusterSize);
+        r.verifyDone();
+    }
+    any.verify((targetRatio >= 0.0f) && (targetRatio <= 1.0f), "targetRatio must be on [0, 1]");
+    any.verify(clusterSize > 0, "clusterSize must be positive");
+}
+
+
+Any MeshSimplifier::Settings::toAny() const {
+    Any a(Any::TABLE, "MeshSimplifier::Settings");
+    a["targetRatio"]    = targetRatio;
+    a["maxError"]       = maxError;
+    a["normalWeight"]   = normalWeight;
+    a["boneWeight"]     = boneWeight;
+    a["boundaryWeight"] = boundaryWeight;
+    a["clusterSize"]    = clusterSize;
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/** Sum of squared distances to weighted planes, as a symmetric 4x4 matrix. Double precision
+    because the matrices of nearly coplanar faces nearly cancel. */
+class Quadric {
+public:
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+    /** Total area of the faces whose planes were added, used to normalize the error */
+    double area;
+
+    Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), area(0) {}
+
+    /** The plane n.p + d = 0, weighted by w. \a n must have unit length. */
+    Quadric(const Vector3& n, double d, double w, double faceArea) : area(faceArea) {
+        const double a = n.x, b = n.y, c = n.z;
+        a2 = w * a * a; ab = w * a * b; ac = w * a * c; ad = w * a * d;
+        b2 = w * b * b; bc = w * b * c; bd = w * b * d;
+        c2 = w * c * c; cd = w * c * d;
+        d2 = w * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        area += q.area;
+        return *this;
+    }
+
+    Quadric& operator-=(const Quadric& q) {
+        a2 -= q.a2; ab -= q.ab; ac -= q.ac; ad -= q.ad;
+        b2 -= q.b2; bc -= q.bc; bd -= q.bd;
+        c2 -= q.c2; cd -= q.cd;
+        d2 -= q.d2;
+        area -= q.area;
+        return *this;
+    }
+
+    double operator()(const Vector3& p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+            2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+    }
+};
+
+
+/** Area-weighted plane quadric of a triangle */
+static Quadric faceQuadric(const Vector3& v0, const Vector3& v1, const Vector3& v2) {
+    const Vector3& n = (v1 - v0).cross(v2 - v0);
+    const float length = n.length();
+    if (length <= 0.0f) {
+        return Quadric();
+    }
+    const Vector3& unit = n / length;
+    const double area = 0.5 * length;
+    return Quadric(unit, -unit.dot(v0), area, area);
+}
+
+
+/** A candidate half-edge collapse of position p0 onto position p1 */
+class Collapse {
+public:
+    float   cost;
+    int     p0;
+    int     p1;
+    int     version;
+
+    /** std::priority_queue is a max heap; order by increasing cost, with ties broken
+        by index so that the result does not depend on the heap implementation */
+    bool operator<(const Collapse& other) const {
+        return (cost > other.cost) || ((cost == other.cost) && (p0 > other.p0));
+    }
+};
+
+
+/** Owner of a position that appears in more than one cluster */
+static const int SHARED = -2;
+
+
+/** State shared by all clusters of one MeshSimplifier::simplify() call */
+class SimplifyContext {
+public:
+    const CPUVertexArray&               vertexArray;
+    const MeshSimplifier::Settings&     settings;
+
+    /** Square of Settings::maxError */
+    double                              maxCost;
+
+    /** Smallest index of a vertex with the same position, for each vertex */
+    Array<int>                          positionID;
+
+    /** Indexed by positionID */
+    Array<bool>                         positionLocked;
+
+    /** Indexed by positionID */
+    Array<Quadric>                      quadric;
+
+    /** Vertex indices of the current triangles */
+    Array<int>                          corner;
+
+    Array<bool>                         alive;
+
+    /** Cluster that owns each position in the current pass, or SHARED. Indexed by positionID. */
+    std::unique_ptr<std::atomic<int>[]> owner;
+
+    SimplifyContext(const CPUVertexArray& v, const MeshSimplifier::Settings& s) : vertexArray(v), settings(s) {
+        maxCost = square(double(settings.maxError));
+    }
+};
+
+
+/** Quadric additions to positions shared with other clusters, applied after the parallel pass */
+class ClusterResult {
+public:
+    int                 numRemoved;
+    double              maxCost;
+    Array<int>          sharedPosition;
+    Array<Quadric>      sharedQuadric;
+    ClusterResult() : numRemoved(0), maxCost(0) {}
+};
+
+
+/** A self-contained copy of the triangles of one cluster, simplified independently of the
+    others. Positions that also appear in other clusters are locked. */
+class ClusterMesh {
+public:
+    SimplifyContext&    context;
+
+    // Per local position
+    Array<int>          positionRep;
+    Array<Vector3>      point;
+    Array<Quadric>      quadric;
+    /** Boundary and seam planes. Rebuilt every pass, so not written back to the context. */
+    Array<Quadric>      constraint;
+    /** First corner in the singly linked list of corners at each position, -1 if none */
+    Array<int>          head;
+    Array<int>          version;
+    Array<bool>         locked;
+    Array<bool>         shared;
+    Array<bool>         removed;
+    Array<bool>         received;
+    Array<int>          mark;
+    Array<int>          slot;
+    Array<int>          mark2;
+    int                 currentMark;
+    int                 currentMark2;
+    /** Value of mark at the positions adjacent to the position being evaluated */
+    int                 ringMark;
+
+    /** Vertex index of each local wedge */
+    Array<int>          wedgeVertex;
+
+    // Per corner
+    Array<int>          cornerPosition;
+    Array<int>          cornerWedge;
+    Array<int>          next;
+
+    // Per triangle
+    Array<int>          triangle;
+    Array<bool>         alive;
+    int                 numAlive;
+
+    // Scratch
+    Array<int>          corner0;
+    Array<int>          corner1;
+    Array<int>          ring;
+    Array<int>          ringCount;
+    Array<int>          pairWedge0;
+    Array<int>          pairWedge1;
+    Array<int>          neighbor;
+
+    std::priority_queue<Collapse> heap;
+
+    /** Cost of the best collapse of each position when the cluster was built */
+    Array<float>        initialCost;
+
+    ClusterMesh(SimplifyContext& c) : context(c), currentMark(0), currentMark2(0), ringMark(0), numAlive(0) {}
+
+    /** Replaces out with the corners of live triangles at p, unlinking those of dead triangles */
+    void liveCorners(int p, Array<int>& out) {
+        out.fastClear();
+        int prev = -1;
+        for (int c = head[p]; c != -1; c = next[c]) {
+            if (alive[c / 3]) {
+                out.append(c);
+                prev = c;
+            } else if (prev == -1) {
+                head[p] = next[c];
+            } else {
+                next[prev] = next[c];
+            }
+        }
+    }
+
+    /** Returns the corner of triangle t at position p, or -1 */
+    int findCorner(int t, int p) const {
+        for (int k = 3 * t; k < 3 * t + 3; ++k) {
+            if (cornerPosition[k] == p) {
+                return k;
+            }
+        }
+        return -1;
+    }
+
+    /** Copies the triangles and finds the cheapest collapse of every position */
+    void build(const int* globalTriangle, int numTriangles);
+
+    void addConstraints();
+
+    /** Fills pairWedge0 and pairWedge1 with the wedge of p1 that each wedge of p0 moves onto.
+        Requires corner0 = liveCorners(p0). Returns false if a wedge has no unique partner. */
+    bool findPartners(int p0, int p1);
+
+    /** Requires corner0 and the ring marks of p0 from evaluate() */
+    bool linkConditionHolds(int p0, int p1, int numEdgeTriangles);
+
+    /** True if the collapse would fold a triangle over or turn it into a sliver. Requires corner0. */
+    bool createsBadTriangle(int p0, int p1) const;
+
+    /** Normalized quadric error of moving p0 to p1 */
+    double geometricCost(int p0, int p1) const;
+
+    /** Cost of the attribute changes of the collapse. Requires pairWedge0 and pairWedge1. Never negative. */
+    double attributeCost(int p0, int p1) const;
+
+    /** Computes the cheapest legal collapse of p0. Returns false if there is none. */
+    bool evaluate(int p0, Collapse& best);
+
+    void collapse(int p0, int p1);
+
+    /** Collapses until at most \a target triangles remain or the next collapse costs more than \a maxCost */
+    void simplify(int target, double maxCost, ClusterResult& result);
+
+    void writeBack(ClusterResult& result);
+};
+
+
+void ClusterMesh::build(const int* globalTriangle, int numTriangles) {
+    const Array<int>& positionID = context.positionID;
+    const int numCorners = 3 * numTriangles;
+
+    triangle.resize(numTriangles);
+    alive.resize(numTriangles);
+    cornerPosition.resize(numCorners);
+    cornerWedge.resize(numCorners);
+    next.resize(numCorners);
+
+    for (int t = 0; t < numTriangles; ++t) {
+        triangle[t] = globalTriangle[t];
+        for (int k = 0; k < 3; ++k) {
+            const int v = context.corner[3 * globalTriangle[t] + k];
+            cornerWedge[3 * t + k] = v;
+            cornerPosition[3 * t + k] = positionID[v];
+        }
+    }
+
+    // Renumber positions and wedges densely
+    positionRep = cornerPosition;
+    std::sort(positionRep.begin(), positionRep.end());
+    positionRep.resize(int(std::unique(positionRep.begin(), positionRep.end()) - positionRep.begin()));
+    wedgeVertex = cornerWedge;
+    std::sort(wedgeVertex.begin(), wedgeVertex.end());
+    wedgeVertex.resize(int(std::unique(wedgeVertex.begin(), wedgeVertex.end()) - wedgeVertex.begin()));
+    for (int c = 0; c < numCorners; ++c) {
+        cornerPosition[c] = int(std::lower_bound(positionRep.begin(), positionRep.end(), cornerPosition[c]) - positionRep.begin());
+        cornerWedge[c] = int(std::lower_bound(wedgeVertex.begin(), wedgeVertex.end(), cornerWedge[c]) - wedgeVertex.begin());
+    }
+
+    const int numPositions = positionRep.size();
+    point.resize(numPositions);
+    quadric.resize(numPositions);
+    constraint.resize(numPositions);
+    head.resize(numPositions);
+    version.resize(numPositions);
+    locked.resize(numPositions);
+    shared.resize(numPositions);
+    removed.resize(numPositions);
+    received.resize(numPositions);
+    mark.resize(numPositions);
+    slot.resize(numPositions);
+    mark2.resize(numPositions);
+    for (int p = 0; p < numPositions; ++p) {
+        const int rep   = positionRep[p];
+        point[p]        = context.vertexArray.vertex[rep].position;
+        quadric[p]      = context.quadric[rep];
+        constraint[p]   = Quadric();
+        head[p]         = -1;
+        version[p]      = 0;
+        shared[p]       = (context.owner[rep].load(std::memory_order_relaxed) == SHARED);
+        locked[p]       = shared[p] || context.positionLocked[rep];
+        removed[p]      = false;
+        received[p]     = false;
+        mark[p]         = 0;
+        mark2[p]        = 0;
+    }
+
+    // Triangles with a repeated position have no area and are dropped
+    numAlive = 0;
+    for (int t = 0; t < numTriangles; ++t) {
+        const int* p = cornerPosition.getCArray() + 3 * t;
+        alive[t] = (p[0] != p[1]) && (p[1] != p[2]) && (p[2] != p[0]);
+        numAlive += alive[t] ? 1 : 0;
+    }
+
+    // Link corners in order
+    for (int c = numCorners - 1; c >= 0; --c) {
+        const int p = cornerPosition[c];
+        next[c] = head[p];
+        head[p] = c;
+    }
+
+    addConstraints();
+
+    Collapse c;
+    for (int p = 0; p < numPositions; ++p) {
+        if (evaluate(p, c)) {
+            c.version = version[p];
+            heap.push(c);
+            initialCost.append(c.cost);
+        }
+    }
+}
+
+
+void ClusterMesh::addConstraints() {
+    const float boundaryWeight = context.settings.boundaryWeight;
+    if (boundaryWeight <= 0.0f) {
+        return;
+    }
+
+    for (int t = 0; t < triangle.size(); ++t) {
+        if (! alive[t]) {
+            continue;
+        }
+
+        const Vector3& faceNormal = (point[cornerPosition[3 * t + 1]] - point[cornerPosition[3 * t]]).cross(
+            point[cornerPosition[3 * t + 2]] - point[cornerPosition[3 * t]]).directionOrZero();
+
+        for (int k = 0; k < 3; ++k) {
+            const int ca = 3 * t + k;
+            const int cb = 3 * t + (k + 1) % 3;
+            const int a  = cornerPosition[ca];
+            const int b  = cornerPosition[cb];
+            if (locked[a] && locked[b]) {
+                continue;
+            }
+
+            // The edge needs a constraint if no other triangle shares it, or if one that does
+            // has different wedges at either end
+            bool constrain = true;
+            for (int c = head[a]; c != -1; c = next[c]) {
+                const int u = c / 3;
+                if ((u == t) || ! alive[u]) {
+                    continue;
+                }
+                const int d = findCorner(u, b);
+                if (d != -1) {
+                    if ((cornerWedge[c] != cornerWedge[ca]) || (cornerWedge[d] != cornerWedge[cb])) {
+                        constrain = true;
+                        break;
+                    }
+                    constrain = false;
+                }
+            }
+
+            if (constrain) {
+                const Vector3& edge = point[b] - point[a];
+                const Vector3& n = edge.cross(faceNormal).directionOrZero();
+                const Quadric q(n, -n.dot(point[a]), boundaryWeight * edge.squaredLength(), 0.0);
+                constraint[a] += q;
+                constraint[b] += q;
+            }
+        }
+    }
+}
+
+
+bool ClusterMesh::findPartners(int p0, int p1) {
+    pairWedge0.fastClear();
+    pairWedge1.fastClear();
+
+    for (int i = 0; i < corner0.size(); ++i) {
+        const int c  = corner0[i];
+        const int c1 = findCorner(c / 3, p1);
+        if (c1 == -1) {
+            continue;
+        }
+        const int w0 = cornerWedge[c];
+        const int w1 = cornerWedge[c1];
+        const int j  = pairWedge0.findIndex(w0);
+        if (j == -1) {
+            if (pairWedge1.contains(w1)) {
+                // Two wedges would merge, erasing a seam
+                return false;
+            }
+            pairWedge0.append(w0);
+            pairWedge1.append(w1);
+        } else if (pairWedge1[j] != w1) {
+            // A wedge would split
+            return false;
+        }
+    }
+
+    // Every wedge must have a partner
+    for (int i = 0; i < corner0.size(); ++i) {
+        if (! pairWedge0.contains(cornerWedge[corner0[i]])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool ClusterMesh::linkConditionHolds(int p0, int p1, int numEdgeTriangles) {
+    // The positions adjacent to both ends must be exactly the apexes of the edge's triangles,
+    // or the collapse would create a non-manifold edge
+    ++currentMark2;
+    int numCommon = 0;
+    liveCorners(p1, corner1);
+    for (int i = 0; i < corner1.size(); ++i) {
+        const int base = 3 * (corner1[i] / 3);
+        for (int k = base; k < base + 3; ++k) {
+            const int q = cornerPosition[k];
+            if ((q != p0) && (q != p1) && (mark[q] == ringMark) && (mark2[q] != currentMark2)) {
+                mark2[q] = currentMark2;
+                ++numCommon;
+            }
+        }
+    }
+
+    if (shared[p1]) {
+        // An edge from p1 to another shared position may exist only in the triangles of other
+        // clusters, so it cannot be seen here. Assume that it does.
+        for (int i = 0; i < ring.size(); ++i) {
+            const int q = ring[i];
+            if ((q != p1) && shared[q] && (mark2[q] != currentMark2)) {
+                return false;
+            }
+        }
+    }
+
+    return numCommon == numEdgeTriangles;
+}
+
+
+/** 1 for an equilateral triangle, 0 for a degenerate one. \a n is the cross product of two edges. */
+static float triangleQuality(const Vector3& n, const Vector3& v0, const Vector3& v1, const Vector3& v2) {
+    const float d = (v1 - v0).squaredLength() + (v2 - v1).squaredLength() + (v0 - v2).squaredLength();
+    return (d > 0.0f) ? 2.0f * sqrtf(3.0f) * n.length() / d : 0.0f;
+}
+
+
+bool ClusterMesh::createsBadTriangle(int p0, int p1) const {
+    const Vector3& P1 = point[p1];
+    for (int i = 0; i < corner0.size(); ++i) {
+        const int c    = corner0[i];
+        const int base = 3 * (c / 3);
+        if (findCorner(c / 3, p1) != -1) {
+            // Removed by the collapse
+            continue;
+        }
+        const Vector3& v0 = point[p0];
+        const Vector3& v1 = point[cornerPosition[base + (c - base + 1) % 3]];
+        const Vector3& v2 = point[cornerPosition[base + (c - base + 2) % 3]];
+        const Vector3& before = (v1 - v0).cross(v2 - v0);
+        const Vector3& after  = (v1 - P1).cross(v2 - P1);
+        if (before.dot(after) <= 0.2f * before.length() * after.length()) {
+            // Folded over, or turned so sharply that it is nearly folded
+            return true;
+        }
+
+        const float quality = triangleQuality(after, P1, v1, v2);
+        if ((quality < 0.05f) && (quality < triangleQuality(before, v0, v1, v2))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/** Fraction of bone influence that differs between two vertices, on [0, 1] */
+static float boneDifference(const Vector4int32& ia, const Vector4& wa, const Vector4int32& ib, const Vector4& wb) {
+    float d = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        float other = 0.0f;
+        for (int j = 0; j < 4; ++j) {
+            if (ib[j] == ia[i]) {
+                other = wb[j];
+                break;
+            }
+        }
+        d += fabsf(wa[i] - other);
+    }
+    for (int j = 0; j < 4; ++j) {
+        bool found = false;
+        for (int i = 0; (i < 4) && ! found; ++i) {
+            found = (ia[i] == ib[j]);
+        }
+        if (! found) {
+            d += wb[j];
+        }
+    }
+    return 0.5f * d;
+}
+
+
+double ClusterMesh::geometricCost(int p0, int p1) const {
+    const Vector3& P1 = point[p1];
+    const double area = quadric[p0].area + quadric[p1].area;
+    const double q = quadric[p0](P1) + quadric[p1](P1) + constraint[p0](P1) + constraint[p1](P1);
+    return max((area > 0.0) ? q / area : q, 0.0);
+}
+
+
+double ClusterMesh::attributeCost(int p0, int p1) const {
+    // Attribute changes cost in proportion to the distance over which they are smeared
+    const CPUVertexArray& vertexArray = context.vertexArray;
+    const MeshSimplifier::Settings& settings = context.settings;
+    float normalTerm = 0.0f;
+    float boneTerm   = 0.0f;
+    for (int i = 0; i < pairWedge0.size(); ++i) {
+        const int v0 = wedgeVertex[pairWedge0[i]];
+        const int v1 = wedgeVertex[pairWedge1[i]];
+        const float n = (vertexArray.vertex[v0].normal - vertexArray.vertex[v1].normal).squaredLength() * 0.25f;
+        if (n > normalTerm) {
+            normalTerm = n;
+        }
+        if (vertexArray.hasBones) {
+            boneTerm = max(boneTerm, boneDifference(vertexArray.boneIndices[v0], vertexArray.boneWeights[v0],
+                                                    vertexArray.boneIndices[v1], vertexArray.boneWeights[v1]));
+        }
+    }
+    return double((point[p0] - point[p1]).squaredLength()) * max(settings.normalWeight * normalTerm + settings.boneWeight * boneTerm, 0.0f);
+}
+
+
+bool ClusterMesh::evaluate(int p0, Collapse& best) {
+    if (locked[p0] || removed[p0]) {
+        return false;
+    }
+
+    liveCorners(p0, corner0);
+
+    // Mark the ring of p0 and count the triangles on each edge
+    ringMark = ++currentMark;
+    ring.fastClear();
+    ringCount.fastClear();
+    for (int i = 0; i < corner0.size(); ++i) {
+        const int c = corner0[i];
+        const int base = 3 * (c / 3);
+        for (int k = 1; k < 3; ++k) {
+            const int q = cornerPosition[base + (c - base + k) % 3];
+            if (mark[q] != ringMark) {
+                mark[q] = ringMark;
+                slot[q] = ring.size();
+                ring.append(q);
+                ringCount.append(0);
+            }
+            ++ringCount[slot[q]];
+        }
+    }
+
+    bool border = false;
+    for (int i = 0; i < ringCount.size(); ++i) {
+        if (ringCount[i] > 2) {
+            // Non-manifold
+            return false;
+        }
+        border = border || (ringCount[i] == 1);
+    }
+
+    best.cost = finf();
+    for (int i = 0; i < ring.size(); ++i) {
+        const int p1 = ring[i];
+
+        // A boundary vertex may only slide along the boundary
+        if (border && (ringCount[i] != 1)) {
+            continue;
+        }
+
+        // Test legality, which is the expensive part, only for candidates that would be the best
+        const double g = geometricCost(p0, p1);
+        if ((g >= best.cost) || ! findPartners(p0, p1)) {
+            continue;
+        }
+
+        const float c = float(g + attributeCost(p0, p1));
+        if ((c >= best.cost) || ! linkConditionHolds(p0, p1, ringCount[i]) || createsBadTriangle(p0, p1)) {
+            continue;
+        }
+
+        best.cost = c;
+        best.p0   = p0;
+        best.p1   = p1;
+    }
+
+    return best.cost < finf();
+}
+
+
+void ClusterMesh::collapse(int p0, int p1) {
+    liveCorners(p0, corner0);
+    const bool ok = findPartners(p0, p1);
+    (void)ok;
+    debugAssert(ok);
+
+    const int tail = corner0.last();
+    for (int i = 0; i < corner0.size(); ++i) {
+        const int c = corner0[i];
+        const int t = c / 3;
+        if (findCorner(t, p1) != -1) {
+            alive[t] = false;
+            --numAlive;
+        } else {
+            cornerPosition[c] = p1;
+            cornerWedge[c] = pairWedge1[pairWedge0.findIndex(cornerWedge[c])];
+        }
+    }
+
+    // Move the corners of p0 to p1; those of the removed triangles are unlinked lazily
+    next[tail] = head[p1];
+    head[p1]   = head[p0];
+    head[p0]   = -1;
+
+    quadric[p1]    += quadric[p0];
+    constraint[p1] += constraint[p0];
+    removed[p0]     = true;
+    received[p1]    = true;
+}
+
+
+void ClusterMesh::simplify(int target, double maxCost, ClusterResult& result) {
+    Collapse c;
+    while ((numAlive > target) && ! heap.empty()) {
+        const Collapse top = heap.top();
+        heap.pop();
+        const int p0 = top.p0;
+        if (removed[p0] || (top.version != version[p0])) {
+            continue;
+        }
+
+        // The neighbourhood of the target may have changed since this was computed
+        if (! evaluate(p0, c)) {
+            ++version[p0];
+            continue;
+        }
+        if (c.cost > top.cost) {
+            c.version = ++version[p0];
+            heap.push(c);
+            continue;
+        }
+        if (c.cost > maxCost) {
+            break;
+        }
+
+        const int p1 = c.p1;
+        collapse(p0, p1);
+        result.maxCost = max(result.maxCost, double(c.cost));
+
+        // Re-evaluate the neighbourhood of the merged vertex
+        liveCorners(p1, corner1);
+        ++currentMark;
+        neighbor.fastClear();
+        neighbor.append(p1);
+        mark[p1] = currentMark;
+        for (int i = 0; i < corner1.size(); ++i) {
+            const int base = 3 * (corner1[i] / 3);
+            for (int k = base; k < base + 3; ++k) {
+                const int q = cornerPosition[k];
+                if (mark[q] != currentMark) {
+                    mark[q] = currentMark;
+                    neighbor.append(q);
+                }
+            }
+        }
+        for (int i = 0; i < neighbor.size(); ++i) {
+            const int q = neighbor[i];
+            ++version[q];
+            if (evaluate(q, c)) {
+                c.version = version[q];
+                heap.push(c);
+            }
+        }
+    }
+}
+
+
+void ClusterMesh::writeBack(ClusterResult& result) {
+    for (int t = 0; t < triangle.size(); ++t) {
+        const int g = triangle[t];
+        if (! alive[t]) {
+            context.alive[g] = false;
+            ++result.numRemoved;
+        } else {
+            for (int k = 0; k < 3; ++k) {
+                context.corner[3 * g + k] = wedgeVertex[cornerWedge[3 * t + k]];
+            }
+        }
+    }
+
+    for (int p = 0; p < positionRep.size(); ++p) {
+        const int rep = positionRep[p];
+        if (! shared[p]) {
+            context.quadric[rep] = quadric[p];
+        } else if (received[p]) {
+            // Other clusters may also add to this position
+            Quadric delta = quadric[p];
+            delta -= context.quadric[rep];
+            result.sharedPosition.append(rep);
+            result.sharedQuadric.append(delta);
+        }
+    }
+}
+
+
+/** Sets positionID[v] to the smallest index of a vertex with exactly the same position as v */
+static void weldPositions(const CPUVertexArray& vertexArray, Array<int>& positionID) {
+    const int N = vertexArray.size();
+    const CPUVertexArray::Vertex* vertex = vertexArray.vertex.getCArray();
+
+    Array<int> order;
+    order.resize(N);
+    for (int v = 0; v < N; ++v) {
+        order[v] = v;
+    }
+    tbb::parallel_sort(order.begin(), order.end(), [vertex](int a, int b) {
+        const Point3& A = vertex[a].position;
+        const Point3& B = vertex[b].position;
+        if (A.x != B.x) { return A.x < B.x; }
+        if (A.y != B.y) { return A.y < B.y; }
+        if (A.z != B.z) { return A.z < B.z; }
+        return a < b;
+    });
+
+    positionID.resize(N);
+    for (int i = 0; i < N; ++i) {
+        const int v = order[i];
+        positionID[v] = ((i > 0) && (vertex[order[i - 1]].position == vertex[v].position)) ? positionID[order[i - 1]] : v;
+    }
+}
+
+
+/** Spreads the low 10 bits of x to every third bit */
+static uint32 spreadBits(uint32 x) {
+    x &= 0x3FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8))  & 0x0300F00F;
+    x = (x | (x << 4))  & 0x030C30C3;
+    x = (x | (x << 2))  & 0x09249249;
+    return x;
+}
+
+
+/** Triangle indices sorted along a Morton curve through their centroids, so that runs of the
+    result are spatially compact clusters */
+static void mortonOrder(const CPUVertexArray& vertexArray, const Array<int>& indexArray, Array<int>& order) {
+    const int numTriangles = indexArray.size() / 3;
+    const CPUVertexArray::Vertex* vertex = vertexArray.vertex.getCArray();
+
+    AABox bounds = AABox::empty();
+    for (int i = 0; i < indexArray.size(); ++i) {
+        bounds.merge(vertex[indexArray[i]].position);
+    }
+    const Vector3& extent = bounds.extent();
+    const Vector3 scale(
+        (extent.x > 0.0f) ? 1023.0f / extent.x : 0.0f,
+        (extent.y > 0.0f) ? 1023.0f / extent.y : 0.0f,
+        (extent.z > 0.0f) ? 1023.0f / extent.z : 0.0f);
+
+    Array<uint64> key;
+    key.resize(numTriangles);
+    tbb::parallel_for(tbb::blocked_range<int>(0, numTriangles, 4096), [&](const tbb::blocked_range<int>& r) {
+        for (int t = r.begin(); t < r.end(); ++t) {
+            const Vector3& centroid = (vertex[indexArray[3 * t]].position + vertex[indexArray[3 * t + 1]].position +
+                                       vertex[indexArray[3 * t + 2]].position) / 3.0f;
+            const Vector3& c = (centroid - bounds.low()) * scale;
+            const uint32 code = spreadBits(uint32(iClamp(iFloor(c.x), 0, 1023))) |
+                (spreadBits(uint32(iClamp(iFloor(c.y), 0, 1023))) << 1) |
+                (spreadBits(uint32(iClamp(iFloor(c.z), 0, 1023))) << 2);
+            key[t] = (uint64(code) << 32) | uint64(t);
+        }
+    });
+    tbb::parallel_sort(key.begin(), key.end());
+
+    order.resize(numTriangles);
+    for (int t = 0; t < numTriangles; ++t) {
+        order[t] = int(key[t] & 0xFFFFFFFF);
+    }
+}
+
+} // namespace
+
+
+float MeshSimplifier::simplify
+   (const CPUVertexArray&   vertexArray,
+    const Array<int>&       indexArray,
+    Array<int>&             result,
+    const Settings&         settings,
+    const Array<bool>&      lockedVertex) {
+
+    debugAssertM(indexArray.size() % 3 == 0, "Index array must contain triangles");
+    debugAssertM(&result != &indexArray, "The result may not alias the input");
+    debugAssertM((lockedVertex.size() == 0) || (lockedVertex.size() == vertexArray.size()), "Wrong number of locked vertex flags");
+
+    const int numTriangles = indexArray.size() / 3;
+    const int target = iClamp(iRound(numTriangles * settings.targetRatio), 0, numTriangles);
+    if (target >= numTriangles) {
+        result = indexArray;
+        return 0.0f;
+    }
+
+    const int numVertices = vertexArray.size();
+    const CPUVertexArray::Vertex* vertex = vertexArray.vertex.getCArray();
+
+    SimplifyContext context(vertexArray, settings);
+    weldPositions(vertexArray, context.positionID);
+
+    context.positionLocked.resize(numVertices);
+    for (int v = 0; v < numVertices; ++v) {
+        context.positionLocked[v] = false;
+    }
+    if (lockedVertex.size() == numVertices) {
+        for (int v = 0; v < numVertices; ++v) {
+            if (lockedVertex[v]) {
+                context.positionLocked[context.positionID[v]] = true;
+            }
+        }
+    }
+
+    context.corner = indexArray;
+    context.alive.resize(numTriangles);
+    for (int t = 0; t < numTriangles; ++t) {
+        context.alive[t] = true;
+    }
+
+    // Accumulate the planes of the original triangles at each position
+    context.quadric.resize(numVertices);
+    for (int t = 0; t < numTriangles; ++t) {
+        const int* v = indexArray.getCArray() + 3 * t;
+        const Quadric& q = faceQuadric(vertex[v[0]].position, vertex[v[1]].position, vertex[v[2]].position);
+        for (int k = 0; k < 3; ++k) {
+            context.quadric[context.positionID[v[k]]] += q;
+        }
+    }
+
+    context.owner.reset(new std::atomic<int>[numVertices]);
+
+    Array<int> order;
+    mortonOrder(vertexArray, indexArray, order);
+
+    int     numAlive = numTriangles;
+    double  maxCost  = 0.0;
+    Array<int> aliveOrder;
+    Array<int> clusterStart;
+    Array<ClusterResult> clusterResult;
+    std::vector<std::unique_ptr<ClusterMesh>> clusterMesh;
+    Array<float> initialCost;
+
+    // Alternate passes offset the clusters by half a cluster, so that the positions locked on
+    // cluster borders in one pass are interior in the next. Clusters grow when locked borders
+    // limit progress. The pass with a single cluster runs to completion, and is the only pass
+    // on a single core, where the cluster borders would only add work.
+    int64 clusterSize = (System::numCores() > 1) ? max(settings.clusterSize, 64) : numTriangles;
+    for (int pass = 0; numAlive > target; ++pass) {
+        aliveOrder.fastClear();
+        for (int i = 0; i < order.size(); ++i) {
+            if (context.alive[order[i]]) {
+                aliveOrder.append(order[i]);
+            }
+        }
+
+        const int   size   = int(min(clusterSize, int64(aliveOrder.size())));
+        const int   offset = (pass % 2 == 1) ? size / 2 : 0;
+        clusterStart.fastClear();
+        clusterStart.append(0);
+        for (int s = (offset > 0) ? offset : size; s < aliveOrder.size(); s += size) {
+            clusterStart.append(s);
+        }
+        clusterStart.append(aliveOrder.size());
+        const int numClusters = clusterStart.size() - 1;
+
+        // Find the positions that appear in more than one cluster
+        tbb::parallel_for(tbb::blocked_range<int>(0, numVertices, 4096), [&](const tbb::blocked_range<int>& r) {
+            for (int v = r.begin(); v < r.end(); ++v) {
+                context.owner[v].store(-1, std::memory_order_relaxed);
+            }
+        });
+        tbb::parallel_for(tbb::blocked_range<int>(0, numClusters, 1), [&](const tbb::blocked_range<int>& r) {
+            for (int cluster = r.begin(); cluster < r.end(); ++cluster) {
+                for (int i = clusterStart[cluster]; i < clusterStart[cluster + 1]; ++i) {
+                    const int t = aliveOrder[i];
+                    for (int k = 0; k < 3; ++k) {
+                        std::atomic<int>& o = context.owner[context.positionID[context.corner[3 * t + k]]];
+                        int expected = -1;
+                        if (! o.compare_exchange_strong(expected, cluster, std::memory_order_relaxed) && (expected != cluster)) {
+                            o.store(SHARED, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            }
+        });
+
+        clusterMesh.resize(numClusters);
+        tbb::parallel_for(tbb::blocked_range<int>(0, numClusters, 1), [&](const tbb::blocked_range<int>& r) {
+            for (int cluster = r.begin(); cluster < r.end(); ++cluster) {
+                clusterMesh[cluster].reset(new ClusterMesh(context));
+                clusterMesh[cluster]->build(aliveOrder.getCArray() + clusterStart[cluster], clusterStart[cluster + 1] - clusterStart[cluster]);
+            }
+        });
+
+        // Each collapse removes about two triangles. Clusters stop at the cost of the collapse
+        // that would be needed if the cheapest initial collapses of all clusters were taken,
+        // so that flat clusters simplify further than curved ones, approximating the order
+        // of a serial simplification.
+        const int64 excess = numAlive - target;
+        double passMaxCost = context.maxCost;
+        if (numClusters > 1) {
+            initialCost.fastClear();
+            for (int cluster = 0; cluster < numClusters; ++cluster) {
+                initialCost.append(clusterMesh[cluster]->initialCost);
+            }
+            if (initialCost.size() > 0) {
+                const int k = int(min(int64(initialCost.size() / 4), (excess + 1) / 2));
+                std::nth_element(initialCost.begin(), initialCost.begin() + k, initialCost.end());
+                passMaxCost = min(passMaxCost, double(initialCost[k]));
+            }
+        }
+
+        // No cluster removes more than its share of the excess, so that ties at the cost
+        // threshold cannot overshoot the target
+        const int aliveAtStart = numAlive;
+        clusterResult.fastClear();
+        clusterResult.resize(numClusters);
+        tbb::parallel_for(tbb::blocked_range<int>(0, numClusters, 1), [&](const tbb::blocked_range<int>& r) {
+            for (int cluster = r.begin(); cluster < r.end(); ++cluster) {
+                ClusterMesh& mesh = *clusterMesh[cluster];
+                const int n = mesh.triangle.size();
+                const int toRemove = int((excess * n + aliveAtStart - 1) / aliveAtStart);
+                mesh.simplify(n - toRemove, passMaxCost, clusterResult[cluster]);
+                mesh.writeBack(clusterResult[cluster]);
+                clusterMesh[cluster].reset();
+            }
+        });
+
+        int numRemoved = 0;
+        for (int cluster = 0; cluster < numClusters; ++cluster) {
+            const ClusterResult& r = clusterResult[cluster];
+            numRemoved += r.numRemoved;
+            maxCost = max(maxCost, r.maxCost);
+            for (int i = 0; i < r.sharedPosition.size(); ++i) {
+                context.quadric[r.sharedPosition[i]] += r.sharedQuadric[i];
+            }
+        }
+        numAlive -= numRemoved;
+
+        if (numClusters == 1) {
+            break;
+        } else if (numRemoved < excess / 16) {
+            clusterSize *= 4;
+        }
+    }
+
+    result.fastClear();
+    result.reserve(3 * numAlive);
+    for (int t = 0; t < numTriangles; ++t) {
+        if (context.alive[t]) {
+            result.append(context.corner[3 * t], context.corner[3 * t + 1], context.corner[3 * t + 2]);
+        }
+    }
+
+    return float(sqrt(maxCost));
+}
+
+} // namespace G3D
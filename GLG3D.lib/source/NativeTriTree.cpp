@@ -54,6 +54,8 @@ void NativeTriTree::intersectBox
 
 
 void NativeTriTree::rebuild() {
+    updateMaterialIndex();
+
     if (m_root) {
         m_root->destroy(m_memoryManager);
         m_memoryManager->free(m_root);
@@ -0,0 +1,381 @@
+/**
+  \file GLG3D.lib/source/OcclusionCuller.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+*/
+#include "GLG3D/OcclusionCuller.h"
+#include "GLG3D/CPUVertexArray.h"
+#include "GLG3D/Tri.h"
+#include "GLG3D/Surface.h"
+#include "G3D/Box.h"
+#include "G3D/AABox.h"
+#include <immintrin.h>
+
+namespace G3D {
+
+/** Triangles per task when transforming and setting up */
+static const int TRIANGLES_PER_SETUP_TASK = 1024;
+
+/** occluded() descends the hierarchy until the box covers at most this many texels per side */
+static const int MAX_TEST_TEXELS = 4;
+
+
+OcclusionCuller::OcclusionCuller(const Settings& settings) : m_settings(settings), m_nearW(0.0f) {
+    m_width  = iCeil(float(max(settings.width, 1))  / TILE_WIDTH)  * TILE_WIDTH;
+    m_height = iCeil(float(max(settings.height, 1)) / TILE_HEIGHT) * TILE_HEIGHT;
+    m_tilesX = m_width  / TILE_WIDTH;
+    m_tilesY = m_height / TILE_HEIGHT;
+    m_tileBin.resize(m_tilesX * m_tilesY);
+
+    // Allocate the hierarchy
+    int w = m_width, h = m_height;
+    while (true) {
+        m_levelWidth.append(w);
+        m_levelHeight.append(h);
+        m_level.next().resize(w * h);
+        if ((w == 1) && (h == 1)) {
+            break;
+        }
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    clear();
+}
+
+
+shared_ptr<OcclusionCuller> OcclusionCuller::create(const Settings& settings) {
+    return createShared<OcclusionCuller>(settings);
+}
+
+
+void OcclusionCuller::setView(const CFrame& cameraFrame, const Projection& projection, const Rect2D& viewport) {
+    m_cameraFrame = cameraFrame;
+    m_projection  = projection;
+    m_viewport    = viewport;
+    m_nearW       = -projection.nearPlaneZ();
+
+    // Map the viewport onto the whole depth buffer. The unit projection already has y
+    // increasing downward, so row 0 is the top.
+    Matrix4 P;
+    projection.getProjectUnitMatrix(viewport, P);
+    const float sx = m_width  / 2.0f;
+    const float sy = m_height / 2.0f;
+    m_worldToPixel = Matrix4(sx,  0, 0, sx,
+                              0, sy, 0, sy,
+                              0,   0, 1,  0,
+                              0,   0, 0,  1) * P * cameraFrame.inverse().toMatrix4();
+
+    m_numTested   = 0;
+    m_numOccluded = 0;
+    clear();
+}
+
+
+void OcclusionCuller::clear() {
+    for (int L = 0; L < m_level.size(); ++L) {
+        System::memset(m_level[L].getCArray(), 0, sizeof(float) * m_level[L].size());
+    }
+}
+
+
+bool OcclusionCuller::setupScreenTri(const Vector4& a, const Vector4& b, const Vector4& c, ScreenTri& tri) const {
+    Vector3 v[3] = {Vector3(a.x / a.w, a.y / a.w, 1.0f / a.w),
+                    Vector3(b.x / b.w, b.y / b.w, 1.0f / b.w),
+                    Vector3(c.x / c.w, c.y / c.w, 1.0f / c.w)};
+
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    if (! (fabsf(area) > 1e-8f)) {
+        // Degenerate, or not finite
+        return false;
+    }
+    if (area < 0.0f) {
+        // Draw both windings
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+
+    // Pixel centers are at half-integers
+    const float minX = min(v[0].x, v[1].x, v[2].x), maxX = max(v[0].x, v[1].x, v[2].x);
+    const float minY = min(v[0].y, v[1].y, v[2].y), maxY = max(v[0].y, v[1].y, v[2].y);
+    tri.x0 = int(ceilf(clamp(minX - 0.5f, 0.0f, float(m_width))));
+    tri.x1 = int(floorf(clamp(maxX - 0.5f, -1.0f, float(m_width - 1))));
+    tri.y0 = int(ceilf(clamp(minY - 0.5f, 0.0f, float(m_height))));
+    tri.y1 = int(floorf(clamp(maxY - 0.5f, -1.0f, float(m_height - 1))));
+    if ((tri.x0 > tri.x1) || (tri.y0 > tri.y1)) {
+        return false;
+    }
+
+    // edge[i] is the edge opposite vertex i, scaled to be that vertex's barycentric weight times area
+    for (int i = 0; i < 3; ++i) {
+        const Vector3& p = v[(i + 1) % 3];
+        const Vector3& q = v[(i + 2) % 3];
+        tri.edge[i] = Vector3(p.y - q.y, q.x - p.x, (q.y - p.y) * p.x - (q.x - p.x) * p.y);
+    }
+
+    tri.invW = (tri.edge[0] * v[0].z + tri.edge[1] * v[1].z + tri.edge[2] * v[2].z) / area;
+    return true;
+}
+
+
+int OcclusionCuller::setupTriangle(const Vector4& a, const Vector4& b, const Vector4& c, ScreenTri* out) const {
+    const Vector4* in[3] = {&a, &b, &c};
+
+    // Clip against the near plane (w >= m_nearW)
+    Vector4 poly[4];
+    int n = 0;
+    for (int i = 0; i < 3; ++i) {
+        const Vector4& p = *in[i];
+        const Vector4& q = *in[(i + 1) % 3];
+        const bool pInside = (p.w >= m_nearW);
+        const bool qInside = (q.w >= m_nearW);
+        if (pInside) {
+            poly[n++] = p;
+        }
+        if (pInside != qInside) {
+            const float t = (m_nearW - p.w) / (q.w - p.w);
+            poly[n++] = p + (q - p) * t;
+        }
+    }
+
+    int count = 0;
+    for (int i = 2; i < n; ++i) {
+        if (setupScreenTri(poly[0], poly[i - 1], poly[i], out[count])) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+
+void OcclusionCuller::rasterizeTile(int tx, int ty) {
+    const Array<int>& bin = m_tileBin[tx + ty * m_tilesX];
+    if (bin.size() == 0) {
+        return;
+    }
+
+    const int tileX0 = tx * TILE_WIDTH,  tileX1 = tileX0 + TILE_WIDTH  - 1;
+    const int tileY0 = ty * TILE_HEIGHT, tileY1 = tileY0 + TILE_HEIGHT - 1;
+    float* depth = m_level[0].getCArray();
+    const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int b = 0; b < bin.size(); ++b) {
+        const ScreenTri& tri = m_screenTri[bin[b]];
+
+        // Start on a multiple of four pixels. The extra pixels fail the edge tests.
+        const int x0 = max(tri.x0, tileX0) & ~3;
+        const int x1 = min(tri.x1, tileX1);
+        const int y0 = max(tri.y0, tileY0);
+        const int y1 = min(tri.y1, tileY1);
+
+        const __m128 e0x = _mm_set1_ps(tri.edge[0].x), e1x = _mm_set1_ps(tri.edge[1].x), e2x = _mm_set1_ps(tri.edge[2].x);
+        const __m128 zx  = _mm_set1_ps(tri.invW.x);
+
+        for (int y = y0; y <= y1; ++y) {
+            const float fy = y + 0.5f;
+            const __m128 e0y = _mm_set1_ps(tri.edge[0].y * fy + tri.edge[0].z);
+            const __m128 e1y = _mm_set1_ps(tri.edge[1].y * fy + tri.edge[1].z);
+            const __m128 e2y = _mm_set1_ps(tri.edge[2].y * fy + tri.edge[2].z);
+            const __m128 zy  = _mm_set1_ps(tri.invW.y * fy + tri.invW.z);
+            float* row = depth + y * m_width;
+
+            for (int x = x0; x <= x1; x += 4) {
+                const __m128 fx = _mm_add_ps(_mm_set1_ps(float(x)), laneOffset);
+                const __m128 inside = _mm_and_ps(_mm_and_ps(
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e0x, fx), e0y), zero),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e1x, fx), e1y), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e2x, fx), e2y), zero));
+
+                if (_mm_movemask_ps(inside) != 0) {
+                    const __m128 old = _mm_loadu_ps(row + x);
+                    const __m128 z   = _mm_max_ps(old, _mm_add_ps(_mm_mul_ps(zx, fx), zy));
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, old)));
+                }
+            }
+        }
+    }
+}
+
+
+void OcclusionCuller::buildHierarchy() {
+    for (int L = 1; L < m_level.size(); ++L) {
+        const float* src = m_level[L - 1].getCArray();
+        float*       dst = m_level[L].getCArray();
+        const int srcW = m_levelWidth[L - 1], srcH = m_levelHeight[L - 1];
+        const int w = m_levelWidth[L], h = m_levelHeight[L];
+        for (int y = 0; y < h; ++y) {
+            const int sy0 = 2 * y, sy1 = min(2 * y + 1, srcH - 1);
+            for (int x = 0; x < w; ++x) {
+                const int sx0 = 2 * x, sx1 = min(2 * x + 1, srcW - 1);
+                dst[x + y * w] = min(min(src[sx0 + sy0 * srcW], src[sx1 + sy0 * srcW]),
+                                     min(src[sx0 + sy1 * srcW], src[sx1 + sy1 * srcW]));
+            }
+        }
+    }
+}
+
+
+void OcclusionCuller::rasterizeClipSpace(const int* index, int numTriangles) {
+    m_screenTri.resize(2 * numTriangles, DONT_SHRINK_UNDERLYING_ARRAY);
+    m_screenTriValid.resize(2 * numTriangles, DONT_SHRINK_UNDERLYING_ARRAY);
+
+    const Vector4* clip = m_clipVertex.getCArray();
+    tbb::parallel_for(tbb::blocked_range<int>(0, numTriangles, TRIANGLES_PER_SETUP_TASK), [&](const tbb::blocked_range<int>& r) {
+        for (int t = r.begin(); t < r.end(); ++t) {
+            const int n = setupTriangle(clip[index[3 * t]], clip[index[3 * t + 1]], clip[index[3 * t + 2]], &m_screenTri[2 * t]);
+            m_screenTriValid[2 * t]     = (n > 0);
+            m_screenTriValid[2 * t + 1] = (n > 1);
+        }
+    });
+
+    // Bin by tile, preserving submission order within each tile
+    for (int i = 0; i < m_tileBin.size(); ++i) {
+        m_tileBin[i].fastClear();
+    }
+    for (int i = 0; i < m_screenTri.size(); ++i) {
+        if (m_screenTriValid[i]) {
+            const ScreenTri& tri = m_screenTri[i];
+            for (int ty = tri.y0 / TILE_HEIGHT; ty <= tri.y1 / TILE_HEIGHT; ++ty) {
+                for (int tx = tri.x0 / TILE_WIDTH; tx <= tri.x1 / TILE_WIDTH; ++tx) {
+                    m_tileBin[tx + ty * m_tilesX].append(i);
+                }
+            }
+        }
+    }
+
+    // Each tile owns its pixels, so tiles can be rasterized concurrently without synchronization
+    tbb::parallel_for(tbb::blocked_range<int>(0, m_tilesX * m_tilesY, 1), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            rasterizeTile(i % m_tilesX, i / m_tilesX);
+        }
+    });
+
+    buildHierarchy();
+}
+
+
+void OcclusionCuller::rasterize(const Array<Point3>& vertex, const Array<int>& index) {
+    debugAssertM(index.size() % 3 == 0, "Index array must contain whole triangles");
+    m_clipVertex.resize(vertex.size(), DONT_SHRINK_UNDERLYING_ARRAY);
+    tbb::parallel_for(tbb::blocked_range<int>(0, vertex.size(), TRIANGLES_PER_SETUP_TASK), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            m_clipVertex[i] = m_worldToPixel * Vector4(vertex[i], 1.0f);
+        }
+    });
+    rasterizeClipSpace(index.getCArray(), index.size() / 3);
+}
+
+
+void OcclusionCuller::rasterize(const CPUVertexArray& vertexArray, const Array<Tri>& triArray) {
+    m_clipVertex.resize(vertexArray.size(), DONT_SHRINK_UNDERLYING_ARRAY);
+    tbb::parallel_for(tbb::blocked_range<int>(0, vertexArray.size(), TRIANGLES_PER_SETUP_TASK), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            m_clipVertex[i] = m_worldToPixel * Vector4(vertexArray.vertex[i].position, 1.0f);
+        }
+    });
+
+    Array<int> index;
+    index.resize(3 * triArray.size());
+    for (int t = 0; t < triArray.size(); ++t) {
+        for (int v = 0; v < 3; ++v) {
+            index[3 * t + v] = int(triArray[t].index[v]);
+        }
+    }
+    rasterizeClipSpace(index.getCArray(), triArray.size());
+}
+
+
+void OcclusionCuller::rasterize(const Array<shared_ptr<Surface> >& occluderArray) {
+    CPUVertexArray vertexArray;
+    Array<Tri> triArray;
+    Surface::getTris(occluderArray, vertexArray, triArray);
+    rasterize(vertexArray, triArray);
+}
+
+
+bool OcclusionCuller::occluded(const Point3& center, const Vector3 halfAxis[3]) const {
+    m_numTested.increment();
+
+    // Bounds of the projected corners
+    float minX = finf(), minY = finf(), maxX = -finf(), maxY = -finf(), maxInvW = 0.0f;
+    for (int c = 0; c < 8; ++c) {
+        const Point3& corner = center +
+            ((c & 1) ? halfAxis[0] : -halfAxis[0]) +
+            ((c & 2) ? halfAxis[1] : -halfAxis[1]) +
+            ((c & 4) ? halfAxis[2] : -halfAxis[2]);
+        const Vector4& p = m_worldToPixel * Vector4(corner, 1.0f);
+        if (! (p.w >= m_nearW)) {
+            // Crosses the near plane
+            return false;
+        }
+        const float invW = 1.0f / p.w;
+        minX = min(minX, p.x * invW);
+        maxX = max(maxX, p.x * invW);
+        minY = min(minY, p.y * invW);
+        maxY = max(maxY, p.y * invW);
+        maxInvW = max(maxInvW, invW);
+    }
+
+    if ((maxX < 0.0f) || (maxY < 0.0f) || (minX >= m_width) || (minY >= m_height)) {
+        // Off screen, which is frustum culling's responsibility
+        return false;
+    }
+
+    const int x0 = iClamp(int(floorf(minX)), 0, m_width - 1),  x1 = iClamp(int(floorf(maxX)), 0, m_width - 1);
+    const int y0 = iClamp(int(floorf(minY)), 0, m_height - 1), y1 = iClamp(int(floorf(maxY)), 0, m_height - 1);
+
+    // Find the finest level at which the box covers only a few texels
+    int L = 0;
+    while ((L + 1 < m_level.size()) && (((x1 >> L) - (x0 >> L) >= MAX_TEST_TEXELS) || ((y1 >> L) - (y0 >> L) >= MAX_TEST_TEXELS))) {
+        ++L;
+    }
+
+    const float* level = m_level[L].getCArray();
+    const int w = m_levelWidth[L];
+    for (int y = y0 >> L; y <= (y1 >> L); ++y) {
+        for (int x = x0 >> L; x <= (x1 >> L); ++x) {
+            if (level[x + y * w] <= maxInvW) {
+                // Some occluder point in this region is not in front of the box
+                return false;
+            }
+        }
+    }
+
+    m_numOccluded.increment();
+    return true;
+}
+
+
+bool OcclusionCuller::occluded(const Box& box) const {
+    if (! box.isFinite()) {
+        return false;
+    }
+    Vector3 halfAxis[3];
+    for (int a = 0; a < 3; ++a) {
+        halfAxis[a] = box.axis(a) * (box.extent(a) * 0.5f);
+    }
+    return occluded(box.center(), halfAxis);
+}
+
+
+bool OcclusionCuller::occluded(const AABox& box) const {
+    if (! box.isFinite() || box.isEmpty()) {
+        return false;
+    }
+    const Vector3& halfExtent = box.extent() * 0.5f;
+    const Vector3 halfAxis[3] = {Vector3(halfExtent.x, 0, 0), Vector3(0, halfExtent.y, 0), Vector3(0, 0, halfExtent.z)};
+    return occluded(box.center(), halfAxis);
+}
+
+
+float OcclusionCuller::depth(int x, int y, int level) const {
+    debugAssert((level >= 0) && (level < m_level.size()));
+    const float invW = m_level[level][x + y * m_levelWidth[level]];
+    return (invW > 0.0f) ? 1.0f / invW : finf();
+}
+
+} // namespace G3D
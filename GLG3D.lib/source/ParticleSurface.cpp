@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2015-08-30
-  \edited  2015-09-22
+  \edited  2026-10-18
  
  G3D Library http://g3d.cs.williams.edu
  Copyright 2000-2017, Morgan McGuire morgan@casual-effects.com
@@ -16,6 +16,8 @@
 #include "GLG3D/ParticleSurface.h"
 #include "GLG3D/RenderDevice.h"
 #include "GLG3D/Shader.h"
+#include "G3D/Thread.h"
+#include "G3D/radixSort.h"
 
 namespace G3D {
 
@@ -30,46 +32,98 @@ void ParticleSurface::getObjectSpaceBoundingSphere(Sphere& sphere, bool previous
     sphere = m_objectSpaceSphereBounds;
 }
 
+/** Particles per task for the parallel depth sort and index upload */
+static const int PARTICLES_PER_SORT_TASK = 16 * 1024;
+
+/** Precision of the quantized depth keys. Sorting takes one pass per eight bits. */
+static const int SORT_KEY_BITS           = 24;
+
+
 void ParticleSurface::sortAndUploadIndices(shared_ptr<ParticleSurface> particleSurface, const Vector3& csz) {
-    ParticleSystem::s_sortArray.fastClear();
-    
     const shared_ptr<ParticleSystem::Block>& block = particleSurface->m_block;
     const shared_ptr<ParticleSystem>& particleSystem = block->particleSystem.lock();
-
-    for (int i = 0; i < particleSystem->m_particle.size(); ++i) {
-        const ParticleSystem::Particle& particle = particleSystem->m_particle[i];
+    const ParticleSystem::Particle* particle = particleSystem->m_particle.getCArray();
+    const int n = particleSystem->m_particle.size();
+    const int numTasks = max(1, (n + PARTICLES_PER_SORT_TASK - 1) / PARTICLES_PER_SORT_TASK);
+
+    // Express the depth axis in the particles' reference frame, so that depth is
+    // a single dot product. The translation does not affect the order.
+    Vector3 axis = csz;
+    if (! particleSystem->particlesAreInWorldSpace()) {
         CFrame cframe;
         particleSurface->getCoordinateFrame(cframe);
-        const Point3& wsPosition = particleSystem->particlesAreInWorldSpace() ?
-            particle.position :
-            cframe.pointToWorldSpace(particle.position);
-        const float particleCSZ = dot(wsPosition, csz);
-
-        ParticleSystem::SortProxy proxy;
-        proxy.index = block->startIndex + i;
-        proxy.z = particleCSZ;
-        ParticleSystem::s_sortArray.append(proxy);
+        axis = cframe.vectorToObjectSpace(csz);
+    }
+
+    static Array<float> depth;
+    static Array<float> taskMinDepth, taskMaxDepth;
+    depth.resize(n, false);
+    taskMinDepth.resize(numTasks, false);
+    taskMaxDepth.resize(numTasks, false);
+
+    Thread::runConcurrently(0, numTasks, [&](int t) {
+        float lo = finf(), hi = -finf();
+        const int end = min(n, (t + 1) * PARTICLES_PER_SORT_TASK);
+        for (int i = t * PARTICLES_PER_SORT_TASK; i < end; ++i) {
+            const float z = dot(particle[i].position, axis);
+            depth[i] = z;
+            lo = min(lo, z);
+            hi = max(hi, z);
+        }
+        taskMinDepth[t] = lo;
+        taskMaxDepth[t] = hi;
+    });
+
+    float minDepth = finf(), maxDepth = -finf();
+    for (int t = 0; t < numTasks; ++t) {
+        minDepth = min(minDepth, taskMinDepth[t]);
+        maxDepth = max(maxDepth, taskMaxDepth[t]);
     }
-    ParticleSystem::s_sortArray.sort(SORT_DECREASING);
+
+    // Quantize so that the farthest particle has key 0, giving back-to-front order
+    // from an increasing sort
+    const uint32 maxKey = (1U << SORT_KEY_BITS) - 1;
+    const float  scale  = (maxDepth > minDepth) ? float(maxKey) / (maxDepth - minDepth) : 0.0f;
+
+    Array<ParticleSystem::SortProxy>& sortArray = ParticleSystem::s_sortArray;
+    sortArray.resize(n, false);
+    ParticleSystem::s_sortScratchArray.resize(n, false);
+
+    Thread::runConcurrently(0, numTasks, [&](int t) {
+        const int end = min(n, (t + 1) * PARTICLES_PER_SORT_TASK);
+        for (int i = t * PARTICLES_PER_SORT_TASK; i < end; ++i) {
+            ParticleSystem::SortProxy& proxy = sortArray[i];
+            proxy.key   = min(maxKey, uint32((maxDepth - depth[i]) * scale));
+            proxy.index = block->startIndex + i;
+        }
+    });
+
+    const ParticleSystem::SortProxy* sorted =
+        radixSortByKey(sortArray.getCArray(), ParticleSystem::s_sortScratchArray.getCArray(), n, SORT_KEY_BITS, PARTICLES_PER_SORT_TASK);
+
     ParticleSystem::ParticleBuffer& pBuffer = ParticleSystem::s_particleBuffer;
     bool needsReallocation = true;
     if (pBuffer.indexStream.valid() &&
-        (pBuffer.indexStream.maxSize() >= size_t(ParticleSystem::s_sortArray.size()))) {
+        (pBuffer.indexStream.maxSize() >= sizeof(int) * size_t(n))) {
         needsReallocation = false;
     }
 
     if (needsReallocation) {
-        const int numToAllocate = ParticleSystem::s_sortArray.size() * 2;
+        const int numToAllocate = n * 2;
         const shared_ptr<VertexBuffer>& vb = VertexBuffer::create(sizeof(int) * numToAllocate + 8);
         int ignored;
         pBuffer.indexStream = IndexStream(ignored, numToAllocate, vb);
     }
-    static Array<int> sortedIndices;
-    sortedIndices.fastClear();
-    for (const ParticleSystem::SortProxy& p : ParticleSystem::s_sortArray) {
-        sortedIndices.append(p.index);
-    }
-    pBuffer.indexStream.update(sortedIndices);
+
+    // Write the sorted indices directly into the GPU buffer
+    int* indexPtr = (int*)pBuffer.indexStream.mapBufferForWrite(n);
+    Thread::runConcurrently(0, numTasks, [&](int t) {
+        const int end = min(n, (t + 1) * PARTICLES_PER_SORT_TASK);
+        for (int i = t * PARTICLES_PER_SORT_TASK; i < end; ++i) {
+            indexPtr[i] = sorted[i].index;
+        }
+    });
+    pBuffer.indexStream.unmapBuffer();
 }
 
 
@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2015-08-30
-  \edited  2016-02-14
+  \edited  2026-10-18
  
  G3D Library http://g3d.cs.williams.edu
  Copyright 2000-2017, Morgan McGuire morgan@casual-effects.com
@@ -18,6 +18,8 @@
 #include "GLG3D/Scene.h"
 #include "G3D/Vector4uint16.h"
 #include "GLG3D/ParticleSystemModel.h"
+#include "G3D/Thread.h"
+#include <immintrin.h>
 
 namespace G3D {
 
@@ -270,6 +272,7 @@ void ParticleMaterial::freeAllUnusedMaterials() {
 
 ParticleSystem::ParticleBuffer ParticleSystem::s_particleBuffer;
 Array<ParticleSystem::SortProxy> ParticleSystem::s_sortArray;
+Array<ParticleSystem::SortProxy> ParticleSystem::s_sortScratchArray;
 bool ParticleSystem::s_preferLowResolutionTransparency = true;
 
 ParticleSystem::ParticleSystem() : m_particlesChangedSinceBounds(true), 
@@ -327,42 +330,255 @@ void ParticleSystem::updateBounds() {
 }
 
 
+/** Structure-of-arrays copy of the simulated fields of a run of consecutive
+    Particles, so that the integrator can advance SIMD-width groups of particles
+    at once. Only the fields that the integrator reads or writes are transposed. */
+class PhysicsChunk {
+public:
+    /** Particles per chunk. A multiple of the widest SIMD width, and small
+        enough that a chunk stays in L1 cache between the transpose and the integration. */
+    enum { SIZE = 256 };
+
+    float       positionX[SIZE];
+    float       positionY[SIZE];
+    float       positionZ[SIZE];
+
+    float       velocityX[SIZE];
+    float       velocityY[SIZE];
+    float       velocityZ[SIZE];
+
+    float       brownianX[SIZE];
+    float       brownianY[SIZE];
+    float       brownianZ[SIZE];
+
+    /** 0.5 * (air density) * dragCoefficient * area / mass, the factor
+        of |relativeVelocity| * relativeVelocity in the acceleration */
+    float       dragScale[SIZE];
+
+    float       angle[SIZE];
+    float       angularVelocity[SIZE];
+};
+
+
+/** Per-frame values shared by all particles of one system */
+class PhysicsConstants {
+public:
+    Vector3     gravitationalAcceleration;
+    Vector3     windVelocity;
+    float       maxBrownianVelocity;
+    float       dt;
+};
+
+
+/** Euler integration of drag, gravity, and brownian motion on
+    \a n particles of \a chunk, one at a time. */
+static void integratePhysicsScalar(PhysicsChunk& chunk, int n, const PhysicsConstants& k) {
+    for (int i = 0; i < n; ++i) {
+        float vx = chunk.velocityX[i];
+        float vy = chunk.velocityY[i];
+        float vz = chunk.velocityZ[i];
+
+        // Velocity relative to the brownian-perturbed wind
+        const float rx = (k.windVelocity.x + k.maxBrownianVelocity * chunk.brownianX[i]) - vx;
+        const float ry = (k.windVelocity.y + k.maxBrownianVelocity * chunk.brownianY[i]) - vy;
+        const float rz = (k.windVelocity.z + k.maxBrownianVelocity * chunk.brownianZ[i]) - vz;
+
+        const float s = chunk.dragScale[i] * sqrt(rx * rx + ry * ry + rz * rz);
+
+        vx += (k.gravitationalAcceleration.x + rx * s) * k.dt;
+        vy += (k.gravitationalAcceleration.y + ry * s) * k.dt;
+        vz += (k.gravitationalAcceleration.z + rz * s) * k.dt;
+
+        chunk.velocityX[i] = vx;
+        chunk.velocityY[i] = vy;
+        chunk.velocityZ[i] = vz;
+
+        chunk.positionX[i] += vx * k.dt;
+        chunk.positionY[i] += vy * k.dt;
+        chunk.positionZ[i] += vz * k.dt;
+        chunk.angle[i]     += chunk.angularVelocity[i] * k.dt;
+    }
+}
+
+
+/** SSE version of integratePhysicsScalar. \a n must be a multiple of 4. */
+static void integratePhysicsSSE(PhysicsChunk& chunk, int n, const PhysicsConstants& k) {
+    const __m128 gx = _mm_set1_ps(k.gravitationalAcceleration.x);
+    const __m128 gy = _mm_set1_ps(k.gravitationalAcceleration.y);
+    const __m128 gz = _mm_set1_ps(k.gravitationalAcceleration.z);
+    const __m128 wx = _mm_set1_ps(k.windVelocity.x);
+    const __m128 wy = _mm_set1_ps(k.windVelocity.y);
+    const __m128 wz = _mm_set1_ps(k.windVelocity.z);
+    const __m128 b  = _mm_set1_ps(k.maxBrownianVelocity);
+    const __m128 dt = _mm_set1_ps(k.dt);
+
+    for (int i = 0; i < n; i += 4) {
+        __m128 vx = _mm_loadu_ps(chunk.velocityX + i);
+        __m128 vy = _mm_loadu_ps(chunk.velocityY + i);
+        __m128 vz = _mm_loadu_ps(chunk.velocityZ + i);
+
+        // Velocity relative to the brownian-perturbed wind
+        const __m128 rx = _mm_sub_ps(_mm_add_ps(wx, _mm_mul_ps(b, _mm_loadu_ps(chunk.brownianX + i))), vx);
+        const __m128 ry = _mm_sub_ps(_mm_add_ps(wy, _mm_mul_ps(b, _mm_loadu_ps(chunk.brownianY + i))), vy);
+        const __m128 rz = _mm_sub_ps(_mm_add_ps(wz, _mm_mul_ps(b, _mm_loadu_ps(chunk.brownianZ + i))), vz);
+
+        const __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)));
+        const __m128 s     = _mm_mul_ps(_mm_loadu_ps(chunk.dragScale + i), speed);
+
+        vx = _mm_add_ps(vx, _mm_mul_ps(_mm_add_ps(gx, _mm_mul_ps(rx, s)), dt));
+        vy = _mm_add_ps(vy, _mm_mul_ps(_mm_add_ps(gy, _mm_mul_ps(ry, s)), dt));
+        vz = _mm_add_ps(vz, _mm_mul_ps(_mm_add_ps(gz, _mm_mul_ps(rz, s)), dt));
+
+        _mm_storeu_ps(chunk.velocityX + i, vx);
+        _mm_storeu_ps(chunk.velocityY + i, vy);
+        _mm_storeu_ps(chunk.velocityZ + i, vz);
+
+        _mm_storeu_ps(chunk.positionX + i, _mm_add_ps(_mm_loadu_ps(chunk.positionX + i), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(chunk.positionY + i, _mm_add_ps(_mm_loadu_ps(chunk.positionY + i), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(chunk.positionZ + i, _mm_add_ps(_mm_loadu_ps(chunk.positionZ + i), _mm_mul_ps(vz, dt)));
+        _mm_storeu_ps(chunk.angle + i, _mm_add_ps(_mm_loadu_ps(chunk.angle + i), _mm_mul_ps(_mm_loadu_ps(chunk.angularVelocity + i), dt)));
+    }
+}
+
+
+/** AVX version of integratePhysicsSSE. \a n must be a multiple of 8. */
+G3D_TARGET_AVX static void integratePhysicsAVX(PhysicsChunk& chunk, int n, const PhysicsConstants& k) {
+    const __m256 gx = _mm256_set1_ps(k.gravitationalAcceleration.x);
+    const __m256 gy = _mm256_set1_ps(k.gravitationalAcceleration.y);
+    const __m256 gz = _mm256_set1_ps(k.gravitationalAcceleration.z);
+    const __m256 wx = _mm256_set1_ps(k.windVelocity.x);
+    const __m256 wy = _mm256_set1_ps(k.windVelocity.y);
+    const __m256 wz = _mm256_set1_ps(k.windVelocity.z);
+    const __m256 b  = _mm256_set1_ps(k.maxBrownianVelocity);
+    const __m256 dt = _mm256_set1_ps(k.dt);
+
+    for (int i = 0; i < n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(chunk.velocityX + i);
+        __m256 vy = _mm256_loadu_ps(chunk.velocityY + i);
+        __m256 vz = _mm256_loadu_ps(chunk.velocityZ + i);
+
+        const __m256 rx = _mm256_sub_ps(_mm256_add_ps(wx, _mm256_mul_ps(b, _mm256_loadu_ps(chunk.brownianX + i))), vx);
+        const __m256 ry = _mm256_sub_ps(_mm256_add_ps(wy, _mm256_mul_ps(b, _mm256_loadu_ps(chunk.brownianY + i))), vy);
+        const __m256 rz = _mm256_sub_ps(_mm256_add_ps(wz, _mm256_mul_ps(b, _mm256_loadu_ps(chunk.brownianZ + i))), vz);
+
+        const __m256 speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, rx), _mm256_mul_ps(ry, ry)), _mm256_mul_ps(rz, rz)));
+        const __m256 s     = _mm256_mul_ps(_mm256_loadu_ps(chunk.dragScale + i), speed);
+
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_add_ps(gx, _mm256_mul_ps(rx, s)), dt));
+        vy = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_add_ps(gy, _mm256_mul_ps(ry, s)), dt));
+        vz = _mm256_add_ps(vz, _mm256_mul_ps(_mm256_add_ps(gz, _mm256_mul_ps(rz, s)), dt));
+
+        _mm256_storeu_ps(chunk.velocityX + i, vx);
+        _mm256_storeu_ps(chunk.velocityY + i, vy);
+        _mm256_storeu_ps(chunk.velocityZ + i, vz);
+
+        _mm256_storeu_ps(chunk.positionX + i, _mm256_add_ps(_mm256_loadu_ps(chunk.positionX + i), _mm256_mul_ps(vx, dt)));
+        _mm256_storeu_ps(chunk.positionY + i, _mm256_add_ps(_mm256_loadu_ps(chunk.positionY + i), _mm256_mul_ps(vy, dt)));
+        _mm256_storeu_ps(chunk.positionZ + i, _mm256_add_ps(_mm256_loadu_ps(chunk.positionZ + i), _mm256_mul_ps(vz, dt)));
+        _mm256_storeu_ps(chunk.angle + i, _mm256_add_ps(_mm256_loadu_ps(chunk.angle + i), _mm256_mul_ps(_mm256_loadu_ps(chunk.angularVelocity + i), dt)));
+    }
+}
+
+
 void ParticleSystem::applyPhysics(float t, float dt) {
     debugAssert(notNull(m_physicsEnvironment));
-    // Convert to the local reference frame
-    const Vector3&  gravitationalAcceleration   = m_particlesAreInWorldSpace ? m_physicsEnvironment->gravitationalAcceleration : m_frame.vectorToObjectSpace(m_physicsEnvironment->gravitationalAcceleration);
-    const Vector3&  windVelocity                = m_particlesAreInWorldSpace ? m_physicsEnvironment->windVelocity : m_frame.vectorToObjectSpace(m_physicsEnvironment->windVelocity);
 
-    // Compensate for the [-2, 2] range below
-    const float     maxBrownianVelocity         = m_physicsEnvironment->maxBrownianVelocity * 0.35f;
-    const int       brownianTemporalOffset      = int(t * (m_physicsEnvironment->windVelocity.length() + 1.f) - 1000.0f); 
+    // Convert to the local reference frame
+    const Vector3& gravitationalAcceleration = m_particlesAreInWorldSpace ? m_physicsEnvironment->gravitationalAcceleration : m_frame.vectorToObjectSpace(m_physicsEnvironment->gravitationalAcceleration);
+    const Vector3& windVelocity              = m_particlesAreInWorldSpace ? m_physicsEnvironment->windVelocity : m_frame.vectorToObjectSpace(m_physicsEnvironment->windVelocity);
 
-    for (int i = 0; i < m_particle.size(); ++i) {
-        Particle& P = m_particle[i];
-        
-        // https://en.wikipedia.org/wiki/Drag_equation
-        const float area = pif() * square(P.radius);
-        
-        // Sample three, different artbitray noise functions
-        const Point3int32& fixedPos = Point3int32(P.position * 200.0f);
-        const Vector3 brownianDirection(Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.y + 10208, fixedPos.z + 55010, 2),
-                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.z + 10208, fixedPos.x + 55010, 2),
-                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.x + 10208, fixedPos.y + 55010, 2));
-        const Vector3& localWindVelocity = windVelocity + maxBrownianVelocity * brownianDirection;
-        const Vector3& relativeVelocity = localWindVelocity - P.velocity;
-        const Vector3& dragForce = relativeVelocity.directionOrZero() * (0.5f * 1.185f * relativeVelocity.squaredMagnitude() * P.dragCoefficient * area);
-        
-        const Vector3& acceleration = gravitationalAcceleration + dragForce / P.mass;
-        
-        P.velocity += acceleration * dt;
-        P.position += P.velocity * dt;
-        P.angle += P.angularVelocity * dt;
-    }
+    integratePhysics(m_particle.getCArray(), m_particle.size(), gravitationalAcceleration, windVelocity, m_physicsEnvironment->maxBrownianVelocity, t, dt);
     
     markChanged();
 }
 
 
+void ParticleSystem::integratePhysics
+   (Particle*       particle,
+    int             numParticles,
+    const Vector3&  gravitationalAcceleration,
+    const Vector3&  windVelocity,
+    float           maxBrownianVelocity,
+    float           t,
+    float           dt,
+    int             maxSIMDWidth) {
+
+    PhysicsConstants k;
+    k.gravitationalAcceleration = gravitationalAcceleration;
+    k.windVelocity              = windVelocity;
+
+    // Compensate for the [-2, 2] range of the noise below
+    k.maxBrownianVelocity       = maxBrownianVelocity * 0.35f;
+    k.dt                        = dt;
+
+    const int brownianTemporalOffset = int(t * (windVelocity.length() + 1.f) - 1000.0f); 
+    Noise&    noise                  = Noise::common();
+    const int simdWidth              = ((maxSIMDWidth >= 8) && System::hasAVX()) ? 8 : (maxSIMDWidth >= 4) ? 4 : 1;
+
+    const int numChunks    = (numParticles + PhysicsChunk::SIZE - 1) / PhysicsChunk::SIZE;
+
+    // Each task transposes its particles into a PhysicsChunk, integrates them
+    // with SIMD, and then transposes them back into the Particle array
+    tbb::parallel_for(tbb::blocked_range<int>(0, numChunks, 1), [&](const tbb::blocked_range<int>& r) {
+        PhysicsChunk chunk;
+        for (int c = r.begin(); c < r.end(); ++c) {
+            Particle*   P = particle + c * PhysicsChunk::SIZE;
+            const int   n = min(int(PhysicsChunk::SIZE), numParticles - c * PhysicsChunk::SIZE);
+
+            for (int i = 0; i < n; ++i) {
+                const Particle& p = P[i];
+                chunk.positionX[i]       = p.position.x;
+                chunk.positionY[i]       = p.position.y;
+                chunk.positionZ[i]       = p.position.z;
+                chunk.velocityX[i]       = p.velocity.x;
+                chunk.velocityY[i]       = p.velocity.y;
+                chunk.velocityZ[i]       = p.velocity.z;
+                chunk.angle[i]           = p.angle;
+                chunk.angularVelocity[i] = p.angularVelocity;
+
+                // https://en.wikipedia.org/wiki/Drag_equation
+                const float area = pif() * square(p.radius);
+                chunk.dragScale[i] = 0.5f * 1.185f * p.dragCoefficient * area / p.mass;
+
+                // Sample three, different arbitrary noise functions
+                const Point3int32& fixedPos = Point3int32(p.position * 200.0f);
+                chunk.brownianX[i] = noise.sampleFloat(brownianTemporalOffset, fixedPos.y + 10208, fixedPos.z + 55010, 2);
+                chunk.brownianY[i] = noise.sampleFloat(brownianTemporalOffset, fixedPos.z + 10208, fixedPos.x + 55010, 2);
+                chunk.brownianZ[i] = noise.sampleFloat(brownianTemporalOffset, fixedPos.x + 10208, fixedPos.y + 55010, 2);
+            }
+
+            // Pad to the SIMD width with motionless particles
+            const int paddedN = (n + 7) & ~7;
+            for (int i = n; i < paddedN; ++i) {
+                chunk.positionX[i] = chunk.positionY[i] = chunk.positionZ[i] = 0.0f;
+                chunk.velocityX[i] = chunk.velocityY[i] = chunk.velocityZ[i] = 0.0f;
+                chunk.brownianX[i] = chunk.brownianY[i] = chunk.brownianZ[i] = 0.0f;
+                chunk.angle[i] = chunk.angularVelocity[i] = chunk.dragScale[i] = 0.0f;
+            }
+
+            if (simdWidth == 8) {
+                integratePhysicsAVX(chunk, paddedN, k);
+            } else if (simdWidth == 4) {
+                integratePhysicsSSE(chunk, paddedN, k);
+            } else {
+                integratePhysicsScalar(chunk, n, k);
+            }
+
+            for (int i = 0; i < n; ++i) {
+                Particle& p = P[i];
+                p.position.x = chunk.positionX[i];
+                p.position.y = chunk.positionY[i];
+                p.position.z = chunk.positionZ[i];
+                p.velocity.x = chunk.velocityX[i];
+                p.velocity.y = chunk.velocityY[i];
+                p.velocity.z = chunk.velocityZ[i];
+                p.angle      = chunk.angle[i];
+            }
+        }
+    });
+}
+
+
 void ParticleSystem::markChanged() {
     m_particlesChangedSinceBounds = true;
     m_particlesChangedSincePose = true;
@@ -518,6 +734,9 @@ Any ParticleSystem::toAny(const bool forceAll) const {
 }
 
 
+/** Particles per task when copying to the GPU in onPose */
+static const int PARTICLES_PER_COPY_TASK = 4096;
+
 void ParticleSystem::onPose(Array<shared_ptr<Surface>>& surfaceArray) {
     if (m_particlesChangedSincePose) {
         updateBounds();
@@ -578,36 +797,43 @@ void ParticleSystem::onPose(Array<shared_ptr<Surface>>& surfaceArray) {
         flags |= ParticleBuffer::RECEIVES_SHADOWS;
     }
 
-    // TODO: Use thread::runConcurrently for these copies
-    if (m_particlesAreInWorldSpace) {
-        for (int p = 0; p < m_particle.size(); ++p) {
-            const Particle& particle = m_particle[p];
-            positionPtr[p] = (const Vector4&)particle.position;
-            normalPtr[p] = particle.normal;
-        } 
-    } else {
-        for (int p = 0; p < m_particle.size(); ++p) {
-            const Particle& particle = m_particle[p];
-            positionPtr[p] = Vector4(m_frame.pointToWorldSpace(particle.position), particle.angle);
-
-            // Transform from object to world space
-            if (particle.normal[3] > 0) {
-                const Vector3& normal = m_frame.normalToWorldSpace(Vector3(particle.normal[0], particle.normal[1], particle.normal[2]) * 2.0f - Vector3(1.0f, 1.0f, 1.0f));
-                for (int i = 0; i < 3; ++i) {
-                    normalPtr[p][i] = uint8(255.0f * (normal[i] * 0.5f + 0.5f));
+    // Copy in parallel batches, each of which writes a contiguous range of every attribute
+    const int numParticles = m_particle.size();
+    const int numBatches   = (numParticles + PARTICLES_PER_COPY_TASK - 1) / PARTICLES_PER_COPY_TASK;
+    Thread::runConcurrently(0, numBatches, [&](int b) {
+        const int start = b * PARTICLES_PER_COPY_TASK;
+        const int end   = min(numParticles, start + PARTICLES_PER_COPY_TASK);
+
+        if (m_particlesAreInWorldSpace) {
+            for (int p = start; p < end; ++p) {
+                const Particle& particle = m_particle[p];
+                positionPtr[p] = (const Vector4&)particle.position;
+                normalPtr[p] = particle.normal;
+            } 
+        } else {
+            for (int p = start; p < end; ++p) {
+                const Particle& particle = m_particle[p];
+                positionPtr[p] = Vector4(m_frame.pointToWorldSpace(particle.position), particle.angle);
+
+                // Transform from object to world space
+                if (particle.normal[3] > 0) {
+                    const Vector3& normal = m_frame.normalToWorldSpace(Vector3(particle.normal[0], particle.normal[1], particle.normal[2]) * 2.0f - Vector3(1.0f, 1.0f, 1.0f));
+                    for (int i = 0; i < 3; ++i) {
+                        normalPtr[p][i] = uint8(255.0f * (normal[i] * 0.5f + 0.5f));
+                    }
+                    normalPtr[p].w = particle.normal.w;
                 }
-                normalPtr[p].w = particle.normal.w;
-            }
-        } 
-    }
+            } 
+        }
 
-    for (int p = 0; p < m_particle.size(); ++p) {
-        const Particle& particle = m_particle[p];
-        shapePtr[p]              = (const Vector3&)particle.radius;
+        for (int p = start; p < end; ++p) {
+            const Particle& particle = m_particle[p];
+            shapePtr[p]              = (const Vector3&)particle.radius;
 
-        const shared_ptr<ParticleMaterial>& material = particle.material;
-        materialPropertiesPtr[p] = Vector4uint16(material->m_textureIndex, material->m_texelWidth, flags, particle.userdataInt);
-    }
+            const shared_ptr<ParticleMaterial>& material = particle.material;
+            materialPropertiesPtr[p] = Vector4uint16(material->m_textureIndex, material->m_texelWidth, flags, particle.userdataInt);
+        }
+    });
 
     // We only mapped the buffer via .position, so unmap the whole thing by the sam variable
     s_particleBuffer.position.unmapBuffer();
@@ -22,6 +22,15 @@
 
 namespace G3D {
 
+const SurfaceBoundsCache& Renderer::surfaceBounds(const Array<shared_ptr<Surface>>& allSurfaces) {
+    // A subclass may pass a different array than the one cached for this frame, e.g., a subset
+    if (! m_surfaceBoundsCurrent || ! m_surfaceBounds.matches(allSurfaces)) {
+        m_surfaceBounds.update(allSurfaces);
+    }
+    return m_surfaceBounds;
+}
+
+
 void Renderer::computeGBuffer
    (RenderDevice*                       rd,
     const Array<shared_ptr<Surface>>&   sortedVisibleSurfaces,
@@ -53,7 +62,7 @@ void Renderer::computeShadowing
     LightingEnvironment&                lightingEnvironment) {
 
     BEGIN_PROFILER_EVENT("Renderer::computeShadowing");
-    Light::renderShadowMaps(rd, lightingEnvironment.lightArray, allSurfaces);
+    Light::renderShadowMaps(rd, lightingEnvironment.lightArray, surfaceBounds(allSurfaces));
 
     if (! gbuffer->colorGuardBandThickness().isZero()) {
         rd->setGuardBandClip2D(gbuffer->colorGuardBandThickness());
@@ -83,7 +92,7 @@ void Renderer::cullAndSort
 
     BEGIN_PROFILER_EVENT("Renderer::cullAndSort");
     const shared_ptr<Camera>& camera = gbuffer->camera();
-    Surface::cull(camera->frame(), camera->projection(), gbuffer->rect2DBounds(), allSurfaces, allVisibleSurfaces);
+    surfaceBounds(allSurfaces).cull(SurfaceBoundsCache::View(camera->frame(), camera->projection(), gbuffer->rect2DBounds()), allVisibleSurfaces);
 
     Surface::sortBackToFront(allVisibleSurfaces, camera->frame().lookVector());
 
@@ -30,9 +30,51 @@ using namespace G3D::units;
 
 namespace G3D {
 
+void Scene::evaluateSplineTracks() {
+    // Find the SplineTracks, recompiling only those that changed or moved in m_entityArray
+    int n = 0;
+    for (int e = 0; e < m_entityArray.size(); ++e) {
+        const shared_ptr<Entity::Track>& track = m_entityArray[e]->track();
+        Entity::SplineTrack* splineTrack = dynamic_cast<Entity::SplineTrack*>(track.get());
+        if (isNull(splineTrack)) {
+            continue;
+        }
+
+        if (n == m_splineTrackArray.size()) {
+            m_splineTrackArray.append(dynamic_pointer_cast<Entity::SplineTrack>(track));
+            m_splineTrackVersion.append(splineTrack->m_version);
+            m_splineBatch.append(splineTrack->m_spline);
+        } else if ((m_splineTrackArray[n].get() != splineTrack) || (m_splineTrackVersion[n] != splineTrack->m_version)) {
+            m_splineTrackArray[n] = dynamic_pointer_cast<Entity::SplineTrack>(track);
+            m_splineTrackVersion[n] = splineTrack->m_version;
+            m_splineBatch.set(n, splineTrack->m_spline);
+        }
+        ++n;
+    }
+
+    if (n < m_splineTrackArray.size()) {
+        // Entities were removed; the batch cannot shrink, so rebuild it
+        m_splineTrackArray.resize(n);
+        m_splineTrackVersion.resize(n);
+        m_splineBatch.clear();
+        for (int i = 0; i < n; ++i) {
+            m_splineBatch.append(m_splineTrackArray[i]->m_spline);
+        }
+    }
+
+    m_splineBatch.evaluate(float(m_time), m_splineFrame);
+    for (int i = 0; i < n; ++i) {
+        Entity::SplineTrack* splineTrack = m_splineTrackArray[i].get();
+        splineTrack->m_batchTime  = m_time;
+        splineTrack->m_batchFrame = m_splineFrame[i];
+    }
+}
+
+
 void Scene::onSimulation(SimTime deltaTime) {
     sortEntitiesByDependency();
     m_time += isNaN(deltaTime) ? 0 : deltaTime;
+    evaluateSplineTracks();
     for (int i = 0; i < m_entityArray.size(); ++i) {
         const shared_ptr<Entity> entity = m_entityArray[i];
         
@@ -192,6 +234,9 @@ void Scene::clear() {
     m_entityTable.clear();
     m_entityArray.fastClear();
     m_cameraArray.fastClear();
+    m_splineTrackArray.fastClear();
+    m_splineTrackVersion.fastClear();
+    m_splineBatch.clear();
     m_localLightingEnvironment = LightingEnvironment();
     m_localLightingEnvironment.ambientOcclusion = old;
     m_skybox.reset();
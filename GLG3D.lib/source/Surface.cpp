@@ -26,6 +26,7 @@
 #include "GLG3D/Shader.h"
 #include "GLG3D/LightingEnvironment.h"
 #include "GLG3D/SVO.h"
+#include "GLG3D/SurfaceBoundsCache.h"
 
 namespace G3D {
 
@@ -230,51 +231,19 @@ void Surface::cull
  Array<shared_ptr<Surface> >& allSurfaces,
  Array<shared_ptr<Surface> >& outSurfaces,
  bool                       previous,
- bool                       inPlace) {
-    if (inPlace) {
-        debugAssert(&allSurfaces != &outSurfaces);
-        outSurfaces.fastClear();
-    }
-    Frustum fr;
-    cameraProjection.frustum(viewport, fr);
-    fr = cameraFrame.toWorldSpace(fr);
-    
-    static Array<Plane> clipPlanes;
-    cameraProjection.getClipPlanes(viewport, clipPlanes);
-    for (int i = 0; i < clipPlanes.size(); ++i) {
-        clipPlanes[i] = cameraFrame.toWorldSpace(clipPlanes[i]);
-    }
-
-    for (int i = 0; i < allSurfaces.size(); ++i) {
-        Sphere sphere;
-        CFrame c;
+ bool                       inPlace,
+ const shared_ptr<OcclusionCuller>& occlusionCuller) {
 
-        // We actually remove this shared_ptr from the array below,
-        // at which point this reference will become invalid. However,
-        // the code doesn't touch the reference again afterwards, so 
-        // that dangling pointer is ok.
-        const shared_ptr<Surface>& m = allSurfaces[i];
-        m->getCoordinateFrame(c, previous);
-        m->getObjectSpaceBoundingSphere(sphere, previous);
-        sphere = c.toWorldSpace(sphere);
-        
-        // Not const because it is reevaluated in the branch immediately below
-        bool culled = sphere.culledBy(clipPlanes);
-        if (!culled) {
-            AABox osBox;
-            m->getObjectSpaceBoundingBox(osBox, previous);
-            Box wsBox = c.toWorldSpace(osBox);
-            culled = wsBox.culledBy(fr);
-        }
+    SurfaceBoundsCache bounds;
+    bounds.update(allSurfaces, previous);
 
-        if (!culled) {
-            if (inPlace) {
-                allSurfaces.fastRemove(i);
-                --i;
-            } else {
-                outSurfaces.append(allSurfaces[i]);
-            }
-        }
+    const SurfaceBoundsCache::View view(cameraFrame, cameraProjection, viewport, false, occlusionCuller);
+    if (inPlace) {
+        debugAssert(&allSurfaces != &outSurfaces);
+        allSurfaces.fastClear();
+        bounds.cull(view, allSurfaces);
+    } else {
+        bounds.cull(view, outSurfaces);
     }
 }
 
@@ -0,0 +1,355 @@
+/**
+  \file GLG3D.lib/source/SurfaceBoundsCache.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+*/
+#include "GLG3D/SurfaceBoundsCache.h"
+#include "GLG3D/Surface.h"
+#include "GLG3D/OcclusionCuller.h"
+#include "G3D/Sphere.h"
+#include "G3D/Box.h"
+#include "G3D/Plane.h"
+#include "G3D/Frustum.h"
+#include "G3D/System.h"
+#include <immintrin.h>
+
+namespace G3D {
+
+/** Surfaces per task in update() and cull(). A multiple of 8. */
+static const int SURFACES_PER_CULL_TASK = 1024;
+
+/** Box half-axis length used for infinite boxes. Large enough that no finite plane culls it,
+    small enough that the projected extent stays finite. */
+static const float INFINITE_EXTENT = 1e30f;
+
+/** World-space clip planes of one view as n.x, n.y, n.z, distance, with a point P
+    outside the plane when dot(n, P) < distance, and the frustum vertices. */
+class ViewPlanes {
+public:
+    enum {MAX_PLANES = 6, MAX_VERTICES = 8};
+
+    float   plane[4 * MAX_PLANES];
+    int     numPlanes;
+
+    /** Frustum vertices. The far vertices of an infinite frustum are directions. */
+    Vector3 vertex[MAX_VERTICES];
+    bool    vertexAtInfinity[MAX_VERTICES];
+    int     numVertices;
+
+    ViewPlanes() : numPlanes(0), numVertices(0) {}
+
+    int size() const {
+        return numPlanes;
+    }
+
+    void set(const SurfaceBoundsCache::View& view) {
+        Frustum frustum;
+        view.projection.frustum(view.viewport, frustum);
+        debugAssert((frustum.faceArray.size() <= MAX_PLANES) && (frustum.vertexPos.size() <= MAX_VERTICES));
+
+        numVertices = min(frustum.vertexPos.size(), int(MAX_VERTICES));
+        for (int v = 0; v < numVertices; ++v) {
+            const Vector4& wsVertex = view.frame.toWorldSpace(frustum.vertexPos[v]);
+            vertexAtInfinity[v] = (wsVertex.w == 0.0f);
+            vertex[v] = vertexAtInfinity[v] ? wsVertex.xyz() : wsVertex.xyz() / wsVertex.w;
+        }
+
+        numPlanes = min(frustum.faceArray.size(), int(MAX_PLANES));
+        for (int p = 0; p < numPlanes; ++p) {
+            const Plane& wsPlane = view.frame.toWorldSpace(frustum.faceArray[p].plane);
+            Vector3 n;
+            float d;
+            wsPlane.getEquation(n, d);
+            plane[4 * p + 0] = n.x;
+            plane[4 * p + 1] = n.y;
+            plane[4 * p + 2] = n.z;
+            plane[4 * p + 3] = -d;
+        }
+    }
+
+    /** True if the whole frustum is outside one face of box \a i, which catches large boxes
+        beside the frustum's edges that no single frustum plane culls. As in Box::culledBy(const Frustum&). */
+    bool outsideBoxFace(const float* const* field, int i) const {
+        const Point3 center(field[4][i], field[5][i], field[6][i]);
+        for (int a = 0; a < 3; ++a) {
+            const Vector3 halfAxis(field[7 + 3 * a][i], field[8 + 3 * a][i], field[9 + 3 * a][i]);
+            if (halfAxis.squaredLength() < 1e-10f) {
+                // Degenerate face
+                continue;
+            }
+
+            for (int side = -1; side <= 1; side += 2) {
+                const Vector3& n = halfAxis * float(side);
+                const float d = n.dot(center + n);
+                bool outside = true;
+                for (int v = 0; (v < numVertices) && outside; ++v) {
+                    outside = vertexAtInfinity[v] ? (n.dot(vertex[v]) > 0.0f) : (n.dot(vertex[v]) >= d);
+                }
+                if (outside) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+
+/** Writes one bit per surface for the 8-surface groups [groupBegin, groupEnd) into \a visible.
+    A bit is 1 if the surface may be visible. */
+static void cullSSE
+   (const float* const*     field,
+    const ViewPlanes&       planes,
+    int                     groupBegin,
+    int                     groupEnd,
+    uint8*                  visible) {
+
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (int g = groupBegin; g < groupEnd; ++g) {
+        int bits = 0;
+        for (int half = 0; half < 2; ++half) {
+            const int i = 8 * g + 4 * half;
+            const __m128 sx = _mm_loadu_ps(field[0] + i), sy = _mm_loadu_ps(field[1] + i), sz = _mm_loadu_ps(field[2] + i), sr = _mm_loadu_ps(field[3] + i);
+            const __m128 bx = _mm_loadu_ps(field[4] + i), by = _mm_loadu_ps(field[5] + i), bz = _mm_loadu_ps(field[6] + i);
+
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < planes.size(); ++p) {
+                const float* P = planes.plane + 4 * p;
+                const __m128 nx = _mm_set1_ps(P[0]), ny = _mm_set1_ps(P[1]), nz = _mm_set1_ps(P[2]), d = _mm_set1_ps(P[3]);
+
+                const __m128 sphereDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, sx), _mm_mul_ps(ny, sy)), _mm_add_ps(_mm_mul_ps(nz, sz), sr));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(sphereDist, d));
+
+                __m128 boxDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, bx), _mm_mul_ps(ny, by)), _mm_mul_ps(nz, bz));
+                for (int a = 0; a < 3; ++a) {
+                    const __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(field[7 + 3 * a] + i)), _mm_mul_ps(ny, _mm_loadu_ps(field[8 + 3 * a] + i))),
+                                                _mm_mul_ps(nz, _mm_loadu_ps(field[9 + 3 * a] + i)));
+                    boxDist = _mm_add_ps(boxDist, _mm_andnot_ps(signMask, e));
+                }
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(boxDist, d));
+            }
+            bits |= (~_mm_movemask_ps(outside) & 0xF) << (4 * half);
+        }
+        visible[g] = uint8(bits);
+    }
+}
+
+
+/** AVX version of cullSSE */
+G3D_TARGET_AVX static void cullAVX
+   (const float* const*     field,
+    const ViewPlanes&       planes,
+    int                     groupBegin,
+    int                     groupEnd,
+    uint8*                  visible) {
+
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    for (int g = groupBegin; g < groupEnd; ++g) {
+        const int i = 8 * g;
+        const __m256 sx = _mm256_loadu_ps(field[0] + i), sy = _mm256_loadu_ps(field[1] + i), sz = _mm256_loadu_ps(field[2] + i), sr = _mm256_loadu_ps(field[3] + i);
+        const __m256 bx = _mm256_loadu_ps(field[4] + i), by = _mm256_loadu_ps(field[5] + i), bz = _mm256_loadu_ps(field[6] + i);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < planes.size(); ++p) {
+            const float* P = planes.plane + 4 * p;
+            const __m256 nx = _mm256_set1_ps(P[0]), ny = _mm256_set1_ps(P[1]), nz = _mm256_set1_ps(P[2]), d = _mm256_set1_ps(P[3]);
+
+            const __m256 sphereDist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, sx), _mm256_mul_ps(ny, sy)), _mm256_add_ps(_mm256_mul_ps(nz, sz), sr));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(sphereDist, d, _CMP_LT_OQ));
+
+            __m256 boxDist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, bx), _mm256_mul_ps(ny, by)), _mm256_mul_ps(nz, bz));
+            for (int a = 0; a < 3; ++a) {
+                const __m256 e = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, _mm256_loadu_ps(field[7 + 3 * a] + i)), _mm256_mul_ps(ny, _mm256_loadu_ps(field[8 + 3 * a] + i))),
+                                               _mm256_mul_ps(nz, _mm256_loadu_ps(field[9 + 3 * a] + i)));
+                boxDist = _mm256_add_ps(boxDist, _mm256_andnot_ps(signMask, e));
+            }
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(boxDist, d, _CMP_LT_OQ));
+        }
+        visible[g] = uint8(~_mm256_movemask_ps(outside) & 0xFF);
+    }
+}
+
+
+void SurfaceBoundsCache::update(const Array<shared_ptr<Surface> >& surfaceArray, bool previous) {
+    m_previous = previous;
+    m_surfaceArray.fastClear();
+    m_surfaceArray.append(surfaceArray);
+
+    const int n = surfaceArray.size();
+    m_paddedSize = (n + 7) & ~7;
+    m_field.resize(NUM_FIELDS * m_paddedSize, DONT_SHRINK_UNDERLYING_ARRAY);
+    m_castsShadows.resize(n, DONT_SHRINK_UNDERLYING_ARRAY);
+    m_finite.resize(n, DONT_SHRINK_UNDERLYING_ARRAY);
+
+    float* f[NUM_FIELDS];
+    for (int k = 0; k < NUM_FIELDS; ++k) {
+        f[k] = field(Field(k));
+        for (int i = n; i < m_paddedSize; ++i) {
+            f[k][i] = 0.0f;
+        }
+    }
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, n, SURFACES_PER_CULL_TASK), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            const shared_ptr<Surface>& surface = m_surfaceArray[i];
+            CFrame c;
+            Sphere sphere;
+            AABox osBox;
+            surface->getCoordinateFrame(c, previous);
+            surface->getObjectSpaceBoundingSphere(sphere, previous);
+            surface->getObjectSpaceBoundingBox(osBox, previous);
+            m_castsShadows[i] = surface->castsShadows();
+
+            sphere = c.toWorldSpace(sphere);
+            if (sphere.radius < finf()) {
+                f[SPHERE_X][i] = sphere.center.x;
+                f[SPHERE_Y][i] = sphere.center.y;
+                f[SPHERE_Z][i] = sphere.center.z;
+                f[SPHERE_RADIUS][i] = sphere.radius;
+            } else {
+                f[SPHERE_X][i] = f[SPHERE_Y][i] = f[SPHERE_Z][i] = 0.0f;
+                f[SPHERE_RADIUS][i] = finf();
+            }
+
+            m_finite[i] = osBox.isFinite() && ! osBox.isEmpty();
+            if (m_finite[i]) {
+                const Point3& center = c.pointToWorldSpace(osBox.center());
+                const Vector3& halfExtent = osBox.extent() * 0.5f;
+                f[BOX_X][i] = center.x;
+                f[BOX_Y][i] = center.y;
+                f[BOX_Z][i] = center.z;
+                for (int a = 0; a < 3; ++a) {
+                    const Vector3& axis = c.rotation.column(a) * halfExtent[a];
+                    f[AXIS0_X + 3 * a][i] = axis.x;
+                    f[AXIS0_Y + 3 * a][i] = axis.y;
+                    f[AXIS0_Z + 3 * a][i] = axis.z;
+                }
+            } else {
+                // The projected extent of this box onto any unit normal is at least INFINITE_EXTENT
+                f[BOX_X][i] = f[BOX_Y][i] = f[BOX_Z][i] = 0.0f;
+                for (int a = 0; a < 3; ++a) {
+                    for (int k = 0; k < 3; ++k) {
+                        f[AXIS0_X + 3 * a + k][i] = (a == k) ? INFINITE_EXTENT : 0.0f;
+                    }
+                }
+            }
+        }
+    });
+}
+
+
+void SurfaceBoundsCache::clear() {
+    m_surfaceArray.fastClear();
+    m_paddedSize = 0;
+}
+
+
+bool SurfaceBoundsCache::matches(const Array<shared_ptr<Surface> >& surfaceArray) const {
+    if (surfaceArray.size() != m_surfaceArray.size()) {
+        return false;
+    }
+    for (int i = 0; i < surfaceArray.size(); ++i) {
+        if (surfaceArray[i] != m_surfaceArray[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void SurfaceBoundsCache::cull(const View& view, Array<shared_ptr<Surface> >& visible) const {
+    Array<View> viewArray;
+    viewArray.append(view);
+    Array< Array<shared_ptr<Surface> > > visibleArray;
+    cull(viewArray, visibleArray);
+    visible.append(visibleArray[0]);
+}
+
+
+void SurfaceBoundsCache::cull(const Array<View>& view, Array< Array<shared_ptr<Surface> > >& visible) const {
+    visible.resize(view.size());
+
+    Array<ViewPlanes> planes;
+    planes.resize(view.size());
+    for (int v = 0; v < view.size(); ++v) {
+        planes[v].set(view[v]);
+    }
+
+    const float* f[NUM_FIELDS];
+    for (int k = 0; k < NUM_FIELDS; ++k) {
+        f[k] = field(Field(k));
+    }
+
+    // One bit per surface per view
+    const int numGroups = m_paddedSize / 8;
+    Array<uint8> visibleBits;
+    visibleBits.resize(numGroups * view.size());
+
+    const bool useAVX = System::hasAVX();
+    const int groupsPerTask = SURFACES_PER_CULL_TASK / 8;
+    tbb::parallel_for(tbb::blocked_range<int>(0, numGroups, groupsPerTask), [&](const tbb::blocked_range<int>& r) {
+        // Each task culls its block of surfaces against every view while the bounds are in cache
+        for (int v = 0; v < view.size(); ++v) {
+            uint8* bits = visibleBits.getCArray() + v * numGroups;
+            if (useAVX) {
+                cullAVX(f, planes[v], r.begin(), r.end(), bits);
+            } else {
+                cullSSE(f, planes[v], r.begin(), r.end(), bits);
+            }
+        }
+    });
+
+    // Gather the visible surfaces for each view in order
+    tbb::parallel_for(0, view.size(), [&](int v) {
+        const uint8* bits = visibleBits.getCArray() + v * numGroups;
+        const bool onlyShadowCasters = view[v].onlyShadowCasters;
+        const OcclusionCuller* occlusionCuller = view[v].occlusionCuller.get();
+        Array<shared_ptr<Surface> >& out = visible[v];
+        for (int g = 0; g < numGroups; ++g) {
+            const int mask = bits[g];
+            if (mask != 0) {
+                for (int b = 0; b < 8; ++b) {
+                    const int i = 8 * g + b;
+                    if ((mask & (1 << b)) && (i < m_surfaceArray.size()) && (! onlyShadowCasters || m_castsShadows[i]) &&
+                        ! (m_finite[i] && (planes[v].outsideBoxFace(f, i) || (notNull(occlusionCuller) && occluded(occlusionCuller, i))))) {
+                        out.append(m_surfaceArray[i]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+
+bool SurfaceBoundsCache::occluded(const OcclusionCuller* occlusionCuller, int i) const {
+    const Point3 center(field(BOX_X)[i], field(BOX_Y)[i], field(BOX_Z)[i]);
+    Vector3 halfAxis[3];
+    for (int a = 0; a < 3; ++a) {
+        halfAxis[a] = Vector3(field(Field(AXIS0_X + 3 * a))[i], field(Field(AXIS0_Y + 3 * a))[i], field(Field(AXIS0_Z + 3 * a))[i]);
+    }
+    return occlusionCuller->occluded(center, halfAxis);
+}
+
+
+void SurfaceBoundsCache::getBoxBounds(AABox& bounds, bool onlyShadowCasters, bool& anyInfinite) const {
+    bounds = AABox::empty();
+    for (int i = 0; i < m_surfaceArray.size(); ++i) {
+        if (! onlyShadowCasters || m_castsShadows[i]) {
+            if (m_finite[i]) {
+                Vector3 halfExtent;
+                for (int k = 0; k < 3; ++k) {
+                    halfExtent[k] = fabsf(field(Field(AXIS0_X + k))[i]) + fabsf(field(Field(AXIS1_X + k))[i]) + fabsf(field(Field(AXIS2_X + k))[i]);
+                }
+                const Point3 center(field(BOX_X)[i], field(BOX_Y)[i], field(BOX_Z)[i]);
+                bounds.merge(AABox(center - halfExtent, center + halfExtent));
+            } else {
+                anyInfinite = true;
+            }
+        }
+    }
+}
+
+} // namespace G3D
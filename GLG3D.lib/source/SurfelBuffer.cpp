@@ -0,0 +1,102 @@
+/**
+  \file GLG3D.lib/source/SurfelBuffer.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-18
+  \edited  2026-10-18
+*/
+#include "G3D/CoordinateFrame.h"
+#include "GLG3D/SurfelBuffer.h"
+#include "GLG3D/UniversalSurfel.h"
+#include "GLG3D/UniversalMaterial.h"
+
+namespace G3D {
+
+void SurfelBuffer::resize(int n) {
+    const bool shrink = false;
+    position.resize(n, shrink);
+    prevPosition.resize(n, shrink);
+    geometricNormal.resize(n, shrink);
+    shadingNormal.resize(n, shrink);
+    shadingTangent1.resize(n, shrink);
+    shadingTangent2.resize(n, shrink);
+    tangentSpaceNormal.resize(n, shrink);
+    lambertianReflectivity.resize(n, shrink);
+    glossyReflectionCoefficient.resize(n, shrink);
+    transmissionCoefficient.resize(n, shrink);
+    emission.resize(n, shrink);
+    coverage.resize(n, shrink);
+    smoothness.resize(n, shrink);
+    isTransmissive.resize(n, shrink);
+    etaPos.resize(n, shrink);
+    kappaPos.resize(n, shrink);
+    etaNeg.resize(n, shrink);
+    kappaNeg.resize(n, shrink);
+    material.resize(n, shrink);
+    surface.resize(n, shrink);
+    source.resize(n, shrink);
+}
+
+
+void SurfelBuffer::set(int i, const UniversalSurfel& s) {
+    position[i]                     = s.position;
+    prevPosition[i]                 = s.prevPosition;
+    geometricNormal[i]              = s.geometricNormal;
+    shadingNormal[i]                = s.shadingNormal;
+    shadingTangent1[i]              = s.shadingTangent1;
+    shadingTangent2[i]              = s.shadingTangent2;
+    tangentSpaceNormal[i]           = s.tangentSpaceNormal;
+    lambertianReflectivity[i]       = s.lambertianReflectivity;
+    glossyReflectionCoefficient[i]  = s.glossyReflectionCoefficient;
+    transmissionCoefficient[i]      = s.transmissionCoefficient;
+    emission[i]                     = s.emission;
+    coverage[i]                     = s.coverage;
+    smoothness[i]                   = s.smoothness;
+    isTransmissive[i]               = s.isTransmissive;
+    etaPos[i]                       = s.etaPos;
+    kappaPos[i]                     = s.kappaPos;
+    etaNeg[i]                       = s.etaNeg;
+    kappaNeg[i]                     = s.kappaNeg;
+    material[i]                     = static_cast<const UniversalMaterial*>(s.material);
+    surface[i]                      = s.surface;
+    source[i]                       = s.source;
+}
+
+
+void SurfelBuffer::get(int i, UniversalSurfel& s) const {
+    debugAssertM(hasSurfel(i), "Element has no surfel");
+    s.position                      = position[i];
+    s.prevPosition                  = prevPosition[i];
+    s.geometricNormal               = geometricNormal[i];
+    s.shadingNormal                 = shadingNormal[i];
+    s.shadingTangent1               = shadingTangent1[i];
+    s.shadingTangent2               = shadingTangent2[i];
+    s.tangentSpaceNormal            = tangentSpaceNormal[i];
+    s.lambertianReflectivity        = lambertianReflectivity[i];
+    s.glossyReflectionCoefficient   = glossyReflectionCoefficient[i];
+    s.transmissionCoefficient       = transmissionCoefficient[i];
+    s.emission                      = emission[i];
+    s.coverage                      = coverage[i];
+    s.smoothness                    = smoothness[i];
+    s.isTransmissive                = isTransmissive[i];
+    s.etaPos                        = etaPos[i];
+    s.kappaPos                      = kappaPos[i];
+    s.etaNeg                        = etaNeg[i];
+    s.kappaNeg                      = kappaNeg[i];
+    s.material                      = material[i];
+    s.surface                       = surface[i];
+    s.source                        = source[i];
+}
+
+
+void SurfelBuffer::transformToWorldSpace(int i, const CFrame& xform, const CFrame& prevXform) {
+    position[i]         = xform.pointToWorldSpace(position[i]);
+    prevPosition[i]     = prevXform.pointToWorldSpace(prevPosition[i]);
+    geometricNormal[i]  = xform.vectorToWorldSpace(geometricNormal[i]);
+    shadingNormal[i]    = xform.vectorToWorldSpace(shadingNormal[i]);
+    shadingTangent1[i]  = xform.vectorToWorldSpace(shadingTangent1[i]);
+    shadingTangent2[i]  = xform.vectorToWorldSpace(shadingTangent2[i]);
+}
+
+} // G3D
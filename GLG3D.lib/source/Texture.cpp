@@ -27,6 +27,8 @@
 #include "GLG3D/BumpMap.h"
 #include "GLG3D/Shader.h"
 #include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/BlockCompressedImage.h"
+#include "GLG3D/AsyncImageDecoder.h"
 #include "GLG3D/GLPixelTransferBuffer.h"
 #include "G3D/format.h"
 #include "G3D/CubeMap.h"
@@ -934,6 +936,16 @@ shared_ptr<Texture> Texture::fromFile
         return Texture::fromPixelTransferBuffer(FilePath::base(filename[0]), Image::arrayToPixelTransferBuffer(images), desiredEncoding.format, dimension);
     }
 
+    if ((dimension == DIM_2D) && filename[1].empty() && ! filename[0].empty() && ! beginsWith(filename[0], "<") &&
+        BlockCompressedImage::supportsFormat(desiredEncoding.format) &&
+        (preprocess.modulate == Color4::one()) && (preprocess.gammaAdjust == 1.0f) && (preprocess.scaleFactor == 1.0f) &&
+        ! preprocess.computeNormalMap && ! preprocess.convertToPremultipliedAlpha) {
+        // Compress on the CPU, which is higher quality than most drivers and is cached on disk
+        BlockCompressedImage::Settings settings(desiredEncoding.format);
+        settings.generateMipMaps = generateMipMaps;
+        return fromBlockCompressedImage(FilePath::base(filename[0]), BlockCompressedImage::fromFile(filename[0], settings), desiredEncoding);
+    }
+
     String realFilename[6];
     Array< Array< const void* > > byteMipMapFaces;
 
@@ -957,58 +969,44 @@ shared_ptr<Texture> Texture::fromFile
         generateCubeMapFilenames(filename[0], realFilename, info);
     }
 
-    // The six cube map faces, or the one texture and 5 dummys.
-    shared_ptr<Image> image[6];
+    // Decode all faces on worker threads, which also orient the cube map faces and apply the color
+    // preprocessing, so that this thread only uploads. GLCaps must be queried on this thread.
+    const bool convertL8ToRGB8 = ! GLCaps::supportsTexture(ImageFormat::L8()) ||
+        (notNull(desiredEncoding.format) && (desiredEncoding.format->luminanceBits == 0));
 
-    if (((numFaces == 1) && (dimension == DIM_2D)) || (dimension == DIM_3D)) {
-        if ((toLower(realFilename[0]) == "<white>") || realFilename[0].empty()) {
-            const shared_ptr<CPUPixelTransferBuffer>& buffer = CPUPixelTransferBuffer::create(1, 1, ImageFormat::RGBA8());
-            image[0] = Image::fromPixelTransferBuffer(buffer);
-            image[0]->set(Point2int32(0, 0), Color4unorm8::one());
+    AsyncImageDecoder::Future future[6];
+    shared_ptr<CPUPixelTransferBuffer> buffers[6];
+    for (int f = 0; f < numFaces; ++f) {
+        if ((toLower(realFilename[f]) == "<white>") || realFilename[f].empty()) {
+            buffers[f] = CPUPixelTransferBuffer::create(1, 1, ImageFormat::RGBA8());
+            System::memset(buffers[f]->buffer(), 0xFF, 4);
+            AsyncImageDecoder::applyPreprocess(preprocess, buffers[f]);
         } else {
-            image[0] = Image::fromFile(realFilename[0]);
+            const bool isCubeFace = (numFaces > 1);
+            const CubeMapConvention::CubeMapInfo::Face faceInfo = info.face[f];
+            future[f] = AsyncImageDecoder::decode(realFilename[f], preprocess, [isCubeFace, faceInfo, convertL8ToRGB8](const shared_ptr<Image>& image) {
+                alwaysAssertM((image->width() > 0) && (image->height() > 0), "Image not found");
+                if (isCubeFace) {
+                    shared_ptr<Image> im = image;
+                    transform(im, faceInfo);
+                }
 
-            alwaysAssertM(image[0]->width() > 0, 
-                G3D::format("Image not found: \"%s\" and GImage failed to throw an exception", realFilename[0].c_str()));
+                // Not all drivers will convert L8 to RGB correctly, so we force it explicitly here
+                if ((image->format() == ImageFormat::L8()) && convertL8ToRGB8) {
+                    image->convertToRGB8();
+                }
+            });
         }
-    } else {
-        // Load each cube face on a different thread to overlap compute and I/O    
-        Thread::runConcurrently(0, numFaces, [&](int f) {
-            if ((toLower(realFilename[f]) == "<white>") || realFilename[f].empty()) {
-                const shared_ptr<CPUPixelTransferBuffer>& buffer = CPUPixelTransferBuffer::create(1, 1, ImageFormat::RGBA8());
-                image[f] = Image::fromPixelTransferBuffer(buffer);
-                image[f]->set(Point2int32(0, 0), Color4unorm8::one());
-            } else {
-                image[f] = Image::fromFile(realFilename[f]);
-            }
-        });
     }
 
-    shared_ptr<PixelTransferBuffer> buffers[6];
-    Thread::runConcurrently(0, numFaces, [&](int f) {
-        //debugPrintf("Loading %s\n", realFilename[f].c_str());
-        alwaysAssertM(image[f]->width() > 0,  "Image not found");
-        alwaysAssertM(image[f]->height() > 0, "Image not found");
-
-        if (numFaces > 1) {
-            transform(image[f], info.face[f]);
-        }
-        
-        if (! GLCaps::supportsTexture(image[f]->format())) {
-            if (image[f]->format() == ImageFormat::L8()) {
-                image[f]->convertToRGB8();
-            } else { 
-                debugAssertM(false, "Unsupported texture format on this machine");
-            }
-        } else if ((image[f]->format() == ImageFormat::L8()) && notNull(desiredEncoding.format) && (desiredEncoding.format->luminanceBits == 0)) {
-            // Not all drivers will convert L8 to RGB correctly, so we force it explicitly here
-            image[f]->convertToRGB8();
+    for (int f = 0; f < numFaces; ++f) {
+        if (future[f].valid()) {
+            // Rethrows any Image::Error from the worker
+            buffers[f] = future[f].get();
         }
-
-        const shared_ptr<CPUPixelTransferBuffer>& b = image[f]->toPixelTransferBuffer();
-        buffers[f] = b;
-        array[f] = b->buffer();
-    }, (numFaces > 0));
+        debugAssertM(GLCaps::supportsTexture(buffers[f]->format()), "Unsupported texture format on this machine");
+        array[f] = buffers[f]->buffer();
+    }
 
     const shared_ptr<Texture>& t =
         fromMemory(FilePath::base(filename[0]), 
@@ -1021,7 +1019,7 @@ shared_ptr<Texture> Texture::fromFile
                    desiredEncoding, 
                    dimension,
                    generateMipMaps,
-                   preprocess,
+                   AsyncImageDecoder::remainingPreprocess(preprocess),
                    preferSRGBSpaceForAuto);
     
     return t;
@@ -1103,39 +1101,53 @@ shared_ptr<Texture> Texture::fromTwoFiles
         generateCubeMapFilenames(alphaFilename, alphaFilenameArray, alphaInfo);
     }
     
-    shared_ptr<Image> color[6];
-    shared_ptr<Image> alpha[6];
+    // Decode every file on worker threads, which also orient the cube map faces, before composing
+    // them on this thread
+    AsyncImageDecoder::Future color[6];
+    AsyncImageDecoder::Future alpha[6];
+    for (int f = 0; f < numFaces; ++f) {
+        const bool isCubeFace = (numFaces > 1);
+        const CubeMapConvention::CubeMapInfo::Face alphaFaceInfo = alphaInfo.face[f];
+        alpha[f] = AsyncImageDecoder::decode(alphaFilenameArray[f], Preprocess::defaults(), [isCubeFace, alphaFaceInfo](const shared_ptr<Image>& image) {
+            if (isCubeFace) {
+                shared_ptr<Image> im = image;
+                transform(im, alphaFaceInfo);
+            }
+        });
+
+        if (! ((toLower(filenameArray[f]) == "<white>") || filenameArray[f].empty())) {
+            const CubeMapConvention::CubeMapInfo::Face faceInfo = info.face[f];
+            color[f] = AsyncImageDecoder::decode(filenameArray[f], Preprocess::defaults(), [isCubeFace, faceInfo](const shared_ptr<Image>& image) {
+                if (isCubeFace) {
+                    shared_ptr<Image> im = image;
+                    transform(im, faceInfo);
+                }
+            });
+        }
+    }
+
     shared_ptr<PixelTransferBuffer> buffers[6];
     shared_ptr<Texture> t;
 
     try {
         for (int f = 0; f < numFaces; ++f) {
             // Compose the two images to a single RGBA
-            alpha[f] = Image::fromFile(alphaFilenameArray[f]);
-            if ( !((toLower(filenameArray[f]) == "<white>") || filenameArray[f].empty() )) {
-                color[f] = Image::fromFile(filenameArray[f]);
-            } 
+            const shared_ptr<CPUPixelTransferBuffer>& abuf = alpha[f].get();
+            const uint8* alphaMap                   = reinterpret_cast<const uint8*>(abuf->mapRead());
+            const int alphaStride                   = abuf->format()->numComponents;
 
-            const shared_ptr<CPUPixelTransferBuffer>& b    = CPUPixelTransferBuffer::create(alpha[f]->width(), alpha[f]->height(), ImageFormat::RGBA8());
+            const shared_ptr<CPUPixelTransferBuffer>& b    = CPUPixelTransferBuffer::create(abuf->width(), abuf->height(), ImageFormat::RGBA8());
             uint8* newMap                           = reinterpret_cast<uint8*>(b->mapWrite());
 
-            if (notNull(color[f])) {
-                if (numFaces > 1) {
-                    transform(color[f], info.face[f]);
-                    transform(alpha[f], alphaInfo.face[f]);
-                }
-                shared_ptr<CPUPixelTransferBuffer> cbuf = color[f]->toPixelTransferBuffer();
+            if (color[f].valid()) {
+                const shared_ptr<CPUPixelTransferBuffer>& cbuf = color[f].get();
                 const uint8* colorMap                   = reinterpret_cast<const uint8*>(cbuf->mapRead());
-                shared_ptr<CPUPixelTransferBuffer> abuf = alpha[f]->toPixelTransferBuffer();
-                const uint8* alphaMap                   = reinterpret_cast<const uint8*>(abuf->mapRead());
-            
 
-                alwaysAssertM((color[f]->width()  == alpha[f]->width()) && 
-                              (color[f]->height() == alpha[f]->height()), "Texture images for RGB + R -> RGBA packing conversion must be the same size");
+                alwaysAssertM((cbuf->width()  == abuf->width()) && 
+                              (cbuf->height() == abuf->height()), "Texture images for RGB + R -> RGBA packing conversion must be the same size");
                 /** write into new map byte-by-byte, copying over alpha properly */
-                const int N = color[f]->height() * color[f]->width();
+                const int N = cbuf->height() * cbuf->width();
                 const int colorStride = cbuf->format()->numComponents;
-                const int alphaStride = abuf->format()->numComponents;
                 for (int i = 0; i < N; ++i) {
                     newMap[i * 4 + 0] = colorMap[i * colorStride + 0];
                     newMap[i * 4 + 1] = colorMap[i * colorStride + 1];
@@ -1143,25 +1155,17 @@ shared_ptr<Texture> Texture::fromTwoFiles
                     newMap[i * 4 + 3] = useAlpha ? alphaMap[i * 4 + 3] : alphaMap[i * alphaStride];
                 }
                 cbuf->unmap();
-                abuf->unmap();
             } else { // No color map, use white
-                if (numFaces > 1) {
-                    transform(alpha[f], alphaInfo.face[f]);
-                }
-                shared_ptr<CPUPixelTransferBuffer> abuf = alpha[f]->toPixelTransferBuffer();
-                const uint8* alphaMap                   = reinterpret_cast<const uint8*>(abuf->mapRead());
-
                 /** write into new map byte-by-byte, copying over alpha properly */
-                const int N = alpha[f]->height() * alpha[f]->width();
-                const int alphaStride = abuf->format()->numComponents;
+                const int N = abuf->height() * abuf->width();
                 for (int i = 0; i < N; ++i) {
                     newMap[i * 4 + 0] = 255;
                     newMap[i * 4 + 1] = 255;
                     newMap[i * 4 + 2] = 255;
                     newMap[i * 4 + 3] = useAlpha ? alphaMap[i * 4 + 3] : alphaMap[i * alphaStride];
                 }
-                abuf->unmap();
             }
+            abuf->unmap();
             
             b->unmap();
             buffers[f] = b;
@@ -1664,6 +1668,24 @@ shared_ptr<Texture> Texture::fromImage
 }
 
 
+shared_ptr<Texture> Texture::fromBlockCompressedImage
+   (const String&                   name,
+    const shared_ptr<BlockCompressedImage>& image,
+    const Encoding&                 encoding) {
+
+    Array< Array<const void*> > mips;
+    mips.resize(image->numMipLevels());
+    for (int m = 0; m < mips.size(); ++m) {
+        mips[m].append(image->mipLevel(m).data.getCArray());
+    }
+
+    Preprocess preprocess;
+    preprocess.computeMinMaxMean = false;
+
+    return fromMemory(name, mips, image->format(), image->width(), image->height(), 1, 1, encoding, DIM_2D, false, preprocess);
+}
+
+
 shared_ptr<Texture> Texture::fromPixelTransferBuffer
    (const String&                   name,
     const shared_ptr<PixelTransferBuffer>& image,
@@ -56,8 +56,13 @@ bool Texture::Encoding::operator==(const Encoding& e) const {
 
 Any Texture::Specification::toAny() const {
     Any a = Any(Any::TABLE, "Texture::Specification");
-    a["filename"]           = filename;
-    a["alphaFilename"]      = alphaFilename;
+    // Empty filenames are omitted because parsing would resolve them to a directory
+    if (! filename.empty()) {
+        a["filename"]       = filename;
+    }
+    if (! alphaFilename.empty()) {
+        a["alphaFilename"]  = alphaFilename;
+    }
     a["encoding"]           = encoding;
     a["dimension"]          = toString(dimension);
     a["generateMipMaps"]    = generateMipMaps;
@@ -4,19 +4,24 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2009-06-10
-  \edited  2016-09-16
+  \edited  2026-10-18
 */
 #include "G3D/AABox.h"
 #include "G3D/CollisionDetection.h"
 #include "GLG3D/TriTreeBase.h"
 #include "GLG3D/Surface.h"
 #include "GLG3D/Scene.h"
+#include "GLG3D/SurfelBuffer.h"
+#include "GLG3D/UniversalMaterial.h"
+#include "GLG3D/UniversalSurfel.h"
 
 namespace G3D {
 
 void TriTreeBase::clear() {
     m_triArray.fastClear();
     m_vertexArray.clear();
+    m_triMaterialIndex.fastClear();
+    m_materialTable.fastClear();
 }
 
 
@@ -25,6 +30,35 @@ TriTreeBase::~TriTreeBase() {
 }
 
 
+void TriTreeBase::updateMaterialIndex() {
+    m_triMaterialIndex.resize(m_triArray.size());
+    m_materialTable.fastClear();
+
+    Table<const ReferenceCountedObject*, int> indexTable;
+    const ReferenceCountedObject* previous = nullptr;
+    int previousIndex = -1;
+    for (int t = 0; t < m_triArray.size(); ++t) {
+        const ReferenceCountedObject* data = m_triArray[t].m_data.get();
+
+        // Consecutive Tris usually come from the same Surface
+        if ((data != previous) || (previousIndex == -1)) {
+            bool created = false;
+            int& index = indexTable.getCreate(data, created);
+            if (created) {
+                index = m_materialTable.size();
+                MaterialEntry& entry = m_materialTable.next();
+                entry.surface  = dynamic_cast<const Surface*>(data);
+                entry.material = dynamic_cast<const UniversalMaterial*>(m_triArray[t].material().get());
+            }
+            previous      = data;
+            previousIndex = index;
+        }
+
+        m_triMaterialIndex[t] = previousIndex;
+    }
+}
+
+
 void TriTreeBase::setContents
    (const shared_ptr<Scene>&            scene, 
     ImageStorage                        newStorage) {
@@ -79,7 +113,7 @@ shared_ptr<Surfel> TriTreeBase::intersectRay
     Hit hit;
     if (intersectRay(ray, hit, options)) {
         shared_ptr<Surfel> surfel;
-        m_triArray[hit.triIndex].sample(hit.u, hit.v, hit.triIndex, m_vertexArray, hit.backface, surfel);
+        sample(hit, surfel);
         return surfel;
     } else {
         return nullptr;
@@ -126,11 +160,58 @@ void TriTreeBase::intersectSphere
 
 
 void TriTreeBase::sample(const Hit& hit, shared_ptr<Surfel>& surfel) const {
-    if (hit.triIndex != Hit::NONE) {
-        m_triArray[hit.triIndex].sample(hit.u, hit.v, hit.triIndex, m_vertexArray, hit.backface, surfel);
-    } else {
+    if (hit.triIndex == Hit::NONE) {
         surfel = nullptr;
+        return;
+    }
+
+    const Tri& tri = m_triArray[hit.triIndex];
+    const MaterialEntry* entry = (hit.triIndex < m_triMaterialIndex.size()) ? &m_materialTable[m_triMaterialIndex[hit.triIndex]] : nullptr;
+    if (isNull(entry) || isNull(entry->material)) {
+        // Not a UniversalMaterial, or a subclass that did not call updateMaterialIndex()
+        tri.sample(hit.u, hit.v, hit.triIndex, m_vertexArray, hit.backface, surfel);
+        return;
     }
+
+    // Reuse the existing surfel when possible, as UniversalMaterial::sample does
+    UniversalSurfel* universalSurfel = dynamic_cast<UniversalSurfel*>(surfel.get());
+    if (isNull(universalSurfel)) {
+        surfel = UniversalSurfel::create();
+        universalSurfel = static_cast<UniversalSurfel*>(surfel.get());
+    }
+    universalSurfel->sample(tri, hit.u, hit.v, hit.triIndex, m_vertexArray, hit.backface, entry->material, entry->surface);
+}
+
+
+void TriTreeBase::sample(const Hit& hit, SurfelBuffer& buffer, int index) const {
+    if (hit.triIndex == Hit::NONE) {
+        buffer.setNone(index);
+        return;
+    }
+
+    debugAssertM(m_triMaterialIndex.size() == m_triArray.size(), "rebuild() did not call updateMaterialIndex()");
+    const MaterialEntry& entry = m_materialTable[m_triMaterialIndex[hit.triIndex]];
+    if (isNull(entry.material)) {
+        buffer.setNone(index);
+        return;
+    }
+
+    // On the stack, so no allocation or reference counting
+    UniversalSurfel surfel;
+    surfel.sample(m_triArray[hit.triIndex], hit.u, hit.v, hit.triIndex, m_vertexArray, hit.backface, entry.material, entry.surface);
+    buffer.set(index, surfel);
+}
+
+
+void TriTreeBase::sampleHits(const Array<Hit>& hits, SurfelBuffer& buffer) const {
+    buffer.resize(hits.size());
+
+    const Hit* pHit = hits.getCArray();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, hits.size(), 128), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            sample(pHit[i], buffer, int(i));
+        }
+    });
 }
 
 
@@ -145,18 +226,12 @@ void TriTreeBase::intersectRays
 
     const Hit* pHit = hits.getCArray();
     shared_ptr<Surfel>* pSurfel = results.getCArray();
-    const Tri* pTri = m_triArray.getCArray();
 
 	tbb::parallel_for(tbb::blocked_range<size_t>(0, hits.size(), 128), [&](const tbb::blocked_range<size_t>& r) {
 		const size_t start = r.begin();
 		const size_t end   = r.end();
 		for (size_t i = start; i < end; ++i) {
-            const Hit& hit = pHit[i];
-            if (hit.triIndex != Hit::NONE) {
-                pTri[hit.triIndex].sample(hit.u, hit.v, hit.triIndex, m_vertexArray, hit.backface, pSurfel[i]);
-            } else {
-                pSurfel[i] = nullptr;
-            }
+            sample(pHit[i], pSurfel[i]);
         }
     });
 
@@ -210,6 +210,7 @@ shared_ptr<UniversalMaterial> UniversalMaterial::create(const String& name, cons
         }
 
         value->m_name = name;
+        value->m_specification = createShared<Specification>(specification);
 
         value->m_constantTable = specification.m_constantTable;
 
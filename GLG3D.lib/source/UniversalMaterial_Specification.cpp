@@ -317,6 +317,79 @@ size_t UniversalMaterial::Specification::hashCode() const {
 }
 
 
+bool UniversalMaterial::Specification::serializable() const {
+    return isNull(m_lambertianTex) && isNull(m_glossyTex) && isNull(m_transmissiveTex) &&
+        isNull(m_emissiveTex) && isNull(m_customTex) && (m_numLightMapDirections == 0);
+}
+
+
+void UniversalMaterial::Specification::serialize(BinaryOutput& b) const {
+    alwaysAssertM(serializable(), "Cannot serialize a UniversalMaterial::Specification that refers to Textures in memory");
+
+    m_lambertian.serialize(b);
+    m_glossy.serialize(b);
+    m_transmissive.serialize(b);
+    m_emissive.serialize(b);
+
+    b.writeFloat32(m_etaTransmit);
+    m_extinctionTransmit.serialize(b);
+    b.writeFloat32(m_etaReflect);
+    m_extinctionReflect.serialize(b);
+
+    b.writeString32(m_customShaderPrefix);
+
+    m_bump.texture.serialize(b);
+    m_bump.settings.serialize(b);
+
+    m_refractionHint.serialize(b);
+    m_mirrorHint.serialize(b);
+    m_alphaFilter.serialize(b);
+    m_sampler.toAny().serialize(b);
+    m_inferAmbientOcclusionAtTransparentPixels.serialize(b);
+
+    b.writeInt32(m_constantTable.size());
+    for (Table<String, double>::Iterator it = m_constantTable.begin(); it.hasMore(); ++it) {
+        b.writeString32(it->key);
+        b.writeFloat64(it->value);
+    }
+}
+
+
+void UniversalMaterial::Specification::deserialize(BinaryInput& b) {
+    *this = Specification();
+
+    m_lambertian.deserialize(b);
+    m_glossy.deserialize(b);
+    m_transmissive.deserialize(b);
+    m_emissive.deserialize(b);
+
+    m_etaTransmit = b.readFloat32();
+    m_extinctionTransmit.deserialize(b);
+    m_etaReflect = b.readFloat32();
+    m_extinctionReflect.deserialize(b);
+
+    m_customShaderPrefix = b.readString32();
+
+    m_bump.texture.deserialize(b);
+    m_bump.settings.deserialize(b);
+
+    m_refractionHint.deserialize(b);
+    m_mirrorHint.deserialize(b);
+    m_alphaFilter.deserialize(b);
+
+    Any a;
+    a.deserialize(b);
+    m_sampler = Sampler(a);
+    m_inferAmbientOcclusionAtTransparentPixels.deserialize(b);
+
+    const int numConstants = b.readInt32();
+    for (int i = 0; i < numConstants; ++i) {
+        const String& key = b.readString32();
+        m_constantTable.set(key, b.readFloat64());
+    }
+}
+
+
 Component4 UniversalMaterial::Specification::loadLambertian() const {
     if (notNull(m_lambertianTex)) {
         return Component4(m_lambertianTex);
@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2012-08-01
-  \edited  2016-07-02
+  \edited  2026-10-18
 
   Copyright 2001-2016, Morgan McGuire
  */
@@ -19,6 +19,11 @@
 namespace G3D {
 
 void UniversalSurfel::sample(const Tri& tri, float u, float v, int triIndex, const CPUVertexArray& vertexArray, bool backside, const UniversalMaterial* universalMaterial) {
+    sample(tri, u, v, triIndex, vertexArray, backside, universalMaterial, dynamic_cast<const Surface*>(tri.m_data.get()));
+}
+
+
+void UniversalSurfel::sample(const Tri& tri, float u, float v, int triIndex, const CPUVertexArray& vertexArray, bool backside, const UniversalMaterial* universalMaterial, const Surface* surface) {
     source.index = triIndex;
     source.u = u;
     source.v = v;
@@ -53,8 +58,6 @@ void UniversalSurfel::sample(const Tri& tri, float u, float v, int triIndex, con
         u * vert1.texCoord0 +
         v * vert2.texCoord0;
 
-    // The cast for material and extracting the surface
-    // are very expensive.
     geometricNormal = tri.normal(vertexArray);
     const shared_ptr<UniversalBSDF>& bsdf = universalMaterial->bsdf();    
 
@@ -147,7 +150,7 @@ void UniversalSurfel::sample(const Tri& tri, float u, float v, int triIndex, con
     isTransmissive = transmissionCoefficient.nonZero() || (coverage < 1.0f);
 
     material = universalMaterial;
-    surface  = dynamic_cast<const Surface*>(tri.m_data.get());
+    this->surface = surface;
 }
 
 
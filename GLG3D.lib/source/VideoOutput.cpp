@@ -11,6 +11,7 @@
 #include "GLG3D/VideoInput.h"
 #include "GLG3D/RenderDevice.h"
 #include "GLG3D/GLPixelTransferBuffer.h"
+#include <atomic>
 
 #ifdef G3D_NO_FFMPEG
 typedef void* PixelFormat;
@@ -45,6 +46,10 @@ VideoOutput::Settings::Settings(InternalCodecID c, int w, int h, float f, int cu
     raw.invert = false;
     mpeg.bframes = 0;
     mpeg.gop = 12;  // The default
+
+    asynchronous.enabled            = false;
+    asynchronous.queueLength        = 8;
+    asynchronous.dropFramesWhenFull = false;
 }
 
 
@@ -125,7 +130,11 @@ VideoOutput::VideoOutput() :
     m_avInputBuffer(NULL),
     m_avInputFrame(NULL),
     m_avEncodingBuffer(NULL),
-    m_avEncodingBufferSize(0)
+    m_avEncodingBufferSize(0),
+    m_swsContext(NULL),
+    m_discardQueuedFrames(0),
+    m_droppedFrames(0),
+    m_stalledFrames(0)
 {
 }
 
@@ -136,6 +145,11 @@ VideoOutput::~VideoOutput() {
         abort();
     }
 
+    if (m_swsContext) {
+        sws_freeContext(m_swsContext);
+        m_swsContext = NULL;
+    }
+
     if (m_avInputBuffer) {
         av_free(m_avInputBuffer);
         m_avInputBuffer = NULL;
@@ -295,6 +309,60 @@ void VideoOutput::initialize(const String& filename, const Settings& settings) {
     }
 #endif
     m_isInitialized = true;
+
+    if (m_settings.asynchronous.enabled) {
+        startEncoderThread();
+    }
+}
+
+
+void VideoOutput::startEncoderThread() {
+    const int n = iMax(1, m_settings.asynchronous.queueLength);
+
+    m_freeFrames   = shared_ptr<BoundedThreadsafeQueue<PendingFrame*>>(new BoundedThreadsafeQueue<PendingFrame*>(n));
+    // One extra slot for the NULL that stops the thread
+    m_queuedFrames = shared_ptr<BoundedThreadsafeQueue<PendingFrame*>>(new BoundedThreadsafeQueue<PendingFrame*>(n + 1));
+
+    m_framePool.resize(n);
+    for (int i = 0; i < n; ++i) {
+        m_framePool[i] = shared_ptr<PendingFrame>(new PendingFrame());
+        m_freeFrames->pushBack(m_framePool[i].get());
+    }
+
+    m_discardQueuedFrames = 0;
+    m_encoderThread = Thread::create("G3D::VideoOutput encoder", &VideoOutput::encoderThreadMain, this);
+    m_encoderThread->start();
+}
+
+
+void VideoOutput::stopEncoderThread(bool discard) {
+    if (isNull(m_encoderThread)) {
+        return;
+    }
+
+    m_discardQueuedFrames = discard ? 1 : 0;
+    m_queuedFrames->pushBack(NULL);
+    m_encoderThread->waitForCompletion();
+    m_encoderThread.reset();
+}
+
+
+void VideoOutput::encoderThreadMain(void* videoOutput) {
+    VideoOutput* vo = static_cast<VideoOutput*>(videoOutput);
+
+    PendingFrame* frame = NULL;
+    while (vo->m_queuedFrames->popFront(frame) && notNull(frame)) {
+        if (vo->m_discardQueuedFrames.value() == 0) {
+            try {
+                vo->encodeFrameNow(frame->data.getCArray(), frame->format, frame->invertY);
+            } catch (const String& e) {
+                logPrintf("VideoOutput: dropped a frame on the encoder thread: %s\n", e.c_str());
+            }
+        }
+
+        // Recycle the buffer
+        vo->m_freeFrames->pushBack(frame);
+    }
 }
 
 
@@ -351,10 +419,38 @@ void VideoOutput::append(const shared_ptr<PixelTransferBuffer>& frame) {
 
 
 
-void VideoOutput::encodeFrame(const uint8* _frame, const ImageFormat* format, bool invertY) {
+void VideoOutput::encodeFrame(const uint8* frame, const ImageFormat* format, bool invertY) {
     alwaysAssertM(m_isInitialized, "VideoOutput was not initialized before call to encodeAndWriteFrame.");
     alwaysAssertM(! m_isFinished, "Cannot call VideoOutput::append() after commit() or abort().");
 
+    if (isNull(m_encoderThread)) {
+        encodeFrameNow(frame, format, invertY);
+        return;
+    }
+
+    PendingFrame* pending = NULL;
+    if (! m_freeFrames->tryPopFront(pending)) {
+        // Every buffer is waiting for the encoder
+        if (m_settings.asynchronous.dropFramesWhenFull) {
+            ++m_droppedFrames;
+            return;
+        }
+        ++m_stalledFrames;
+        m_freeFrames->popFront(pending);
+    }
+
+    // The caller's buffer is only valid until this returns, so copy it
+    const size_t bytes = size_t(m_settings.width) * size_t(m_settings.height) * format->cpuBitsPerPixel / 8;
+    pending->data.resize(bytes, false);
+    System::memcpy(pending->data.getCArray(), frame, bytes);
+    pending->format  = format;
+    pending->invertY = invertY;
+
+    m_queuedFrames->pushBack(pending);
+}
+
+
+void VideoOutput::encodeFrameNow(const uint8* _frame, const ImageFormat* format, bool invertY) {
 #   ifndef G3D_NO_FFMPEG
 
         const uint8* frame = convertFrame(_frame, format, invertY);
@@ -398,57 +494,62 @@ const uint8* VideoOutput::convertFrame(const uint8* src, const ImageFormat* form
         ((m_settings.codec == CODEC_ID_RAWVIDEO) && (m_settings.raw.invert != invertY)) ||
          ((m_settings.codec != CODEC_ID_RAWVIDEO) && invertY);
 
-    // go through an intermediate conversion if required
-    const PixelFormat matchingPixelFormat = ConvertImageFormatToPixelFormat(format);
-
-    Array<const void*> inputBuffers;
-    inputBuffers.append(src);
-
-    Array<void*> outputBuffers;
-    outputBuffers.append(m_temp.getCArray());
+    const int width  = m_settings.width;
+    const int height = m_settings.height;
+
+    // Rows convert independently for packed formats, so convert bands of rows in parallel.
+    // Bayer patterns need neighboring rows and YUV may be planar.
+    const bool rowsAreIndependent = 
+        (format->bayerPattern == ImageFormat::BAYER_PATTERN_NONE) &&
+        (format->colorSpace != ImageFormat::COLOR_SPACE_YUV) &&
+        ((format->cpuBitsPerPixel % 8) == 0);
+    const int ROWS_PER_BAND = 32;
+
+    std::atomic<bool> success(true);
+    tbb::parallel_for(tbb::blocked_range<int>(0, height, rowsAreIndependent ? ROWS_PER_BAND : height), [&](const tbb::blocked_range<int>& band) {
+        const size_t srcStride = size_t(width) * format->cpuBitsPerPixel / 8;
+        const size_t dstStride = size_t(width) * ImageFormat::RGB8()->cpuBitsPerPixel / 8;
+
+        Array<const void*> inputBuffers;
+        inputBuffers.append(src + srcStride * band.begin());
+
+        // When inverting, this band lands at the mirrored position
+        const int dstY = invertRequired ? (height - band.end()) : band.begin();
+        Array<void*> outputBuffers;
+        outputBuffers.append(m_temp.getCArray() + dstStride * dstY);
+
+        if (! ImageFormat::convert(inputBuffers, width, int(band.size()), format, 0, 
+                                   outputBuffers, ImageFormat::RGB8(), 0, invertRequired)) {
+            success = false;
+        }
+    });
 
-    const bool success = ImageFormat::convert(inputBuffers, 
-                                          m_settings.width, 
-                                          m_settings.height, 
-                                          format, 0, 
-                                          outputBuffers, 
-                                          ImageFormat::RGB8(), 
-                                          0, 
-                                          invertRequired);
     if (! success) {
         throwException(success, "Unable to add frame due to unsupported conversion of formats.");
     }
    
 #   ifndef G3D_NO_FFMPEG
-        m_avInputFrame->format = matchingPixelFormat;
-        if (PIX_FMT_RGB24 != m_avStream->codec->pix_fmt) {
+        // m_temp is now RGB8 regardless of the input format
+        const PixelFormat tempPixelFormat = PIX_FMT_RGB24;
+        m_avInputFrame->format = m_avStream->codec->pix_fmt;
+        if (tempPixelFormat != m_avStream->codec->pix_fmt) {
             // finally convert to the format the encoder expects
-            AVFrame* convFrame = avcodec_alloc_frame();
-            throwException(convFrame, "Unable to append frame because in "
-                                      "VideoOutput, avcodec_alloc_frame returned NULL");
+            AVPicture convFrame;
+            avpicture_fill(&convFrame, m_temp.getCArray(), tempPixelFormat, width, height);
 
-            avpicture_fill(reinterpret_cast<AVPicture*>(convFrame), 
-                           m_temp.getCArray(),
-                           matchingPixelFormat,
-                           m_settings.width, 
-                           m_settings.height);
-
-            // Create resize context since the parameters shouldn't change throughout the video
-            SwsContext* resizeContext = sws_getContext(m_settings.width, m_settings.height, matchingPixelFormat, m_settings.width, m_settings.height, m_avStream->codec->pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
-            debugAssert(resizeContext);
-
-            sws_scale(resizeContext, convFrame->data, convFrame->linesize, 0, m_settings.height, m_avInputFrame->data, m_avInputFrame->linesize);
+            // The parameters do not change throughout the video, so this creates the context only once
+            m_swsContext = sws_getCachedContext(m_swsContext, width, height, tempPixelFormat, width, height, m_avStream->codec->pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+            throwException(m_swsContext, "Unable to append frame because sws_getCachedContext failed");
 
-            av_free(convFrame);
-            av_free(resizeContext);
+            sws_scale(m_swsContext, convFrame.data, convFrame.linesize, 0, height, m_avInputFrame->data, m_avInputFrame->linesize);
 
         } else {
             // otherwise just setup the input frame without conversion
             avpicture_fill(reinterpret_cast<AVPicture*>(m_avInputFrame), 
                            m_temp.getCArray(),
-                           matchingPixelFormat,
-                           m_settings.width, 
-                           m_settings.height);
+                           tempPixelFormat,
+                           width, 
+                           height);
         }
 #   endif
 
@@ -457,6 +558,9 @@ const uint8* VideoOutput::convertFrame(const uint8* src, const ImageFormat* form
 
 
 void VideoOutput::commit() {
+    // Drain the queue before writing the trailer
+    stopEncoderThread(false);
+
     m_isFinished = true;
 #ifndef G3D_NO_FFMPEG
     if (m_isInitialized) {
@@ -470,6 +574,8 @@ void VideoOutput::commit() {
 }
 
 void VideoOutput::abort() {
+    stopEncoderThread(true);
+
     m_isFinished = true;
 #ifndef G3D_NO_FFMPEG
     if (m_avFormatContext && m_avFormatContext->pb) {
@@ -18,6 +18,9 @@ var MessageType = {
     // Matches G3D::GEventType::KEY_UP
     KEY_UP: 3,
 
+    // Changed tiles of a frame; see G3D::DeltaFrameEncoder::Frame::serialize
+    IMAGE_TILES: 4,
+
     SEND_IMAGE: 1000
 };
 
@@ -40,6 +43,13 @@ var dpad;
 /** Current image being displayed */
 var img;
 
+/** Canvas onto which IMAGE_TILES messages are assembled */
+var tileCanvas;
+
+/** Index of the most recent frame that updated each tile, keyed by "x,y", so that a tile that
+    finishes decoding late does not overwrite a newer one */
+var tileFrameIndex = {};
+
 ///////////////////////////////////////////////////////////////
 //                                                           //
 //                      EVENT RULES                          //
@@ -140,6 +150,13 @@ function onReceiveMessage(msg) {
             sendMessage({ type: MessageType.SEND_IMAGE });
             break;
 
+        case MessageType.IMAGE_TILES:
+            receiveTiles(msg);
+
+            // Acknowledge the frame so that the server can send more
+            sendMessage({ type: MessageType.SEND_IMAGE });
+            break;
+
     case MessageType.COMMENT:
         console.log('Server says: ' + msg.value);
         break;
@@ -154,6 +171,54 @@ function onReceiveMessage(msg) {
 //                                                           //
 //                      HELPER RULES                         //
 
+/** Decodes the tiles in an IMAGE_TILES message and draws them onto tileCanvas */
+function receiveTiles(msg) {
+    var view = new DataView(msg.data.buffer, msg.data.byteOffset, msg.data.byteLength);
+    var offset = 0;
+    function readInt32() { var v = view.getInt32(offset); offset += 4; return v; }
+
+    var width     = readInt32();
+    var height    = readInt32();
+    var index     = readInt32();
+    var keyframe  = view.getUint8(offset); offset += 1;
+    var numTiles  = readInt32();
+
+    if (! tileCanvas || (tileCanvas.width !== width) || (tileCanvas.height !== height)) {
+        tileCanvas = document.createElement('canvas');
+        tileCanvas.width  = width;
+        tileCanvas.height = height;
+        tileFrameIndex = {};
+    }
+    img = tileCanvas;
+
+    for (var t = 0; t < numTiles; ++t) {
+        var x      = readInt32();
+        var y      = readInt32();
+        readInt32(); // width
+        readInt32(); // height
+        var size   = readInt32();
+        var bytes  = msg.data.subarray(offset, offset + size);
+        offset += size;
+
+        drawTile(x, y, index, 'data:' + msg.mimeType + ';base64,' + btoa(String.fromCharCode.apply(undefined, bytes)));
+    }
+}
+
+
+function drawTile(x, y, index, uri) {
+    var key = x + ',' + y;
+    tileFrameIndex[key] = index;
+
+    var tileImg = new Image();
+    tileImg.onload = function () {
+        if (tileFrameIndex[key] === index) {
+            tileCanvas.getContext('2d').drawImage(tileImg, x, y);
+        }
+    };
+    tileImg.onerror = function (evt) { console.log('error loading tile'); };
+    tileImg.src = uri;
+}
+
 function createDPad() {
     // Create the directional pad.  Note that images might not have
     // loaded yet, so we can't refer to their width and height.
@@ -11,11 +11,12 @@ G3D_START_AT_MAIN();
 /** Events coming in from the remote machine */
 static ThreadsafeQueue<GEvent>      remoteEventQueue;
 
+/** Protects clientTable */
 static GMutex                       clientSetMutex;
-static Set<struct mg_connection*>   clientSet;
 
-/** Set to 1 when the client requests a full-screen image and back to 0 after the frame is sent. */
-static AtomicInt32                  clientWantsImage(0);
+/** Each client has its own encoder because the tiles to send depend on what that client
+    has already received */
+static Table<struct mg_connection*, shared_ptr<DeltaFrameEncoder> > clientTable;
 
 int main(int argc, const char* argv[]) {
     initGLG3D();
@@ -95,12 +96,11 @@ int mg_websocket_write(struct mg_connection* conn, int opcode, const String& str
 
 static void websocket_ready_handler(struct mg_connection* conn) {
     clientSetMutex.lock();
-    clientSet.insert(conn);
+    clientTable.set(conn, shared_ptr<DeltaFrameEncoder>(new DeltaFrameEncoder()));
     clientSetMutex.unlock();
 
     mg_websocket_write(conn, 0x1, "{\"type\": 0, \"value\":\"server ready\"}");
     debugPrintf("Connection 0x%x: Opened for websocket\n",  (unsigned int)(uintptr_t)conn);
-    clientWantsImage = 1;
 }
 
 
@@ -170,7 +170,12 @@ static int websocket_data_handler(struct mg_connection* conn, int flags, char* d
             break;
 
         case SEND_IMAGE:
-            clientWantsImage = 1;
+            // The client has received a frame and is ready for more
+            clientSetMutex.lock();
+            if (clientTable.containsKey(conn)) {
+                clientTable[conn]->acknowledge();
+            }
+            clientSetMutex.unlock();
             break;
 
         case GEventType::KEY_DOWN:
@@ -245,7 +250,7 @@ int error_handler(mg_connection* conn, int status) {
 
 static void connection_close_handler(struct mg_connection* conn) {
     clientSetMutex.lock();
-    clientSet.remove(conn);
+    clientTable.remove(conn);
     clientSetMutex.unlock();
 }
 
@@ -261,13 +266,15 @@ String futureTime(int secondsIntoFuture) {
 
 
 static const int IMAGE = 1;
-void mg_websocket_write_image(mg_connection* conn, const shared_ptr<Image>& buf, Image::ImageFileFormat ff) {
+static const int IMAGE_TILES = 4;
+
+/** Sends only the tiles of the frame that changed. See DeltaFrameEncoder::Frame::serialize for the binary format. */
+void mg_websocket_write_tiles(mg_connection* conn, const DeltaFrameEncoder::Frame& frame) {
     BinaryOutput bo("<memory>", G3D_BIG_ENDIAN);
 
-    alwaysAssertM((ff == Image::PNG) || (ff == Image::JPEG), "Only PNG and JPEG are supported right now");
-    const char* mimeType = (ff == Image::PNG) ? "image/png" : "image/jpeg";
+    const char* mimeType = (frame.tileFormat == Image::PNG) ? "image/png" : "image/jpeg";
     const String& msg = 
-        format("{\"type\":%d,\"width\":%d,\"height\":%d,\"mimeType\":\"%s\"}",IMAGE, buf->width(), buf->height(), mimeType);
+        format("{\"type\":%d,\"mimeType\":\"%s\"}", IMAGE_TILES, mimeType);
 
     // JSON header length (in network byte order)
     bo.writeInt32((int32)msg.length());
@@ -276,11 +283,9 @@ void mg_websocket_write_image(mg_connection* conn, const shared_ptr<Image>& buf,
     bo.writeString(msg, (int32)msg.length());
 
     // Binary data
-    buf->serialize(bo, ff);
-    
-    const size_t bytes = mg_websocket_write(conn, 0x2, (const char*)bo.getCArray(), bo.length());
-    (void)bytes;
-    // debugPrintf("Sent %d bytes\n", (unsigned int)bytes);
+    frame.serialize(bo);
+
+    mg_websocket_write(conn, 0x2, (const char*)bo.getCArray(), bo.length());
 }
 
 
@@ -378,8 +383,8 @@ bool App::onEvent(const GEvent& event) {
     if ((event.type == GEventType::KEY_DOWN) && (event.key.keysym.sym == 'p')) {
         // Send a message to the clients
         clientSetMutex.lock();
-        for (Set<struct mg_connection*>::Iterator it = clientSet.begin(); it.isValid(); ++it) {
-            mg_connection* conn = *it;
+        for (Table<struct mg_connection*, shared_ptr<DeltaFrameEncoder> >::Iterator it = clientTable.begin(); it.isValid(); ++it) {
+            mg_connection* conn = it->key;
             mg_websocket_write(conn, 0x1, "{\"type\": 0, \"value\": \"how are you?\"}");
         }
         clientSetMutex.unlock();
@@ -402,16 +407,26 @@ void App::onGraphics3D(RenderDevice* rd, Array<shared_ptr<Surface> >& allSurface
     } rd->pop2D();
 
     clientSetMutex.lock();
-    screenPrintf("Number of clients: %d\n", clientSet.size());
-    //screenPrintf("clientWantsImage: %d\n", clientWantsImage.value());
+    screenPrintf("Number of clients: %d\n", (int)clientTable.size());
 
-    if ((clientWantsImage.value() != 0) && (clientSet.size() > 0)) {
-        // Send the image to the first client
-        mg_connection* conn = *clientSet.begin();
+    // Read back the frame only if some client can accept it
+    shared_ptr<CPUPixelTransferBuffer> frameBuffer;
+    for (Table<struct mg_connection*, shared_ptr<DeltaFrameEncoder> >::Iterator it = clientTable.begin(); it.isValid(); ++it) {
+        const shared_ptr<DeltaFrameEncoder>& encoder = it->value;
+        screenPrintf("  Client 0x%x: %d frames, %d kB in flight\n", (unsigned int)(uintptr_t)it->key, encoder->framesInFlight(), (int)(encoder->bytesInFlight() / 1024));
 
-        // JPEG encoding/decoding takes more time but substantially less bandwidth than PNG
-        mg_websocket_write_image(conn, m_finalFramebuffer->texture(0)->toImage(ImageFormat::RGB8()), Image::JPEG);
-        clientWantsImage = 0;
+        if (encoder->readyToSend()) {
+            if (isNull(frameBuffer)) {
+                frameBuffer = m_finalFramebuffer->texture(0)->toImage(ImageFormat::RGB8())->toPixelTransferBuffer();
+            }
+
+            // JPEG tiles take more time to encode and decode than PNG but substantially less
+            // bandwidth. Only tiles that changed since this client's last frame are sent.
+            DeltaFrameEncoder::Frame frame;
+            if (encoder->encode(frameBuffer, frame)) {
+                mg_websocket_write_tiles(it->key, frame);
+            }
+        }
     }
     clientSetMutex.unlock();
 }
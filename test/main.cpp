@@ -39,6 +39,7 @@ using G3D::uint8;
 // Forward declarations
 void testImageConvert();
 void testImage();
+void testAsyncImageDecoder();
 
 void perfArray();
 void testArray();
@@ -55,6 +56,9 @@ void testSpeedLoad();
 
 void testZip();
 
+void testParsePLY();
+void perfParsePLY();
+
 void testuint128();
 
 void testCollisionDetection();
@@ -73,6 +77,8 @@ void testQuat();
 
 void perfKDTree();
 void testKDTree();
+void testArticulatedModelDiskCache();
+void testMeshSimplifier();
 
 void testSphere();
 
@@ -88,6 +94,8 @@ void testSystemMemset();
 
 void testMap2D();
 
+void testCubeMap();
+
 void testReferenceCount();
 
 void testRandom();
@@ -97,7 +105,30 @@ void perfTextOutput();
 void testMeshAlgTangentSpace();
 
 void perfQueue();
+
+void perfNetwork();
+void testNetwork();
 void testQueue();
+void testRadixSort();
+void testParticleSystem();
+void testInstancedTriTree();
+void testCPUVertexArray();
+void testTriTreeBase();
+
+void testBoundedThreadsafeQueue();
+void testSurfaceBoundsCache();
+void perfSurfaceBoundsCache();
+void testOcclusionCuller();
+void perfOcclusionCuller();
+void perfAny();
+void perfSpline();
+void perfMeshAlgTangentSpace();
+void perfAdjacency();
+void perfMeshSimplifier();
+void perfMeshAlgVertexCache();
+void perfBlockCompressedImage();
+void perfImageFilter();
+void perfBoundedThreadsafeQueue();
 
 void testBinaryIO();
 void testHugeBinaryIO();
@@ -108,6 +139,11 @@ void testTextInput2();
 
 void testTable();
 void testAdjacency();
+void testMeshAlgVertexCache();
+void testBlockCompressedImage();
+void testImageFilter();
+void testVideoOutput();
+void testDeltaFrameEncoder();
 
 void perfTable();
 
@@ -724,6 +760,8 @@ int main(int argc, char* argv[]) {
 
         perfBinaryIO();
 
+        perfParsePLY();
+
         perfTable();
 
         perfHashTrait();
@@ -732,6 +770,20 @@ int main(int argc, char* argv[]) {
 
         perfQueue();
 
+        perfBoundedThreadsafeQueue();
+
+        perfNetwork();
+        perfSurfaceBoundsCache();
+        perfOcclusionCuller();
+        perfAny();
+        perfSpline();
+        perfMeshAlgTangentSpace();
+        perfAdjacency();
+        perfMeshSimplifier();
+        perfMeshAlgVertexCache();
+        perfBlockCompressedImage();
+        perfImageFilter();
+
         perfMatrix3();
 
         perfTextOutput();
@@ -786,6 +838,7 @@ int main(int argc, char* argv[]) {
     teststring();
 
     testImage();
+    testAsyncImageDecoder();
 
     testMatrix();
 
@@ -793,6 +846,8 @@ int main(int argc, char* argv[]) {
 
     testBinaryIO();
 
+    testParsePLY();
+
     testSpeedLoad();
 
     testReliableConduit(NetworkDevice::instance());
@@ -809,6 +864,8 @@ int main(int argc, char* argv[]) {
 
     testImageConvert();
 
+    testMeshSimplifier();
+
     testLineSegment2D();
 
     if (! renderDevice) {
@@ -818,6 +875,8 @@ int main(int argc, char* argv[]) {
 
     if (renderDevice) {
         testKDTree();
+        testArticulatedModelDiskCache();
+        testTriTreeBase();
         testGLight();
     }
 
@@ -831,6 +890,8 @@ int main(int argc, char* argv[]) {
 
     testMap2D();
 
+    testCubeMap();
+
     testfilter();
 
     testArray();
@@ -865,6 +926,14 @@ int main(int argc, char* argv[]) {
     testuint128();
 
     testQueue();
+    testRadixSort();
+    testParticleSystem();
+    testBoundedThreadsafeQueue();
+    testNetwork();
+    testSurfaceBoundsCache();
+    testOcclusionCuller();
+    testInstancedTriTree();
+    testCPUVertexArray();
 
     testMeshAlgTangentSpace();
 
@@ -881,7 +950,12 @@ int main(int argc, char* argv[]) {
     testAABoxCollision();
     printf("  passed\n");
     testAdjacency();
+    testMeshAlgVertexCache();
     printf("  passed\n");
+    testBlockCompressedImage();
+    testImageFilter();
+    testVideoOutput();
+    testDeltaFrameEncoder();
     testWildcards();
     printf("  passed\n");
 
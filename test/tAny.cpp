@@ -306,11 +306,134 @@ static void testTableReader() {
     testAssert(b == false);
 }
 
+
+/** Parses with G3D::TextInput, bypassing the fast path of Any::parse */
+static Any parseWithTextInput(const String& src) {
+    TextInput::Settings settings;
+    settings.cppBlockComments = true;
+    settings.cppLineComments = true;
+    settings.otherLineComments = false;
+    settings.generateCommentTokens = true;
+    settings.singleQuotedStrings = false;
+    settings.msvcFloatSpecials = true;
+    settings.caseSensitive = false;
+
+    TextInput ti(TextInput::FROM_STRING, src, settings);
+    Any a;
+    a.deserialize(ti);
+    return a;
+}
+
+
+static void testFastParse() {
+    const String& src = 
+        "// Scene\n"
+        "Scene {\r\n"
+        "    /* Block\n comment */\n"
+        "    name = \"Tab\\there\";\n"
+        "    hex = 0x1F;\n"
+        "    numbers = [ -1, +2.5, 1e-3, .5, 7, inf ];\n"
+        "    x = nan;\n"
+        "    frame = CFrame::fromXYZYPRDegrees(0, 1, 2, 45);\n"
+        "    nil = None;\n"
+        "    flags = (true, false, identifier);\n"
+        "    empty = Table { };\n"
+        "};";
+
+    Any fast = Any::parse(src);
+    Any slow = parseWithTextInput(src);
+
+    // NaN never compares equal, so check it separately from the rest of the table
+    testAssert(isNaN(fast["x"].number()));
+    testAssert(isNaN(slow["x"].number()));
+    fast.remove("x");
+    slow.remove("x");
+
+    testAssert(fast == slow);
+    testAssert(fast.unparse() == slow.unparse());
+    testAssert(fast.comment() == slow.comment());
+    testAssert(fast["numbers"][1].source().line == slow["numbers"][1].source().line);
+    testAssert(fast["numbers"][1].source().character == slow["numbers"][1].source().character);
+    testAssert(fast["frame"].name() == "CFrame::fromXYZYPRDegrees");
+    testAssert(fast["hex"].number() == 31);
+
+    // Errors are reported by the TextInput parser
+    bool threw = false;
+    try {
+        Any::parse("{ a = 1; b = ");
+    } catch (const ParseError&) {
+        threw = true;
+    }
+    testAssertM(threw, "Incomplete input did not throw");
+}
+
+
+static void testBinarySerialize() {
+    Any a;
+    a.load("Any-load.txt");
+
+    {
+        // The text-based version 1 encoding that earlier versions of G3D read
+        BinaryOutput out("<memory>", G3D_LITTLE_ENDIAN);
+        a.serialize(out);
+
+        BinaryInput in(out.getCArray(), out.size(), G3D_LITTLE_ENDIAN);
+        testAssert(in.readInt32() == 1);
+        in.setPosition(0);
+        Any b;
+        b.deserialize(in);
+        testAssert(in.getPosition() == in.size());
+        testAssert(a == b);
+        testAssert(a.unparse() == b.unparse());
+    }
+
+    {
+        // The compact encoding also preserves source locations
+        BinaryOutput out("<memory>", G3D_LITTLE_ENDIAN);
+        a.serializeCompact(out);
+
+        BinaryInput in(out.getCArray(), out.size(), G3D_LITTLE_ENDIAN);
+        testAssert(in.readInt32() == 2);
+        in.setPosition(0);
+        Any b;
+        b.deserialize(in);
+        testAssert(in.getPosition() == in.size());
+        testAssert(a == b);
+        testAssert(a.unparse() == b.unparse());
+        testAssert(a.source().filename == b.source().filename);
+    }
+}
+
+
+static void testDiskCache() {
+    const String directory = FilePath::concat(FileSystem::currentDirectory(), "any-cache-test");
+    Any::setDiskCacheDirectory(directory);
+    FileSystem::removeFile(FilePath::concat(directory, "*.AnyCache"));
+
+    Any source;
+    source.load("Any-load.txt");
+    Array<String> files;
+    FileSystem::getFiles(FilePath::concat(directory, "*.AnyCache"), files);
+    testAssertM(files.size() == 1, "No cache file was written");
+
+    Any cached;
+    cached.load("Any-load.txt");
+    testAssert(cached == source);
+    testAssert(cached.unparse() == source.unparse());
+
+    FileSystem::removeFile(FilePath::concat(directory, "*.AnyCache"));
+    Any::setDiskCacheDirectory("");
+}
+
+
 void testAny() {
 
     printf("G3D::Any ");
     testTableReader();
     testParse();
+    testFastParse();
+    testBinarySerialize();
+    testDiskCache();
 
     testRefCount1();
     testRefCount2();
@@ -363,3 +486,71 @@ void testAny() {
     printf("passed\n");
 
 };    // void testAny()
+
+
+void perfAny() {
+    printf("Any, scene file of 40000 entities:\n");
+
+    // A synthetic scene that resembles real ones, written to disk
+    const String filename = "Any-perf.Scene.Any";
+    String src = "// Generated\n{\n    name = \"Perf\";\n    entities = {\n";
+    Random rnd(1, false);
+    for (int i = 0; i < 40000; ++i) {
+        src += format("        entity%d = VisibleEntity {\n"
+                      "            model = \"model%d\";\n"
+                      "            frame = CFrame::fromXYZYPRDegrees(%g, %g, %g, %g, 0, 0);\n"
+                      "            canChange = false;\n"
+                      "            // Override\n"
+                      "            material = UniversalMaterial::Specification { lambertian = Color3(%g, %g, %g); };\n"
+                      "            track = PhysicsFrameSpline { control = ( Point3(%g, 0, 1), Point3(2, %g, 3) ); };\n"
+                      "        };\n",
+                      i, i % 50, rnd.uniform(-100, 100), rnd.uniform(0, 10), rnd.uniform(-100, 100), rnd.uniform(0, 360),
+                      rnd.uniform(), rnd.uniform(), rnd.uniform(), rnd.uniform(), rnd.uniform());
+    }
+    src += "    };\n}\n";
+    writeWholeFile(filename, src);
+
+    TextInput::Settings settings;
+    settings.cppBlockComments = true;
+    settings.cppLineComments = true;
+    settings.otherLineComments = false;
+    settings.generateCommentTokens = true;
+    settings.singleQuotedStrings = false;
+    settings.msvcFloatSpecials = true;
+    settings.caseSensitive = false;
+
+    const String directory = FilePath::concat(FileSystem::currentDirectory(), "any-cache-test");
+    RealTime textInputTime = finf(), scannerTime = finf(), cacheTime = finf();
+    for (int t = 0; t < 3; ++t) {
+        {
+            Any a;
+            RealTime start = System::time();
+            TextInput ti(filename, settings);
+            a.deserialize(ti);
+            textInputTime = min(textInputTime, System::time() - start);
+        }
+        {
+            Any a;
+            RealTime start = System::time();
+            a.load(filename);
+            scannerTime = min(scannerTime, System::time() - start);
+        }
+        {
+            // The first iteration fills the cache
+            Any::setDiskCacheDirectory(directory);
+            Any a;
+            RealTime start = System::time();
+            a.load(filename);
+            cacheTime = min(cacheTime, System::time() - start);
+            Any::setDiskCacheDirectory("");
+        }
+    }
+
+    FileSystem::removeFile(FilePath::concat(directory, "*.AnyCache"));
+    FileSystem::removeFile(filename);
+
+    printf("  %5.1f MB via TextInput:  %6.1f ms\n", src.size() / 1e6, textInputTime / units::milliseconds());
+    printf("  %5.1f MB via Any::load:  %6.1f ms\n", src.size() / 1e6, scannerTime / units::milliseconds());
+    printf("  %5.1f MB from the cache: %6.1f ms\n", src.size() / 1e6, cacheTime / units::milliseconds());
+    printf("\n");
+}
@@ -0,0 +1,95 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** Loads bypassing the in-memory cache */
+static shared_ptr<ArticulatedModel> loadModel(const ArticulatedModel::Specification& spec) {
+    ArticulatedModel::clearCache();
+    return ArticulatedModel::create(spec);
+}
+
+
+template<class T>
+static bool sameArray(const Array<T>& a, const Array<T>& b) {
+    return (a.size() == b.size()) && (memcmp(a.getCArray(), b.getCArray(), sizeof(T) * a.size()) == 0);
+}
+
+
+static int numCacheFiles(const String& directory) {
+    Array<String> files;
+    FileSystem::getFiles(FilePath::concat(directory, "*.ArticulatedModel"), files);
+    return files.size();
+}
+
+
+/** Requires a RenderDevice, because loading creates materials */
+void testArticulatedModelDiskCache() {
+    printf("ArticulatedModel disk cache ");
+
+    const String directory = FilePath::concat(FileSystem::currentDirectory(), "articulatedmodel-cache-test");
+    ArticulatedModel::setDiskCacheDirectory(directory);
+    FileSystem::removeFile(FilePath::concat(directory, "*.ArticulatedModel"));
+
+    ArticulatedModel::Specification spec;
+    spec.filename = System::findDataFile("cow.ifs");
+    spec.scale = 0.5f;
+
+    const shared_ptr<ArticulatedModel>& source = loadModel(spec);
+    testAssertM(numCacheFiles(directory) == 1, "No cache file was written");
+
+    const shared_ptr<ArticulatedModel>& cached = loadModel(spec);
+    testAssert(cached != source);
+
+    // The cached model matches the one built from the source
+    testAssert(cached->name() == source->name());
+    testAssert(cached->rootArray().size() == source->rootArray().size());
+    testAssert(cached->geometryArray().size() == source->geometryArray().size());
+    testAssert(cached->meshArray().size() == source->meshArray().size());
+    for (int g = 0; g < source->geometryArray().size(); ++g) {
+        const CPUVertexArray& a = source->geometryArray()[g]->cpuVertexArray;
+        const CPUVertexArray& b = cached->geometryArray()[g]->cpuVertexArray;
+        testAssert(a.size() == b.size());
+        testAssert(a.hasTangent == b.hasTangent);
+        testAssert(sameArray(a.vertex, b.vertex));
+        testAssert(source->geometryArray()[g]->boxBounds == cached->geometryArray()[g]->boxBounds);
+    }
+    for (int m = 0; m < source->meshArray().size(); ++m) {
+        const ArticulatedModel::Mesh* a = source->meshArray()[m];
+        const ArticulatedModel::Mesh* b = cached->meshArray()[m];
+        testAssert(a->name == b->name);
+        testAssert(sameArray(a->cpuIndexArray, b->cpuIndexArray));
+        testAssert(a->twoSided == b->twoSided);
+        testAssert(a->material == b->material);
+    }
+
+    // A different specification is a different file
+    spec.scale = 0.25f;
+    loadModel(spec);
+    testAssert(numCacheFiles(directory) == 2);
+
+    // Levels of detail are generated at load time and stored in the cache
+    spec.preprocess.append(ArticulatedModel::Instruction(Any::parse("generateLODs(all(), 3, 0.5)")));
+    const shared_ptr<ArticulatedModel>& lodSource = loadModel(spec);
+    const shared_ptr<ArticulatedModel>& lodCached = loadModel(spec);
+    testAssert(numCacheFiles(directory) == 3);
+    for (int m = 0; m < lodSource->meshArray().size(); ++m) {
+        const ArticulatedModel::Mesh* a = lodSource->meshArray()[m];
+        const ArticulatedModel::Mesh* b = lodCached->meshArray()[m];
+        testAssert(a->lodArray.size() > 0);
+        testAssert(a->lodArray.size() == b->lodArray.size());
+        for (int i = 0; i < a->lodArray.size(); ++i) {
+            const Array<int>& finer = (i == 0) ? a->cpuIndexArray : a->lodArray[i - 1].cpuIndexArray;
+            testAssert(a->lodArray[i].cpuIndexArray.size() < finer.size());
+            testAssert((i == 0) || (a->lodArray[i].error >= a->lodArray[i - 1].error));
+            testAssert(sameArray(a->lodArray[i].cpuIndexArray, b->lodArray[i].cpuIndexArray));
+            testAssert(a->lodArray[i].error == b->lodArray[i].error);
+        }
+        testAssert(a->levelOfDetail(-1.0f) == NULL);
+        testAssert(a->levelOfDetail(finf()) == &a->lodArray.last());
+    }
+
+    FileSystem::removeFile(FilePath::concat(directory, "*.ArticulatedModel"));
+    ArticulatedModel::setDiskCacheDirectory("");
+    ArticulatedModel::clearCache();
+
+    printf("passed\n");
+}
@@ -0,0 +1,77 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+static bool sameBytes(const shared_ptr<CPUPixelTransferBuffer>& a, const shared_ptr<CPUPixelTransferBuffer>& b) {
+    return (a->format() == b->format()) && (a->width() == b->width()) && (a->height() == b->height()) &&
+        (memcmp(a->buffer(), b->buffer(), a->size()) == 0);
+}
+
+
+static void testConcurrentDecode() {
+    static const char* filename[] = {"ImageTest/test-image.bmp", "ImageTest/test-image.png", "ImageTest/test-image.jpg", "ImageTest/test-image.tga"};
+    static const int N = 4;
+
+    std::atomic<int> numTransforms(0);
+    AsyncImageDecoder::Future future[N];
+    for (int i = 0; i < N; ++i) {
+        future[i] = AsyncImageDecoder::decode(filename[i], Texture::Preprocess::defaults(), [&numTransforms](const shared_ptr<Image>& image) {
+            ++numTransforms;
+        });
+    }
+
+    for (int i = 0; i < N; ++i) {
+        const shared_ptr<CPUPixelTransferBuffer>& expected = Image::fromFile(filename[i])->toPixelTransferBuffer();
+        testAssert(sameBytes(future[i].get(), expected));
+    }
+    testAssert(numTransforms == N);
+}
+
+
+static void testPreprocess() {
+    Texture::Preprocess preprocess;
+    preprocess.modulate = Color4(0.5f, 0.5f, 0.5f, 1.0f);
+    preprocess.computeNormalMap = true;
+
+    const shared_ptr<CPUPixelTransferBuffer>& original = Image::fromFile("ImageTest/test-image.png")->toPixelTransferBuffer();
+    const shared_ptr<CPUPixelTransferBuffer>& darkened = AsyncImageDecoder::decode("ImageTest/test-image.png", preprocess).get();
+    testAssert(original->format() == ImageFormat::RGB8());
+    testAssert(darkened->size() == original->size());
+
+    const uint8* a = static_cast<const uint8*>(original->buffer());
+    const uint8* b = static_cast<const uint8*>(darkened->buffer());
+    for (int i = 0; i < int(original->size()); ++i) {
+        testAssert(abs(int(b[i]) - int(a[i]) / 2) <= 1);
+    }
+
+    // Only the adjustments that decode() does not apply remain
+    const Texture::Preprocess& remaining = AsyncImageDecoder::remainingPreprocess(preprocess);
+    testAssert(remaining.modulate == Color4::one());
+    testAssert(remaining.gammaAdjust == 1.0f);
+    testAssert(remaining.computeNormalMap);
+
+    // Formats that cannot be adjusted are left alone
+    const shared_ptr<CPUPixelTransferBuffer>& hdr = CPUPixelTransferBuffer::create(2, 2, ImageFormat::RGBA32F());
+    testAssert(! AsyncImageDecoder::applyPreprocess(preprocess, hdr));
+    testAssert(AsyncImageDecoder::applyPreprocess(Texture::Preprocess::defaults(), hdr));
+}
+
+
+static void testMissingFile() {
+    const AsyncImageDecoder::Future& future = AsyncImageDecoder::decode("ImageTest/does-not-exist.png");
+    bool threw = false;
+    try {
+        future.get();
+    } catch (...) {
+        threw = true;
+    }
+    testAssert(threw);
+}
+
+
+void testAsyncImageDecoder() {
+    printf("AsyncImageDecoder ");
+    testConcurrentDecode();
+    testPreprocess();
+    testMissingFile();
+    printf("passed\n");
+}
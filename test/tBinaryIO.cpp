@@ -40,6 +40,31 @@ void testHugeBinaryIO() {
         }
     }
 
+    printf("BinaryOutput Large Block-Compressed Files\n");
+
+    // Large enough to stream compressed blocks to disk while writing
+    for (size_t i = 0; i < stepSize; ++i) {
+        giantBuffer[i] = uint8(i * 7 + (i >> 12));
+    }
+
+    {
+        BinaryOutput b("huge.bin", G3D_LITTLE_ENDIAN);
+        b.setBlockCompression(1);
+        for (int i = 0; i < (int)testSize / (int)stepSize; ++i) {
+            b.writeBytes(giantBuffer, (int)stepSize);
+        }
+        b.commit();
+    }
+
+    {
+        BinaryInput b("huge.bin", G3D_LITTLE_ENDIAN, true);
+        testAssert(b.size() == (int64)testSize);
+        b.setPosition(testSize - stepSize + 1000);
+        testAssert(b.readUInt8() == giantBuffer[1000]);
+        b.setPosition(3);
+        testAssert(b.readUInt8() == giantBuffer[3]);
+    }
+
     delete giantBuffer;
 
 	if (FileSystem::exists("huge.bin", false)) {
@@ -170,6 +195,117 @@ static void testCompression() {
 }
 
 
+static void testBlockCompression() {
+    printf("BinaryOutput::setBlockCompression\n");
+
+    // Several blocks plus a partial one, with compressible and incompressible regions
+    const int N = 300000;
+    const int blockSize = 64 * 1024;
+
+    for (int target = 0; target < 2; ++target) {
+        const String filename = (target == 0) ? "<memory>" : "outBlocks.t";
+        BinaryOutput f(filename, G3D_BIG_ENDIAN);
+        f.setBlockCompression(6, blockSize);
+        Random rng(10, false);
+        for (int i = 0; i < N; ++i) {
+            f.writeUInt32(i);
+            f.writeUInt8((i & 1) ? uint8(rng.integer(0, 255)) : 7);
+        }
+        f.commit();
+
+        shared_ptr<BinaryInput> g;
+        if (target == 0) {
+            g = std::make_shared<BinaryInput>(f.getCArray(), f.size(), G3D_BIG_ENDIAN, true);
+        } else {
+            g = std::make_shared<BinaryInput>(filename, G3D_BIG_ENDIAN, true);
+        }
+        testAssert(g->size() == N * 5);
+
+        rng.reset(10, false);
+        for (int i = 0; i < N; ++i) {
+            testAssert(g->readUInt32() == uint32(i));
+            testAssert(g->readUInt8() == ((i & 1) ? uint8(rng.integer(0, 255)) : 7));
+        }
+
+        // Random access across block boundaries
+        g->setPosition(5 * (N / 2));
+        testAssert(g->readUInt32() == uint32(N / 2));
+        g->setPosition(5 * 7);
+        testAssert(g->readUInt32() == 7);
+    }
+}
+
+
+/** Payload byte of record \a i in testBlockCompressionStreaming */
+static uint8 streamingRecordByte(int i) {
+    return (i & 1) ? uint8((uint32(i) * 2654435761u) >> 24) : 7;
+}
+
+
+/** Uses blocks small enough that the writer streams blocks to disk several times and the
+    reader holds only a window of the file, so that seeks move the window in both directions. */
+static void testBlockCompressionStreaming() {
+    printf("BinaryOutput::setBlockCompression streaming\n");
+
+    const int N = 50000;
+    const int blockSize = 1024;
+    const int overwritten = N - 1000;
+    const String filename = "outBlocksStreaming.t";
+    FileSystem::removeFile(filename);
+
+    {
+        BinaryOutput f(filename, G3D_LITTLE_ENDIAN);
+        f.setBlockCompression(6, blockSize);
+        for (int i = 0; i < N; ++i) {
+            f.writeUInt32(i);
+            f.writeUInt8(streamingRecordByte(i));
+        }
+
+        // Full blocks were already streamed to disk
+        FileSystem::clearCache();
+        testAssert(FileSystem::exists(filename));
+
+        // Seek backwards within the blocks still in memory
+        const int64 end = f.position();
+        f.setPosition(5 * overwritten);
+        f.writeUInt32(0xFFFFFFFF);
+        f.setPosition(end);
+        f.commit();
+    }
+
+    BinaryInput g(filename, G3D_LITTLE_ENDIAN, true);
+    testAssert(g.size() == N * 5);
+
+    for (int i = 0; i < N; ++i) {
+        testAssert(g.readUInt32() == ((i == overwritten) ? 0xFFFFFFFF : uint32(i)));
+        testAssert(g.readUInt8() == streamingRecordByte(i));
+    }
+
+    // Seek backwards and forwards across blocks and windows, including reads that straddle
+    // a block boundary
+    const int record[] = {N - 1, 3, N / 2, 204, N - 3, 1, N / 4, 3 * N / 4};
+    for (int r = 0; r < 8; ++r) {
+        const int i = record[r];
+        g.setPosition(5 * i);
+        testAssert(g.readUInt32() == uint32(i));
+        testAssert(g.readUInt8() == streamingRecordByte(i));
+    }
+
+    // A read larger than the decompression window
+    Array<uint8> bytes;
+    bytes.resize(200 * blockSize);
+    g.setPosition(5 * 100);
+    g.readBytes(bytes.getCArray(), bytes.size());
+    for (int i = 100; i < 100 + bytes.size() / 5; ++i) {
+        const uint8* p = bytes.getCArray() + 5 * (i - 100);
+        testAssert((p[0] | (p[1] << 8) | (p[2] << 16) | (uint32(p[3]) << 24)) == uint32(i));
+        testAssert(p[4] == streamingRecordByte(i));
+    }
+
+    FileSystem::removeFile(filename);
+}
+
+
 static void measureSerializerPerformance() {
     Array<uint8> x;
     x.resize(1024);
@@ -409,4 +545,6 @@ void testBinaryIO() {
     testBasicSerialization();
     testBitSerialization();
     testCompression();
+    testBlockCompression();
+    testBlockCompressionStreaming();
 }
@@ -0,0 +1,153 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** Smooth gradients with a noisy band and a hard-edged alpha disk, so that every format
+    sees both easy and difficult blocks. The size is deliberately not a multiple of 4. */
+static shared_ptr<CPUPixelTransferBuffer> makeTestImage(int width, int height) {
+    const shared_ptr<CPUPixelTransferBuffer>& im = CPUPixelTransferBuffer::create(width, height, ImageFormat::RGBA8());
+    uint8* p = static_cast<uint8*>(im->buffer());
+    Random rnd(7, false);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x, p += 4) {
+            const float u = float(x) / float(width), v = float(y) / float(height);
+            const int noise = (y > height / 2) && (y < 3 * height / 4) ? rnd.integer(-24, 24) : 0;
+            p[0] = uint8(iClamp(iRound(255.0f * u) + noise, 0, 255));
+            p[1] = uint8(iClamp(iRound(255.0f * v) - noise, 0, 255));
+            p[2] = uint8(iClamp(iRound(128.0f + 100.0f * sin(10.0f * u * v)) + noise, 0, 255));
+            p[3] = (square(u - 0.5f) + square(v - 0.5f) < 0.1f) ? 255 : uint8(iRound(64.0f * u));
+        }
+    }
+    return im;
+}
+
+
+static float psnrOf(const shared_ptr<BlockCompressedImage>& im, const shared_ptr<CPUPixelTransferBuffer>& src, int numChannels) {
+    const shared_ptr<CPUPixelTransferBuffer>& decoded = im->decompress();
+    const uint8* a = static_cast<const uint8*>(src->buffer());
+    const uint8* b = static_cast<const uint8*>(decoded->buffer());
+    double sum = 0.0;
+    for (int i = 0; i < src->width() * src->height(); ++i) {
+        for (int c = 0; c < numChannels; ++c) {
+            sum += square(double(a[4 * i + c]) - double(b[4 * i + c]));
+        }
+    }
+    const double mse = sum / (double(src->width() * src->height()) * numChannels);
+    return (mse == 0.0) ? finf() : float(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+
+static void testQuality() {
+    const shared_ptr<CPUPixelTransferBuffer>& src = makeTestImage(66, 43);
+
+    static const struct {
+        const ImageFormat*  format;
+        int                 numChannels;
+        float               minPSNR;
+    } test[] = {
+        {ImageFormat::RGB_DXT1(),  3, 32.0f},
+        {ImageFormat::RGBA_DXT3(), 4, 32.5f},
+        {ImageFormat::RGBA_DXT5(), 4, 33.0f},
+        {ImageFormat::R_BC4(),     1, 46.0f},
+        {ImageFormat::RG_BC5(),    2, 46.0f},
+        // Mode 6 fits color and alpha with one line, which the alpha edge defeats
+        {ImageFormat::RGBA_BC7(),  4, 31.0f}};
+
+    for (int i = 0; i < int(sizeof(test) / sizeof(test[0])); ++i) {
+        float previous = 0.0f;
+        for (int q = 0; q < 3; ++q) {
+            const CompressionQuality quality = CompressionQuality(CompressionQuality::Value(q));
+            const shared_ptr<BlockCompressedImage>& im = BlockCompressedImage::fromPixelTransferBuffer(src, BlockCompressedImage::Settings(test[i].format, quality));
+            testAssert(im->format() == test[i].format);
+
+            // The reported PSNR is measured on the stored channels
+            const float psnr = psnrOf(im, src, test[i].numChannels);
+            testAssert(abs(psnr - im->psnr()) < 0.01f);
+            testAssertM(psnr >= test[i].minPSNR, test[i].format->name() + " at " + quality.toString());
+
+            // Slower settings never do noticeably worse
+            testAssert(psnr >= previous - 0.1f);
+            previous = psnr;
+        }
+    }
+}
+
+
+static void testMipMaps() {
+    const shared_ptr<CPUPixelTransferBuffer>& src = makeTestImage(66, 43);
+    const shared_ptr<BlockCompressedImage>& im = BlockCompressedImage::fromPixelTransferBuffer(src, BlockCompressedImage::Settings(ImageFormat::RGBA_DXT1(), CompressionQuality::FAST));
+
+    testAssert(im->numMipLevels() == 7);
+    testAssert((im->mipLevel(1).width == 33) && (im->mipLevel(1).height == 21));
+    testAssert((im->mipLevel(6).width == 1) && (im->mipLevel(6).height == 1));
+    testAssert(im->mipLevel(0).data.size() == 17 * 11 * 8);
+    testAssert(im->mipLevel(6).data.size() == 8);
+
+    // Transparent texels survive the three-color mode
+    const shared_ptr<CPUPixelTransferBuffer>& decoded = im->decompress();
+    const uint8* a = static_cast<const uint8*>(src->buffer());
+    const uint8* b = static_cast<const uint8*>(decoded->buffer());
+    for (int i = 0; i < src->width() * src->height(); ++i) {
+        testAssert((a[4 * i + 3] >= 128) == (b[4 * i + 3] == 255));
+    }
+
+    BlockCompressedImage::Settings settings(ImageFormat::R_BC4(), CompressionQuality::FAST);
+    settings.generateMipMaps = false;
+    testAssert(BlockCompressedImage::fromPixelTransferBuffer(src, settings)->numMipLevels() == 1);
+}
+
+
+static void testDDS() {
+    const shared_ptr<CPUPixelTransferBuffer>& src = makeTestImage(32, 20);
+    const ImageFormat* format[] = {ImageFormat::RGBA_DXT1(), ImageFormat::RGBA_DXT5(), ImageFormat::SRGBA_DXT5(), ImageFormat::RG_BC5(), ImageFormat::SRGBA_BC7()};
+
+    for (int i = 0; i < int(sizeof(format) / sizeof(format[0])); ++i) {
+        const shared_ptr<BlockCompressedImage>& im = BlockCompressedImage::fromPixelTransferBuffer(src, BlockCompressedImage::Settings(format[i], CompressionQuality::FAST));
+        im->save("test.dds");
+        const shared_ptr<BlockCompressedImage>& loaded = BlockCompressedImage::fromDDSFile("test.dds");
+
+        testAssert(loaded->format() == im->format());
+        testAssert(loaded->psnr() == im->psnr());
+        testAssert(loaded->numMipLevels() == im->numMipLevels());
+        for (int m = 0; m < im->numMipLevels(); ++m) {
+            const Array<uint8>& a = im->mipLevel(m).data;
+            const Array<uint8>& b = loaded->mipLevel(m).data;
+            testAssert((a.size() == b.size()) && (memcmp(a.getCArray(), b.getCArray(), a.size()) == 0));
+        }
+    }
+    FileSystem::removeFile("test.dds");
+
+    BlockCompressedImage::Settings settings(ImageFormat::SRGBA_BC7(), CompressionQuality::BEST);
+    settings.generateMipMaps = false;
+    const BlockCompressedImage::Settings copy(settings.toAny());
+    testAssert((copy.format == settings.format) && (copy.quality == settings.quality) && ! copy.generateMipMaps);
+    testAssert(BlockCompressedImage::cacheFilename("data/brick.png", settings) == "data/brick.SRGBA_BC7.BEST.nomip.dds");
+}
+
+
+void testBlockCompressedImage() {
+    printf("BlockCompressedImage ");
+    testMipMaps();
+    testQuality();
+    testDDS();
+    printf("passed\n");
+}
+
+
+void perfBlockCompressedImage() {
+    printf("BlockCompressedImage, 1024x1024 without mipmaps:\n");
+    const shared_ptr<CPUPixelTransferBuffer>& src = makeTestImage(1024, 1024);
+    const ImageFormat* format[] = {ImageFormat::RGB_DXT1(), ImageFormat::RGBA_DXT5(), ImageFormat::RG_BC5(), ImageFormat::RGBA_BC7()};
+
+    for (int i = 0; i < int(sizeof(format) / sizeof(format[0])); ++i) {
+        for (int q = 0; q < 3; ++q) {
+            BlockCompressedImage::Settings settings(format[i], CompressionQuality(CompressionQuality::Value(q)));
+            settings.generateMipMaps = false;
+            const RealTime start = System::time();
+            const shared_ptr<BlockCompressedImage>& im = BlockCompressedImage::fromPixelTransferBuffer(src, settings);
+            const RealTime elapsed = System::time() - start;
+            printf("  %-9s %-6s %6.2f dB  %7.1f MPixel/s\n", format[i]->name().c_str(), settings.quality.toString(),
+                   im->psnr(), 1024.0 * 1024.0 / (elapsed * 1e6));
+        }
+    }
+    printf("\n");
+}
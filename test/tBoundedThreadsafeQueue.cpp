@@ -0,0 +1,183 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <thread>
+#include <atomic>
+
+/** Each of numProducers threads pushes the values [p * perProducer, (p + 1) * perProducer) and
+    the consumers check that every value arrives exactly once and that each producer's values
+    arrive in order. */
+static void testContention(int numProducers, int numConsumers, int capacity, int batchSize) {
+    const int perProducer = 100000;
+    BoundedThreadsafeQueue<int> queue(capacity);
+
+    Array<uint8> count;
+    count.resize(numProducers * perProducer);
+    System::memset(count.getCArray(), 0, count.size());
+    std::atomic<int> received(0);
+    std::atomic<bool> outOfOrder(false);
+
+    std::vector<std::thread> thread;
+    for (int p = 0; p < numProducers; ++p) {
+        thread.push_back(std::thread([&, p]() {
+            Array<int> batch;
+            for (int i = 0; i < perProducer; i += batchSize) {
+                batch.fastClear();
+                for (int j = i; j < min(perProducer, i + batchSize); ++j) {
+                    batch.append(p * perProducer + j);
+                }
+                if (batchSize == 1) {
+                    queue.pushBack(batch[0]);
+                } else {
+                    queue.pushBack(batch.getCArray(), batch.size());
+                }
+            }
+        }));
+    }
+
+    for (int c = 0; c < numConsumers; ++c) {
+        thread.push_back(std::thread([&]() {
+            Array<int> last;
+            last.resize(numProducers);
+            for (int i = 0; i < numProducers; ++i) {
+                last[i] = -1;
+            }
+            Array<int> batch;
+            batch.resize(batchSize);
+            while (received.load() < numProducers * perProducer) {
+                const int n = queue.popFront(batch.getCArray(), batchSize, 0.01);
+                for (int i = 0; i < n; ++i) {
+                    const int v = batch[i];
+                    const int p = v / perProducer;
+                    if (v <= last[p]) {
+                        outOfOrder = true;
+                    }
+                    last[p] = v;
+                    ++count[v];
+                }
+                received += n;
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < thread.size(); ++i) {
+        thread[i].join();
+    }
+
+    testAssertM(! outOfOrder.load(), "Values from one producer were reordered");
+    testAssert(queue.empty());
+    for (int i = 0; i < count.size(); ++i) {
+        testAssertM(count[i] == 1, format("Value %d received %d times", i, count[i]));
+    }
+}
+
+
+void testBoundedThreadsafeQueue() {
+    printf("BoundedThreadsafeQueue ");
+
+    {
+        BoundedThreadsafeQueue<int> q(5);
+        testAssert(q.capacity() == 8);
+        testAssert(q.empty());
+
+        for (int i = 0; i < 8; ++i) {
+            testAssert(q.tryPushBack(i));
+        }
+        testAssertM(! q.tryPushBack(8), "Pushed to a full queue");
+        testAssert(q.size() == 8);
+        testAssertM(! q.pushBack(8, 0.001), "Blocking push to a full queue did not time out");
+
+        int v = -1;
+        for (int i = 0; i < 8; ++i) {
+            testAssert(q.tryPopFront(v));
+            testAssert(v == i);
+        }
+        testAssertM(! q.tryPopFront(v), "Popped from an empty queue");
+        testAssertM(! q.popFront(v, 0.001), "Blocking pop from an empty queue did not time out");
+
+        // Batches that wrap around the ring
+        int in[6] = {10, 11, 12, 13, 14, 15};
+        int out[8];
+        for (int pass = 0; pass < 5; ++pass) {
+            testAssert(q.tryPushBack(in, 6) == 6);
+            testAssert(q.tryPushBack(in, 6) == 2);
+            testAssert(q.tryPopFront(out, 8) == 8);
+            testAssert(out[0] == 10 && out[5] == 15 && out[6] == 10 && out[7] == 11);
+            testAssert(q.empty());
+        }
+    }
+
+    testContention(1, 1, 64, 1);
+    testContention(4, 4, 64, 1);
+    testContention(4, 4, 256, 16);
+    testContention(3, 1, 16, 7);
+
+    printf("passed\n");
+}
+
+
+/** Producer/consumer throughput under contention */
+template<class PushPop>
+static RealTime timeContention(int numProducers, int numConsumers, int perProducer, const PushPop& pushPop) {
+    std::atomic<int> received(0);
+    const int total = numProducers * perProducer;
+    std::vector<std::thread> thread;
+
+    const RealTime start = System::time();
+    for (int p = 0; p < numProducers; ++p) {
+        thread.push_back(std::thread([&]() {
+            for (int i = 0; i < perProducer; ++i) {
+                pushPop.push(i);
+            }
+        }));
+    }
+    for (int c = 0; c < numConsumers; ++c) {
+        thread.push_back(std::thread([&]() {
+            while (received.load(std::memory_order_relaxed) < total) {
+                if (pushPop.pop()) {
+                    ++received;
+                }
+            }
+        }));
+    }
+    for (size_t i = 0; i < thread.size(); ++i) {
+        thread[i].join();
+    }
+    return System::time() - start;
+}
+
+
+namespace {
+class SpinlockQueueOps {
+public:
+    mutable ThreadsafeQueue<int> queue;
+    void push(int i) const { queue.pushBack(i); }
+    bool pop() const { int v; return queue.popFront(v); }
+};
+
+class BoundedQueueOps {
+public:
+    mutable BoundedThreadsafeQueue<int> queue;
+    BoundedQueueOps() : queue(4096) {}
+    void push(int i) const { queue.pushBack(i); }
+    bool pop() const { int v; return queue.popFront(v, 0.001); }
+};
+}
+
+
+void perfBoundedThreadsafeQueue() {
+    printf("ThreadsafeQueue vs. BoundedThreadsafeQueue contention (M elements/s):\n");
+    const int perProducer = 500000;
+    const int config[][2] = {{1, 1}, {2, 2}, {4, 4}, {8, 1}};
+
+    for (int c = 0; c < 4; ++c) {
+        const int p = config[c][0], n = config[c][1];
+        SpinlockQueueOps spin;
+        BoundedQueueOps bounded;
+        const RealTime spinTime    = timeContention(p, n, perProducer, spin);
+        const RealTime boundedTime = timeContention(p, n, perProducer, bounded);
+        const double M = p * perProducer / 1.0e6;
+        printf("  %d producers, %d consumers:  ThreadsafeQueue %6.2f   BoundedThreadsafeQueue %6.2f\n",
+               p, n, M / spinTime, M / boundedTime);
+    }
+    printf("\n");
+}
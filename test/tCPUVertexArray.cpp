@@ -0,0 +1,90 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** Random vertices, each influenced by four random bones with weights that sum to one */
+static void makeSkinnedArray(int numVertices, int numBones, Random& rnd, CPUVertexArray& va) {
+    va.clear();
+    va.hasBones = true;
+    for (int i = 0; i < numVertices; ++i) {
+        CPUVertexArray::Vertex& v = va.vertex.next();
+        v.position  = Point3(rnd.uniform(-10, 10), rnd.uniform(-10, 10), rnd.uniform(-10, 10));
+        v.normal    = Vector3::random(rnd);
+        v.tangent   = Vector4(v.normal.cross(Vector3::random(rnd)).directionOrZero(), rnd.uniform() < 0.5f ? -1.0f : 1.0f);
+        v.texCoord0 = Point2(rnd.uniform(), rnd.uniform());
+
+        Vector4 weight(rnd.uniform(), rnd.uniform(), rnd.uniform(), rnd.uniform());
+        weight /= weight.x + weight.y + weight.z + weight.w;
+        va.boneWeights.append(weight);
+        va.boneIndices.append(Vector4int32(rnd.integer(0, numBones - 1), rnd.integer(0, numBones - 1),
+                                           rnd.integer(0, numBones - 1), rnd.integer(0, numBones - 1)));
+    }
+}
+
+
+/** Scalar linear blend skinning of vertex \a i */
+static void referenceSkin(const CPUVertexArray& va, const Array<CFrame>& boneFrame, int i, CPUVertexArray::Vertex& result) {
+    Matrix3 R = Matrix3::zero();
+    Vector3 T = Vector3::zero();
+    for (int b = 0; b < 4; ++b) {
+        const CFrame& frame = boneFrame[va.boneIndices[i][b]];
+        const float w = va.boneWeights[i][b];
+        R += frame.rotation * w;
+        T += frame.translation * w;
+    }
+
+    const CPUVertexArray::Vertex& v = va.vertex[i];
+    result.position = R * v.position + T;
+    result.normal   = (R * v.normal).directionOrZero();
+    result.tangent  = Vector4((R * v.tangent.xyz()).directionOrZero(), v.tangent.w);
+}
+
+
+static void testSkin() {
+    Random rnd(7, false);
+
+    Array<CFrame> boneFrame;
+    for (int b = 0; b < 13; ++b) {
+        boneFrame.append(CFrame::fromXYZYPRDegrees(rnd.uniform(-5, 5), rnd.uniform(-5, 5), rnd.uniform(-5, 5),
+                                                   rnd.uniform(0, 360), rnd.uniform(-90, 90), rnd.uniform(0, 360)));
+    }
+
+    // Sizes that are not multiples of the SIMD width, and that span more than one parallel task
+    const int numVertices[] = {1, 3, 7, 9, 17, 2049, 5003};
+    for (int n = 0; n < int(sizeof(numVertices) / sizeof(numVertices[0])); ++n) {
+        CPUVertexArray va;
+        makeSkinnedArray(numVertices[n], boneFrame.size(), rnd, va);
+
+        for (int pass = 0; pass < 2; ++pass) {
+            const bool allowAVX = (pass == 1);
+            if (allowAVX && ! System::hasAVX()) {
+                continue;
+            }
+
+            CPUVertexArray dst;
+            va.skin(boneFrame, dst, allowAVX);
+            testAssert(dst.size() == va.size());
+            testAssert(! dst.hasBones);
+
+            // Reskinning into an array of the right size only rewrites the vertices
+            const Vector2 texCoord = dst.vertex[0].texCoord0;
+            va.skin(boneFrame, dst, allowAVX);
+            testAssert(dst.vertex[0].texCoord0 == texCoord);
+
+            for (int i = 0; i < va.size(); ++i) {
+                CPUVertexArray::Vertex expected;
+                referenceSkin(va, boneFrame, i, expected);
+                const CPUVertexArray::Vertex& actual = dst.vertex[i];
+                testAssertM((actual.position - expected.position).length() < 1e-4f, format("Skinned position differs at vertex %d of %d (%s)", i, va.size(), allowAVX ? "AVX" : "SSE"));
+                testAssertM((actual.normal - expected.normal).length() < 1e-4f, format("Skinned normal differs at vertex %d of %d (%s)", i, va.size(), allowAVX ? "AVX" : "SSE"));
+                testAssertM((actual.tangent - expected.tangent).length() < 1e-4f, format("Skinned tangent differs at vertex %d of %d (%s)", i, va.size(), allowAVX ? "AVX" : "SSE"));
+            }
+        }
+    }
+}
+
+
+void testCPUVertexArray() {
+    printf("CPUVertexArray ");
+    testSkin();
+    printf("passed\n");
+}
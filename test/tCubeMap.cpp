@@ -0,0 +1,159 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+
+static float maxDifference(const Color3& a, const Color3& b) {
+    const Color3& d = a - b;
+    return max(fabsf(d.r), fabsf(d.g), fabsf(d.b));
+}
+
+
+static shared_ptr<CubeMap> makeCubeMap(int size, bool constant) {
+    Array<shared_ptr<Image3>> face;
+    for (int f = 0; f < 6; ++f) {
+        const shared_ptr<Image3>& image = Image3::createEmpty(size, size, WrapMode::CLAMP);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                image->set(x, y, constant ? Color3(0.25f, 0.5f, 1.0f) : Color3(float(f) / 5.0f, float(x) / float(size), float(y) / float(size)));
+            }
+        }
+        face.append(image);
+    }
+    return CubeMap::create(face);
+}
+
+
+static void testCubeMapConstant() {
+    const shared_ptr<CubeMap>& cube = makeCubeMap(32, true);
+    const Color3 expected(0.25f, 0.5f, 1.0f);
+
+    Random rnd(1, false);
+    Array<Vector3> v;
+    Array<float> lod, roughness;
+    for (int i = 0; i < 500; ++i) {
+        v.append(Vector3::random(rnd));
+        lod.append(rnd.uniform(0.0f, 6.0f));
+        roughness.append(rnd.uniform(0.0f, 1.0f));
+    }
+
+    Array<Color3> batch;
+    batch.resize(v.size());
+    cube->trilinear(v.getCArray(), lod.getCArray(), batch.getCArray(), v.size());
+    for (int i = 0; i < v.size(); ++i) {
+        testAssertM(maxDifference(cube->trilinear(v[i], lod[i]), expected) < 1e-4f, "Trilinear changed a constant cube map");
+        testAssertM(maxDifference(batch[i], expected) < 1e-4f, "Batched trilinear changed a constant cube map");
+        testAssertM(maxDifference(cube->prefilteredGGX(v[i], roughness[i]), expected) < 1e-3f, "Prefiltered GGX changed a constant cube map");
+    }
+}
+
+
+static void testCubeMapFiltering() {
+    const shared_ptr<CubeMap>& cube = makeCubeMap(32, false);
+    testAssert(cube->numGGXLevels() > 1);
+
+    Random rnd(2, false);
+    Array<Vector3> v;
+    Array<float> lod, roughness;
+    for (int i = 0; i < 500; ++i) {
+        v.append(Vector3::random(rnd));
+        lod.append(rnd.uniform(0.0f, 6.0f));
+        roughness.append(rnd.uniform(0.0f, 1.0f));
+    }
+
+    Array<Color3> batch;
+    batch.resize(v.size());
+
+    // Batched lookups match the scalar ones
+    cube->bilinear(v.getCArray(), batch.getCArray(), v.size());
+    for (int i = 0; i < v.size(); ++i) {
+        testAssertM(maxDifference(cube->bilinear(v[i]), batch[i]) < 1e-5f, "Batched bilinear does not match bilinear");
+        testAssertM(maxDifference(cube->trilinear(v[i], 0.0f), batch[i]) < 1e-5f, "Trilinear level 0 does not match bilinear");
+    }
+
+    cube->trilinear(v.getCArray(), lod.getCArray(), batch.getCArray(), v.size());
+    for (int i = 0; i < v.size(); ++i) {
+        testAssertM(maxDifference(cube->trilinear(v[i], lod[i]), batch[i]) < 1e-5f, "Batched trilinear does not match trilinear");
+    }
+
+    cube->prefilteredGGX(v.getCArray(), roughness.getCArray(), batch.getCArray(), v.size());
+    for (int i = 0; i < v.size(); ++i) {
+        testAssertM(maxDifference(cube->prefilteredGGX(v[i], roughness[i]), batch[i]) < 1e-5f, "Batched prefilteredGGX does not match prefilteredGGX");
+
+        // A mirror reflection is unfiltered
+        testAssertM(maxDifference(cube->prefilteredGGX(v[i], 0.0f), cube->bilinear(v[i])) < 1e-5f, "Roughness 0 does not match bilinear");
+
+        // Filtering never leaves the range of the input
+        const Color3& rough = cube->prefilteredGGX(v[i], 1.0f);
+        testAssertM(rough.min() >= 0.0f && rough.max() <= 1.0f, "Prefiltered GGX is out of range");
+    }
+}
+
+
+static void testCubeMapFaceColors() {
+    // Each face is a different solid color. The borders copied from adjacent faces must
+    // not bleed into the interior of the coarse levels, and a non-power-of-two size 
+    // exercises the odd levels (24, 12, 6, 3, 1).
+    Array<shared_ptr<Image3>> face;
+    Array<Color3> color;
+    for (int f = 0; f < 6; ++f) {
+        color.append(Color3((f & 1) ? 1.0f : 0.0f, float(f / 2) * 0.5f, float(f) / 5.0f));
+        const shared_ptr<Image3>& image = Image3::createEmpty(24, 24, WrapMode::CLAMP);
+        for (int y = 0; y < image->height(); ++y) {
+            for (int x = 0; x < image->width(); ++x) {
+                image->set(x, y, color[f]);
+            }
+        }
+        face.append(image);
+    }
+    const shared_ptr<CubeMap>& cube = CubeMap::create(face);
+
+    for (int f = 0; f < 6; ++f) {
+        Vector3 center;
+        center[f / 2] = (f & 1) ? -1.0f : 1.0f;
+        for (float lod = 0.0f; lod <= 6.0f; lod += 0.5f) {
+            testAssertM(maxDifference(cube->trilinear(center, lod), color[f]) < 1e-5f, "Adjacent faces bled into the center of a face");
+        }
+    }
+}
+
+
+static void testCubeMapGradient() {
+    // Box filtering preserves a linear ramp, so away from the face edges every level must
+    // reproduce the level 0 value at the same point. This catches levels that are misaligned
+    // with level 0, for both power-of-two and odd level sizes.
+    const int size[] = {32, 24};
+    for (int s = 0; s < 2; ++s) {
+        Array<shared_ptr<Image3>> face;
+        for (int f = 0; f < 6; ++f) {
+            const shared_ptr<Image3>& image = Image3::createEmpty(size[s], size[s], WrapMode::CLAMP);
+            for (int y = 0; y < size[s]; ++y) {
+                for (int x = 0; x < size[s]; ++x) {
+                    image->set(x, y, Color3(float(f) / 5.0f, (float(x) + 0.5f) / float(size[s]), (float(y) + 0.5f) / float(size[s])));
+                }
+            }
+            face.append(image);
+        }
+        const shared_ptr<CubeMap>& cube = CubeMap::create(face);
+
+        Random rnd(3, false);
+        for (int i = 0; i < 200; ++i) {
+            // A direction through the middle of face i % 6
+            Vector3 v(rnd.uniform(-0.4f, 0.4f), rnd.uniform(-0.4f, 0.4f), rnd.uniform(-0.4f, 0.4f));
+            v[(i % 6) / 2] = (i & 1) ? -1.0f : 1.0f;
+            const Color3& expected = cube->bilinear(v);
+            for (float lod = 0.5f; lod <= 3.0f; lod += 0.5f) {
+                testAssertM(maxDifference(cube->trilinear(v, lod), expected) < 1e-4f, "A mip level is misaligned with level 0");
+            }
+        }
+    }
+}
+
+
+void testCubeMap() {
+    printf("CubeMap ");
+    testCubeMapConstant();
+    testCubeMapFiltering();
+    testCubeMapFaceColors();
+    testCubeMapGradient();
+    printf("passed\n");
+}
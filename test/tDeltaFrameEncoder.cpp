@@ -0,0 +1,149 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** Decodes the tiles of \a frame onto \a canvas, as the remoteRender viewer does, after a
+    round trip through Frame::serialize */
+static void applyFrame(const DeltaFrameEncoder::Frame& frame, const shared_ptr<CPUPixelTransferBuffer>& canvas) {
+    BinaryOutput bo("<memory>", G3D_BIG_ENDIAN);
+    frame.serialize(bo);
+    BinaryInput bi(bo.getCArray(), bo.size(), G3D_BIG_ENDIAN);
+
+    testAssert(bi.readInt32() == canvas->width());
+    testAssert(bi.readInt32() == canvas->height());
+    testAssert(bi.readInt32() == frame.index);
+    testAssert((bi.readUInt8() != 0) == frame.keyframe);
+    const int numTiles = bi.readInt32();
+    testAssert(numTiles == frame.tiles.size());
+
+    const int bytesPerPixel = canvas->format()->cpuBitsPerPixel / 8;
+    for (int t = 0; t < numTiles; ++t) {
+        const int x = bi.readInt32();
+        const int y = bi.readInt32();
+        const int width = bi.readInt32();
+        const int height = bi.readInt32();
+        const int size = bi.readInt32();
+
+        BinaryInput tileInput(bi.getCArray() + bi.getPosition(), size, G3D_LITTLE_ENDIAN);
+        bi.skip(size);
+        const shared_ptr<CPUPixelTransferBuffer>& tile = Image::fromBinaryInput(tileInput, canvas->format())->toPixelTransferBuffer();
+        testAssert((tile->width() == width) && (tile->height() == height));
+
+        for (int row = 0; row < height; ++row) {
+            System::memcpy(static_cast<uint8*>(canvas->row(y + row)) + x * bytesPerPixel, tile->row(row), width * bytesPerPixel);
+        }
+    }
+    testAssert(bi.getPosition() == bi.size());
+}
+
+
+static bool sameImage(const shared_ptr<CPUPixelTransferBuffer>& a, const shared_ptr<CPUPixelTransferBuffer>& b) {
+    const int rowBytes = a->width() * a->format()->cpuBitsPerPixel / 8;
+    for (int y = 0; y < a->height(); ++y) {
+        if (memcmp(a->row(y), b->row(y), rowBytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static void fillRect(const shared_ptr<CPUPixelTransferBuffer>& image, int x0, int y0, int x1, int y1, Random& rnd) {
+    for (int y = y0; y < y1; ++y) {
+        uint8* row = static_cast<uint8*>(image->row(y));
+        for (int x = x0 * 3; x < x1 * 3; ++x) {
+            row[x] = uint8(rnd.integer(0, 255));
+        }
+    }
+}
+
+
+void testDeltaFrameEncoder() {
+    printf("DeltaFrameEncoder ");
+
+    // PNG tiles are lossless, so the viewer's image must match exactly. The frame size is not
+    // a multiple of the tile size, so the right and bottom tiles are partial.
+    DeltaFrameEncoder::Settings settings;
+    settings.tileSize = 16;
+    settings.tileFormat = Image::PNG;
+    settings.keyframeInterval = 0;
+    settings.maxFramesInFlight = 100;
+    DeltaFrameEncoder encoder(settings);
+
+    const int width = 70, height = 45;
+    const int numTiles = 5 * 3;
+    Random rnd(3, false);
+    const shared_ptr<CPUPixelTransferBuffer>& image  = CPUPixelTransferBuffer::create(width, height, ImageFormat::RGB8());
+    const shared_ptr<CPUPixelTransferBuffer>& canvas = CPUPixelTransferBuffer::create(width, height, ImageFormat::RGB8());
+    fillRect(image, 0, 0, width, height, rnd);
+    System::memset(canvas->buffer(), 0, canvas->size());
+
+    // The first frame is a keyframe with every tile
+    DeltaFrameEncoder::Frame frame;
+    testAssert(encoder.encode(image, frame));
+    testAssert(frame.keyframe && (frame.index == 0));
+    testAssert(frame.tiles.size() == numTiles);
+    applyFrame(frame, canvas);
+    testAssert(sameImage(image, canvas));
+    testAssert((encoder.framesInFlight() == 1) && (encoder.bytesInFlight() == frame.dataSize()));
+
+    // An unchanged frame encodes nothing and is not counted
+    testAssert(! encoder.encode(image, frame));
+    testAssert(encoder.framesInFlight() == 1);
+
+    // A change within one tile sends only that tile
+    fillRect(image, 20, 20, 24, 24, rnd);
+    testAssert(encoder.encode(image, frame));
+    testAssert(! frame.keyframe && (frame.index == 1));
+    testAssert(frame.tiles.size() == 1);
+    testAssert((frame.tiles[0].x == 16) && (frame.tiles[0].y == 16));
+    applyFrame(frame, canvas);
+    testAssert(sameImage(image, canvas));
+
+    // A change spanning four tiles, including the partial corner tile
+    fillRect(image, 60, 30, width, height, rnd);
+    testAssert(encoder.encode(image, frame));
+    testAssert(! frame.keyframe && (frame.tiles.size() == 4));
+    for (int t = 0; t < frame.tiles.size(); ++t) {
+        const DeltaFrameEncoder::Tile& tile = frame.tiles[t];
+        testAssert((tile.x >= 48) && (tile.y >= 16));
+        testAssert(tile.width  == ((tile.x == 64) ? 6 : 16));
+        testAssert(tile.height == ((tile.y == 32) ? 13 : 16));
+    }
+    applyFrame(frame, canvas);
+    testAssert(sameImage(image, canvas));
+
+    // Changing every pixel sends every tile, without being a keyframe
+    fillRect(image, 0, 0, width, height, rnd);
+    testAssert(encoder.encode(image, frame));
+    testAssert(! frame.keyframe && (frame.tiles.size() == numTiles));
+    applyFrame(frame, canvas);
+    testAssert(sameImage(image, canvas));
+
+    // forceKeyframe() resends an unchanged frame in full
+    encoder.forceKeyframe();
+    testAssert(encoder.encode(image, frame));
+    testAssert(frame.keyframe && (frame.tiles.size() == numTiles) && (frame.index == 4));
+    applyFrame(frame, canvas);
+    testAssert(sameImage(image, canvas));
+
+    // Acknowledging every frame empties the pacing window
+    testAssert(encoder.framesInFlight() == 5);
+    for (int i = 0; i < 5; ++i) {
+        encoder.acknowledge();
+    }
+    testAssert((encoder.framesInFlight() == 0) && (encoder.bytesInFlight() == 0));
+
+    // Pacing stops sending after maxFramesInFlight unacknowledged frames
+    settings.maxFramesInFlight = 2;
+    DeltaFrameEncoder paced(settings);
+    testAssert(paced.readyToSend());
+    testAssert(paced.encode(image, frame));
+    testAssert(paced.readyToSend());
+    fillRect(image, 0, 0, 1, 1, rnd);
+    testAssert(paced.encode(image, frame));
+    testAssert(! paced.readyToSend());
+    paced.acknowledge();
+    testAssert(paced.readyToSend());
+
+    printf("passed\n");
+}
@@ -0,0 +1,265 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+static shared_ptr<Image4> makeTestImage(int width, int height, WrapMode wrap = WrapMode::CLAMP) {
+    const shared_ptr<Image4>& im = Image4::createEmpty(width, height, wrap);
+    Random rnd(3, false);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const float u = float(x) / float(width), v = float(y) / float(height);
+            im->set(x, y, Color4(u, v, 0.5f + 0.5f * sin(12.0f * u * v), rnd.uniform()));
+        }
+    }
+    return im;
+}
+
+
+static float difference(const Color4& a, const Color4& b) {
+    const Color4& c = a - b;
+    return max(max(abs(c.r), abs(c.g)), max(abs(c.b), abs(c.a)));
+}
+
+
+static float maxDifference(const shared_ptr<Image4>& a, const shared_ptr<Image4>& b) {
+    testAssert((a->width() == b->width()) && (a->height() == b->height()));
+    float d = 0.0f;
+    for (int y = 0; y < a->height(); ++y) {
+        for (int x = 0; x < a->width(); ++x) {
+            d = max(d, difference(a->get(x, y), b->get(x, y)));
+        }
+    }
+    return d;
+}
+
+
+/** Per-pixel convolution through Map2D::get, as tools did before ImageFilter */
+static shared_ptr<Image4> referenceConvolve(const shared_ptr<Image4>& src, const Array<float>& kx, const Array<float>& ky) {
+    const shared_ptr<Image4>& tmp = Image4::createEmpty(src->width(), src->height(), src->wrapMode());
+    const shared_ptr<Image4>& dst = Image4::createEmpty(src->width(), src->height(), src->wrapMode());
+    for (int y = 0; y < src->height(); ++y) {
+        for (int x = 0; x < src->width(); ++x) {
+            Color4 sum = Color4::zero();
+            for (int t = 0; t < kx.size(); ++t) {
+                sum += src->get(x + t - kx.size() / 2, y) * kx[t];
+            }
+            tmp->set(x, y, sum);
+        }
+    }
+    for (int y = 0; y < src->height(); ++y) {
+        for (int x = 0; x < src->width(); ++x) {
+            Color4 sum = Color4::zero();
+            for (int t = 0; t < ky.size(); ++t) {
+                sum += tmp->get(x, y + t - ky.size() / 2) * ky[t];
+            }
+            dst->set(x, y, sum);
+        }
+    }
+    return dst;
+}
+
+
+static void testConvolve() {
+    Array<float> kx, ky;
+    gaussian1D(kx, 7, 1.5f);
+    ky.append(0.25f, 0.5f, 0.25f);
+
+    const WrapMode wrap[] = {WrapMode::CLAMP, WrapMode::TILE, WrapMode::ZERO};
+    for (int i = 0; i < 3; ++i) {
+        const shared_ptr<Image4>& src = makeTestImage(37, 70, wrap[i]);
+        testAssert(maxDifference(ImageFilter::convolve(src, kx, ky), referenceConvolve(src, kx, ky)) < 1e-5f);
+    }
+
+    // Image3 drops alpha but otherwise matches
+    const shared_ptr<Image4>& src = makeTestImage(20, 9);
+    const shared_ptr<Image3>& blurred3 = ImageFilter::gaussianBlur(Image3::fromArray(src->getCArray(), src->width(), src->height(), src->wrapMode()), 1.0f);
+    const shared_ptr<Image4>& blurred4 = ImageFilter::gaussianBlur(src, 1.0f);
+    for (int y = 0; y < src->height(); ++y) {
+        for (int x = 0; x < src->width(); ++x) {
+            testAssert(difference(Color4(blurred3->get(x, y), 1.0f), Color4(blurred4->get(x, y).rgb(), 1.0f)) < 1e-5f);
+        }
+    }
+}
+
+
+static void testResample() {
+    const shared_ptr<Image4>& src = makeTestImage(34, 20);
+
+    // Interpolating filters are the identity at unit scale
+    testAssert(maxDifference(ImageFilter::resample(src, 34, 20, ResampleFilter::LANCZOS3), src) < 1e-5f);
+    testAssert(maxDifference(ImageFilter::resample(src, 34, 20, ResampleFilter::BOX), src) < 1e-5f);
+    testAssert(maxDifference(ImageFilter::resample(src, 34, 20, ResampleFilter::KAISER), src) < 1e-5f);
+
+    // Halving with a box averages 2x2 blocks
+    const shared_ptr<Image4>& half = ImageFilter::resample(src, 17, 10, ResampleFilter::BOX);
+    for (int y = 0; y < half->height(); ++y) {
+        for (int x = 0; x < half->width(); ++x) {
+            const Color4& expected = (src->get(2 * x, 2 * y) + src->get(2 * x + 1, 2 * y) + src->get(2 * x, 2 * y + 1) + src->get(2 * x + 1, 2 * y + 1)) * 0.25f;
+            testAssert(difference(expected, half->get(x, y)) < 1e-5f);
+        }
+    }
+
+    // Normalized weights preserve a constant image, including at the edges
+    const shared_ptr<Image4>& constant = Image4::createEmpty(29, 17, WrapMode::CLAMP);
+    constant->setAll(Color4(0.25f, 0.5f, 0.75f, 1.0f));
+    for (int f = 0; f < 5; ++f) {
+        const ResampleFilter filter = ResampleFilter(ResampleFilter::Value(f));
+        const shared_ptr<Image4>& up = ImageFilter::resample(constant, 64, 40, filter);
+        const shared_ptr<Image4>& down = ImageFilter::resample(constant, 7, 3, filter);
+        for (int y = 0; y < up->height(); ++y) {
+            for (int x = 0; x < up->width(); ++x) {
+                testAssertM(difference(up->get(x, y), constant->get(0, 0)) < 1e-5f, filter.toString());
+            }
+        }
+        testAssertM(difference(down->get(3, 1), constant->get(0, 0)) < 1e-5f, filter.toString());
+    }
+}
+
+
+static void testPixelTransferBuffer() {
+    // Black and white checkerboard
+    const shared_ptr<CPUPixelTransferBuffer>& srgb = CPUPixelTransferBuffer::create(8, 8, ImageFormat::SRGBA8());
+    const shared_ptr<CPUPixelTransferBuffer>& rgb = CPUPixelTransferBuffer::create(8, 8, ImageFormat::RGB8());
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            const uint8 v = ((x + y) & 1) ? 255 : 0;
+            uint8* p = static_cast<uint8*>(srgb->buffer()) + 4 * (x + 8 * y);
+            p[0] = p[1] = p[2] = v;
+            p[3] = 255;
+            uint8* q = static_cast<uint8*>(rgb->buffer()) + 3 * (x + 8 * y);
+            q[0] = q[1] = q[2] = v;
+        }
+    }
+
+    Array< shared_ptr<CPUPixelTransferBuffer> > mip;
+    ImageFilter::generateMipMaps(srgb, mip);
+    testAssert(mip.size() == 4);
+    testAssert(mip[3]->format() == ImageFormat::SRGBA8());
+    testAssert((mip[3]->width() == 1) && (mip[3]->height() == 1));
+    testAssert(memcmp(mip[0]->buffer(), srgb->buffer(), srgb->size()) == 0);
+
+    // Averaged in linear space, gray is brighter than in sRGB space
+    const uint8* p = static_cast<const uint8*>(mip[1]->buffer());
+    testAssert((abs(int(p[0]) - 188) <= 1) && (p[3] == 255));
+
+    ImageFilter::generateMipMaps(rgb, mip);
+    testAssert(mip[2]->format() == ImageFormat::RGB8());
+    testAssert(abs(int(static_cast<const uint8*>(mip[2]->buffer())[1]) - 128) <= 1);
+
+    // Ringing is clamped for unorm8 and preserved for float
+    const shared_ptr<CPUPixelTransferBuffer>& sharp = ImageFilter::resample(rgb, 19, 19, ResampleFilter::LANCZOS3);
+    testAssert(sharp->format() == ImageFormat::RGB8());
+    const shared_ptr<CPUPixelTransferBuffer>& rgbFloat = CPUPixelTransferBuffer::create(8, 8, ImageFormat::RGB32F());
+    for (int i = 0; i < 8 * 8 * 3; ++i) {
+        static_cast<float*>(rgbFloat->buffer())[i] = float(static_cast<const uint8*>(rgb->buffer())[i]) / 255.0f;
+    }
+    const shared_ptr<CPUPixelTransferBuffer>& hdr = ImageFilter::resample(rgbFloat, 19, 19, ResampleFilter::LANCZOS3);
+    testAssert(hdr->format() == ImageFormat::RGB32F());
+    float lo = 1.0f;
+    for (int i = 0; i < 19 * 19 * 3; ++i) {
+        lo = min(lo, static_cast<const float*>(hdr->buffer())[i]);
+    }
+    testAssert(lo < 0.0f);
+}
+
+
+static void testMipMaps() {
+    Array< shared_ptr<Image4> > mip;
+    const shared_ptr<Image4>& src = makeTestImage(13, 6);
+    ImageFilter::generateMipMaps(src, mip, ResampleFilter::KAISER);
+    testAssert(mip.size() == 4);
+    testAssert(mip[0] == src);
+    testAssert((mip[1]->width() == 6) && (mip[1]->height() == 3));
+    testAssert((mip[2]->width() == 3) && (mip[2]->height() == 1));
+    testAssert((mip[3]->width() == 1) && (mip[3]->height() == 1));
+
+    // Matches the chain that Map2D builds for its own filtered lookups
+    const shared_ptr<Image4>& even = makeTestImage(16, 8);
+    ImageFilter::generateMipMaps(even, mip);
+    testAssert(even->numMipLevels() == mip.size());
+    for (int L = 1; L < mip.size(); ++L) {
+        for (int y = 0; y < mip[L]->height(); ++y) {
+            for (int x = 0; x < mip[L]->width(); ++x) {
+                testAssert(difference(even->mipTexel(L, x, y, WrapMode::CLAMP), mip[L]->get(x, y)) < 1e-5f);
+            }
+        }
+    }
+}
+
+
+void testImageFilter() {
+    printf("ImageFilter ");
+    testConvolve();
+    testResample();
+    testPixelTransferBuffer();
+    testMipMaps();
+    printf("passed\n");
+}
+
+
+void perfImageFilter() {
+    printf("ImageFilter, 1024x1024 RGBA32F:\n");
+    const shared_ptr<Image4>& src = makeTestImage(1024, 1024);
+    Array<float> kernel;
+    gaussian1D(kernel, 13, 2.0f);
+
+    RealTime start = System::time();
+    referenceConvolve(src, kernel, kernel);
+    const RealTime perPixelBlur = System::time() - start;
+
+    start = System::time();
+    ImageFilter::convolve(src, kernel, kernel);
+    const RealTime blur = System::time() - start;
+    printf("  13-tap blur       Map2D::get %6.1f ms   ImageFilter %6.1f ms\n", perPixelBlur * 1000.0, blur * 1000.0);
+
+    // Per-pixel separable Lanczos minification, weighting Map2D::get
+    start = System::time();
+    {
+        const int w = 640, h = 480;
+        const float sx = float(w) / 1024.0f, sy = float(h) / 1024.0f;
+        const shared_ptr<Image4>& tmp = Image4::createEmpty(w, 1024, WrapMode::CLAMP);
+        const shared_ptr<Image4>& dst = Image4::createEmpty(w, h, WrapMode::CLAMP);
+        for (int y = 0; y < 1024; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const float c = (x + 0.5f) / sx - 0.5f;
+                Color4 sum = Color4::zero();
+                float wsum = 0.0f;
+                for (int i = iFloor(c - 3.0f / sx); i <= iCeil(c + 3.0f / sx); ++i) {
+                    const float wt = ImageFilter::evaluate(ResampleFilter::LANCZOS3, (i - c) * sx);
+                    sum += src->get(i, y) * wt;
+                    wsum += wt;
+                }
+                tmp->set(x, y, sum / wsum);
+            }
+        }
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const float c = (y + 0.5f) / sy - 0.5f;
+                Color4 sum = Color4::zero();
+                float wsum = 0.0f;
+                for (int i = iFloor(c - 3.0f / sy); i <= iCeil(c + 3.0f / sy); ++i) {
+                    const float wt = ImageFilter::evaluate(ResampleFilter::LANCZOS3, (i - c) * sy);
+                    sum += tmp->get(x, i) * wt;
+                    wsum += wt;
+                }
+                dst->set(x, y, sum / wsum);
+            }
+        }
+    }
+    const RealTime perPixelResample = System::time() - start;
+
+    start = System::time();
+    ImageFilter::resample(src, 640, 480, ResampleFilter::LANCZOS3);
+    const RealTime resample = System::time() - start;
+    printf("  Lanczos 640x480   Map2D::get %6.1f ms   ImageFilter %6.1f ms\n", perPixelResample * 1000.0, resample * 1000.0);
+
+    start = System::time();
+    src->generateMipMaps();
+    const RealTime perPixelMip = System::time() - start;
+
+    Array< shared_ptr<Image4> > mip;
+    start = System::time();
+    ImageFilter::generateMipMaps(src, mip);
+    const RealTime mipTime = System::time() - start;
+    printf("  Box mip chain     Map2D      %6.1f ms   ImageFilter %6.1f ms\n", perPixelMip * 1000.0, mipTime * 1000.0);
+    printf("\n");
+}
@@ -0,0 +1,132 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** Interpolates the position of the hit point without any textures, so that Tris can be
+    sampled without a GPU. */
+class PositionMaterial : public Material {
+protected:
+    String              m_name;
+
+public:
+
+    PositionMaterial() : m_name("PositionMaterial") {}
+
+    virtual bool hasPartialCoverage() const override {
+        return false;
+    }
+
+    virtual bool coverageLessThanEqual(const float alphaThreshold, const Point2& texCoord) const override {
+        return false;
+    }
+
+    virtual void setStorage(ImageStorage s) const override {}
+
+    virtual const String& name() const override {
+        return m_name;
+    }
+
+    virtual void sample(const Tri& tri, float u, float v, int triIndex, const CPUVertexArray& vertexArray, bool backside, shared_ptr<Surfel>& surfel) const override {
+        const shared_ptr<UniversalSurfel>& s = UniversalSurfel::create();
+        const float w = 1.0f - u - v;
+        s->position = w * tri.position(vertexArray, 0) + u * tri.position(vertexArray, 1) + v * tri.position(vertexArray, 2);
+        s->prevPosition =
+            w * vertexArray.prevPosition[tri.index[0]] +
+            u * vertexArray.prevPosition[tri.index[1]] +
+            v * vertexArray.prevPosition[tri.index[2]];
+        s->geometricNormal = tri.normal(vertexArray);
+        s->source = Surfel::Source(triIndex, u, v);
+        surfel = s;
+    }
+};
+
+} // namespace
+
+
+/** A 2x2 quad centered on the origin in the z = 0 plane, facing +z */
+static void makeQuad(Array<Tri>& triArray, CPUVertexArray& vertexArray) {
+    const Point3 corner[4] = {Point3(-1, -1, 0), Point3(1, -1, 0), Point3(1, 1, 0), Point3(-1, 1, 0)};
+    for (int i = 0; i < 4; ++i) {
+        CPUVertexArray::Vertex& vertex = vertexArray.vertex.next();
+        vertex.position  = corner[i];
+        vertex.normal    = Vector3::unitZ();
+        vertex.tangent   = Vector4(1, 0, 0, 1);
+        vertex.texCoord0 = Point2(corner[i].x, corner[i].y) * 0.5f + Point2(0.5f, 0.5f);
+        vertexArray.prevPosition.append(corner[i]);
+    }
+
+    const shared_ptr<PositionMaterial>& material = std::make_shared<PositionMaterial>();
+    triArray.append(Tri(0, 1, 2, vertexArray, material), Tri(0, 2, 3, vertexArray, material));
+}
+
+
+void testInstancedTriTree() {
+    printf("InstancedTriTree ");
+
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeQuad(triArray, vertexArray);
+
+    InstancedTriTree tree;
+    const int mesh = tree.addMesh(triArray, vertexArray);
+    testAssert(tree.numMeshes() == 1);
+
+    // A stationary instance five units in front of the origin, and a rotated instance
+    // beside it that moved one unit along +x since the previous frame
+    const CFrame stillFrame = CFrame::fromXYZYPRDegrees(0, 0, -5);
+    const CFrame movingFrame = CFrame::fromXYZYPRDegrees(10, 0, -7, 0, 0, 30);
+    const CFrame movingPrevFrame = CFrame::fromXYZYPRDegrees(9, 0, -7, 0, 0, 30);
+    const int still = tree.addInstance(mesh, stillFrame);
+    const int moving = tree.addInstance(mesh, movingFrame, movingPrevFrame);
+    tree.rebuild();
+
+    const Point3 target[2] = {stillFrame.pointToWorldSpace(Point3(0.3f, -0.4f, 0)), movingFrame.pointToWorldSpace(Point3(-0.6f, 0.2f, 0))};
+    const int instanceID[2] = {still, moving};
+    for (int i = 0; i < 2; ++i) {
+        const Point3 origin(target[i].x, target[i].y, 0);
+        const Ray ray(origin, -Vector3::unitZ());
+
+        TriTreeBase::Hit hit;
+        testAssert(tree.intersectRay(ray, hit));
+        testAssert(hit.instanceID == instanceID[i]);
+        testAssert(fuzzyEq(hit.distance, -target[i].z));
+
+        // triIndex and the barycentric coordinates identify the hit point on the mesh of the instance
+        const InstancedTriTree::Instance& instance = tree.instance(hit.instanceID);
+        const shared_ptr<TriTreeBase>& meshTree = tree.meshTree(instance.meshIndex);
+        testAssert((hit.triIndex >= 0) && (hit.triIndex < meshTree->size()));
+        const Tri& tri = meshTree->triArray()[hit.triIndex];
+        const Point3& objectPoint =
+            (1.0f - hit.u - hit.v) * tri.position(meshTree->vertexArray(), 0) +
+            hit.u * tri.position(meshTree->vertexArray(), 1) +
+            hit.v * tri.position(meshTree->vertexArray(), 2);
+        testAssert(instance.frame.pointToWorldSpace(objectPoint).fuzzyEq(target[i]));
+
+        shared_ptr<Surfel> surfel;
+        tree.sample(hit, surfel);
+        testAssert(notNull(surfel));
+        testAssert(surfel->source.index == hit.triIndex);
+        testAssert(surfel->position.fuzzyEq(target[i]));
+        testAssert(surfel->geometricNormal.fuzzyEq(Vector3::unitZ()));
+
+        // Only the moving instance reports motion
+        const Vector3& motion = surfel->position - surfel->prevPosition;
+        testAssert(motion.fuzzyEq((instanceID[i] == moving) ? Vector3::unitX() : Vector3::zero()));
+    }
+
+    // Rays that pass between or behind the instances miss
+    TriTreeBase::Hit hit;
+    testAssert(! tree.intersectRay(Ray(Point3(5, 0, 0), -Vector3::unitZ()), hit));
+    testAssert(! tree.intersectRay(Ray(Point3(0, 0, 0), Vector3::unitZ()), hit));
+    testAssert(hit.instanceID == TriTreeBase::Hit::NONE);
+
+    // The closer instance occludes a copy behind it
+    const int behind = tree.addInstance(mesh, CFrame::fromXYZYPRDegrees(0, 0, -9));
+    tree.rebuild();
+    testAssert(tree.intersectRay(Ray(Point3(0.1f, 0.1f, 0), -Vector3::unitZ()), hit));
+    testAssert((hit.instanceID == still) && (hit.instanceID != behind));
+    testAssert(fuzzyEq(hit.distance, 5.0f));
+
+    printf("passed\n");
+}
@@ -1,4 +1,5 @@
 #include "G3D/Map2D.h"
+#include "G3D/Random.h"
 #include "testassert.h"
 
 using namespace G3D;
@@ -43,6 +44,92 @@ void testBicubic() {
 }
 
 
+static void testMipMaps() {
+    typedef Map2D<float, float> FloatMap;
+
+    // Checkerboard with a non-power-of-two width
+    shared_ptr<FloatMap> map = FloatMap::create(64, 48, WrapMode::TILE);
+    for (int y = 0; y < map->height(); ++y) {
+        for (int x = 0; x < map->width(); ++x) {
+            map->set(x, y, float((x + y) & 1));
+        }
+    }
+
+    testAssert(map->numMipLevels() == 7);
+    testAssert(map->mipWidth(1) == 32 && map->mipHeight(1) == 24);
+    testAssert(map->mipWidth(6) == 1 && map->mipHeight(6) == 1);
+
+    // Level 0 matches bilinear, and every coarser level is uniform gray
+    testAssert(fuzzyEq(map->trilinear(Vector2(10.25f, 7.5f), 0.0f), map->bilinear(10.25f, 7.5f)));
+    for (float lod = 1.0f; lod <= 8.0f; lod += 0.75f) {
+        testAssert(fuzzyEq(map->trilinear(Vector2(13.3f, 21.7f), lod), 0.5f));
+    }
+
+    // Footprints from derivatives
+    testAssert(fuzzyEq(map->trilinear(Vector2(5.5f, 5.5f), Vector2(4.0f, 0.0f), Vector2(0.0f, 4.0f)), 0.5f));
+    testAssert(fuzzyEq(map->ewa(Vector2(5.5f, 5.5f), Vector2(6.0f, 1.0f), Vector2(-0.5f, 3.0f)), 0.5f));
+
+    // Batched lookups match individual ones
+    Array<Vector2> p;
+    Array<float> lod;
+    for (int i = 0; i < 11; ++i) {
+        p.append(Vector2(i * 5.3f - 7.0f, i * 2.1f + 0.2f));
+        lod.append(i * 0.37f);
+    }
+    Array<float> result;
+    result.resize(p.size());
+    map->trilinear(p.getCArray(), lod.getCArray(), result.getCArray(), p.size(), WrapMode::TILE);
+    for (int i = 0; i < p.size(); ++i) {
+        testAssert(fuzzyEq(result[i], map->trilinear(p[i], lod[i])));
+    }
+
+    // Writing invalidates the pyramid
+    map->setAll(2.0f);
+    testAssert(fuzzyEq(map->trilinear(Vector2(3.0f, 3.0f), 3.5f), 2.0f));
+    testAssert(fuzzyEq(map->ewa(Vector2(3.0f, 3.0f), Vector2(40.0f, 0.0f), Vector2(0.0f, 0.5f)), 2.0f));
+}
+
+
+static void testOddMipMaps() {
+    typedef Map2D<float, float> FloatMap;
+
+    // Odd sizes must average every texel into the next level, including the last row and column
+    shared_ptr<FloatMap> map = FloatMap::create(13, 7, WrapMode::CLAMP);
+    Random rnd(3, false);
+    for (int y = 0; y < map->height(); ++y) {
+        for (int x = 0; x < map->width(); ++x) {
+            map->set(x, y, rnd.uniform());
+        }
+    }
+    const float mean = map->average();
+
+    testAssert(map->numMipLevels() == 4);
+    testAssert(map->mipWidth(1) == 6 && map->mipHeight(1) == 3);
+    testAssert(map->mipWidth(2) == 3 && map->mipHeight(2) == 1);
+    for (int L = 1; L < map->numMipLevels(); ++L) {
+        float sum = 0.0f;
+        for (int y = 0; y < map->mipHeight(L); ++y) {
+            for (int x = 0; x < map->mipWidth(L); ++x) {
+                sum += map->mipTexel(L, x, y, WrapMode::CLAMP);
+            }
+        }
+        testAssert(fuzzyEq(sum / float(map->mipWidth(L) * map->mipHeight(L)), mean));
+    }
+    testAssert(fuzzyEq(map->trilinear(Vector2(6.5f, 3.5f), 10.0f), mean));
+
+    // A bright last column is spread over the last texel of each level rather than lost
+    map->setAll(0.0f);
+    for (int y = 0; y < map->height(); ++y) {
+        map->set(map->width() - 1, y, 1.0f);
+    }
+    map->generateMipMaps();
+    testAssert(map->mipTexel(1, map->mipWidth(1) - 1, 0, WrapMode::CLAMP) > 0.0f);
+    testAssert(fuzzyEq(map->mipTexel(1, 0, 0, WrapMode::CLAMP), 0.0f));
+}
+
+
 void testMap2D() {
     testBicubic();
+    testMipMaps();
+    testOddMipMaps();
 }
@@ -4,6 +4,255 @@ using G3D::uint8;
 using G3D::uint32;
 using G3D::uint64;
 
+/** The original serial implementation of MeshAlg::computeAdjacency, which inserts each
+    triangle's edges into a per-vertex edge table */
+static void serialAdjacency(
+    const Array<Vector3>&   vertexGeometry,
+    const Array<int>&       indexArray,
+    Array<MeshAlg::Face>&   faceArray,
+    Array<MeshAlg::Edge>&   edgeArray,
+    Array<MeshAlg::Vertex>& vertexArray) {
+
+    typedef MeshAlg::Face Face;
+    typedef MeshAlg::Edge Edge;
+
+    class TableEdge {
+    public:
+        int        i1;
+        Array<int> faceIndexArray;
+    };
+
+    Array< Array<TableEdge> > table;
+    table.resize(vertexGeometry.size());
+
+    faceArray.clear();
+    edgeArray.clear();
+    vertexArray.clear();
+    faceArray.resize(indexArray.size() / 3);
+    vertexArray.resize(vertexGeometry.size());
+
+    Array<Vector3> faceNormal;
+    faceNormal.resize(faceArray.size());
+
+    static const int nextIndex[] = {1, 2, 0};
+    for (int f = 0; f < faceArray.size(); ++f) {
+        Face& face = faceArray[f];
+        Vector3 vertex[3];
+        for (int j = 0; j < 3; ++j) {
+            const int v = indexArray[3 * f + j];
+            face.vertexIndex[j] = v;
+            face.edgeIndex[j]   = Face::NONE;
+            vertexArray[v].faceIndex.append(f);
+            vertex[j] = vertexGeometry[v];
+        }
+        const Vector3& N = (vertex[1] - vertex[0]).cross(vertex[2] - vertex[0]);
+        faceNormal[f] = N.directionOrZero();
+
+        for (int j = 0; j < 3; ++j) {
+            int i0 = indexArray[3 * f + j];
+            int i1 = indexArray[3 * f + nextIndex[j]];
+            int fi = f;
+            if (i0 >= i1) {
+                std::swap(i0, i1);
+                fi = ~f;
+            }
+            Array<TableEdge>& list = table[i0];
+            int k = 0;
+            while ((k < list.size()) && (list[k].i1 != i1)) {
+                ++k;
+            }
+            if (k == list.size()) {
+                list.next().i1 = i1;
+            }
+            list[k].faceIndexArray.append(fi);
+        }
+    }
+
+    Array<Edge> tempEdgeArray;
+    for (int i0 = 0; i0 < table.size(); ++i0) {
+        for (int k = 0; k < table[i0].size(); ++k) {
+            Array<int>& faceIndexArray = table[i0][k].faceIndexArray;
+            while (faceIndexArray.size() > 0) {
+                const int f0 = faceIndexArray.pop();
+                const Vector3& n0 = faceNormal[(f0 >= 0) ? f0 : ~f0];
+                bool found = false;
+                float ndotn = -2;
+                int f1 = -1, i1 = -1;
+                for (int i = faceIndexArray.size() - 1; i >= 0; --i) {
+                    const int f = faceIndexArray[i];
+                    if ((f >= 0) != (f0 >= 0)) {
+                        const float d = faceNormal[(f >= 0) ? f : ~f].dot(n0);
+                        if (! found || (d > ndotn)) {
+                            found = true;
+                            ndotn = d;
+                            f1 = f;
+                            i1 = i;
+                        }
+                    }
+                }
+
+                const int e = tempEdgeArray.size();
+                Edge& edge = tempEdgeArray.next();
+                edge.vertexIndex[0] = i0;
+                edge.vertexIndex[1] = table[i0][k].i1;
+                edge.faceIndex[0] = edge.faceIndex[1] = Face::NONE;
+
+                int assign[2] = {f0, f1};
+                for (int a = 0; a < (found ? 2 : 1); ++a) {
+                    const int f = (assign[a] >= 0) ? assign[a] : ~assign[a];
+                    edge.faceIndex[(assign[a] >= 0) ? 0 : 1] = f;
+                    int q = 0;
+                    while (faceArray[f].edgeIndex[q] != Face::NONE) {
+                        ++q;
+                    }
+                    faceArray[f].edgeIndex[q] = (assign[a] >= 0) ? e : ~e;
+                }
+                if (found) {
+                    faceIndexArray.fastRemove(i1);
+                }
+            }
+        }
+    }
+
+    // Move boundary edges to the end
+    Array<int> newIndex;
+    newIndex.resize(tempEdgeArray.size());
+    edgeArray.resize(tempEdgeArray.size());
+    for (int e = 0, i = 0, j = tempEdgeArray.size() - 1; e < tempEdgeArray.size(); ++e) {
+        newIndex[e] = tempEdgeArray[e].boundary() ? j-- : i++;
+        edgeArray[newIndex[e]] = tempEdgeArray[e];
+    }
+
+    for (int f = 0; f < faceArray.size(); ++f) {
+        Face& face = faceArray[f];
+        for (int q = 0; q < 3; ++q) {
+            const int e = face.edgeIndex[q];
+            face.edgeIndex[q] = (e < 0) ? ~newIndex[~e] : newIndex[e];
+        }
+
+        const int e0 = face.edgeIndex[0];
+        const int e1 = face.edgeIndex[1];
+        const int e0End   = (e0 < 0) ? edgeArray[~e0].vertexIndex[0] : edgeArray[e0].vertexIndex[1];
+        const int e1Begin = (e1 < 0) ? edgeArray[~e1].vertexIndex[1] : edgeArray[e1].vertexIndex[0];
+        if (e0End != e1Begin) {
+            std::swap(face.edgeIndex[1], face.edgeIndex[2]);
+        }
+    }
+
+    for (int e = 0; e < edgeArray.size(); ++e) {
+        vertexArray[edgeArray[e].vertexIndex[0]].edgeIndex.append(e);
+        vertexArray[edgeArray[e].vertexIndex[1]].edgeIndex.append(~e);
+    }
+}
+
+
+static bool sameAdjacency
+   (const Array<MeshAlg::Face>&   faceA,
+    const Array<MeshAlg::Edge>&   edgeA,
+    const Array<MeshAlg::Vertex>& vertexA,
+    const Array<MeshAlg::Face>&   faceB,
+    const Array<MeshAlg::Edge>&   edgeB,
+    const Array<MeshAlg::Vertex>& vertexB) {
+
+    if ((faceA.size() != faceB.size()) || (edgeA.size() != edgeB.size()) || (vertexA.size() != vertexB.size())) {
+        return false;
+    }
+
+    for (int f = 0; f < faceA.size(); ++f) {
+        for (int j = 0; j < 3; ++j) {
+            if ((faceA[f].vertexIndex[j] != faceB[f].vertexIndex[j]) || (faceA[f].edgeIndex[j] != faceB[f].edgeIndex[j])) {
+                return false;
+            }
+        }
+    }
+
+    for (int e = 0; e < edgeA.size(); ++e) {
+        for (int j = 0; j < 2; ++j) {
+            if ((edgeA[e].vertexIndex[j] != edgeB[e].vertexIndex[j]) || (edgeA[e].faceIndex[j] != edgeB[e].faceIndex[j])) {
+                return false;
+            }
+        }
+    }
+
+    for (int v = 0; v < vertexA.size(); ++v) {
+        const MeshAlg::Vertex& a = vertexA[v];
+        const MeshAlg::Vertex& b = vertexB[v];
+        if ((a.faceIndex.size() != b.faceIndex.size()) || (a.edgeIndex.size() != b.edgeIndex.size())) {
+            return false;
+        }
+        for (int i = 0; i < a.faceIndex.size(); ++i) {
+            if (a.faceIndex[i] != b.faceIndex[i]) {
+                return false;
+            }
+        }
+        for (int i = 0; i < a.edgeIndex.size(); ++i) {
+            if (a.edgeIndex[i] != b.edgeIndex[i]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/** A grid whose triangles are shuffled, plus random triangles that create non-manifold,
+    degenerate, and duplicate edges */
+static void makeAdjacencyMesh(int cells, Array<Vector3>& vertex, Array<int>& index) {
+    Array<Vector2> texCoord;
+    MeshAlg::generateGrid(vertex, texCoord, index, cells, cells);
+
+    Random rnd(11, false);
+    const int numFaces = index.size() / 3;
+    for (int f = numFaces - 1; f > 0; --f) {
+        const int g = rnd.integer(0, f);
+        for (int j = 0; j < 3; ++j) {
+            std::swap(index[3 * f + j], index[3 * g + j]);
+        }
+    }
+
+    for (int i = 0; i < cells * 4; ++i) {
+        const int f = rnd.integer(0, numFaces - 1);
+        const int k = rnd.integer(0, 2);
+        switch (i % 4) {
+        case 0:
+            // Duplicate a triangle
+            index.append(index[3 * f], index[3 * f + 1], index[3 * f + 2]);
+            break;
+        case 1:
+            // Reverse a triangle
+            index.append(index[3 * f + 2], index[3 * f + 1], index[3 * f]);
+            break;
+        case 2:
+            // Degenerate triangle
+            index.append(index[3 * f + k], index[3 * f + k], index[3 * f + (k + 1) % 3]);
+            break;
+        default:
+            // Fin on an existing edge
+            index.append(index[3 * f + k], index[3 * f + (k + 1) % 3], rnd.integer(0, vertex.size() - 1));
+        }
+    }
+}
+
+
+static void testAdjacencyMatchesSerial() {
+    Array<Vector3> vertex;
+    Array<int>     index;
+    makeAdjacencyMesh(60, vertex, index);
+
+    Array<MeshAlg::Face>    faceArray,   serialFaceArray;
+    Array<MeshAlg::Edge>    edgeArray,   serialEdgeArray;
+    Array<MeshAlg::Vertex>  vertexArray, serialVertexArray;
+
+    MeshAlg::computeAdjacency(vertex, index, faceArray, edgeArray, vertexArray);
+    serialAdjacency(vertex, index, serialFaceArray, serialEdgeArray, serialVertexArray);
+
+    testAssertM(sameAdjacency(faceArray, edgeArray, vertexArray, serialFaceArray, serialEdgeArray, serialVertexArray),
+                "computeAdjacency differs from the serial edge table");
+    MeshAlg::debugCheckConsistency(faceArray, edgeArray, vertexArray);
+}
+
+
 void testAdjacency() {
     printf("MeshAlg::computeAdjacency\n");
 
@@ -304,4 +553,25 @@ void testAdjacency() {
 
     }
     
+    testAdjacencyMatchesSerial();
+}
+
+
+void perfAdjacency() {
+    printf("MeshAlg::computeAdjacency, 2M triangles:\n");
+
+    Array<Vector3> vertex;
+    Array<int>     index;
+    makeAdjacencyMesh(1000, vertex, index);
+
+    Array<MeshAlg::Face>    faceArray;
+    Array<MeshAlg::Edge>    edgeArray;
+    Array<MeshAlg::Vertex>  vertexArray;
+
+    const RealTime start = System::time();
+    MeshAlg::computeAdjacency(vertex, index, faceArray, edgeArray, vertexArray);
+    const RealTime elapsed = System::time() - start;
+
+    printf("  computeAdjacency:                 %6.1f ms\n", elapsed / units::milliseconds());
+    printf("\n");
 }
@@ -4,6 +4,112 @@ using G3D::uint8;
 using G3D::uint32;
 using G3D::uint64;
 
+/** The original serial implementation, which scatters each face's vectors to its vertices */
+static void serialTangentSpaceBasis(
+    const Array<Vector3>&       vertexArray,
+    const Array<Vector2>&       texCoordArray,
+    const Array<Vector3>&       vertexNormalArray,
+    const Array<MeshAlg::Face>& faceArray,
+    Array<Vector3>&             tangent,
+    Array<Vector3>&             binormal) {
+
+    tangent.resize(vertexArray.size());
+    binormal.resize(vertexArray.size());
+    System::memset(tangent.getCArray(), 0, sizeof(Vector3) * tangent.size());
+    System::memset(binormal.getCArray(), 0, sizeof(Vector3) * binormal.size());
+
+    for (int f = 0; f < faceArray.size(); ++f) {
+        const MeshAlg::Face& face = faceArray[f];
+        const int i0 = face.vertexIndex[0];
+        const int i1 = face.vertexIndex[1];
+        const int i2 = face.vertexIndex[2];
+
+        Vector3 ve1 = vertexArray[i1] - vertexArray[i0];
+        Vector3 ve2 = vertexArray[i2] - vertexArray[i0];
+        Vector2 te1 = texCoordArray[i1] - texCoordArray[i0];
+        Vector2 te2 = texCoordArray[i2] - texCoordArray[i0];
+
+        Vector3 n(ve1.cross(ve2).direction());
+        Vector3 t, b;
+        float r = te1.x * te2.y - te1.y * te2.x;
+        if (r == 0.0) {
+            if (! n.isFinite() || n.isZero()) {
+                n = Vector3::unitY();
+            }
+            n.getTangents(t, b);
+        } else {
+            r = 1.0f / r;        
+            t = (te2.y * ve1 - te1.y * ve2) * r;
+            b = (te2.x * ve1 - te1.x * ve2) * r;   
+        }
+
+        for (int v = 0; v < 3; ++v) {
+            tangent[face.vertexIndex[v]]  += t;
+            binormal[face.vertexIndex[v]] += b;
+        }
+    }
+
+    for (int v = 0; v < vertexArray.size(); ++v) {
+        const Vector3& N = vertexNormalArray[v];
+        Vector3& T = tangent[v];
+        Vector3& B = binormal[v];
+        T -= T.dot(N) * N;
+        B -= B.dot(N) * N;
+        T = T.directionOrZero();
+        B = B.directionOrZero();
+    }
+}
+
+
+/** A bumpy grid with extra triangles that share vertices in scrambled order */
+static void makeMesh(int cells, Array<Vector3>& vertex, Array<Vector2>& texCoord, Array<int>& index) {
+    MeshAlg::generateGrid(vertex, texCoord, index, cells, cells);
+    Random rnd(7, false);
+    for (int v = 0; v < vertex.size(); ++v) {
+        vertex[v] += Vector3(rnd.uniform(-0.01f, 0.01f), rnd.uniform(-0.01f, 0.01f), rnd.uniform(-0.01f, 0.01f));
+    }
+    for (int i = 0; i < cells * 10; ++i) {
+        index.append(rnd.integer(0, vertex.size() - 1), rnd.integer(0, vertex.size() - 1), rnd.integer(0, vertex.size() - 1));
+    }
+}
+
+
+static void testParallelMatchesSerial() {
+    Array<Vector3> vertex;
+    Array<Vector2> texCoord;
+    Array<int>     index;
+    makeMesh(120, vertex, texCoord, index);
+
+    Array<int> cornerOffset, corner;
+    MeshAlg::computeVertexCorners(index, vertex.size(), cornerOffset, corner);
+    testAssert(cornerOffset.size() == vertex.size() + 1);
+    testAssert(cornerOffset.last() == index.size());
+    for (int v = 0; v < vertex.size(); ++v) {
+        for (int k = cornerOffset[v]; k < cornerOffset[v + 1]; ++k) {
+            testAssert(index[corner[k]] == v);
+            testAssert((k == cornerOffset[v]) || (corner[k - 1] < corner[k]));
+        }
+    }
+
+    Array<MeshAlg::Face> face;
+    Array<MeshAlg::Edge> edge;
+    Array<MeshAlg::Vertex> adjacency;
+    MeshAlg::computeAdjacency(vertex, index, face, edge, adjacency);
+
+    Array<Vector3> vertexNormal, faceNormal;
+    MeshAlg::computeNormals(vertex, face, adjacency, vertexNormal, faceNormal);
+
+    Array<Vector3> tangent, binormal, serialTangent, serialBinormal;
+    MeshAlg::computeTangentSpaceBasis(vertex, texCoord, vertexNormal, face, tangent, binormal);
+    serialTangentSpaceBasis(vertex, texCoord, vertexNormal, face, serialTangent, serialBinormal);
+
+    testAssertM(memcmp(tangent.getCArray(), serialTangent.getCArray(), sizeof(Vector3) * tangent.size()) == 0,
+                "Parallel tangents differ from the serial result");
+    testAssertM(memcmp(binormal.getCArray(), serialBinormal.getCArray(), sizeof(Vector3) * binormal.size()) == 0,
+                "Parallel binormals differ from the serial result");
+}
+
+
 void testMeshAlgTangentSpace() {
     printf("MeshAlg::computeTangentSpaceBasis ");
 
@@ -46,5 +152,40 @@ void testMeshAlgTangentSpace() {
         testAssert(binormal[i].fuzzyEq(Vector3::unitY()));
     }
 
+    testParallelMatchesSerial();
+
     printf("passed\n");
 }
+
+
+void perfMeshAlgTangentSpace() {
+    printf("MeshAlg::computeTangentSpaceBasis, 2M triangles:\n");
+
+    Array<Vector3> vertex;
+    Array<Vector2> texCoord;
+    Array<int>     index;
+    makeMesh(1000, vertex, texCoord, index);
+
+    Array<MeshAlg::Face> face;
+    Array<MeshAlg::Edge> edge;
+    Array<MeshAlg::Vertex> adjacency;
+    MeshAlg::computeAdjacency(vertex, index, face, edge, adjacency);
+
+    Array<Vector3> vertexNormal, faceNormal, tangent, binormal;
+    RealTime start = System::time();
+    MeshAlg::computeNormals(vertex, face, adjacency, vertexNormal, faceNormal);
+    const RealTime normalTime = System::time() - start;
+
+    start = System::time();
+    serialTangentSpaceBasis(vertex, texCoord, vertexNormal, face, tangent, binormal);
+    const RealTime serialTime = System::time() - start;
+
+    start = System::time();
+    MeshAlg::computeTangentSpaceBasis(vertex, texCoord, vertexNormal, face, tangent, binormal);
+    const RealTime parallelTime = System::time() - start;
+
+    printf("  computeNormals:                   %6.1f ms\n", normalTime / units::milliseconds());
+    printf("  Tangent space, serial:            %6.1f ms\n", serialTime / units::milliseconds());
+    printf("  computeTangentSpaceBasis:         %6.1f ms\n", parallelTime / units::milliseconds());
+    printf("\n");
+}
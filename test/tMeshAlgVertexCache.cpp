@@ -0,0 +1,182 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** A grid whose triangles and vertices are stored in random order, as an importer that
+    knows nothing of the vertex cache may produce them */
+static void makeShuffledGrid(int cells, Array<Vector3>& vertex, Array<int>& index) {
+    Array<Vector2> texCoord;
+    Array<Vector3> gridVertex;
+    MeshAlg::generateGrid(gridVertex, texCoord, index, cells, cells, Vector2(1, 1), true, false);
+
+    Random rnd(5, false);
+    Array<int> remap;
+    remap.resize(gridVertex.size());
+    for (int v = 0; v < remap.size(); ++v) {
+        remap[v] = v;
+    }
+    remap.randomize(rnd);
+    vertex.resize(gridVertex.size());
+    for (int v = 0; v < remap.size(); ++v) {
+        vertex[remap[v]] = gridVertex[v];
+    }
+    for (int i = 0; i < index.size(); ++i) {
+        index[i] = remap[index[i]];
+    }
+
+    for (int f = index.size() / 3 - 1; f > 0; --f) {
+        const int g = rnd.integer(0, f);
+        for (int j = 0; j < 3; ++j) {
+            std::swap(index[3 * f + j], index[3 * g + j]);
+        }
+    }
+}
+
+
+/** Triangles as sorted triples, so that two lists can be compared regardless of order */
+static void sortedTriangles(const Array<int>& index, Array<Vector3int32>& triangles) {
+    triangles.fastClear();
+    for (int i = 0; i < index.size(); i += 3) {
+        // Rotate each triangle so that its smallest index is first, which preserves winding
+        int r = 0;
+        if (index[i + 1] < index[i + r]) { r = 1; }
+        if (index[i + 2] < index[i + r]) { r = 2; }
+        triangles.append(Vector3int32(index[i + r], index[i + (r + 1) % 3], index[i + (r + 2) % 3]));
+    }
+    triangles.sort([](const Vector3int32& a, const Vector3int32& b) {
+        return (a.x < b.x) || ((a.x == b.x) && ((a.y < b.y) || ((a.y == b.y) && (a.z < b.z))));
+    });
+}
+
+
+static void testOptimizeVertexCache() {
+    Array<Vector3> vertex;
+    Array<int>     index;
+    makeShuffledGrid(50, vertex, index);
+
+    float acmrBefore, atvrBefore;
+    MeshAlg::simulateVertexCache(index, acmrBefore, atvrBefore);
+
+    Array<int> optimized = index;
+    MeshAlg::optimizeVertexCache(optimized, vertex.size());
+
+    // The same triangles with the same winding
+    Array<Vector3int32> a, b;
+    sortedTriangles(index, a);
+    sortedTriangles(optimized, b);
+    testAssert((a.size() == b.size()) && (memcmp(a.getCArray(), b.getCArray(), sizeof(Vector3int32) * a.size()) == 0));
+
+    float acmr, atvr;
+    MeshAlg::simulateVertexCache(optimized, acmr, atvr);
+    testAssert(acmr < 0.8f);
+    testAssert(acmr < acmrBefore * 0.5f);
+    testAssert(atvr < atvrBefore);
+    testAssert(atvr >= 1.0f);
+}
+
+
+static void testSimulateVertexCache() {
+    // Two triangles sharing an edge transform four vertices
+    Array<int> index;
+    index.append(0, 1, 2);
+    index.append(2, 1, 3);
+    float acmr, atvr;
+    MeshAlg::simulateVertexCache(index, acmr, atvr);
+    testAssert(acmr == 2.0f);
+    testAssert(atvr == 1.0f);
+
+    // With a one-entry cache only a repeat of the last vertex hits
+    MeshAlg::simulateVertexCache(index, acmr, atvr, 1);
+    testAssert(acmr == 3.0f);
+    testAssert(atvr == 1.5f);
+}
+
+
+static void testVertexFetchRemap() {
+    Array<int> index;
+    index.append(5, 3, 0);
+    index.append(0, 3, 1);
+
+    Array<int> remap;
+    MeshAlg::computeVertexFetchRemap(index, 7, remap);
+    testAssert(remap.size() == 7);
+
+    // Used vertices in order of first use, then the unused ones in their original order
+    testAssert(remap[5] == 0);
+    testAssert(remap[3] == 1);
+    testAssert(remap[0] == 2);
+    testAssert(remap[1] == 3);
+    testAssert(remap[2] == 4);
+    testAssert(remap[4] == 5);
+    testAssert(remap[6] == 6);
+}
+
+
+/** Bytes read from memory per byte of vertex data when the vertices that miss a 16-entry
+    post-transform cache are fetched through a 16 kB FIFO of 64-byte lines, for vertices the
+    size of CPUVertexArray::Vertex */
+static float simulateVertexFetch(const Array<int>& index, int numVertices) {
+    static const int vertexBytes = 48, lineBytes = 64, numLines = 256, cacheSize = 16;
+    const int NEVER = -(numLines + cacheSize);
+
+    Array<int> transformTime, lineTime;
+    transformTime.resize(numVertices);
+    lineTime.resize((numVertices * vertexBytes) / lineBytes + 2);
+    transformTime.setAll(NEVER);
+    lineTime.setAll(NEVER);
+
+    int numTransforms = 0, numLinesRead = 0;
+    for (int i = 0; i < index.size(); ++i) {
+        const int v = index[i];
+        if (numTransforms - transformTime[v] < cacheSize) {
+            continue;
+        }
+        transformTime[v] = numTransforms;
+        ++numTransforms;
+
+        for (int line = (v * vertexBytes) / lineBytes; line <= ((v + 1) * vertexBytes - 1) / lineBytes; ++line) {
+            if (numLinesRead - lineTime[line] >= numLines) {
+                lineTime[line] = numLinesRead;
+                ++numLinesRead;
+            }
+        }
+    }
+    return float(numLinesRead * lineBytes) / float(numVertices * vertexBytes);
+}
+
+
+void testMeshAlgVertexCache() {
+    printf("MeshAlg::optimizeVertexCache ");
+    testSimulateVertexCache();
+    testVertexFetchRemap();
+    testOptimizeVertexCache();
+    printf("passed\n");
+}
+
+
+void perfMeshAlgVertexCache() {
+    printf("MeshAlg::optimizeVertexCache, 2M triangles:\n");
+
+    Array<Vector3> vertex;
+    Array<int>     index;
+    makeShuffledGrid(1000, vertex, index);
+
+    float acmr, atvr;
+    MeshAlg::simulateVertexCache(index, acmr, atvr);
+    printf("  Shuffled:   ACMR %5.3f  ATVR %5.3f\n", acmr, atvr);
+
+    const RealTime start = System::time();
+    MeshAlg::optimizeVertexCache(index, vertex.size());
+    const RealTime elapsed = System::time() - start;
+
+    MeshAlg::simulateVertexCache(index, acmr, atvr);
+    printf("  Optimized:  ACMR %5.3f  ATVR %5.3f  (%6.1f ms)\n", acmr, atvr, elapsed / units::milliseconds());
+
+    printf("  Vertex fetch overfetch, original order:  %5.3f\n", simulateVertexFetch(index, vertex.size()));
+    Array<int> remap;
+    MeshAlg::computeVertexFetchRemap(index, vertex.size(), remap);
+    for (int i = 0; i < index.size(); ++i) {
+        index[i] = remap[index[i]];
+    }
+    printf("  Vertex fetch overfetch, first-use order: %5.3f\n", simulateVertexFetch(index, vertex.size()));
+    printf("\n");
+}
@@ -0,0 +1,183 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** A grid of (n + 1) x (n + 1) positions on the xz plane, with height(x, z) on y and a UV seam
+    along x = 0.5: the column of positions on the seam has two vertices with different
+    texture coordinates. chart[v] is 0 or 1 for the side of the seam that uses vertex v. */
+static void makeGrid(int n, float bump, CPUVertexArray& vertexArray, Array<int>& indexArray, Array<int>& chart) {
+    vertexArray.vertex.fastClear();
+    indexArray.fastClear();
+    chart.fastClear();
+
+    const int seam = n / 2;
+    Array<int> index[2];
+    for (int side = 0; side < 2; ++side) {
+        index[side].resize((n + 1) * (n + 1));
+        for (int z = 0; z <= n; ++z) {
+            for (int x = 0; x <= n; ++x) {
+                if ((side == 0) ? (x > seam) : (x < seam)) {
+                    index[side][x + z * (n + 1)] = -1;
+                    continue;
+                }
+                const float u = float(x) / n;
+                const float w = float(z) / n;
+                CPUVertexArray::Vertex& vertex = vertexArray.vertex.next();
+                vertex.position  = Point3(u, bump * sin(u * 6.0f) * cos(w * 5.0f), w);
+                vertex.normal    = Vector3(-bump * 6.0f * cos(u * 6.0f) * cos(w * 5.0f), 1.0f, bump * 5.0f * sin(u * 6.0f) * sin(w * 5.0f)).direction();
+                vertex.tangent   = Vector4(1, 0, 0, 1);
+                vertex.texCoord0 = Point2(u + float(side), w);
+                index[side][x + z * (n + 1)] = vertexArray.size() - 1;
+                chart.append(side);
+            }
+        }
+    }
+
+    for (int z = 0; z < n; ++z) {
+        for (int x = 0; x < n; ++x) {
+            const Array<int>& I = index[(x < seam) ? 0 : 1];
+            const int a = I[x + z * (n + 1)], b = I[x + 1 + z * (n + 1)];
+            const int c = I[x + (z + 1) * (n + 1)], d = I[x + 1 + (z + 1) * (n + 1)];
+            indexArray.append(a, c, b);
+            indexArray.append(b, c, d);
+        }
+    }
+}
+
+
+static float projectedArea(const CPUVertexArray& vertexArray, const Array<int>& indexArray) {
+    float area = 0.0f;
+    for (int i = 0; i < indexArray.size(); i += 3) {
+        const Point3& a = vertexArray.vertex[indexArray[i]].position;
+        const Point3& b = vertexArray.vertex[indexArray[i + 1]].position;
+        const Point3& c = vertexArray.vertex[indexArray[i + 2]].position;
+        area += 0.5f * ((c.x - a.x) * (b.z - a.z) - (b.x - a.x) * (c.z - a.z));
+    }
+    return area;
+}
+
+
+/** Checks that the result is a valid, consistently oriented mesh on the same vertices */
+static void checkResult(const CPUVertexArray& vertexArray, const Array<int>& indexArray, const Array<int>& chart) {
+    testAssert(indexArray.size() % 3 == 0);
+    for (int i = 0; i < indexArray.size(); i += 3) {
+        const int a = indexArray[i], b = indexArray[i + 1], c = indexArray[i + 2];
+        testAssert((a >= 0) && (a < vertexArray.size()));
+        testAssert((b >= 0) && (b < vertexArray.size()));
+        testAssert((c >= 0) && (c < vertexArray.size()));
+
+        const Point3& A = vertexArray.vertex[a].position;
+        const Point3& B = vertexArray.vertex[b].position;
+        const Point3& C = vertexArray.vertex[c].position;
+        testAssertM((A != B) && (B != C) && (C != A), "Degenerate triangle");
+        testAssertM((C - A).cross(B - A).y < 0.0f, "Flipped triangle");
+
+        // The seam stays closed and no triangle mixes texture coordinates from both sides
+        testAssertM((chart[a] == chart[b]) && (chart[b] == chart[c]), "Seam was crossed");
+    }
+}
+
+
+static void testFlatGrid() {
+    CPUVertexArray vertexArray;
+    Array<int> indexArray, chart, result;
+    makeGrid(32, 0.0f, vertexArray, indexArray, chart);
+
+    // Every collapse on a plane that keeps the outline has zero error, so the grid reduces
+    // to a handful of triangles covering exactly the same area
+    MeshSimplifier::Settings settings;
+    settings.targetRatio = 0.0f;
+    settings.maxError = 1e-4f;
+    const float error = MeshSimplifier::simplify(vertexArray, indexArray, result, settings);
+
+    checkResult(vertexArray, result, chart);
+    testAssert(error <= settings.maxError);
+    testAssert(result.size() < indexArray.size() / 20);
+    testAssert(fuzzyEq(projectedArea(vertexArray, result), projectedArea(vertexArray, indexArray)));
+}
+
+
+static void testCurvedGrid() {
+    CPUVertexArray vertexArray;
+    Array<int> indexArray, chart, result;
+    makeGrid(64, 0.1f, vertexArray, indexArray, chart);
+    const int numTriangles = indexArray.size() / 3;
+
+    // On multiple cores, small clusters force several parallel passes
+    MeshSimplifier::Settings settings;
+    settings.targetRatio = 0.1f;
+    settings.clusterSize = 256;
+    const float error = MeshSimplifier::simplify(vertexArray, indexArray, result, settings);
+    checkResult(vertexArray, result, chart);
+    testAssert(result.size() / 3 <= iRound(numTriangles * settings.targetRatio));
+    testAssert(error > 0.0f);
+    testAssert(abs(projectedArea(vertexArray, result) - projectedArea(vertexArray, indexArray)) < 0.01f);
+
+    // The same ratio in one cluster
+    Array<int> serial;
+    settings.clusterSize = numTriangles;
+    MeshSimplifier::simplify(vertexArray, indexArray, serial, settings);
+    checkResult(vertexArray, serial, chart);
+    testAssert(serial.size() / 3 <= iRound(numTriangles * settings.targetRatio));
+
+    // The error bound stops simplification early
+    settings.targetRatio = 0.0f;
+    settings.maxError = error * 0.1f;
+    Array<int> bounded;
+    testAssert(MeshSimplifier::simplify(vertexArray, indexArray, bounded, settings) <= settings.maxError);
+    checkResult(vertexArray, bounded, chart);
+    testAssert(bounded.size() > result.size());
+
+    // Locked vertices remain
+    Array<bool> locked;
+    locked.resize(vertexArray.size());
+    for (int v = 0; v < vertexArray.size(); ++v) {
+        locked[v] = (v % 7 == 0);
+    }
+    settings = MeshSimplifier::Settings();
+    settings.targetRatio = 0.1f;
+    Array<int> lockedResult;
+    MeshSimplifier::simplify(vertexArray, indexArray, lockedResult, settings, locked);
+    checkResult(vertexArray, lockedResult, chart);
+    Set<int> used;
+    for (int i = 0; i < lockedResult.size(); ++i) {
+        used.insert(lockedResult[i]);
+    }
+    for (int v = 0; v < vertexArray.size(); v += 7) {
+        testAssertM(used.contains(v), "A locked vertex was removed");
+    }
+}
+
+
+static void testSettingsAny() {
+    MeshSimplifier::Settings settings;
+    settings.targetRatio = 0.25f;
+    settings.clusterSize = 100;
+    const MeshSimplifier::Settings copy(settings.toAny());
+    testAssert(copy.targetRatio == settings.targetRatio);
+    testAssert(copy.clusterSize == settings.clusterSize);
+    testAssert(MeshSimplifier::Settings(Any(0.75)).targetRatio == 0.75f);
+}
+
+
+void testMeshSimplifier() {
+    printf("MeshSimplifier ");
+    testSettingsAny();
+    testFlatGrid();
+    testCurvedGrid();
+    printf("passed\n");
+}
+
+
+void perfMeshSimplifier() {
+    printf("MeshSimplifier performance:\n");
+    CPUVertexArray vertexArray;
+    Array<int> indexArray, chart, result;
+    makeGrid(700, 0.1f, vertexArray, indexArray, chart);
+
+    MeshSimplifier::Settings settings;
+    settings.targetRatio = 0.1f;
+    const RealTime start = System::time();
+    MeshSimplifier::simplify(vertexArray, indexArray, result, settings);
+    const RealTime elapsed = System::time() - start;
+    printf("  %d -> %d triangles: %6.3f s\n\n", indexArray.size() / 3, result.size() / 3, elapsed);
+}
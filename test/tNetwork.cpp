@@ -0,0 +1,205 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+enum {PING = 1, PONG, STREAM};
+
+static const uint16 NETWORK_TEST_PORT = 10761;
+
+/** Spins until \a msg has a message or \a timeout elapses */
+static bool waitForMessage(NetMessageIterator& msg, RealTime timeout = 5.0) {
+    const RealTime end = System::time() + timeout;
+    while (! msg.isValid()) {
+        if (System::time() > end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** Creates a server on 127.0.0.1:\a port and connects a client to it. Returns false if
+    the connection could not be established within a few seconds. */
+static bool connectLoopback(uint16 port, shared_ptr<NetServer>& server, shared_ptr<NetConnection>& client, shared_ptr<NetConnection>& serverSide) {
+    const NetAddress address("127.0.0.1", port);
+    server = NetServer::create(address);
+    client = NetConnection::connectToServer(address);
+
+    const RealTime connectTimeout = System::time() + 5.0;
+    while ((isNull(serverSide) || (client->status() == NetConnection::WAITING_TO_CONNECT)) && (System::time() < connectTimeout)) {
+        for (NetConnectionIterator& c = server->newConnectionIterator(); c.isValid(); ++c) {
+            serverSide = c.connection();
+        }
+        System::sleep(0.001);
+    }
+
+    return notNull(serverSide) && (client->status() != NetConnection::WAITING_TO_CONNECT);
+}
+
+
+/** Loopback round-trip latency and streaming throughput of the network thread, in the style of the netChat sample */
+void perfNetwork() {
+    printf("Network loopback:\n");
+
+    shared_ptr<NetServer> server;
+    shared_ptr<NetConnection> client, serverSide;
+    if (! connectLoopback(NETWORK_TEST_PORT, server, client, serverSide)) {
+        printf("  Could not connect to 127.0.0.1:%d; skipping\n\n", NETWORK_TEST_PORT);
+        return;
+    }
+
+    NetMessageIterator& serverMsg = serverSide->incomingMessageIterator();
+    NetMessageIterator& clientMsg = client->incomingMessageIterator();
+
+    // Round trips: each message waits for the network thread on both ends to wake up
+    const int numPings = 2000;
+    BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+    RealTime start = System::time();
+    for (int i = 0; i < numPings; ++i) {
+        bo.reset();
+        bo.writeInt32(i);
+        client->send(PING, bo);
+
+        bool ok = waitForMessage(serverMsg);
+        alwaysAssertM(ok, "Timed out waiting for ping");
+        bo.reset();
+        bo.writeInt32(serverMsg.binaryInput().readInt32());
+        ++serverMsg;
+        serverSide->send(PONG, bo);
+
+        ok = waitForMessage(clientMsg);
+        alwaysAssertM(ok, "Timed out waiting for pong");
+        alwaysAssertM(clientMsg.binaryInput().readInt32() == i, "Out of order pong");
+        ++clientMsg;
+    }
+    const RealTime roundTrip = (System::time() - start) / numPings;
+    printf("  Round trip:   %7.1f us\n", roundTrip / (units::milliseconds() * 0.001));
+
+    // One-way stream of reliable messages
+    const int numStream   = 20000;
+    const int messageSize = 1024;
+    Array<uint8> payload;
+    payload.resize(messageSize);
+    for (int i = 0; i < messageSize; ++i) {
+        payload[i] = uint8(i);
+    }
+
+    start = System::time();
+    int received = 0;
+    for (int i = 0; i < numStream; ++i) {
+        client->send(STREAM, payload.getCArray(), messageSize);
+        for (; serverMsg.isValid(); ++serverMsg) {
+            ++received;
+        }
+    }
+    const RealTime streamTimeout = System::time() + 20.0;
+    while ((received < numStream) && (System::time() < streamTimeout)) {
+        for (; serverMsg.isValid(); ++serverMsg) {
+            ++received;
+        }
+    }
+    const RealTime streamTime = System::time() - start;
+    alwaysAssertM(received == numStream, "Lost reliable messages");
+    printf("  Stream:       %7.0f msg/s (%.1f MB/s)\n\n", numStream / streamTime,
+           double(numStream) * messageSize / (streamTime * 1024.0 * 1024.0));
+
+    client->disconnect(false);
+    serverSide->disconnect(false);
+}
+
+
+/** Receives on a connection until it is disconnected, as a network client's receive thread would */
+static void receiveUntilDisconnected(void* arg) {
+    NetConnection* connection = static_cast<NetConnection*>(arg);
+    while (connection->status() != NetConnection::DISCONNECTED) {
+        for (NetMessageIterator& msg = connection->incomingMessageIterator(); msg.isValid(); ++msg) {}
+    }
+}
+
+
+/** Message delivery over loopback, wakeup of the network thread on send, and wakeup of a
+    blocked receiver when the other end shuts down */
+void testNetwork() {
+    printf("Network ");
+
+    shared_ptr<NetServer> server;
+    shared_ptr<NetConnection> client, serverSide;
+    if (! connectLoopback(NETWORK_TEST_PORT + 1, server, client, serverSide)) {
+        printf("(could not connect to 127.0.0.1:%d; skipping) ", NETWORK_TEST_PORT + 1);
+        printf("passed\n");
+        return;
+    }
+
+    NetMessageIterator& serverMsg = serverSide->incomingMessageIterator();
+    NetMessageIterator& clientMsg = client->incomingMessageIterator();
+
+    // Reliable messages arrive intact and in order, including ones that enet must fragment
+    const int numMessages = 40;
+    BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+    for (int i = 0; i < numMessages; ++i) {
+        bo.reset();
+        bo.writeInt32(i);
+        const int length = (i % 4 == 3) ? 20000 : i;
+        for (int j = 0; j < length; ++j) {
+            bo.writeUInt8(uint8(i + j));
+        }
+        client->send(STREAM, bo);
+    }
+
+    for (int i = 0; i < numMessages; ++i) {
+        testAssertM(waitForMessage(serverMsg), "Timed out waiting for a message");
+        testAssert(serverMsg.type() == STREAM);
+        BinaryInput& bi = serverMsg.binaryInput();
+        testAssert(bi.readInt32() == i);
+        const int length = (i % 4 == 3) ? 20000 : i;
+        testAssert(serverMsg.size() == size_t(4 + length));
+        for (int j = 0; j < length; ++j) {
+            testAssert(bi.readUInt8() == uint8(i + j));
+        }
+        ++serverMsg;
+    }
+
+    // A send wakes the network thread immediately. Without the wakeup, each message would
+    // wait for the network thread's poll timeout of 10 ms.
+    Array<RealTime> roundTrip;
+    for (int i = 0; i < 21; ++i) {
+        const RealTime start = System::time();
+        bo.reset();
+        bo.writeInt32(i);
+        client->send(PING, bo);
+        testAssertM(waitForMessage(serverMsg), "Timed out waiting for ping");
+        testAssert(serverMsg.type() == PING);
+        bo.reset();
+        bo.writeInt32(serverMsg.binaryInput().readInt32());
+        ++serverMsg;
+        serverSide->send(PONG, bo);
+
+        testAssertM(waitForMessage(clientMsg), "Timed out waiting for pong");
+        testAssert(clientMsg.type() == PONG);
+        testAssert(clientMsg.binaryInput().readInt32() == i);
+        ++clientMsg;
+        roundTrip.append(System::time() - start);
+    }
+    roundTrip.sort();
+    testAssertM(roundTrip[roundTrip.size() / 2] < 0.005, format("Median loopback round trip is %f ms", roundTrip[roundTrip.size() / 2] * 1000.0));
+
+    // A thread blocked receiving from the server is released when the server shuts down, long
+    // before enet would time out the connection
+    const shared_ptr<Thread> receiver = Thread::create("receiveUntilDisconnected", receiveUntilDisconnected, client.get());
+    receiver->start();
+    System::sleep(0.05);
+    testAssert(! receiver->completed());
+
+    server->stop();
+    const RealTime shutdownTimeout = System::time() + 2.0;
+    while (! receiver->completed() && (System::time() < shutdownTimeout)) {
+        System::sleep(0.001);
+    }
+    testAssertM(receiver->completed(), "Receiving thread was not woken by the server shutting down");
+
+    // Release the thread even if the assertion above is compiled out
+    client->disconnect(false);
+    receiver->waitForCompletion();
+    testAssert(serverSide->status() == NetConnection::DISCONNECTED);
+
+    printf("passed\n");
+}
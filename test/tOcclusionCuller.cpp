@@ -0,0 +1,181 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** Appends the 12 triangles of a world-space box */
+static void appendBox(const AABox& box, Array<Point3>& vertex, Array<int>& index) {
+    const int base = vertex.size();
+    for (int c = 0; c < 8; ++c) {
+        vertex.append(box.corner(c));
+    }
+    static const int face[6][4] = {{0, 1, 2, 3}, {4, 5, 6, 7}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 3, 7, 4}, {1, 2, 6, 5}};
+    for (int f = 0; f < 6; ++f) {
+        index.append(base + face[f][0], base + face[f][1], base + face[f][2]);
+        index.append(base + face[f][0], base + face[f][2], base + face[f][3]);
+    }
+}
+
+
+static void appendQuad(const Point3& a, const Point3& b, const Point3& c, const Point3& d, Array<Point3>& vertex, Array<int>& index) {
+    const int base = vertex.size();
+    vertex.append(a, b, c, d);
+    index.append(base, base + 1, base + 2);
+    index.append(base, base + 2, base + 3);
+}
+
+
+/** Distance in front of the camera of the nearest triangle through the center of pixel (x, y),
+    found by ray casting */
+static float referenceDepth(const CFrame& cameraFrame, const Projection& projection, const Rect2D& viewport,
+                            const Array<Point3>& vertex, const Array<int>& index, int x, int y) {
+    const Ray& csRay = projection.ray(x + 0.5f, y + 0.5f, viewport);
+    const Ray& wsRay = cameraFrame.toWorldSpace(csRay);
+    const float zPerT = -csRay.direction().z;
+    const float nearW = -projection.nearPlaneZ();
+
+    float best = finf();
+    for (int t = 0; t < index.size(); t += 3) {
+        const Point3& a = vertex[index[t]];
+        const Point3& b = vertex[index[t + 1]];
+        const Point3& c = vertex[index[t + 2]];
+        // Both windings
+        const float time = min(wsRay.intersectionTime(a, b, c), wsRay.intersectionTime(a, c, b));
+        const float distance = time * zPerT;
+        if ((distance >= nearW) && (distance < best)) {
+            best = distance;
+        }
+    }
+    return best;
+}
+
+
+void testOcclusionCuller() {
+    printf("OcclusionCuller ");
+
+    OcclusionCuller::Settings settings;
+    settings.width  = 128;
+    settings.height = 64;
+    const shared_ptr<OcclusionCuller> culler = OcclusionCuller::create(settings);
+    testAssert((culler->width() == 128) && (culler->height() == 64));
+
+    const Rect2D viewport = Rect2D::xywh(0, 0, 128, 64);
+    Projection projection;
+    projection.setFieldOfView(toRadians(70.0f), FOVDirection::HORIZONTAL);
+    projection.setNearPlaneZ(-0.5f);
+    projection.setFarPlaneZ(-200.0f);
+    const CFrame cameraFrame = CFrame::fromXYZYPRDegrees(1, 2, 3, 15, -5, 0);
+    culler->setView(cameraFrame, projection, viewport);
+
+    // Occluders: a wall facing the camera, a tilted quad that crosses the near plane, and a box.
+    // Points are placed in camera space and transformed to world space.
+    Array<Point3> cs, vertex;
+    Array<int> index;
+    appendQuad(Point3(-6, -3, -12), Point3(2, -3, -12), Point3(2, 3, -12), Point3(-6, 3, -12), cs, index);
+    appendQuad(Point3(1, -2, 1), Point3(5, -2, 1), Point3(5, -1, -30), Point3(1, -1, -30), cs, index);
+    for (int i = 0; i < cs.size(); ++i) {
+        vertex.append(cameraFrame.pointToWorldSpace(cs[i]));
+    }
+    appendBox(AABox(cameraFrame.pointToWorldSpace(Point3(-1, -1, -8)) - Vector3(0.7f, 0.7f, 0.7f),
+                    cameraFrame.pointToWorldSpace(Point3(-1, -1, -8)) + Vector3(0.7f, 0.7f, 0.7f)), vertex, index);
+
+    culler->rasterize(vertex, index);
+
+    // Compare against ray casting. Coverage may differ only for pixel centers that lie on an edge.
+    int covered = 0, mismatched = 0;
+    for (int y = 0; y < culler->height(); ++y) {
+        for (int x = 0; x < culler->width(); ++x) {
+            const float expected = referenceDepth(cameraFrame, projection, viewport, vertex, index, x, y);
+            const float actual = culler->depth(x, y);
+            if (expected < finf()) {
+                ++covered;
+            }
+            if ((expected < finf()) != (actual < finf())) {
+                ++mismatched;
+            } else if (expected < finf()) {
+                testAssertM(fuzzyEq(expected / actual, 1.0f) || (abs(expected - actual) < 1e-3f * expected),
+                            format("Depth at (%d, %d) is %f, expected %f", x, y, actual, expected));
+            }
+        }
+    }
+    testAssertM(covered > 1000, "Occluders do not cover the screen");
+    testAssertM(mismatched <= covered / 200, format("%d of %d covered pixels disagree with ray casting", mismatched, covered));
+
+    // The hierarchy stores the farthest depth of each block
+    for (int L = 1; L < culler->numLevels(); ++L) {
+        testAssert(culler->depth(0, 0, L) >= culler->depth(0, 0, L - 1));
+    }
+
+    // Boxes given in camera space
+    const Vector3 h(0.3f, 0.3f, 0.3f);
+    const CFrame& c = cameraFrame;
+    const bool behindWall      = culler->occluded(c.toWorldSpace(Box(Point3(-3, 0, -20) - h, Point3(-3, 0, -20) + h)));
+    const bool inFrontOfWall   = culler->occluded(c.toWorldSpace(Box(Point3(-3, 0, -10) - h, Point3(-3, 0, -10) + h)));
+    const bool besideWall      = culler->occluded(c.toWorldSpace(Box(Point3(3.5f, 0, -20) - h, Point3(3.5f, 0, -20) + h)));
+    const bool intersectsWall  = culler->occluded(c.toWorldSpace(Box(Point3(-2, 0, -11.9f) - h, Point3(-2, 0, -11.9f) + h)));
+    const bool crossesNear     = culler->occluded(c.toWorldSpace(Box(Point3(-1, 0, -0.1f) - h, Point3(-1, 0, -0.1f) + h)));
+    const bool behindBox       = culler->occluded(c.toWorldSpace(Box(Point3(-1, -1, -9.5f) - h, Point3(-1, -1, -9.5f) + h)));
+    const bool largeDistant    = culler->occluded(c.toWorldSpace(Box(Point3(-4, -1, -100) - h * 5, Point3(-4, -1, -100) + h * 5)));
+
+    testAssertM(behindWall, "Box behind the wall was not occluded");
+    testAssertM(! inFrontOfWall, "Box in front of the wall was occluded");
+    testAssertM(! besideWall, "Box beside the wall's edge was occluded");
+    testAssertM(! intersectsWall, "Box intersecting the wall was occluded");
+    testAssertM(! crossesNear, "Box crossing the near plane was occluded");
+    testAssertM(behindBox, "Box behind the box occluder was not occluded");
+    testAssertM(largeDistant, "Large distant box was not occluded");
+    testAssert((culler->numTested() == 7) && (culler->numOccluded() == 3));
+
+    culler->setView(cameraFrame, projection, viewport);
+    testAssertM(culler->depth(10, 10) == finf(), "setView did not clear");
+    const bool emptyBuffer = culler->occluded(c.toWorldSpace(Box(Point3(-3, 0, -20) - h, Point3(-3, 0, -20) + h)));
+    testAssertM(! emptyBuffer, "Box occluded by an empty buffer");
+
+    printf("passed\n");
+}
+
+
+void perfOcclusionCuller() {
+    printf("OcclusionCuller, city of 2500 buildings, 100k bounding boxes:\n");
+
+    // A grid of buildings with small objects between them, seen from street level
+    Random rnd(1, false);
+    Array<Point3> vertex;
+    Array<int> index;
+    for (int i = 0; i < 50; ++i) {
+        for (int j = 0; j < 50; ++j) {
+            const Point3 lo(i * 20.0f - 500.0f, 0.0f, j * 20.0f - 1000.0f);
+            appendBox(AABox(lo, lo + Vector3(14, rnd.uniform(10, 60), 14)), vertex, index);
+        }
+    }
+
+    Array<Box> test;
+    for (int i = 0; i < 100000; ++i) {
+        const Point3 p(rnd.uniform(-500, 500), rnd.uniform(0, 10), rnd.uniform(-1000, 0));
+        test.append(Box(p, p + Vector3(1, 2, 1)));
+    }
+
+    const Rect2D viewport = Rect2D::xywh(0, 0, 1920, 1080);
+    Projection projection;
+    projection.setFieldOfView(toRadians(90.0f), FOVDirection::HORIZONTAL);
+    const CFrame cameraFrame = CFrame::fromXYZYPRDegrees(3, 2, 5, 0, 0, 0);
+
+    const shared_ptr<OcclusionCuller> culler = OcclusionCuller::create();
+    RealTime rasterizeTime = finf(), testTime = finf();
+    for (int t = 0; t < 5; ++t) {
+        RealTime start = System::time();
+        culler->setView(cameraFrame, projection, viewport);
+        culler->rasterize(vertex, index);
+        rasterizeTime = min(rasterizeTime, System::time() - start);
+
+        start = System::time();
+        tbb::parallel_for(tbb::blocked_range<int>(0, test.size(), 1024), [&](const tbb::blocked_range<int>& r) {
+            for (int i = r.begin(); i < r.end(); ++i) {
+                culler->occluded(test[i]);
+            }
+        });
+        testTime = min(testTime, System::time() - start);
+    }
+
+    printf("  Rasterize %d triangles at %dx%d: %6.2f ms\n", index.size() / 3, culler->width(), culler->height(), rasterizeTime / units::milliseconds());
+    printf("  Test %d boxes:                     %6.2f ms  (%d occluded)\n", test.size(), testTime / units::milliseconds(), culler->numOccluded());
+    printf("\n");
+}
@@ -0,0 +1,144 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+using G3D::uint8;
+using G3D::uint32;
+using G3D::uint64;
+
+static void writeHeaderLine(BinaryOutput& b, const String& s) {
+    b.writeBytes(s.c_str(), s.size());
+}
+
+
+/** Face record layouts. Any list other than the index list forces ParsePLY's per-value reader. */
+enum FaceLayout {INDICES_ONLY, FIXED_EXTRAS, LIST_EXTRAS};
+
+/** Writes a binary PLY file with either a mixed-type or an all-float vertex schema and a face
+    list optionally wrapped by other properties, as many scanners produce. */
+static void writeTestPLY(BinaryOutput& b, int numVertices, int numFaces, bool allFloat, FaceLayout faceLayout) {
+    const String& endian = (b.endian() == G3D_LITTLE_ENDIAN) ? "binary_little_endian" : "binary_big_endian";
+
+    writeHeaderLine(b, "ply\nformat " + endian + " 1.0\n");
+    writeHeaderLine(b, format("element vertex %d\n", numVertices));
+    writeHeaderLine(b, "property float x\nproperty float y\nproperty float z\n");
+    if (! allFloat) {
+        writeHeaderLine(b, "property uchar red\nproperty double confidence\n");
+    }
+    writeHeaderLine(b, format("element face %d\n", numFaces));
+    if (faceLayout == FIXED_EXTRAS) {
+        writeHeaderLine(b, "property short flags\n");
+    }
+    writeHeaderLine(b, "property list uchar int vertex_indices\n");
+    if (faceLayout == FIXED_EXTRAS) {
+        writeHeaderLine(b, "property float quality\n");
+    } else if (faceLayout == LIST_EXTRAS) {
+        writeHeaderLine(b, "property list uchar float texcoord\n");
+    }
+    writeHeaderLine(b, "end_header\n");
+
+    for (int v = 0; v < numVertices; ++v) {
+        b.writeFloat32(float(v));
+        b.writeFloat32(float(v) * 0.5f);
+        b.writeFloat32(-float(v));
+        if (! allFloat) {
+            b.writeUInt8(uint8(v & 0xFF));
+            b.writeFloat64(double(v) * 0.25);
+        }
+    }
+
+    for (int f = 0; f < numFaces; ++f) {
+        if (faceLayout == FIXED_EXTRAS) {
+            b.writeInt16(int16(f));
+        }
+        // Alternate triangles and quads
+        const int n = 3 + (f & 1);
+        b.writeUInt8(uint8(n));
+        for (int i = 0; i < n; ++i) {
+            b.writeInt32((f + i) % numVertices);
+        }
+        if (faceLayout == FIXED_EXTRAS) {
+            b.writeFloat32(1.0f);
+        } else if (faceLayout == LIST_EXTRAS) {
+            // Varying length, so that record boundaries cannot be predicted
+            b.writeUInt8(uint8(2 * n));
+            for (int i = 0; i < 2 * n; ++i) {
+                b.writeFloat32(0.5f);
+            }
+        }
+    }
+}
+
+
+static void testParsePLYFile(G3DEndian endian, bool allFloat, FaceLayout faceLayout) {
+    // Odd, so that the all-float byte swap has a tail that is not a multiple of the SIMD width
+    const int numVertices = 5001;
+    const int numFaces    = 7001;
+
+    BinaryOutput b("<memory>", endian);
+    writeTestPLY(b, numVertices, numFaces, allFloat, faceLayout);
+
+    BinaryInput bi(b.getCArray(), b.length(), endian, false, false);
+    ParsePLY ply;
+    ply.parse(bi);
+
+    testAssert(ply.numVertices == numVertices);
+    testAssert(ply.numFaces == numFaces);
+    testAssert(ply.vertexProperty.size() == (allFloat ? 3 : 5));
+
+    const int N = ply.vertexProperty.size();
+    for (int v = 0; v < numVertices; ++v) {
+        const float* d = ply.vertexData + v * N;
+        testAssertM(d[0] == float(v) && d[1] == float(v) * 0.5f && d[2] == -float(v), "Bad vertex position");
+        if (! allFloat) {
+            testAssertM(d[3] == float(v & 0xFF), "Bad uchar vertex property");
+            testAssertM(d[4] == float(double(v) * 0.25), "Bad double vertex property");
+        }
+    }
+
+    for (int f = 0; f < numFaces; ++f) {
+        const ParsePLY::Face& face = ply.faceArray[f];
+        testAssertM(face.size() == 3 + (f & 1), "Bad face length");
+        for (int i = 0; i < face.size(); ++i) {
+            testAssertM(face[i] == (f + i) % numVertices, "Bad face index");
+        }
+    }
+}
+
+
+void testParsePLY() {
+    printf("ParsePLY ");
+
+    for (int e = 0; e < 2; ++e) {
+        const G3DEndian endian = (e == 0) ? G3D_LITTLE_ENDIAN : G3D_BIG_ENDIAN;
+        testParsePLYFile(endian, false, INDICES_ONLY);
+        testParsePLYFile(endian, false, FIXED_EXTRAS);
+        testParsePLYFile(endian, false, LIST_EXTRAS);
+        testParsePLYFile(endian, true,  INDICES_ONLY);
+    }
+
+    printf("passed\n");
+}
+
+
+void perfParsePLY() {
+    printf("ParsePLY binary decoding:\n");
+
+    const int numVertices = 2000000;
+    const int numFaces    = 4000000;
+
+    for (int e = 0; e < 2; ++e) {
+        const G3DEndian endian = (e == 0) ? G3D_LITTLE_ENDIAN : G3D_BIG_ENDIAN;
+        BinaryOutput b("<memory>", endian);
+        writeTestPLY(b, numVertices, numFaces, false, INDICES_ONLY);
+
+        BinaryInput bi(b.getCArray(), b.length(), endian, false, false);
+        ParsePLY ply;
+
+        const RealTime start = System::time();
+        ply.parse(bi);
+        const RealTime elapsed = System::time() - start;
+
+        printf("  %s endian, %d vertices + %d faces: %6.3f s (%.0f MB/s)\n",
+               (e == 0) ? "little" : "big", numVertices, numFaces, elapsed,
+               double(b.length()) / (elapsed * 1024.0 * 1024.0));
+    }
+}
@@ -0,0 +1,90 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** The per-particle integration that ParticleSystem::integratePhysics vectorizes */
+static void referencePhysics(Array<ParticleSystem::Particle>& particle, int n, const Vector3& gravitationalAcceleration, const Vector3& windVelocity, float maxBrownianVelocity, float t, float dt) {
+    const float maxBrownian            = maxBrownianVelocity * 0.35f;
+    const int   brownianTemporalOffset = int(t * (windVelocity.length() + 1.f) - 1000.0f);
+
+    for (int i = 0; i < n; ++i) {
+        ParticleSystem::Particle& P = particle[i];
+        const float area = pif() * square(P.radius);
+        const Point3int32& fixedPos = Point3int32(P.position * 200.0f);
+        const Vector3 brownianDirection(Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.y + 10208, fixedPos.z + 55010, 2),
+                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.z + 10208, fixedPos.x + 55010, 2),
+                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.x + 10208, fixedPos.y + 55010, 2));
+        const Vector3& relativeVelocity = windVelocity + maxBrownian * brownianDirection - P.velocity;
+        const Vector3& dragForce = relativeVelocity.directionOrZero() * (0.5f * 1.185f * relativeVelocity.squaredMagnitude() * P.dragCoefficient * area);
+
+        P.velocity += (gravitationalAcceleration + dragForce / P.mass) * dt;
+        P.position += P.velocity * dt;
+        P.angle    += P.angularVelocity * dt;
+    }
+}
+
+
+static bool nearlyEqual(float a, float b) {
+    return fabs(a - b) <= 1e-4f * max(1.0f, fabs(a));
+}
+
+
+void testParticleSystem() {
+    printf("ParticleSystem::integratePhysics ");
+
+    // Several chunks plus a partial one, whose length is not a multiple of any SIMD width
+    const int n = 2 * 256 + 101;
+    const Vector3 gravity(0.1f, -9.8f, 0.3f);
+    const Vector3 wind(2.0f, 0.5f, -1.0f);
+    const float   maxBrownianVelocity = 1.5f;
+    const float   dt = 1.0f / 60.0f;
+
+    Random rnd(7, false);
+    Array<ParticleSystem::Particle> initial;
+    // One extra particle, which must not be touched
+    initial.resize(n + 1);
+    for (int i = 0; i < initial.size(); ++i) {
+        ParticleSystem::Particle& P = initial[i];
+        P.position        = Point3(rnd.uniform(-5, 5), rnd.uniform(-5, 5), rnd.uniform(-5, 5));
+        P.velocity        = Vector3(rnd.uniform(-3, 3), rnd.uniform(-3, 3), rnd.uniform(-3, 3));
+        P.angle           = rnd.uniform(0, 2 * pif());
+        P.angularVelocity = rnd.uniform(-4, 4);
+        P.radius          = rnd.uniform(0.01f, 0.5f);
+        P.mass            = rnd.uniform(0.05f, 2.0f);
+        P.dragCoefficient = (i % 5 == 0) ? 0.0f : rnd.uniform(0.1f, 1.5f);
+    }
+
+    Array<ParticleSystem::Particle> expected = initial;
+    const int simdWidth[] = {1, 4, 8};
+    Array<ParticleSystem::Particle> actual[3];
+    for (int w = 0; w < 3; ++w) {
+        actual[w] = initial;
+    }
+
+    for (int step = 0; step < 10; ++step) {
+        const float t = 3.0f + step * dt;
+        referencePhysics(expected, n, gravity, wind, maxBrownianVelocity, t, dt);
+        for (int w = 0; w < 3; ++w) {
+            ParticleSystem::integratePhysics(actual[w].getCArray(), n, gravity, wind, maxBrownianVelocity, t, dt, simdWidth[w]);
+        }
+    }
+
+    for (int w = 0; w < 3; ++w) {
+        if ((simdWidth[w] == 8) && ! System::hasAVX()) {
+            continue;
+        }
+        for (int i = 0; i < n; ++i) {
+            const ParticleSystem::Particle& A = actual[w][i];
+            const ParticleSystem::Particle& E = expected[i];
+            for (int a = 0; a < 3; ++a) {
+                testAssertM(nearlyEqual(A.position[a], E.position[a]) && nearlyEqual(A.velocity[a], E.velocity[a]),
+                            format("Particle %d of %d differs with SIMD width %d", i, n, simdWidth[w]));
+            }
+            testAssertM(nearlyEqual(A.angle, E.angle), format("Particle %d of %d angle differs with SIMD width %d", i, n, simdWidth[w]));
+        }
+
+        const ParticleSystem::Particle& extra = actual[w][n];
+        testAssert((extra.position == initial[n].position) && (extra.velocity == initial[n].velocity) && (extra.angle == initial[n].angle));
+    }
+
+    printf("passed\n");
+}
@@ -232,6 +232,81 @@ static void curveTest() {
 //    testAssert(fuzzyEq(v, 1.66667));
 }
 
+
+/** Cyclic splines repeat before the first control point as well as after the last */
+static void cyclicTest() {
+    Spline<float> spline;
+    spline.extrapolationMode = SplineExtrapolationMode::CYCLIC;
+    spline.append(1.0f, 3.0f);
+    spline.append(1.25f, -2.0f);
+    spline.append(3.0f, 5.0f);
+    spline.append(4.5f, 1.0f);
+
+    const float d = spline.duration();
+    for (float t = -8.0f; t < 0.0f; t += 0.25f) {
+        testAssert(fuzzyEq(spline.evaluate(t), spline.evaluate(t + 3 * d)));
+    }
+}
+
+
+static PhysicsFrameSpline randomPhysicsFrameSpline(Random& rnd, int n, SplineExtrapolationMode e, SplineInterpolationMode m) {
+    PhysicsFrameSpline spline;
+    spline.extrapolationMode = e;
+    spline.interpolationMode = m;
+    float t = rnd.uniform(-5, 5);
+    for (int i = 0; i < n; ++i) {
+        spline.append(t, CFrame::fromXYZYPRDegrees(rnd.uniform(-10, 10), rnd.uniform(-10, 10), rnd.uniform(-10, 10), 
+                                                   rnd.uniform(-180, 180), rnd.uniform(-90, 90), rnd.uniform(-180, 180)));
+        t += rnd.uniform(0.1f, 3.0f);
+    }
+    return spline;
+}
+
+
+static void batchTest() {
+    Random rnd(3, false);
+    PhysicsFrameSplineBatch batch;
+    Array<PhysicsFrameSpline> spline;
+    for (int i = 0; i < 120; ++i) {
+        const SplineExtrapolationMode e = (i % 3 == 0) ? SplineExtrapolationMode::CYCLIC : 
+            (i % 3 == 1) ? SplineExtrapolationMode::LINEAR : SplineExtrapolationMode::CLAMP;
+        const SplineInterpolationMode m = (i % 5 == 0) ? SplineInterpolationMode::LINEAR : SplineInterpolationMode::CUBIC;
+        spline.append(randomPhysicsFrameSpline(rnd, 1 + i % 8, e, m));
+        const int index = batch.append(spline.last());
+        testAssert(index == i);
+        (void)index;
+    }
+
+    // Replaced splines are recompiled
+    for (int i = 0; i < 100; ++i) {
+        const int j = rnd.integer(0, spline.size() - 1);
+        spline[j] = randomPhysicsFrameSpline(rnd, 2 + i % 9, spline[j].extrapolationMode, spline[j].interpolationMode);
+        batch.set(j, spline[j]);
+    }
+    testAssert(batch.size() == spline.size());
+
+    // Monotonic time, including before the first and after the last control point
+    Array<PhysicsFrame> frame;
+    for (float t = -30.0f; t < 60.0f; t += 0.1f) {
+        batch.evaluate(t, frame);
+        for (int i = 0; i < spline.size(); ++i) {
+            const PhysicsFrame& expected = spline[i].evaluate(t);
+            testAssert(expected.translation.fuzzyEq(frame[i].translation) || ((expected.translation - frame[i].translation).length() < 1e-4f * expected.translation.length()));
+            testAssert(abs(abs(expected.rotation.dot(frame[i].rotation)) - 1.0f) < 1e-4f);
+        }
+    }
+
+    // Random time
+    for (int k = 0; k < 5000; ++k) {
+        const int i = rnd.integer(0, spline.size() - 1);
+        const float t = rnd.uniform(-100, 100);
+        const PhysicsFrame& expected = spline[i].evaluate(t);
+        const PhysicsFrame& actual = batch.evaluate(i, t);
+        testAssert((expected.translation - actual.translation).length() < 1e-4f * max(1.0f, expected.translation.length()));
+    }
+}
+
+
 void testSpline() {
     printf("Spline ");
     // Control point testing
@@ -243,5 +318,40 @@ void testSpline() {
     linearTest();
   
     curveTest();
+    cyclicTest();
+    batchTest();
     printf("passed\n");
 }
+
+
+void perfSpline() {
+    printf("PhysicsFrameSpline, 20000 cyclic splines of 8 control points, 60 frames:\n");
+
+    Random rnd(1, false);
+    PhysicsFrameSplineBatch batch;
+    Array<PhysicsFrameSpline> spline;
+    for (int i = 0; i < 20000; ++i) {
+        spline.append(randomPhysicsFrameSpline(rnd, 8, SplineExtrapolationMode::CYCLIC, SplineInterpolationMode::CUBIC));
+        batch.append(spline.last());
+    }
+
+    Array<PhysicsFrame> frame;
+    frame.resize(spline.size());
+    RealTime start = System::time();
+    for (int f = 0; f < 60; ++f) {
+        for (int i = 0; i < spline.size(); ++i) {
+            frame[i] = spline[i].evaluate(f / 60.0f);
+        }
+    }
+    const RealTime evaluateTime = (System::time() - start) / 60;
+
+    start = System::time();
+    for (int f = 0; f < 60; ++f) {
+        batch.evaluate(f / 60.0f, frame);
+    }
+    const RealTime batchTime = (System::time() - start) / 60;
+
+    printf("  Spline::evaluate:                 %6.2f ms/frame\n", evaluateTime / units::milliseconds());
+    printf("  PhysicsFrameSplineBatch::evaluate: %6.2f ms/frame\n", batchTime / units::milliseconds());
+    printf("\n");
+}
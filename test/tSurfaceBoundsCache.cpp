@@ -0,0 +1,233 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+/** A Surface that has only bounds */
+class BoundsSurface : public Surface {
+public:
+    CFrame  cframe;
+    AABox   box;
+    bool    shadows;
+
+    BoundsSurface(const CFrame& cframe, const AABox& box, bool shadows) : cframe(cframe), box(box), shadows(shadows) {}
+
+    virtual void getCoordinateFrame(CoordinateFrame& c, bool previous = false) const override {
+        c = cframe;
+    }
+
+    virtual void getObjectSpaceBoundingBox(AABox& b, bool previous = false) const override {
+        b = box;
+    }
+
+    virtual void getObjectSpaceBoundingSphere(Sphere& s, bool previous = false) const override {
+        if (box.isFinite()) {
+            s = Sphere(box.center(), box.extent().length() / 2.0f);
+        } else {
+            s = Sphere(Point3::zero(), finf());
+        }
+    }
+
+    virtual bool castsShadows() const override {
+        return shadows;
+    }
+
+    virtual void renderWireframeHomogeneous(RenderDevice* rd, const Array<shared_ptr<Surface> >& surfaceArray, const Color4& color, bool previous) const override {}
+    virtual bool canBeFullyRepresentedInGBuffer(const GBuffer::Specification& specification) const override { return true; }
+    virtual bool anyUnblended() const override { return true; }
+    virtual bool requiresBlending() const override { return false; }
+    virtual void render(RenderDevice* rd, const LightingEnvironment& environment, RenderPassType passType) const override {}
+    virtual void setStorage(ImageStorage newStorage) override {}
+};
+}
+
+
+static void makeScene(int n, Array<shared_ptr<Surface> >& surfaceArray) {
+    Random rnd(n, false);
+    for (int i = 0; i < n; ++i) {
+        const CFrame& c = CFrame::fromXYZYPRDegrees(rnd.uniform(-100, 100), rnd.uniform(-100, 100), rnd.uniform(-100, 100),
+                                                    rnd.uniform(0, 360), rnd.uniform(-90, 90), rnd.uniform(0, 360));
+        const Vector3& extent = Vector3(rnd.uniform(0.1f, 8), rnd.uniform(0.1f, 8), rnd.uniform(0.1f, 8));
+        const AABox& box = (i % 1000 == 7) ? AABox::inf() : AABox(-extent / 2, extent / 2);
+        surfaceArray.append(shared_ptr<Surface>(new BoundsSurface(c, box, (i % 3) != 0)));
+    }
+}
+
+
+/** The per-surface test that Surface::cull used before SurfaceBoundsCache */
+static void referenceCull(const SurfaceBoundsCache::View& view, const Array<shared_ptr<Surface> >& allSurfaces, Array<shared_ptr<Surface> >& visible) {
+    Frustum fr;
+    view.projection.frustum(view.viewport, fr);
+    fr = view.frame.toWorldSpace(fr);
+
+    Array<Plane> clipPlanes;
+    view.projection.getClipPlanes(view.viewport, clipPlanes);
+    for (int i = 0; i < clipPlanes.size(); ++i) {
+        clipPlanes[i] = view.frame.toWorldSpace(clipPlanes[i]);
+    }
+
+    for (int i = 0; i < allSurfaces.size(); ++i) {
+        const shared_ptr<Surface>& m = allSurfaces[i];
+        if (view.onlyShadowCasters && ! m->castsShadows()) {
+            continue;
+        }
+
+        Sphere sphere;
+        CFrame c;
+        m->getCoordinateFrame(c);
+        m->getObjectSpaceBoundingSphere(sphere);
+        sphere = c.toWorldSpace(sphere);
+
+        bool culled = sphere.culledBy(clipPlanes);
+        if (! culled) {
+            AABox osBox;
+            m->getObjectSpaceBoundingBox(osBox);
+            culled = osBox.isFinite() && c.toWorldSpace(osBox).culledBy(fr);
+        }
+
+        if (! culled) {
+            visible.append(m);
+        }
+    }
+}
+
+
+static void makeViews(Array<SurfaceBoundsCache::View>& view) {
+    const Rect2D viewport = Rect2D::xywh(0, 0, 1920, 1080);
+    const Rect2D shadowViewport = Rect2D::xywh(0, 0, 2048, 2048);
+    Projection camera;
+    camera.setFieldOfView(1.2f, FOVDirection::HORIZONTAL);
+    camera.setFarPlaneZ(-150.0f);
+    view.append(SurfaceBoundsCache::View(CFrame::fromXYZYPRDegrees(0, 2, 10, 20, -5), camera, viewport));
+
+    for (int L = 0; L < 4; ++L) {
+        Projection light;
+        light.setFieldOfView(1.0f + 0.2f * L, FOVDirection::HORIZONTAL);
+        light.setNearPlaneZ(-0.5f);
+        light.setFarPlaneZ((L == 3) ? -finf() : -80.0f);
+        view.append(SurfaceBoundsCache::View(CFrame::fromXYZYPRDegrees(30.0f * L - 45, 40, 30.0f * L - 45, 90.0f * L, -50), light, shadowViewport, true));
+    }
+}
+
+
+void testSurfaceBoundsCache() {
+    printf("SurfaceBoundsCache ");
+
+    Array<shared_ptr<Surface> > allSurfaces;
+    makeScene(20003, allSurfaces);
+
+    Array<SurfaceBoundsCache::View> view;
+    makeViews(view);
+
+    SurfaceBoundsCache bounds;
+    bounds.update(allSurfaces);
+    testAssert(bounds.size() == allSurfaces.size());
+
+    // matches() identifies the exact array that was read, which Renderer::surfaceBounds relies on
+    testAssert(bounds.matches(allSurfaces));
+    Array<shared_ptr<Surface> > other = allSurfaces;
+    other.pop();
+    testAssert(! bounds.matches(other));
+    other.append(allSurfaces[0]);
+    testAssert(! bounds.matches(other));
+
+    Array< Array<shared_ptr<Surface> > > visible;
+    bounds.cull(view, visible);
+    testAssert(visible.size() == view.size());
+
+    for (int v = 0; v < view.size(); ++v) {
+        Array<shared_ptr<Surface> > expected;
+        referenceCull(view[v], allSurfaces, expected);
+
+        testAssertM(expected.size() == visible[v].size(),
+                    format("View %d: %d visible, expected %d", v, visible[v].size(), expected.size()));
+        for (int i = 0; i < expected.size(); ++i) {
+            testAssertM(visible[v].contains(expected[i]), format("View %d culled a visible surface", v));
+        }
+        testAssertM(visible[v].size() > 0, "Nothing visible");
+        testAssertM(visible[v].size() < allSurfaces.size(), "Nothing culled");
+
+        Array<shared_ptr<Surface> > single;
+        bounds.cull(view[v], single);
+        testAssert(single.size() == visible[v].size());
+    }
+
+    // Infinite surfaces are never culled, and order is preserved
+    for (int i = 1; i < visible[0].size(); ++i) {
+        testAssert(allSurfaces.findIndex(visible[0][i - 1]) < allSurfaces.findIndex(visible[0][i]));
+    }
+    for (int i = 7; i < allSurfaces.size(); i += 1000) {
+        testAssert(visible[0].contains(allSurfaces[i]));
+    }
+
+    // In-place Surface::cull keeps exactly the visible surfaces
+    Array<shared_ptr<Surface> > inPlace = allSurfaces;
+    Surface::cull(view[0].frame, view[0].projection, view[0].viewport, inPlace);
+    testAssert(inPlace.size() == visible[0].size());
+
+    // A wall just in front of the camera occludes every finite surface behind it
+    const shared_ptr<OcclusionCuller> occlusionCuller = OcclusionCuller::create();
+    occlusionCuller->setView(view[0].frame, view[0].projection, view[0].viewport);
+    Array<Point3> wall;
+    wall.append(Point3(-100, -100, -2), Point3(100, -100, -2), Point3(100, 100, -2), Point3(-100, 100, -2));
+    for (int i = 0; i < wall.size(); ++i) {
+        wall[i] = view[0].frame.pointToWorldSpace(wall[i]);
+    }
+    Array<int> wallIndex;
+    wallIndex.append(0, 1, 2);
+    wallIndex.append(0, 2, 3);
+    occlusionCuller->rasterize(wall, wallIndex);
+
+    Array<shared_ptr<Surface> > unoccluded;
+    Surface::cull(view[0].frame, view[0].projection, view[0].viewport, allSurfaces, unoccluded, false, occlusionCuller);
+    testAssert(unoccluded.size() + occlusionCuller->numOccluded() == visible[0].size());
+    testAssertM(occlusionCuller->numOccluded() > 0, "Nothing occluded");
+    for (int i = 7; i < allSurfaces.size(); i += 1000) {
+        testAssert(unoccluded.contains(allSurfaces[i]));
+    }
+
+    printf("passed\n");
+}
+
+
+void perfSurfaceBoundsCache() {
+    printf("Surface culling, 100k surfaces x 5 views:\n");
+
+    Array<shared_ptr<Surface> > allSurfaces;
+    makeScene(100000, allSurfaces);
+    Array<SurfaceBoundsCache::View> view;
+    makeViews(view);
+
+    const int trials = 5;
+    int ignore = 0;
+
+    RealTime referenceTime = finf();
+    for (int t = 0; t < trials; ++t) {
+        const RealTime start = System::time();
+        for (int v = 0; v < view.size(); ++v) {
+            Array<shared_ptr<Surface> > visible;
+            referenceCull(view[v], allSurfaces, visible);
+            ignore += visible.size();
+        }
+        referenceTime = min(referenceTime, System::time() - start);
+    }
+
+    SurfaceBoundsCache bounds;
+    RealTime updateTime = finf(), cullTime = finf();
+    for (int t = 0; t < trials; ++t) {
+        RealTime start = System::time();
+        bounds.update(allSurfaces);
+        updateTime = min(updateTime, System::time() - start);
+
+        start = System::time();
+        Array< Array<shared_ptr<Surface> > > visible;
+        bounds.cull(view, visible);
+        cullTime = min(cullTime, System::time() - start);
+        ignore += visible[0].size();
+    }
+
+    printf("  Per-surface virtual calls:    %6.2f ms\n", referenceTime / units::milliseconds());
+    printf("  SurfaceBoundsCache::update:   %6.2f ms\n", updateTime / units::milliseconds());
+    printf("  SurfaceBoundsCache::cull:     %6.2f ms  (%s)\n", cullTime / units::milliseconds(), System::hasAVX() ? "AVX" : "SSE");
+    printf("\n");
+    (void)ignore;
+}
@@ -0,0 +1,128 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+/** Appends a 2x2 quad facing +z, centered on \a center */
+static void appendQuad(const Point3& center, const shared_ptr<ReferenceCountedObject>& data, Array<Tri>& triArray, CPUVertexArray& vertexArray) {
+    const int base = vertexArray.size();
+    const Vector3 offset[4] = {Vector3(-1, -1, 0), Vector3(1, -1, 0), Vector3(1, 1, 0), Vector3(-1, 1, 0)};
+    for (int i = 0; i < 4; ++i) {
+        CPUVertexArray::Vertex& vertex = vertexArray.vertex.next();
+        vertex.position  = center + offset[i];
+        vertex.normal    = Vector3::unitZ();
+        vertex.tangent   = Vector4(1, 0, 0, 1);
+        vertex.texCoord0 = Point2(offset[i].x, offset[i].y) * 0.5f + Point2(0.5f, 0.5f);
+    }
+    triArray.append(Tri(base, base + 1, base + 2, vertexArray, data), Tri(base, base + 2, base + 3, vertexArray, data));
+}
+
+
+static void testSurfelsEqual(const UniversalSurfel& expected, const UniversalSurfel& actual) {
+    testAssert(actual.position.fuzzyEq(expected.position));
+    testAssert(actual.prevPosition.fuzzyEq(expected.prevPosition));
+    testAssert(actual.geometricNormal.fuzzyEq(expected.geometricNormal));
+    testAssert(actual.shadingNormal.fuzzyEq(expected.shadingNormal));
+    testAssert(actual.shadingTangent1.fuzzyEq(expected.shadingTangent1));
+    testAssert(actual.lambertianReflectivity == expected.lambertianReflectivity);
+    testAssert(actual.glossyReflectionCoefficient == expected.glossyReflectionCoefficient);
+    testAssert(actual.coverage == expected.coverage);
+    testAssert(actual.source.index == expected.source.index);
+    testAssert(actual.material == expected.material);
+}
+
+
+/** Casts \a rays and checks that TriTreeBase::sampleHits produces the same surfels as
+    TriTreeBase::sample for each hit. Returns the number of surfels. */
+static int testSampleHits(const TriTreeBase& tree, const Array<Ray>& rays, SurfelBuffer& buffer) {
+    Array<TriTreeBase::Hit> hits;
+    tree.intersectRays(rays, hits);
+    tree.sampleHits(hits, buffer);
+    testAssert(buffer.size() == hits.size());
+
+    int numSurfels = 0;
+    for (int i = 0; i < hits.size(); ++i) {
+        shared_ptr<Surfel> surfel;
+        tree.sample(hits[i], surfel);
+        const shared_ptr<UniversalSurfel>& expected = dynamic_pointer_cast<UniversalSurfel>(surfel);
+
+        // Misses and Tris without a UniversalMaterial have no element
+        if (isNull(expected)) {
+            testAssert(! buffer.hasSurfel(i));
+            continue;
+        }
+
+        testAssert(buffer.hasSurfel(i));
+        UniversalSurfel actual;
+        buffer.get(i, actual);
+        testSurfelsEqual(*expected, actual);
+        ++numSurfels;
+    }
+    return numSurfels;
+}
+
+
+void testTriTreeBase() {
+    printf("TriTreeBase::sampleHits ");
+
+    const shared_ptr<UniversalMaterial>& red   = UniversalMaterial::createDiffuse(Color3::red());
+    const shared_ptr<UniversalMaterial>& green = UniversalMaterial::createDiffuse(Color3::green());
+
+    // Materials repeat non-consecutively, and one quad has no material at all
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    vertexArray.hasTangent = true;
+    appendQuad(Point3(-1.0f,  0.0f, -3.0f), red,     triArray, vertexArray);
+    appendQuad(Point3( 1.0f,  0.0f, -4.0f), green,   triArray, vertexArray);
+    appendQuad(Point3( 0.0f,  1.0f, -5.0f), red,     triArray, vertexArray);
+    appendQuad(Point3( 0.0f, -1.5f, -2.0f), nullptr, triArray, vertexArray);
+
+    Array<Ray> rays;
+    for (float y = -3.0f; y <= 3.0f; y += 0.25f) {
+        for (float x = -3.0f; x <= 3.0f; x += 0.25f) {
+            rays.append(Ray(Point3(x + 0.01f, y + 0.02f, 0.0f), -Vector3::unitZ()));
+        }
+    }
+
+    TriTree tree;
+    tree.setContents(triArray, vertexArray);
+    SurfelBuffer buffer;
+    const int numSurfels = testSampleHits(tree, rays, buffer);
+    testAssert((numSurfels > 0) && (numSurfels < rays.size()));
+
+    // updateMaterialIndex() maps each Tri to its own material
+    for (int i = 0; i < buffer.size(); ++i) {
+        if (buffer.hasSurfel(i)) {
+            // Only the green quad is at z = -4
+            testAssert(buffer.material[i] == (fuzzyEq(buffer.position[i].z, -4.0f) ? green.get() : red.get()));
+        }
+    }
+
+    // Swapping the materials and rebuilding updates the index
+    for (int t = 0; t < triArray.size(); ++t) {
+        if (notNull(triArray[t].material())) {
+            triArray[t].setData((triArray[t].material() == red) ? green : red);
+        }
+    }
+    tree.setContents(triArray, vertexArray);
+    testAssert(testSampleHits(tree, rays, buffer) == numSurfels);
+    for (int i = 0; i < buffer.size(); ++i) {
+        if (buffer.hasSurfel(i) && fuzzyEq(buffer.position[i].z, -3.0f)) {
+            testAssert(buffer.material[i] == green.get());
+        }
+    }
+
+    // Instanced path, including a moving instance, into a buffer that is reused at a smaller size
+    InstancedTriTree instancedTree;
+    const int mesh = instancedTree.addMesh(triArray, vertexArray);
+    instancedTree.addInstance(mesh, CFrame());
+    instancedTree.addInstance(mesh, CFrame::fromXYZYPRDegrees(0.5f, 0.25f, -4.0f, 20.0f), CFrame::fromXYZYPRDegrees(0.0f, 0.25f, -4.0f, 20.0f));
+    instancedTree.rebuild();
+
+    Array<Ray> fewerRays;
+    for (int i = 0; i < rays.size(); i += 3) {
+        fewerRays.append(rays[i]);
+    }
+    testAssert(testSampleHits(instancedTree, fewerRays, buffer) > 0);
+    testAssert(buffer.size() == fewerRays.size());
+
+    printf("passed\n");
+}
@@ -0,0 +1,169 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+// Odd sizes, so that the last band of rows that convertFrame converts in parallel is partial
+static const int VIDEO_WIDTH  = 131;
+static const int VIDEO_HEIGHT = 97;
+
+/** Color of pixel (x, y) of frame \a index. Every row and every channel differs. */
+static Color3unorm8 framePixel(int index, int x, int y) {
+    return Color3unorm8(unorm8::fromBits(uint8(x)), unorm8::fromBits(uint8(255 - y)), unorm8::fromBits(uint8(index * 10 + 3)));
+}
+
+
+/** A frame in \a format, which must be RGB8 or BGR8 */
+static shared_ptr<CPUPixelTransferBuffer> makeFrame(int index, const ImageFormat* format) {
+    const shared_ptr<CPUPixelTransferBuffer>& frame = CPUPixelTransferBuffer::create(VIDEO_WIDTH, VIDEO_HEIGHT, format);
+    const bool bgr = (format == ImageFormat::BGR8());
+    for (int y = 0; y < VIDEO_HEIGHT; ++y) {
+        uint8* row = static_cast<uint8*>(frame->row(y));
+        for (int x = 0; x < VIDEO_WIDTH; ++x) {
+            const Color3unorm8& c = framePixel(index, x, y);
+            row[x * 3 + 0] = (bgr ? c.b : c.r).bits();
+            row[x * 3 + 1] = c.g.bits();
+            row[x * 3 + 2] = (bgr ? c.r : c.b).bits();
+        }
+    }
+    return frame;
+}
+
+
+/** Returns the data of each video chunk of an uncompressed AVI in the order stored, by
+    walking the chunks of its 'movi' list. */
+static void readRawAVIFrames(const String& filename, Array<Array<uint8> >& frameArray) {
+    FileSystem::clearCache();
+    BinaryInput bi(filename, G3D_LITTLE_ENDIAN);
+    const uint8* data = bi.getCArray();
+    const int64 length = bi.size();
+
+    int64 movi = -1;
+    for (int64 i = 8; (i + 4 <= length) && (movi < 0); ++i) {
+        if ((memcmp(data + i, "movi", 4) == 0) && (memcmp(data + i - 8, "LIST", 4) == 0)) {
+            movi = i;
+        }
+    }
+    testAssertM(movi >= 0, "No movi list in " + filename);
+
+    bi.setPosition(movi - 4);
+    const int64 end = movi + bi.readUInt32();
+    testAssert(end <= length);
+
+    frameArray.clear();
+    for (int64 pos = movi + 4; pos + 8 <= end; ) {
+        bi.setPosition(pos);
+        const String& id = bi.readFixedLengthString(4);
+        const int size = int(bi.readUInt32());
+        // Video chunks are "##db" (uncompressed) or "##dc"; others are indices and padding
+        if ((id[2] == 'd') && ((id[3] == 'b') || (id[3] == 'c'))) {
+            Array<uint8>& frame = frameArray.next();
+            frame.resize(size);
+            bi.readBytes(frame.getCArray(), size);
+        }
+        // Chunks are word aligned
+        pos += 8 + size + (size & 1);
+    }
+}
+
+
+/** Asserts that \a frame, a chunk from an uncompressed AVI, holds frame \a index as BGR
+    rows, stored bottom-up if \a inverted */
+static void checkFrame(const Array<uint8>& frame, int index, bool inverted) {
+    // Rows may be padded
+    testAssert((frame.size() % VIDEO_HEIGHT) == 0);
+    const int stride = frame.size() / VIDEO_HEIGHT;
+    testAssert(stride >= VIDEO_WIDTH * 3);
+
+    for (int row = 0; row < VIDEO_HEIGHT; ++row) {
+        const int y = inverted ? (VIDEO_HEIGHT - 1 - row) : row;
+        const uint8* p = frame.getCArray() + row * stride;
+        for (int x = 0; x < VIDEO_WIDTH; ++x) {
+            const Color3unorm8& c = framePixel(index, x, y);
+            testAssertM((p[x * 3] == c.b.bits()) && (p[x * 3 + 1] == c.g.bits()) && (p[x * 3 + 2] == c.r.bits()),
+                        "Wrong channel or row order in an uncompressed AVI frame");
+        }
+    }
+}
+
+
+/** Appends \a numFrames frames in \a format and returns the video chunks of the committed file */
+static void encode(const VideoOutput::Settings& settings, int numFrames, const ImageFormat* format, Array<Array<uint8> >& frameArray, int& droppedFrames, int& stalledFrames) {
+    const String filename = "VideoOutputTest.avi";
+    const shared_ptr<VideoOutput>& video = VideoOutput::create(filename, settings);
+    testAssert(notNull(video));
+
+    for (int i = 0; i < numFrames; ++i) {
+        video->append(makeFrame(i, format));
+        testAssert(video->pendingFrames() <= iMax(1, settings.asynchronous.queueLength));
+    }
+    video->commit();
+    testAssert(video->finished());
+    testAssert(video->pendingFrames() == 0);
+
+    droppedFrames = video->droppedFrames();
+    stalledFrames = video->stalledFrames();
+
+    readRawAVIFrames(filename, frameArray);
+    FileSystem::removeFile(filename);
+}
+
+
+void testVideoOutput() {
+    printf("VideoOutput ");
+
+    if (! VideoOutput::supports(VideoOutput::CODEC_ID_RAWVIDEO)) {
+        printf("(no raw video encoder; skipping) passed\n");
+        return;
+    }
+
+    const int numFrames = 20;
+    int dropped = 0, stalled = 0;
+    Array<Array<uint8> > frameArray;
+
+    // Synchronous encoding never drops or stalls. BGR8 input is stored unchanged.
+    VideoOutput::Settings settings = VideoOutput::Settings::rawAVI(VIDEO_WIDTH, VIDEO_HEIGHT);
+    encode(settings, numFrames, ImageFormat::BGR8(), frameArray, dropped, stalled);
+    testAssert(frameArray.size() == numFrames);
+    testAssert((dropped == 0) && (stalled == 0));
+    for (int i = 0; i < numFrames; ++i) {
+        checkFrame(frameArray[i], i, false);
+    }
+
+    // Asynchronous encoding that blocks when the queue is full encodes every frame. RGB8
+    // input is swizzled to BGR, and raw.invert reverses the rows.
+    settings.raw.invert = true;
+    settings.asynchronous.enabled = true;
+    settings.asynchronous.queueLength = 2;
+    settings.asynchronous.dropFramesWhenFull = false;
+    encode(settings, numFrames, ImageFormat::RGB8(), frameArray, dropped, stalled);
+    testAssert(frameArray.size() == numFrames);
+    testAssert(dropped == 0);
+    testAssert(stalled <= numFrames);
+    for (int i = 0; i < numFrames; ++i) {
+        checkFrame(frameArray[i], i, true);
+    }
+
+    // A one-frame queue that drops when full encodes exactly the frames that were not dropped
+    settings.asynchronous.queueLength = 1;
+    settings.asynchronous.dropFramesWhenFull = true;
+    encode(settings, numFrames, ImageFormat::RGB8(), frameArray, dropped, stalled);
+    testAssert(stalled == 0);
+    testAssert(dropped < numFrames);
+    testAssert(frameArray.size() == numFrames - dropped);
+    checkFrame(frameArray[0], 0, true);
+
+    // abort() discards queued frames and removes the file
+    settings.asynchronous.queueLength = 4;
+    settings.asynchronous.dropFramesWhenFull = false;
+    {
+        const shared_ptr<VideoOutput>& video = VideoOutput::create("VideoOutputTest.avi", settings);
+        for (int i = 0; i < 4; ++i) {
+            video->append(makeFrame(i, ImageFormat::RGB8()));
+        }
+        video->abort();
+        testAssert(video->finished() && (video->pendingFrames() == 0));
+        FileSystem::clearCache();
+        testAssert(! FileSystem::exists("VideoOutputTest.avi"));
+    }
+
+    printf("passed\n");
+}
@@ -0,0 +1,82 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <algorithm>
+
+namespace {
+struct Element {
+    uint32  key;
+    int     index;
+};
+}
+
+/** Sorts \a n elements with keys below 2^numKeyBits and compares the result against
+    std::stable_sort. The original index of each element identifies it, so any reordering
+    of equal keys is detected. */
+static void testRadixSortCase(int n, int numKeyBits, int numDistinctKeys, int elementsPerTask, Random& rnd) {
+    Array<Element> element, scratch;
+    element.resize(n);
+    scratch.resize(n);
+    const uint32 maxKey = uint32((uint64(1) << numKeyBits) - 1);
+    Array<uint32> keyTable;
+    for (int k = 0; k < numDistinctKeys; ++k) {
+        keyTable.append(rnd.bits() & maxKey);
+    }
+    for (int i = 0; i < n; ++i) {
+        element[i].key   = keyTable[rnd.integer(0, numDistinctKeys - 1)];
+        element[i].index = i;
+    }
+
+    Array<Element> expected = element;
+    std::stable_sort(expected.begin(), expected.end(), [](const Element& a, const Element& b) { return a.key < b.key; });
+
+    const Element* sorted = radixSortByKey(element.getCArray(), scratch.getCArray(), n, numKeyBits, elementsPerTask);
+    testAssert((sorted == element.getCArray()) || (sorted == scratch.getCArray()));
+    for (int i = 0; i < n; ++i) {
+        testAssertM((sorted[i].key == expected[i].key) && (sorted[i].index == expected[i].index), "Radix sort disagrees with std::stable_sort");
+    }
+}
+
+
+void testRadixSort() {
+    printf("radixSortByKey ");
+    Random rnd(5, false);
+
+    // Empty and single-element arrays
+    testRadixSortCase(0, 24, 1, 16, rnd);
+    testRadixSortCase(1, 24, 1, 16, rnd);
+
+    // Odd sizes that leave a partial final task, with many duplicate keys
+    testRadixSortCase(1001, 24, 7, 64, rnd);
+    testRadixSortCase(4097, 24, 300, 1000, rnd);
+
+    // Every key equal, so that every pass is skipped
+    testRadixSortCase(999, 24, 1, 100, rnd);
+
+    // Keys that differ only in some digits, so that some passes are skipped
+    {
+        Array<Element> element, scratch;
+        element.resize(777);
+        scratch.resize(777);
+        for (int i = 0; i < element.size(); ++i) {
+            element[i].key   = uint32(rnd.integer(0, 3) << 8) | 0xA0005;
+            element[i].index = i;
+        }
+        const Element* sorted = radixSortByKey(element.getCArray(), scratch.getCArray(), element.size(), 24, 50);
+        for (int i = 1; i < element.size(); ++i) {
+            testAssert((sorted[i - 1].key < sorted[i].key) ||
+                       ((sorted[i - 1].key == sorted[i].key) && (sorted[i - 1].index < sorted[i].index)));
+        }
+    }
+
+    // Full 32-bit keys and distinct keys, in one task and in many
+    testRadixSortCase(3333, 32, 3333, 100000, rnd);
+    testRadixSortCase(50001, 32, 1000, 4096, rnd);
+
+    // Concurrent sorts do not share state
+    Thread::runConcurrently(0, 8, [&](int t) {
+        Random threadRnd(100 + t, false);
+        testRadixSortCase(20001 + t, 24, 500, 1024, threadRnd);
+    });
+
+    printf("passed\n");
+}
@@ -16,6 +16,38 @@ static bool zipfileExistsTest(const String& filename) {
 }
 
 
+static void testZipfileCache() {
+    const shared_ptr<ZipfileCache::Archive>& a = ZipfileCache::archive("apiTest.zip");
+    testAssertM(notNull(a), "ZipfileCache could not open apiTest.zip");
+
+    // Repeated lookups share one parsed directory
+    testAssertM(ZipfileCache::archive("apiTest.zip") == a, "ZipfileCache did not reuse the open archive");
+    testAssertM(a->contains("Test.txt") && a->contains("test.TXT"), "ZipfileCache lookup is not case insensitive");
+    testAssertM(! a->contains("Grawk"), "ZipfileCache found a nonexistent entry");
+    testAssertM(a->size("Test.txt") == 69, "ZipfileCache size failed");
+
+    // Concurrent reads must each see the whole entry
+    const int index = a->find("Test.txt");
+    const String& expected = readWholeFile("TestDir/Test.txt");
+    Array<String> result;
+    result.resize(16);
+    Thread::runConcurrently(0, result.size(), [&](int i) {
+        Array<char> buffer;
+        buffer.resize((int)a->entry(index).size);
+        if (a->read(index, buffer.getCArray())) {
+            result[i] = String(buffer.getCArray(), buffer.size());
+        }
+    });
+    for (int i = 0; i < result.size(); ++i) {
+        testAssertM(result[i] == expected, "ZipfileCache parallel read failed");
+    }
+
+    // Flushing the FileSystem cache closes the archive
+    FileSystem::clearCache();
+    testAssertM(ZipfileCache::archive("apiTest.zip") != a, "FileSystem::clearCache did not flush ZipfileCache");
+}
+
+
 void testZip() {
 	
 	printf("zip API ");
@@ -115,6 +147,8 @@ void testZip() {
 	}
 	testAssertM(zipLength, "Zip fileLength failed.");
 
+    testZipfileCache();
+
 
 	printf("passed\n");
 }